@@ -219,6 +219,12 @@ CREATE FUNCTION pgstrom.psum_x2(float8)
   AS 'MODULE_PATHNAME', 'pgstrom_partial_sum_x2_float8'
   LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
+-- PCOMP() - rounding error of the compensated summation
+CREATE FUNCTION pgstrom.pcomp(float8)
+  RETURNS float8
+  AS 'MODULE_PATHNAME', 'pgstrom_partial_compensation'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
 CREATE AGGREGATE pgstrom.fsum_numeric(float8)
 (
   sfunc = pg_catalog.float8pl,
@@ -227,6 +233,22 @@ CREATE AGGREGATE pgstrom.fsum_numeric(float8)
   parallel = safe
 );
 
+-- SUM/AVG of numeric(p,s) in fixed-point
+CREATE FUNCTION pgstrom.numeric_fixed_int8(numeric,int4)
+  RETURNS int8
+  AS 'MODULE_PATHNAME', 'pgstrom_numeric_fixed_int8'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.numeric_fixed_sum(numeric,int4)
+  RETURNS numeric
+  AS 'MODULE_PATHNAME', 'pgstrom_numeric_fixed_sum'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.numeric_fixed_avg(numeric,int8,int4)
+  RETURNS numeric
+  AS 'MODULE_PATHNAME', 'pgstrom_numeric_fixed_avg'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
 -- PCOV_*
 CREATE FUNCTION pgstrom.pcov_x(bool,float8,float8)
   RETURNS float8
@@ -491,3 +513,35 @@ CREATE AGGREGATE pgstrom.regr_syy(float8[])
   finalfunc = pg_catalog.float8_regr_syy,
   parallel = safe
 );
+
+-- PERCENTILE_CONT() / PERCENTILE_DISC()
+CREATE FUNCTION pgstrom.percentile_weighted_accum(internal,float8,float8,int8)
+  RETURNS internal
+  AS 'MODULE_PATHNAME','pgstrom_percentile_weighted_accum'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.percentile_cont_weighted_final(internal)
+  RETURNS float8
+  AS 'MODULE_PATHNAME','pgstrom_percentile_cont_weighted_final'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.percentile_disc_weighted_final(internal)
+  RETURNS float8
+  AS 'MODULE_PATHNAME','pgstrom_percentile_disc_weighted_final'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE AGGREGATE pgstrom.percentile_cont(float8,float8,int8)
+(
+  sfunc = pgstrom.percentile_weighted_accum,
+  stype = internal,
+  finalfunc = pgstrom.percentile_cont_weighted_final,
+  parallel = safe
+);
+
+CREATE AGGREGATE pgstrom.percentile_disc(float8,float8,int8)
+(
+  sfunc = pgstrom.percentile_weighted_accum,
+  stype = internal,
+  finalfunc = pgstrom.percentile_disc_weighted_final,
+  parallel = safe
+);
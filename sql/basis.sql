@@ -74,6 +74,52 @@ CREATE FUNCTION public.gpu_pci_id(int = 0)
   AS 'MODULE_PATHNAME','pgstrom_gpu_pci_id'
   LANGUAGE C STRICT;
 
+--
+-- Calibration of the GPU cost model
+--
+CREATE TYPE pgstrom.__pgstrom_gpu_device_benchmark AS (
+  device_nr       int,
+  setup_usec      float8,
+  launch_usec     float8,
+  dma_usec_per_mb float8,
+  gpu_op_nsec     float8,
+  cpu_op_nsec     float8
+);
+CREATE FUNCTION pgstrom.gpu_device_benchmark()
+  RETURNS SETOF pgstrom.__pgstrom_gpu_device_benchmark
+  AS 'MODULE_PATHNAME','pgstrom_gpu_device_benchmark'
+  LANGUAGE C STRICT VOLATILE;
+
+CREATE TABLE pgstrom.gpu_cost_calibration (
+  device_nr       int,
+  setup_usec      float8,
+  launch_usec     float8,
+  dma_usec_per_mb float8,
+  gpu_op_nsec     float8,
+  cpu_op_nsec     float8,
+  measured_at     timestamptz
+);
+SELECT pg_catalog.pg_extension_config_dump('pgstrom.gpu_cost_calibration', '');
+
+CREATE FUNCTION pgstrom.gpu_cost_calibration_invalidator()
+  RETURNS trigger
+  AS 'MODULE_PATHNAME','pgstrom_gpu_cost_calibration_invalidator'
+  LANGUAGE C STRICT;
+CREATE TRIGGER gpu_cost_calibration_inval
+  AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE
+  ON pgstrom.gpu_cost_calibration
+  FOR EACH STATEMENT
+  EXECUTE PROCEDURE pgstrom.gpu_cost_calibration_invalidator();
+
+CREATE FUNCTION pgstrom.gpu_cost_calibrate()
+  RETURNS SETOF pgstrom.gpu_cost_calibration
+  AS $$
+    DELETE FROM pgstrom.gpu_cost_calibration;
+    INSERT INTO pgstrom.gpu_cost_calibration
+      SELECT *, now() FROM pgstrom.gpu_device_benchmark();
+    SELECT * FROM pgstrom.gpu_cost_calibration;
+  $$ LANGUAGE sql VOLATILE;
+
 --
 -- Functions for system internal state
 --
@@ -91,6 +137,27 @@ CREATE FUNCTION pgstrom.pgstrom_device_preserved_meminfo()
 CREATE VIEW pgstrom.device_preserved_meminfo
   AS SELECT * FROM pgstrom.pgstrom_device_preserved_meminfo();
 
+CREATE TYPE pgstrom.__pgstrom_gpu_activity AS (
+  device_nr       int4,
+  pid             int4,
+  since           timestamp with time zone,
+  running_tasks   int4,
+  pending_tasks   int4,
+  completed_tasks int8,
+  dma_send_bytes  int8,
+  dma_recv_bytes  int8,
+  gpu_task_time   float8,
+  gpumem_usage    int8,
+  nvme_bytes      int8,
+  nvme_time       float8
+);
+CREATE FUNCTION pgstrom.pgstrom_gpu_activity()
+  RETURNS SETOF pgstrom.__pgstrom_gpu_activity
+  AS 'MODULE_PATHNAME'
+  LANGUAGE C VOLATILE;
+CREATE VIEW pgstrom.pg_stat_gpu_activity
+  AS SELECT * FROM pgstrom.pgstrom_gpu_activity();
+
 --
 -- Functions/Languages to support PL/CUDA
 --
@@ -315,11 +382,41 @@ CREATE FUNCTION public.gstore_fdw_rawsize(reggstore)
   AS 'MODULE_PATHNAME','pgstrom_gstore_fdw_rawsize'
   LANGUAGE C STRICT;
 
+CREATE FUNCTION public.gstore_fdw_compact(reggstore)
+  RETURNS int
+  AS 'MODULE_PATHNAME','pgstrom_gstore_fdw_compact'
+  LANGUAGE C STRICT;
+
 CREATE FUNCTION public.gstore_export_ipchandle(reggstore)
   RETURNS bytea
   AS 'MODULE_PATHNAME','pgstrom_gstore_export_ipchandle'
   LANGUAGE C;
 
+CREATE FUNCTION public.gstore_export_ipchandle_shards(reggstore,
+                                                      OUT pinning int,
+                                                      OUT nitems bigint,
+                                                      OUT rawsize bigint,
+                                                      OUT ipc_handle bytea)
+  RETURNS SETOF record
+  AS 'MODULE_PATHNAME','pgstrom_gstore_export_ipchandle_shards'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION public.gstore_export_column_layout(reggstore,
+                                                   OUT segment int,
+                                                   OUT pinning int,
+                                                   OUT attnum smallint,
+                                                   OUT attname name,
+                                                   OUT typestr text,
+                                                   OUT encoding text,
+                                                   OUT nitems bigint,
+                                                   OUT values_offset bigint,
+                                                   OUT values_length bigint,
+                                                   OUT nullmap_offset bigint,
+                                                   OUT nullmap_length bigint)
+  RETURNS SETOF record
+  AS 'MODULE_PATHNAME','pgstrom_gstore_export_column_layout'
+  LANGUAGE C STRICT;
+
 CREATE TYPE pgstrom.__gstore_fdw_chunk_info AS (
   database_oid	oid,
   table_oid		oid,
@@ -371,6 +468,30 @@ CREATE FUNCTION pg_catalog.int8_as_float8(int8)
   AS 'MODULE_PATHNAME','int8_as_float8'
   LANGUAGE C STRICT;
 
+--
+-- Bucketing functions for time-series aggregation
+--
+CREATE FUNCTION pgstrom.time_bucket(interval, timestamp)
+  RETURNS timestamp
+  AS 'MODULE_PATHNAME','pgstrom_time_bucket_timestamp'
+  LANGUAGE C STRICT IMMUTABLE;
+
+CREATE FUNCTION pgstrom.time_bucket(interval, timestamptz)
+  RETURNS timestamptz
+  AS 'MODULE_PATHNAME','pgstrom_time_bucket_timestamptz'
+  LANGUAGE C STRICT IMMUTABLE;
+
+--
+-- GPU accelerated data loading from CSV files
+--
+CREATE FUNCTION pgstrom.copy_gpu(regclass,
+                                 text,              -- file name
+                                 text=',',          -- delimiter
+                                 bool=false)        -- header line
+  RETURNS bigint
+  AS 'MODULE_PATHNAME','pgstrom_copy_gpu'
+  LANGUAGE C STRICT;
+
 --
 -- Function to query commercial license
 --
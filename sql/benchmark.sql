@@ -0,0 +1,180 @@
+--
+-- SQL functions to run micro-benchmark of PG-Strom
+--
+-- pgstrom.benchmark_setup() builds a synthetic fact table (<name>_f) and
+-- dimension table (<name>_d) with the specified row width, number of
+-- groups and join fan-out. Then, pgstrom.benchmark_run() runs a workload
+-- ('scan', 'join' or 'preagg') on the specified mode ('cpu', 'gpu' or
+-- 'nvme'), and reports its throughput. pgstrom.benchmark_suite() runs all
+-- the combinations. Its result can be saved in machine-readable form, like:
+--
+--   COPY (SELECT * FROM pgstrom.benchmark_suite()) TO STDOUT CSV HEADER;
+--
+CREATE FUNCTION pgstrom.benchmark_setup(bigint,              -- nrows
+                                        int = 100,           -- row width
+                                        int = 1000,          -- ngroups
+                                        int = 1,             -- join fan-out
+                                        text = 'pgstrom_bench')
+  RETURNS text
+AS $$
+DECLARE
+  nrows     ALIAS FOR $1;
+  width     ALIAS FOR $2;
+  ngroups   ALIAS FOR $3;
+  fanout    ALIAS FOR $4;
+  tblname   ALIAS FOR $5;
+  ndimkeys  int = 10000;
+BEGIN
+  IF nrows <= 0 OR width <= 0 OR ngroups <= 0 OR fanout <= 0 THEN
+    RAISE EXCEPTION 'benchmark parameters must be positive';
+  END IF;
+
+  EXECUTE format('DROP TABLE IF EXISTS %I, %I',
+                 tblname || '_f', tblname || '_d');
+  EXECUTE format('CREATE TABLE %I (id int8, gkey int4, jkey int4, '
+                 'sel float8, val float8, pad text)',
+                 tblname || '_f');
+  EXECUTE format('CREATE TABLE %I (jkey int4, val float8)',
+                 tblname || '_d');
+  -- 'sel' is uniformly distributed in [0,100), to control the selectivity
+  EXECUTE format('INSERT INTO %I '
+                 'SELECT x, pgstrom.random_int(0.0, 1, %s), '
+                 '          pgstrom.random_int(0.0, 1, %s), '
+                 '          pgstrom.random_float(0.0, 0.0, 100.0), '
+                 '          pgstrom.random_float(0.0, -1000.0, 1000.0), '
+                 '          lpad(md5(x::text), %s, ''-'') '
+                 '  FROM generate_series(1, %s) x',
+                 tblname || '_f', ngroups, ndimkeys, width, nrows);
+  -- every key of the dimension table appears 'fanout' times
+  EXECUTE format('INSERT INTO %I '
+                 'SELECT k, pgstrom.random_float(0.0, -1000.0, 1000.0) '
+                 '  FROM generate_series(1, %s) k, generate_series(1, %s) f',
+                 tblname || '_d', ndimkeys, fanout);
+  EXECUTE format('ANALYZE %I, %I', tblname || '_f', tblname || '_d');
+
+  RETURN format('%s rows of %s bytes width, %s groups, join fan-out %s',
+                nrows, width, ngroups, fanout);
+END
+$$ LANGUAGE 'plpgsql';
+
+CREATE TYPE pgstrom.__pgstrom_benchmark_result AS (
+  workload     text,
+  mode         text,
+  selectivity  float8,
+  nitems       bigint,
+  nbytes       bigint,
+  nresults     bigint,
+  elapsed_ms   float8,
+  rows_per_sec float8,
+  gb_per_sec   float8
+);
+
+CREATE FUNCTION pgstrom.benchmark_run(text,                  -- workload
+                                      text = 'gpu',          -- mode
+                                      float8 = 10.0,         -- selectivity (%)
+                                      int = 3,               -- loops
+                                      text = 'pgstrom_bench')
+  RETURNS pgstrom.__pgstrom_benchmark_result
+AS $$
+DECLARE
+  workload  ALIAS FOR $1;
+  mode      ALIAS FOR $2;
+  sel       ALIAS FOR $3;
+  loops     ALIAS FOR $4;
+  tblname   ALIAS FOR $5;
+  query     text;
+  tv_begin  timestamptz;
+  elapsed   float8;
+  r         pgstrom.__pgstrom_benchmark_result;
+BEGIN
+  -- configuration of the mode; reverted at end of the transaction
+  IF mode = 'cpu' THEN
+    PERFORM set_config('pg_strom.enabled', 'off', true);
+  ELSIF mode = 'gpu' OR mode = 'nvme' THEN
+    PERFORM set_config('pg_strom.enabled', 'on', true);
+    PERFORM set_config('pg_strom.enable_gpuscan', 'on', true);
+    PERFORM set_config('pg_strom.enable_gpuhashjoin', 'on', true);
+    PERFORM set_config('pg_strom.enable_gpupreagg',
+                       CASE WHEN workload = 'preagg' THEN 'on' ELSE 'off' END,
+                       true);
+    IF mode = 'nvme' THEN
+      PERFORM set_config('pg_strom.nvme_strom_enabled', 'on', true);
+      PERFORM set_config('pg_strom.nvme_strom_threshold', '0', true);
+    END IF;
+  ELSE
+    RAISE EXCEPTION 'unknown benchmark mode: %', mode;
+  END IF;
+
+  -- OFFSET 0 prevents the sub-query to be pulled up to the aggregation,
+  -- so the result rows are actually returned to the CPU side
+  IF workload = 'scan' THEN
+    query := format('SELECT count(*) FROM ('
+                    'SELECT id, pad FROM %I WHERE sel < %s OFFSET 0) q',
+                    tblname || '_f', sel);
+  ELSIF workload = 'join' THEN
+    query := format('SELECT count(*) FROM ('
+                    'SELECT f.id, d.val FROM %I f, %I d '
+                    ' WHERE f.jkey = d.jkey AND f.sel < %s OFFSET 0) q',
+                    tblname || '_f', tblname || '_d', sel);
+  ELSIF workload = 'preagg' THEN
+    query := format('SELECT count(*) FROM ('
+                    'SELECT gkey, count(*), sum(val) FROM %I '
+                    ' WHERE sel < %s GROUP BY gkey) q',
+                    tblname || '_f', sel);
+  ELSE
+    RAISE EXCEPTION 'unknown benchmark workload: %', workload;
+  END IF;
+
+  r.workload := workload;
+  r.mode := mode;
+  r.selectivity := sel;
+  SELECT reltuples::bigint INTO r.nitems
+    FROM pg_catalog.pg_class
+   WHERE oid = (tblname || '_f')::regclass;
+  r.nbytes := pg_relation_size((tblname || '_f')::regclass);
+  IF workload = 'join' THEN
+    r.nbytes := r.nbytes + pg_relation_size((tblname || '_d')::regclass);
+  END IF;
+
+  -- the best one of the loops, to exclude JIT compile or cold cache
+  FOR i IN 1 .. greatest(loops, 1) LOOP
+    tv_begin := clock_timestamp();
+    EXECUTE query INTO r.nresults;
+    elapsed := extract(epoch from clock_timestamp() - tv_begin) * 1000.0;
+    IF r.elapsed_ms IS NULL OR elapsed < r.elapsed_ms THEN
+      r.elapsed_ms := elapsed;
+    END IF;
+  END LOOP;
+  r.rows_per_sec := r.nitems / greatest(r.elapsed_ms, 0.001) * 1000.0;
+  r.gb_per_sec := r.nbytes / greatest(r.elapsed_ms, 0.001) * 1000.0
+                  / (1024.0 * 1024.0 * 1024.0);
+  RETURN r;
+END
+$$ LANGUAGE 'plpgsql';
+
+CREATE FUNCTION pgstrom.benchmark_suite(float8 = 10.0,       -- selectivity (%)
+                                        int = 3,             -- loops
+                                        bool = false,        -- with nvme
+                                        text = 'pgstrom_bench')
+  RETURNS SETOF pgstrom.__pgstrom_benchmark_result
+AS $$
+DECLARE
+  sel       ALIAS FOR $1;
+  loops     ALIAS FOR $2;
+  with_nvme ALIAS FOR $3;
+  tblname   ALIAS FOR $4;
+  workload  text;
+  mode      text;
+  r         pgstrom.__pgstrom_benchmark_result;
+BEGIN
+  -- 'nvme' mode shall be the last, because configuration of the NVMe-Strom
+  -- is kept until end of the transaction
+  FOREACH mode IN ARRAY ARRAY['cpu', 'gpu', 'nvme'] LOOP
+    CONTINUE WHEN mode = 'nvme' AND NOT with_nvme;
+    FOREACH workload IN ARRAY ARRAY['scan', 'join', 'preagg'] LOOP
+      r := pgstrom.benchmark_run(workload, mode, sel, loops, tblname);
+      RETURN NEXT r;
+    END LOOP;
+  END LOOP;
+END
+$$ LANGUAGE 'plpgsql';
@@ -4,38 +4,54 @@
 CREATE FUNCTION pgstrom.array_matrix_accum(internal, variadic bool[])
   RETURNS internal
   AS 'MODULE_PATHNAME','array_matrix_accum'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 CREATE FUNCTION pgstrom.array_matrix_accum(internal, variadic int2[])
   RETURNS internal
   AS 'MODULE_PATHNAME','array_matrix_accum'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 CREATE FUNCTION pgstrom.array_matrix_accum(internal, variadic int4[])
   RETURNS internal
   AS 'MODULE_PATHNAME','array_matrix_accum'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 CREATE FUNCTION pgstrom.array_matrix_accum(internal, variadic int8[])
   RETURNS internal
   AS 'MODULE_PATHNAME','array_matrix_accum'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 CREATE FUNCTION pgstrom.array_matrix_accum(internal, variadic real[])
   RETURNS internal
   AS 'MODULE_PATHNAME','array_matrix_accum'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 CREATE FUNCTION pgstrom.array_matrix_accum(internal, variadic float[])
   RETURNS internal
   AS 'MODULE_PATHNAME','array_matrix_accum'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 -- varbit as matrix of int4[]
 CREATE FUNCTION pgstrom.array_matrix_accum_varbit(internal, bit)
   RETURNS internal
   AS 'MODULE_PATHNAME','array_matrix_accum_varbit'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+-- combine/serialize/deserialize for parallel aggregation
+CREATE FUNCTION pgstrom.array_matrix_combine(internal, internal)
+  RETURNS internal
+  AS 'MODULE_PATHNAME','array_matrix_combine'
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.array_matrix_serialize(internal)
+  RETURNS bytea
+  AS 'MODULE_PATHNAME','array_matrix_serialize'
+  LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION pgstrom.array_matrix_deserialize(bytea, internal)
+  RETURNS internal
+  AS 'MODULE_PATHNAME','array_matrix_deserialize'
+  LANGUAGE C STRICT PARALLEL SAFE;
 
 -- type case varbit <--> int4[]
 CREATE FUNCTION pgstrom.varbit_to_int4_array(bit)
@@ -60,80 +76,108 @@ CREATE CAST (int4[] AS bit)
 CREATE FUNCTION pgstrom.array_matrix_final_bool(internal)
   RETURNS bool[]
   AS 'MODULE_PATHNAME','array_matrix_final_bool'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 CREATE FUNCTION pgstrom.array_matrix_final_int2(internal)
   RETURNS int2[]
   AS 'MODULE_PATHNAME','array_matrix_final_int2'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 CREATE FUNCTION pgstrom.array_matrix_final_int4(internal)
   RETURNS int4[]
   AS 'MODULE_PATHNAME','array_matrix_final_int4'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 CREATE FUNCTION pgstrom.array_matrix_final_int8(internal)
   RETURNS int8[]
   AS 'MODULE_PATHNAME','array_matrix_final_int8'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 CREATE FUNCTION pgstrom.array_matrix_final_float4(internal)
   RETURNS float4[]
   AS 'MODULE_PATHNAME','array_matrix_final_float4'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 CREATE FUNCTION pgstrom.array_matrix_final_float8(internal)
   RETURNS float8[]
   AS 'MODULE_PATHNAME','array_matrix_final_float8'
-  LANGUAGE C CALLED ON NULL INPUT;
+  LANGUAGE C CALLED ON NULL INPUT PARALLEL SAFE;
 
 CREATE AGGREGATE pg_catalog.array_matrix(variadic bool[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_bool
+  finalfunc = pgstrom.array_matrix_final_bool,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(variadic int2[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_int2
+  finalfunc = pgstrom.array_matrix_final_int2,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(variadic int4[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_int4
+  finalfunc = pgstrom.array_matrix_final_int4,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(variadic int8[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_int8
+  finalfunc = pgstrom.array_matrix_final_int8,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(variadic float4[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_float4
+  finalfunc = pgstrom.array_matrix_final_float4,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(variadic float8[])
 (
   sfunc = pgstrom.array_matrix_accum,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_float8
+  finalfunc = pgstrom.array_matrix_final_float8,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE AGGREGATE pg_catalog.array_matrix(bit)
 (
   sfunc = pgstrom.array_matrix_accum_varbit,
   stype = internal,
-  finalfunc = pgstrom.array_matrix_final_int4
+  finalfunc = pgstrom.array_matrix_final_int4,
+  combinefunc = pgstrom.array_matrix_combine,
+  serialfunc = pgstrom.array_matrix_serialize,
+  deserialfunc = pgstrom.array_matrix_deserialize,
+  parallel = safe
 );
 
 CREATE FUNCTION pg_catalog.array_matrix_validation(anyarray)
@@ -550,3 +594,45 @@ CREATE FUNCTION pg_catalog.transpose(float8[])
   RETURNS float8[]
   AS 'MODULE_PATHNAME','array_matrix_transpose_float8'
   LANGUAGE C STRICT;
+
+CREATE FUNCTION pg_catalog.matrix_multiply(float4[], float4[])
+  RETURNS float4[]
+  AS 'MODULE_PATHNAME','array_matrix_multiply_float4'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION pg_catalog.matrix_multiply(float8[], float8[])
+  RETURNS float8[]
+  AS 'MODULE_PATHNAME','array_matrix_multiply_float8'
+  LANGUAGE C STRICT;
+
+CREATE OPERATOR pg_catalog.* (
+  PROCEDURE = pg_catalog.matrix_multiply,
+  LEFTARG = float4[],
+  RIGHTARG = float4[]
+);
+
+CREATE OPERATOR pg_catalog.* (
+  PROCEDURE = pg_catalog.matrix_multiply,
+  LEFTARG = float8[],
+  RIGHTARG = float8[]
+);
+
+CREATE FUNCTION pg_catalog.matrix_tmultiply(float4[], float4[])
+  RETURNS float4[]
+  AS 'MODULE_PATHNAME','array_matrix_tmultiply_float4'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION pg_catalog.matrix_tmultiply(float8[], float8[])
+  RETURNS float8[]
+  AS 'MODULE_PATHNAME','array_matrix_tmultiply_float8'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION pg_catalog.matrix_dot(float4[], float4[])
+  RETURNS float4[]
+  AS 'MODULE_PATHNAME','array_matrix_dot_float4'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION pg_catalog.matrix_dot(float8[], float8[])
+  RETURNS float8[]
+  AS 'MODULE_PATHNAME','array_matrix_dot_float8'
+  LANGUAGE C STRICT;
@@ -102,3 +102,12 @@ CREATE FUNCTION pgstrom.random_daterange(float=0.0,
   RETURNS daterange
   AS 'MODULE_PATHNAME','pgstrom_random_daterange'
   LANGUAGE C CALLED ON NULL INPUT;
+
+-- GPU version of the above generators, to build large tables quickly
+CREATE FUNCTION pgstrom.random_fill(regclass,
+                                    bigint,         -- number of rows
+                                    float=0.0,      -- NULL ratio (%)
+                                    bigint=null)    -- random seed
+  RETURNS bigint
+  AS 'MODULE_PATHNAME','pgstrom_random_fill'
+  LANGUAGE C CALLED ON NULL INPUT;
@@ -37,6 +37,10 @@ Datum pgstrom_partial_sum_any(PG_FUNCTION_ARGS);
 Datum pgstrom_partial_sum_x2_float4(PG_FUNCTION_ARGS);
 Datum pgstrom_partial_sum_x2_float8(PG_FUNCTION_ARGS);
 Datum pgstrom_partial_sum_x2_numeric(PG_FUNCTION_ARGS);
+Datum pgstrom_partial_compensation(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_fixed_int8(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_fixed_sum(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_fixed_avg(PG_FUNCTION_ARGS);
 Datum pgstrom_partial_cov_x(PG_FUNCTION_ARGS);
 Datum pgstrom_partial_cov_y(PG_FUNCTION_ARGS);
 Datum pgstrom_partial_cov_x2(PG_FUNCTION_ARGS);
@@ -48,6 +52,9 @@ Datum pgstrom_float8_stddev_samp_numeric(PG_FUNCTION_ARGS);
 Datum pgstrom_float8_stddev_pop_numeric(PG_FUNCTION_ARGS);
 Datum pgstrom_float8_var_samp_numeric(PG_FUNCTION_ARGS);
 Datum pgstrom_float8_var_pop_numeric(PG_FUNCTION_ARGS);
+Datum pgstrom_percentile_weighted_accum(PG_FUNCTION_ARGS);
+Datum pgstrom_percentile_cont_weighted_final(PG_FUNCTION_ARGS);
+Datum pgstrom_percentile_disc_weighted_final(PG_FUNCTION_ARGS);
 
 /* utility to reference numeric[] */
 static inline Datum
@@ -302,6 +309,91 @@ pgstrom_partial_sum_any(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_partial_sum_any);
 
+/*
+ * pgstrom.pcomp(float8)
+ *
+ * Rounding error of the compensated summation. A single row has no error,
+ * so it is always zero; GPU kernel accumulates the errors on reduction.
+ */
+Datum
+pgstrom_partial_compensation(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(0.0);
+}
+PG_FUNCTION_INFO_V1(pgstrom_partial_compensation);
+
+/*
+ * numeric_fixed_power10 - returns 10^expo in numeric
+ */
+static Datum
+numeric_fixed_power10(int expo)
+{
+	char	buf[32];
+
+	snprintf(buf, sizeof(buf), "1e%d", expo);
+	return DirectFunctionCall3(numeric_in,
+							   CStringGetDatum(buf),
+							   ObjectIdGetDatum(InvalidOid),
+							   Int32GetDatum(-1));
+}
+
+/*
+ * pgstrom.numeric_fixed_int8(numeric,int4)
+ *
+ * CPU version of the fixed-point representation of numeric(p,s); it returns
+ * X * 10^s as int8. Declared scale of the column never leaves any fraction.
+ */
+Datum
+pgstrom_numeric_fixed_int8(PG_FUNCTION_ARGS)
+{
+	Datum	value = PG_GETARG_DATUM(0);
+	int32	scale = PG_GETARG_INT32(1);
+
+	value = DirectFunctionCall2(numeric_mul, value,
+								numeric_fixed_power10(scale));
+	return DirectFunctionCall1(numeric_int8, value);
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_fixed_int8);
+
+/*
+ * pgstrom.numeric_fixed_sum(numeric,int4)
+ *
+ * It turns back the sum of fixed-point values into numeric with scale 's'.
+ */
+Datum
+pgstrom_numeric_fixed_sum(PG_FUNCTION_ARGS)
+{
+	Datum	sum = PG_GETARG_DATUM(0);
+	int32	scale = PG_GETARG_INT32(1);
+
+	return DirectFunctionCall2(numeric_mul, sum,
+							   numeric_fixed_power10(-scale));
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_fixed_sum);
+
+/*
+ * pgstrom.numeric_fixed_avg(numeric,int8,int4)
+ *
+ * It computes average from the sum of fixed-point values and nrows, with
+ * the same result scale as numeric_avg() does.
+ */
+Datum
+pgstrom_numeric_fixed_avg(PG_FUNCTION_ARGS)
+{
+	Datum	sum = PG_GETARG_DATUM(0);
+	int64	nrows = PG_GETARG_INT64(1);
+	int32	scale = PG_GETARG_INT32(2);
+
+	if (nrows == 0)
+		PG_RETURN_NULL();
+	sum = DirectFunctionCall2(numeric_mul, sum,
+							  numeric_fixed_power10(-scale));
+	return DirectFunctionCall2(numeric_div, sum,
+							   DirectFunctionCall1(int8_numeric,
+												   Int64GetDatum(nrows)));
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_fixed_avg);
+
 /*
  * pgstrom.psum_x2(float4)
  */
@@ -498,3 +590,185 @@ pgstrom_float8_var_pop_numeric(PG_FUNCTION_ARGS)
 	PG_RETURN_NUMERIC(DirectFunctionCall1(float8_numeric, datum));
 }
 PG_FUNCTION_INFO_V1(pgstrom_float8_var_pop_numeric);
+
+/*
+ * Weighted percentile aggregates
+ *
+ * GpuPreAgg runs percentile_cont/percentile_disc(FRACTION) WITHIN GROUP
+ * (ORDER BY X) as GROUP BY (..., X) with nrows(), so the final aggregation
+ * receives a set of distinct X and number of its occurrence. These
+ * functions reconstruct the exact percentile from the weighted values,
+ * not an approximation.
+ */
+typedef struct
+{
+	float8		value;
+	int64		count;
+} percentile_weighted_item;
+
+typedef struct
+{
+	float8		fraction;
+	bool		fraction_isnull;
+	int64		nitems;
+	int64		nrooms;
+	int64		total;
+	percentile_weighted_item *items;
+} percentile_weighted_state;
+
+Datum
+pgstrom_percentile_weighted_accum(PG_FUNCTION_ARGS)
+{
+	MemoryContext	aggcxt;
+	percentile_weighted_state *state;
+	int64			count;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	if (PG_ARGISNULL(0))
+	{
+		state = MemoryContextAllocZero(aggcxt,
+									   sizeof(percentile_weighted_state));
+		state->fraction_isnull = PG_ARGISNULL(1);
+		if (!state->fraction_isnull)
+			state->fraction = PG_GETARG_FLOAT8(1);
+	}
+	else
+		state = (percentile_weighted_state *)PG_GETARG_POINTER(0);
+
+	/* NULL values are ignored, like ordered-set aggregates */
+	if (PG_ARGISNULL(2) || PG_ARGISNULL(3))
+		PG_RETURN_POINTER(state);
+	count = PG_GETARG_INT64(3);
+	if (count <= 0)
+		PG_RETURN_POINTER(state);
+
+	if (state->nitems >= state->nrooms)
+	{
+		int64	nrooms = Max(2 * state->nrooms, 1024);
+		Size	len = sizeof(percentile_weighted_item) * nrooms;
+
+		if (!state->items)
+			state->items = MemoryContextAllocHuge(aggcxt, len);
+		else
+			state->items = repalloc_huge(state->items, len);
+		state->nrooms = nrooms;
+	}
+	state->items[state->nitems].value = PG_GETARG_FLOAT8(2);
+	state->items[state->nitems].count = count;
+	state->nitems++;
+	state->total += count;
+
+	PG_RETURN_POINTER(state);
+}
+PG_FUNCTION_INFO_V1(pgstrom_percentile_weighted_accum);
+
+static int
+percentile_weighted_item_cmp(const void *__a, const void *__b)
+{
+	float8		a = ((const percentile_weighted_item *)__a)->value;
+	float8		b = ((const percentile_weighted_item *)__b)->value;
+
+	/* NaN is larger than any other values, same as float8_cmp_internal */
+	if (isnan(a))
+		return (isnan(b) ? 0 : 1);
+	if (isnan(b))
+		return -1;
+	if (a > b)
+		return 1;
+	if (a < b)
+		return -1;
+	return 0;
+}
+
+/*
+ * percentile_weighted_setup - returns the state sorted by the value,
+ * or NULL if result shall be NULL.
+ */
+static percentile_weighted_state *
+percentile_weighted_setup(FunctionCallInfo fcinfo)
+{
+	percentile_weighted_state *state;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (PG_ARGISNULL(0))
+		return NULL;
+	state = (percentile_weighted_state *)PG_GETARG_POINTER(0);
+	if (state->fraction_isnull || state->total == 0)
+		return NULL;
+	if (state->fraction < 0.0 ||
+		state->fraction > 1.0 ||
+		isnan(state->fraction))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("percentile value %g is not between 0 and 1",
+						state->fraction)));
+	/* sort is idempotent, so final function can be called multiple times */
+	qsort(state->items, state->nitems,
+		  sizeof(percentile_weighted_item),
+		  percentile_weighted_item_cmp);
+	return state;
+}
+
+/*
+ * percentile_weighted_fetch - returns the value at the @rownum (0-origin)
+ * of the sorted values, if each value is repeated by its count.
+ */
+static float8
+percentile_weighted_fetch(percentile_weighted_state *state, int64 rownum)
+{
+	int64		i;
+
+	Assert(rownum >= 0 && rownum < state->total);
+	for (i=0; i < state->nitems; i++)
+	{
+		if (rownum < state->items[i].count)
+			return state->items[i].value;
+		rownum -= state->items[i].count;
+	}
+	elog(ERROR, "Bug? rownum is out of the weighted values");
+}
+
+Datum
+pgstrom_percentile_cont_weighted_final(PG_FUNCTION_ARGS)
+{
+	percentile_weighted_state *state = percentile_weighted_setup(fcinfo);
+	float8		position;
+	int64		first_row;
+	int64		second_row;
+	float8		first;
+	float8		second;
+
+	if (!state)
+		PG_RETURN_NULL();
+	/* same logic to percentile_cont_final_common */
+	position = state->fraction * (state->total - 1);
+	first_row = (int64) floor(position);
+	second_row = (int64) ceil(position);
+
+	first = percentile_weighted_fetch(state, first_row);
+	if (first_row == second_row)
+		PG_RETURN_FLOAT8(first);
+	second = percentile_weighted_fetch(state, second_row);
+
+	PG_RETURN_FLOAT8(first + (second - first) * (position - first_row));
+}
+PG_FUNCTION_INFO_V1(pgstrom_percentile_cont_weighted_final);
+
+Datum
+pgstrom_percentile_disc_weighted_final(PG_FUNCTION_ARGS)
+{
+	percentile_weighted_state *state = percentile_weighted_setup(fcinfo);
+	int64		rownum;
+
+	if (!state)
+		PG_RETURN_NULL();
+	/* same logic to percentile_disc_final */
+	rownum = (int64) ceil(state->fraction * state->total);
+	if (rownum > 0)
+		rownum--;
+	PG_RETURN_FLOAT8(percentile_weighted_fetch(state, rownum));
+}
+PG_FUNCTION_INFO_V1(pgstrom_percentile_disc_weighted_final);
@@ -19,6 +19,10 @@
 #include "cuda_plcuda.h"
 
 #define CCACHE_MAX_NUM_DATABASES	100
+#define CCACHE_NUM_RELSTATS			1024
+#define CCACHE_RELSTATS_PROBES		8
+#define CCACHE_MISSHIT_CANDIDATES	32
+#define CCACHE_MISSHIT_HALFLIFE		60		/* seconds */
 #define CCBUILDER_STATE__SHUTDOWN	0
 #define CCBUILDER_STATE__STARTUP	1
 #define CCBUILDER_STATE__LOADING	3
@@ -30,6 +34,20 @@ typedef struct
 	pg_atomic_uint64 curr_scan_pos;
 } ccacheDatabase;
 
+/*
+ * ccacheRelStat - number of ccache misses per relation, to schedule
+ * the chunks to be built by the hottest-first. The counter is halved for
+ * each CCACHE_MISSHIT_HALFLIFE seconds since the last miss.
+ */
+typedef struct
+{
+	Oid			database_oid;
+	Oid			table_oid;
+	cl_ulong	nmisses;
+	TimestampTz	atime;			/* time of the latest miss */
+	BlockNumber	scan_pos;		/* next chunk to be loaded, by builders */
+} ccacheRelStat;
+
 typedef struct
 {
 	int			builder_id;
@@ -48,8 +66,13 @@ typedef struct
 	slock_t			chunks_lock;
 	dlist_head		lru_misshit_list;
 	dlist_head		lru_active_list;
+	dlist_head		lru_stale_list;
 	dlist_head		free_chunks_list;
 	dlist_head	   *active_slots;
+	ccacheRelStat	rel_stats[CCACHE_NUM_RELSTATS];
+	/* management of the in-memory hot tier */
+	cl_int			num_hot_free;
+	cl_int		   *hot_free_slots;
 	/* management of ccache builder workers */
 	pg_atomic_uint32 generation;
 	slock_t			lock;
@@ -74,20 +97,77 @@ struct ccacheChunk
 	Oid			table_oid;		/* OID of the cached table */
 	BlockNumber	block_nr;		/* block number where is head of the chunk */
 	size_t		length;			/* length of the ccache file */
+	ino_t		file_ino;		/* inode number of the ccache file */
 	cl_uint		nitems;			/* number of valid rows cached */
 	cl_int		nattrs;			/* number of regular columns. KDS on ccache
 								 * file has more rows for system columns */
 	cl_int		refcnt;			/* reference counter */
+	cl_uint		nmisses;		/* number of misses until the build */
 	TimestampTz	ctime;			/* timestamp of the cache creation.
 								 * may be zero, if not constructed yet. */
 	TimestampTz	atime;			/* time of the latest access */
+	size_t		zmap_offset;	/* offset of the zone-map in the ccache file,
+								 * or zero if not available */
+	cl_int		hot_slot;		/* 1-origin index of the hot tier slot, if
+								 * chunk is resident. zero means not resident,
+								 * negative means promotion in-progress */
+	bits8		dirty_map[BITMAPLEN(CCACHE_CHUNK_NBLOCKS)];
+								/* blocks updated since the cache creation,
+								 * only valid on the stale chunk */
 };
 typedef struct ccacheChunk		ccacheChunk;
 
+/*
+ * ccacheZoneMap - min/max and null count of a regular column in the chunk.
+ * It is written next to the KDS on the ccache file.
+ */
+typedef struct
+{
+	cl_uint		nullcount;		/* number of NULLs */
+	cl_bool		has_minmax;		/* true, if min/max values are valid */
+	Datum		min_value;
+	Datum		max_value;
+} ccacheZoneMap;
+
+/*
+ * ccacheZoneQual - a simple 'column OP constant' qualifier, which can be
+ * checked with the zone-map, or 'column = constant' / 'column IN (...)'
+ * on varlena column, which can be checked with the varlena dictionary.
+ */
+typedef struct
+{
+	AttrNumber	anum;			/* 0-origin attribute number */
+	StrategyNumber strategy;	/* one of BT*StrategyNumber */
+	Oid			collid;			/* collation of the comparison */
+	Datum		value;			/* the constant value */
+	FmgrInfo	cmp_proc;		/* btree comparison of (column, constant) */
+	/* only varlena dictionary */
+	int			dict_nvalues;	/* number of the constant values, or zero */
+	struct varlena **dict_values; /* detoasted constant values */
+} ccacheZoneQual;
+
+/*
+ * Varlena dictionary larger than the threshold is not checked, because
+ * it is likely high cardinality.
+ */
+#define CCACHE_DICTIONARY_PROBE_LIMIT	(1UL << 20)
+
 #define CCACHE_CTIME_NOT_BUILD		(0)
 #define CCACHE_CTIME_IN_PROGRESS	(DT_NOEND)
+#define CCACHE_CTIME_STALE			(DT_NOBEGIN)
 #define CCACHE_CTIME_IS_READY(ctime)			\
-	((ctime) != CCACHE_CTIME_NOT_BUILD && (ctime) != CCACHE_CTIME_IN_PROGRESS)
+	((ctime) != CCACHE_CTIME_NOT_BUILD &&		\
+	 (ctime) != CCACHE_CTIME_IN_PROGRESS &&		\
+	 (ctime) != CCACHE_CTIME_STALE)
+
+/*
+ * The ccache file has the zone-map and the block index next to the KDS.
+ * The block index is an array of the first row index for each block,
+ * and used to refresh the stale chunk incrementally.
+ */
+#define CCACHE_BLOCK_INDEX(kds,zmap_offset,nattrs)				\
+	((cl_uint *)((char *)(kds) + (zmap_offset) +				\
+				 MAXALIGN(sizeof(ccacheZoneMap) * (nattrs))))
 
 /* static variables */
 static shmem_startup_hook_type shmem_startup_next = NULL;
@@ -95,11 +175,16 @@ static char		   *ccache_startup_databases;	/* GUC */
 static int			ccache_num_builders;		/* GUC */
 static bool			__ccache_log_output;		/* GUC */
 static size_t		ccache_total_size;			/* GUC */
+static size_t		ccache_hot_tier_size;		/* GUC */
 static char		   *ccache_base_dir_name;		/* GUC */
+static bool			ccache_compression;			/* GUC */
+static bool			ccache_mmap_load;			/* GUC */
 static DIR		   *ccache_base_dir = NULL;
 static ccacheState *ccache_state = NULL;		/* shmem */
 static cl_int		ccache_num_chunks;
 static cl_int		ccache_num_slots;
+static cl_int		ccache_num_hot_slots;
+static char		   *ccache_hot_buffer = NULL;	/* shmem */
 static ccacheDatabase *ccache_database = NULL;	/* only builder */
 static ccacheBuilder  *ccache_builder = NULL;	/* only builder */
 static uint32		ccache_builder_generation = UINT_MAX;	/* only builder */
@@ -133,6 +218,124 @@ ccache_compute_hashvalue(Oid database_oid, Oid table_oid, BlockNumber block_nr)
 	return hash;
 }
 
+/*
+ * ccache_decay_misshit - miss counter aged by the elapsed time
+ */
+static inline cl_ulong
+ccache_decay_misshit(cl_ulong nmisses, TimestampTz atime, TimestampTz now)
+{
+	long		secs;
+	int			usecs;
+
+	TimestampDifference(atime, now, &secs, &usecs);
+	secs /= CCACHE_MISSHIT_HALFLIFE;
+
+	return (secs < 64 ? nmisses >> secs : 0);
+}
+
+/*
+ * ccache_count_relation_misshit - increments the miss counter of relation
+ *
+ * Caller must hold chunks_lock. If no room found in the probe window,
+ * the entry with the least (aged) counter is replaced.
+ */
+static void
+ccache_count_relation_misshit(Oid database_oid, Oid table_oid,
+							  TimestampTz now)
+{
+	ccacheRelStat *rstat;
+	ccacheRelStat *victim = NULL;
+	cl_ulong	victim_nmisses = 0;
+	cl_ulong	nmisses;
+	uint32		index;
+	int			i;
+
+	index = hash_uint32(database_oid ^ table_oid) % CCACHE_NUM_RELSTATS;
+	for (i=0; i < CCACHE_RELSTATS_PROBES; i++)
+	{
+		rstat = &ccache_state->rel_stats[(index + i) % CCACHE_NUM_RELSTATS];
+		nmisses = ccache_decay_misshit(rstat->nmisses, rstat->atime, now);
+		if (rstat->database_oid == database_oid &&
+			rstat->table_oid == table_oid)
+		{
+			rstat->nmisses = nmisses + 1;
+			rstat->atime = now;
+			return;
+		}
+		if (!victim || nmisses < victim_nmisses)
+		{
+			victim = rstat;
+			victim_nmisses = nmisses;
+		}
+	}
+	victim->database_oid = database_oid;
+	victim->table_oid = table_oid;
+	victim->nmisses = 1;
+	victim->atime = now;
+	victim->scan_pos = 0;
+}
+
+/*
+ * ccache_lookup_relation_misshit - returns the aged miss counter of
+ * relation, and the position where the builders resume loading.
+ */
+static cl_ulong
+ccache_lookup_relation_misshit(Oid database_oid, Oid table_oid,
+							   BlockNumber *p_scan_pos)
+{
+	ccacheRelStat *rstat;
+	TimestampTz	now = GetCurrentTimestamp();
+	uint32		index;
+	cl_ulong	nmisses = 0;
+	int			i;
+
+	index = hash_uint32(database_oid ^ table_oid) % CCACHE_NUM_RELSTATS;
+	*p_scan_pos = 0;
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	for (i=0; i < CCACHE_RELSTATS_PROBES; i++)
+	{
+		rstat = &ccache_state->rel_stats[(index + i) % CCACHE_NUM_RELSTATS];
+		if (rstat->database_oid == database_oid &&
+			rstat->table_oid == table_oid)
+		{
+			nmisses = ccache_decay_misshit(rstat->nmisses,
+										   rstat->atime, now);
+			*p_scan_pos = rstat->scan_pos;
+			break;
+		}
+	}
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	return nmisses;
+}
+
+/*
+ * ccache_update_relation_scanpos - saves the position where the builders
+ * resume loading the chunks of the relation
+ */
+static void
+ccache_update_relation_scanpos(Oid database_oid, Oid table_oid,
+							   BlockNumber scan_pos)
+{
+	ccacheRelStat *rstat;
+	uint32		index;
+	int			i;
+
+	index = hash_uint32(database_oid ^ table_oid) % CCACHE_NUM_RELSTATS;
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	for (i=0; i < CCACHE_RELSTATS_PROBES; i++)
+	{
+		rstat = &ccache_state->rel_stats[(index + i) % CCACHE_NUM_RELSTATS];
+		if (rstat->database_oid == database_oid &&
+			rstat->table_oid == table_oid)
+		{
+			rstat->scan_pos = scan_pos;
+			break;
+		}
+	}
+	SpinLockRelease(&ccache_state->chunks_lock);
+}
+
 /*
  * ccache_chunk_filename
  */
@@ -228,17 +431,38 @@ ccache_put_chunk_nolock(ccacheChunk *cc_chunk)
 			Assert(cc_chunk->length == 0);
 		else
 		{
+			struct stat	stat_buf;
+
 			Assert(cc_chunk->length > 0);
 			ccache_chunk_filename(fname,
 								  cc_chunk->database_oid,
 								  cc_chunk->table_oid,
 								  cc_chunk->block_nr);
-			if (unlinkat(dirfd(ccache_base_dir), fname, 0) != 0)
+			/*
+			 * The file name may already be replaced by the newer chunk of
+			 * the same block, if this chunk was invalidated and rebuilt.
+			 * So, we unlink the file only if it is still ours.
+			 */
+			if (fstatat(dirfd(ccache_base_dir), fname, &stat_buf, 0) != 0)
+			{
+				if (errno != ENOENT)
+					elog(WARNING, "failed on fstatat \"%s\": %m", fname);
+			}
+			else if (stat_buf.st_ino == cc_chunk->file_ino &&
+					 unlinkat(dirfd(ccache_base_dir), fname, 0) != 0)
 				elog(WARNING, "failed on unlinkat \"%s\": %m", fname);
 			Assert(ccache_state->ccache_usage >= TYPEALIGN(BLCKSZ,
 														   cc_chunk->length));
 			ccache_state->ccache_usage -= TYPEALIGN(BLCKSZ, cc_chunk->length);
 		}
+		/* release the hot tier slot, if resident */
+		Assert(cc_chunk->hot_slot >= 0);
+		if (cc_chunk->hot_slot > 0)
+		{
+			Assert(ccache_state->num_hot_free < ccache_num_hot_slots);
+			ccache_state->hot_free_slots[ccache_state->num_hot_free++]
+				= cc_chunk->hot_slot;
+		}
 		/* back to the free list */
 		memset(cc_chunk, 0, sizeof(ccacheChunk));
 		dlist_push_head(&ccache_state->free_chunks_list,
@@ -273,6 +497,7 @@ pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr)
 	dlist_node *dnode;
 	ccacheChunk *cc_chunk = NULL;
 	ccacheChunk *cc_temp;
+	TimestampTz	now = GetCurrentTimestamp();
 
 	hash = ccache_compute_hashvalue(MyDatabaseId, table_oid, block_nr);
 	index = hash % ccache_num_slots;
@@ -286,7 +511,9 @@ pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr)
 			cc_temp->table_oid == table_oid &&
 			cc_temp->block_nr == block_nr)
 		{
-			cc_temp->atime = GetCurrentTimestamp();
+			TimestampTz	last_atime = cc_temp->atime;
+
+			cc_temp->atime = now;
 			if (cc_temp->ctime == CCACHE_CTIME_NOT_BUILD)
 			{
 				Assert(cc_temp->length == 0 &&
@@ -294,7 +521,10 @@ pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr)
 					   cc_temp->lru_chain.prev != NULL);
 				dlist_move_head(&ccache_state->lru_misshit_list,
 								&cc_temp->lru_chain);
-				cc_temp->atime = GetCurrentTimestamp();
+				cc_temp->nmisses = ccache_decay_misshit(cc_temp->nmisses,
+														last_atime,
+														now) + 1;
+				ccache_count_relation_misshit(MyDatabaseId, table_oid, now);
 			}
 			else if (cc_temp->ctime == CCACHE_CTIME_IN_PROGRESS)
 			{
@@ -303,6 +533,15 @@ pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr)
 					   cc_temp->lru_chain.prev == NULL);
 				cc_temp->atime = GetCurrentTimestamp();
 			}
+			else if (cc_temp->ctime == CCACHE_CTIME_STALE)
+			{
+				/* stale chunk is never used until incremental refresh */
+				Assert(cc_temp->length > 0 &&
+					   cc_temp->lru_chain.next != NULL &&
+					   cc_temp->lru_chain.prev != NULL);
+				dlist_move_head(&ccache_state->lru_stale_list,
+								&cc_temp->lru_chain);
+			}
 			else
 			{
 				Assert(cc_temp->length > 0);
@@ -346,31 +585,304 @@ pgstrom_ccache_get_chunk(Relation relation, BlockNumber block_nr)
 		cc_chunk->table_oid = table_oid;
 		cc_chunk->block_nr = block_nr;
 		cc_chunk->refcnt = 1;
-		cc_chunk->atime = GetCurrentTimestamp();
+		cc_chunk->nmisses = 1;
+		cc_chunk->atime = now;
 		dlist_push_tail(&ccache_state->active_slots[index],
 						&cc_chunk->hash_chain);
 		dlist_push_head(&ccache_state->lru_misshit_list,
 						&cc_chunk->lru_chain);
 		cc_chunk = NULL;
 	}
+	Assert(cc_chunk == NULL);
+	ccache_count_relation_misshit(MyDatabaseId, table_oid, now);
 found:
 	SpinLockRelease(&ccache_state->chunks_lock);
 
 	return cc_chunk;
 }
 
+/*
+ * ccache_load_chunk_nvme
+ *
+ * It constructs a PDS_column whose column arrays shall be loaded by
+ * SSD-to-GPU Direct DMA. The BLCKSZ chunks of the ccache file which
+ * contain the referenced columns are located at the tail of KDS, so
+ * column arrays keep their offset within the chunk.
+ */
+/*
+ * ccache_column_nbytes
+ *
+ * It returns the length of the column array on the ccache chunk. Width of
+ * the bit-packed column is saved on the chunk itself, not in the header.
+ */
+static size_t
+ccache_column_nbytes(kern_data_store *kds_head, int j,
+					 char *hot_base, int fdesc)
+{
+	kern_colmeta   *cmeta = &kds_head->colmeta[j];
+	size_t			nitems = kds_head->nitems;
+	size_t			nbytes = cmeta->extra_sz * MAXIMUM_ALIGNOF;
+
+	if (cmeta->attpacked)
+	{
+		kern_packed_column pack;
+		off_t		offset = cmeta->va_offset * MAXIMUM_ALIGNOF;
+
+		if (hot_base)
+			memcpy(&pack, hot_base + offset, sizeof(kern_packed_column));
+		else if (pread(fdesc, &pack, sizeof(kern_packed_column),
+					   offset) != sizeof(kern_packed_column))
+			elog(ERROR, "failed on pread(2): %m");
+		nbytes += KERN_PACKED_COLUMN_LENGTH(pack.nbits, nitems);
+	}
+	else if (cmeta->attlen > 0)
+		nbytes += MAXALIGN(TYPEALIGN(cmeta->attalign,
+									 cmeta->attlen) * nitems);
+	else
+		nbytes += MAXALIGN(sizeof(cl_uint) * nitems);
+	return nbytes;
+}
+
+static pgstrom_data_store *
+ccache_load_chunk_nvme(GpuContext *gcontext,
+					   TupleDesc tupdesc,
+					   kern_data_store *kds_head,
+					   int ncols,
+					   Relids ccache_refs,
+					   int fdesc)
+{
+	size_t		nitems = kds_head->nitems;
+	size_t		head_sz;
+	size_t		length;
+	size_t	   *va_offsets;
+	BlockNumber *chunk_ids;
+	cl_uint		nchunks = 0;
+	cl_uint		nrooms = 0;
+	CUdeviceptr	m_deviceptr;
+	CUresult	rc;
+	pgstrom_data_store *pds;
+	int			i;
+
+	for (i = bms_next_member(ccache_refs, -1);
+		 i >= 0;
+		 i = bms_next_member(ccache_refs, i))
+	{
+		size_t			nbytes = ccache_column_nbytes(kds_head, i,
+													  NULL, fdesc);
+
+		nrooms += nbytes / BLCKSZ + 2;
+	}
+	head_sz = TYPEALIGN(BLCKSZ, STROMALIGN(offsetof(kern_data_store,
+													colmeta[ncols])));
+	chunk_ids = palloc(sizeof(BlockNumber) * nrooms);
+	va_offsets = palloc0(sizeof(size_t) * ncols);
+	for (i = bms_next_member(ccache_refs, -1);
+		 i >= 0;
+		 i = bms_next_member(ccache_refs, i))
+	{
+		kern_colmeta   *cmeta = &kds_head->colmeta[i];
+		size_t			offset = cmeta->va_offset * MAXIMUM_ALIGNOF;
+		size_t			nbytes = ccache_column_nbytes(kds_head, i,
+													  NULL, fdesc);
+		BlockNumber		head;
+		BlockNumber		tail;
+
+		head = offset / BLCKSZ;
+		tail = (offset + nbytes - 1) / BLCKSZ;
+		/* columns are stored in order of attribute number */
+		Assert(nchunks == 0 || chunk_ids[nchunks-1] <= head);
+		if (nchunks > 0 && chunk_ids[nchunks-1] == head)
+			va_offsets[i] = (size_t)BLCKSZ * (nchunks - 1);
+		else
+			va_offsets[i] = (size_t)BLCKSZ * nchunks;
+		va_offsets[i] += head_sz + (offset % BLCKSZ);
+		while (head <= tail)
+		{
+			if (nchunks == 0 || chunk_ids[nchunks-1] < head)
+			{
+				Assert(nchunks < nrooms);
+				chunk_ids[nchunks++] = head;
+			}
+			head++;
+		}
+	}
+	length = head_sz + (size_t)BLCKSZ * nchunks;
+
+	/* allocation of pds_column buffer, and chunk-ids x2 */
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							offsetof(pgstrom_data_store, kds) + length +
+							2 * sizeof(BlockNumber) * nchunks,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "out of managed memory");
+	pds = (pgstrom_data_store *)m_deviceptr;
+	memset(&pds->chain, 0, sizeof(dlist_node));
+	pds->gcontext = gcontext;
+	pg_atomic_init_u32(&pds->refcnt, 1);
+	init_kernel_data_store(&pds->kds, tupdesc, length,
+						   KDS_FORMAT_COLUMN, nitems);
+	for (i = bms_next_member(ccache_refs, -1);
+		 i >= 0;
+		 i = bms_next_member(ccache_refs, i))
+	{
+		pds->kds.colmeta[i].va_offset = va_offsets[i] / MAXIMUM_ALIGNOF;
+		pds->kds.colmeta[i].extra_sz = kds_head->colmeta[i].extra_sz;
+		pds->kds.colmeta[i].attpacked = kds_head->colmeta[i].attpacked;
+		if (kds_head->colmeta[i].attpacked)
+			pds->kds.has_packed = true;
+	}
+	pds->kds.nitems = nitems;
+	pds->nblocks_uncached = nchunks;
+	pds->filedesc = fdesc;
+	pds->mmap_base = NULL;
+	pds->mmap_length = 0;
+	pds->kds_dev = NULL;
+	memcpy(PDS_CCACHE_CHUNK_IDS(pds), chunk_ids,
+		   sizeof(BlockNumber) * nchunks);
+	pfree(va_offsets);
+	pfree(chunk_ids);
+
+	return pds;
+}
+
+/*
+ * ccache_load_chunk_mmap
+ *
+ * It maps the ccache file on the address space aligned to huge page, and
+ * builds a PDS on the file image without any copy. The PDS header is put
+ * in front of the mapping, and the header of the device image, which
+ * contains only the referenced columns, is put in front of the PDS header.
+ * The mapping is registered as page-locked host memory if possible, to
+ * allow the DMA engine to read the page cache directly. It is valid until
+ * the PDS release, even if the chunk is rebuilt, because ccache builder
+ * never truncates the existing file; it writes a new file under the
+ * temporary name, then renames it onto the chunk file, so the mapped
+ * inode is kept until munmap(2).
+ * It returns NULL if the file cannot be mapped.
+ */
+#define CCACHE_MMAP_ALIGN		(2UL << 20)		/* 2MB; huge page */
+
+static pgstrom_data_store *
+ccache_load_chunk_mmap(GpuContext *gcontext,
+					   kern_data_store *kds_head,
+					   int ncols,
+					   Relids ccache_refs,
+					   int fdesc)
+{
+	size_t		head_sz = KDS_CALCULATE_HEAD_LENGTH(ncols);
+	size_t		file_sz = TYPEALIGN(BLCKSZ, kds_head->length);
+	size_t		mmap_length;
+	char	   *mmap_base;
+	char	   *kds_addr;
+	size_t		offset;
+	kern_data_store *kds_dev;
+	pgstrom_data_store *pds;
+	int			i;
+
+	if (head_sz + offsetof(pgstrom_data_store, kds) > CCACHE_MMAP_ALIGN)
+		return NULL;
+	/* reserve the address space, then map the file on the aligned portion */
+	mmap_length = 2 * CCACHE_MMAP_ALIGN + file_sz;
+	mmap_base = mmap(NULL, mmap_length,
+					 PROT_READ | PROT_WRITE,
+					 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+					 -1, 0);
+	if (mmap_base == MAP_FAILED)
+	{
+		elog(DEBUG2, "failed on mmap: %m");
+		return NULL;
+	}
+	kds_addr = (char *)TYPEALIGN(CCACHE_MMAP_ALIGN,
+								 mmap_base + CCACHE_MMAP_ALIGN);
+	if (mmap(kds_addr, file_sz,
+			 PROT_READ,
+			 MAP_SHARED | MAP_FIXED | MAP_POPULATE,
+			 fdesc, 0) == MAP_FAILED)
+	{
+		elog(DEBUG2, "failed on mmap of the ccache file: %m");
+		munmap(mmap_base, mmap_length);
+		return NULL;
+	}
+#ifdef MADV_HUGEPAGE
+	/* only a hint; effective if tmpfs is mounted with huge=advise */
+	madvise(kds_addr, file_sz, MADV_HUGEPAGE);
+#endif
+	pds = (pgstrom_data_store *)(kds_addr - offsetof(pgstrom_data_store,
+													   kds));
+	memset(pds, 0, offsetof(pgstrom_data_store, kds));
+	pds->gcontext = gcontext;
+	pg_atomic_init_u32(&pds->refcnt, 1);
+	pds->nblocks_uncached = 0;
+	pds->filedesc = -1;
+	pds->nblocks_zcopy = 0;
+	pds->zcopy_blocks = NULL;
+	pds->mmap_base = mmap_base;
+	pds->mmap_length = mmap_length;
+
+	/* header of the device image, with only the referenced columns */
+	kds_dev = (kern_data_store *)((char *)pds - head_sz);
+	memcpy(kds_dev, &pds->kds, head_sz);
+	kds_dev->has_packed = false;
+	offset = head_sz;
+	for (i=0; i < ncols; i++)
+	{
+		kern_colmeta   *cmeta = &kds_dev->colmeta[i];
+
+		if (cmeta->va_offset == 0 || !bms_is_member(i, ccache_refs))
+		{
+			cmeta->va_offset = 0;
+			cmeta->extra_sz = 0;
+			cmeta->attpacked = false;
+			continue;
+		}
+		cmeta->va_offset = offset / MAXIMUM_ALIGNOF;
+		if (cmeta->attpacked)
+			kds_dev->has_packed = true;
+		offset += ccache_column_nbytes(&pds->kds, i,
+									   (char *)&pds->kds, -1);
+	}
+	kds_dev->length = offset;
+	pds->kds_dev = kds_dev;
+
+#if CUDA_VERSION >= 11010
+	{
+		CUresult	rc;
+
+		rc = cuCtxPushCurrent(gcontext->cuda_context);
+		if (rc == CUDA_SUCCESS)
+		{
+			rc = cuMemHostRegister(kds_addr, file_sz,
+								   CU_MEMHOSTREGISTER_PORTABLE |
+								   CU_MEMHOSTREGISTER_READ_ONLY);
+			cuCtxPopCurrent(NULL);
+		}
+		/* unpinned mapping still works, but driver stages the DMA */
+		if (rc != CUDA_SUCCESS)
+			elog(DEBUG2, "failed on cuMemHostRegister: %s", errorText(rc));
+	}
+#endif
+	return pds;
+}
+
 /*
  * pgstrom_ccache_load_chunk
+ *
+ * If @try_nvme_strom, the caller can process PDS_column with
+ * nblocks_uncached > 0, to be loaded by SSD-to-GPU Direct DMA.
  */
 pgstrom_data_store *
 pgstrom_ccache_load_chunk(ccacheChunk *cc_chunk,
 						  GpuContext *gcontext,
 						  Relation relation,
-						  Relids ccache_refs)
+						  Relids ccache_refs,
+						  bool try_nvme_strom)
 {
 	TupleDesc	tupdesc = RelationGetDescr(relation);
 	int			i, ncols;
 	int			fdesc = -1;
+	cl_int		hot_slot;
+	char	   *hot_base = NULL;
 	ssize_t		nitems;
 	ssize_t		length;
 	ssize_t		offset;
@@ -378,17 +890,30 @@ pgstrom_ccache_load_chunk(ccacheChunk *cc_chunk,
 	CUresult	rc;
 	char		buffer[MAXPGPATH];
 	kern_data_store *kds_head = (kern_data_store *)buffer;
-	pgstrom_data_store *pds;
+	pgstrom_data_store *pds = NULL;
 
-	/* open the ccache file */
 	Assert(CCACHE_CTIME_IS_READY(cc_chunk->ctime));
-	ccache_chunk_filename(buffer,
-						  MyDatabaseId,
-						  RelationGetRelid(relation),
-						  cc_chunk->block_nr);
-	fdesc = openat(dirfd(ccache_base_dir), buffer, O_RDONLY);
-	if (fdesc < 0)
-		elog(ERROR, "failed on open('%s'): %m", buffer);
+	/*
+	 * If chunk is resident on the hot tier, we don't need to open the ccache
+	 * file. Our reference to the cc_chunk prevents its demotion.
+	 */
+	hot_slot = cc_chunk->hot_slot;
+	if (hot_slot > 0)
+	{
+		Assert(hot_slot <= ccache_num_hot_slots);
+		hot_base = ccache_hot_buffer + (size_t)(hot_slot - 1) * CCACHE_CHUNK_SIZE;
+	}
+	else
+	{
+		/* open the ccache file */
+		ccache_chunk_filename(buffer,
+							  MyDatabaseId,
+							  RelationGetRelid(relation),
+							  cc_chunk->block_nr);
+		fdesc = openat(dirfd(ccache_base_dir), buffer, O_RDONLY);
+		if (fdesc < 0)
+			elog(ERROR, "failed on open('%s'): %m", buffer);
+	}
 
 	PG_TRY();
 	{
@@ -396,90 +921,567 @@ pgstrom_ccache_load_chunk(ccacheChunk *cc_chunk,
 		Assert(cc_chunk->nattrs == tupdesc->natts);
 		ncols = cc_chunk->nattrs + NumOfSystemAttrs;
 		length = STROMALIGN(offsetof(kern_data_store, colmeta[ncols]));
-		if (length > sizeof(buffer))
-			kds_head = palloc(length);
-		if (pread(fdesc, kds_head, length, 0) != length)
-			elog(ERROR, "failed on pread(2): %m");
+		if (hot_base)
+			kds_head = (kern_data_store *)hot_base;
+		else
+		{
+			if (length > sizeof(buffer))
+				kds_head = palloc(length);
+			if (pread(fdesc, kds_head, length, 0) != length)
+				elog(ERROR, "failed on pread(2): %m");
+		}
 		nitems = kds_head->nitems;
-		/* count length of the PDS_column */
-		for (i = bms_next_member(ccache_refs, -1);
-			 i >= 0;
-			 i = bms_next_member(ccache_refs, i))
+		if (try_nvme_strom && !hot_base && nitems > 0 &&
+			DirectoryCanUseNvmeStrom(dirfd(ccache_base_dir)))
 		{
-			kern_colmeta   *cmeta = &kds_head->colmeta[i];
-
-			length += cmeta->extra_sz * MAXIMUM_ALIGNOF;
-			if (cmeta->attlen > 0)
-				length += MAXALIGN(TYPEALIGN(cmeta->attalign,
-											 cmeta->attlen) * nitems);
-			else
-				length += MAXALIGN(sizeof(cl_uint) * nitems);
-		}
-		/* allocation of pds_column buffer */
-		rc = gpuMemAllocManaged(gcontext,
-								&m_deviceptr,
-								offsetof(pgstrom_data_store,
-										 kds) + length,
-								CU_MEM_ATTACH_GLOBAL);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "out of managed memory");
-		pds = (pgstrom_data_store *)m_deviceptr;
-		memset(&pds->chain, 0, sizeof(dlist_node));
-		pds->gcontext = gcontext;
-		pg_atomic_init_u32(&pds->refcnt, 1);
-		pds->nblocks_uncached = 0;
-		pds->filedesc = -1;
-		init_kernel_data_store(&pds->kds, tupdesc, length,
-							   KDS_FORMAT_COLUMN, nitems);
-		/* load from the ccache file */
-		offset = STROMALIGN(offsetof(kern_data_store, colmeta[ncols]));
-		for (i = bms_next_member(ccache_refs, -1);
-			 i >= 0;
-			 i = bms_next_member(ccache_refs, i))
-		{
-			kern_colmeta   *cmeta = &kds_head->colmeta[i];
-			size_t			nbytes;
-
-			Assert(pds->kds.colmeta[i].attbyval  == cmeta->attbyval &&
-				   pds->kds.colmeta[i].attalign  == cmeta->attalign &&
-				   pds->kds.colmeta[i].attlen    == cmeta->attlen &&
-				   pds->kds.colmeta[i].attnum    == cmeta->attnum &&
-				   pds->kds.colmeta[i].atttypid  == cmeta->atttypid &&
-				   pds->kds.colmeta[i].atttypmod == cmeta->atttypmod);
-			Assert(offset == MAXALIGN(offset));
-			pds->kds.colmeta[i].va_offset = offset / MAXIMUM_ALIGNOF;
-			pds->kds.colmeta[i].extra_sz = cmeta->extra_sz;
-
-			nbytes = cmeta->extra_sz * MAXIMUM_ALIGNOF;
-			if (cmeta->attlen > 0)
-				nbytes += MAXALIGN(TYPEALIGN(cmeta->attalign,
-											 cmeta->attlen) * nitems);
-			else
-				nbytes += MAXALIGN(sizeof(cl_uint) * nitems);
+			/* column arrays shall be loaded by SSD-to-GPU Direct DMA */
+			pds = ccache_load_chunk_nvme(gcontext, tupdesc, kds_head,
+										 ncols, ccache_refs, fdesc);
+			fdesc = -1;		/* now owned by the PDS */
+		}
+		else if (ccache_mmap_load && !hot_base && nitems > 0)
+		{
+			/* build the PDS on the memory-mapped ccache file, if possible */
+			pds = ccache_load_chunk_mmap(gcontext, kds_head,
+										 ncols, ccache_refs, fdesc);
+		}
 
-			if (pread(fdesc,
-					  (char *)&pds->kds + offset,
-					  nbytes,
-					  cmeta->va_offset * MAXIMUM_ALIGNOF) != nbytes)
-				elog(ERROR, "failed on pread(2): %m");
-			offset += nbytes;
+		if (!pds)
+		{
+			/* count length of the PDS_column */
+			for (i = bms_next_member(ccache_refs, -1);
+				 i >= 0;
+				 i = bms_next_member(ccache_refs, i))
+			{
+				length += ccache_column_nbytes(kds_head, i,
+											   hot_base, fdesc);
+			}
+			/* allocation of pds_column buffer */
+			rc = gpuMemAllocManaged(gcontext,
+									&m_deviceptr,
+									offsetof(pgstrom_data_store,
+											 kds) + length,
+									CU_MEM_ATTACH_GLOBAL);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "out of managed memory");
+			pds = (pgstrom_data_store *)m_deviceptr;
+			memset(&pds->chain, 0, sizeof(dlist_node));
+			pds->gcontext = gcontext;
+			pg_atomic_init_u32(&pds->refcnt, 1);
+			pds->nblocks_uncached = 0;
+			pds->filedesc = -1;
+			pds->nblocks_zcopy = 0;
+			pds->zcopy_blocks = NULL;
+			pds->mmap_base = NULL;
+			pds->mmap_length = 0;
+			pds->kds_dev = NULL;
+			init_kernel_data_store(&pds->kds, tupdesc, length,
+								   KDS_FORMAT_COLUMN, nitems);
+			/* load from the ccache file */
+			offset = STROMALIGN(offsetof(kern_data_store, colmeta[ncols]));
+			for (i = bms_next_member(ccache_refs, -1);
+				 i >= 0;
+				 i = bms_next_member(ccache_refs, i))
+			{
+				kern_colmeta   *cmeta = &kds_head->colmeta[i];
+				size_t			nbytes;
+
+				Assert(pds->kds.colmeta[i].attbyval  == cmeta->attbyval &&
+					   pds->kds.colmeta[i].attalign  == cmeta->attalign &&
+					   pds->kds.colmeta[i].attlen    == cmeta->attlen &&
+					   pds->kds.colmeta[i].attnum    == cmeta->attnum &&
+					   pds->kds.colmeta[i].atttypid  == cmeta->atttypid &&
+					   pds->kds.colmeta[i].atttypmod == cmeta->atttypmod);
+				Assert(offset == MAXALIGN(offset));
+				pds->kds.colmeta[i].va_offset = offset / MAXIMUM_ALIGNOF;
+				pds->kds.colmeta[i].extra_sz = cmeta->extra_sz;
+				pds->kds.colmeta[i].attpacked = cmeta->attpacked;
+				if (cmeta->attpacked)
+					pds->kds.has_packed = true;
+
+				nbytes = ccache_column_nbytes(kds_head, i, hot_base, fdesc);
+				if (hot_base)
+					memcpy((char *)&pds->kds + offset,
+						   hot_base + cmeta->va_offset * MAXIMUM_ALIGNOF,
+						   nbytes);
+				else if (pread(fdesc,
+							   (char *)&pds->kds + offset,
+							   nbytes,
+							   cmeta->va_offset * MAXIMUM_ALIGNOF) != nbytes)
+					elog(ERROR, "failed on pread(2): %m");
+				offset += nbytes;
+			}
+			pds->kds.nitems = nitems;
+			Assert(offset == length);
 		}
-		pds->kds.nitems = nitems;
-		Assert(offset == length);
 	}
 	PG_CATCH();
 	{
-		close(fdesc);
+		if (fdesc >= 0)
+			close(fdesc);
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
-	close(fdesc);
-	if ((char *)kds_head != buffer)
+	if (fdesc >= 0)
+		close(fdesc);
+	if ((char *)kds_head != buffer && (char *)kds_head != hot_base)
 		pfree(kds_head);
 
 	return pds;
 }
 
+/*
+ * ccache_buffer_build_zonemap - computes min/max and null count of the
+ * fixed-length regular columns
+ */
+static void
+ccache_buffer_build_zonemap(TupleDesc tupdesc,
+							ccacheBuffer *cc_buf,
+							ccacheZoneMap *zmap)
+{
+	int			i, j;
+
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[j];
+		TypeCacheEntry *tcache;
+		bits8	   *nullmap = cc_buf->nullmap[j];
+		char	   *base = cc_buf->values[j];
+		int			unitsz;
+
+		memset(&zmap[j], 0, sizeof(ccacheZoneMap));
+		if (attr->attisdropped || attr->attlen < 0)
+			continue;
+		unitsz = att_align_nominal(attr->attlen, attr->attalign);
+		for (i=0; i < cc_buf->nitems; i++)
+		{
+			if (cc_buf->hasnull[j] && att_isnull(i, nullmap))
+				zmap[j].nullcount++;
+		}
+		if (!attr->attbyval || zmap[j].nullcount == cc_buf->nitems)
+			continue;
+		tcache = lookup_type_cache(attr->atttypid,
+								   TYPECACHE_CMP_PROC_FINFO);
+		if (!OidIsValid(tcache->cmp_proc_finfo.fn_oid))
+			continue;
+
+		for (i=0; i < cc_buf->nitems; i++)
+		{
+			Datum		datum;
+
+			if (cc_buf->hasnull[j] && att_isnull(i, nullmap))
+				continue;
+			datum = fetch_att(base + unitsz * i, true, attr->attlen);
+			if (!zmap[j].has_minmax)
+			{
+				zmap[j].min_value = datum;
+				zmap[j].max_value = datum;
+				zmap[j].has_minmax = true;
+			}
+			else if (DatumGetInt32(FunctionCall2Coll(&tcache->cmp_proc_finfo,
+													 attr->attcollation,
+													 datum,
+													 zmap[j].min_value)) < 0)
+				zmap[j].min_value = datum;
+			else if (DatumGetInt32(FunctionCall2Coll(&tcache->cmp_proc_finfo,
+													 attr->attcollation,
+													 datum,
+													 zmap[j].max_value)) > 0)
+				zmap[j].max_value = datum;
+		}
+	}
+}
+
+/*
+ * ccache_zonemap_dictionary_qual
+ *
+ * It picks up 'column = constant' or 'column IN (constants...)' on varlena
+ * column, if equality of the operator is binary comparison. Varlena columns
+ * on ccache are de-duplicated, so we can check whether the chunk contains
+ * the constant values using the dictionary of the column.
+ */
+static ccacheZoneQual *
+ccache_zonemap_dictionary_qual(TupleDesc tupdesc, Index scanrelid, Node *qual)
+{
+	Var		   *var;
+	Const	   *con;
+	Oid			opfuncid;
+	bool		is_array = false;
+	List	   *args;
+	ccacheZoneQual *zq;
+
+	if (IsA(qual, OpExpr))
+	{
+		opfuncid = ((OpExpr *) qual)->opfuncid;
+		args = ((OpExpr *) qual)->args;
+	}
+	else if (IsA(qual, ScalarArrayOpExpr) &&
+			 ((ScalarArrayOpExpr *) qual)->useOr)
+	{
+		opfuncid = ((ScalarArrayOpExpr *) qual)->opfuncid;
+		args = ((ScalarArrayOpExpr *) qual)->args;
+		is_array = true;
+	}
+	else
+		return NULL;
+	if (opfuncid != F_TEXTEQ && opfuncid != F_BYTEAEQ)
+		return NULL;
+	if (list_length(args) != 2)
+		return NULL;
+	if (IsA(linitial(args), Var) && IsA(lsecond(args), Const))
+	{
+		var = linitial(args);
+		con = lsecond(args);
+	}
+	else if (!is_array &&
+			 IsA(linitial(args), Const) && IsA(lsecond(args), Var))
+	{
+		con = linitial(args);
+		var = lsecond(args);
+	}
+	else
+		return NULL;
+	if (var->varno != scanrelid ||
+		var->varlevelsup > 0 ||
+		var->varattno <= 0 ||
+		var->varattno > tupdesc->natts ||
+		tupdesc->attrs[var->varattno - 1]->attlen >= 0 ||
+		con->constisnull)
+		return NULL;
+
+	zq = palloc0(sizeof(ccacheZoneQual));
+	zq->anum = var->varattno - 1;
+	zq->strategy = BTEqualStrategyNumber;
+	if (!is_array)
+	{
+		zq->dict_nvalues = 1;
+		zq->dict_values = palloc(sizeof(struct varlena *));
+		zq->dict_values[0] = PG_DETOAST_DATUM(con->constvalue);
+	}
+	else
+	{
+		ArrayType  *array = DatumGetArrayTypeP(con->constvalue);
+		int16		typlen;
+		bool		typbyval;
+		char		typalign;
+		Datum	   *elem_values;
+		bool	   *elem_isnull;
+		int			i, nelems;
+
+		get_typlenbyvalalign(ARR_ELEMTYPE(array),
+							 &typlen, &typbyval, &typalign);
+		deconstruct_array(array, ARR_ELEMTYPE(array),
+						  typlen, typbyval, typalign,
+						  &elem_values, &elem_isnull, &nelems);
+		zq->dict_values = palloc(sizeof(struct varlena *) * Max(nelems, 1));
+		for (i=0; i < nelems; i++)
+		{
+			if (elem_isnull[i])
+				continue;
+			zq->dict_values[zq->dict_nvalues++]
+				= PG_DETOAST_DATUM(elem_values[i]);
+		}
+		/* IN (NULL, ...) never match, however, keep the logic simple */
+		if (zq->dict_nvalues == 0)
+			return NULL;
+	}
+	return zq;
+}
+
+/*
+ * pgstrom_ccache_zonemap_quals
+ *
+ * It picks up 'column OP constant' form qualifiers from the implicitly
+ * AND'ed list, if OP is a btree operator of the column type. These are
+ * used to skip ccache chunks which never satisfy the qualifiers.
+ */
+List *
+pgstrom_ccache_zonemap_quals(Relation relation, Index scanrelid, List *quals)
+{
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	List	   *zone_quals = NIL;
+	ListCell   *lc;
+
+	foreach (lc, quals)
+	{
+		OpExpr	   *op = lfirst(lc);
+		Var		   *var;
+		Const	   *con;
+		Oid			opfamily;
+		Oid			cmp_func;
+		int			strategy;
+		Form_pg_attribute attr;
+		TypeCacheEntry *tcache;
+		ccacheZoneQual *zq;
+
+		/* equality on varlena column, checked with the dictionary */
+		zq = ccache_zonemap_dictionary_qual(tupdesc, scanrelid, lfirst(lc));
+		if (zq)
+		{
+			zone_quals = lappend(zone_quals, zq);
+			continue;
+		}
+
+		if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+			continue;
+		if (IsA(linitial(op->args), Var) && IsA(lsecond(op->args), Const))
+		{
+			var = linitial(op->args);
+			con = lsecond(op->args);
+		}
+		else if (IsA(linitial(op->args), Const) && IsA(lsecond(op->args), Var))
+		{
+			con = linitial(op->args);
+			var = lsecond(op->args);
+		}
+		else
+			continue;
+		if (var->varno != scanrelid ||
+			var->varlevelsup > 0 ||
+			var->varattno <= 0 ||
+			var->varattno > tupdesc->natts ||
+			con->constisnull)
+			continue;
+		attr = tupdesc->attrs[var->varattno - 1];
+		if (!attr->attbyval || attr->attlen < 0 ||
+			attr->atttypid != var->vartype)
+			continue;
+		tcache = lookup_type_cache(var->vartype, TYPECACHE_BTREE_OPFAMILY);
+		opfamily = tcache->btree_opf;
+		if (!OidIsValid(opfamily))
+			continue;
+		strategy = get_op_opfamily_strategy(op->opno, opfamily);
+		if (strategy == InvalidStrategy)
+			continue;
+		/* commute the strategy, if 'constant OP column' form */
+		if ((Node *)var == lsecond(op->args))
+			strategy = BTCommuteStrategyNumber(strategy);
+		cmp_func = get_opfamily_proc(opfamily,
+									 var->vartype,
+									 con->consttype,
+									 BTORDER_PROC);
+		if (!OidIsValid(cmp_func))
+			continue;
+
+		zq = palloc0(sizeof(ccacheZoneQual));
+		zq->anum = var->varattno - 1;
+		zq->strategy = strategy;
+		zq->collid = op->inputcollid;
+		zq->value = con->constvalue;
+		fmgr_info(cmp_func, &zq->cmp_proc);
+
+		zone_quals = lappend(zone_quals, zq);
+	}
+	return zone_quals;
+}
+
+/*
+ * ccache_read_chunk_region - reads a region of the ccache chunk
+ *
+ * It returns the address on the hot tier as is, if resident. Elsewhere,
+ * the region is read to palloc'd buffer. NULL shall be returned on errors.
+ */
+static void *
+ccache_read_chunk_region(char *hot_base, int fdesc,
+						 size_t offset, size_t length)
+{
+	char	   *buffer;
+
+	if (hot_base)
+		return hot_base + offset;
+	buffer = palloc(length);
+	if (pread(fdesc, buffer, length, offset) != length)
+	{
+		pfree(buffer);
+		return NULL;
+	}
+	return buffer;
+}
+
+/*
+ * ccache_check_dictionary - checks whether the varlena dictionary of the
+ * column contains any of the constant values
+ */
+static bool
+ccache_check_dictionary(ccacheChunk *cc_chunk,
+						kern_data_store *kds_head,
+						char *hot_base, int fdesc,
+						ccacheZoneQual *zq)
+{
+	kern_colmeta *cmeta = &kds_head->colmeta[zq->anum];
+	size_t		offset;
+	size_t		length;
+	char	   *dict;
+	char	   *pos;
+	bool		retval = false;
+	int			i;
+
+	Assert(cmeta->attlen < 0);
+	/* all NULLs never satisfy the equality */
+	if (cmeta->va_offset == 0 || cmeta->extra_sz == 0)
+		return false;
+	length = (size_t)cmeta->extra_sz << MAXIMUM_ALIGNOF_SHIFT;
+	if (length > CCACHE_DICTIONARY_PROBE_LIMIT)
+		return true;
+	offset = (((size_t)cmeta->va_offset << MAXIMUM_ALIGNOF_SHIFT) +
+			  MAXALIGN(sizeof(cl_uint) * kds_head->nrooms));
+	dict = ccache_read_chunk_region(hot_base, fdesc, offset, length);
+	if (!dict)
+		return true;
+
+	for (pos = dict; !retval && pos < dict + length; )
+	{
+		struct varlena *vl = (struct varlena *) pos;
+
+		/* binary comparison is not sufficient for compressed datum */
+		if (VARATT_IS_COMPRESSED(vl))
+		{
+			retval = true;
+			break;
+		}
+		for (i=0; i < zq->dict_nvalues; i++)
+		{
+			struct varlena *con = zq->dict_values[i];
+
+			if (VARSIZE_ANY_EXHDR(vl) == VARSIZE_ANY_EXHDR(con) &&
+				memcmp(VARDATA_ANY(vl), VARDATA_ANY(con),
+					   VARSIZE_ANY_EXHDR(con)) == 0)
+			{
+				retval = true;
+				break;
+			}
+		}
+		pos += MAXALIGN(VARSIZE_ANY(vl));
+	}
+	if (!hot_base)
+		pfree(dict);
+	return retval;
+}
+
+/*
+ * pgstrom_ccache_check_zonemap
+ *
+ * It returns false, if no rows in the chunk can satisfy the zone_quals
+ * according to the zone-map or the varlena dictionary. Elsewhere, chunk
+ * has to be loaded.
+ */
+bool
+pgstrom_ccache_check_zonemap(ccacheChunk *cc_chunk,
+							 Relation relation,
+							 List *zone_quals)
+{
+	ccacheZoneMap *zmap;
+	kern_data_store *kds_head = NULL;
+	cl_int		hot_slot;
+	char	   *hot_base = NULL;
+	char		fname[MAXPGPATH];
+	int			fdesc = -1;
+	bool		retval = true;
+	ListCell   *lc;
+
+	Assert(CCACHE_CTIME_IS_READY(cc_chunk->ctime));
+	if (zone_quals == NIL || cc_chunk->zmap_offset == 0)
+		return true;
+
+	hot_slot = cc_chunk->hot_slot;
+	if (hot_slot > 0)
+		hot_base = ccache_hot_buffer + (size_t)(hot_slot - 1) * CCACHE_CHUNK_SIZE;
+	else
+	{
+		ccache_chunk_filename(fname,
+							  MyDatabaseId,
+							  RelationGetRelid(relation),
+							  cc_chunk->block_nr);
+		fdesc = openat(dirfd(ccache_base_dir), fname, O_RDONLY);
+		if (fdesc < 0)
+			return true;	/* let pgstrom_ccache_load_chunk raise an error */
+	}
+	zmap = ccache_read_chunk_region(hot_base, fdesc,
+									cc_chunk->zmap_offset,
+									sizeof(ccacheZoneMap) * cc_chunk->nattrs);
+	if (!zmap)
+		goto out;
+
+	foreach (lc, zone_quals)
+	{
+		ccacheZoneQual *zq = lfirst(lc);
+		ccacheZoneMap  *zm = &zmap[zq->anum];
+		int				cmp_min;
+		int				cmp_max;
+
+		Assert(zq->anum < cc_chunk->nattrs);
+		if (zq->dict_nvalues > 0)
+		{
+			if (!kds_head)
+			{
+				/* only colmeta of the user columns are needed */
+				size_t	len = offsetof(kern_data_store,
+									   colmeta[cc_chunk->nattrs]);
+
+				kds_head = ccache_read_chunk_region(hot_base, fdesc, 0, len);
+				if (!kds_head)
+					continue;
+			}
+			retval = ccache_check_dictionary(cc_chunk, kds_head,
+											 hot_base, fdesc, zq);
+			if (!retval)
+				break;
+			continue;
+		}
+
+		if (!zm->has_minmax)
+		{
+			/* all NULLs never satisfy strict btree operators */
+			if (zm->nullcount > 0 && zm->nullcount == cc_chunk->nitems)
+			{
+				retval = false;
+				break;
+			}
+			continue;
+		}
+		cmp_min = DatumGetInt32(FunctionCall2Coll(&zq->cmp_proc,
+												  zq->collid,
+												  zm->min_value,
+												  zq->value));
+		cmp_max = DatumGetInt32(FunctionCall2Coll(&zq->cmp_proc,
+												  zq->collid,
+												  zm->max_value,
+												  zq->value));
+		switch (zq->strategy)
+		{
+			case BTLessStrategyNumber:
+				retval = (cmp_min < 0);
+				break;
+			case BTLessEqualStrategyNumber:
+				retval = (cmp_min <= 0);
+				break;
+			case BTEqualStrategyNumber:
+				retval = (cmp_min <= 0 && cmp_max >= 0);
+				break;
+			case BTGreaterEqualStrategyNumber:
+				retval = (cmp_max >= 0);
+				break;
+			case BTGreaterStrategyNumber:
+				retval = (cmp_max > 0);
+				break;
+			default:
+				break;
+		}
+		if (!retval)
+			break;
+	}
+	if (!hot_base)
+	{
+		pfree(zmap);
+		if (kds_head)
+			pfree(kds_head);
+	}
+out:
+	if (fdesc >= 0)
+		close(fdesc);
+	return retval;
+}
+
 /*
  * ccache_invalidator_oid - returns OID of invalidator trigger function
  */
@@ -829,26 +1831,91 @@ RelationCanUseColumnarCache(Relation relation)
 			continue;
 		if (TRIGGER_FOR_AFTER(trigger->tgtype))
 		{
-			if (TRIGGER_FOR_ROW(trigger->tgtype))
+			if (TRIGGER_FOR_ROW(trigger->tgtype))
+			{
+				if (TRIGGER_FOR_INSERT(trigger->tgtype))
+					has_row_insert = true;
+				if (TRIGGER_FOR_UPDATE(trigger->tgtype))
+					has_row_update = true;
+				if (TRIGGER_FOR_DELETE(trigger->tgtype))
+					has_row_delete = true;
+			}
+			else
+			{
+				if (TRIGGER_FOR_TRUNCATE(trigger->tgtype))
+					has_stmt_truncate = true;
+			}
+		}
+	}
+	return (has_row_insert &&
+			has_row_update &&
+			has_row_delete &&
+			has_stmt_truncate);
+}
+
+/*
+ * ccache_invalidate_block
+ *
+ * It marks the block dirty on the ready or stale chunk, to refresh the chunk
+ * incrementally later. The stale chunk is never used for scan. Chunks not
+ * built yet, or in-progress, are simply dropped.
+ */
+static void
+ccache_invalidate_block(Relation rel, BlockNumber block_nr)
+{
+	BlockNumber	base = (block_nr & ~(CCACHE_CHUNK_NBLOCKS - 1));
+	BlockNumber	index = block_nr - base;
+	pg_crc32	hash;
+	int			k;
+	dlist_iter	iter;
+
+	hash = ccache_compute_hashvalue(MyDatabaseId,
+									RelationGetRelid(rel),
+									base);
+	k = hash % ccache_num_slots;
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	dlist_foreach(iter, &ccache_state->active_slots[k])
+	{
+		ccacheChunk *cc_temp = dlist_container(ccacheChunk,
+											   hash_chain,
+											   iter.cur);
+		if (cc_temp->hash == hash &&
+			cc_temp->database_oid == MyDatabaseId &&
+			cc_temp->table_oid == RelationGetRelid(rel) &&
+			cc_temp->block_nr == base)
+		{
+			if (CCACHE_CTIME_IS_READY(cc_temp->ctime))
 			{
-				if (TRIGGER_FOR_INSERT(trigger->tgtype))
-					has_row_insert = true;
-				if (TRIGGER_FOR_UPDATE(trigger->tgtype))
-					has_row_update = true;
-				if (TRIGGER_FOR_DELETE(trigger->tgtype))
-					has_row_delete = true;
+				/* move to the LRU stale list, but keep the ccache file */
+				cc_temp->ctime = CCACHE_CTIME_STALE;
+				memset(cc_temp->dirty_map, 0, sizeof(cc_temp->dirty_map));
+				dlist_delete(&cc_temp->lru_chain);
+				dlist_push_head(&ccache_state->lru_stale_list,
+								&cc_temp->lru_chain);
+				/* demotion from the hot tier, if nobody references */
+				if (cc_temp->hot_slot > 0 && cc_temp->refcnt == 1)
+				{
+					ccache_state->hot_free_slots[ccache_state->num_hot_free++]
+						= cc_temp->hot_slot;
+					cc_temp->hot_slot = 0;
+				}
 			}
+
+			if (cc_temp->ctime == CCACHE_CTIME_STALE)
+				cc_temp->dirty_map[index >> 3] |= (1 << (index & 7));
 			else
 			{
-				if (TRIGGER_FOR_TRUNCATE(trigger->tgtype))
-					has_stmt_truncate = true;
+				dlist_delete(&cc_temp->hash_chain);
+				memset(&cc_temp->hash_chain, 0, sizeof(dlist_node));
+				ccache_put_chunk_nolock(cc_temp);
 			}
+			elog(BUILDER_LOG,
+				 "ccache: relation %s, block %u invalidation",
+				 RelationGetRelationName(rel), block_nr);
+			break;
 		}
 	}
-	return (has_row_insert &&
-			has_row_update &&
-			has_row_delete &&
-			has_stmt_truncate);
+	SpinLockRelease(&ccache_state->chunks_lock);
 }
 
 /*
@@ -870,54 +1937,28 @@ pgstrom_ccache_invalidator(PG_FUNCTION_ARGS)
 		HeapTuple	tuple = trigdata->tg_trigtuple;
 		BlockNumber	block_nr;
 		BlockNumber	block_nr_last;
-		pg_crc32	hash;
-		int			index;
-		dlist_iter	iter;
 
 		if (!TRIGGER_FIRED_BY_INSERT(trigdata->tg_event) &&
 			!TRIGGER_FIRED_BY_DELETE(trigdata->tg_event) &&
 			!TRIGGER_FIRED_BY_UPDATE(trigdata->tg_event))
 			elog(ERROR, "%s: triggered by unknown event", __FUNCTION__);
 
-		block_nr_last = DatumGetInt32(flinfo->fn_extra);
+		/*
+		 * @fn_extra keeps the last block number + 1, to skip invalidation
+		 * of the same block repeatedly.
+		 */
+		block_nr_last = (BlockNumber)((Datum)flinfo->fn_extra);
 		block_nr = BlockIdGetBlockNumber(&tuple->t_self.ip_blkid);
-		block_nr &= ~(CCACHE_CHUNK_NBLOCKS - 1);
-		if ((block_nr_last & ~(CCACHE_CHUNK_NBLOCKS - 1)) != 0)
-		{
-			block_nr_last &= ~(CCACHE_CHUNK_NBLOCKS - 1);
-			if (block_nr == block_nr_last)
-				PG_RETURN_VOID();
-		}
-		hash = ccache_compute_hashvalue(MyDatabaseId,
-										RelationGetRelid(rel),
-										block_nr);
-		index = hash % ccache_num_slots;
-		SpinLockAcquire(&ccache_state->chunks_lock);
-		dlist_foreach(iter, &ccache_state->active_slots[index])
+		if (block_nr + 1 != block_nr_last)
+			ccache_invalidate_block(rel, block_nr);
+		/* new version of the tuple may be located on another block */
+		if (TRIGGER_FIRED_BY_UPDATE(trigdata->tg_event))
 		{
-			ccacheChunk *cc_temp = dlist_container(ccacheChunk,
-												   hash_chain,
-												   iter.cur);
-			if (cc_temp->hash == hash &&
-				cc_temp->database_oid == MyDatabaseId &&
-				cc_temp->table_oid == RelationGetRelid(rel) &&
-				cc_temp->block_nr == block_nr)
-			{
-				dlist_delete(&cc_temp->hash_chain);
-				memset(&cc_temp->hash_chain, 0, sizeof(dlist_node));
-				ccache_put_chunk_nolock(cc_temp);
-				elog(BUILDER_LOG,
-					 "ccache: relation %s, block %u invalidation",
-					 RelationGetRelationName(rel), block_nr);
-				break;
-			}
+			tuple = trigdata->tg_newtuple;
+			block_nr = BlockIdGetBlockNumber(&tuple->t_self.ip_blkid);
+			if (block_nr + 1 != block_nr_last)
+				ccache_invalidate_block(rel, block_nr);
 		}
-		SpinLockRelease(&ccache_state->chunks_lock);
-
-		/*
-		 * Several least bits of @block_nr should be always zero.
-		 * So, we use the least bit as a mark of valid @block_nr_last.
-		 */
 		flinfo->fn_extra = DatumGetPointer((Datum)(block_nr + 1));
 	}
 	else
@@ -1459,13 +2500,16 @@ ccache_setup_buffer(TupleDesc tupdesc,
 
 /*
  * ccache_expand_buffer
+ *
+ * It expands the buffer to (2 * nrooms + 20000) rows at least, or to
+ * @nrooms_min if caller knows a larger number of rows to be appended.
  */
 void
 ccache_expand_buffer(TupleDesc tupdesc, ccacheBuffer *cc_buf,
-					 MemoryContext memcxt)
+					 size_t nrooms_min, MemoryContext memcxt)
 {
 	MemoryContext oldcxt = MemoryContextSwitchTo(memcxt);
-	size_t		nrooms = (2 * cc_buf->nrooms + 20000);
+	size_t		nrooms = Max(2 * cc_buf->nrooms + 20000, nrooms_min);
 	cl_int		j;
 
 	for (j=0; j < cc_buf->nattrs; j++)
@@ -1654,6 +2698,40 @@ ccache_copy_buffer_from_kds(TupleDesc tupdesc,
 				vl_array[i] = entry;
 			}
 		}
+		else if (cmeta->attpacked)
+		{
+			kern_packed_column *pack = (kern_packed_column *)addr;
+			cl_long		value;
+
+			if (extra_sz > 0)
+			{
+				Assert(extra_sz == MAXALIGN(BITMAPLEN(nitems)));
+				memcpy(cc_buf->nullmap[j],
+					   (char *)addr + KERN_PACKED_COLUMN_LENGTH(pack->nbits,
+																nitems),
+					   BITMAPLEN(nitems));
+				cc_buf->hasnull[j] = true;
+			}
+			else
+			{
+				memset(cc_buf->nullmap[j], ~0, BITMAPLEN(nitems));
+				cc_buf->hasnull[j] = false;
+			}
+			/* unpack the values */
+			for (i=0; i < nitems; i++)
+			{
+				if (!kern_get_packed_column(kds, j, i, &value))
+					value = 0;
+				if (cmeta->attlen == sizeof(cl_short))
+					((cl_short *)cc_buf->values[j])[i] = (cl_short)value;
+				else if (cmeta->attlen == sizeof(cl_int))
+					((cl_int *)cc_buf->values[j])[i] = (cl_int)value;
+				else
+					((cl_long *)cc_buf->values[j])[i] = value;
+			}
+			Assert(cc_buf->vl_dict[j] == NULL);
+			cc_buf->extra_sz[j] = 0;
+		}
 		else
 		{
 			int		unitsz = TYPEALIGN(cmeta->attalign,
@@ -1680,150 +2758,331 @@ ccache_copy_buffer_from_kds(TupleDesc tupdesc,
 }
 
 /*
- * ccache_copy_buffer_to_kds
+ * ccache_buffer_column_frame
+ *
+ * It checks whether the j-th column shall be bit-packed, and returns the
+ * frame of reference and width of the packed values if possible.
+ * Packing is skipped if it does not reduce the size of values array.
  */
-void
-ccache_copy_buffer_to_kds(kern_data_store *kds,
-						  TupleDesc tupdesc,
-						  ccacheBuffer *cc_buf,
-						  bits8 *rowmap, size_t visible_nitems)
+static inline cl_long
+__ccache_buffer_fixed_value(char *values, int attlen, size_t index)
 {
-	size_t	nrooms = (!rowmap ? cc_buf->nitems : visible_nitems);
-	char   *pos;
-	long	i, j, k;
-
-	init_kernel_data_store(kds,
-						   tupdesc,
-						   SIZE_MAX,	/* to be set later */
-						   KDS_FORMAT_COLUMN,
-						   nrooms);
-	Assert(tupdesc->natts == cc_buf->nattrs ||
-		   tupdesc->natts == cc_buf->nattrs + NumOfSystemAttrs);
+	if (attlen == sizeof(cl_short))
+		return ((cl_short *)values)[index];
+	else if (attlen == sizeof(cl_int))
+		return ((cl_int *)values)[index];
+	Assert(attlen == sizeof(cl_long));
+	return ((cl_long *)values)[index];
+}
 
-	pos = (char *)kds + STROMALIGN(offsetof(kern_data_store,
-											colmeta[kds->ncols]));
-	for (j=0; j < cc_buf->nattrs; j++)
+static bool
+ccache_buffer_column_frame(TupleDesc tupdesc,
+						   ccacheBuffer *cc_buf, int j,
+						   cl_long *p_base, cl_uint *p_nbits)
+{
+	Form_pg_attribute attr;
+	bits8	   *nullmap;
+	cl_long		value;
+	cl_long		vmin = LONG_MAX;
+	cl_long		vmax = LONG_MIN;
+	cl_ulong	range;
+	cl_uint		nbits;
+	size_t		i;
+
+	if (j >= tupdesc->natts ||
+		cc_buf->vl_compress[j] != GSTORE_COMPRESSION__BITPACK)
+		return false;
+	attr = tupdesc->attrs[j];
+	Assert(attr->attbyval && (attr->attlen == sizeof(cl_short) ||
+							  attr->attlen == sizeof(cl_int) ||
+							  attr->attlen == sizeof(cl_long)));
+	nullmap = (cc_buf->hasnull[j] ? cc_buf->nullmap[j] : NULL);
+	for (i=0; i < cc_buf->nitems; i++)
 	{
-		Form_pg_attribute attr;
-		kern_colmeta   *cmeta = &kds->colmeta[j];
-		size_t			offset;
-		size_t			nbytes;
-
-		if (j < tupdesc->natts)
-			attr = tupdesc->attrs[j];
-		else
-			attr = SystemAttributeDefinition(j - kds->ncols, true);
-		/* skip dropped columns */
-		if (attr->attisdropped)
+		if (nullmap && att_isnull(i, nullmap))
 			continue;
+		value = __ccache_buffer_fixed_value(cc_buf->values[j],
+											attr->attlen, i);
+		vmin = Min(vmin, value);
+		vmax = Max(vmax, value);
+	}
+	if (vmin > vmax)
+		vmin = vmax = 0;	/* all-null or empty */
+	range = (cl_ulong)vmax - (cl_ulong)vmin;
+	for (nbits=0; nbits < 64 && (range >> nbits) != 0; nbits++);
+	if (nbits >= BITS_PER_BYTE * attr->attlen)
+		return false;
 
-		offset = ((char *)pos - (char *)kds);
-		Assert((offset & (MAXIMUM_ALIGNOF - 1)) == 0);
-		cmeta->va_offset = offset / MAXIMUM_ALIGNOF;
-		if (cmeta->attlen < 0)
-		{
-			cl_uint	   *base = (cl_uint *)pos;
-			char	   *extra = pos + MAXALIGN(sizeof(cl_uint) * nrooms);
-			vl_dict_key **vl_entries = (vl_dict_key **)cc_buf->values[j];
-			vl_dict_key *entry;
+	*p_base = vmin;
+	*p_nbits = nbits;
+	return true;
+}
 
-            for (i=0, k=0; i < cc_buf->nitems; i++)
-            {
-				/* only visible rows */
-				if (rowmap && att_isnull(i, rowmap))
-					continue;
-				entry = vl_entries[i];
-				if (!entry)
-					base[k] = 0;
-				else
+/*
+ * ccache_buffer_column_length
+ *
+ * It returns the length to be consumed by the j-th regular column, when
+ * the buffer is written out to KDS_FORMAT_COLUMN with @nrooms rows.
+ */
+size_t
+ccache_buffer_column_length(TupleDesc tupdesc,
+							ccacheBuffer *cc_buf,
+							int j, size_t nrooms)
+{
+	Form_pg_attribute attr = tupdesc->attrs[j];
+	size_t		length;
+	cl_long		base;
+	cl_uint		nbits;
+
+	Assert(j < tupdesc->natts);
+	if (attr->attisdropped)
+		return 0;
+	if (attr->attlen < 0)
+		return (MAXALIGN(sizeof(cl_uint) * nrooms) +
+				MAXALIGN(cc_buf->extra_sz[j]));
+
+	if (ccache_buffer_column_frame(tupdesc, cc_buf, j, &base, &nbits))
+		length = KERN_PACKED_COLUMN_LENGTH(nbits, nrooms);
+	else
+		length = MAXALIGN(att_align_nominal(attr->attlen,
+											attr->attalign) * nrooms);
+	if (cc_buf->hasnull[j])
+		length += MAXALIGN(BITMAPLEN(nrooms));
+	return length;
+}
+
+/*
+ * ccache_copy_buffer_column
+ *
+ * It writes out the j-th column of the buffer onto @dest, that shall be
+ * located at @offset from the head of @kds. Only the KDS header of @kds
+ * has to be valid, so the caller can write out a large KDS column by
+ * column. It returns the length consumed.
+ */
+size_t
+ccache_copy_buffer_column(kern_data_store *kds,
+						  TupleDesc tupdesc,
+						  ccacheBuffer *cc_buf,
+						  bits8 *rowmap, size_t nrooms,
+						  int j, char *dest, size_t offset)
+{
+	Form_pg_attribute attr;
+	kern_colmeta   *cmeta = &kds->colmeta[j];
+	char		   *pos = dest;
+	size_t			nbytes;
+	long			i, k;
+	cl_long			base;
+	cl_uint			nbits;
+
+	if (j < tupdesc->natts)
+		attr = tupdesc->attrs[j];
+	else
+		attr = SystemAttributeDefinition(j - kds->ncols, true);
+	/* skip dropped columns */
+	if (attr->attisdropped)
+		return 0;
+
+	Assert((offset & (MAXIMUM_ALIGNOF - 1)) == 0);
+	cmeta->va_offset = offset / MAXIMUM_ALIGNOF;
+	cmeta->attpacked = false;
+	if (cmeta->attlen < 0)
+	{
+		cl_uint	   *base = (cl_uint *)pos;
+		char	   *extra = pos + MAXALIGN(sizeof(cl_uint) * nrooms);
+		vl_dict_key **vl_entries = (vl_dict_key **)cc_buf->values[j];
+		vl_dict_key *entry;
+		size_t		vl_offset;
+		HASH_SEQ_STATUS	hseq;
+
+		/* offset may be assigned by the prior write of the same buffer */
+		hash_seq_init(&hseq, cc_buf->vl_dict[j]);
+		while ((entry = hash_seq_search(&hseq)) != NULL)
+			entry->offset = 0;
+
+		for (i=0, k=0; i < cc_buf->nitems; i++)
+		{
+			/* only visible rows */
+			if (rowmap && att_isnull(i, rowmap))
+				continue;
+			entry = vl_entries[i];
+			if (!entry)
+				base[k] = 0;
+			else
+			{
+				if (entry->offset == 0)
 				{
-					if (entry->offset == 0)
-					{
-						offset = (size_t)(extra - (char *)base);
-						Assert((offset & (MAXIMUM_ALIGNOF - 1)) == 0);
-						entry->offset = offset / MAXIMUM_ALIGNOF;
-						nbytes = VARSIZE_ANY(entry->vl_datum);
-						Assert(nbytes > 0);
-						memcpy(extra, entry->vl_datum, nbytes);
-						cmeta->extra_sz += MAXALIGN(nbytes) / MAXIMUM_ALIGNOF;
-						extra += MAXALIGN(nbytes);
-					}
-					base[k] = entry->offset;
+					vl_offset = (size_t)(extra - (char *)base);
+					Assert((vl_offset & (MAXIMUM_ALIGNOF - 1)) == 0);
+					entry->offset = vl_offset / MAXIMUM_ALIGNOF;
+					nbytes = VARSIZE_ANY(entry->vl_datum);
+					Assert(nbytes > 0);
+					memcpy(extra, entry->vl_datum, nbytes);
+					cmeta->extra_sz += MAXALIGN(nbytes) / MAXIMUM_ALIGNOF;
+					extra += MAXALIGN(nbytes);
 				}
-				k++;
+				base[k] = entry->offset;
 			}
-			Assert(k == nrooms);
-			pos += (char *)extra - (char *)base;
+			k++;
 		}
-		else if (!rowmap)
+		Assert(k == nrooms);
+		pos += (char *)extra - (char *)base;
+	}
+	else if (ccache_buffer_column_frame(tupdesc, cc_buf, j, &base, &nbits))
+	{
+		kern_packed_column *pack = (kern_packed_column *)pos;
+		char	   *src = cc_buf->values[j];
+		bool		meet_null = false;
+		bits8	   *d_nullmap;
+		bits8	   *s_nullmap;
+		cl_ulong	value;
+		cl_ulong	bitpos;
+		cl_uint		shift;
+
+		/* fixed-length attribute with bit-packing */
+		nbytes = KERN_PACKED_COLUMN_LENGTH(nbits, nrooms);
+		memset(pack, 0, nbytes);
+		pack->base = base;
+		pack->nbits = nbits;
+		d_nullmap = (cc_buf->hasnull[j] ? (bits8 *)(pos + nbytes) : NULL);
+		s_nullmap = (cc_buf->hasnull[j] ? cc_buf->nullmap[j] : NULL);
+
+		for (i=0, k=0; i < cc_buf->nitems; i++)
 		{
-			/* fixed-length attribute without row-visibility map */
-			offset = pos - (char *)kds;
-			Assert((offset & (MAXIMUM_ALIGNOF - 1)) == 0);
+			/* only visible rows */
+			if (rowmap && att_isnull(i, rowmap))
+				continue;
 
-			cmeta->va_offset = offset / MAXIMUM_ALIGNOF;
-			nbytes = MAXALIGN(TYPEALIGN(cmeta->attalign,
-										cmeta->attlen) * nrooms);
-			memcpy(pos, cc_buf->values[j], nbytes);
-			pos += nbytes;
-			/* null bitmap, if any */
-			if (!cc_buf->hasnull[j])
-				cmeta->extra_sz = 0;
+			if (s_nullmap && att_isnull(i, s_nullmap))
+			{
+				Assert(d_nullmap != NULL);
+				d_nullmap[k>>3] &= ~(1 << (k & (BITS_PER_BYTE - 1)));
+				meet_null = true;
+			}
 			else
 			{
-				nbytes = MAXALIGN(BITMAPLEN(nrooms));
-				cmeta->extra_sz = nbytes  / MAXIMUM_ALIGNOF;
-				memcpy(pos, cc_buf->nullmap[j], nbytes);
-				pos += nbytes;
+				if (d_nullmap)
+					d_nullmap[k>>3] |=  (1 << (k & (BITS_PER_BYTE - 1)));
+				if (nbits > 0)
+				{
+					value = (cl_ulong)
+						(__ccache_buffer_fixed_value(src, cmeta->attlen, i) -
+						 base);
+					bitpos = (cl_ulong)k * (cl_ulong)nbits;
+					shift = (bitpos & 63);
+					pack->values[bitpos >> 6] |= (value << shift);
+					if (shift + nbits > 64)
+						pack->values[(bitpos >> 6) + 1]
+							|= (value >> (64 - shift));
+				}
 			}
+			k++;
 		}
+		Assert(k == nrooms);
+		pos += nbytes;
+		if (!meet_null)
+			cmeta->extra_sz = 0;
 		else
 		{
-			bool		meet_null = false;
-			char	   *src = cc_buf->values[j];
-			bits8	   *d_nullmap;
-			bits8	   *s_nullmap;
-			int			unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
-			/* fixed-length attribute with row-visibility map */
-			offset = pos - (char *)kds;
-			Assert((offset & (MAXIMUM_ALIGNOF - 1)) == 0);
-
-			cmeta->va_offset = offset / MAXIMUM_ALIGNOF;
-			nbytes = MAXALIGN(TYPEALIGN(cmeta->attalign,
-										cmeta->attlen) * nrooms);
-			d_nullmap = (cc_buf->hasnull[j] ? (bits8 *)(pos + nbytes) : NULL);
-			s_nullmap = (cc_buf->hasnull[j] ? cc_buf->nullmap[j] : NULL);
-
-			for (i=0, k=0; i < cc_buf->nitems; i++)
-			{
-				/* only visible rows */
-				if (att_isnull(i, rowmap))
-					continue;
+			nbytes = MAXALIGN(BITMAPLEN(nrooms));
+			cmeta->extra_sz = nbytes / MAXIMUM_ALIGNOF;
+			pos += nbytes;
+		}
+		cmeta->attpacked = true;
+		kds->has_packed = true;
+	}
+	else if (!rowmap)
+	{
+		/* fixed-length attribute without row-visibility map */
+		nbytes = MAXALIGN(TYPEALIGN(cmeta->attalign,
+									cmeta->attlen) * nrooms);
+		memcpy(pos, cc_buf->values[j], nbytes);
+		pos += nbytes;
+		/* null bitmap, if any */
+		if (!cc_buf->hasnull[j])
+			cmeta->extra_sz = 0;
+		else
+		{
+			nbytes = MAXALIGN(BITMAPLEN(nrooms));
+			cmeta->extra_sz = nbytes  / MAXIMUM_ALIGNOF;
+			memcpy(pos, cc_buf->nullmap[j], nbytes);
+			pos += nbytes;
+		}
+	}
+	else
+	{
+		bool		meet_null = false;
+		char	   *src = cc_buf->values[j];
+		bits8	   *d_nullmap;
+		bits8	   *s_nullmap;
+		int			unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
+
+		/* fixed-length attribute with row-visibility map */
+		nbytes = MAXALIGN(TYPEALIGN(cmeta->attalign,
+									cmeta->attlen) * nrooms);
+		d_nullmap = (cc_buf->hasnull[j] ? (bits8 *)(pos + nbytes) : NULL);
+		s_nullmap = (cc_buf->hasnull[j] ? cc_buf->nullmap[j] : NULL);
+
+		for (i=0, k=0; i < cc_buf->nitems; i++)
+		{
+			/* only visible rows */
+			if (att_isnull(i, rowmap))
+				continue;
 
-				if (s_nullmap && att_isnull(i, s_nullmap))
-				{
-					Assert(d_nullmap != NULL);
-					d_nullmap[k>>3] &= ~(1 << (k & (BITS_PER_BYTE - 1)));
-					meet_null = true;
-				}
-				else
-				{
-					if (d_nullmap)
-						d_nullmap[k>>3] |=  (1 << (k & (BITS_PER_BYTE - 1)));
-					memcpy(pos + unitsz * k, src + unitsz * i, unitsz);
-				}
-				k++;
+			if (s_nullmap && att_isnull(i, s_nullmap))
+			{
+				Assert(d_nullmap != NULL);
+				d_nullmap[k>>3] &= ~(1 << (k & (BITS_PER_BYTE - 1)));
+				meet_null = true;
 			}
-			Assert(k == nrooms);
-			pos += MAXALIGN(unitsz * nrooms);
-			if (meet_null)
+			else
 			{
-				nbytes = MAXALIGN(BITMAPLEN(nrooms));
-				cmeta->extra_sz = nbytes / MAXIMUM_ALIGNOF;
-				pos += nbytes;
+				if (d_nullmap)
+					d_nullmap[k>>3] |=  (1 << (k & (BITS_PER_BYTE - 1)));
+				memcpy(pos + unitsz * k, src + unitsz * i, unitsz);
 			}
+			k++;
+		}
+		Assert(k == nrooms);
+		pos += MAXALIGN(unitsz * nrooms);
+		if (meet_null)
+		{
+			nbytes = MAXALIGN(BITMAPLEN(nrooms));
+			cmeta->extra_sz = nbytes / MAXIMUM_ALIGNOF;
+			pos += nbytes;
 		}
 	}
+	return (size_t)(pos - dest);
+}
+
+/*
+ * ccache_copy_buffer_to_kds
+ */
+void
+ccache_copy_buffer_to_kds(kern_data_store *kds,
+						  TupleDesc tupdesc,
+						  ccacheBuffer *cc_buf,
+						  bits8 *rowmap, size_t visible_nitems)
+{
+	size_t	nrooms = (!rowmap ? cc_buf->nitems : visible_nitems);
+	char   *pos;
+	int		j;
+
+	init_kernel_data_store(kds,
+						   tupdesc,
+						   SIZE_MAX,	/* to be set later */
+						   KDS_FORMAT_COLUMN,
+						   nrooms);
+	Assert(tupdesc->natts == cc_buf->nattrs ||
+		   tupdesc->natts == cc_buf->nattrs + NumOfSystemAttrs);
+
+	pos = (char *)kds + STROMALIGN(offsetof(kern_data_store,
+											colmeta[kds->ncols]));
+	for (j=0; j < cc_buf->nattrs; j++)
+	{
+		pos += ccache_copy_buffer_column(kds, tupdesc, cc_buf,
+										 rowmap, nrooms, j,
+										 pos, (size_t)(pos - (char *)kds));
+	}
 	kds->nitems = nrooms;
 	kds->length = (char *)pos - (char *)kds;
 }
@@ -1948,6 +3207,110 @@ ccache_buffer_append_row(TupleDesc tupdesc,
 	MemoryContextSwitchTo(oldcxt);
 }
 
+/*
+ * ccache_buffer_append_kds_row - copies a row from KDS_FORMAT_COLUMN
+ */
+static void
+ccache_buffer_append_kds_row(TupleDesc tupdesc,
+							 ccacheBuffer *cc_buf,
+							 kern_data_store *kds,
+							 size_t row_index,
+							 MemoryContext memcxt)
+{
+	MemoryContext oldcxt = MemoryContextSwitchTo(memcxt);
+	size_t		j, nitems;
+
+	if (cc_buf->nitems >= cc_buf->nrooms)
+		elog(ERROR, "lack of ccache buffer rooms");
+	Assert(row_index < kds->nitems);
+
+	nitems = cc_buf->nitems;
+	for (j=0; j < cc_buf->nattrs; j++)
+	{
+		kern_colmeta *cmeta = &kds->colmeta[j];
+		char	   *addr;
+
+		addr = (char *)kds + ((size_t)cmeta->va_offset << MAXIMUM_ALIGNOF_SHIFT);
+		if (cmeta->attlen < 0)
+		{
+			vl_dict_key	key, *entry = NULL;
+			size_t		offset = 0;
+			bool		found;
+
+			if (cmeta->va_offset != 0)
+				offset = ((cl_uint *)addr)[row_index] << MAXIMUM_ALIGNOF_SHIFT;
+			if (offset != 0)
+			{
+				struct varlena *vl = (struct varlena *)(addr + offset);
+
+				key.offset = 0;
+				key.vl_datum = vl;
+				entry = hash_search(cc_buf->vl_dict[j],
+									&key,
+									HASH_ENTER,
+									&found);
+				if (!found)
+				{
+					/* already compressed on the ccache file */
+					entry->offset = 0;
+					entry->vl_datum = palloc(VARSIZE_ANY(vl));
+					memcpy(entry->vl_datum, vl, VARSIZE_ANY(vl));
+					cc_buf->extra_sz[j] += MAXALIGN(VARSIZE_ANY(vl));
+				}
+			}
+			((vl_dict_key **)cc_buf->values[j])[nitems] = entry;
+		}
+		else if (cmeta->attpacked)
+		{
+			bits8  *nullmap = cc_buf->nullmap[j];
+			cl_long	value;
+
+			if (!kern_get_packed_column(kds, j, row_index, &value))
+			{
+				cc_buf->hasnull[j] = true;
+				nullmap[nitems >> 3] &= ~(1 << (nitems & 7));
+			}
+			else
+			{
+				nullmap[nitems >> 3] |= (1 << (nitems & 7));
+				if (cmeta->attlen == sizeof(cl_short))
+					((cl_short *)cc_buf->values[j])[nitems] = (cl_short)value;
+				else if (cmeta->attlen == sizeof(cl_int))
+					((cl_int *)cc_buf->values[j])[nitems] = (cl_int)value;
+				else
+					((cl_long *)cc_buf->values[j])[nitems] = value;
+			}
+		}
+		else
+		{
+			bits8  *nullmap = cc_buf->nullmap[j];
+			int		unitsz = TYPEALIGN(cmeta->attalign, cmeta->attlen);
+			bool	isnull;
+
+			if (cmeta->va_offset == 0)
+				isnull = true;
+			else if (cmeta->extra_sz == 0)
+				isnull = false;
+			else
+				isnull = att_isnull(row_index, (bits8 *)
+									(addr + MAXALIGN(unitsz * kds->nitems)));
+			if (isnull)
+			{
+				cc_buf->hasnull[j] = true;
+				nullmap[nitems >> 3] &= ~(1 << (nitems & 7));
+			}
+			else
+			{
+				nullmap[nitems >> 3] |= (1 << (nitems & 7));
+				memcpy((char *)cc_buf->values[j] + unitsz * nitems,
+					   addr + unitsz * row_index,
+					   cmeta->attlen);
+			}
+		}
+	}
+	MemoryContextSwitchTo(oldcxt);
+}
+
 /*
  * long-life resources for preload/tryload
  */
@@ -1957,11 +3320,18 @@ static Buffer			VisibilityMapBuffer = InvalidBuffer;
 
 /*
  * ccache_preload_chunk - preload a chunk
+ *
+ * If @kds_old is given, rows on the blocks not marked at @dirty_map are
+ * copied from the previous version of the ccache file, instead of the
+ * extraction from the heap blocks.
  */
 static bool
 __ccache_preload_chunk(ccacheChunk *cc_chunk,
 					   Relation relation,
-					   BlockNumber block_nr)
+					   BlockNumber block_nr,
+					   kern_data_store *kds_old,
+					   cl_uint *row_index_old,
+					   bits8 *dirty_map)
 {
 	TupleDesc	tupdesc = RelationGetDescr(relation);
 	size_t		nrooms = 0;
@@ -1970,7 +3340,11 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 	ccacheBuffer cc_buf;
 	int			i, j, fdesc;
 	size_t		length;
+	size_t		zmap_offset;
+	cl_uint	   *row_index;
 	char		fname[MAXPGPATH];
+	char		tname[MAXPGPATH + 8];
+	struct stat	stat_buf;
 	kern_data_store *kds;
 	BufferAccessStrategy strategy;
 
@@ -1998,6 +3372,12 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 		Page	page;
 
 		CHECK_FOR_INTERRUPTS();
+		/* rows on the clean block shall be copied from the old chunk */
+		if (kds_old && !(dirty_map[i >> 3] & (1 << (i & 7))))
+		{
+			nrooms += row_index_old[i+1] - row_index_old[i];
+			continue;
+		}
 		buffer = ReadBufferExtended(relation, MAIN_FORKNUM, block_nr+i,
 									RBM_NORMAL, strategy);
 		LockBuffer(buffer, BUFFER_LOCK_SHARE);
@@ -2023,15 +3403,53 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 	 */
 	ccache_setup_buffer(tupdesc, &cc_buf, true, nrooms,
 						CurrentMemoryContext);
+	if (ccache_compression)
+	{
+		/* integer-like columns are bit-packed, if narrower */
+		for (j=0; j < tupdesc->natts; j++)
+		{
+			Form_pg_attribute attr = tupdesc->attrs[j];
+
+			if (attr->attisdropped)
+				continue;
+			if (attr->atttypid == INT2OID ||
+				attr->atttypid == INT4OID ||
+				attr->atttypid == INT8OID ||
+				attr->atttypid == DATEOID ||
+				attr->atttypid == TIMEOID ||
+				attr->atttypid == TIMESTAMPOID ||
+				attr->atttypid == TIMESTAMPTZOID)
+				cc_buf.vl_compress[j] = GSTORE_COMPRESSION__BITPACK;
+		}
+	}
 	tup_values = palloc(sizeof(Datum) * tupdesc->natts);
 	tup_isnull = palloc(sizeof(bool) * tupdesc->natts);
+	row_index = palloc(sizeof(cl_uint) * (CCACHE_CHUNK_NBLOCKS + 1));
 	for (i=0; i < CCACHE_CHUNK_NBLOCKS; i++)
 	{
 		Page	page = (Page)(PerChunkLoadBuffer + BLCKSZ * i);
-		int		lines = PageGetMaxOffsetNumber(page);
+		int		lines;
 		OffsetNumber lineoff;
 		ItemId	lpp;
 
+		row_index[i] = cc_buf.nitems;
+		if (kds_old && !(dirty_map[i >> 3] & (1 << (i & 7))))
+		{
+			cl_uint		k;
+
+			for (k = row_index_old[i]; k < row_index_old[i+1]; k++)
+			{
+				Assert(cc_buf.nitems < nrooms);
+				ccache_buffer_append_kds_row(tupdesc,
+											 &cc_buf,
+											 kds_old, k,
+											 CurrentMemoryContext);
+				cc_buf.nitems++;
+			}
+			continue;
+		}
+		lines = PageGetMaxOffsetNumber(page);
+
 		for (lineoff = FirstOffsetNumber, lpp = PageGetItemId(page, lineoff);
 			 lineoff <= lines;
 			 lineoff++, lpp++)
@@ -2056,6 +3474,7 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 			cc_buf.nitems++;
 		}
 	}
+	row_index[CCACHE_CHUNK_NBLOCKS] = cc_buf.nitems;
 
 	/* write out to the ccache file */
 	length = STROMALIGN(offsetof(kern_data_store,
@@ -2064,16 +3483,18 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 	{
 		Form_pg_attribute attr;
 
-		if (j < 0)
+		if (j >= 0)
 		{
-			if (j == TableOidAttributeNumber)
-				continue;
-			if (j == ObjectIdAttributeNumber && !tupdesc->tdhasoid)
-				continue;
-			attr = SystemAttributeDefinition(j, true);
+			/* regular columns may be bit-packed */
+			length += ccache_buffer_column_length(tupdesc, &cc_buf,
+												  j, cc_buf.nitems);
+			continue;
 		}
-		else
-			attr = tupdesc->attrs[j];
+		if (j == TableOidAttributeNumber)
+			continue;
+		if (j == ObjectIdAttributeNumber && !tupdesc->tdhasoid)
+			continue;
+		attr = SystemAttributeDefinition(j, true);
 
 		if (attr->attlen < 0)
 		{
@@ -2089,17 +3510,32 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 				length += MAXALIGN(BITMAPLEN(cc_buf.nitems));
 		}
 	}
+	/* zone-map of the regular columns, and block index */
+	zmap_offset = length;
+	length += MAXALIGN(sizeof(ccacheZoneMap) * tupdesc->natts) +
+		MAXALIGN(sizeof(cl_uint) * (CCACHE_CHUNK_NBLOCKS + 1));
+
+	/*
+	 * The chunk file of the same block may still be mapped by the PDS of
+	 * concurrent scan, if previous chunk was invalidated. Truncation of the
+	 * file raises SIGBUS on them, so we construct the new inode under the
+	 * temporary name, then renames it onto the chunk file.
+	 */
 	ccache_chunk_filename(fname,
 						  MyDatabaseId,
 						  RelationGetRelid(relation),
 						  block_nr);
-	fdesc = openat(dirfd(ccache_base_dir), fname,
+	snprintf(tname, sizeof(tname), "%s.tmp", fname);
+	fdesc = openat(dirfd(ccache_base_dir), tname,
 				   O_RDWR | O_CREAT | O_TRUNC, 0600);
 	if (fdesc < 0)
-		elog(ERROR, "failed on openat('%s'): %m", fname);
-	if (fallocate(fdesc, 0, 0, length) < 0)
+		elog(ERROR, "failed on openat('%s'): %m", tname);
+	/* BLCKSZ aligned, for SSD-to-GPU Direct DMA */
+	if (fallocate(fdesc, 0, 0, TYPEALIGN(BLCKSZ, length)) < 0 ||
+		fstat(fdesc, &stat_buf) != 0)
 	{
 		close(fdesc);
+		unlinkat(dirfd(ccache_base_dir), tname, 0);
 		elog(ERROR, "failed on fallocate: %m");
 	}
 	kds = mmap(NULL, length,
@@ -2109,9 +3545,15 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 	if (kds == MAP_FAILED)
 	{
 		close(fdesc);
+		unlinkat(dirfd(ccache_base_dir), tname, 0);
 		elog(ERROR, "failed on mmap: %m");
 	}
 	ccache_copy_buffer_to_kds(kds, tupdesc, &cc_buf, NULL, 0);
+	Assert(kds->length <= zmap_offset);
+	ccache_buffer_build_zonemap(tupdesc, &cc_buf,
+								(ccacheZoneMap *)((char *)kds + zmap_offset));
+	memcpy(CCACHE_BLOCK_INDEX(kds, zmap_offset, tupdesc->natts),
+		   row_index, sizeof(cl_uint) * (CCACHE_CHUNK_NBLOCKS + 1));
 	if (munmap(kds, length) != 0)
 		elog(WARNING, "failed on munmap: %m");
 	if (close(fdesc) != 0)
@@ -2129,8 +3571,6 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 		{
 			if (!VM_ALL_VISIBLE(relation, block_nr+j, &VisibilityMapBuffer))
 			{
-				if (unlinkat(dirfd(ccache_base_dir), fname, 0) != 0)
-					elog(WARNING, "failed on unlinkat('%s'): %m", fname);
 				length = 0;
 				elog(BUILDER_LOG,
 					 "relation %s, block_nr %u - %lu not all visible",
@@ -2143,10 +3583,26 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 	PG_CATCH();
 	{
 		SpinLockRelease(&ccache_state->chunks_lock);
+		unlinkat(dirfd(ccache_base_dir), tname, 0);
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
 
+	/*
+	 * Replace the chunk file under the lock, not to race with unlink of the
+	 * previous chunk on ccache_put_chunk_nolock().
+	 */
+	if (length > 0 &&
+		renameat(dirfd(ccache_base_dir), tname,
+				 dirfd(ccache_base_dir), fname) != 0)
+	{
+		elog(WARNING, "failed on renameat('%s','%s'): %m", tname, fname);
+		length = 0;
+	}
+	if (length == 0 &&
+		unlinkat(dirfd(ccache_base_dir), tname, 0) != 0)
+		elog(WARNING, "failed on unlinkat('%s'): %m", tname);
+
 	if (length > 0)
 	{
 		dlist_iter		iter;
@@ -2155,6 +3611,8 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 		ccache_state->ccache_usage += TYPEALIGN(BLCKSZ, length);
 
 		cc_chunk->length = length;
+		cc_chunk->file_ino = stat_buf.st_ino;
+		cc_chunk->zmap_offset = zmap_offset;
 		cc_chunk->nitems = cc_buf.nitems;
 		cc_chunk->nattrs = RelationGetNumberOfAttributes(relation);
 		cc_chunk->ctime = GetCurrentTimestamp();
@@ -2185,13 +3643,17 @@ __ccache_preload_chunk(ccacheChunk *cc_chunk,
 static bool
 ccache_preload_chunk(ccacheChunk *cc_chunk,
 					 Relation relation,
-					 BlockNumber block_nr)
+					 BlockNumber block_nr,
+					 kern_data_store *kds_old,
+					 cl_uint *row_index_old,
+					 bits8 *dirty_map)
 {
 	bool	retval;
 
 	PG_TRY();
 	{
-		retval = __ccache_preload_chunk(cc_chunk, relation, block_nr);
+		retval = __ccache_preload_chunk(cc_chunk, relation, block_nr,
+										kds_old, row_index_old, dirty_map);
 		if (retval)
 		{
 			if (ccache_builder)
@@ -2247,33 +3709,56 @@ static bool
 ccache_tryload_misshit_chunk(void)
 {
 	dlist_node	   *dnode;
-	ccacheChunk	   *cc_chunk;
+	dlist_iter		iter;
+	ccacheChunk	   *cc_chunk = NULL;
 	ccacheChunk	   *cc_temp;
+	cl_ulong		nmisses;
+	cl_ulong		max_nmisses = 0;
+	TimestampTz		now = GetCurrentTimestamp();
+	int				count = 0;
 	bool			retval;
 
-	/* pick up a target chunk to be loaded, which is recently referenced */
+	/*
+	 * pick up a target chunk to be loaded, which is most frequently
+	 * referenced among the recently referenced candidates
+	 */
 	SpinLockAcquire(&ccache_state->chunks_lock);
-	if (dlist_is_empty(&ccache_state->lru_misshit_list))
+	dlist_foreach(iter, &ccache_state->lru_misshit_list)
+	{
+		cc_temp = dlist_container(ccacheChunk, lru_chain, iter.cur);
+		Assert(cc_temp->hash_chain.prev != NULL &&
+			   cc_temp->hash_chain.next != NULL &&
+			   cc_temp->ctime == CCACHE_CTIME_NOT_BUILD);
+		if (cc_temp->database_oid != MyDatabaseId)
+			continue;
+		nmisses = ccache_decay_misshit(cc_temp->nmisses, cc_temp->atime, now);
+		if (!cc_chunk || nmisses > max_nmisses)
+		{
+			cc_chunk = cc_temp;
+			max_nmisses = nmisses;
+		}
+		if (++count >= CCACHE_MISSHIT_CANDIDATES)
+			break;
+	}
+	if (!cc_chunk)
 	{
 		SpinLockRelease(&ccache_state->chunks_lock);
 		return false;
 	}
-	dnode = dlist_head_node(&ccache_state->lru_misshit_list);
-	cc_chunk = dlist_container(ccacheChunk, lru_chain, dnode);
-	Assert(cc_chunk->hash_chain.prev != NULL &&
-		   cc_chunk->hash_chain.next != NULL &&
-		   cc_chunk->ctime == CCACHE_CTIME_NOT_BUILD);
 
 	/* release existing chunks if ccache usage is nearby the limitation */
 	while (ccache_state->ccache_usage +
 		   CCACHE_CHUNK_SIZE > ccache_total_size)
 	{
-		if (dlist_is_empty(&ccache_state->lru_active_list))
+		if (!dlist_is_empty(&ccache_state->lru_active_list))
+			dnode = dlist_tail_node(&ccache_state->lru_active_list);
+		else if (!dlist_is_empty(&ccache_state->lru_stale_list))
+			dnode = dlist_tail_node(&ccache_state->lru_stale_list);
+		else
 		{
 			SpinLockRelease(&ccache_state->chunks_lock);
 			return false;
 		}
-		dnode = dlist_tail_node(&ccache_state->lru_active_list);
 		cc_temp = dlist_container(ccacheChunk, lru_chain, dnode);
 		Assert(cc_temp->ctime != CCACHE_CTIME_IN_PROGRESS);
 		dlist_delete(&cc_temp->hash_chain);
@@ -2297,11 +3782,167 @@ ccache_tryload_misshit_chunk(void)
 		Relation	relation;
 
 		relation = heap_open(cc_chunk->table_oid, AccessShareLock);
-		retval = ccache_preload_chunk(cc_chunk, relation, cc_chunk->block_nr);
+		retval = ccache_preload_chunk(cc_chunk, relation, cc_chunk->block_nr,
+									  NULL, NULL, NULL);
+		heap_close(relation, NoLock);
+	}
+	PG_CATCH();
+	{
+		/* update builder's state */
+		SpinLockAcquire(&ccache_state->lock);
+		ccache_builder->table_oid = InvalidOid;
+		ccache_builder->block_nr = InvalidBlockNumber;
+		SpinLockRelease(&ccache_state->lock);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	/* update builder's state */
+	SpinLockAcquire(&ccache_state->lock);
+	ccache_builder->table_oid = InvalidOid;
+	ccache_builder->block_nr = InvalidBlockNumber;
+	SpinLockRelease(&ccache_state->lock);
+
+	return retval;
+}
+
+/*
+ * ccache_tryload_stale_chunk - refresh a stale chunk incrementally
+ *
+ * It rebuilds the stale chunk with re-extraction of the dirty blocks only,
+ * once these blocks get all-visible again. Rows on the other blocks are
+ * copied from the previous ccache file.
+ */
+static bool
+ccache_tryload_stale_chunk(void)
+{
+	ccacheChunk	   *cc_chunk = NULL;
+	dlist_iter		iter;
+	bits8			dirty_map[BITMAPLEN(CCACHE_CHUNK_NBLOCKS)];
+	Oid				table_oid;
+	BlockNumber		block_nr;
+	size_t			length;
+	size_t			zmap_offset;
+	cl_int			nattrs;
+	char			fname[MAXPGPATH];
+	int				i, fdesc;
+	Relation		relation;
+	kern_data_store *kds_old = NULL;
+	bool			retval;
+
+	/* pick up a stale chunk, which nobody references */
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	dlist_foreach(iter, &ccache_state->lru_stale_list)
+	{
+		ccacheChunk	   *cc_temp = dlist_container(ccacheChunk, lru_chain,
+												  iter.cur);
+		Assert(cc_temp->ctime == CCACHE_CTIME_STALE);
+		if (cc_temp->refcnt == 1 &&
+			cc_temp->database_oid == MyDatabaseId)
+		{
+			cc_chunk = cc_temp;
+			break;
+		}
+	}
+	if (!cc_chunk)
+	{
+		SpinLockRelease(&ccache_state->chunks_lock);
+		return false;
+	}
+	memcpy(dirty_map, cc_chunk->dirty_map, sizeof(dirty_map));
+	table_oid = cc_chunk->table_oid;
+	block_nr = cc_chunk->block_nr;
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	/* dirty blocks must be all-visible again */
+	relation = heap_open(table_oid, AccessShareLock);
+	if (block_nr + CCACHE_CHUNK_NBLOCKS > RelationGetNumberOfBlocks(relation))
+		goto not_ready;
+	for (i=0; i < CCACHE_CHUNK_NBLOCKS; i++)
+	{
+		if ((dirty_map[i >> 3] & (1 << (i & 7))) != 0 &&
+			!VM_ALL_VISIBLE(relation, block_nr+i, &VisibilityMapBuffer))
+			goto not_ready;
+	}
+
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	if (cc_chunk->ctime != CCACHE_CTIME_STALE ||
+		cc_chunk->refcnt != 1 ||
+		cc_chunk->table_oid != table_oid ||
+		cc_chunk->block_nr != block_nr ||
+		memcmp(cc_chunk->dirty_map, dirty_map, sizeof(dirty_map)) != 0)
+	{
+		/* someone changed the chunk concurrently, retry later */
+		SpinLockRelease(&ccache_state->chunks_lock);
 		heap_close(relation, NoLock);
+		return false;
+	}
+	length = cc_chunk->length;
+	zmap_offset = cc_chunk->zmap_offset;
+	nattrs = cc_chunk->nattrs;
+	/* detach from the LRU list, and mark it 'in-progress' */
+	dlist_delete(&cc_chunk->lru_chain);
+	memset(&cc_chunk->lru_chain, 0, sizeof(dlist_node));
+	Assert(ccache_state->ccache_usage >= TYPEALIGN(BLCKSZ, length));
+	ccache_state->ccache_usage -= TYPEALIGN(BLCKSZ, length);
+	if (cc_chunk->hot_slot > 0)
+		ccache_state->hot_free_slots[ccache_state->num_hot_free++]
+			= cc_chunk->hot_slot;
+	cc_chunk->hot_slot = 0;
+	cc_chunk->length = 0;
+	cc_chunk->zmap_offset = 0;
+	cc_chunk->ctime = CCACHE_CTIME_IN_PROGRESS;
+	cc_chunk->refcnt++;
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	/*
+	 * Map the previous ccache file, then unlink it. The mapping is still
+	 * valid until munmap(2), even if the new file is created.
+	 */
+	ccache_chunk_filename(fname, MyDatabaseId, table_oid, block_nr);
+	fdesc = openat(dirfd(ccache_base_dir), fname, O_RDONLY);
+	if (fdesc < 0)
+		elog(WARNING, "failed on openat('%s'): %m", fname);
+	else
+	{
+		kds_old = mmap(NULL, length, PROT_READ, MAP_SHARED, fdesc, 0);
+		if (kds_old == MAP_FAILED)
+		{
+			elog(WARNING, "failed on mmap('%s'): %m", fname);
+			kds_old = NULL;
+		}
+		close(fdesc);
+		if (unlinkat(dirfd(ccache_base_dir), fname, 0) != 0)
+			elog(WARNING, "failed on unlinkat('%s'): %m", fname);
+	}
+	/* full rebuild, if layout of the relation is changed */
+	if (kds_old && (zmap_offset == 0 ||
+					nattrs != RelationGetNumberOfAttributes(relation)))
+	{
+		if (munmap(kds_old, length) != 0)
+			elog(WARNING, "failed on munmap: %m");
+		kds_old = NULL;
+	}
+
+	/* update builder's state */
+	SpinLockAcquire(&ccache_state->lock);
+	ccache_builder->table_oid = table_oid;
+	ccache_builder->block_nr = block_nr;
+	SpinLockRelease(&ccache_state->lock);
+
+	PG_TRY();
+	{
+		retval = ccache_preload_chunk(cc_chunk, relation, block_nr,
+									  kds_old,
+									  !kds_old ? NULL :
+									  CCACHE_BLOCK_INDEX(kds_old,
+														 zmap_offset,
+														 nattrs),
+									  dirty_map);
 	}
 	PG_CATCH();
 	{
+		if (kds_old)
+			munmap(kds_old, length);
 		/* update builder's state */
 		SpinLockAcquire(&ccache_state->lock);
 		ccache_builder->table_oid = InvalidOid;
@@ -2310,12 +3951,146 @@ ccache_tryload_misshit_chunk(void)
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
+	if (kds_old && munmap(kds_old, length) != 0)
+		elog(WARNING, "failed on munmap: %m");
+	heap_close(relation, NoLock);
 	/* update builder's state */
 	SpinLockAcquire(&ccache_state->lock);
 	ccache_builder->table_oid = InvalidOid;
 	ccache_builder->block_nr = InvalidBlockNumber;
 	SpinLockRelease(&ccache_state->lock);
 
+	if (retval)
+		elog(BUILDER_LOG,
+			 "ccache-builder%d: relation %u block_nr %u refreshed",
+			 ccache_builder->builder_id, table_oid, block_nr);
+	return retval;
+
+not_ready:
+	/* move to the tail, to give other stale chunks a chance */
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	if (cc_chunk->ctime == CCACHE_CTIME_STALE &&
+		cc_chunk->table_oid == table_oid &&
+		cc_chunk->block_nr == block_nr)
+	{
+		dlist_delete(&cc_chunk->lru_chain);
+		dlist_push_tail(&ccache_state->lru_stale_list, &cc_chunk->lru_chain);
+	}
+	SpinLockRelease(&ccache_state->chunks_lock);
+	heap_close(relation, NoLock);
+	return false;
+}
+
+/*
+ * ccache_tryload_hot_chunk - promotes a hot chunk to the in-memory tier
+ *
+ * It picks up the most recently referenced chunk which is not resident yet,
+ * then loads the ccache file onto a free slot of the hot tier. If no free
+ * slot is available, the resident chunk nearest to the tail of the LRU
+ * active list is demoted, unless it is more recently referenced than the
+ * candidate.
+ */
+static bool
+ccache_tryload_hot_chunk(void)
+{
+	ccacheChunk	   *cc_chunk = NULL;
+	ccacheChunk	   *cc_temp;
+	dlist_iter		iter;
+	dlist_iter		riter;
+	char			fname[MAXPGPATH];
+	char		   *hot_base;
+	cl_int			hot_slot;
+	Oid				table_oid;
+	BlockNumber		block_nr;
+	int				fdesc;
+	bool			retval = false;
+
+	if (ccache_num_hot_slots == 0)
+		return false;
+
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	dlist_foreach(iter, &ccache_state->lru_active_list)
+	{
+		cc_temp = dlist_container(ccacheChunk, lru_chain, iter.cur);
+		if (cc_temp->hot_slot == 0 &&
+			CCACHE_CTIME_IS_READY(cc_temp->ctime) &&
+			cc_temp->length <= CCACHE_CHUNK_SIZE)
+		{
+			cc_chunk = cc_temp;
+			break;
+		}
+	}
+	if (!cc_chunk)
+	{
+		SpinLockRelease(&ccache_state->chunks_lock);
+		return false;
+	}
+	/* demote a chilly chunk, if no free slot */
+	if (ccache_state->num_hot_free == 0)
+	{
+		dlist_reverse_foreach(riter, &ccache_state->lru_active_list)
+		{
+			cc_temp = dlist_container(ccacheChunk, lru_chain, riter.cur);
+			if (cc_temp == cc_chunk)
+				break;
+			/* resident, and nobody references */
+			if (cc_temp->hot_slot > 0 && cc_temp->refcnt == 1)
+			{
+				ccache_state->hot_free_slots[ccache_state->num_hot_free++]
+					= cc_temp->hot_slot;
+				cc_temp->hot_slot = 0;
+				break;
+			}
+		}
+		if (ccache_state->num_hot_free == 0)
+		{
+			SpinLockRelease(&ccache_state->chunks_lock);
+			return false;
+		}
+	}
+	hot_slot = ccache_state->hot_free_slots[--ccache_state->num_hot_free];
+	cc_chunk->hot_slot = -1;	/* promotion in-progress */
+	cc_chunk->refcnt++;
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	/* load the ccache file onto the hot tier */
+	hot_base = ccache_hot_buffer + (size_t)(hot_slot - 1) * CCACHE_CHUNK_SIZE;
+	ccache_chunk_filename(fname,
+						  cc_chunk->database_oid,
+						  cc_chunk->table_oid,
+						  cc_chunk->block_nr);
+	fdesc = openat(dirfd(ccache_base_dir), fname, O_RDONLY);
+	if (fdesc < 0)
+		elog(WARNING, "failed on openat('%s'): %m", fname);
+	else
+	{
+		if (pread(fdesc, hot_base, cc_chunk->length, 0) == cc_chunk->length)
+			retval = true;
+		else
+			elog(WARNING, "failed on pread('%s'): %m", fname);
+		close(fdesc);
+	}
+
+	SpinLockAcquire(&ccache_state->chunks_lock);
+	Assert(cc_chunk->hot_slot < 0);
+	if (retval && cc_chunk->hash_chain.next != NULL)
+		cc_chunk->hot_slot = hot_slot;
+	else
+	{
+		/* chunk was invalidated or failed on load, give back the slot */
+		cc_chunk->hot_slot = 0;
+		ccache_state->hot_free_slots[ccache_state->num_hot_free++] = hot_slot;
+		retval = false;
+	}
+	table_oid = cc_chunk->table_oid;
+	block_nr = cc_chunk->block_nr;
+	ccache_put_chunk_nolock(cc_chunk);
+	SpinLockRelease(&ccache_state->chunks_lock);
+
+	if (retval)
+		elog(BUILDER_LOG,
+			 "ccache-builder%d: table_oid %u block_nr %u is promoted to the hot tier",
+			 ccache_builder->builder_id, table_oid, block_nr);
 	return retval;
 }
 
@@ -2420,7 +4195,8 @@ ccache_tryload_one_chunk(Relation relation, BlockNumber block_nr)
 	SpinLockRelease(&ccache_state->chunks_lock);
 
 	/* try to load this chunk */
-	if (ccache_preload_chunk(cc_chunk, relation, cc_chunk->block_nr))
+	if (ccache_preload_chunk(cc_chunk, relation, cc_chunk->block_nr,
+							 NULL, NULL, NULL))
 		return 1;
 
 	/*
@@ -2430,6 +4206,125 @@ ccache_tryload_one_chunk(Relation relation, BlockNumber block_nr)
 	return 0;
 }
 
+/*
+ * ccache_tryload_hottest_chunks
+ *
+ * It tries to load chunks of the relations which had ccache misses,
+ * by the order of number of misses. Chunks already loaded or in-progress
+ * by other builders are skipped. Loading of a relation resumes from the
+ * chunk next to the one tried last time.
+ */
+static int
+ccache_tryload_hottest_chunks(int nchunks_atonce)
+{
+	cl_ulong	   *nmisses;
+	BlockNumber	   *scan_pos;
+	cl_int		   *order;
+	cl_int			num_rels;
+	cl_int			num_hot_rels = 0;
+	cl_int			i, j, k, rc;
+
+	if (!ccache_relations_oid)
+		return nchunks_atonce;
+	num_rels = ccache_relations_oid->dim1;
+	if (num_rels == 0)
+		return nchunks_atonce;
+
+	/* sort the relations by number of misses, using insertion sort */
+	nmisses = palloc(sizeof(cl_ulong) * num_rels);
+	scan_pos = palloc(sizeof(BlockNumber) * num_rels);
+	order = palloc(sizeof(cl_int) * num_rels);
+	for (j=0; j < num_rels; j++)
+	{
+		BlockNumber	pos;
+		cl_ulong	count
+			= ccache_lookup_relation_misshit(MyDatabaseId,
+											 ccache_relations_oid->values[j],
+											 &pos);
+		if (count == 0)
+			continue;
+		for (k = num_hot_rels; k > 0 && nmisses[k-1] < count; k--)
+		{
+			nmisses[k] = nmisses[k-1];
+			scan_pos[k] = scan_pos[k-1];
+			order[k] = order[k-1];
+		}
+		nmisses[k] = count;
+		scan_pos[k] = pos;
+		order[k] = j;
+		num_hot_rels++;
+	}
+
+	for (k=0; k < num_hot_rels && nchunks_atonce > 0; k++)
+	{
+		Relation	relation;
+		BlockNumber	nchunks;
+		BlockNumber	chunk_id = 0;
+
+		relation = heap_open(ccache_relations_oid->values[order[k]],
+							 AccessShareLock);
+		nchunks = RelationGetNumberOfBlocks(relation) / CCACHE_CHUNK_NBLOCKS;
+		rc = 0;
+		for (i=0; i < nchunks && nchunks_atonce > 0; i++)
+		{
+			BlockNumber	block_nr;
+
+			chunk_id = (scan_pos[k] + i) % nchunks;
+			block_nr = chunk_id * CCACHE_CHUNK_NBLOCKS;
+
+			PG_TRY();
+			{
+				/* update builder's state */
+				SpinLockAcquire(&ccache_state->lock);
+				ccache_builder->table_oid = RelationGetRelid(relation);
+				ccache_builder->block_nr = block_nr;
+				SpinLockRelease(&ccache_state->lock);
+
+				rc = ccache_tryload_one_chunk(relation, block_nr);
+			}
+			PG_CATCH();
+			{
+				/* update builder's state */
+				SpinLockAcquire(&ccache_state->lock);
+				ccache_builder->table_oid = InvalidOid;
+				ccache_builder->block_nr = InvalidBlockNumber;
+				SpinLockRelease(&ccache_state->lock);
+
+				PG_RE_THROW();
+			}
+			PG_END_TRY();
+
+			/* update builder's state */
+			SpinLockAcquire(&ccache_state->lock);
+			ccache_builder->table_oid = InvalidOid;
+			ccache_builder->block_nr = InvalidBlockNumber;
+			SpinLockRelease(&ccache_state->lock);
+
+			if (rc < 0)
+				break;	/* cannot continue to load any more */
+			if (rc > 0)
+				nchunks_atonce--;
+		}
+		/*
+		 * next try resumes from the chunk next to the last one, or from
+		 * the last one if it could not be loaded
+		 */
+		if (nchunks > 0)
+			ccache_update_relation_scanpos(MyDatabaseId,
+										   RelationGetRelid(relation),
+										   (rc < 0 ? chunk_id : chunk_id + 1)
+										   % nchunks);
+		heap_close(relation, NoLock);
+		if (rc < 0)
+			break;
+	}
+	pfree(nmisses);
+	pfree(scan_pos);
+	pfree(order);
+
+	return nchunks_atonce;
+}
+
 /*
  * ccache_tryload_chilly_chunks
  */
@@ -2632,7 +4527,8 @@ ccache_tryload_chilly_chunks(int nchunks_atonce)
 			ccache_builder->block_nr = cc_chunk->block_nr;
 			SpinLockRelease(&ccache_state->lock);
 
-			ccache_preload_chunk(cc_chunk, relation, cc_chunk->block_nr);
+			ccache_preload_chunk(cc_chunk, relation, cc_chunk->block_nr,
+								 NULL, NULL, NULL);
 
 			/* update builder's state */
 			SpinLockAcquire(&ccache_state->lock);
@@ -2808,8 +4704,16 @@ ccache_builder_main(Datum arg)
 				else
 					break;
 			}
+			/* incremental refresh of the stale chunks, if any */
+			while (nchunks_atonce > 0 && ccache_tryload_stale_chunk())
+				nchunks_atonce--;
+			if (nchunks_atonce > 0)
+				nchunks_atonce = ccache_tryload_hottest_chunks(nchunks_atonce);
 			if (nchunks_atonce > 0)
 				nchunks_atonce = ccache_tryload_chilly_chunks(nchunks_atonce);
+			/* promotion of the hot chunks, if any */
+			while (nchunks_atonce > 0 && ccache_tryload_hot_chunk())
+				nchunks_atonce--;
 			timeout = (nchunks_atonce == 0 ? 0 : 4000);
 
 			if (VisibilityMapBuffer != InvalidBuffer)
@@ -3008,7 +4912,8 @@ pgstrom_startup_ccache(void)
 	required = MAXALIGN(offsetof(ccacheState,
 								 builders[ccache_num_builders])) +
 		MAXALIGN(sizeof(dlist_head) * ccache_num_slots) +
-		MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks);
+		MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks) +
+		MAXALIGN(sizeof(cl_int) * ccache_num_hot_slots);
 	ccache_state = ShmemInitStruct("Columnar Cache Shared Segment",
 								   required, &found);
 	if (found)
@@ -3021,6 +4926,7 @@ pgstrom_startup_ccache(void)
 	SpinLockInit(&ccache_state->chunks_lock);
 	dlist_init(&ccache_state->lru_misshit_list);
 	dlist_init(&ccache_state->lru_active_list);
+	dlist_init(&ccache_state->lru_stale_list);
 	dlist_init(&ccache_state->free_chunks_list);
 	for (i=0; i < ccache_num_slots; i++)
 		dlist_init(&ccache_state->active_slots[i]);
@@ -3034,6 +4940,19 @@ pgstrom_startup_ccache(void)
 						&cc_chunk->hash_chain);
 		cc_chunk++;
 	}
+	/* free slots of the hot tier */
+	ccache_state->hot_free_slots = (cl_int *)cc_chunk;
+	for (i=0; i < ccache_num_hot_slots; i++)
+		ccache_state->hot_free_slots[i] = ccache_num_hot_slots - i;
+	ccache_state->num_hot_free = ccache_num_hot_slots;
+	if (ccache_num_hot_slots > 0)
+	{
+		ccache_hot_buffer = ShmemInitStruct("Columnar Cache Hot Tier",
+											(size_t)ccache_num_hot_slots *
+											CCACHE_CHUNK_SIZE, &found);
+		if (found)
+			elog(ERROR, "Bug? Columnar Cache Hot Tier is already built");
+	}
 	/* fields for management of builder processes */
 	SpinLockInit(&ccache_state->lock);
 
@@ -3086,6 +5005,7 @@ void
 pgstrom_init_ccache(void)
 {
 	static int	ccache_total_size_kb;
+	static int	ccache_hot_tier_size_kb;
 	int			ccache_total_size_default;
 	long		sc_pagesize = sysconf(_SC_PAGESIZE);
 	long		sc_phys_pages = sysconf(_SC_PHYS_PAGES);
@@ -3168,6 +5088,24 @@ pgstrom_init_ccache(void)
 							 guc_assign_ccache_log_output,
 							 guc_show_ccache_log_output);
 
+	DefineCustomBoolVariable("pg_strom.ccache_compression",
+							 "turn on/off bit-packing of ccache columns",
+							 NULL,
+							 &ccache_compression,
+							 false,
+							 PGC_POSTMASTER,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("pg_strom.ccache_mmap_load",
+							 "turn on/off memory-mapped load of ccache chunks",
+							 NULL,
+							 &ccache_mmap_load,
+							 true,
+							 PGC_SUSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
 	/* calculation of the default 'pg_strom.ccache_total_size' */
 	ccache_total_size_default =
 		Min((((3 * statbuf.f_blocks) / 4) * statbuf.f_bsize) >> 10,
@@ -3183,9 +5121,22 @@ pgstrom_init_ccache(void)
 							GUC_UNIT_KB,
 							NULL, NULL, NULL);
 
+	DefineCustomIntVariable("pg_strom.ccache_hot_tier_size",
+							"size of the in-memory hot tier of ccache",
+							NULL,
+							&ccache_hot_tier_size_kb,
+							0,
+							0,
+							INT_MAX,
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+
 	ccache_total_size = (size_t)ccache_total_size_kb << 10;
 	ccache_num_slots = Max(ccache_total_size / CCACHE_CHUNK_SIZE, 300);
 	ccache_num_chunks = 5 * ccache_num_slots;
+	ccache_hot_tier_size = (size_t)ccache_hot_tier_size_kb << 10;
+	ccache_num_hot_slots = ccache_hot_tier_size / CCACHE_CHUNK_SIZE;
 
 	/* bgworker registration */
 	for (i=0; i < ccache_num_builders; i++)
@@ -3208,8 +5159,12 @@ pgstrom_init_ccache(void)
 								 builders[ccache_num_builders])) +
 		MAXALIGN(sizeof(slock_t) * ccache_num_slots) +
 		MAXALIGN(sizeof(dlist_head) * ccache_num_slots) +
-		MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks);
+		MAXALIGN(sizeof(ccacheChunk) * ccache_num_chunks) +
+		MAXALIGN(sizeof(cl_int) * ccache_num_hot_slots);
 	RequestAddinShmemSpace(required);
+	if (ccache_num_hot_slots > 0)
+		RequestAddinShmemSpace((size_t)ccache_num_hot_slots *
+							   CCACHE_CHUNK_SIZE);
 
 	shmem_startup_next = shmem_startup_hook;
 	shmem_startup_hook = pgstrom_startup_ccache;
@@ -17,6 +17,8 @@
  */
 #include "pg_strom.h"
 #include "cuda_numeric.h"
+#include "cuda_textlib.h"
+#include "cuda_jsonlib.h"
 
 static MemoryContext	devinfo_memcxt;
 static bool		devtype_info_is_built;
@@ -189,6 +191,10 @@ static struct {
 				 NULL, NULL, NULL,
 				 DEVKERNEL_NEEDS_TEXTLIB, 0,
 				 generic_devtype_hashfunc),
+	DEVTYPE_DECL("jsonb",   "JSONBOID",   "varlena *",
+				 NULL, NULL, NULL,
+				 DEVKERNEL_NEEDS_JSONLIB, 0,
+				 generic_devtype_hashfunc),
 	/*
 	 * range types
 	 */
@@ -554,6 +560,8 @@ pg_range_devtype_hashfunc(devtype_info *dtype,
  * 'y' : this function needs cuda_misc.h
  * 'r' : this function needs cuda_rangetype.h
  * 'E' : this function needs cuda_time_extract.h
+ * 'v' : this function constructs a new varlena datum on the per-thread
+ *       varlena buffer (see kern_context_alloc)
  *
  * class character:
  * 'r' : right operator that takes an argument (deprecated)
@@ -1167,6 +1175,14 @@ static devfunc_catalog_t devfunc_common_catalog[] = {
 	{ "date_part", 2, {TEXTOID,TIMETZOID},      "stE/f:extract_timetz"},
 	{ "date_part", 2, {TEXTOID,TIMEOID},        "stE/f:extract_time"},
 
+	/* AT TIME ZONE with interval; see codegen_timezone_expression for text */
+	{ "timezone", 2, {INTERVALOID,TIMESTAMPTZOID}, "t/f:timestamptz_izone" },
+	{ "timezone", 2, {INTERVALOID,TIMESTAMPOID},   "t/f:timestamp_izone" },
+
+	/* date_trunc() */
+	{ "date_trunc", 2, {TEXTOID,TIMESTAMPOID},  "stE/f:date_trunc_timestamp"},
+	{ "date_trunc", 2, {TEXTOID,TIMESTAMPTZOID},"stE/f:date_trunc_timestamptz"},
+
 	/* other time and data functions */
 	{ "now", 0, {}, "t/f:now" },
 
@@ -1214,6 +1230,17 @@ static devfunc_catalog_t devfunc_common_catalog[] = {
 	{ "text_ge",   2, {TEXTOID, TEXTOID},     "sc/f:text_ge" },
 	{ "bttextcmp", 2, {TEXTOID, TEXTOID},     "sc/f:type_compare" },
 	{ "length",    1, {TEXTOID},              "sc/f:textlen" },
+	{ "char_length", 1, {TEXTOID},            "sc/f:textlen" },
+	{ "character_length", 1, {TEXTOID},       "sc/f:textlen" },
+	{ "octet_length", 1, {TEXTOID},           "s/f:textoctetlen" },
+	/* text functions that construct a new varlena datum */
+	{ "substring", 3, {TEXTOID, INT4OID, INT4OID}, "sv/f:text_substring" },
+	{ "substr",    3, {TEXTOID, INT4OID, INT4OID}, "sv/f:text_substring" },
+	{ "substring", 2, {TEXTOID, INT4OID},     "sv/f:text_substring_nolen" },
+	{ "substr",    2, {TEXTOID, INT4OID},     "sv/f:text_substring_nolen" },
+	{ "lower",     1, {TEXTOID},              "scv/f:lower" },
+	{ "upper",     1, {TEXTOID},              "scv/f:upper" },
+	{ "textcat",   2, {TEXTOID, TEXTOID},     "sv/f:textcat" },
 	/* LIKE operators */
 	{ "like",        2, {TEXTOID, TEXTOID},   "s/f:textlike" },
 	{ "textlike",    2, {TEXTOID, TEXTOID},   "s/f:textlike" },
@@ -1226,6 +1253,13 @@ static devfunc_catalog_t devfunc_common_catalog[] = {
 	{ "bpchariclike",  2, {TEXTOID, TEXTOID},   "sc/f:texticlike" },
 	{ "texticnlike",   2, {TEXTOID, TEXTOID},   "sc/f:texticnlike" },
 	{ "bpcharicnlike", 2, {BPCHAROID, TEXTOID}, "sc/f:texticnlike" },
+
+	/*
+	 * JSONB functions
+	 * ---------------------- */
+	{ "jsonb_exists",    2, {JSONBOID, TEXTOID},  "j/f:jsonb_exists" },
+	{ "jsonb_contains",  2, {JSONBOID, JSONBOID}, "j/f:jsonb_contains" },
+	{ "jsonb_contained", 2, {JSONBOID, JSONBOID}, "j/f:jsonb_contained" },
 };
 
 /*
@@ -1245,6 +1279,9 @@ typedef struct devfunc_extra_catalog_t {
 #define FLOAT4	"real"
 #define FLOAT8	"double precision"
 #define NUMERIC	"numeric"
+#define INTERVAL	"interval"
+#define TIMESTAMP	"timestamp without time zone"
+#define TIMESTAMPTZ	"timestamp with time zone"
 
 static devfunc_extra_catalog_t devfunc_extra_catalog[] = {
 	/* float2 - type cast functions */
@@ -1260,6 +1297,14 @@ static devfunc_extra_catalog_t devfunc_extra_catalog[] = {
 	{ FLOAT2,  "pgstrom.float2("INT4")",    "p/f:to_float2" },
 	{ FLOAT2,  "pgstrom.float2("INT8")",    "p/f:to_float2" },
 	{ FLOAT2,  "pgstrom.float2("NUMERIC")", "n/f:numeric_float2" },
+	/* numeric - fixed-point representation for GpuPreAgg */
+	{ INT8,    "pgstrom.numeric_fixed_int8("NUMERIC","INT4")",
+	  "n/f:numeric_fixed_int8" },
+	/* time_bucket - arbitrary width bucketing of timestamp[tz] */
+	{ TIMESTAMP,   "pgstrom.time_bucket("INTERVAL","TIMESTAMP")",
+	  "tE/f:time_bucket_timestamp" },
+	{ TIMESTAMPTZ, "pgstrom.time_bucket("INTERVAL","TIMESTAMPTZ")",
+	  "tE/f:time_bucket_timestamptz" },
 	/* float2 - type comparison functions */
 	{ BOOL,    "pgstrom.float2_eq("FLOAT2","FLOAT2")",  "p/f:float2eq" },
 	{ BOOL,    "pgstrom.float2_ne("FLOAT2","FLOAT2")",  "p/f:float2ne" },
@@ -1568,6 +1613,9 @@ static devfunc_extra_catalog_t devfunc_extra_catalog[] = {
 #undef FLOAT4
 #undef FLOAT8
 #undef NUMERIC
+#undef INTERVAL
+#undef TIMESTAMP
+#undef TIMESTAMPTZ
 
 static void
 __construct_devfunc_info(devfunc_info *entry,
@@ -1613,6 +1661,12 @@ __construct_devfunc_info(devfunc_info *entry,
 				case 'E':
 					flags |= DEVKERNEL_NEEDS_TIME_EXTRACT;
 					break;
+				case 'j':
+					flags |= DEVKERNEL_NEEDS_JSONLIB;
+					break;
+				case 'v':
+					entry->func_needs_vlbuf = true;
+					break;
 				default:
 					elog(NOTICE,
 						 "Bug? unkwnon devfunc property: %c",
@@ -2085,9 +2139,1389 @@ skip:
 /*
  * codegen_expression_walker - main logic of run-time code generator
  */
+static void codegen_expression_walker(Node *node, codegen_context *context);
 static void codegen_function_expression(devfunc_info *dfunc, List *args,
 										codegen_context *context);
 
+/*
+ * Regular expression support
+ * --------------------------
+ * Operators ~, ~*, !~ and !~* with a constant pattern are compiled into
+ * a DFA table (kern_regex_dfa) on the host side, then delivered to the
+ * device as a bytea parameter. Only a subset of the ARE syntax is handled
+ * here; literals, '.', bracket expressions, \d/\D, grouping, alternation,
+ * quantifiers (*, +, ?, {m,n}) and ^/$ anchors at the top level. Other
+ * patterns are not device executable, so CPU evaluates them as usual.
+ */
+#define REGEX_NFA_MAX_STATES	4000
+#define REGEX_DFA_MAX_STATES	256
+#define REGEX_DUPMAX			16
+
+typedef enum
+{
+	RENFA_BYTESET,		/* consumes a byte in bitmap, then out1 */
+	RENFA_SPLIT,		/* epsilon transition to out1 and out2 */
+	RENFA_ACCEPT_ANY,
+	RENFA_ACCEPT_EOS,
+} renfa_kind;
+
+typedef struct
+{
+	renfa_kind	kind;
+	int			out1;
+	int			out2;
+	cl_uint		bitmap[8];
+} renfa_state;
+
+typedef struct
+{
+	int			start;
+	int			end;		/* RENFA_SPLIT state with no out */
+} renfa_frag;
+
+typedef struct
+{
+	const unsigned char *pattern;
+	int			plen;
+	int			pos;
+	bool		icase;
+	int			encoding;
+	renfa_state *states;
+	int			nstates;
+} renfa_compiler;
+
+#define RENFA_CURR(c)		((c)->pos < (c)->plen ? (c)->pattern[(c)->pos] : 0)
+#define RENFA_EOF(c)		((c)->pos >= (c)->plen)
+#define RENFA_SETBIT(s,b)	((s)->bitmap[(b) >> 5] |= (1U << ((b) & 31)))
+#define RENFA_TESTBIT(s,b)	(((s)->bitmap[(b) >> 5] & (1U << ((b) & 31))) != 0)
+#define RENFA_FAILED		renfa_frag_make(-1, -1)
+#define RENFA_IS_FAILED(f)	((f).start < 0)
+
+static inline renfa_frag
+renfa_frag_make(int start, int end)
+{
+	renfa_frag	f;
+
+	f.start = start;
+	f.end = end;
+	return f;
+}
+
+static int
+renfa_new_state(renfa_compiler *c, renfa_kind kind)
+{
+	renfa_state *state;
+
+	if (c->nstates >= REGEX_NFA_MAX_STATES)
+		return -1;
+	state = &c->states[c->nstates];
+	memset(state, 0, sizeof(renfa_state));
+	state->kind = kind;
+	state->out1 = -1;
+	state->out2 = -1;
+	return c->nstates++;
+}
+
+static renfa_frag
+renfa_frag_empty(renfa_compiler *c)
+{
+	int		e = renfa_new_state(c, RENFA_SPLIT);
+
+	if (e < 0)
+		return RENFA_FAILED;
+	return renfa_frag_make(e, e);
+}
+
+/*
+ * renfa_frag_bytes - a fragment which consumes a byte in [lo..hi] or in
+ * the supplied bitmap (if not NULL)
+ */
+static renfa_frag
+renfa_frag_bytes(renfa_compiler *c, const cl_uint *bitmap, int lo, int hi)
+{
+	int		s = renfa_new_state(c, RENFA_BYTESET);
+	int		e = renfa_new_state(c, RENFA_SPLIT);
+	int		i;
+
+	if (s < 0 || e < 0)
+		return RENFA_FAILED;
+	if (bitmap)
+		memcpy(c->states[s].bitmap, bitmap, sizeof(cl_uint) * 8);
+	for (i=lo; i <= hi; i++)
+		RENFA_SETBIT(&c->states[s], i);
+	c->states[s].out1 = e;
+	return renfa_frag_make(s, e);
+}
+
+static renfa_frag
+renfa_frag_concat(renfa_compiler *c, renfa_frag a, renfa_frag b)
+{
+	if (RENFA_IS_FAILED(a) || RENFA_IS_FAILED(b))
+		return RENFA_FAILED;
+	c->states[a.end].out1 = b.start;
+	return renfa_frag_make(a.start, b.end);
+}
+
+static renfa_frag
+renfa_frag_alt(renfa_compiler *c, renfa_frag a, renfa_frag b)
+{
+	int		s, e;
+
+	if (RENFA_IS_FAILED(a) || RENFA_IS_FAILED(b))
+		return RENFA_FAILED;
+	s = renfa_new_state(c, RENFA_SPLIT);
+	e = renfa_new_state(c, RENFA_SPLIT);
+	if (s < 0 || e < 0)
+		return RENFA_FAILED;
+	c->states[s].out1 = a.start;
+	c->states[s].out2 = b.start;
+	c->states[a.end].out1 = e;
+	c->states[b.end].out1 = e;
+	return renfa_frag_make(s, e);
+}
+
+/* '*' if repeat, or '?' if not */
+static renfa_frag
+renfa_frag_option(renfa_compiler *c, renfa_frag a, bool repeat)
+{
+	int		s, e;
+
+	if (RENFA_IS_FAILED(a))
+		return RENFA_FAILED;
+	s = renfa_new_state(c, RENFA_SPLIT);
+	e = renfa_new_state(c, RENFA_SPLIT);
+	if (s < 0 || e < 0)
+		return RENFA_FAILED;
+	c->states[s].out1 = a.start;
+	c->states[s].out2 = e;
+	c->states[a.end].out1 = (repeat ? s : e);
+	return renfa_frag_make(s, e);
+}
+
+static renfa_frag
+renfa_frag_plus(renfa_compiler *c, renfa_frag a)
+{
+	int		s, e;
+
+	if (RENFA_IS_FAILED(a))
+		return RENFA_FAILED;
+	s = renfa_new_state(c, RENFA_SPLIT);
+	e = renfa_new_state(c, RENFA_SPLIT);
+	if (s < 0 || e < 0)
+		return RENFA_FAILED;
+	c->states[a.end].out1 = s;
+	c->states[s].out1 = a.start;
+	c->states[s].out2 = e;
+	return renfa_frag_make(a.start, e);
+}
+
+/*
+ * renfa_frag_charset - a fragment which consumes a character. @ascii is
+ * the set of ASCII characters; if @negative, any characters not in the
+ * set, including multibyte characters, are consumed.
+ */
+static renfa_frag
+renfa_frag_charset(renfa_compiler *c, const cl_uint *ascii, bool negative)
+{
+	cl_uint		bitmap[8];
+	renfa_frag	f;
+	int			i;
+
+	memset(bitmap, 0, sizeof(bitmap));
+	if (!negative)
+	{
+		memcpy(bitmap, ascii, sizeof(cl_uint) * 4);
+		return renfa_frag_bytes(c, bitmap, 1, 0);
+	}
+	for (i=0; i < 4; i++)
+		bitmap[i] = ~ascii[i];
+	if (pg_encoding_max_length(c->encoding) == 1)
+	{
+		/* every byte is a character */
+		for (i=4; i < 8; i++)
+			bitmap[i] = ~0U;
+		return renfa_frag_bytes(c, bitmap, 1, 0);
+	}
+	if (c->encoding != PG_UTF8)
+		return RENFA_FAILED;
+
+	/* ASCII or well-formed UTF-8 sequence */
+	f = renfa_frag_bytes(c, bitmap, 1, 0);
+	f = renfa_frag_alt(c, f,
+					   renfa_frag_concat(c,
+						   renfa_frag_bytes(c, NULL, 0xc2, 0xdf),
+						   renfa_frag_bytes(c, NULL, 0x80, 0xbf)));
+	f = renfa_frag_alt(c, f,
+					   renfa_frag_concat(c,
+						   renfa_frag_concat(c,
+							   renfa_frag_bytes(c, NULL, 0xe0, 0xef),
+							   renfa_frag_bytes(c, NULL, 0x80, 0xbf)),
+						   renfa_frag_bytes(c, NULL, 0x80, 0xbf)));
+	f = renfa_frag_alt(c, f,
+					   renfa_frag_concat(c,
+						   renfa_frag_concat(c,
+							   renfa_frag_concat(c,
+								   renfa_frag_bytes(c, NULL, 0xf0, 0xf4),
+								   renfa_frag_bytes(c, NULL, 0x80, 0xbf)),
+							   renfa_frag_bytes(c, NULL, 0x80, 0xbf)),
+						   renfa_frag_bytes(c, NULL, 0x80, 0xbf)));
+	return f;
+}
+
+static void
+renfa_ascii_setbit(renfa_compiler *c, cl_uint *ascii, int ch)
+{
+	Assert(ch >= 0 && ch < 0x80);
+	ascii[ch >> 5] |= (1U << (ch & 31));
+	/* case folding of ASCII characters, regardless of the locale */
+	if (c->icase && ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')))
+	{
+		ch ^= 0x20;
+		ascii[ch >> 5] |= (1U << (ch & 31));
+	}
+}
+
+/*
+ * renfa_parse_escape - returns the escaped ASCII character, 'd'/'D' for
+ * digit class, or -1 if not supported.
+ */
+static int
+renfa_parse_escape(renfa_compiler *c)
+{
+	int		ch;
+
+	Assert(RENFA_CURR(c) == '\\');
+	c->pos++;
+	if (RENFA_EOF(c))
+		return -1;
+	ch = c->pattern[c->pos++];
+	switch (ch)
+	{
+		case 'd':
+		case 'D':
+			return ch | 0x100;
+		case 't':
+			return '\t';
+		case 'n':
+			return '\n';
+		case 'r':
+			return '\r';
+		case 'f':
+			return '\f';
+		case 'v':
+			return '\v';
+		default:
+			/* other escapes have special meaning (\w, \y, \1, ...) */
+			if (ch >= 0x80 || isalnum(ch))
+				return -1;
+			return ch;
+	}
+}
+
+static renfa_frag
+renfa_parse_bracket(renfa_compiler *c)
+{
+	cl_uint		ascii[4];
+	bool		negative = false;
+	bool		first = true;
+
+	Assert(RENFA_CURR(c) == '[');
+	c->pos++;
+	memset(ascii, 0, sizeof(ascii));
+	if (RENFA_CURR(c) == '^')
+	{
+		negative = true;
+		c->pos++;
+	}
+	for (;;)
+	{
+		int		lo, hi;
+
+		if (RENFA_EOF(c))
+			return RENFA_FAILED;
+		lo = RENFA_CURR(c);
+		if (lo == ']' && !first)
+		{
+			c->pos++;
+			break;
+		}
+		first = false;
+		if (lo == '[' && c->pos + 1 < c->plen &&
+			(c->pattern[c->pos + 1] == ':' ||
+			 c->pattern[c->pos + 1] == '=' ||
+			 c->pattern[c->pos + 1] == '.'))
+			return RENFA_FAILED;	/* locale dependent classes */
+		if (lo == '\\')
+		{
+			lo = renfa_parse_escape(c);
+			if (lo < 0 || lo == ('D' | 0x100))
+				return RENFA_FAILED;
+			if (lo == ('d' | 0x100))
+			{
+				for (lo = '0'; lo <= '9'; lo++)
+					renfa_ascii_setbit(c, ascii, lo);
+				continue;
+			}
+		}
+		else
+			c->pos++;
+		if (lo >= 0x80)
+			return RENFA_FAILED;
+		hi = lo;
+		if (RENFA_CURR(c) == '-' &&
+			c->pos + 1 < c->plen && c->pattern[c->pos + 1] != ']')
+		{
+			c->pos++;
+			hi = RENFA_CURR(c);
+			if (hi == '\\')
+			{
+				hi = renfa_parse_escape(c);
+				if (hi < 0 || hi > 0xff)
+					return RENFA_FAILED;
+			}
+			else
+				c->pos++;
+			if (hi >= 0x80 || hi < lo)
+				return RENFA_FAILED;
+		}
+		while (lo <= hi)
+			renfa_ascii_setbit(c, ascii, lo++);
+	}
+	return renfa_frag_charset(c, ascii, negative);
+}
+
+static renfa_frag renfa_parse_alternative(renfa_compiler *c, int depth);
+
+static renfa_frag
+renfa_parse_atom(renfa_compiler *c, int depth)
+{
+	cl_uint		ascii[4];
+	renfa_frag	f;
+	int			ch = RENFA_CURR(c);
+
+	memset(ascii, 0, sizeof(ascii));
+	switch (ch)
+	{
+		case '(':
+			c->pos++;
+			if (RENFA_CURR(c) == '?')
+			{
+				/* only non-capturing group is supported */
+				if (c->pos + 1 >= c->plen || c->pattern[c->pos + 1] != ':')
+					return RENFA_FAILED;
+				c->pos += 2;
+			}
+			f = renfa_parse_alternative(c, depth + 1);
+			if (RENFA_CURR(c) != ')')
+				return RENFA_FAILED;
+			c->pos++;
+			return f;
+		case '.':
+			c->pos++;
+			return renfa_frag_charset(c, ascii, true);
+		case '[':
+			return renfa_parse_bracket(c);
+		case '\\':
+			ch = renfa_parse_escape(c);
+			if (ch < 0)
+				return RENFA_FAILED;
+			if ((ch & 0x100) != 0)
+			{
+				int		digit;
+
+				for (digit = '0'; digit <= '9'; digit++)
+					renfa_ascii_setbit(c, ascii, digit);
+				return renfa_frag_charset(c, ascii, (ch & 0xff) == 'D');
+			}
+			renfa_ascii_setbit(c, ascii, ch);
+			return renfa_frag_charset(c, ascii, false);
+		case '*':
+		case '+':
+		case '?':
+		case '{':
+		case ')':
+		case '^':
+		case '$':
+			return RENFA_FAILED;
+		default:
+			if (ch < 0x80)
+			{
+				c->pos++;
+				renfa_ascii_setbit(c, ascii, ch);
+				return renfa_frag_charset(c, ascii, false);
+			}
+			/* non-ASCII literal; no case folding here */
+			if (c->icase)
+				return RENFA_FAILED;
+			if (pg_encoding_max_length(c->encoding) == 1)
+			{
+				c->pos++;
+				return renfa_frag_bytes(c, NULL, ch, ch);
+			}
+			else if (c->encoding == PG_UTF8)
+			{
+				int		len = pg_utf_mblen(c->pattern + c->pos);
+
+				if (len < 2 || c->pos + len > c->plen)
+					return RENFA_FAILED;
+				f = renfa_frag_empty(c);
+				while (len-- > 0)
+				{
+					ch = c->pattern[c->pos++];
+					f = renfa_frag_concat(c, f,
+										  renfa_frag_bytes(c, NULL, ch, ch));
+				}
+				return f;
+			}
+			return RENFA_FAILED;
+	}
+}
+
+static int
+renfa_parse_number(renfa_compiler *c)
+{
+	int		num = -1;
+
+	while (!RENFA_EOF(c) && isdigit(RENFA_CURR(c)))
+	{
+		num = (num < 0 ? 0 : num * 10) + (RENFA_CURR(c) - '0');
+		if (num > REGEX_DUPMAX)
+			return -2;
+		c->pos++;
+	}
+	return num;
+}
+
+static renfa_frag
+renfa_parse_piece(renfa_compiler *c, int depth)
+{
+	int			atom_pos = c->pos;
+	int			n_min, n_max;
+	int			i, next_pos;
+	renfa_frag	atom;
+	renfa_frag	f;
+
+	atom = renfa_parse_atom(c, depth);
+	if (RENFA_IS_FAILED(atom))
+		return RENFA_FAILED;
+	switch (RENFA_CURR(c))
+	{
+		case '*':
+			c->pos++;
+			f = renfa_frag_option(c, atom, true);
+			break;
+		case '+':
+			c->pos++;
+			f = renfa_frag_plus(c, atom);
+			break;
+		case '?':
+			c->pos++;
+			f = renfa_frag_option(c, atom, false);
+			break;
+		case '{':
+			c->pos++;
+			n_min = renfa_parse_number(c);
+			if (n_min < 0)
+				return RENFA_FAILED;
+			n_max = n_min;
+			if (RENFA_CURR(c) == ',')
+			{
+				c->pos++;
+				n_max = renfa_parse_number(c);
+				if (n_max == -2 || (n_max >= 0 && n_max < n_min))
+					return RENFA_FAILED;
+			}
+			if (RENFA_CURR(c) != '}')
+				return RENFA_FAILED;
+			c->pos++;
+			next_pos = c->pos;
+			/*
+			 * Bounded repetition is expanded to copies of the atom; each
+			 * copy is constructed by re-parsing the atom.
+			 */
+			f = renfa_frag_empty(c);
+			for (i=0; i < (n_max < 0 ? n_min + 1 : n_max); i++)
+			{
+				renfa_frag	copy = atom;
+
+				if (i > 0)
+				{
+					c->pos = atom_pos;
+					copy = renfa_parse_atom(c, depth);
+				}
+				if (i >= n_min)
+					copy = renfa_frag_option(c, copy, n_max < 0);
+				f = renfa_frag_concat(c, f, copy);
+			}
+			c->pos = next_pos;
+			break;
+		default:
+			return atom;
+	}
+	/* non-greedy quantifier makes no difference on boolean result */
+	if (RENFA_CURR(c) == '?')
+		c->pos++;
+	/* ARE does not allow consecutive quantifiers */
+	if (RENFA_CURR(c) == '*' || RENFA_CURR(c) == '+' ||
+		RENFA_CURR(c) == '?' || RENFA_CURR(c) == '{')
+		return RENFA_FAILED;
+	return f;
+}
+
+static renfa_frag
+renfa_parse_branch(renfa_compiler *c, int depth,
+				   bool *p_anchor_head, bool *p_anchor_tail)
+{
+	renfa_frag	f = renfa_frag_empty(c);
+
+	if (RENFA_CURR(c) == '^' && depth == 0)
+	{
+		*p_anchor_head = true;
+		c->pos++;
+	}
+	while (!RENFA_EOF(c) &&
+		   RENFA_CURR(c) != '|' &&
+		   RENFA_CURR(c) != ')')
+	{
+		if (RENFA_CURR(c) == '$' && depth == 0)
+		{
+			c->pos++;
+			if (!RENFA_EOF(c) && RENFA_CURR(c) != '|')
+				return RENFA_FAILED;
+			*p_anchor_tail = true;
+			break;
+		}
+		f = renfa_frag_concat(c, f, renfa_parse_piece(c, depth));
+		if (RENFA_IS_FAILED(f))
+			return RENFA_FAILED;
+	}
+	return f;
+}
+
+static renfa_frag
+renfa_parse_alternative(renfa_compiler *c, int depth)
+{
+	renfa_frag	f;
+	bool		anchor_head = false;
+	bool		anchor_tail = false;
+
+	Assert(depth > 0);
+	f = renfa_parse_branch(c, depth, &anchor_head, &anchor_tail);
+	while (!RENFA_IS_FAILED(f) && RENFA_CURR(c) == '|')
+	{
+		c->pos++;
+		f = renfa_frag_alt(c, f, renfa_parse_branch(c, depth,
+													&anchor_head,
+													&anchor_tail));
+	}
+	return f;
+}
+
+/*
+ * renfa_closure - epsilon closure of the NFA states
+ */
+static Bitmapset *
+renfa_closure(renfa_compiler *c, Bitmapset *bms)
+{
+	List	   *pending = NIL;
+	int			k = -1;
+
+	while ((k = bms_next_member(bms, k)) >= 0)
+		pending = lappend_int(pending, k);
+	while (pending != NIL)
+	{
+		renfa_state *state = &c->states[linitial_int(pending)];
+
+		pending = list_delete_first(pending);
+		if (state->kind != RENFA_SPLIT)
+			continue;
+		if (state->out1 >= 0 && !bms_is_member(state->out1, bms))
+		{
+			bms = bms_add_member(bms, state->out1);
+			pending = lappend_int(pending, state->out1);
+		}
+		if (state->out2 >= 0 && !bms_is_member(state->out2, bms))
+		{
+			bms = bms_add_member(bms, state->out2);
+			pending = lappend_int(pending, state->out2);
+		}
+	}
+	return bms;
+}
+
+/*
+ * pgstrom_regex_dfa_compile
+ *
+ * It compiles the supplied regular expression into DFA, then returns
+ * a bytea datum of kern_regex_dfa, or NULL if pattern is not supported.
+ */
+static bytea *
+pgstrom_regex_dfa_compile(const char *pattern, int plen, bool icase)
+{
+	renfa_compiler c;
+	int			accept_any;
+	int			accept_eos;
+	int			start;
+	cl_uchar	classmap[256];
+	cl_uchar	classrep[256];
+	int			nclasses = 1;
+	List	   *dfa_states = NIL;
+	cl_ushort  *dfa_accept;
+	cl_ushort  *dfa_trans;
+	kern_regex_dfa *dfa;
+	bytea	   *result;
+	Size		len;
+	int			i, j, k;
+
+	/* ARE director and embedded options are not supported */
+	if (plen >= 3 && strncmp(pattern, "***", 3) == 0)
+		return NULL;
+
+	memset(&c, 0, sizeof(renfa_compiler));
+	c.pattern = (const unsigned char *)pattern;
+	c.plen = plen;
+	c.icase = icase;
+	c.encoding = GetDatabaseEncoding();
+	c.states = palloc(sizeof(renfa_state) * REGEX_NFA_MAX_STATES);
+
+	accept_any = renfa_new_state(&c, RENFA_ACCEPT_ANY);
+	accept_eos = renfa_new_state(&c, RENFA_ACCEPT_EOS);
+	start = -1;
+	for (;;)
+	{
+		renfa_frag	f;
+		bool		anchor_head = false;
+		bool		anchor_tail = false;
+
+		f = renfa_parse_branch(&c, 0, &anchor_head, &anchor_tail);
+		if (!anchor_head)
+		{
+			/* unanchored branch may start at any position */
+			renfa_frag	any = renfa_frag_bytes(&c, NULL, 0x00, 0xff);
+
+			f = renfa_frag_concat(&c, renfa_frag_option(&c, any, true), f);
+		}
+		if (RENFA_IS_FAILED(f))
+			goto unsupported;
+		c.states[f.end].out1 = (anchor_tail ? accept_eos : accept_any);
+		if (start < 0)
+			start = f.start;
+		else
+		{
+			int		s = renfa_new_state(&c, RENFA_SPLIT);
+
+			if (s < 0)
+				goto unsupported;
+			c.states[s].out1 = start;
+			c.states[s].out2 = f.start;
+			start = s;
+		}
+		if (RENFA_EOF(&c))
+			break;
+		if (RENFA_CURR(&c) != '|')
+			goto unsupported;	/* unbalanced ')' */
+		c.pos++;
+	}
+
+	/* byte equivalence classes */
+	memset(classmap, 0, sizeof(classmap));
+	for (i=0; i < c.nstates; i++)
+	{
+		renfa_state *state = &c.states[i];
+		int			remap[512];
+		int			count = 0;
+
+		if (state->kind != RENFA_BYTESET)
+			continue;
+		memset(remap, -1, sizeof(remap));
+		for (j=0; j < 256; j++)
+		{
+			k = 2 * classmap[j] + (RENFA_TESTBIT(state, j) ? 1 : 0);
+			if (remap[k] < 0)
+				remap[k] = count++;
+			classmap[j] = remap[k];
+		}
+		nclasses = count;
+	}
+	for (j=255; j >= 0; j--)
+		classrep[classmap[j]] = j;
+
+	/* subset construction */
+	dfa_accept = palloc0(sizeof(cl_ushort) * REGEX_DFA_MAX_STATES);
+	dfa_trans = palloc(sizeof(cl_ushort) * REGEX_DFA_MAX_STATES * nclasses);
+	dfa_states = list_make1(renfa_closure(&c, bms_make_singleton(start)));
+	for (i=0; i < list_length(dfa_states); i++)
+	{
+		Bitmapset  *curr = list_nth(dfa_states, i);
+
+		if (bms_is_member(accept_any, curr))
+			dfa_accept[i] |= KERN_REGEX_DFA_ACCEPT_ANY;
+		if (bms_is_member(accept_eos, curr))
+			dfa_accept[i] |= KERN_REGEX_DFA_ACCEPT_EOS;
+
+		for (j=0; j < nclasses; j++)
+		{
+			Bitmapset  *next = NULL;
+			ListCell   *lc;
+
+			dfa_trans[i * nclasses + j] = KERN_REGEX_DFA_DEAD;
+			/* no need to walk on any more once it matched */
+			if ((dfa_accept[i] & KERN_REGEX_DFA_ACCEPT_ANY) != 0)
+				continue;
+			k = -1;
+			while ((k = bms_next_member(curr, k)) >= 0)
+			{
+				renfa_state *state = &c.states[k];
+
+				if (state->kind == RENFA_BYTESET &&
+					RENFA_TESTBIT(state, classrep[j]))
+					next = bms_add_member(next, state->out1);
+			}
+			if (!next)
+				continue;
+			next = renfa_closure(&c, next);
+
+			k = 0;
+			foreach (lc, dfa_states)
+			{
+				if (bms_equal(next, lfirst(lc)))
+					break;
+				k++;
+			}
+			if (!lc)
+			{
+				if (list_length(dfa_states) >= REGEX_DFA_MAX_STATES)
+					goto unsupported;
+				dfa_states = lappend(dfa_states, next);
+			}
+			dfa_trans[i * nclasses + j] = k;
+		}
+	}
+
+	/* construct kern_regex_dfa */
+	k = list_length(dfa_states);
+	len = offsetof(kern_regex_dfa, data) + sizeof(cl_ushort) * k * (nclasses + 1);
+	result = palloc0(VARHDRSZ + len);
+	SET_VARSIZE(result, VARHDRSZ + len);
+	dfa = (kern_regex_dfa *) VARDATA(result);
+	dfa->nstates = k;
+	dfa->nclasses = nclasses;
+	memcpy(dfa->classmap, classmap, sizeof(classmap));
+	memcpy(dfa->data, dfa_accept, sizeof(cl_ushort) * k);
+	memcpy(dfa->data + k, dfa_trans, sizeof(cl_ushort) * k * nclasses);
+
+	return result;
+
+unsupported:
+	elog(DEBUG2, "regular expression is not supported on device: %.*s",
+		 plen, pattern);
+	return NULL;
+}
+
+/*
+ * pgstrom_devfunc_regex_lookup
+ *
+ * It checks whether the function invocation is a regular expression
+ * operator with constant pattern, then returns compiled DFA on the
+ * bytea Const node. Elsewhere, NULL shall be returned.
+ */
+static Const *
+pgstrom_devfunc_regex_lookup(Oid func_oid, List *args, bool *p_negative)
+{
+	Const	   *con;
+	bool		icase;
+	bool		negative;
+	text	   *pattern;
+	bytea	   *dfa;
+
+	switch (func_oid)
+	{
+		case F_TEXTREGEXEQ:
+			icase = false;
+			negative = false;
+			break;
+		case F_TEXTREGEXNE:
+			icase = false;
+			negative = true;
+			break;
+		case F_TEXTICREGEXEQ:
+			icase = true;
+			negative = false;
+			break;
+		case F_TEXTICREGEXNE:
+			icase = true;
+			negative = true;
+			break;
+		default:
+			return NULL;
+	}
+	if (list_length(args) != 2 ||
+		exprType(linitial(args)) != TEXTOID ||
+		!IsA(lsecond(args), Const))
+		return NULL;
+	con = lsecond(args);
+	if (con->consttype != TEXTOID || con->constisnull)
+		return NULL;
+
+	pattern = DatumGetTextPP(con->constvalue);
+	dfa = pgstrom_regex_dfa_compile(VARDATA_ANY(pattern),
+									VARSIZE_ANY_EXHDR(pattern),
+									icase);
+	if (!dfa)
+		return NULL;
+	if (p_negative)
+		*p_negative = negative;
+	return makeConst(BYTEAOID,
+					 -1,
+					 InvalidOid,
+					 -1,
+					 PointerGetDatum(dfa),
+					 false,
+					 false);
+}
+
+/*
+ * pgstrom_devfunc_like_fastpath
+ *
+ * It checks whether the function invocation is LIKE / NOT LIKE operator
+ * with a constant pattern that has '%' only at the head and/or the tail,
+ * like '%foo%'. In this case, device code can use a simple substring
+ * search (shift-and for short needles) instead of the generic recursive
+ * matcher, then returns kern_like_pattern on the bytea Const node.
+ */
+static Const *
+pgstrom_devfunc_like_fastpath(Oid func_oid, List *args, bool *p_negative)
+{
+	Const	   *con;
+	bool		negative;
+	text	   *pattern;
+	const char *p;
+	int			plen;
+	int			i = 0;
+	bool		lead_wildcard = false;
+	bool		tail_wildcard = false;
+	StringInfoData buf;
+	kern_like_pattern *lpat;
+	bytea	   *result;
+
+	if (func_oid == F_TEXTLIKE)
+		negative = false;
+	else if (func_oid == F_TEXTNLIKE)
+		negative = true;
+	else
+		return NULL;
+	if (list_length(args) != 2 ||
+		exprType(linitial(args)) != TEXTOID ||
+		!IsA(lsecond(args), Const))
+		return NULL;
+	con = lsecond(args);
+	if (con->consttype != TEXTOID || con->constisnull)
+		return NULL;
+
+	pattern = DatumGetTextPP(con->constvalue);
+	p = VARDATA_ANY(pattern);
+	plen = VARSIZE_ANY_EXHDR(pattern);
+
+	/* seek the fixed string surrounded by '%' */
+	initStringInfo(&buf);
+	enlargeStringInfo(&buf, offsetof(kern_like_pattern, needle) + plen);
+	buf.len = offsetof(kern_like_pattern, needle);
+	memset(buf.data, 0, buf.len);
+	while (i < plen && p[i] == '%')
+	{
+		lead_wildcard = true;
+		i++;
+	}
+	while (i < plen)
+	{
+		char	c = p[i++];
+
+		if (c == '%')
+		{
+			while (i < plen && p[i] == '%')
+				i++;
+			if (i < plen)
+				return NULL;	/* '%' in the middle */
+			tail_wildcard = true;
+			break;
+		}
+		else if (c == '_')
+			return NULL;
+		else if (c == '\\')
+		{
+			if (i >= plen)
+				return NULL;	/* let CPU raise an error */
+			c = p[i++];
+		}
+		appendStringInfoChar(&buf, c);
+	}
+	lpat = (kern_like_pattern *) buf.data;
+	lpat->nlen = buf.len - offsetof(kern_like_pattern, needle);
+	if (lead_wildcard && tail_wildcard)
+		lpat->mode = KERN_LIKE_PATTERN_SUBSTR;
+	else if (lead_wildcard)
+		lpat->mode = KERN_LIKE_PATTERN_SUFFIX;
+	else if (tail_wildcard)
+		lpat->mode = KERN_LIKE_PATTERN_PREFIX;
+	else
+		lpat->mode = KERN_LIKE_PATTERN_EXACT;
+
+	/*
+	 * Byte-wise search from the middle of the string is safe only if
+	 * character boundary is self-evident (UTF-8 or single byte encoding).
+	 */
+	if ((lpat->mode == KERN_LIKE_PATTERN_SUBSTR ||
+		 lpat->mode == KERN_LIKE_PATTERN_SUFFIX) &&
+		GetDatabaseEncoding() != PG_UTF8 &&
+		pg_database_encoding_max_length() != 1)
+		return NULL;
+
+	if (lpat->mode == KERN_LIKE_PATTERN_SUBSTR &&
+		lpat->nlen > 0 && lpat->nlen <= 32)
+	{
+		for (i=0; i < lpat->nlen; i++)
+			lpat->bitap[(cl_uchar)lpat->needle[i]] |= (1U << i);
+	}
+	result = palloc(VARHDRSZ + buf.len);
+	SET_VARSIZE(result, VARHDRSZ + buf.len);
+	memcpy(VARDATA(result), buf.data, buf.len);
+	pfree(buf.data);
+
+	if (p_negative)
+		*p_negative = negative;
+	return makeConst(BYTEAOID,
+					 -1,
+					 InvalidOid,
+					 -1,
+					 PointerGetDatum(result),
+					 false,
+					 false);
+}
+
+/*
+ * codegen_pattern_expression
+ *
+ * It writes out a device function call with the text argument and the
+ * pre-compiled pattern on bytea Const node.
+ */
+static void
+codegen_pattern_expression(const char *func_devname, Node *arg, Const *con,
+						   codegen_context *context)
+{
+	cl_uint		index;
+
+	if (!pgstrom_devtype_lookup_and_track(TEXTOID, context) ||
+		!pgstrom_devtype_lookup_and_track(BYTEAOID, context))
+		elog(ERROR, "codegen: failed to lookup text/bytea device types");
+	context->extra_flags |= DEVKERNEL_NEEDS_TEXTLIB;
+
+	appendStringInfo(&context->str, "pgfn_%s(kcxt, ", func_devname);
+	codegen_expression_walker(arg, context);
+
+	context->used_params = lappend(context->used_params, con);
+	index = list_length(context->used_params) - 1;
+	appendStringInfo(&context->str, ", KPARAM_%u)", index);
+	context->param_refs = bms_add_member(context->param_refs, index);
+}
+
+/*
+ * codegen_pattern_match_expression
+ *
+ * It tries to generate a pattern matching (~, LIKE and so on) with
+ * pre-compiled pattern. false shall be returned if not applicable.
+ */
+static bool
+codegen_pattern_match_expression(Oid func_oid, List *args,
+								 codegen_context *context)
+{
+	Const	   *con;
+	bool		negative;
+
+	con = pgstrom_devfunc_regex_lookup(func_oid, args, &negative);
+	if (con)
+	{
+		codegen_pattern_expression(negative
+								   ? "textregexne_dfa"
+								   : "textregexeq_dfa",
+								   linitial(args), con, context);
+		return true;
+	}
+	con = pgstrom_devfunc_like_fastpath(func_oid, args, &negative);
+	if (con)
+	{
+		codegen_pattern_expression(negative
+								   ? "textnlike_fastpath"
+								   : "textlike_fastpath",
+								   linitial(args), con, context);
+		return true;
+	}
+	return false;
+}
+
+/*
+ * pgstrom_timezone_name_hash
+ *
+ * hash of the canonical timezone name, to identify the session TimeZone
+ * on the device side; see assign_timelib_session_info.
+ */
+cl_uint
+pgstrom_timezone_name_hash(const char *tzname)
+{
+	return DatumGetUInt32(hash_any((const unsigned char *) tzname,
+								   strlen(tzname)));
+}
+
+/*
+ * pgstrom_devfunc_timezone_lookup
+ *
+ * It checks whether the function invocation is AT TIME ZONE with a
+ * constant zone name, then returns an int4 Const node to be passed to
+ * the device function instead of the zone name. Zones with a fixed UTC
+ * offset are replaced by the offset in seconds east of Greenwich.
+ * Zones with DST rules are replaced by hash of the zone name, only if
+ * it is the session TimeZone, because the transition table is shipped
+ * to the device for the session TimeZone only; @p_is_session is set.
+ */
+static Const *
+pgstrom_devfunc_timezone_lookup(Oid func_oid, List *args,
+								bool *p_to_local, bool *p_is_session)
+{
+	Const	   *con;
+	char		tzname[TZ_STRLEN_MAX + 1];
+	char	   *lowzone;
+	int			type;
+	int			val;
+	pg_tz	   *tzp;
+	long		gmtoff;
+	bool		to_local;
+	bool		is_session = false;
+	Datum		value;
+
+	if (func_oid == F_TIMESTAMPTZ_ZONE)
+		to_local = true;		/* timezone(text,timestamptz) */
+	else if (func_oid == F_TIMESTAMP_ZONE)
+		to_local = false;		/* timezone(text,timestamp) */
+	else
+		return NULL;
+	if (list_length(args) != 2 || !IsA(linitial(args), Const))
+		return NULL;
+	con = linitial(args);
+	if (con->consttype != TEXTOID || con->constisnull)
+		return NULL;
+
+	text_to_cstring_buffer(DatumGetTextPP(con->constvalue),
+						   tzname, sizeof(tzname));
+	lowzone = downcase_truncate_identifier(tzname, strlen(tzname), false);
+	type = DecodeTimezoneAbbrev(0, lowzone, &val, &tzp);
+	if (type == TZ || type == DTZ)
+		value = Int32GetDatum(val);
+	else if (type == DYNTZ)
+		return NULL;
+	else
+	{
+		tzp = pg_tzset(tzname);
+		if (!tzp)
+			return NULL;
+		if (pg_get_timezone_offset(tzp, &gmtoff))
+			value = Int32GetDatum((int32) gmtoff);
+		else if (strcmp(pg_get_timezone_name(tzp),
+						pg_get_timezone_name(session_timezone)) == 0)
+		{
+			value = Int32GetDatum((int32)
+					pgstrom_timezone_name_hash(pg_get_timezone_name(tzp)));
+			is_session = true;
+		}
+		else
+		{
+			elog(DEBUG2, "timezone '%s' is not supported on device", tzname);
+			return NULL;
+		}
+	}
+	if (p_to_local)
+		*p_to_local = to_local;
+	if (p_is_session)
+		*p_is_session = is_session;
+	return makeConst(INT4OID,
+					 -1,
+					 InvalidOid,
+					 sizeof(int32),
+					 value,
+					 false,
+					 true);
+}
+
+/*
+ * codegen_timezone_expression
+ *
+ * It tries to generate AT TIME ZONE with a constant zone name.
+ * false shall be returned if not applicable.
+ * Both of the UTC offset and the zone name hash are always passed as
+ * parameters, and one of them is NULL. So, the kernel source is identical
+ * regardless of the zone name, and the program cache is reusable.
+ */
+static bool
+codegen_timezone_expression(Oid func_oid, List *args,
+							codegen_context *context)
+{
+	Const	   *con;
+	Const	   *null_con;
+	bool		to_local;
+	bool		is_session;
+
+	con = pgstrom_devfunc_timezone_lookup(func_oid, args,
+										  &to_local, &is_session);
+	if (!con)
+		return false;
+
+	if (!pgstrom_devtype_lookup_and_track(TIMESTAMPOID, context) ||
+		!pgstrom_devtype_lookup_and_track(TIMESTAMPTZOID, context))
+		elog(ERROR, "codegen: failed to lookup timestamp device types");
+	context->extra_flags |= DEVKERNEL_NEEDS_TIMELIB;
+
+	null_con = makeNullConst(INT4OID, -1, InvalidOid);
+	appendStringInfo(&context->str, "pgfn_%s(kcxt, ",
+					 to_local ? "timestamptz_zone" : "timestamp_zone");
+	codegen_expression_walker((Node *)(is_session ? null_con : con), context);
+	appendStringInfoString(&context->str, ", ");
+	codegen_expression_walker((Node *)(is_session ? con : null_con), context);
+	appendStringInfoString(&context->str, ", ");
+	codegen_expression_walker(lsecond(args), context);
+	appendStringInfoChar(&context->str, ')');
+
+	return true;
+}
+
+
+/*
+ * jsonb_path_walker
+ *
+ * It walks down the chain of jsonb field extraction (->, ->>, #>, #>>)
+ * with constant keys, then appends kern_jsonb_path_item on @buf in the
+ * order from the root. @p_root shall be the jsonb expression at the root.
+ */
+static bool
+jsonb_path_walker(Node *node, bool as_text, Node **p_root,
+				  StringInfo buf, cl_uint *p_nitems)
+{
+	Oid			func_oid;
+	List	   *args = NIL;
+	Const	   *con;
+	kern_jsonb_path_item item;
+
+	if (IsA(node, FuncExpr))
+	{
+		func_oid = ((FuncExpr *) node)->funcid;
+		args = ((FuncExpr *) node)->args;
+	}
+	else if (IsA(node, OpExpr))
+	{
+		func_oid = get_opcode(((OpExpr *) node)->opno);
+		args = ((OpExpr *) node)->args;
+	}
+	else
+		func_oid = InvalidOid;
+
+	/* #> and #>> operators have their own pg_proc entries */
+	if ((as_text
+		 ? (func_oid != F_JSONB_OBJECT_FIELD_TEXT &&
+			func_oid != F_JSONB_ARRAY_ELEMENT_TEXT &&
+			func_oid != F_JSONB_EXTRACT_PATH_TEXT &&
+			func_oid != F_JSONB_EXTRACT_PATH_TEXT_OP)
+		 : (func_oid != F_JSONB_OBJECT_FIELD &&
+			func_oid != F_JSONB_ARRAY_ELEMENT &&
+			func_oid != F_JSONB_EXTRACT_PATH &&
+			func_oid != F_JSONB_EXTRACT_PATH_OP)))
+	{
+		/* the root jsonb expression */
+		if (as_text || exprType(node) != JSONBOID)
+			return false;
+		*p_root = node;
+		return true;
+	}
+	if (list_length(args) != 2 || !IsA(lsecond(args), Const))
+		return false;
+	con = lsecond(args);
+	if (con->constisnull)
+		return false;
+	if (!jsonb_path_walker(linitial(args), false, p_root, buf, p_nitems))
+		return false;
+
+	if (func_oid == F_JSONB_OBJECT_FIELD_TEXT ||
+		func_oid == F_JSONB_OBJECT_FIELD)
+	{
+		text   *key = DatumGetTextPP(con->constvalue);
+
+		memset(&item, 0, sizeof(item));
+		item.flags = KERN_JSONB_PATH_KEY;
+		item.keylen = VARSIZE_ANY_EXHDR(key);
+		appendBinaryStringInfo(buf, (char *)&item,
+							   offsetof(kern_jsonb_path_item, key));
+		appendBinaryStringInfo(buf, VARDATA_ANY(key), item.keylen);
+		(*p_nitems)++;
+	}
+	else if (func_oid == F_JSONB_ARRAY_ELEMENT_TEXT ||
+			 func_oid == F_JSONB_ARRAY_ELEMENT)
+	{
+		memset(&item, 0, sizeof(item));
+		item.flags = KERN_JSONB_PATH_INDEX;
+		item.index = DatumGetInt32(con->constvalue);
+		appendBinaryStringInfo(buf, (char *)&item,
+							   offsetof(kern_jsonb_path_item, key));
+		(*p_nitems)++;
+	}
+	else
+	{
+		Datum	   *elem_values;
+		bool	   *elem_isnull;
+		int			i, nelems;
+
+		deconstruct_array(DatumGetArrayTypeP(con->constvalue),
+						  TEXTOID, -1, false, 'i',
+						  &elem_values, &elem_isnull, &nelems);
+		/* result is always NULL if no path or any NULL elements */
+		if (nelems == 0)
+			return false;
+		for (i=0; i < nelems; i++)
+		{
+			text	   *key;
+			char	   *cstr;
+			char	   *end;
+			long		lindex;
+
+			if (elem_isnull[i])
+				return false;
+			key = DatumGetTextPP(elem_values[i]);
+			memset(&item, 0, sizeof(item));
+			item.flags = KERN_JSONB_PATH_KEY;
+			item.keylen = VARSIZE_ANY_EXHDR(key);
+			/* same logic in get_jsonb_path_all() */
+			cstr = text_to_cstring(key);
+			errno = 0;
+			lindex = strtol(cstr, &end, 10);
+			if (end != cstr && *end == '\0' && errno == 0 &&
+				lindex <= INT_MAX && lindex >= INT_MIN)
+			{
+				item.flags |= KERN_JSONB_PATH_INDEX;
+				item.index = (cl_int) lindex;
+			}
+			appendBinaryStringInfo(buf, (char *)&item,
+								   offsetof(kern_jsonb_path_item, key));
+			appendBinaryStringInfo(buf, VARDATA_ANY(key), item.keylen);
+			(*p_nitems)++;
+			/* alignment of the next item */
+			while (INTALIGN(buf->len) != buf->len)
+				appendStringInfoChar(buf, '\0');
+		}
+		return true;
+	}
+	while (INTALIGN(buf->len) != buf->len)
+		appendStringInfoChar(buf, '\0');
+	return true;
+}
+
+/*
+ * pgstrom_devfunc_jsonb_path_lookup
+ *
+ * It checks whether the function invocation is text comparison (= or <>)
+ * between the text extraction from jsonb (->> or #>>) with constant keys
+ * and another text expression, then returns kern_jsonb_path on the bytea
+ * Const node. The jsonb expression at the root and the other text
+ * expression are also returned.
+ */
+static Const *
+pgstrom_devfunc_jsonb_path_lookup(Oid func_oid, List *args,
+								  bool *p_negative,
+								  Node **p_jsonb, Node **p_text)
+{
+	StringInfoData buf;
+	cl_uint		nitems = 0;
+	Node	   *root;
+	Node	   *other;
+	bytea	   *result;
+	bool		negative;
+
+	if (func_oid == F_TEXTEQ)
+		negative = false;
+	else if (func_oid == F_TEXTNE)
+		negative = true;
+	else
+		return NULL;
+	if (list_length(args) != 2 ||
+		!pgstrom_devtype_lookup(JSONBOID))
+		return NULL;
+
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf, (char *)&nitems, sizeof(cl_uint));
+	if (jsonb_path_walker(linitial(args), true, &root, &buf, &nitems))
+		other = lsecond(args);
+	else
+	{
+		buf.len = sizeof(cl_uint);
+		nitems = 0;
+		if (!jsonb_path_walker(lsecond(args), true, &root, &buf, &nitems))
+			return NULL;
+		other = linitial(args);
+	}
+	((kern_jsonb_path *) buf.data)->nitems = nitems;
+
+	result = palloc(VARHDRSZ + buf.len);
+	SET_VARSIZE(result, VARHDRSZ + buf.len);
+	memcpy(VARDATA(result), buf.data, buf.len);
+	pfree(buf.data);
+
+	if (p_negative)
+		*p_negative = negative;
+	if (p_jsonb)
+		*p_jsonb = root;
+	if (p_text)
+		*p_text = other;
+	return makeConst(BYTEAOID,
+					 -1,
+					 InvalidOid,
+					 -1,
+					 PointerGetDatum(result),
+					 false,
+					 false);
+}
+
+/*
+ * codegen_jsonb_expression
+ */
+static bool
+codegen_jsonb_expression(Oid func_oid, List *args, codegen_context *context)
+{
+	Const	   *con;
+	Node	   *jsonb_arg;
+	Node	   *text_arg;
+	bool		negative;
+	cl_uint		index;
+
+	con = pgstrom_devfunc_jsonb_path_lookup(func_oid, args, &negative,
+											&jsonb_arg, &text_arg);
+	if (!con)
+		return false;
+
+	if (!pgstrom_devtype_lookup_and_track(JSONBOID, context) ||
+		!pgstrom_devtype_lookup_and_track(TEXTOID, context) ||
+		!pgstrom_devtype_lookup_and_track(BYTEAOID, context))
+		elog(ERROR, "codegen: failed to lookup jsonb/text/bytea device types");
+	context->extra_flags |= DEVKERNEL_NEEDS_JSONLIB;
+
+	appendStringInfo(&context->str, "pgfn_%s(kcxt, ",
+					 negative ? "jsonb_path_text_ne" : "jsonb_path_text_eq");
+	codegen_expression_walker(jsonb_arg, context);
+
+	context->used_params = lappend(context->used_params, con);
+	index = list_length(context->used_params) - 1;
+	appendStringInfo(&context->str, ", KPARAM_%u, ", index);
+	context->param_refs = bms_add_member(context->param_refs, index);
+
+	codegen_expression_walker(text_arg, context);
+	appendStringInfoChar(&context->str, ')');
+
+	return true;
+}
+
 static void
 codegen_expression_walker(Node *node, codegen_context *context)
 {
@@ -2098,6 +3532,23 @@ codegen_expression_walker(Node *node, codegen_context *context)
 	if (node == NULL)
 		return;
 
+	/* common subexpression already evaluated? */
+	if (context->cse_exprs != NIL &&
+		(IsA(node, FuncExpr) || IsA(node, OpExpr)))
+	{
+		int		index = 0;
+
+		foreach (cell, context->cse_exprs)
+		{
+			if (equal(node, lfirst(cell)))
+			{
+				appendStringInfo(&context->str, "CSE_%u", index);
+				return;
+			}
+			index++;
+		}
+	}
+
 	if (IsA(node, Const))
 	{
 		Const  *con = (Const *) node;
@@ -2201,6 +3652,11 @@ codegen_expression_walker(Node *node, codegen_context *context)
 	{
 		FuncExpr   *func = (FuncExpr *) node;
 
+		if (codegen_pattern_match_expression(func->funcid,
+											 func->args, context) ||
+			codegen_jsonb_expression(func->funcid, func->args, context) ||
+			codegen_timezone_expression(func->funcid, func->args, context))
+			return;
 		dfunc = pgstrom_devfunc_lookup(func->funcid,
 									   func->funcresulttype,
 									   func->args,
@@ -2216,6 +3672,11 @@ codegen_expression_walker(Node *node, codegen_context *context)
 	{
 		OpExpr	   *op = (OpExpr *) node;
 
+		if (codegen_pattern_match_expression(get_opcode(op->opno),
+											 op->args, context) ||
+			codegen_jsonb_expression(get_opcode(op->opno),
+									 op->args, context))
+			return;
 		dfunc = pgstrom_devfunc_lookup(get_opcode(op->opno),
 									   op->opresulttype,
 									   op->args,
@@ -2509,6 +3970,48 @@ codegen_expression_walker(Node *node, codegen_context *context)
 		elog(ERROR, "Bug? unsupported expression: %s", nodeToString(node));
 }
 
+/*
+ * devfunc_varlena_bufsz
+ *
+ * It estimates the size of varlena buffer to be consumed by the device
+ * function which constructs a new varlena datum. Length of the result is
+ * not larger than the total length of the varlena arguments, so we pick
+ * up the length of constant, or upper limit by the typmod if any.
+ * Elsewhere, DEVFUNC_VARLENA_BUFSZ_DEFAULT is assumed; longer values are
+ * evaluated by CPU.
+ * The buffer is consumed from the per-thread local memory, so function
+ * which may need more than DEVFUNC_VARLENA_BUFSZ_MAX is not offloaded, and
+ * total size of the buffer is also capped by DEVFUNC_VARLENA_BUFSZ_MAX.
+ * Rows that run out the buffer are evaluated by CPU.
+ */
+#define DEVFUNC_VARLENA_BUFSZ_DEFAULT	256
+#define DEVFUNC_VARLENA_BUFSZ_MAX		4096
+
+static cl_uint
+devfunc_varlena_bufsz(List *args)
+{
+	cl_uint		bufsz = VARHDRSZ;
+	ListCell   *lc;
+
+	foreach (lc, args)
+	{
+		Node	   *expr = lfirst(lc);
+		Oid			type_oid = exprType(expr);
+		int32		type_mod = exprTypmod(expr);
+
+		if (get_typlen(type_oid) != -1)
+			continue;
+		if (IsA(expr, Const) && !((Const *) expr)->constisnull)
+			bufsz += VARSIZE_ANY_EXHDR(((Const *) expr)->constvalue);
+		else if (type_mod >= VARHDRSZ)
+			bufsz += ((type_mod - VARHDRSZ) *
+					  pg_database_encoding_max_length());
+		else
+			bufsz += DEVFUNC_VARLENA_BUFSZ_DEFAULT;
+	}
+	return MAXALIGN(bufsz);
+}
+
 static void
 codegen_function_expression(devfunc_info *dfunc, List *args,
 							codegen_context *context)
@@ -2516,6 +4019,11 @@ codegen_function_expression(devfunc_info *dfunc, List *args,
 	ListCell   *lc1;
 	ListCell   *lc2;
 
+	if (dfunc->func_needs_vlbuf)
+		context->varlena_bufsz = Min(context->varlena_bufsz +
+									 devfunc_varlena_bufsz(args),
+									 DEVFUNC_VARLENA_BUFSZ_MAX);
+
 	appendStringInfo(&context->str,
 					 "pgfn_%s(kcxt",
 					 dfunc->func_devname);
@@ -2555,7 +4063,9 @@ pgstrom_codegen_expression(Node *expr, codegen_context *context)
 	walker_context.kds_label  = context->kds_label;
 	walker_context.kds_index_label = context->kds_index_label;
 	walker_context.extra_flags = context->extra_flags;
+	walker_context.varlena_bufsz = context->varlena_bufsz;
 	walker_context.pseudo_tlist = context->pseudo_tlist;
+	walker_context.cse_exprs = context->cse_exprs;
 
 	if (IsA(expr, List))
 	{
@@ -2584,10 +4094,144 @@ pgstrom_codegen_expression(Node *expr, codegen_context *context)
 	context->param_refs = walker_context.param_refs;
 	/* no need to write back xxx_label fields because read-only */
 	context->extra_flags = walker_context.extra_flags;
+	context->varlena_bufsz = walker_context.varlena_bufsz;
 
 	return walker_context.str.data;
 }
 
+/*
+ * common_subexprs_walker
+ *
+ * It counts number of the appearance of FuncExpr/OpExpr nodes in the
+ * post-order, and whether it is evaluated unconditionally, or not.
+ * Right hand of AND/OR (including implicit-AND list), and arguments of
+ * CASE/COALESCE and so on may not be evaluated, so it is not safe to evaluate them preliminary; it may
+ * raise an error that never happen on the CPU.
+ */
+typedef struct
+{
+	List	   *exprs;		/* candidate expressions */
+	List	   *counts;		/* number of the appearance */
+	Bitmapset  *uncond;		/* evaluated unconditionally */
+	bool		unconditional;
+} common_subexprs_context;
+
+static bool
+common_subexprs_walker(Node *node, common_subexprs_context *con)
+{
+	bool		unconditional = con->unconditional;
+	ListCell   *lc1, *lc2;
+	int			index = 0;
+
+	if (!node)
+		return false;
+	if (IsA(node, List) ||
+		(IsA(node, BoolExpr) &&
+		 ((BoolExpr *) node)->boolop != NOT_EXPR))
+	{
+		List   *args = (IsA(node, List)
+						? (List *) node
+						: ((BoolExpr *) node)->args);
+
+		foreach (lc1, args)
+		{
+			common_subexprs_walker(lfirst(lc1), con);
+			con->unconditional = false;
+		}
+		con->unconditional = unconditional;
+		return false;
+	}
+	if (!IsA(node, FuncExpr) &&
+		!IsA(node, OpExpr) &&
+		!IsA(node, ScalarArrayOpExpr) &&
+		!IsA(node, RelabelType) &&
+		!IsA(node, CoerceViaIO) &&
+		!IsA(node, NullTest) &&
+		!IsA(node, BooleanTest) &&
+		!IsA(node, BoolExpr))
+		con->unconditional = false;
+	expression_tree_walker(node, common_subexprs_walker, con);
+	con->unconditional = unconditional;
+
+	if ((!IsA(node, FuncExpr) && !IsA(node, OpExpr)) ||
+		contain_volatile_functions(node))
+		return false;
+
+	forboth (lc1, con->exprs,
+			 lc2, con->counts)
+	{
+		if (equal(node, lfirst(lc1)))
+		{
+			lfirst_int(lc2)++;
+			if (unconditional)
+				con->uncond = bms_add_member(con->uncond, index);
+			return false;
+		}
+		index++;
+	}
+	con->exprs = lappend(con->exprs, node);
+	con->counts = lappend_int(con->counts, 1);
+	if (unconditional)
+		con->uncond = bms_add_member(con->uncond, index);
+	return false;
+}
+
+/*
+ * pgstrom_codegen_common_subexprs
+ *
+ * It picks up device expressions that appear more than once in the @exprs
+ * and evaluated unconditionally at least once, then writes out declaration
+ * and evaluation of the CSE_%u variables. Later, pgstrom_codegen_expression()
+ * references these variables instead of the evaluation of the expression
+ * again, until caller resets context->cse_exprs.
+ * Elements of @exprs are evaluated unconditionally, in the order.
+ */
+char *
+pgstrom_codegen_common_subexprs(List *exprs, codegen_context *context)
+{
+	common_subexprs_context con;
+	StringInfoData	buf;
+	ListCell	   *lc1, *lc2;
+	int				index = 0;
+
+	initStringInfo(&buf);
+	memset(&con, 0, sizeof(common_subexprs_context));
+	foreach (lc1, exprs)
+	{
+		con.unconditional = true;
+		common_subexprs_walker(lfirst(lc1), &con);
+	}
+
+	/* inner expressions shall be evaluated first, by the post-order */
+	context->cse_exprs = NIL;
+	forboth (lc1, con.exprs,
+			 lc2, con.counts)
+	{
+		Node		   *expr = lfirst(lc1);
+		Oid				type_oid = exprType(expr);
+		devtype_info   *dtype;
+		char		   *code;
+
+		if (lfirst_int(lc2) > 1 && bms_is_member(index, con.uncond))
+		{
+			dtype = pgstrom_devtype_lookup(type_oid);
+			if (!dtype)
+				elog(ERROR, "Bug? device supported type is missing: %s",
+					 format_type_be(type_oid));
+			code = pgstrom_codegen_expression(expr, context);
+			appendStringInfo(
+				&buf,
+				"  pg_%s_t CSE_%u = %s;\n",
+				dtype->type_name,
+				list_length(context->cse_exprs),
+				code);
+			context->cse_exprs = lappend(context->cse_exprs, expr);
+		}
+		index++;
+	}
+	return buf.data;
+}
+
 /*
  * pgstrom_codegen_param_declarations
  */
@@ -2707,11 +4351,31 @@ __pgstrom_device_expression(Expr *expr, const char *filename, int lineno)
 	else if (IsA(expr, FuncExpr))
 	{
 		FuncExpr   *func = (FuncExpr *) expr;
-
-		if (!pgstrom_devfunc_lookup(func->funcid,
-									func->funcresulttype,
-									func->args,
-									func->inputcollid))
+		devfunc_info *dfunc;
+		Node	   *jsonb_arg;
+		Node	   *text_arg;
+
+		if (pgstrom_devfunc_regex_lookup(func->funcid, func->args, NULL))
+			return __pgstrom_device_expression(linitial(func->args),
+											   filename, lineno);
+		if (pgstrom_devfunc_jsonb_path_lookup(func->funcid, func->args, NULL,
+											  &jsonb_arg, &text_arg))
+			return (__pgstrom_device_expression((Expr *) jsonb_arg,
+												filename, lineno) &&
+					__pgstrom_device_expression((Expr *) text_arg,
+												filename, lineno));
+		if (pgstrom_devfunc_timezone_lookup(func->funcid, func->args,
+											NULL, NULL))
+			return __pgstrom_device_expression(lsecond(func->args),
+											   filename, lineno);
+		dfunc = pgstrom_devfunc_lookup(func->funcid,
+									   func->funcresulttype,
+									   func->args,
+									   func->inputcollid);
+		if (!dfunc)
+			goto unable_node;
+		if (dfunc->func_needs_vlbuf &&
+			devfunc_varlena_bufsz(func->args) > DEVFUNC_VARLENA_BUFSZ_MAX)
 			goto unable_node;
 		return __pgstrom_device_expression((Expr *) func->args,
 										   filename, lineno);
@@ -2719,11 +4383,27 @@ __pgstrom_device_expression(Expr *expr, const char *filename, int lineno)
 	else if (IsA(expr, OpExpr) || IsA(expr, DistinctExpr))
 	{
 		OpExpr	   *op = (OpExpr *) expr;
-
-		if (!pgstrom_devfunc_lookup(get_opcode(op->opno),
-									op->opresulttype,
-									op->args,
-									op->inputcollid))
+		devfunc_info *dfunc;
+		Node	   *jsonb_arg;
+		Node	   *text_arg;
+
+		if (pgstrom_devfunc_regex_lookup(get_opcode(op->opno), op->args, NULL))
+			return __pgstrom_device_expression(linitial(op->args),
+											   filename, lineno);
+		if (pgstrom_devfunc_jsonb_path_lookup(get_opcode(op->opno), op->args,
+											  NULL, &jsonb_arg, &text_arg))
+			return (__pgstrom_device_expression((Expr *) jsonb_arg,
+												filename, lineno) &&
+					__pgstrom_device_expression((Expr *) text_arg,
+												filename, lineno));
+		dfunc = pgstrom_devfunc_lookup(get_opcode(op->opno),
+									   op->opresulttype,
+									   op->args,
+									   op->inputcollid);
+		if (!dfunc)
+			goto unable_node;
+		if (dfunc->func_needs_vlbuf &&
+			devfunc_varlena_bufsz(op->args) > DEVFUNC_VARLENA_BUFSZ_MAX)
 			goto unable_node;
 		return __pgstrom_device_expression((Expr *) op->args,
 										   filename, lineno);
@@ -262,9 +262,17 @@ typedef uintptr_t		hostptr_t;
 #define StromKernel_gpupreagg_setup_column			0x0303
 #define StromKernel_gpupreagg_nogroup_reduction		0x0304
 #define StromKernel_gpupreagg_groupby_reduction		0x0305
+#define StromKernel_gpusort_topk_local				0x0401
 #define StromKernel_plcuda_prep_kernel				0x0501
 #define StromKernel_plcuda_main_kernel				0x0502
 #define StromKernel_plcuda_post_kernel				0x0503
+#define StromKernel_gpuwindow_setup					0x0601
+#define StromKernel_gpuwindow_scan_local			0x0602
+#define StromKernel_gpuwindow_scan_carry			0x0603
+#define StromKernel_gpuwindow_scan_final			0x0604
+#define StromKernel_gpucopy_count_lines				0x0701
+#define StromKernel_gpucopy_find_lines				0x0702
+#define StromKernel_gpucopy_parse_lines				0x0703
 
 #define KERN_ERRORBUF_FILENAME_LEN		24
 typedef struct
@@ -284,6 +292,9 @@ typedef struct
 {
 	kern_errorbuf	e;
 	struct kern_parambuf *kparams;
+	cl_char		   *vlbuf;		/* head of the varlena buffer, if any */
+	cl_char		   *vlpos;		/* current position of the varlena buffer */
+	cl_char		   *vlend;		/* tail of the varlena buffer */
 } kern_context;
 
 #define INIT_KERNEL_CONTEXT(kcxt,kfunction,__kparams)		\
@@ -293,9 +304,36 @@ typedef struct
 		(kcxt)->e.lineno = 0;								\
 		(kcxt)->e.filename[0] = '\0';						\
 		(kcxt)->kparams = (__kparams);						\
+		(kcxt)->vlbuf = NULL;								\
+		(kcxt)->vlpos = NULL;								\
+		(kcxt)->vlend = NULL;								\
 		assert((cl_ulong)(__kparams) == MAXALIGN(__kparams));	\
 	} while(0)
 
+/*
+ * Per-thread varlena buffer
+ *
+ * Device functions which construct a new varlena datum (like substring,
+ * lower or textcat) allocate the result on the varlena buffer attached to
+ * the kern_context. KERN_CONTEXT_VARLENA_BUFSZ is the required size per
+ * row estimated by the code generator, and defined by the session info.
+ * Kernel functions that evaluate expressions attach a buffer, then rewind
+ * it prior to the evaluation of each row.
+ * If no buffer is attached, or it runs out, device function raises
+ * StromError_CpuReCheck, then CPU evaluates the row again.
+ */
+#define DECL_KERNEL_VARLENA_BUFFER(NAME)						\
+	cl_char		NAME[Max(KERN_CONTEXT_VARLENA_BUFSZ, 1)]		\
+				__attribute__ ((aligned(MAXIMUM_ALIGNOF)))
+#define SETUP_KERNEL_VARLENA_BUFFER(kcxt,__vlbuf,__vlsize)		\
+	do {														\
+		(kcxt)->vlbuf = (cl_char *)(__vlbuf);					\
+		(kcxt)->vlpos = (cl_char *)(__vlbuf);					\
+		(kcxt)->vlend = (cl_char *)(__vlbuf) + (__vlsize);		\
+	} while(0)
+#define RESET_KERNEL_VARLENA_BUFFER(kcxt)						\
+	((kcxt)->vlpos = (kcxt)->vlbuf)
+
 /*
  * It sets an error code unless no significant error code is already set.
  * Also, CpuReCheck has higher priority than RowFiltered because CpuReCheck
@@ -335,6 +373,24 @@ __STROM_SET_ERROR(kern_errorbuf *p_kerror, cl_int errcode,
 	STROM_SET_ERROR((p_kerror), (errcode) == cudaSuccess ?				\
 					(cl_int)(errcode) :									\
 					(cl_int)(errcode) + StromError_CudaDevRunTimeBase)
+
+/*
+ * kern_context_alloc - allocation on the per-thread varlena buffer
+ */
+STATIC_INLINE(void *)
+kern_context_alloc(kern_context *kcxt, cl_uint length)
+{
+	cl_char	   *pos = (cl_char *)MAXALIGN(kcxt->vlpos);
+
+	if (!kcxt->vlbuf || pos + length > kcxt->vlend)
+	{
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		return NULL;
+	}
+	kcxt->vlpos = pos + length;
+	return pos;
+}
+
 /*
  * kern_writeback_error_status
  */
@@ -521,6 +577,21 @@ typedef struct {
 #define HEAP_COMBOCID			0x0020	/* t_cid is a combo cid */
 #define HEAP_XMAX_EXCL_LOCK		0x0040	/* xmax is exclusive locker */
 #define HEAP_XMAX_LOCK_ONLY		0x0080	/* xmax, if valid, is only a locker */
+#define HEAP_XMAX_SHR_LOCK		(HEAP_XMAX_EXCL_LOCK | HEAP_XMAX_KEYSHR_LOCK)
+#define HEAP_LOCK_MASK			(HEAP_XMAX_SHR_LOCK | HEAP_XMAX_EXCL_LOCK | \
+								 HEAP_XMAX_KEYSHR_LOCK)
+#define HEAP_XMIN_COMMITTED		0x0100	/* t_xmin committed */
+#define HEAP_XMIN_INVALID		0x0200	/* t_xmin invalid/aborted */
+#define HEAP_XMIN_FROZEN		(HEAP_XMIN_COMMITTED|HEAP_XMIN_INVALID)
+#define HEAP_XMAX_COMMITTED		0x0400	/* t_xmax committed */
+#define HEAP_XMAX_INVALID		0x0800	/* t_xmax invalid/aborted */
+#define HEAP_XMAX_IS_MULTI		0x1000	/* t_xmax is a MultiXactId */
+#define HEAP_UPDATED			0x2000	/* this is UPDATEd version of row */
+#define HEAP_MOVED_OFF			0x4000	/* moved to another place by pre-9.0
+										 * VACUUM FULL */
+#define HEAP_MOVED_IN			0x8000	/* moved from another place by pre-9.0
+										 * VACUUM FULL */
+#define HEAP_MOVED				(HEAP_MOVED_OFF | HEAP_MOVED_IN)
 
 /*
  * information stored in t_infomask2:
@@ -620,6 +691,8 @@ typedef struct {
 	/* (only column) total size of varlena body or NULL bitmap if attbyval;
 	 * because of the same reason, extra_sz shall be used with 3bits shift. */
 	cl_uint			extra_sz;
+	/* (only column) true, if values are bit-packed as kern_packed_column */
+	cl_uint			attpacked;
 } kern_colmeta;
 
 /*
@@ -663,6 +736,7 @@ typedef struct {
 	cl_char			format;		/* one of KDS_FORMAT_* above */
 	cl_char			has_notbyval; /* true, if any of column is !attbyval */
 	cl_char			tdhasoid;	/* copy of TupleDesc.tdhasoid */
+	cl_char			has_packed;	/* true, if any of column is bit-packed */
 	cl_uint			tdtypeid;	/* copy of TupleDesc.tdtypeid */
 	cl_int			tdtypmod;	/* copy of TupleDesc.tdtypmod */
 	cl_uint			table_oid;	/* OID of the table (only if GpuScan) */
@@ -674,6 +748,25 @@ typedef struct {
 	kern_colmeta	colmeta[FLEXIBLE_ARRAY_MEMBER]; /* metadata of columns */
 } kern_data_store;
 
+/*
+ * kern_packed_column - values array of a bit-packed column
+ *
+ * Fixed-length integer-like column of KDS_FORMAT_COLUMN can be saved using
+ * frame-of-reference; each value is stored as (value - base) with 'nbits'
+ * width in a series of 64bit words. The NULL bitmap, if any, follows the
+ * packed values as usual fixed-length column doing.
+ */
+typedef struct {
+	cl_long			base;		/* frame of reference (minimum value) */
+	cl_uint			nbits;		/* width of the packed values; 0-64 */
+	cl_uint			__padding__;
+	cl_ulong		values[FLEXIBLE_ARRAY_MEMBER];
+} kern_packed_column;
+
+#define KERN_PACKED_COLUMN_LENGTH(nbits,nitems)						\
+	MAXALIGN(offsetof(kern_packed_column,							\
+					  values[((size_t)(nbits) * (size_t)(nitems) + 63) >> 6]))
+
 /* attribute number of system columns */
 #define SelfItemPointerAttributeNumber			(-1)
 #define ObjectIdAttributeNumber					(-2)
@@ -1270,7 +1363,8 @@ typedef struct varatt_external
 
 typedef struct varatt_indirect
 {
-	hostptr_t	pointer;	/* Host pointer to in-memory varlena */
+	hostptr_t	pointer;	/* Host pointer to in-memory varlena; or
+							 * device pointer if kern_parambuf */
 } varatt_indirect;
 
 #define VARTAG_SIZE(tag) \
@@ -1569,6 +1663,10 @@ toast_decompress_datum(char *buffer, cl_uint buflen,
 		{														\
 			varlena *vl_val = (varlena *)						\
 				((char *)kparams + kparams->poffset[param_id]);	\
+			/* indirect reference to the device memory */		\
+			if (VARATT_IS_EXTERNAL_INDIRECT(vl_val))			\
+				vl_val = (varlena *)((varatt_indirect *)		\
+					((varattrib_1b_e *)vl_val)->va_data)->pointer; \
 			if (VARATT_IS_4B_U(vl_val) || VARATT_IS_1B(vl_val))	\
 			{													\
 				result.value = vl_val;							\
@@ -1688,6 +1786,68 @@ STROMCL_VARLENA_TYPE_TEMPLATE(bytea)
 
 #define EXTRACT_HEAP_TUPLE_END()										\
 	} while(0)
+
+/*
+ * Macro to extract a heap-tuple with known attributes
+ *
+ * usage:
+ * EXTRACT_HEAP_TUPLE_BEGIN_SPEC(kds, htup)
+ *  -> no field is fetched yet
+ * EXTRACT_HEAP_TUPLE_FIXED(addr, colidx, offset)
+ *  -> addr shall point the field at the fixed offset, or NULL if tuple has
+ *     no such column. Only available for the leading fixed-length and
+ *     NOT NULL columns.
+ * EXTRACT_HEAP_TUPLE_SEEK(colidx, offset)
+ *  -> moves to the end of the leading @colidx columns at the @offset
+ * EXTRACT_HEAP_TUPLE_NEXT_SPEC(addr, attlen, attalign, notnull)
+ *  -> addr shall point the next field, or NULL
+ *     :
+ * EXTRACT_HEAP_TUPLE_END()
+ *
+ * Code generator knows attlen/attalign/notnull of the columns, so it does
+ * not need to walk on the colmeta array nor check null-bitmap of NOT NULL
+ * columns at run-time.
+ */
+#define EXTRACT_HEAP_TUPLE_BEGIN_SPEC(kds, htup)						\
+	do {																\
+		const HeapTupleHeaderData * __restrict__ __htup = (htup);		\
+		cl_uint			__colidx = ~0U;	/* next column is the first */	\
+		cl_uint			__ncols = 0;									\
+		cl_bool			__heap_hasnull = false;							\
+		char		   *__base = NULL;									\
+		char		   *__pos = NULL;									\
+																		\
+		if (__htup)														\
+		{																\
+			__heap_hasnull = ((__htup->t_infomask & HEAP_HASNULL) != 0); \
+			__ncols = min(__ldg(&(kds)->ncols),							\
+						  __htup->t_infomask2 & HEAP_NATTS_MASK);		\
+			__base = __pos = (char *)(__htup) + __htup->t_hoff;			\
+			assert(__pos == (char *)MAXALIGN(__pos));					\
+		}
+
+#define EXTRACT_HEAP_TUPLE_FIXED(ADDR, COLIDX, OFFSET)					\
+		(ADDR) = ((COLIDX) < __ncols ? __base + (OFFSET) : NULL)
+
+#define EXTRACT_HEAP_TUPLE_SEEK(COLIDX, OFFSET)							\
+		__colidx = (COLIDX) - 1;										\
+		__pos = __base + (OFFSET)
+
+#define EXTRACT_HEAP_TUPLE_NEXT_SPEC(ADDR, ATTLEN, ATTALIGN, NOTNULL)	\
+		__colidx++;														\
+		if (__colidx < __ncols &&										\
+			((NOTNULL) || !__heap_hasnull ||							\
+			 !att_isnull(__colidx, __htup->t_bits)))					\
+		{																\
+			if ((ATTLEN) > 0)											\
+				__pos = (char *)TYPEALIGN((ATTALIGN), __pos);			\
+			else if (!VARATT_NOT_PAD_BYTE(__pos))						\
+				__pos = (char *)TYPEALIGN((ATTALIGN), __pos);			\
+			(ADDR) = __pos;												\
+			__pos += ((ATTLEN) > 0 ? (ATTLEN) : VARSIZE_ANY(__pos));	\
+		}																\
+		else															\
+			(ADDR) = NULL
 #endif	/* __CUDACC__ */
 
 /*
@@ -1814,6 +1974,8 @@ kern_get_datum_column(kern_data_store *kds,
 	if (offset == 0)
 		return NULL;
 	values = (char *)kds + offset;
+	/* bit-packed column must be fetched by kern_get_packed_column() */
+	Assert(!__ldg(&cmeta->attpacked));
 	if (__ldg(&cmeta->attlen) < 0)
 	{
 		Assert(!__ldg(&cmeta->attbyval));
@@ -1841,6 +2003,54 @@ kern_get_datum_column(kern_data_store *kds,
 	return (void *)values;
 }
 
+/*
+ * kern_get_packed_column
+ *
+ * It fetches a value of the bit-packed column; returns false if NULL.
+ */
+STATIC_INLINE(cl_bool)
+kern_get_packed_column(kern_data_store *kds,
+					   cl_uint colidx, cl_uint rowidx,
+					   cl_long *p_value)
+{
+	kern_colmeta *cmeta = &kds->colmeta[colidx];
+	kern_packed_column *pack;
+	size_t		offset;
+	cl_uint		nbits;
+	cl_ulong	bitpos;
+	cl_uint		shift;
+	cl_ulong	value;
+
+	Assert(colidx < kds->ncols && __ldg(&cmeta->attpacked));
+	offset = __ldg(&cmeta->va_offset) << MAXIMUM_ALIGNOF_SHIFT;
+	if (offset == 0)
+		return false;
+	pack = (kern_packed_column *)((char *)kds + offset);
+	nbits = __ldg(&pack->nbits);
+	if (__ldg(&cmeta->extra_sz) > 0)
+	{
+		char   *nullmap = ((char *)pack +
+						   KERN_PACKED_COLUMN_LENGTH(nbits,
+													 __ldg(&kds->nitems)));
+		if (att_isnull(rowidx, nullmap))
+			return false;
+	}
+	if (nbits == 0)
+		value = 0;
+	else
+	{
+		bitpos = (cl_ulong)rowidx * (cl_ulong)nbits;
+		shift = (bitpos & 63);
+		value = (__ldg(&pack->values[bitpos >> 6]) >> shift);
+		if (shift + nbits > 64)
+			value |= (__ldg(&pack->values[(bitpos >> 6) + 1]) << (64 - shift));
+		if (nbits < 64)
+			value &= ((1UL << nbits) - 1);
+	}
+	*p_value = __ldg(&pack->base) + (cl_long)value;
+	return true;
+}
+
 STATIC_INLINE(void *)
 kern_get_datum(kern_data_store *kds,
 			   cl_uint colidx, cl_uint rowidx)
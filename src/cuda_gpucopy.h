@@ -0,0 +1,654 @@
+/*
+ * cuda_gpucopy.h
+ *
+ * CUDA device code specific to GPU accelerated COPY FROM (CSV)
+ * --
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef CUDA_GPUCOPY_H
+#define CUDA_GPUCOPY_H
+
+/*
+ * Kind of columns parsed by GPU. GPUCOPY_KIND__CPU means GPU only locates
+ * the field, then CPU calls the input function of the data type.
+ */
+#define GPUCOPY_KIND__CPU			0
+#define GPUCOPY_KIND__BOOL			1
+#define GPUCOPY_KIND__INT2			2
+#define GPUCOPY_KIND__INT4			3
+#define GPUCOPY_KIND__INT8			4
+#define GPUCOPY_KIND__FLOAT4		5
+#define GPUCOPY_KIND__FLOAT8		6
+#define GPUCOPY_KIND__DATE			7
+#define GPUCOPY_KIND__TIMESTAMP		8
+
+/* number of bytes to be scanned by a thread, to find out the newlines */
+#define GPUCOPY_BYTES_PER_THREAD	32
+
+/*
+ * kern_copyfield - location of the field for GPUCOPY_KIND__CPU. If the
+ * field is quoted and contains escaped quotes (""), GPUCOPY_FIELD_ESCAPED
+ * is set on the @length.
+ */
+typedef struct
+{
+	cl_uint		offset;		/* offset from the head of text */
+	cl_uint		length;		/* length of the field */
+} kern_copyfield;
+
+#define GPUCOPY_FIELD_ESCAPED		0x80000000U
+
+typedef struct
+{
+	cl_char		kind;			/* one of GPUCOPY_KIND__* */
+	cl_char		unitsz;			/* width of the values */
+	cl_uint		values_offset;	/* offset of the values from the results */
+	cl_uint		nullmap_offset;	/* offset of the nullmap from the results;
+								 * bit is set if not null */
+} kern_copycolumn;
+
+/*
+ * kern_gpucopy
+ *
+ * +-----------------+
+ * | kern_gpucopy    |
+ * | +---------------+
+ * | | kern_errbuf   |
+ * | +---------------+
+ * | | colmeta[0]    |
+ * | |     :         |
+ * | | colmeta[N-1]  |
+ * +-+---------------+ <-- KERN_GPUCOPY_TEXT()
+ * | text buffer     |
+ * |  (CSV lines,    |
+ * |   ends with LF) |
+ * +-----------------+
+ *
+ * The results buffer, allocated once number of lines is fixed, has the
+ * positions of the newlines (nitems x cl_uint), values and nullmap of each
+ * column, then the row flags (nitems x cl_char). Non-zero row flag means
+ * GPU could not parse the line, so CPU will parse it again.
+ */
+struct kern_gpucopy {
+	kern_errorbuf	kerror;
+	cl_uint			length;		/* length of the text buffer */
+	cl_uint			nitems;		/* number of the lines */
+	cl_uint			row_flags_offset; /* offset of the row flags */
+	cl_uint			ncols;		/* number of the columns */
+	cl_char			delimiter;	/* field delimiter */
+	kern_copycolumn	colmeta[FLEXIBLE_ARRAY_MEMBER];
+};
+typedef struct kern_gpucopy		kern_gpucopy;
+
+#define KERN_GPUCOPY_HEAD_LENGTH(ncols)					\
+	STROMALIGN(offsetof(kern_gpucopy, colmeta[(ncols)]))
+#define KERN_GPUCOPY_TEXT(kcopy)						\
+	((char *)(kcopy) + KERN_GPUCOPY_HEAD_LENGTH((kcopy)->ncols))
+#define KERN_GPUCOPY_LENGTH(kcopy)						\
+	(KERN_GPUCOPY_HEAD_LENGTH((kcopy)->ncols) + (kcopy)->length)
+
+#ifdef __CUDACC__
+/*
+ * gpucopy_next_field
+ *
+ * It fetches the next field of the CSV line, then moves @p_pos to the
+ * delimiter or the end of line. It returns false if the field is broken,
+ * like unterminated quoted field.
+ */
+STATIC_FUNCTION(cl_bool)
+gpucopy_next_field(const char *text, cl_uint *p_pos, cl_uint end,
+				   cl_char delimiter,
+				   cl_uint *p_head, cl_uint *p_len,
+				   cl_bool *p_quoted, cl_bool *p_escaped)
+{
+	cl_uint		pos = *p_pos;
+
+	*p_quoted = false;
+	*p_escaped = false;
+	if (pos < end && text[pos] == '"')
+	{
+		*p_quoted = true;
+		*p_head = ++pos;
+		for (;;)
+		{
+			if (pos >= end)
+				return false;		/* unterminated quoted field */
+			if (text[pos] == '"')
+			{
+				if (pos + 1 < end && text[pos + 1] == '"')
+				{
+					*p_escaped = true;
+					pos += 2;
+					continue;
+				}
+				break;
+			}
+			pos++;
+		}
+		*p_len = pos - *p_head;
+		pos++;
+		/* only delimiter or end of line is allowed after the quote */
+		if (pos < end && text[pos] != delimiter)
+			return false;
+	}
+	else
+	{
+		*p_head = pos;
+		while (pos < end && text[pos] != delimiter)
+		{
+			if (text[pos] == '"')
+				return false;		/* let CPU report the error */
+			pos++;
+		}
+		*p_len = pos - *p_head;
+	}
+	*p_pos = pos;
+	return true;
+}
+
+/*
+ * gpucopy_trim_spaces - removes leading and trailing white-spaces
+ */
+STATIC_INLINE(void)
+gpucopy_trim_spaces(const char *text, cl_uint *p_head, cl_uint *p_len)
+{
+	cl_uint		head = *p_head;
+	cl_uint		tail = *p_head + *p_len;
+
+	while (head < tail && (text[head] == ' ' || text[head] == '\t'))
+		head++;
+	while (head < tail && (text[tail-1] == ' ' || text[tail-1] == '\t'))
+		tail--;
+	*p_head = head;
+	*p_len = tail - head;
+}
+
+/*
+ * gpucopy_parse_int - parses an integer within [min_value, max_value]
+ */
+STATIC_FUNCTION(cl_bool)
+gpucopy_parse_int(const char *text, cl_uint head, cl_uint len,
+				  cl_long min_value, cl_long max_value, cl_long *p_value)
+{
+	cl_uint		pos;
+	cl_uint		end;
+	cl_bool		neg = false;
+	cl_ulong	limit;
+	cl_ulong	value = 0;
+	cl_uint		d;
+
+	gpucopy_trim_spaces(text, &head, &len);
+	pos = head;
+	end = head + len;
+	if (pos < end && (text[pos] == '-' || text[pos] == '+'))
+		neg = (text[pos++] == '-');
+	if (pos >= end)
+		return false;
+	limit = (neg ? (cl_ulong)(-(min_value + 1)) + 1 : (cl_ulong)max_value);
+	while (pos < end)
+	{
+		if (text[pos] < '0' || text[pos] > '9')
+			return false;
+		d = text[pos++] - '0';
+		if (value > (limit - d) / 10)
+			return false;			/* out of range */
+		value = value * 10 + d;
+	}
+	*p_value = (neg ? (cl_long)(0UL - value) : (cl_long)value);
+	return true;
+}
+
+/*
+ * gpucopy_parse_float
+ *
+ * It parses a decimal number only if it is exactly representable by the
+ * fast path; mantissa up to 2^53 and the exponent within 10^[-22..22],
+ * because both of them are exact in double and a single multiplication
+ * or division gives the correctly rounded result, same as strtod().
+ * Elsewhere, CPU parses the line again.
+ */
+STATIC_FUNCTION(cl_bool)
+gpucopy_parse_float(const char *text, cl_uint head, cl_uint len,
+					cl_double *p_value)
+{
+	cl_uint		pos;
+	cl_uint		end;
+	cl_bool		neg = false;
+	cl_bool		has_digits = false;
+	cl_ulong	mantissa = 0;
+	cl_int		ndigits = 0;
+	cl_int		exp10 = 0;
+	cl_double	value;
+	cl_double	scale;
+	cl_int		i;
+
+	gpucopy_trim_spaces(text, &head, &len);
+	pos = head;
+	end = head + len;
+	if (pos < end && (text[pos] == '-' || text[pos] == '+'))
+		neg = (text[pos++] == '-');
+	/* integer part */
+	while (pos < end && text[pos] >= '0' && text[pos] <= '9')
+	{
+		has_digits = true;
+		if (mantissa > 0 || text[pos] != '0')
+		{
+			if (++ndigits > 19)
+				return false;
+			mantissa = mantissa * 10 + (text[pos] - '0');
+		}
+		pos++;
+	}
+	/* fraction part */
+	if (pos < end && text[pos] == '.')
+	{
+		pos++;
+		while (pos < end && text[pos] >= '0' && text[pos] <= '9')
+		{
+			has_digits = true;
+			if (mantissa > 0 || text[pos] != '0')
+			{
+				if (++ndigits > 19)
+					return false;
+				mantissa = mantissa * 10 + (text[pos] - '0');
+			}
+			exp10--;
+			pos++;
+		}
+	}
+	if (!has_digits)
+		return false;		/* including NaN and Infinity */
+	/* exponent part */
+	if (pos < end && (text[pos] == 'e' || text[pos] == 'E'))
+	{
+		cl_bool		exp_neg = false;
+		cl_int		exp_value = 0;
+
+		pos++;
+		if (pos < end && (text[pos] == '-' || text[pos] == '+'))
+			exp_neg = (text[pos++] == '-');
+		if (pos >= end)
+			return false;
+		while (pos < end)
+		{
+			if (text[pos] < '0' || text[pos] > '9' || exp_value > 1000)
+				return false;
+			exp_value = exp_value * 10 + (text[pos++] - '0');
+		}
+		exp10 += (exp_neg ? -exp_value : exp_value);
+	}
+	if (pos != end)
+		return false;
+	if (mantissa > (1UL << 53))
+		return false;
+	if (mantissa == 0)
+		exp10 = 0;
+	if (exp10 < -22 || exp10 > 22)
+		return false;
+
+	value = (cl_double) mantissa;
+	for (i=0, scale=1.0; i < abs(exp10); i++)
+		scale *= 10.0;
+	if (exp10 >= 0)
+		value *= scale;
+	else
+		value /= scale;
+	*p_value = (neg ? -value : value);
+	return true;
+}
+
+/*
+ * gpucopy_parse_bool - only the canonical forms are parsed by GPU
+ */
+STATIC_FUNCTION(cl_bool)
+gpucopy_parse_bool(const char *text, cl_uint head, cl_uint len,
+				   cl_bool *p_value)
+{
+	const char *str;
+
+	gpucopy_trim_spaces(text, &head, &len);
+	str = text + head;
+	if ((len == 1 && (str[0] == 't' || str[0] == 'y' || str[0] == '1')) ||
+		(len == 2 && str[0] == 'o' && str[1] == 'n') ||
+		(len == 3 && str[0] == 'y' && str[1] == 'e' && str[2] == 's') ||
+		(len == 4 && str[0] == 't' && str[1] == 'r' &&
+		 str[2] == 'u' && str[3] == 'e'))
+	{
+		*p_value = true;
+		return true;
+	}
+	if ((len == 1 && (str[0] == 'f' || str[0] == 'n' || str[0] == '0')) ||
+		(len == 2 && str[0] == 'n' && str[1] == 'o') ||
+		(len == 3 && str[0] == 'o' && str[1] == 'f' && str[2] == 'f') ||
+		(len == 5 && str[0] == 'f' && str[1] == 'a' &&
+		 str[2] == 'l' && str[3] == 's' && str[4] == 'e'))
+	{
+		*p_value = false;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * gpucopy_parse_digits - fixed number of digits
+ */
+STATIC_INLINE(cl_bool)
+gpucopy_parse_digits(const char *str, cl_int ndigits, cl_int *p_value)
+{
+	cl_int		value = 0;
+	cl_int		i;
+
+	for (i=0; i < ndigits; i++)
+	{
+		if (str[i] < '0' || str[i] > '9')
+			return false;
+		value = value * 10 + (str[i] - '0');
+	}
+	*p_value = value;
+	return true;
+}
+
+/*
+ * gpucopy_parse_ymd - ISO 8601 date (YYYY-MM-DD) to days from 2000-01-01
+ */
+STATIC_FUNCTION(cl_bool)
+gpucopy_parse_ymd(const char *str, cl_int *p_days)
+{
+	static const cl_int	mdays[] = {31,28,31,30,31,30,31,31,30,31,30,31};
+	cl_int		y, m, d;
+	cl_int		max_days;
+
+	if (!gpucopy_parse_digits(str, 4, &y) || str[4] != '-' ||
+		!gpucopy_parse_digits(str + 5, 2, &m) || str[7] != '-' ||
+		!gpucopy_parse_digits(str + 8, 2, &d))
+		return false;
+	if (y < 1 || m < 1 || m > 12 || d < 1)
+		return false;
+	max_days = mdays[m-1];
+	if (m == 2 && (y % 4 == 0 && (y % 100 != 0 || y % 400 == 0)))
+		max_days++;
+	if (d > max_days)
+		return false;
+	*p_days = date2j(y, m, d) - POSTGRES_EPOCH_JDATE;
+	return true;
+}
+
+/*
+ * gpucopy_parse_date - 'YYYY-MM-DD' only
+ */
+STATIC_FUNCTION(cl_bool)
+gpucopy_parse_date(const char *text, cl_uint head, cl_uint len,
+				   cl_int *p_value)
+{
+	gpucopy_trim_spaces(text, &head, &len);
+	if (len != 10)
+		return false;
+	return gpucopy_parse_ymd(text + head, p_value);
+}
+
+/*
+ * gpucopy_parse_timestamp - 'YYYY-MM-DD HH:MI:SS[.ffffff]' only
+ */
+STATIC_FUNCTION(cl_bool)
+gpucopy_parse_timestamp(const char *text, cl_uint head, cl_uint len,
+						cl_long *p_value)
+{
+	const char *str;
+	cl_int		days;
+	cl_int		hour, min, sec;
+	cl_int		fsec = 0;
+	cl_int		i;
+
+	gpucopy_trim_spaces(text, &head, &len);
+	str = text + head;
+	if (len < 19 || len == 20 || len > 26)
+		return false;
+	if (!gpucopy_parse_ymd(str, &days) ||
+		(str[10] != ' ' && str[10] != 'T') ||
+		!gpucopy_parse_digits(str + 11, 2, &hour) || str[13] != ':' ||
+		!gpucopy_parse_digits(str + 14, 2, &min) || str[16] != ':' ||
+		!gpucopy_parse_digits(str + 17, 2, &sec))
+		return false;
+	if (hour > 23 || min > 59 || sec > 59)
+		return false;
+	if (len > 19)
+	{
+		if (str[19] != '.' ||
+			!gpucopy_parse_digits(str + 20, len - 20, &fsec))
+			return false;
+		for (i = len - 20; i < 6; i++)
+			fsec *= 10;
+	}
+	*p_value = ((cl_long)days * USECS_PER_DAY +
+				((cl_long)(hour * 60 + min) * 60 + sec) * USECS_PER_SEC +
+				fsec);
+	return true;
+}
+
+/*
+ * gpucopy_parse_column - parses a field, then stores the value
+ */
+STATIC_FUNCTION(cl_bool)
+gpucopy_parse_column(kern_copycolumn *cmeta, char *results,
+					 const char *text, cl_uint row_index,
+					 cl_uint head, cl_uint len,
+					 cl_bool quoted, cl_bool escaped)
+{
+	char	   *values = results + cmeta->values_offset;
+	cl_uint	   *nullmap = (cl_uint *)(results + cmeta->nullmap_offset);
+	cl_long		ival;
+	cl_int		dval;
+	cl_double	fval;
+	cl_bool		bval;
+
+	/* unquoted empty field is NULL */
+	if (!quoted && len == 0)
+		return true;
+	if (cmeta->kind == GPUCOPY_KIND__CPU)
+	{
+		kern_copyfield *field = (kern_copyfield *)values + row_index;
+
+		field->offset = head;
+		field->length = (escaped ? (len | GPUCOPY_FIELD_ESCAPED) : len);
+	}
+	else
+	{
+		if (escaped)
+			return false;
+		switch (cmeta->kind)
+		{
+			case GPUCOPY_KIND__BOOL:
+				if (!gpucopy_parse_bool(text, head, len, &bval))
+					return false;
+				((cl_bool *)values)[row_index] = bval;
+				break;
+			case GPUCOPY_KIND__INT2:
+				if (!gpucopy_parse_int(text, head, len,
+									   SHRT_MIN, SHRT_MAX, &ival))
+					return false;
+				((cl_short *)values)[row_index] = (cl_short)ival;
+				break;
+			case GPUCOPY_KIND__INT4:
+				if (!gpucopy_parse_int(text, head, len,
+									   INT_MIN, INT_MAX, &ival))
+					return false;
+				((cl_int *)values)[row_index] = (cl_int)ival;
+				break;
+			case GPUCOPY_KIND__INT8:
+				if (!gpucopy_parse_int(text, head, len,
+									   LONG_MIN, LONG_MAX, &ival))
+					return false;
+				((cl_long *)values)[row_index] = ival;
+				break;
+			case GPUCOPY_KIND__FLOAT4:
+				if (!gpucopy_parse_float(text, head, len, &fval))
+					return false;
+				/* float4in() also rounds the result of strtod() */
+				((cl_float *)values)[row_index] = (cl_float)fval;
+				break;
+			case GPUCOPY_KIND__FLOAT8:
+				if (!gpucopy_parse_float(text, head, len, &fval))
+					return false;
+				((cl_double *)values)[row_index] = fval;
+				break;
+			case GPUCOPY_KIND__DATE:
+				if (!gpucopy_parse_date(text, head, len, &dval))
+					return false;
+				((cl_int *)values)[row_index] = dval;
+				break;
+			case GPUCOPY_KIND__TIMESTAMP:
+				if (!gpucopy_parse_timestamp(text, head, len, &ival))
+					return false;
+				((cl_long *)values)[row_index] = ival;
+				break;
+			default:
+				return false;
+		}
+	}
+	atomicOr(&nullmap[row_index / 32], 1U << (row_index % 32));
+	return true;
+}
+
+/*
+ * gpucopy_count_lines
+ *
+ * Every block scans (block size x GPUCOPY_BYTES_PER_THREAD) bytes, then
+ * saves number of the newlines in the range.
+ */
+KERNEL_FUNCTION(void)
+gpucopy_count_lines(kern_gpucopy *kcopy, cl_uint *block_nlines)
+{
+	kern_context	kcxt;
+	const char	   *text = KERN_GPUCOPY_TEXT(kcopy);
+	cl_uint			base;
+	cl_uint			pos;
+	cl_uint			count = 0;
+	cl_uint			i;
+	__shared__ cl_uint	block_count;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpucopy_count_lines, NULL);
+	if (get_local_id() == 0)
+		block_count = 0;
+	__syncthreads();
+
+	base = get_global_index() * get_local_size() * GPUCOPY_BYTES_PER_THREAD;
+	for (i=0; i < GPUCOPY_BYTES_PER_THREAD; i++)
+	{
+		pos = base + i * get_local_size() + get_local_id();
+		if (pos < kcopy->length && text[pos] == '\n')
+			count++;
+	}
+	if (count > 0)
+		atomicAdd(&block_count, count);
+	__syncthreads();
+	if (get_local_id() == 0)
+		block_nlines[get_global_index()] = block_count;
+	/* any error during run-time? */
+	kern_writeback_error_status(&kcopy->kerror, &kcxt.e);
+}
+
+/*
+ * gpucopy_find_lines
+ *
+ * It writes out positions of the newlines in order, according to the
+ * number of lines in the preceding blocks.
+ */
+KERNEL_FUNCTION(void)
+gpucopy_find_lines(kern_gpucopy *kcopy, cl_uint *block_base,
+				   cl_uint *line_end)
+{
+	kern_context	kcxt;
+	const char	   *text = KERN_GPUCOPY_TEXT(kcopy);
+	cl_uint			base;
+	cl_uint			index;
+	cl_uint			offset;
+	cl_uint			count;
+	cl_uint			pos;
+	cl_uint			i;
+	int				is_newline;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpucopy_find_lines, NULL);
+	base = get_global_index() * get_local_size() * GPUCOPY_BYTES_PER_THREAD;
+	index = block_base[get_global_index()];
+	for (i=0; i < GPUCOPY_BYTES_PER_THREAD; i++)
+	{
+		pos = base + i * get_local_size() + get_local_id();
+		is_newline = (pos < kcopy->length && text[pos] == '\n');
+		offset = pgstromStairlikeBinaryCount(is_newline, &count);
+		if (is_newline)
+			line_end[index + offset] = pos;
+		index += count;
+	}
+	/* any error during run-time? */
+	kern_writeback_error_status(&kcopy->kerror, &kcxt.e);
+}
+
+/*
+ * gpucopy_parse_lines
+ *
+ * Every thread parses a line, then stores the values. If GPU cannot parse
+ * the line for any reasons (broken line, out of range, formats which are
+ * not supported by GPU, ...), it sets the row flag, then CPU will parse
+ * the line again and report the error if any.
+ */
+KERNEL_FUNCTION(void)
+gpucopy_parse_lines(kern_gpucopy *kcopy, cl_uint *line_end, char *results)
+{
+	kern_context	kcxt;
+	const char	   *text = KERN_GPUCOPY_TEXT(kcopy);
+	cl_char		   *row_flags = (cl_char *)(results +
+											kcopy->row_flags_offset);
+	cl_uint			index;
+	cl_uint			pos;
+	cl_uint			end;
+	cl_uint			head;
+	cl_uint			len;
+	cl_bool			quoted;
+	cl_bool			escaped;
+	cl_uint			j;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpucopy_parse_lines, NULL);
+	for (index = get_global_id();
+		 index < kcopy->nitems;
+		 index += get_global_size())
+	{
+		pos = (index == 0 ? 0 : line_end[index - 1] + 1);
+		end = line_end[index];
+		if (end > pos && text[end - 1] == '\r')
+			end--;
+		row_flags[index] = false;
+		for (j=0; j < kcopy->ncols; j++)
+		{
+			if (!gpucopy_next_field(text, &pos, end, kcopy->delimiter,
+									&head, &len, &quoted, &escaped) ||
+				!gpucopy_parse_column(&kcopy->colmeta[j], results, text,
+									  index, head, len, quoted, escaped))
+				break;
+			if (j + 1 < kcopy->ncols)
+			{
+				/* missing data for the next columns */
+				if (pos >= end)
+					break;
+				pos++;		/* skip the delimiter */
+			}
+			else if (pos != end)
+				break;		/* extra data after the last column */
+		}
+		if (j < kcopy->ncols)
+			row_flags[index] = true;
+	}
+	/* any error during run-time? */
+	kern_writeback_error_status(&kcopy->kerror, &kcxt.e);
+}
+#endif	/* __CUDACC__ */
+#endif	/* CUDA_GPUCOPY_H */
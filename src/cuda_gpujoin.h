@@ -34,10 +34,21 @@ typedef struct
 	{
 		cl_ulong	chunk_offset;	/* offset to KDS or Hash */
 		cl_ulong	ojmap_offset;	/* offset to outer-join map, if any */
+		cl_ulong	bloom_offset;	/* offset to bloom filter, if any */
+		cl_ulong	sorted_offset;	/* offset to sorted items, if any */
+		cl_ulong	heavy_offset;	/* offset to heavy hitters, if any */
+		cl_ulong	range_offset;	/* offset to range items, if any */
+		cl_uint		bloom_nwords;	/* number of bloom filter words; must
+									 * be power of 2, or 0 if no filter */
+		cl_uint		sorted_nitems;	/* number of sorted items, or 0 */
+		cl_uint		heavy_nitems;	/* number of heavy hitter keys, or 0 */
+		cl_uint		range_nitems;	/* number of range items, or 0 */
+		cl_bool		sorted_probe;	/* true, if probe by sorted items */
 		cl_bool		is_nestloop;	/* true, if NestLoop. */
 		cl_bool		left_outer;		/* true, if JOIN_LEFT or JOIN_FULL */
 		cl_bool		right_outer;	/* true, if JOIN_RIGHT or JOIN_FULL */
-		cl_char		__padding__[5];
+		cl_bool		semi_join;		/* true, if JOIN_SEMI */
+		cl_bool		anti_join;		/* true, if JOIN_ANTI */
 	} chunks[FLEXIBLE_ARRAY_MEMBER];
 } kern_multirels;
 
@@ -54,12 +65,99 @@ typedef struct
 					(size_t)(kmrels)->chunks[(depth)-1].ojmap_offset)	\
 				 : NULL))
 
+/*
+ * Bloom filter of the inner hash values. Each inner tuple sets two bits
+ * derived from its hash value, so an outer tuple whose bits are not both
+ * set obviously has no matched inner tuple.
+ */
+#define GPUJOIN_BLOOM_HASH1(hash)		((cl_uint)(hash))
+#define GPUJOIN_BLOOM_HASH2(hash)		((cl_uint)(hash) * 0x9e3779b1U)
+
+#define KERN_MULTIRELS_BLOOM_FILTER(kmrels, depth)						\
+	((cl_uint *)((kmrels)->chunks[(depth)-1].bloom_nwords > 0			\
+				 ? ((char *)(kmrels) +									\
+					(size_t)(kmrels)->chunks[(depth)-1].bloom_offset)	\
+				 : NULL))
+
+/*
+ * kern_sorteditem - inner hash items sorted by the hash value
+ *
+ * If inner hash table has many duplicated join keys, walk on the hash-slot
+ * chain is expensive because of random memory access. In this case, host
+ * code builds an array of the hash items sorted by the hash value, then
+ * GpuHashJoin looks up the first item by binary search, and merges the
+ * following items that have same hash value sequentially.
+ */
+typedef struct
+{
+	cl_uint		hash;			/* 32-bit hash value */
+	cl_uint		offset;			/* offset of the kern_hashitem from KDS */
+} kern_sorteditem;
+
+#define KERN_MULTIRELS_SORTED_ITEMS(kmrels, depth)						\
+	((kern_sorteditem *)((kmrels)->chunks[(depth)-1].sorted_nitems > 0	\
+						 ? ((char *)(kmrels) +							\
+							(size_t)(kmrels)->chunks[(depth)-1].sorted_offset) \
+						 : NULL))
+
+/*
+ * kern_heavyitem - heavy hitter keys of the inner hash table
+ *
+ * If a particular join key has so many inner tuples, a thread that is
+ * responsible to the outer row with this key walks on a very long chain,
+ * while other threads in the warp are idle. So, host code picks up these
+ * heavy hitter keys, then GpuHashJoin merges the sorted items of the key
+ * cooperatively by all the threads in the block.
+ */
+typedef struct
+{
+	cl_uint		hash;			/* 32-bit hash value */
+	cl_uint		sindex;			/* index of the first sorted item */
+} kern_heavyitem;
+
+#define KERN_MULTIRELS_HEAVY_ITEMS(kmrels, depth)						\
+	((kern_heavyitem *)((kmrels)->chunks[(depth)-1].heavy_nitems > 0	\
+						? ((char *)(kmrels) +							\
+						   (size_t)(kmrels)->chunks[(depth)-1].heavy_offset) \
+						: NULL))
+
+/*
+ * kern_rangeitem - inner rows sorted by the lower bound of range keys
+ *
+ * If join quals of GpuNestLoop restrict the inner row by a range; like
+ * BETWEEN, range @> element or range && range, host code builds an array
+ * of the inner rows sorted by the lower bound, with running maximum of
+ * the upper bound. Then, GpuNestLoop picks up the candidate inner rows
+ * by binary search, instead of evaluation of the join quals for each
+ * pair of outer and inner rows.
+ * Bounds of the range keys are 64bit integer; NULL or infinite lower
+ * (upper) bound is LONG_MIN (LONG_MAX).
+ */
+typedef struct
+{
+	cl_long		lower;			/* lower bound of the inner row */
+	cl_long		upper_max;		/* max upper bound of the items up to here */
+	cl_uint		index;			/* row index of the inner KDS */
+} kern_rangeitem;
+
+#define KERN_MULTIRELS_RANGE_ITEMS(kmrels, depth)						\
+	((kern_rangeitem *)((kmrels)->chunks[(depth)-1].range_nitems > 0	\
+						? ((char *)(kmrels) +							\
+						   (size_t)(kmrels)->chunks[(depth)-1].range_offset) \
+						: NULL))
+
 #define KERN_MULTIRELS_LEFT_OUTER_JOIN(kmrels, depth)	\
 	__ldg(&((kmrels)->chunks[(depth)-1].left_outer))
 
 #define KERN_MULTIRELS_RIGHT_OUTER_JOIN(kmrels, depth)	\
 	__ldg(&((kmrels)->chunks[(depth)-1].right_outer))
 
+#define KERN_MULTIRELS_SEMI_JOIN(kmrels, depth)			\
+	__ldg(&((kmrels)->chunks[(depth)-1].semi_join))
+
+#define KERN_MULTIRELS_ANTI_JOIN(kmrels, depth)			\
+	__ldg(&((kmrels)->chunks[(depth)-1].anti_join))
+
 /*
  * kern_gpujoin - control object of GpuJoin
  *
@@ -75,6 +173,9 @@ typedef struct
  * | for suspend and  |
  * | resume           |
  * +------------------+
+ * | 5. hash-value    |
+ * | cache (optional) |
+ * +------------------+
  *
  * The first segment is the control object of GpuJoin itself, and the second
  * one is buffer of contrant variables.
@@ -90,6 +191,10 @@ typedef struct
  * GpuJoin kernel will suspend the execution if and when destination buffer
  * gets filled up. Host code is responsible to detach the current buffer
  * and allocates a new one, then resume the GPU kernel.
+ * The 5th segment caches the hash-value of join keys for each source row,
+ * if keys of the hash-join reference only the source relation and the source
+ * rows have dense row-index (KDS_FORMAT_COLUMN). See the comment at
+ * gpujoin_hash_cache_slot() for details.
  * The 4th segment for suspend / resume shall not be in-use unless destination
  * buffer does not run out, thus, it shall not consume devuce physical pages
  * because we allocate the control segment using unified managed memory.
@@ -101,6 +206,9 @@ struct kern_gpujoin
 	cl_uint			pstack_offset;		/* offset to the pseudo-stack */
 	cl_uint			pstack_nrooms;		/* size of pseudo-stack */
 	cl_uint			suspend_offset;		/* offset to the suspend-backup */
+	cl_uint			hcache_offset;		/* offset to the hash-value cache */
+	cl_uint			hcache_nitems;		/* # of source rows to be cached */
+	cl_uint			hcache_ngroups;		/* # of key groups to be cached */
 	cl_uint			num_rels;			/* number of inner relations */
 	cl_bool			resume_context;		/* resume context from suspend */
 	cl_uint			src_read_pos;		/* position to read from kds_src */
@@ -108,11 +216,14 @@ struct kern_gpujoin
 	cl_uint			source_nitems;		/* out: # of source rows */
 	cl_uint			outer_nitems;		/* out: # of filtered source rows */
 	cl_uint			stat_nitems[FLEXIBLE_ARRAY_MEMBER]; /* out: stat nitems */
+	/*-- depth order; physical depth to be run on each level --*/
 	/*-- pseudo-stack and suspend/resume context --*/
 	/*-- kernel param/const buffer --*/
 };
 typedef struct kern_gpujoin		kern_gpujoin;
 
+#define KERN_GPUJOIN_DEPTH_ORDER(kgjoin)				\
+	((cl_uint *)&(kgjoin)->stat_nitems[(kgjoin)->num_rels + 1])
 #define KERN_GPUJOIN_PARAMBUF(kgjoin)					\
 	((kern_parambuf *)((char *)(kgjoin) + (kgjoin)->kparams_offset))
 #define KERN_GPUJOIN_PARAMBUF_LENGTH(kgjoin)			\
@@ -129,6 +240,11 @@ typedef struct kern_gpujoin		kern_gpujoin;
 	  get_global_index() *									\
 	  STROMALIGN(offsetof(gpujoin_suspend_block,			\
 						  threads[get_local_size()]))))
+#define KERN_GPUJOIN_HASH_CACHE(kgjoin)						\
+	((cl_ulong *)((char *)(kgjoin) + (kgjoin)->hcache_offset))
+#define KERN_GPUJOIN_HASH_CACHE_LENGTH(kgjoin)				\
+	STROMALIGN(sizeof(cl_ulong) * (size_t)(kgjoin)->hcache_nitems *	\
+			   (size_t)(kgjoin)->hcache_ngroups)
 
 #ifdef __CUDACC__
 
@@ -169,12 +285,83 @@ gpujoin_join_quals(kern_context *kcxt,
 STATIC_FUNCTION(cl_uint)
 gpujoin_hash_value(kern_context *kcxt,
 				   cl_uint *pg_crc32_table,
+				   kern_gpujoin *kgjoin,
 				   kern_data_store *kds,
 				   kern_multirels *kmrels,
 				   cl_int depth,
 				   cl_uint *x_buffer,
 				   cl_bool *p_is_null_keys);
 
+/*
+ * gpujoin_hash_cache_slot
+ *
+ * Hash-value of the join keys which reference only the source relation is
+ * identical for all the combinations derived from the same source row, and
+ * for all the depths with identical keys. So, hash-value is calculated once
+ * per source row and key group, then cached on the 5th segment of the
+ * kern_gpujoin. It is available only if source rows have dense row-index
+ * (t_offset of KDS_FORMAT_COLUMN is row-index + 1).
+ * Each item is (hash-value << 32 | is_null_keys << 1 | 1), or zero if not
+ * calculated yet. Multiple threads may write the same item concurrently,
+ * however, it is harmless because the values to be written are identical.
+ */
+STATIC_INLINE(cl_ulong *)
+gpujoin_hash_cache_slot(kern_gpujoin *kgjoin, cl_int hgroup,
+						cl_uint *x_buffer)
+{
+	cl_uint		t_offset = x_buffer[0];
+
+	if (!kgjoin ||
+		t_offset == 0 ||
+		t_offset > kgjoin->hcache_nitems ||
+		hgroup >= kgjoin->hcache_ngroups)
+		return NULL;
+	return KERN_GPUJOIN_HASH_CACHE(kgjoin) +
+		((size_t)hgroup * (size_t)kgjoin->hcache_nitems + (t_offset - 1));
+}
+
+STATIC_INLINE(cl_bool)
+gpujoin_hash_cache_fetch(cl_ulong *hslot,
+						 cl_uint *p_hash_value,
+						 cl_bool *p_is_null_keys)
+{
+	cl_ulong	hitem;
+
+	if (!hslot)
+		return false;
+	hitem = *((volatile cl_ulong *)hslot);
+	if ((hitem & 1UL) == 0)
+		return false;
+	*p_hash_value = (cl_uint)(hitem >> 32);
+	*p_is_null_keys = ((hitem & 2UL) != 0);
+	return true;
+}
+
+STATIC_INLINE(void)
+gpujoin_hash_cache_store(cl_ulong *hslot,
+						 cl_uint hash_value,
+						 cl_bool is_null_keys)
+{
+	if (hslot)
+		*hslot = (((cl_ulong)hash_value << 32) |
+				  (is_null_keys ? 2UL : 0UL) | 1UL);
+}
+
+/*
+ * gpujoin_range_keys
+ *
+ * Calculation of the bounds of outer row, to be compared with the range
+ * items, if this depth has range keys.
+ */
+STATIC_FUNCTION(void)
+gpujoin_range_keys(kern_context *kcxt,
+				   kern_data_store *kds,
+				   kern_multirels *kmrels,
+				   cl_int depth,
+				   cl_uint *x_buffer,
+				   cl_long *p_lower,
+				   cl_long *p_upper);
+
 /*
  * gpujoin_projection
  *
@@ -206,6 +393,159 @@ static __shared__ cl_uint	write_pos[GPUJOIN_MAX_DEPTH+1];
 static __shared__ cl_uint	stat_source_nitems;
 static __shared__ cl_uint	stat_nitems[GPUJOIN_MAX_DEPTH+1];
 static __shared__ cl_uint	pg_crc32_table[256];
+static __shared__ cl_int	depth_order[GPUJOIN_MAX_DEPTH+1];	/* level->depth */
+static __shared__ cl_int	depth_pos[GPUJOIN_MAX_DEPTH+1];		/* depth->level */
+
+/*
+ * GPUJOIN_DEPTH_POS - position of the pseudo-stack entry that references
+ * the tuple of the supplied (physical) depth. Host code may reorder the
+ * depths of INNER JOIN at runtime, so automatically generated code has to
+ * use this macro to pick up the tuple.
+ */
+#define GPUJOIN_DEPTH_POS(depth)		(depth_pos[(depth)])
+
+/*
+ * gpujoin_setup_depth_order
+ */
+STATIC_INLINE(void)
+gpujoin_setup_depth_order(kern_gpujoin *kgjoin)
+{
+	cl_uint	   *order = KERN_GPUJOIN_DEPTH_ORDER(kgjoin);
+	cl_int		level;
+
+	if (get_local_id() == 0)
+	{
+		for (level=0; level <= GPUJOIN_MAX_DEPTH; level++)
+		{
+			depth_order[level] = order[level];
+			depth_pos[order[level]] = level;
+		}
+	}
+	__syncthreads();
+}
+
+/*
+ * gpujoin_sorted_lower_bound
+ *
+ * It returns index of the first sorted item that has the supplied hash
+ * value, or UINT_MAX if not found.
+ */
+STATIC_INLINE(cl_uint)
+gpujoin_sorted_lower_bound(kern_sorteditem *sitems, cl_uint nitems,
+						   cl_uint hash)
+{
+	cl_uint		head = 0;
+	cl_uint		tail = nitems;
+	cl_uint		curr;
+
+	while (head < tail)
+	{
+		curr = head + (tail - head) / 2;
+		if (__ldg(&sitems[curr].hash) < hash)
+			head = curr + 1;
+		else
+			tail = curr;
+	}
+	if (head < nitems && __ldg(&sitems[head].hash) == hash)
+		return head;
+	return UINT_MAX;
+}
+
+/*
+ * gpujoin_heavy_hitter_lookup
+ *
+ * It returns index of the first sorted item of the heavy hitter key, or
+ * UINT_MAX if the supplied hash value is not a heavy hitter.
+ */
+STATIC_INLINE(cl_uint)
+gpujoin_heavy_hitter_lookup(kern_heavyitem *hitems, cl_uint nitems,
+							cl_uint hash)
+{
+	cl_uint		head = 0;
+	cl_uint		tail = nitems;
+	cl_uint		curr;
+
+	while (head < tail)
+	{
+		curr = head + (tail - head) / 2;
+		if (__ldg(&hitems[curr].hash) < hash)
+			head = curr + 1;
+		else
+			tail = curr;
+	}
+	if (head < nitems && __ldg(&hitems[head].hash) == hash)
+		return __ldg(&hitems[head].sindex);
+	return UINT_MAX;
+}
+
+/*
+ * gpujoin_range_window
+ *
+ * It looks up the window of range items that may overlap with the bounds
+ * of outer row; items before @p_head have upper bound less than @lower
+ * because of the running maximum, and items from @p_tail have lower bound
+ * greater than @upper.
+ */
+STATIC_FUNCTION(void)
+gpujoin_range_window(kern_rangeitem *ritems, cl_uint nitems,
+					 cl_long lower, cl_long upper,
+					 cl_uint *p_head, cl_uint *p_tail)
+{
+	cl_uint		head;
+	cl_uint		tail;
+	cl_uint		curr;
+
+	/* the first item with upper_max >= lower */
+	head = 0;
+	tail = nitems;
+	while (head < tail)
+	{
+		curr = head + (tail - head) / 2;
+		if (__ldg(&ritems[curr].upper_max) < lower)
+			head = curr + 1;
+		else
+			tail = curr;
+	}
+	*p_head = head;
+
+	/* the first item with lower > upper */
+	tail = nitems;
+	while (head < tail)
+	{
+		curr = head + (tail - head) / 2;
+		if (__ldg(&ritems[curr].lower) <= upper)
+			head = curr + 1;
+		else
+			tail = curr;
+	}
+	*p_tail = head;
+}
+
+/*
+ * gpujoin_bloom_filter_test
+ *
+ * It returns false if the hash value is obviously not contained in the
+ * inner relation of this depth. Elsewhere, hash-slot has to be probed.
+ */
+STATIC_INLINE(cl_bool)
+gpujoin_bloom_filter_test(kern_multirels *kmrels, cl_int depth, cl_uint hash)
+{
+	cl_uint		nwords = __ldg(&kmrels->chunks[depth-1].bloom_nwords);
+	cl_uint	   *bloom;
+	cl_uint		h1, h2;
+
+	if (nwords == 0)
+		return true;	/* no bloom filter */
+	bloom = (cl_uint *)((char *)kmrels +
+						__ldg(&kmrels->chunks[depth-1].bloom_offset));
+	h1 = GPUJOIN_BLOOM_HASH1(hash);
+	if ((__ldg(&bloom[(h1 >> 5) & (nwords-1)]) & (1U << (h1 & 31))) == 0)
+		return false;
+	h2 = GPUJOIN_BLOOM_HASH2(hash);
+	if ((__ldg(&bloom[(h2 >> 5) & (nwords-1)]) & (1U << (h2 & 31))) == 0)
+		return false;
+	return true;
+}
 
 /*
  * per block suspended context
@@ -338,6 +678,7 @@ gpujoin_rewind_stack(cl_int depth, cl_uint *l_state, cl_bool *matched)
 STATIC_FUNCTION(cl_int)
 gpujoin_load_source(kern_context *kcxt,
 					kern_gpujoin *kgjoin,
+					kern_multirels *kmrels,
 					kern_data_store *kds_src,
 					cl_uint *wr_stack,
 					cl_uint *l_state)
@@ -345,6 +686,7 @@ gpujoin_load_source(kern_context *kcxt,
 	cl_uint		t_offset = UINT_MAX;
 	cl_bool		visible = false;
 	cl_uint		count;
+	cl_uint		nvisibles;
 	cl_uint		wr_index;
 
 	/* extract a HeapTupleHeader */
@@ -365,6 +707,7 @@ gpujoin_load_source(kern_context *kcxt,
 			tupitem = KERN_DATA_STORE_TUPITEM(kds_src, row_index);
 			t_offset = (cl_uint)((char *)&tupitem->htup - (char *)kds_src);
 
+			RESET_KERNEL_VARLENA_BUFFER(kcxt);
 			visible = gpuscan_quals_eval(kcxt,
 										 kds_src,
 										 &tupitem->t_self,
@@ -412,6 +755,7 @@ gpujoin_load_source(kern_context *kcxt,
 
 					htup = PageGetItem(pg_page, lpp);
 
+					RESET_KERNEL_VARLENA_BUFFER(kcxt);
 					visible = gpuscan_quals_eval(kcxt,
 												 kds_src,
 												 &t_self,
@@ -435,6 +779,7 @@ gpujoin_load_source(kern_context *kcxt,
 		if (row_index < __ldg(&kds_src->nitems))
 		{
 			t_offset = row_index + 1;
+			RESET_KERNEL_VARLENA_BUFFER(kcxt);
 			visible = gpuscan_quals_eval_column(kcxt,
 												kds_src,
 												row_index);
@@ -446,11 +791,42 @@ gpujoin_load_source(kern_context *kcxt,
 		return -1;
 	/* statistics */
 	count = __syncthreads_count(t_offset != UINT_MAX);
+	nvisibles = __syncthreads_count(visible);
 	if (get_local_id() == 0)
 	{
 		if (__ldg(&kds_src->format) == KDS_FORMAT_BLOCK)
 			wip_count[0] = count;
 		stat_source_nitems += count;
+		stat_nitems[0] += nvisibles;
+	}
+
+	/*
+	 * If the first depth is INNER or SEMI hash-join with bloom filter, we
+	 * can drop the source tuple that obviously has no matched inner tuple
+	 * prior to the hash-slot probe.
+	 */
+	if (kgjoin->num_rels > 0 &&
+		!__ldg(&kmrels->chunks[depth_order[1]-1].is_nestloop) &&
+		!KERN_MULTIRELS_LEFT_OUTER_JOIN(kmrels, depth_order[1]) &&
+		!KERN_MULTIRELS_ANTI_JOIN(kmrels, depth_order[1]) &&
+		__ldg(&kmrels->chunks[depth_order[1]-1].bloom_nwords) > 0 &&
+		visible)
+	{
+		cl_uint		hash_value;
+		cl_bool		is_null_keys;
+
+		RESET_KERNEL_VARLENA_BUFFER(kcxt);
+		hash_value = gpujoin_hash_value(kcxt,
+										pg_crc32_table,
+										kgjoin,
+										kds_src,
+										kmrels,
+										depth_order[1],
+										&t_offset,
+										&is_null_keys);
+		if (is_null_keys ||
+			!gpujoin_bloom_filter_test(kmrels, depth_order[1], hash_value))
+			visible = false;
 	}
 
 	/* store the source tuple if visible */
@@ -460,10 +836,7 @@ gpujoin_load_source(kern_context *kcxt,
 		wr_index += write_pos[0];
 		__syncthreads();
 		if (get_local_id() == 0)
-		{
 			write_pos[0] += count;
-			stat_nitems[0] += count;
-		}
 		if (visible)
 			wr_stack[wr_index] = t_offset;
 		__syncthreads();
@@ -646,6 +1019,7 @@ gpujoin_projection_row(kern_context *kcxt,
 	{
 		rd_stack += read_index * (nrels + 1);
 
+		RESET_KERNEL_VARLENA_BUFFER(kcxt);
 		gpujoin_projection(kcxt,
 						   kds_src,
 						   kmrels,
@@ -745,9 +1119,22 @@ gpupreagg_projection_slot(kern_context *kcxt_gpreagg,
 						  cl_char *src_isnull,
 						  Datum *dst_values,
 						  cl_char *dst_isnull);
+#ifdef GPUPREAGG_FUSED_NOGROUP
+/* to be defined by cuda_gpupreagg.h */
+STATIC_FUNCTION(void)
+gpupreagg_fused_nogroup_reduction(kern_context *kcxt_gpreagg,
+								  kern_data_store *kds_final,
+								  cl_uint nvalids,
+								  cl_bool *slot_isnull,
+								  Datum *slot_values);
+#endif
 
 /*
  * gpujoin_projection_slot
+ *
+ * If GPUPREAGG_FUSED_NOGROUP, @kds_dst is the final buffer of GpuPreAgg,
+ * and the joined rows are accumulated on the private slot, then reduced
+ * onto the final buffer directly, without the intermediation of kds_slot.
  */
 STATIC_FUNCTION(cl_int)
 gpujoin_projection_slot(kern_context *kcxt,
@@ -762,11 +1149,15 @@ gpujoin_projection_slot(kern_context *kcxt,
 {
 	cl_uint		nrels = kgjoin->num_rels;
 	cl_uint		read_index;
-	cl_uint		dest_index;
-	cl_uint		dest_offset;
-	cl_uint		count;
+	cl_uint		dest_index	__attribute__((unused));
+	cl_uint		dest_offset	__attribute__((unused));
+	cl_uint		count		__attribute__((unused));
 	cl_uint		nvalids;
 	cl_bool		tup_is_valid = false;
+#ifdef GPUPREAGG_FUSED_NOGROUP
+	Datum		slot_values[GPUPREAGG_NUM_SLOT_COLUMNS];
+	cl_bool		slot_isnull[GPUPREAGG_NUM_SLOT_COLUMNS];
+#endif
 #if GPUJOIN_DEVICE_PROJECTION_NFIELDS > 0
 	Datum		tup_values[GPUJOIN_DEVICE_PROJECTION_NFIELDS];
 	cl_bool		tup_isnull[GPUJOIN_DEVICE_PROJECTION_NFIELDS];
@@ -803,9 +1194,17 @@ gpujoin_projection_slot(kern_context *kcxt,
 		/*
 		 * NOTE: We don't need to copy varlena datum, but pointer reference
 		 * only, because pds_src / kmrels are still valid during GpuPreAgg.
+		 * On the other hands, varlena datum constructed on the per-thread
+		 * varlena buffer is not valid after the kernel exit, so we detach
+		 * the buffer during the projection. The device functions which
+		 * construct varlena datum raise CpuReCheck error instead.
 		 */
+		cl_char	   *vlbuf = kcxt->vlbuf;
+		cl_char	   *vlend = kcxt->vlend;
+
 		rd_stack += read_index * (nrels + 1);
 
+		SETUP_KERNEL_VARLENA_BUFFER(kcxt, NULL, 0);
 		gpujoin_projection(kcxt,
 						   kds_src,
 						   kmrels,
@@ -816,11 +1215,37 @@ gpujoin_projection_slot(kern_context *kcxt,
 						   use_extra_buf,
 						   extra_buf,
 						   &extra_len);
+		SETUP_KERNEL_VARLENA_BUFFER(kcxt, vlbuf, vlend - vlbuf);
 		assert(extra_len <= GPUJOIN_DEVICE_PROJECTION_EXTRA_SIZE);
 
 		tup_is_valid = true;
 	}
 
+#ifdef GPUPREAGG_FUSED_NOGROUP
+	/* step.2 - initial projection by GpuPreAgg on the private slot */
+	if (tup_is_valid)
+	{
+		gpupreagg_projection_slot(kcxt_gpreagg,
+								  tup_values,
+								  tup_isnull,
+								  slot_values,
+								  slot_isnull);
+	}
+	if (__syncthreads_count(kcxt->e.errcode ||
+							kcxt_gpreagg->e.errcode) > 0)
+	{
+		if (kcxt->e.errcode == StromError_Success)
+			kcxt->e = kcxt_gpreagg->e;
+		return -1;	/* bailout */
+	}
+
+	/* step.3 - reduction of the private slots onto the kds_final */
+	gpupreagg_fused_nogroup_reduction(kcxt_gpreagg,
+									  kds_dst,
+									  nvalids,
+									  slot_isnull,
+									  slot_values);
+#else
 	/* step.2 - increments nitems/usage of the kds_dst */
 	dest_offset = pgstromStairlikeSum(extra_len, &count);
 	if (get_local_id() == 0)
@@ -902,6 +1327,7 @@ gpujoin_projection_slot(kern_context *kcxt,
 	}
 	if (__syncthreads_count(kcxt->e.errcode) > 0)
 		return -1;	/* bailout */
+#endif	/* GPUPREAGG_FUSED_NOGROUP */
 
 	/* step.4 - make advance the read position */
 	if (get_local_id() == 0)
@@ -926,11 +1352,16 @@ gpujoin_exec_nestloop(kern_context *kcxt,
 {
 	kern_data_store *kds_in = KERN_MULTIRELS_INNER_KDS(kmrels, depth);
 	cl_bool		   *oj_map = KERN_MULTIRELS_OUTER_JOIN_MAP(kmrels, depth);
+	kern_rangeitem *ritems = KERN_MULTIRELS_RANGE_ITEMS(kmrels, depth);
 	kern_tupitem   *tupitem = NULL;
+	cl_bool			semi_join = KERN_MULTIRELS_SEMI_JOIN(kmrels, depth);
+	cl_bool			anti_join = KERN_MULTIRELS_ANTI_JOIN(kmrels, depth);
 	cl_uint			x_unitsz;
 	cl_uint			y_unitsz;
 	cl_uint			x_index;	/* outer index */
 	cl_uint			y_index;	/* inner index */
+	cl_uint			r_head;		/* head of the candidate inner rows */
+	cl_uint			r_tail;		/* tail of the candidate inner rows */
 	cl_uint			wr_index;
 	cl_uint			count;
 	cl_bool			result = false;
@@ -965,27 +1396,58 @@ gpujoin_exec_nestloop(kern_context *kcxt,
 	x_index = get_local_id() % x_unitsz;
 	y_index = get_local_id() / x_unitsz;
 
-	if (y_unitsz * l_state[depth] >= kds_in->nitems)
+	/*
+	 * If range items are built, only the window of the items that may
+	 * overlap with the bounds of the outer row are the candidates.
+	 */
+	if (!ritems)
+	{
+		r_head = 0;
+		r_tail = kds_in->nitems;
+	}
+	else
+	{
+		cl_long		o_lower;
+		cl_long		o_upper;
+
+		RESET_KERNEL_VARLENA_BUFFER(kcxt);
+		gpujoin_range_keys(kcxt,
+						   kds_src,
+						   kmrels,
+						   depth,
+						   rd_stack + (read_pos[depth-1] + x_index) * depth,
+						   &o_lower,
+						   &o_upper);
+		gpujoin_range_window(ritems,
+							 __ldg(&kmrels->chunks[depth-1].range_nitems),
+							 o_lower, o_upper,
+							 &r_head, &r_tail);
+	}
+
+	if (__syncthreads_count(r_head + y_unitsz * l_state[depth] < r_tail) == 0)
 	{
 		/*
 		 * In case of LEFT OUTER JOIN, we need to check whether the outer
 		 * combination had any matched inner tuples, or not.
+		 * SEMI JOIN generates the outer combination if any matched, and
+		 * ANTI JOIN generates it if not matched, like LEFT OUTER JOIN.
 		 */
-		if (KERN_MULTIRELS_LEFT_OUTER_JOIN(kmrels, depth))
+		if (KERN_MULTIRELS_LEFT_OUTER_JOIN(kmrels, depth) ||
+			semi_join || anti_join)
 		{
 			if (get_local_id() < x_unitsz)
 				matched_sync[get_local_id()] = false;
 			__syncthreads();
 			if (matched[depth])
 				matched_sync[x_index] = true;
-			if (__syncthreads_count(!matched_sync[x_index]) > 0)
+			if (__syncthreads_count(matched_sync[x_index] == semi_join) > 0)
 			{
 				if (y_index == 0)
-					result = !matched_sync[x_index];
+					result = (matched_sync[x_index] == semi_join);
 				else
 					result = false;
-				/* don't generate LEFT OUTER tuple twice */
-				matched[depth] = true;
+				/* don't generate LEFT OUTER/SEMI/ANTI tuple twice */
+				matched[depth] = !semi_join;
 				goto left_outer;
 			}
 		}
@@ -1004,11 +1466,16 @@ gpujoin_exec_nestloop(kern_context *kcxt,
 	rd_stack += (x_index * depth);
 	if (y_index < y_unitsz)
 	{
-		y_index += y_unitsz * l_state[depth];
-		if (y_index < kds_in->nitems)
+		y_index += r_head + y_unitsz * l_state[depth];
+		/* SEMI/ANTI JOIN needs no more inner tuples once matched */
+		if (y_index < r_tail &&
+			!((semi_join || anti_join) && matched[depth]))
 		{
+			if (ritems)
+				y_index = __ldg(&ritems[y_index].index);
 			tupitem = KERN_DATA_STORE_TUPITEM(kds_in, y_index);
 
+			RESET_KERNEL_VARLENA_BUFFER(kcxt);
 			result = gpujoin_join_quals(kcxt,
 										kds_src,
 										kmrels,
@@ -1021,6 +1488,9 @@ gpujoin_exec_nestloop(kern_context *kcxt,
 				matched[depth] = true;
 				if (oj_map && !oj_map[y_index])
 					oj_map[y_index] = true;
+				/* SEMI/ANTI JOIN generates nothing until end of the inner */
+				if (semi_join || anti_join)
+					result = false;
 			}
 		}
 	}
@@ -1052,8 +1522,121 @@ left_outer:
 	return depth + 1;
 }
 
+/*
+ * gpujoin_exec_heavy_hitter
+ *
+ * All the threads in the block cooperatively merge the sorted items of a
+ * heavy hitter key, for an outer row picked up from the threads that are
+ * responsible to the heavy hitter keys. Its l_state[] is (index << 1) | 1
+ * where index is the next sorted item to be merged.
+ */
+STATIC_FUNCTION(cl_int)
+gpujoin_exec_heavy_hitter(kern_context *kcxt,
+						  kern_gpujoin *kgjoin,
+						  kern_multirels *kmrels,
+						  kern_data_store *kds_src,
+						  cl_int depth,
+						  cl_uint *rd_stack,
+						  cl_uint *wr_stack,
+						  cl_uint *l_state,
+						  cl_bool *matched)
+{
+	cl_int				dindex = depth_order[depth];
+	kern_data_store	   *kds_hash = KERN_MULTIRELS_INNER_KDS(kmrels, dindex);
+	cl_bool			   *oj_map = KERN_MULTIRELS_OUTER_JOIN_MAP(kmrels, dindex);
+	kern_sorteditem	   *sitems = KERN_MULTIRELS_SORTED_ITEMS(kmrels, dindex);
+	cl_uint				sorted_nitems
+		= __ldg(&kmrels->chunks[dindex-1].sorted_nitems);
+	kern_hashitem	   *khitem = NULL;
+	cl_uint				hash_value;
+	cl_uint				index;
+	cl_uint				wr_index;
+	cl_uint				count;
+	cl_bool				result = false;
+	static __shared__ cl_uint hh_owner;
+	static __shared__ cl_uint hh_sindex;
+	static __shared__ cl_uint *hh_rd_stack;
+
+	/* elect an outer row to be processed by the block */
+	if (get_local_id() == 0)
+		hh_owner = UINT_MAX;
+	__syncthreads();
+	if (l_state[depth] != UINT_MAX && (l_state[depth] & 1) != 0)
+		atomicMin(&hh_owner, get_local_id());
+	__syncthreads();
+	if (get_local_id() == hh_owner)
+	{
+		hh_sindex = (l_state[depth] >> 1);
+		hh_rd_stack = rd_stack;
+	}
+	__syncthreads();
+
+	/* every thread merges one sorted item of the heavy hitter key */
+	hash_value = __ldg(&sitems[hh_sindex].hash);
+	index = hh_sindex + get_local_id();
+	if (index < sorted_nitems &&
+		__ldg(&sitems[index].hash) == hash_value)
+	{
+		cl_bool		joinquals_matched;
+
+		khitem = (kern_hashitem *)
+			((char *)kds_hash + __ldg(&sitems[index].offset));
+		RESET_KERNEL_VARLENA_BUFFER(kcxt);
+		result = gpujoin_join_quals(kcxt,
+									kds_src,
+									kmrels,
+									dindex,
+									hh_rd_stack,
+									&khitem->t.htup,
+									&joinquals_matched);
+		assert(result == joinquals_matched);
+		/* No RIGHT/FULL JOIN are needed */
+		if (result && oj_map && !oj_map[khitem->rowid])
+			oj_map[khitem->rowid] = true;
+	}
+
+	/* the owner moves to the next window of the sorted items */
+	if (get_local_id() == hh_owner)
+	{
+		index = hh_sindex + get_local_size();
+		if (index < sorted_nitems &&
+			__ldg(&sitems[index].hash) == hash_value)
+			l_state[depth] = ((index << 1) | 1);
+		else
+			l_state[depth] = UINT_MAX;
+	}
+
+	wr_index = write_pos[depth];
+	wr_index += pgstromStairlikeBinaryCount(result, &count);
+	if (get_local_id() == 0)
+	{
+		write_pos[depth] += count;
+		stat_nitems[depth] += count;
+	}
+	wr_stack += wr_index * (depth + 1);
+	if (result)
+	{
+		memcpy(wr_stack, hh_rd_stack, sizeof(cl_uint) * depth);
+		wr_stack[depth] = (cl_uint)((char *)&khitem->t.htup -
+									(char *)kds_hash);
+	}
+	/* count number of threads still in-progress */
+	count = __syncthreads_count(l_state[depth] != UINT_MAX);
+	if (get_local_id() == 0)
+		wip_count[depth] = count;
+	/* enough room exists on this depth? */
+	if (write_pos[depth] + get_local_size() <= kgjoin->pstack_nrooms)
+		return depth;
+	return depth+1;
+}
+
 /*
  * gpujoin_exec_hashjoin
+ *
+ * l_state[] of the thread is 0 on the first touch, UINT_MAX at the end,
+ * or the current item; offset of the hash item on the hash-slot chain,
+ * (index << 1) + 2 of the sorted item, or (index << 1) | 1 of the heavy
+ * hitter's sorted item (see gpujoin_exec_heavy_hitter).
  */
 STATIC_FUNCTION(cl_int)
 gpujoin_exec_hashjoin(kern_context *kcxt,
@@ -1066,15 +1649,26 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 					  cl_uint *l_state,
 					  cl_bool *matched)
 {
-	kern_data_store	   *kds_hash = KERN_MULTIRELS_INNER_KDS(kmrels, depth);
-	cl_bool			   *oj_map = KERN_MULTIRELS_OUTER_JOIN_MAP(kmrels, depth);
+	/* @depth is the level of pseudo-stack; @dindex is the physical depth */
+	cl_int				dindex = depth_order[depth];
+	kern_data_store	   *kds_hash = KERN_MULTIRELS_INNER_KDS(kmrels, dindex);
+	cl_bool			   *oj_map = KERN_MULTIRELS_OUTER_JOIN_MAP(kmrels, dindex);
+	kern_sorteditem	   *sitems = NULL;
+	kern_heavyitem	   *hitems = KERN_MULTIRELS_HEAVY_ITEMS(kmrels, dindex);
+	cl_uint				sorted_nitems
+		= __ldg(&kmrels->chunks[dindex-1].sorted_nitems);
+	cl_uint				sindex = UINT_MAX;
 	kern_hashitem	   *khitem = NULL;
 	cl_uint				hash_value;
+	cl_bool				hash_ready = false;
+	cl_bool				is_null_keys;
 	cl_uint				rd_index;
 	cl_uint				wr_index;
 	cl_uint				count;
 	cl_bool				result;
 
+	if (__ldg(&kmrels->chunks[dindex-1].sorted_probe))
+		sitems = KERN_MULTIRELS_SORTED_ITEMS(kmrels, dindex);
 	assert(kds_hash->format == KDS_FORMAT_HASH);
 	assert(depth >= 1 && depth <= GPUJOIN_MAX_DEPTH);
 
@@ -1113,26 +1707,82 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 	rd_index = read_pos[depth-1] + get_local_id();
 	rd_stack += (rd_index * depth);
 
-	if (l_state[depth] == 0)
+	/*
+	 * Outer rows with heavy hitter keys are processed by whole the block,
+	 * prior to the walk on the hash-slot chain by individual threads.
+	 */
+	if (hitems)
 	{
-		/* first touch to the hash-slot */
-		if (rd_index < write_pos[depth-1])
+		if (l_state[depth] == 0 && rd_index < write_pos[depth-1])
 		{
-			cl_bool		is_null_keys;
-
+			RESET_KERNEL_VARLENA_BUFFER(kcxt);
 			hash_value = gpujoin_hash_value(kcxt,
 											pg_crc32_table,
+											kgjoin,
 											kds_src,
 											kmrels,
-											depth,
+											dindex,
 											rd_stack,
 											&is_null_keys);
+			hash_ready = true;
+			if (!is_null_keys)
+			{
+				sindex = gpujoin_heavy_hitter_lookup(hitems,
+							__ldg(&kmrels->chunks[dindex-1].heavy_nitems),
+							hash_value);
+				if (sindex != UINT_MAX)
+					l_state[depth] = ((sindex << 1) | 1);
+				sindex = UINT_MAX;
+			}
+		}
+		if (__syncthreads_or(l_state[depth] != UINT_MAX &&
+							 (l_state[depth] & 1) != 0))
+			return gpujoin_exec_heavy_hitter(kcxt,
+											 kgjoin,
+											 kmrels,
+											 kds_src,
+											 depth,
+											 rd_stack,
+											 wr_stack,
+											 l_state,
+											 matched);
+	}
+
+	if (l_state[depth] == 0)
+	{
+		/* first touch to the hash-slot */
+		if (rd_index < write_pos[depth-1])
+		{
+			if (!hash_ready)
+			{
+				RESET_KERNEL_VARLENA_BUFFER(kcxt);
+				hash_value = gpujoin_hash_value(kcxt,
+												pg_crc32_table,
+												kgjoin,
+												kds_src,
+												kmrels,
+												dindex,
+												rd_stack,
+												&is_null_keys);
+			}
 			if (hash_value >= kds_hash->hash_min &&
 				hash_value <= kds_hash->hash_max)
 			{
 				/* MEMO: NULL-keys will never match to inner-join */
-				if (!is_null_keys)
+				if (is_null_keys ||
+					!gpujoin_bloom_filter_test(kmrels, dindex, hash_value))
+					khitem = NULL;
+				else if (!sitems)
 					khitem = KERN_HASH_FIRST_ITEM(kds_hash, hash_value);
+				else
+				{
+					sindex = gpujoin_sorted_lower_bound(sitems,
+														sorted_nitems,
+														hash_value);
+					if (sindex != UINT_MAX)
+						khitem = (kern_hashitem *)
+							((char *)kds_hash + __ldg(&sitems[sindex].offset));
+				}
 			}
 		}
 		else
@@ -1144,6 +1794,16 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 			l_state[depth] = UINT_MAX;
 		}
 	}
+	else if (l_state[depth] != UINT_MAX && sitems)
+	{
+		/* merges the sorted items that have same hash value */
+		sindex = (l_state[depth] - 2) >> 1;
+		hash_value = __ldg(&sitems[sindex].hash);
+		if (++sindex < sorted_nitems &&
+			__ldg(&sitems[sindex].hash) == hash_value)
+			khitem = (kern_hashitem *)
+				((char *)kds_hash + __ldg(&sitems[sindex].offset));
+	}
 	else if (l_state[depth] != UINT_MAX)
 	{
 		/* walks on the hash-slot chain */
@@ -1165,10 +1825,11 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 
 		assert(khitem->hash == hash_value);
 
+		RESET_KERNEL_VARLENA_BUFFER(kcxt);
 		result = gpujoin_join_quals(kcxt,
 									kds_src,
 									kmrels,
-									depth,
+									dindex,
 									rd_stack,
 									&khitem->t.htup,
 									&joinquals_matched);
@@ -1181,21 +1842,38 @@ gpujoin_exec_hashjoin(kern_context *kcxt,
 			assert(khitem->rowid < kds_hash->nitems);
 			if (oj_map && !oj_map[khitem->rowid])
 				oj_map[khitem->rowid] = true;
+			/*
+			 * SEMI JOIN generates the outer row only once, with no inner
+			 * tuple, and ANTI JOIN generates nothing. In both cases, it is
+			 * not necessary to walk on the hash-slot chain any more.
+			 */
+			if (KERN_MULTIRELS_SEMI_JOIN(kmrels, dindex) ||
+				KERN_MULTIRELS_ANTI_JOIN(kmrels, dindex))
+			{
+				result = KERN_MULTIRELS_SEMI_JOIN(kmrels, dindex);
+				khitem = NULL;
+			}
 		}
 	}
-	else if (KERN_MULTIRELS_LEFT_OUTER_JOIN(kmrels, depth) &&
+	else if ((KERN_MULTIRELS_LEFT_OUTER_JOIN(kmrels, dindex) ||
+			  KERN_MULTIRELS_ANTI_JOIN(kmrels, dindex)) &&
 			 l_state[depth] != UINT_MAX &&
 			 !matched[depth])
 	{
-		/* No matched outer rows, but LEFT/FULL OUTER */
+		/* No matched outer rows, but LEFT/FULL OUTER or ANTI */
 		result = true;
 	}
 	else
 		result = false;
 
 	/* save the current hash item */
-	l_state[depth] = (!khitem ? UINT_MAX : (cl_uint)((char *)&khitem->t.htup -
-													 (char *)kds_hash));
+	if (!khitem)
+		l_state[depth] = UINT_MAX;
+	else if (sitems)
+		l_state[depth] = (sindex << 1) + 2;
+	else
+		l_state[depth] = (cl_uint)((char *)&khitem->t.htup -
+								   (char *)kds_hash);
 	wr_index = write_pos[depth];
 	wr_index += pgstromStairlikeBinaryCount(result, &count);
 	if (get_local_id() == 0)
@@ -1243,9 +1921,11 @@ gpujoin_main(kern_gpujoin *kgjoin,
 	cl_uint		   *pstack_base;
 	cl_uint			l_state[GPUJOIN_MAX_DEPTH+1];
 	cl_bool			matched[GPUJOIN_MAX_DEPTH+1];
+	DECL_KERNEL_VARLENA_BUFFER(vlbuf);
 	__shared__ cl_int depth_thread0 __attribute__((unused));
 
 	INIT_KERNEL_CONTEXT(&kcxt, gpujoin_main, kparams);
+	SETUP_KERNEL_VARLENA_BUFFER(&kcxt, vlbuf, KERN_CONTEXT_VARLENA_BUFSZ);
 	assert(__ldg(&kds_src->format) == KDS_FORMAT_ROW ||
 		   __ldg(&kds_src->format) == KDS_FORMAT_BLOCK ||
 		   __ldg(&kds_src->format) == KDS_FORMAT_COLUMN);
@@ -1269,6 +1949,8 @@ gpujoin_main(kern_gpujoin *kgjoin,
 		 index += get_local_size())
 		pg_crc32_table[index] = kmrels->pg_crc32_table[index];
 	__syncthreads();
+	/* setup depth order */
+	gpujoin_setup_depth_order(kgjoin);
 
 	/* setup per-depth context */
 	memset(l_state, 0, sizeof(l_state));
@@ -1298,6 +1980,7 @@ gpujoin_main(kern_gpujoin *kgjoin,
 			/* LOAD FROM KDS_SRC (ROW/BLOCK/COLUMN) */
 			depth = gpujoin_load_source(&kcxt,
 										kgjoin,
+										kmrels,
 										kds_src,
 										PSTACK_DEPTH(depth),
 										l_state);
@@ -1328,7 +2011,7 @@ gpujoin_main(kern_gpujoin *kgjoin,
 											matched);
 #endif
 		}
-		else if (kmrels->chunks[depth-1].is_nestloop)
+		else if (kmrels->chunks[depth_order[depth]-1].is_nestloop)
 		{
 			/* NEST-LOOP */
 			depth = gpujoin_exec_nestloop(&kcxt,
@@ -1423,9 +2106,11 @@ gpujoin_right_outer(kern_gpujoin *kgjoin,
 	cl_uint		   *pstack_base;
 	cl_uint			l_state[GPUJOIN_MAX_DEPTH+1];
 	cl_bool			matched[GPUJOIN_MAX_DEPTH+1];
+	DECL_KERNEL_VARLENA_BUFFER(vlbuf);
 	__shared__ cl_int depth_thread0 __attribute__((unused));
 
 	INIT_KERNEL_CONTEXT(&kcxt, gpujoin_right_outer, kparams);
+	SETUP_KERNEL_VARLENA_BUFFER(&kcxt, vlbuf, KERN_CONTEXT_VARLENA_BUFSZ);
 	assert(KERN_MULTIRELS_RIGHT_OUTER_JOIN(kmrels, outer_depth));
 #ifndef GPUPREAGG_COMBINED_JOIN
 	assert(kds_dst->format == KDS_FORMAT_ROW);
@@ -1447,6 +2132,8 @@ gpujoin_right_outer(kern_gpujoin *kgjoin,
 		 index += get_local_size())
 		pg_crc32_table[index] = kmrels->pg_crc32_table[index];
 	__syncthreads();
+	/* setup depth order */
+	gpujoin_setup_depth_order(kgjoin);
 
 	/* setup per-depth context */
 	memset(l_state, 0, sizeof(l_state));
@@ -1503,7 +2190,7 @@ gpujoin_right_outer(kern_gpujoin *kgjoin,
 											matched);
 #endif		/* GPUPREAGG_COMBINED_JOIN */
 		}
-		else if (kmrels->chunks[depth-1].is_nestloop)
+		else if (kmrels->chunks[depth_order[depth]-1].is_nestloop)
 		{
 			/* NEST-LOOP */
 			depth = gpujoin_exec_nestloop(&kcxt,
@@ -103,6 +103,13 @@ typedef union
 #define GLOBAL_HASHSLOT_THRESHOLD(g_hashsize)	\
 	((size_t)(0.75 * (double)(g_hashsize)))
 
+/*
+ * GROUP BY with less number of groups than the threshold below uses
+ * a variant of the reduction kernel that merges the values of the same
+ * group in a warp prior to the atomic operations. (GPUPREAGG_SMALL_GROUPBY)
+ */
+#define GPUPREAGG_SMALL_GROUPBY_NGROUPS		64
+
 typedef struct
 {
 	cl_uint		lock;			/* lock when hash_size is expanded */
@@ -123,6 +130,19 @@ typedef struct
 
 #ifdef __CUDACC__
 
+/*
+ * KERN_DATA_STORE_SLOT_VLBUF
+ *
+ * varlena datum constructed by the initial projection must be valid until
+ * the final data move, so the per-thread varlena buffer is attached to the
+ * tail of kds_slot; host code reserves KERN_CONTEXT_VARLENA_BUFSZ bytes
+ * for each slot.
+ */
+#define KERN_DATA_STORE_SLOT_VLBUF(kds_slot,slot_index)				\
+	((char *)(kds_slot) + (kds_slot)->length -						\
+	 (size_t)STROMALIGN(KERN_CONTEXT_VARLENA_BUFSZ) *				\
+	 ((kds_slot)->nrooms - (slot_index)))
+
 /*
  * hash value calculation function - to be generated by PG-Strom on the fly
  */
@@ -149,13 +169,20 @@ gpupreagg_keymatch(kern_context *kcxt,
 
 /*
  * nogroup calculation function - to be generated by PG-Strom on the fly
+ *
+ * NOTE: @comp_values is the slot of the row owned by the current thread.
+ * Rounding error of the compensated summation is accumulated on the
+ * pcomp() column of this row, then it shall be merged to the owner by
+ * the reduction of the pcomp() column itself, because it always follows
+ * its partner column.
  */
 STATIC_FUNCTION(void)
 gpupreagg_nogroup_calc(cl_int attnum,
 					   cl_bool *p_accum_isnull,
 					   Datum   *p_accum_datum,
 					   cl_bool  newval_isnull,
-					   Datum    newval_datum);
+					   Datum    newval_datum,
+					   Datum   *comp_values);
 
 
 /*
@@ -166,7 +193,8 @@ gpupreagg_local_calc(cl_int attnum,
 					 cl_bool *p_accum_isnull,
 					 Datum   *p_accum_datum,
 					 cl_bool  newval_isnull,
-					 Datum    newval_datum);
+					 Datum    newval_datum,
+					 Datum   *comp_values);
 
 /*
  * global calculation function - to be generated by PG-Strom on the fly
@@ -317,10 +345,12 @@ gpupreagg_setup_row(kern_gpupreagg *kgpreagg,
 	cl_bool		   *slot_isnull;
 	cl_bool			try_next_window = true;
 	cl_bool			rc;
+	DECL_KERNEL_VARLENA_BUFFER(vlbuf);
 	__shared__ cl_uint	base;
 	__shared__ cl_int	status;
 
 	INIT_KERNEL_CONTEXT(&kcxt, gpupreagg_setup_row, kparams);
+	SETUP_KERNEL_VARLENA_BUFFER(&kcxt, vlbuf, KERN_CONTEXT_VARLENA_BUFSZ);
 	if (get_local_id() == 0)
 		status = StromError_Success;
 	__syncthreads();
@@ -340,6 +370,7 @@ gpupreagg_setup_row(kern_gpupreagg *kgpreagg,
 		{
 			tupitem = KERN_DATA_STORE_TUPITEM(kds_src, src_index);
 #ifdef GPUPREAGG_PULLUP_OUTER_SCAN
+			RESET_KERNEL_VARLENA_BUFFER(&kcxt);
 			rc = gpuscan_quals_eval(&kcxt, kds_src,
 									&tupitem->t_self,
 									&tupitem->htup);
@@ -379,11 +410,16 @@ gpupreagg_setup_row(kern_gpupreagg *kgpreagg,
 				slot_values = KERN_DATA_STORE_VALUES(kds_slot, slot_index);
 				slot_isnull = KERN_DATA_STORE_ISNULL(kds_slot, slot_index);
 
+				SETUP_KERNEL_VARLENA_BUFFER(&kcxt,
+						KERN_DATA_STORE_SLOT_VLBUF(kds_slot, slot_index),
+						KERN_CONTEXT_VARLENA_BUFSZ);
 				gpupreagg_projection_row(&kcxt,
 										 kds_src,
 										 &tupitem->htup,
 										 slot_values,
 										 slot_isnull);
+				SETUP_KERNEL_VARLENA_BUFFER(&kcxt, vlbuf,
+											KERN_CONTEXT_VARLENA_BUFSZ);
 			}
 		}
 		/* bailout if any error */
@@ -419,9 +455,11 @@ gpupreagg_setup_block(kern_gpupreagg *kgpreagg,
 	cl_uint			offset;
 	cl_bool			try_next_window = true;
 	cl_bool			thread_is_valid = false;
+	DECL_KERNEL_VARLENA_BUFFER(vlbuf);
 	__shared__ cl_uint	base;
 
 	INIT_KERNEL_CONTEXT(&kcxt, gpupreagg_setup_block, kparams);
+	SETUP_KERNEL_VARLENA_BUFFER(&kcxt, vlbuf, KERN_CONTEXT_VARLENA_BUFSZ);
 
 	assert(kds_src->format == KDS_FORMAT_BLOCK ||
 		   kds_slot->format == KDS_FORMAT_SLOT);
@@ -483,7 +521,10 @@ gpupreagg_setup_block(kern_gpupreagg *kgpreagg,
 			/* evaluation of the qualifier */
 #ifdef GPUPREAGG_HAS_OUTER_QUALS
 			if (htup)
+			{
+				RESET_KERNEL_VARLENA_BUFFER(&kcxt);
 				rc = gpuscan_quals_eval(&kcxt, kds_src, &t_self, htup);
+			}
 			/* bailout if any errors */
 			if (__syncthreads_count(kcxt.e.errcode) > 0)
 				goto out;
@@ -510,11 +551,16 @@ gpupreagg_setup_block(kern_gpupreagg *kgpreagg,
 					slot_values = KERN_DATA_STORE_VALUES(kds_slot, slot_index);
 					slot_isnull = KERN_DATA_STORE_ISNULL(kds_slot, slot_index);
 
+					SETUP_KERNEL_VARLENA_BUFFER(&kcxt,
+							KERN_DATA_STORE_SLOT_VLBUF(kds_slot, slot_index),
+							KERN_CONTEXT_VARLENA_BUFSZ);
 					gpupreagg_projection_row(&kcxt,
 											 kds_src,
 											 htup,
 											 slot_values,
 											 slot_isnull);
+					SETUP_KERNEL_VARLENA_BUFFER(&kcxt, vlbuf,
+											KERN_CONTEXT_VARLENA_BUFSZ);
 				}
 				/* bailout if any errors */
 				if (__syncthreads_count(kcxt.e.errcode) > 0)
@@ -566,10 +612,12 @@ gpupreagg_setup_column(kern_gpupreagg *kgpreagg,
 	cl_bool		   *slot_isnull;
 	cl_bool			try_next_window = true;
 	cl_bool			rc;
+	DECL_KERNEL_VARLENA_BUFFER(vlbuf);
 	__shared__ cl_uint	base;
 	__shared__ cl_int	status;
 
 	INIT_KERNEL_CONTEXT(&kcxt, gpupreagg_setup_column, kparams);
+	SETUP_KERNEL_VARLENA_BUFFER(&kcxt, vlbuf, KERN_CONTEXT_VARLENA_BUFSZ);
 	if (get_local_id() == 0)
 		status = StromError_Success;
 	__syncthreads();
@@ -588,6 +636,7 @@ gpupreagg_setup_column(kern_gpupreagg *kgpreagg,
 		if (src_index < src_nitems)
 		{
 #ifdef GPUPREAGG_PULLUP_OUTER_SCAN
+			RESET_KERNEL_VARLENA_BUFFER(&kcxt);
 			rc = gpuscan_quals_eval_column(&kcxt, kds_src, src_index);
 #else
 			rc = true;
@@ -623,11 +672,16 @@ gpupreagg_setup_column(kern_gpupreagg *kgpreagg,
 				slot_values = KERN_DATA_STORE_VALUES(kds_slot, slot_index);
 				slot_isnull = KERN_DATA_STORE_ISNULL(kds_slot, slot_index);
 
+				SETUP_KERNEL_VARLENA_BUFFER(&kcxt,
+						KERN_DATA_STORE_SLOT_VLBUF(kds_slot, slot_index),
+						KERN_CONTEXT_VARLENA_BUFSZ);
 				gpupreagg_projection_column(&kcxt,
 											kds_src,
 											src_index,
 											slot_values,
 											slot_isnull);
+				SETUP_KERNEL_VARLENA_BUFFER(&kcxt, vlbuf,
+											KERN_CONTEXT_VARLENA_BUFSZ);
 			}
 		}
 		/* bailout if any error */
@@ -728,7 +782,8 @@ gpupreagg_nogroup_reduction(kern_gpupreagg *kgpreagg,		/* in/out */
 										   &l_isnull[get_local_id()],
 										   &l_values[get_local_id()],
 										   l_isnull[get_local_id() + buddy],
-										   l_values[get_local_id() + buddy]);
+										   l_values[get_local_id() + buddy],
+										   slot_values);
 				}
 				__syncthreads();
 			}
@@ -772,6 +827,84 @@ gpupreagg_nogroup_reduction(kern_gpupreagg *kgpreagg,		/* in/out */
     kern_writeback_error_status(&kgpreagg->kerror, &kcxt.e);
 }
 
+#ifdef GPUPREAGG_FUSED_NOGROUP
+/*
+ * gpupreagg_fused_nogroup_reduction
+ *
+ * It is called by gpujoin_projection_slot() on the fused GpuJoin+GpuPreAgg,
+ * instead of writing out the joined rows onto the kds_slot. Private slot of
+ * the first @nvalids threads are reduced within the thread-block, then the
+ * thread-0 accumulates the result onto the kds_final.
+ */
+STATIC_FUNCTION(void)
+gpupreagg_fused_nogroup_reduction(kern_context *kcxt_gpreagg,
+								  kern_data_store *kds_final,
+								  cl_uint nvalids,
+								  cl_bool *slot_isnull,
+								  Datum *slot_values)
+{
+	kern_parambuf  *kparams = kcxt_gpreagg->kparams;
+	kern_gpupreagg *kgpreagg = (kern_gpupreagg *)
+		((char *)kparams - offsetof(kern_gpupreagg, kparams));
+	varlena		   *kparam_0 = (varlena *)kparam_get_value(kparams, 0);
+	cl_char		   *attr_is_preagg = (cl_char *)VARDATA(kparam_0);
+	cl_int			index;
+	__shared__ cl_bool	l_isnull[MAXTHREADS_PER_BLOCK];
+	__shared__ Datum	l_values[MAXTHREADS_PER_BLOCK];
+
+	assert(kds_final->format == KDS_FORMAT_SLOT);
+	assert(kds_final->ncols == GPUPREAGG_NUM_SLOT_COLUMNS);
+	for (index=0; index < kds_final->ncols; index++)
+	{
+		int		dist, buddy;
+
+		/* do nothing, if attribute is not preagg-function */
+		if (!attr_is_preagg[index])
+			continue;
+		/* load the value from the private slot to local */
+		if (get_local_id() < nvalids)
+		{
+			l_isnull[get_local_id()] = slot_isnull[index];
+			l_values[get_local_id()] = slot_values[index];
+		}
+		__syncthreads();
+		/* do reduction */
+		for (dist=2, buddy=1; dist < 2 * nvalids; buddy=dist, dist *= 2)
+		{
+			if ((get_local_id() & (dist-1)) == 0 &&
+				(get_local_id() + (buddy)) < nvalids)
+			{
+				gpupreagg_nogroup_calc(index,
+									   &l_isnull[get_local_id()],
+									   &l_values[get_local_id()],
+									   l_isnull[get_local_id() + buddy],
+									   l_values[get_local_id() + buddy],
+									   slot_values);
+			}
+			__syncthreads();
+		}
+		/* store this value to the private slot of thread-0 */
+		if (get_local_id() == 0)
+		{
+			slot_isnull[index] = l_isnull[0];
+			slot_values[index] = l_values[0];
+		}
+		__syncthreads();
+	}
+	/* update the final reduction buffer */
+	if (get_local_id() == 0 && nvalids > 0)
+	{
+		if (atomicCAS(&kds_final->nitems, 0, 1) == 0)
+			atomicAdd(&kgpreagg->num_groups, 1);
+		gpupreagg_global_calc(KERN_DATA_STORE_ISNULL(kds_final, 0),
+							  KERN_DATA_STORE_VALUES(kds_final, 0),
+							  slot_isnull,
+							  slot_values);
+	}
+	__syncthreads();
+}
+#endif	/* GPUPREAGG_FUSED_NOGROUP */
+
 /*
  * gpupreagg_init_final_hash
  *
@@ -1170,7 +1303,17 @@ retry_fnext:
  */
 
 /* keep shared memory consumption less than 32KB */
+#ifndef GPUPREAGG_SMALL_GROUPBY
 #define GPUPREAGG_LOCAL_HASHSIZE	1720
+#else
+/*
+ * A few groups are expected, so the local hash-slot can be smaller, but
+ * it still needs to have room for a block-size of new owners in addition
+ * to the owners less than get_local_size() / 8 that are kept over the
+ * loop; in exchange for l_owner_index[].
+ */
+#define GPUPREAGG_LOCAL_HASHSIZE	1200
+#endif
 
 KERNEL_FUNCTION_MAXTHREADS(void)
 gpupreagg_groupby_reduction(kern_gpupreagg *kgpreagg,		/* in/out */
@@ -1196,6 +1339,12 @@ gpupreagg_groupby_reduction(kern_gpupreagg *kgpreagg,		/* in/out */
 	cl_uint			owner_index;
 	cl_bool			is_owner = false;
 	cl_bool			is_last_reduction = false;
+#ifdef GPUPREAGG_SMALL_GROUPBY
+	cl_uint			lane_id = (get_local_id() & (warpSize - 1));
+	cl_uint			warp_base = get_local_id() - lane_id;
+	cl_uint			w_peers;
+	__shared__ cl_uint	l_owner_index[MAXTHREADS_PER_BLOCK];
+#endif
 	__shared__ cl_uint	crc32_table[256];
 	__shared__ cl_bool	l_isnull[MAXTHREADS_PER_BLOCK];
 	__shared__ Datum	l_values[MAXTHREADS_PER_BLOCK];
@@ -1327,6 +1476,34 @@ clean_restart:
 		if (__syncthreads_count(kcxt.e.errcode) > 0)
 			goto bailout;
 
+#ifdef GPUPREAGG_SMALL_GROUPBY
+		/*
+		 * Threads in a warp likely reference the same owner, because only
+		 * a few groups are expected. So, the first lane of the owner in
+		 * the warp (leader) collects the lanes of the same owner (peers),
+		 * then it merges their values privately for each column.
+		 */
+		l_owner_index[get_local_id()] = (!is_owner && kds_index < slot_nitems
+										 ? owner_index : UINT_MAX);
+		__syncthreads();
+		w_peers = 0;
+		if (!is_owner && kds_index < slot_nitems)
+		{
+			for (index = 0;
+				 index < warpSize && warp_base + index < get_local_size();
+				 index++)
+			{
+				if (l_owner_index[warp_base + index] != owner_index)
+					continue;
+				if (index < lane_id)
+				{
+					w_peers = 0;	/* not a leader */
+					break;
+				}
+				w_peers |= (1U << index);
+			}
+		}
+#endif
 		/* Local reduction for each column */
 		for (index=0; index < kds_slot->ncols; index++)
 		{
@@ -1340,6 +1517,35 @@ clean_restart:
 			}
 			__syncthreads();
 
+#ifdef GPUPREAGG_SMALL_GROUPBY
+			/* reduction by the leader lane, then atomic operation */
+			if (w_peers != 0)
+			{
+				cl_uint		mask = (w_peers & ~(1U << lane_id));
+				cl_bool		acm_isnull = l_isnull[get_local_id()];
+				Datum		acm_datum = l_values[get_local_id()];
+				cl_uint		i;
+
+				assert(owner_index < get_local_size());
+				while (mask != 0)
+				{
+					i = __ffs(mask) - 1;
+					mask &= ~(1U << i);
+					gpupreagg_nogroup_calc(index,
+										   &acm_isnull,
+										   &acm_datum,
+										   l_isnull[warp_base + i],
+										   l_values[warp_base + i],
+										   slot_values);
+				}
+				gpupreagg_local_calc(index,
+									 &l_isnull[owner_index],
+									 &l_values[owner_index],
+									 acm_isnull,
+									 acm_datum,
+									 slot_values);
+			}
+#else
 			/* reduction by atomic operation */
 			if (!is_owner && kds_index < slot_nitems)
 			{
@@ -1348,8 +1554,10 @@ clean_restart:
 									 &l_isnull[owner_index],
 									 &l_values[owner_index],
 									 l_isnull[get_local_id()],
-									 l_values[get_local_id()]);
+									 l_values[get_local_id()],
+									 slot_values);
 			}
+#endif
 			__syncthreads();
 
 			/* move the aggregation value */
@@ -1639,6 +1847,46 @@ aggcalc_atomic_add_double(cl_bool *p_accum_isnull, Datum *p_accum_datum,
 	}
 }
 
+/*
+ * aggcalc_(atomic|normal)_add_double_comp
+ *
+ * compensated version of the float8 summation. It adds the new value to
+ * the accumulator, then adds its rounding error (TwoSum) to *p_comp, that
+ * is the pcomp() column paired with the accumulator. Sum of these two
+ * columns keeps twice precision of float8, so the result is much less
+ * sensitive to the order of atomic operations.
+ */
+STATIC_INLINE(void)
+aggcalc_atomic_add_double_comp(cl_bool *p_accum_isnull, Datum *p_accum_datum,
+							   cl_bool newval_isnull, Datum newval_datum,
+							   Datum *p_comp)
+{
+	if (!newval_isnull)
+	{
+		cl_ulong	curval = *((cl_ulong *)p_accum_datum);
+		cl_ulong	newval;
+		cl_ulong	oldval;
+		cl_bool		comp_isnull;
+		cl_double	a, b, s, bb, err;
+
+		b = __longlong_as_double((cl_ulong)newval_datum);
+		do {
+			oldval = curval;
+			a = __longlong_as_double(oldval);
+			s = a + b;
+			newval = __double_as_longlong(s);
+		} while ((curval = atomicCAS((cl_ulong *)p_accum_datum,
+									 oldval, newval)) != oldval);
+		*p_accum_isnull = false;
+
+		bb = s - a;
+		err = (a - (s - bb)) + (b - bb);
+		if (err != 0.0)
+			aggcalc_atomic_add_double(&comp_isnull, p_comp,
+									  false, __double_as_longlong(err));
+	}
+}
+
 STATIC_INLINE(void)
 aggcalc_normal_min_short(cl_bool *p_accum_isnull, Datum *p_accum_datum,
 						 cl_bool newval_isnull, Datum newval_datum)
@@ -1810,5 +2058,23 @@ aggcalc_normal_add_double(cl_bool *p_accum_isnull, Datum *p_accum_datum,
 		*p_accum_isnull = false;
 	}
 }
+
+STATIC_INLINE(void)
+aggcalc_normal_add_double_comp(cl_bool *p_accum_isnull, Datum *p_accum_datum,
+							   cl_bool newval_isnull, Datum newval_datum,
+							   Datum *p_comp)
+{
+	if (!newval_isnull)
+	{
+		cl_double	a = *((cl_double *)p_accum_datum);
+		cl_double	b = __longlong_as_double((cl_ulong)newval_datum);
+		cl_double	s = a + b;
+		cl_double	bb = s - a;
+
+		*((cl_double *)p_accum_datum) = s;
+		*((cl_double *)p_comp) += (a - (s - bb)) + (b - bb);
+		*p_accum_isnull = false;
+	}
+}
 #endif	/* __CUDACC__ */
 #endif	/* CUDA_GPUPREAGG_H */
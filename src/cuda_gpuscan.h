@@ -29,12 +29,34 @@
  * | |     :         |  v
  * +-+---------------+ ---
  */
+/*
+ * kern_snapshot
+ *
+ * MVCC snapshot to check visibility of the tuples on GPU device, for the
+ * blocks directly loaded by NVMe-Strom even if not all-visible. xip[] has
+ * @xcnt top-level transactions, then @subxcnt sub-transactions.
+ */
+typedef struct {
+	cl_uint			xmin;		/* all XID < xmin are visible to me */
+	cl_uint			xmax;		/* all XID >= xmax are invisible to me */
+	cl_uint			xcnt;
+	cl_uint			subxcnt;
+	cl_bool			suboverflowed;
+	cl_uint			xip[FLEXIBLE_ARRAY_MEMBER];
+} kern_snapshot;
+
 struct kern_gpuscan {
 	kern_errorbuf	kerror;
 	cl_uint			read_src_pos;
 	cl_uint			nitems_in;
 	cl_uint			nitems_out;
 	cl_uint			extra_size;
+	/* bitmap of rows to be re-checked by CPU, see KERN_GPUSCAN_RECHECKBUF */
+	cl_uint			recheck_width;	/* bits per item of kds_src, or 0 */
+	cl_uint			recheck_nbits;
+	cl_uint			recheck_nitems;
+	/* length of kern_snapshot, if GPU checks visibility; see below */
+	cl_uint			snapshot_length;
 	/* performance profile */
 	struct {
 		cl_float	tv_kern_exec_quals;
@@ -56,10 +78,21 @@ typedef struct kern_gpuscan		kern_gpuscan;
 	STROMALIGN(offsetof(kern_resultbuf,			\
 		results[KERN_GPUSCAN_RESULTBUF(kgpuscan)->nrels * \
 				KERN_GPUSCAN_RESULTBUF(kgpuscan)->nrooms]))
+#define KERN_GPUSCAN_RECHECKBUF(kgpuscan)		\
+	((cl_uint *)((char *)KERN_GPUSCAN_RESULTBUF(kgpuscan) +	\
+				 KERN_GPUSCAN_RESULTBUF_LENGTH(kgpuscan)))
+#define KERN_GPUSCAN_RECHECKBUF_LENGTH(kgpuscan)	\
+	STROMALIGN(sizeof(cl_uint) * (((kgpuscan)->recheck_nbits + 31) / 32))
+#define KERN_GPUSCAN_SNAPSHOT(kgpuscan)			\
+	((kgpuscan)->snapshot_length == 0 ? NULL :	\
+	 (kern_snapshot *)((char *)KERN_GPUSCAN_RECHECKBUF(kgpuscan) +	\
+					   KERN_GPUSCAN_RECHECKBUF_LENGTH(kgpuscan)))
 #define KERN_GPUSCAN_LENGTH(kgpuscan)			\
 	(offsetof(kern_gpuscan, kparams) +			\
 	 KERN_GPUSCAN_PARAMBUF_LENGTH(kgpuscan) +	\
-	 KERN_GPUSCAN_RESULTBUF_LENGTH(kgpuscan))
+	 KERN_GPUSCAN_RESULTBUF_LENGTH(kgpuscan) +	\
+	 KERN_GPUSCAN_RECHECKBUF_LENGTH(kgpuscan) +	\
+	 STROMALIGN((kgpuscan)->snapshot_length))
 #define KERN_GPUSCAN_DMASEND_LENGTH(kgpuscan)	\
 	(offsetof(kern_gpuscan, kparams) +			\
 	 KERN_GPUSCAN_PARAMBUF_LENGTH(kgpuscan) +	\
@@ -151,6 +184,95 @@ PageGetMaxOffsetNumber(PageHeaderData *page)
 	return (pd_lower <= SizeOfPageHeaderData ? 0 :
 			(pd_lower - SizeOfPageHeaderData) / sizeof(ItemIdData));
 }
+
+/* definitions at access/transam.h */
+#define InvalidTransactionId		((TransactionId) 0)
+#define FrozenTransactionId			((TransactionId) 2)
+#define FirstNormalTransactionId	((TransactionId) 3)
+#define TransactionIdIsNormal(xid)	((xid) >= FirstNormalTransactionId)
+
+STATIC_INLINE(cl_bool)
+TransactionIdPrecedes(TransactionId id1, TransactionId id2)
+{
+	/* If either ID is a permanent XID then we can just do unsigned
+	 * comparison.  If both are normal, do a modulo-2^32 comparison. */
+	if (!TransactionIdIsNormal(id1) || !TransactionIdIsNormal(id2))
+		return (id1 < id2);
+	return ((cl_int)(id1 - id2) < 0);
+}
+
+/*
+ * gpuscan_xid_in_snapshot - equivalent to XidInMVCCSnapshot
+ *
+ * It returns 1 if the transaction is still in-progress from the standpoint
+ * of the snapshot, 0 if not, or -1 if CPU needs to lookup pg_subtrans
+ * because sub-transaction array is overflowed.
+ */
+STATIC_FUNCTION(cl_int)
+gpuscan_xid_in_snapshot(kern_snapshot *ksnap, TransactionId xid)
+{
+	cl_uint		i, nitems;
+
+	if (TransactionIdPrecedes(xid, ksnap->xmin))
+		return 0;
+	if (!TransactionIdPrecedes(xid, ksnap->xmax))
+		return 1;
+	if (ksnap->suboverflowed)
+		return -1;
+	nitems = ksnap->xcnt + ksnap->subxcnt;
+	for (i=0; i < nitems; i++)
+	{
+		if (ksnap->xip[i] == xid)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * gpuscan_tuple_visibility - equivalent to HeapTupleSatisfiesMVCC
+ *
+ * It returns 1 if the tuple is visible, 0 if invisible, or -1 if in-doubt.
+ * Only the hint bits are referenced, so CPU has to check visibility of the
+ * in-doubt tuples with the commit log. Tuples inserted or deleted by the
+ * current transaction are always in-doubt, because they have no hint bits
+ * and command-id is not considered here.
+ */
+STATIC_FUNCTION(cl_int)
+gpuscan_tuple_visibility(kern_snapshot *ksnap, HeapTupleHeaderData *htup)
+{
+	cl_ushort	infomask = htup->t_infomask;
+	cl_int		status;
+
+	/* inserting transaction */
+	if ((infomask & HEAP_XMIN_FROZEN) != HEAP_XMIN_FROZEN)
+	{
+		if ((infomask & HEAP_XMIN_INVALID) != 0)
+			return 0;
+		if ((infomask & HEAP_XMIN_COMMITTED) == 0 ||
+			(infomask & HEAP_MOVED) != 0)
+			return -1;
+		status = gpuscan_xid_in_snapshot(ksnap,
+										 htup->t_choice.t_heap.t_xmin);
+		if (status != 0)
+			return (status > 0 ? 0 : -1);
+	}
+
+	/* deleting or locking transaction */
+	if ((infomask & HEAP_XMAX_INVALID) != 0)
+		return 1;
+	if ((infomask & HEAP_XMAX_LOCK_ONLY) != 0 ||
+		(infomask & (HEAP_XMAX_IS_MULTI |
+					 HEAP_LOCK_MASK)) == HEAP_XMAX_EXCL_LOCK)
+		return 1;	/* locked only */
+	if ((infomask & HEAP_XMAX_IS_MULTI) != 0 ||
+		(infomask & HEAP_XMAX_COMMITTED) == 0)
+		return -1;
+	status = gpuscan_xid_in_snapshot(ksnap,
+									 htup->t_choice.t_heap.t_xmax);
+	if (status < 0)
+		return -1;
+	return (status > 0 ? 1 : 0);
+}
 #endif	/* __CUDACC__ */
 
 /*
@@ -187,7 +309,7 @@ KDS_BLOCK_REF_HTUP(kern_data_store *kds,
 	{
 		p_self->ip_blkid.bi_hi	= block_nr >> 16;
 		p_self->ip_blkid.bi_lo	= block_nr & 0xffff;
-		p_self->ip_posid		= lpp - pg_page->pd_linp;
+		p_self->ip_posid		= (lpp - pg_page->pd_linp) + 1;
 	}
 	if (p_len)
 		*p_len = ItemIdGetLength(lpp);
@@ -226,6 +348,35 @@ gpuscan_projection_column(kern_context *kcxt,
 						  cl_bool *tup_isnull,
 						  char *extra_buf);
 
+/*
+ * gpuscan_recheck_by_cpu
+ *
+ * It marks the row on the recheck bitmap if evaluation of the qualifiers
+ * or the device projection raised StromError_CpuReCheck, then clears the
+ * error. CPU re-checks only the marked rows later, and GPU results of the
+ * other rows are kept.
+ */
+STATIC_INLINE(cl_bool)
+gpuscan_recheck_by_cpu(kern_context *kcxt,
+					   kern_gpuscan *kgpuscan,
+					   cl_uint src_index,
+					   cl_uint line_no)
+{
+	cl_uint	   *bitmap = KERN_GPUSCAN_RECHECKBUF(kgpuscan);
+	cl_uint		bit;
+
+	if (kcxt->e.errcode != StromError_CpuReCheck ||
+		line_no >= kgpuscan->recheck_width)
+		return false;
+	bit = src_index * kgpuscan->recheck_width + line_no;
+	assert(bit < kgpuscan->recheck_nbits);
+	atomicOr(&bitmap[bit / 32], 1U << (bit % 32));
+	atomicAdd(&kgpuscan->recheck_nitems, 1);
+	kcxt->e.errcode = StromError_Success;
+
+	return true;
+}
+
 #ifdef GPUSCAN_KERNEL_REQUIRED
 /*
  * gpuscan_exec_quals_row - GpuScan logic for KDS_FORMAT_ROW
@@ -261,6 +412,7 @@ gpuscan_exec_quals_row(kern_gpuscan *kgpuscan,
 	char		   *tup_extra = NULL;
 #endif
 #endif
+	DECL_KERNEL_VARLENA_BUFFER(vlbuf);
 	__shared__ cl_int	src_base;
 	__shared__ cl_int	nitems_base;
 	__shared__ cl_int	usage_base	__attribute__((unused));
@@ -269,6 +421,7 @@ gpuscan_exec_quals_row(kern_gpuscan *kgpuscan,
 	assert(kds_src->format == KDS_FORMAT_ROW);
 	assert(!kds_dst || kds_dst->format == KDS_FORMAT_ROW);
 	INIT_KERNEL_CONTEXT(&kcxt, gpuscan_exec_quals_row, kparams);
+	SETUP_KERNEL_VARLENA_BUFFER(&kcxt, vlbuf, KERN_CONTEXT_VARLENA_BUFSZ);
 	if (get_local_id() == 0)
 		status = StromError_Success;
 	__syncthreads();
@@ -294,16 +447,41 @@ gpuscan_exec_quals_row(kern_gpuscan *kgpuscan,
 		if (src_index < src_nitems)
 		{
 			tupitem = KERN_DATA_STORE_TUPITEM(kds_src, src_index);
+			RESET_KERNEL_VARLENA_BUFFER(&kcxt);
 			rc = gpuscan_quals_eval(&kcxt, kds_src,
 									&tupitem->t_self,
 									&tupitem->htup);
+#ifdef GPUSCAN_HAS_WHERE_QUALS
+			if (gpuscan_recheck_by_cpu(&kcxt, kgpuscan, src_index, 0))
+				rc = false;
+#endif
+#ifdef GPUSCAN_HAS_DEVICE_PROJECTION
+			/*
+			 * extract the source tuple to the private slot, if any.
+			 * Rows that raised CpuReCheck here are also re-checked by CPU,
+			 * and the rest of the chunk keeps running on GPU.
+			 */
+			if (rc && kcxt.e.errcode == StromError_Success)
+			{
+				RESET_KERNEL_VARLENA_BUFFER(&kcxt);
+				gpuscan_projection_tuple(&kcxt,
+										 kds_src,
+										 &tupitem->htup,
+										 &tupitem->t_self,
+										 tup_values,
+										 tup_isnull,
+										 tup_extra);
+				if (gpuscan_recheck_by_cpu(&kcxt, kgpuscan, src_index, 0))
+					rc = false;
+			}
+#endif
 		}
 		else
 		{
 			tupitem = NULL;
 			rc = false;
 		}
-#ifdef GPUSCAN_HAS_WHERE_QUALS
+#if defined(GPUSCAN_HAS_WHERE_QUALS) || defined(GPUSCAN_HAS_DEVICE_PROJECTION)
 		/* bailout if any error */
 		if (__syncthreads_count(kcxt.e.errcode) > 0)
 			break;
@@ -318,16 +496,8 @@ gpuscan_exec_quals_row(kern_gpuscan *kgpuscan,
 			nitems_base = atomicAdd(&kds_dst->nitems, nvalids);
 		__syncthreads();
 
-		/* extract the source tuple to the private slot, if any */
 		if (tupitem && rc)
 		{
-			gpuscan_projection_tuple(&kcxt,
-									 kds_src,
-									 &tupitem->htup,
-									 &tupitem->t_self,
-									 tup_values,
-									 tup_isnull,
-									 tup_extra);
 			required = MAXALIGN(offsetof(kern_tupitem, htup) +
 								compute_heaptuple_size(&kcxt,
 													   kds_dst,
@@ -430,6 +600,9 @@ gpuscan_exec_quals_block(kern_gpuscan *kgpuscan,
 						 kern_data_store *kds_dst)
 {
 	kern_parambuf  *kparams = KERN_GPUSCAN_PARAMBUF(kgpuscan);
+	kern_resultbuf *kresults		__attribute__((unused))
+		= KERN_GPUSCAN_RESULTBUF(kgpuscan);
+	kern_snapshot  *ksnap = KERN_GPUSCAN_SNAPSHOT(kgpuscan);
 	kern_context	kcxt;
 	cl_uint			src_nitems = kds_src->nitems;
 	cl_uint			part_sz;
@@ -456,14 +629,16 @@ gpuscan_exec_quals_block(kern_gpuscan *kgpuscan,
 	char		   *tup_extra = NULL;
 #endif
 #endif
+	DECL_KERNEL_VARLENA_BUFFER(vlbuf);
 	__shared__ cl_uint	base;
 	__shared__ cl_uint	nitems_base;
 	__shared__ cl_uint	usage_base;
 	__shared__ cl_int	status __attribute__((unused));
 
 	assert(kds_src->format == KDS_FORMAT_BLOCK);
-	assert(kds_dst->format == KDS_FORMAT_ROW);
+	assert(!kds_dst || kds_dst->format == KDS_FORMAT_ROW);
 	INIT_KERNEL_CONTEXT(&kcxt, gpuscan_exec_quals_block, kparams);
+	SETUP_KERNEL_VARLENA_BUFFER(&kcxt, vlbuf, KERN_CONTEXT_VARLENA_BUFSZ);
 	if (get_local_id() == 0)
 		status = StromError_Success;
 	__syncthreads();
@@ -493,6 +668,7 @@ gpuscan_exec_quals_block(kern_gpuscan *kgpuscan,
 
 		do {
 			HeapTupleHeaderData *htup = NULL;
+			ItemIdData *lpp = NULL;
 			ItemPointerData t_self;
 			PageHeaderData *pg_page;
 			BlockNumber	block_nr;
@@ -513,46 +689,109 @@ gpuscan_exec_quals_block(kern_gpuscan *kgpuscan,
 
 				if (line_no < n_lines)
 				{
-					ItemIdData *lpp = PageGetItemId(pg_page, line_no+1);
+					lpp = PageGetItemId(pg_page, line_no+1);
 					if (ItemIdIsNormal(lpp))
 						htup = PageGetItem(pg_page, lpp);
 					t_len = ItemIdGetLength(lpp);
 				}
+
+				/*
+				 * Visibility check of the tuple, if the block is directly
+				 * loaded by NVMe-Strom but not all-visible. In-doubt rows
+				 * are marked on the recheck bitmap, then CPU checks its
+				 * visibility and qualifiers.
+				 */
+				if (htup && ksnap &&
+					(__ldg(&pg_page->pd_flags) & PD_ALL_VISIBLE) == 0)
+				{
+					cl_int	visibility = gpuscan_tuple_visibility(ksnap, htup);
+
+					if (visibility < 0)
+					{
+						STROM_SET_ERROR(&kcxt.e, StromError_CpuReCheck);
+						gpuscan_recheck_by_cpu(&kcxt, kgpuscan,
+											   part_id, line_no);
+					}
+					if (visibility <= 0)
+						htup = NULL;
+				}
 			}
 
 			/* evaluation of the qualifiers */
 #ifdef GPUSCAN_HAS_WHERE_QUALS
 			if (htup)
+			{
+				RESET_KERNEL_VARLENA_BUFFER(&kcxt);
 				rc = gpuscan_quals_eval(&kcxt, kds_src,
 										&t_self,
 										htup);
+				if (gpuscan_recheck_by_cpu(&kcxt, kgpuscan, part_id, line_no))
+					rc = false;
+			}
 			else
 				rc = false;
+#else
+			rc = true;
+#endif
+#ifdef GPUSCAN_HAS_DEVICE_PROJECTION
+			/* device projection; CpuReCheck is handled like the qualifiers */
+			if (htup && rc && kcxt.e.errcode == StromError_Success)
+			{
+				RESET_KERNEL_VARLENA_BUFFER(&kcxt);
+				gpuscan_projection_tuple(&kcxt,
+										 kds_src,
+										 htup,
+										 &t_self,
+										 tup_values,
+										 tup_isnull,
+										 tup_extra);
+				if (gpuscan_recheck_by_cpu(&kcxt, kgpuscan, part_id, line_no))
+					rc = false;
+			}
+#endif
+#if defined(GPUSCAN_HAS_WHERE_QUALS) || defined(GPUSCAN_HAS_DEVICE_PROJECTION)
 			/* bailout if any error */
 			if (__syncthreads_count(kcxt.e.errcode) > 0)
 			{
 				try_next_window = false;
 				break;
 			}
-#else
-			rc = true;
 #endif
 			/* how many rows servived WHERE-clause evaluations? */
 			nitems_offset = pgstromStairlikeBinaryCount(htup && rc, &nvalids);
 			if (nvalids == 0)
 				goto skip;
 
+#ifndef GPUSCAN_HAS_DEVICE_PROJECTION
+			/*
+			 * Late materialization; host side also has the identical blocks,
+			 * so we write back only offset of the line item, then CPU fetches
+			 * the tuple from the source buffer.
+			 */
+			if (!kds_dst)
+			{
+				if (get_local_id() == 0)
+					nitems_base = atomicAdd(&kresults->nitems, nvalids);
+				__syncthreads();
+
+				if (nitems_base + nvalids > kresults->nrooms)
+				{
+					STROM_SET_ERROR(&kcxt.e, StromError_DataStoreNoSpace);
+					try_next_window = false;
+					break;
+				}
+				if (htup && rc)
+				{
+					kresults->results[nitems_base + nitems_offset] = (cl_uint)
+						((char *)lpp - (char *)kds_src);
+				}
+				goto skip;
+			}
+#endif
 			/* store the result heap-tuple to destination buffer */
 			if (htup && rc)
 			{
 #ifdef GPUSCAN_HAS_DEVICE_PROJECTION
-				gpuscan_projection_tuple(&kcxt,
-										 kds_src,
-										 htup,
-										 &t_self,
-										 tup_values,
-										 tup_isnull,
-										 tup_extra);
 				required = MAXALIGN(offsetof(kern_tupitem, htup) +
 									compute_heaptuple_size(&kcxt,
 														   kds_dst,
@@ -698,6 +937,7 @@ gpuscan_exec_quals_column(kern_gpuscan *kgpuscan,
 #else
 	cl_char		   *tup_extra __attribute__((unused)) = NULL;
 #endif
+	DECL_KERNEL_VARLENA_BUFFER(vlbuf);
 	__shared__ cl_int	src_base;
 	__shared__ cl_int	nitems_base;
 	__shared__ cl_int	usage_base	__attribute__((unused));
@@ -706,6 +946,7 @@ gpuscan_exec_quals_column(kern_gpuscan *kgpuscan,
 	assert(__ldg(&kds_src->format) == KDS_FORMAT_COLUMN);
 	assert(!kds_dst || __ldg(&kds_dst->format) == KDS_FORMAT_ROW);
 	INIT_KERNEL_CONTEXT(&kcxt, gpuscan_exec_quals_column, kparams);
+	SETUP_KERNEL_VARLENA_BUFFER(&kcxt, vlbuf, KERN_CONTEXT_VARLENA_BUFSZ);
 	if (get_local_id() == 0)
 		status = StromError_Success;
 	__syncthreads();
@@ -729,7 +970,10 @@ gpuscan_exec_quals_column(kern_gpuscan *kgpuscan,
 		/* Evalidation of the rows by WHERE-clause */
 		src_index = src_base + get_local_id();
 		if (src_index < src_nitems)
+		{
+			RESET_KERNEL_VARLENA_BUFFER(&kcxt);
 			rc = gpuscan_quals_eval_column(&kcxt, kds_src, src_index);
+		}
 		else
 			rc = false;
 #ifdef GPUSCAN_HAS_WHERE_QUALS
@@ -754,6 +998,7 @@ gpuscan_exec_quals_column(kern_gpuscan *kgpuscan,
 
 		if (rc)
 		{
+			RESET_KERNEL_VARLENA_BUFFER(&kcxt);
 			gpuscan_projection_column(&kcxt,
 									  kds_src,
 									  src_index,
@@ -825,6 +1070,101 @@ gpuscan_exec_quals_column(kern_gpuscan *kgpuscan,
 	}
 	kern_writeback_error_status(&kgpuscan->kerror, &kcxt.e);
 }
+
+/*
+ * gpuscan_unpack_column - expand a bit-packed column of KDS_FORMAT_COLUMN
+ *
+ * Host code sets up the header of kds_dst, then the colidx-th column of
+ * kds_src shall be unpacked to the plain values array of kds_dst, prior to
+ * execution of gpuscan_exec_quals_column.
+ */
+KERNEL_FUNCTION(void)
+gpuscan_unpack_column(kern_data_store *kds_dst,
+					  kern_data_store *kds_src,
+					  cl_uint colidx)
+{
+	kern_colmeta   *cmeta = &kds_dst->colmeta[colidx];
+	kern_packed_column *pack;
+	cl_uint			nitems = __ldg(&kds_src->nitems);
+	cl_uint			unitsz;
+	cl_uint			index;
+	cl_long			value;
+	char		   *values;
+	char		   *s_nullmap;
+	char		   *d_nullmap;
+
+	assert(__ldg(&kds_src->colmeta[colidx].attpacked) &&
+		   !__ldg(&cmeta->attpacked));
+	values = ((char *)kds_dst +
+			  (__ldg(&cmeta->va_offset) << MAXIMUM_ALIGNOF_SHIFT));
+	/* NULL bitmap, if any */
+	if (__ldg(&cmeta->extra_sz) > 0)
+	{
+		pack = (kern_packed_column *)
+			((char *)kds_src +
+			 (__ldg(&kds_src->colmeta[colidx].va_offset)
+			  << MAXIMUM_ALIGNOF_SHIFT));
+		unitsz = TYPEALIGN(__ldg(&cmeta->attalign), __ldg(&cmeta->attlen));
+		s_nullmap = ((char *)pack +
+					 KERN_PACKED_COLUMN_LENGTH(__ldg(&pack->nbits), nitems));
+		d_nullmap = values + MAXALIGN(unitsz * nitems);
+		for (index = get_global_id();
+			 index < BITMAPLEN(nitems);
+			 index += get_global_size())
+		{
+			d_nullmap[index] = s_nullmap[index];
+		}
+	}
+	/* unpack the values */
+	for (index = get_global_id();
+		 index < nitems;
+		 index += get_global_size())
+	{
+		if (!kern_get_packed_column(kds_src, colidx, index, &value))
+			value = 0;
+		if (__ldg(&cmeta->attlen) == sizeof(cl_short))
+			((cl_short *)values)[index] = (cl_short)value;
+		else if (__ldg(&cmeta->attlen) == sizeof(cl_int))
+			((cl_int *)values)[index] = (cl_int)value;
+		else
+			((cl_long *)values)[index] = value;
+	}
+}
+
+/*
+ * gpuscan_gather_blocks - copy blocks on the shared buffer to kds_src
+ *
+ * Host code registers the shared buffer as page-locked host memory, then
+ * GPU copies the all-visible blocks to the KDS_FORMAT_BLOCK directly,
+ * prior to execution of gpuscan_exec_quals_block. @nblocks blocks are
+ * stored from the @base_index'th block of kds_src.
+ */
+KERNEL_FUNCTION(void)
+gpuscan_gather_blocks(kern_data_store *kds_src,
+					  char *buffer_blocks,
+					  cl_uint *buffer_ids,
+					  cl_uint base_index,
+					  cl_uint nblocks)
+{
+	cl_uint		index;
+	cl_uint		i;
+
+	assert(__ldg(&kds_src->format) == KDS_FORMAT_BLOCK);
+	for (index = get_global_index();
+		 index < nblocks;
+		 index += gridDim.x)
+	{
+		cl_ulong   *src = (cl_ulong *)
+			(buffer_blocks + (size_t)__ldg(&buffer_ids[index]) * BLCKSZ);
+		cl_ulong   *dst = (cl_ulong *)
+			KERN_DATA_STORE_BLOCK_PGPAGE(kds_src, base_index + index);
+
+		for (i = get_local_id();
+			 i < BLCKSZ / sizeof(cl_ulong);
+			 i += get_local_size())
+			dst[i] = src[i];
+	}
+}
 #endif	/* GPUSCAN_KERNEL_REQUIRED */
 #endif	/* __CUDACC__ */
 #endif	/* CUDA_GPUSCAN_H */
@@ -0,0 +1,161 @@
+/*
+ * cuda_gpusort.h
+ *
+ * CUDA device code specific to GpuSort logic
+ * --
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef CUDA_GPUSORT_H
+#define CUDA_GPUSORT_H
+
+/*
+ * +-----------------+
+ * | kern_gpusort    |
+ * | +---------------+
+ * | | kern_errbuf   |
+ * | +---------------+ ---
+ * | | kern_parembuf |  ^
+ * | |     :         |  | parameter buffer length
+ * | |     :         |  v
+ * +-+---------------+ ---
+ */
+struct kern_gpusort {
+	kern_errorbuf	kerror;
+	cl_uint			bound;		/* number of rows to be kept (top-k) */
+	cl_uint			part_size;	/* number of rows per partition; 2^N */
+	kern_parambuf	kparams;
+};
+typedef struct kern_gpusort		kern_gpusort;
+
+#define KERN_GPUSORT_PARAMBUF(kgpusort)			\
+	((kern_parambuf *)(&(kgpusort)->kparams))
+#define KERN_GPUSORT_PARAMBUF_LENGTH(kgpusort)	\
+	STROMALIGN((kgpusort)->kparams.length)
+#define KERN_GPUSORT_LENGTH(kgpusort)			\
+	(offsetof(kern_gpusort, kparams) +			\
+	 KERN_GPUSORT_PARAMBUF_LENGTH(kgpusort))
+
+/*
+ * KERN_GPUSORT_NITEMS_OUT - number of the candidate rows after a step of
+ * gpusort_topk_local. Each partition keeps the first @bound rows at most,
+ * and only the last partition may be smaller than @part_size.
+ */
+#define KERN_GPUSORT_NITEMS_OUT(nitems_in,bound,part_size)			\
+	((((nitems_in) + (part_size) - 1) / (part_size) - 1) * (bound) +	\
+	 Min((bound), (nitems_in) -										\
+		 (((nitems_in) + (part_size) - 1) / (part_size) - 1) * (part_size)))
+
+#ifdef __CUDACC__
+/*
+ * forward declaration of the function to be generated on the fly
+ */
+STATIC_FUNCTION(cl_int)
+gpusort_keycomp(kern_context *kcxt,
+				kern_data_store *kds,
+				cl_uint x_index,
+				cl_uint y_index);
+
+/*
+ * gpusort_topk_local
+ *
+ * It loads a partition of the row indexes onto the shared memory, then
+ * sorts them by bitonic-sorting, and writes back the first @bound rows
+ * to the index_out[]. Rows beyond the @nitems_in are considered as
+ * infinite; so no comparison is needed. Host code repeats this step
+ * until the number of candidates gets equal or less than the @bound.
+ * If @index_in is NULL, it considers the identical index of kds_src.
+ *
+ * The partition size is not tied to the block size, so the least
+ * power of 2 larger than 2 * @bound is also available, to reduce the
+ * number of candidates at least by half for each step.
+ */
+KERNEL_FUNCTION(void)
+gpusort_topk_local(kern_gpusort *kgpusort,
+				   kern_data_store *kds_src,
+				   cl_uint *index_in,
+				   cl_uint *index_out,
+				   cl_uint nitems_in)
+{
+	kern_parambuf  *kparams = KERN_GPUSORT_PARAMBUF(kgpusort);
+	kern_context	kcxt;
+	cl_uint		   *localIdx = SHARED_WORKMEM(cl_uint);
+	cl_uint			bound = kgpusort->bound;
+	cl_uint			part_size = kgpusort->part_size;
+	cl_uint			nparts = (nitems_in + part_size - 1) / part_size;
+	cl_uint			part_index;
+	cl_uint			blockSize;
+	cl_uint			unitSize;
+	cl_uint			i;
+
+	assert(kds_src->format == KDS_FORMAT_ROW);
+	INIT_KERNEL_CONTEXT(&kcxt, gpusort_topk_local, kparams);
+
+	for (part_index = get_global_index();
+		 part_index < nparts;
+		 part_index += gridDim.x)
+	{
+		cl_uint		part_base = part_index * part_size;
+		cl_uint		localLimit = Min(part_size, nitems_in - part_base);
+
+		/* Load index to localIdx[] */
+		for (i = get_local_id(); i < localLimit; i += get_local_size())
+			localIdx[i] = (index_in ? index_in[part_base + i] : part_base + i);
+		__syncthreads();
+
+		for (blockSize = 2; blockSize <= part_size; blockSize *= 2)
+		{
+			for (unitSize = blockSize; unitSize >= 2; unitSize /= 2)
+			{
+				cl_uint		unitMask		= (unitSize - 1);
+				cl_uint		halfUnitSize	= (unitSize >> 1);
+				cl_uint		halfUnitMask	= (halfUnitSize - 1);
+				cl_bool		reversing		= (unitSize == blockSize);
+				cl_uint		idx0, idx1;
+
+				for (i = get_local_id();
+					 i < part_size / 2;
+					 i += get_local_size())
+				{
+					idx0 = (((i & ~halfUnitMask) << 1) +
+							(i & halfUnitMask));
+					idx1 = (reversing
+							? ((idx0 & ~unitMask) | (~idx0 & unitMask))
+							: (halfUnitSize + idx0));
+					if (idx1 < localLimit)
+					{
+						cl_uint		pos0 = localIdx[idx0];
+						cl_uint		pos1 = localIdx[idx1];
+
+						if (gpusort_keycomp(&kcxt, kds_src, pos0, pos1) > 0)
+						{
+							/* swap them */
+							localIdx[idx0] = pos1;
+							localIdx[idx1] = pos0;
+						}
+					}
+				}
+				__syncthreads();
+			}
+		}
+		/* write back the first @bound rows of the partition */
+		for (i = get_local_id();
+			 i < Min(bound, localLimit);
+			 i += get_local_size())
+			index_out[part_index * bound + i] = localIdx[i];
+		__syncthreads();
+	}
+	/* any error during run-time? */
+	kern_writeback_error_status(&kgpusort->kerror, &kcxt.e);
+}
+#endif	/* __CUDACC__ */
+#endif	/* CUDA_GPUSORT_H */
@@ -0,0 +1,326 @@
+/*
+ * cuda_gpuwindow.h
+ *
+ * CUDA device code specific to GpuWindow logic
+ * --
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef CUDA_GPUWINDOW_H
+#define CUDA_GPUWINDOW_H
+
+/*
+ * Kind of window functions supported by GpuWindow
+ */
+#define GPUWINDOW_FUNC__ROW_NUMBER		1
+#define GPUWINDOW_FUNC__RANK			2
+#define GPUWINDOW_FUNC__DENSE_RANK		3
+#define GPUWINDOW_FUNC__COUNT			4
+#define GPUWINDOW_FUNC__SUM_INT			5
+#define GPUWINDOW_FUNC__SUM_FP			6
+#define GPUWINDOW_FUNC__AVG_INT			7
+#define GPUWINDOW_FUNC__AVG_FP			8
+
+#define GPUWINDOW_MAX_NFUNCS			32
+
+/*
+ * kern_windowitem - a running state of window function per row
+ *
+ * GPU kernel initializes the item for each row, then runs segmented scan
+ * by the partition boundary. As a result, each item has the state from the
+ * head of the partition (or the chunk, if partition begins on the previous
+ * chunk) to the current row. Semantics of the fields depend on the kind.
+ *
+ * ROW_NUMBER ... @count is the row number in the partition
+ * RANK       ... @count is the row number, @ival is the row index of the
+ *                head of the peer group (max-scan instead of sum)
+ * DENSE_RANK ... @count is the number of peer groups so far
+ * COUNT      ... @count is the number of (non-NULL) values so far
+ * SUM/AVG    ... @ival or @fval is the sum, @count is the number of
+ *                non-NULL values so far
+ */
+typedef struct
+{
+	cl_long		ival;
+	cl_double	fval;
+	cl_long		count;
+} kern_windowitem;
+
+/*
+ * +-----------------+
+ * | kern_gpuwindow  |
+ * | +---------------+
+ * | | kern_errbuf   |
+ * | +---------------+ ---
+ * | | kern_parembuf |  ^
+ * | |     :         |  | parameter buffer length
+ * | |     :         |  v
+ * +-+---------------+ ---
+ */
+struct kern_gpuwindow {
+	kern_errorbuf	kerror;
+	cl_uint			nitems;		/* number of rows in the chunk */
+	cl_uint			nfuncs;		/* number of window functions */
+	cl_char			func_kinds[GPUWINDOW_MAX_NFUNCS];
+	kern_parambuf	kparams;
+};
+typedef struct kern_gpuwindow	kern_gpuwindow;
+
+#define KERN_GPUWINDOW_PARAMBUF(kgwin)			\
+	((kern_parambuf *)(&(kgwin)->kparams))
+#define KERN_GPUWINDOW_PARAMBUF_LENGTH(kgwin)	\
+	STROMALIGN((kgwin)->kparams.length)
+#define KERN_GPUWINDOW_LENGTH(kgwin)			\
+	(offsetof(kern_gpuwindow, kparams) +		\
+	 KERN_GPUWINDOW_PARAMBUF_LENGTH(kgwin))
+
+/*
+ * gpuwindow_combine_item - combines two running states (x precedes y)
+ */
+STATIC_INLINE(void)
+gpuwindow_combine_item(cl_char func_kind,
+					   kern_windowitem *x,
+					   kern_windowitem *y)
+{
+	if (func_kind == GPUWINDOW_FUNC__RANK)
+		y->ival = Max(x->ival, y->ival);
+	else
+		y->ival += x->ival;
+	y->fval += x->fval;
+	y->count += x->count;
+}
+
+#ifdef __CUDACC__
+/*
+ * forward declaration of the function to be generated on the fly
+ */
+STATIC_FUNCTION(cl_bool)
+gpuwindow_partition_equal(kern_context *kcxt,
+						  kern_data_store *kds,
+						  cl_uint x_index,
+						  cl_uint y_index);
+STATIC_FUNCTION(cl_bool)
+gpuwindow_peer_equal(kern_context *kcxt,
+					 kern_data_store *kds,
+					 cl_uint x_index,
+					 cl_uint y_index);
+STATIC_FUNCTION(void)
+gpuwindow_setup_items(kern_context *kcxt,
+					  kern_data_store *kds,
+					  cl_uint row_index,
+					  cl_bool peer_head,
+					  kern_windowitem *witems,
+					  cl_uint nitems);
+
+/*
+ * gpuwindow_setup
+ *
+ * It marks the head of partitions, then initializes the window items of
+ * every row. The first row of the chunk is always considered as a head
+ * of partition; host code connects the partition across the chunks.
+ */
+KERNEL_FUNCTION(void)
+gpuwindow_setup(kern_gpuwindow *kgwin,
+				kern_data_store *kds_src,
+				kern_windowitem *witems,
+				cl_char *part_head)
+{
+	kern_parambuf  *kparams = KERN_GPUWINDOW_PARAMBUF(kgwin);
+	kern_context	kcxt;
+	cl_uint			nitems = kgwin->nitems;
+	cl_uint			index;
+	cl_bool			is_part_head;
+	cl_bool			is_peer_head;
+
+	assert(kds_src->format == KDS_FORMAT_ROW);
+	INIT_KERNEL_CONTEXT(&kcxt, gpuwindow_setup, kparams);
+
+	for (index = get_global_id();
+		 index < nitems;
+		 index += get_global_size())
+	{
+		is_part_head = (index == 0 ||
+						!gpuwindow_partition_equal(&kcxt, kds_src,
+												   index - 1, index));
+		is_peer_head = (is_part_head ||
+						!gpuwindow_peer_equal(&kcxt, kds_src,
+											  index - 1, index));
+		part_head[index] = is_part_head;
+		gpuwindow_setup_items(&kcxt, kds_src, index, is_peer_head,
+							  witems, nitems);
+	}
+	/* any error during run-time? */
+	kern_writeback_error_status(&kgwin->kerror, &kcxt.e);
+}
+
+/*
+ * gpuwindow_scan_local
+ *
+ * It runs segmented inclusive scan on the window items within the block,
+ * then saves the total of the last segment and whether the block contains
+ * any head of partition, to be carried to the next blocks.
+ */
+KERNEL_FUNCTION_MAXTHREADS(void)
+gpuwindow_scan_local(kern_gpuwindow *kgwin,
+					 kern_windowitem *witems,
+					 cl_char *part_head,
+					 kern_windowitem *block_carry,
+					 cl_char *block_head)
+{
+	kern_parambuf  *kparams = KERN_GPUWINDOW_PARAMBUF(kgwin);
+	kern_context	kcxt;
+	cl_uint			nitems = kgwin->nitems;
+	cl_uint			nfuncs = kgwin->nfuncs;
+	cl_uint			index = get_global_id();
+	cl_uint			lid = get_local_id();
+	cl_uint			unitsz;
+	cl_uint			k;
+	kern_windowitem	item;
+	cl_char			flag;
+	__shared__ kern_windowitem s_items[MAXTHREADS_PER_BLOCK];
+	__shared__ cl_char s_flags[MAXTHREADS_PER_BLOCK];
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpuwindow_scan_local, kparams);
+
+	for (k=0; k < nfuncs; k++)
+	{
+		kern_windowitem *items = witems + (size_t)k * nitems;
+		cl_char		func_kind = kgwin->func_kinds[k];
+
+		if (index < nitems)
+		{
+			s_items[lid] = items[index];
+			s_flags[lid] = part_head[index];
+		}
+		else
+		{
+			memset(&s_items[lid], 0, sizeof(kern_windowitem));
+			s_flags[lid] = false;
+		}
+		__syncthreads();
+
+		for (unitsz=1; unitsz < get_local_size(); unitsz *= 2)
+		{
+			item = s_items[lid];
+			flag = s_flags[lid];
+			if (lid >= unitsz && !flag)
+			{
+				gpuwindow_combine_item(func_kind,
+									   &s_items[lid - unitsz], &item);
+				flag = s_flags[lid - unitsz];
+			}
+			__syncthreads();
+			s_items[lid] = item;
+			s_flags[lid] |= flag;
+			__syncthreads();
+		}
+
+		if (index < nitems)
+			items[index] = s_items[lid];
+		if (lid == get_local_size() - 1)
+		{
+			block_carry[(size_t)k * gridDim.x + blockIdx.x] = s_items[lid];
+			block_head[blockIdx.x] = s_flags[lid];
+		}
+		__syncthreads();
+	}
+	/* any error during run-time? */
+	kern_writeback_error_status(&kgwin->kerror, &kcxt.e);
+}
+
+/*
+ * gpuwindow_scan_carry
+ *
+ * It replaces the total of the blocks by the carry from the preceding
+ * blocks. Number of blocks is not large, so each thread runs sequential
+ * scan for each window function.
+ */
+KERNEL_FUNCTION(void)
+gpuwindow_scan_carry(kern_gpuwindow *kgwin,
+					 kern_windowitem *block_carry,
+					 cl_char *block_head,
+					 cl_uint nblocks)
+{
+	kern_parambuf  *kparams = KERN_GPUWINDOW_PARAMBUF(kgwin);
+	kern_context	kcxt;
+	cl_uint			k, i;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpuwindow_scan_carry, kparams);
+
+	for (k = get_global_id(); k < kgwin->nfuncs; k += get_global_size())
+	{
+		kern_windowitem *carry = block_carry + (size_t)k * nblocks;
+		cl_char		func_kind = kgwin->func_kinds[k];
+		kern_windowitem	running;
+		kern_windowitem	total;
+
+		memset(&running, 0, sizeof(kern_windowitem));
+		for (i=0; i < nblocks; i++)
+		{
+			total = carry[i];
+			carry[i] = running;
+			if (!block_head[i])
+				gpuwindow_combine_item(func_kind, &running, &total);
+			running = total;
+		}
+	}
+	/* any error during run-time? */
+	kern_writeback_error_status(&kgwin->kerror, &kcxt.e);
+}
+
+/*
+ * gpuwindow_scan_final
+ *
+ * It applies the carry from the preceding blocks on the rows prior to the
+ * first head of partition in the block.
+ */
+KERNEL_FUNCTION_MAXTHREADS(void)
+gpuwindow_scan_final(kern_gpuwindow *kgwin,
+					 kern_windowitem *witems,
+					 cl_char *part_head,
+					 kern_windowitem *block_carry)
+{
+	kern_parambuf  *kparams = KERN_GPUWINDOW_PARAMBUF(kgwin);
+	kern_context	kcxt;
+	cl_uint			nitems = kgwin->nitems;
+	cl_uint			index = get_global_id();
+	cl_uint			k;
+	__shared__ cl_uint first_head;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpuwindow_scan_final, kparams);
+
+	if (get_local_id() == 0)
+		first_head = UINT_MAX;
+	__syncthreads();
+	if (index < nitems && part_head[index])
+		atomicMin(&first_head, get_local_id());
+	__syncthreads();
+
+	if (blockIdx.x > 0 && index < nitems && get_local_id() < first_head)
+	{
+		for (k=0; k < kgwin->nfuncs; k++)
+		{
+			kern_windowitem *items = witems + (size_t)k * nitems;
+			kern_windowitem	item = items[index];
+
+			gpuwindow_combine_item(kgwin->func_kinds[k],
+								   &block_carry[(size_t)k * gridDim.x +
+												blockIdx.x],
+								   &item);
+			items[index] = item;
+		}
+	}
+	/* any error during run-time? */
+	kern_writeback_error_status(&kgwin->kerror, &kcxt.e);
+}
+#endif	/* __CUDACC__ */
+#endif	/* CUDA_GPUWINDOW_H */
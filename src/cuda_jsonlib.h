@@ -0,0 +1,518 @@
+/*
+ * cuda_jsonlib.h
+ *
+ * Collection of jsonb functions and operators for CUDA GPU devices
+ * --
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef CUDA_JSONLIB_H
+#define CUDA_JSONLIB_H
+
+/*
+ * kern_jsonb_path
+ *
+ * Path of the field extraction by ->, ->>, #> and #>> operators, built by
+ * the code generator and delivered as a bytea parameter. Each item has
+ * the key to be looked up if the container is an object, and/or the
+ * index to be fetched if the container is an array. Items are stored
+ * sequentially with INTALIGN().
+ */
+#define KERN_JSONB_PATH_KEY		0x0001	/* valid as object key */
+#define KERN_JSONB_PATH_INDEX	0x0002	/* valid as array index */
+
+typedef struct
+{
+	cl_uint		flags;
+	cl_int		index;
+	cl_uint		keylen;
+	char		key[FLEXIBLE_ARRAY_MEMBER];
+} kern_jsonb_path_item;
+
+typedef struct
+{
+	cl_uint		nitems;
+	cl_uint		data[FLEXIBLE_ARRAY_MEMBER];	/* kern_jsonb_path_item */
+} kern_jsonb_path;
+
+#define KERN_JSONB_PATH_ITEM_LENGTH(keylen)		\
+	INTALIGN(offsetof(kern_jsonb_path_item, key) + (keylen))
+
+#ifdef __CUDACC__
+
+/*
+ * On-disk format of jsonb; see utils/jsonb.h
+ *
+ * NOTE: jsonb datum in Var may have short varlena header, thus, we cannot
+ * assume the container is aligned. All the JEntry and header fields are
+ * fetched using jsonb_read_uint().
+ */
+#define JENTRY_OFFLENMASK		0x0FFFFFFF
+#define JENTRY_TYPEMASK			0x70000000
+#define JENTRY_HAS_OFF			0x80000000
+
+#define JENTRY_ISSTRING			0x00000000
+#define JENTRY_ISNUMERIC		0x10000000
+#define JENTRY_ISBOOL_FALSE		0x20000000
+#define JENTRY_ISBOOL_TRUE		0x30000000
+#define JENTRY_ISNULL			0x40000000
+#define JENTRY_ISCONTAINER		0x50000000
+
+#define JB_CMASK				0x0FFFFFFF
+#define JB_FSCALAR				0x10000000
+#define JB_FOBJECT				0x20000000
+#define JB_FARRAY				0x40000000
+
+#ifndef PG_JSONB_TYPE_DEFINED
+#define PG_JSONB_TYPE_DEFINED
+STROMCL_VARLENA_TYPE_TEMPLATE(jsonb)
+#endif
+
+/*
+ * kern_jsonb_value - a reference to the element of jsonb container
+ */
+typedef struct
+{
+	cl_uint		type;		/* one of JENTRY_IS* */
+	const char *data;
+	cl_uint		len;
+} kern_jsonb_value;
+
+STATIC_INLINE(cl_uint)
+jsonb_read_uint(const char *addr)
+{
+	cl_uint		value;
+
+	memcpy(&value, addr, sizeof(cl_uint));
+	return value;
+}
+
+#define JSONB_CHILD(container,index)								\
+	jsonb_read_uint((container) + sizeof(cl_uint) * ((index) + 1))
+
+/*
+ * jsonb_fetch_child - fetch the @index-th child of the container.
+ * @nchildren is number of JEntry; twice the count for objects.
+ */
+STATIC_FUNCTION(void)
+jsonb_fetch_child(const char *container, cl_uint nchildren, cl_uint index,
+				  kern_jsonb_value *jval)
+{
+	const char *base_addr = container + sizeof(cl_uint) * (nchildren + 1);
+	cl_uint		entry = JSONB_CHILD(container, index);
+	cl_uint		offset = 0;
+	cl_uint		len;
+	cl_int		i;
+
+	/* logic in getJsonbOffset() */
+	for (i = (cl_int)index - 1; i >= 0; i--)
+	{
+		cl_uint		temp = JSONB_CHILD(container, i);
+
+		offset += (temp & JENTRY_OFFLENMASK);
+		if ((temp & JENTRY_HAS_OFF) != 0)
+			break;
+	}
+	if ((entry & JENTRY_HAS_OFF) != 0)
+		len = (entry & JENTRY_OFFLENMASK) - offset;
+	else
+		len = (entry & JENTRY_OFFLENMASK);
+
+	jval->type = (entry & JENTRY_TYPEMASK);
+	if (jval->type == JENTRY_ISNUMERIC ||
+		jval->type == JENTRY_ISCONTAINER)
+	{
+		cl_uint		padding = INTALIGN(offset) - offset;
+
+		offset += padding;
+		len -= padding;
+	}
+	jval->data = base_addr + offset;
+	jval->len = len;
+}
+
+/*
+ * jsonb_find_key - lookup the value of the key in the object container.
+ * Keys are sorted by the length first, then by memcmp().
+ */
+STATIC_FUNCTION(cl_bool)
+jsonb_find_key(const char *container, const char *key, cl_uint keylen,
+			   kern_jsonb_value *jval)
+{
+	cl_uint		header = jsonb_read_uint(container);
+	cl_uint		count = (header & JB_CMASK);
+	cl_uint		lo = 0;
+	cl_uint		hi = count;
+
+	if ((header & JB_FOBJECT) == 0)
+		return false;
+	while (lo < hi)
+	{
+		cl_uint		mid = lo + (hi - lo) / 2;
+		kern_jsonb_value kval;
+		cl_int		comp;
+
+		jsonb_fetch_child(container, 2 * count, mid, &kval);
+		if (kval.len != keylen)
+			comp = (kval.len < keylen ? -1 : 1);
+		else
+			comp = memcmp(kval.data, key, keylen);
+		if (comp == 0)
+		{
+			jsonb_fetch_child(container, 2 * count, mid + count, jval);
+			return true;
+		}
+		else if (comp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return false;
+}
+
+/*
+ * jsonb_numeric_value - numeric in jsonb container may be unaligned
+ */
+STATIC_FUNCTION(pg_numeric_t)
+jsonb_numeric_value(kern_context *kcxt, const kern_jsonb_value *jval)
+{
+	cl_uint		buf[(VARHDRSZ + sizeof(union NumericChoice)) /
+					sizeof(cl_uint) + 1];
+	pg_numeric_t result;
+
+	if (jval->len > sizeof(buf))
+	{
+		result.isnull = true;
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		return result;
+	}
+	memcpy(buf, jval->data, jval->len);
+	return pg_numeric_from_varlena(kcxt, (struct varlena *)buf);
+}
+
+/*
+ * jsonb_scalar_equal - logic in equalsJsonbScalarValue()
+ */
+STATIC_FUNCTION(cl_bool)
+jsonb_scalar_equal(kern_context *kcxt,
+				   const kern_jsonb_value *x, const kern_jsonb_value *y)
+{
+	pg_numeric_t	xnum;
+	pg_numeric_t	ynum;
+
+	if (x->type != y->type)
+		return false;
+	switch (x->type)
+	{
+		case JENTRY_ISSTRING:
+			return (x->len == y->len &&
+					memcmp(x->data, y->data, x->len) == 0);
+		case JENTRY_ISNUMERIC:
+			if (x->len == y->len &&
+				memcmp(x->data, y->data, x->len) == 0)
+				return true;
+			xnum = jsonb_numeric_value(kcxt, x);
+			ynum = jsonb_numeric_value(kcxt, y);
+			if (xnum.isnull || ynum.isnull)
+				return false;
+			return (numeric_cmp(kcxt, xnum, ynum) == 0);
+		case JENTRY_ISBOOL_FALSE:
+		case JENTRY_ISBOOL_TRUE:
+		case JENTRY_ISNULL:
+			return true;
+		default:
+			break;
+	}
+	return false;
+}
+
+/*
+ * JSONB_DEEP_CONTAINS_TEMPLATE - logic in JsonbDeepContains()
+ *
+ * Device code does not use recursive call, so the template is expanded
+ * for each nest level of the containers. Elsewhere, the deepest level
+ * gives up and requires CPU recheck.
+ */
+STATIC_FUNCTION(cl_bool)
+jsonb_deep_contains_recheck(kern_context *kcxt,
+							const char *val, const char *tmpl)
+{
+	STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+	return false;
+}
+
+#define JSONB_DEEP_CONTAINS_TEMPLATE(FUNCNAME,NESTED_CONTAINS)		\
+	STATIC_FUNCTION(cl_bool)										\
+	FUNCNAME(kern_context *kcxt, const char *val, const char *tmpl)	\
+	{																\
+		cl_uint		vheader = jsonb_read_uint(val);					\
+		cl_uint		theader = jsonb_read_uint(tmpl);				\
+		cl_uint		vcount = (vheader & JB_CMASK);					\
+		cl_uint		tcount = (theader & JB_CMASK);					\
+		kern_jsonb_value vval;										\
+		kern_jsonb_value tval;										\
+		cl_uint		i, j;											\
+																	\
+		/* different container types at this level */				\
+		if ((vheader & JB_FOBJECT) != (theader & JB_FOBJECT))		\
+			return false;											\
+		if ((theader & JB_FOBJECT) != 0)							\
+		{															\
+			if (vcount < tcount)									\
+				return false;										\
+			for (i=0; i < tcount; i++)								\
+			{														\
+				jsonb_fetch_child(tmpl, 2 * tcount, i, &tval);		\
+				if (!jsonb_find_key(val, tval.data, tval.len, &vval))	\
+					return false;									\
+				jsonb_fetch_child(tmpl, 2 * tcount, i + tcount, &tval);	\
+				if (vval.type != tval.type)							\
+					return false;									\
+				if (tval.type != JENTRY_ISCONTAINER)				\
+				{													\
+					if (!jsonb_scalar_equal(kcxt, &vval, &tval))	\
+						return false;								\
+				}													\
+				else if (!NESTED_CONTAINS(kcxt, vval.data, tval.data))	\
+					return false;									\
+			}														\
+			return true;											\
+		}															\
+		/* raw scalar may not contain an array */					\
+		if ((vheader & JB_FSCALAR) != 0 &&							\
+			(theader & JB_FSCALAR) == 0)							\
+			return false;											\
+		for (i=0; i < tcount; i++)									\
+		{															\
+			jsonb_fetch_child(tmpl, tcount, i, &tval);				\
+			for (j=0; j < vcount; j++)								\
+			{														\
+				jsonb_fetch_child(val, vcount, j, &vval);			\
+				if (tval.type != JENTRY_ISCONTAINER)				\
+				{													\
+					if (jsonb_scalar_equal(kcxt, &vval, &tval))		\
+						break;										\
+				}													\
+				else if (vval.type == JENTRY_ISCONTAINER &&			\
+						 NESTED_CONTAINS(kcxt, vval.data, tval.data))	\
+					break;											\
+			}														\
+			if (j == vcount)										\
+				return false;										\
+		}															\
+		return true;												\
+	}
+
+JSONB_DEEP_CONTAINS_TEMPLATE(jsonb_deep_contains_level3,
+							 jsonb_deep_contains_recheck)
+JSONB_DEEP_CONTAINS_TEMPLATE(jsonb_deep_contains_level2,
+							 jsonb_deep_contains_level3)
+JSONB_DEEP_CONTAINS_TEMPLATE(jsonb_deep_contains,
+							 jsonb_deep_contains_level2)
+
+/*
+ * jsonb_extract_path - walks on the container according to the path.
+ * It returns false if no elements are found. (result shall be NULL)
+ */
+STATIC_FUNCTION(cl_bool)
+jsonb_extract_path(kern_context *kcxt, const char *container,
+				   const kern_jsonb_path *jpath, kern_jsonb_value *jval)
+{
+	const char *pos = (const char *)jpath->data;
+	cl_uint		i;
+
+	jval->type = JENTRY_ISCONTAINER;
+	jval->data = container;
+	jval->len = 0;
+	for (i=0; i < jpath->nitems; i++)
+	{
+		const kern_jsonb_path_item *item = (const kern_jsonb_path_item *)pos;
+		const char *curr = jval->data;
+		cl_uint		header;
+		cl_uint		count;
+		cl_int		index;
+
+		pos += KERN_JSONB_PATH_ITEM_LENGTH(item->keylen);
+		if (jval->type != JENTRY_ISCONTAINER)
+			return false;
+		header = jsonb_read_uint(curr);
+		count = (header & JB_CMASK);
+		if ((header & JB_FOBJECT) != 0)
+		{
+			if ((item->flags & KERN_JSONB_PATH_KEY) == 0 ||
+				!jsonb_find_key(curr, item->key, item->keylen, jval))
+				return false;
+		}
+		else if ((header & JB_FARRAY) != 0)
+		{
+			if ((item->flags & KERN_JSONB_PATH_INDEX) == 0)
+				return false;
+			/* raw scalar is handled differently by operators */
+			if ((header & JB_FSCALAR) != 0)
+			{
+				STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+				return false;
+			}
+			index = item->index;
+			if (index < 0)
+			{
+				if ((cl_uint)(-index) > count)
+					return false;
+				index += count;
+			}
+			if ((cl_uint)index >= count)
+				return false;
+			jsonb_fetch_child(curr, count, index, jval);
+		}
+		else
+			return false;
+	}
+	return true;
+}
+
+/*
+ * jsonb ? text
+ */
+STATIC_FUNCTION(pg_bool_t)
+pgfn_jsonb_exists(kern_context *kcxt, pg_jsonb_t arg1, pg_text_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		const char *container = VARDATA_ANY(arg1.value);
+		kern_jsonb_value key;
+		kern_jsonb_value jval;
+		cl_uint		header = jsonb_read_uint(container);
+		cl_uint		count = (header & JB_CMASK);
+		cl_uint		i;
+
+		key.type = JENTRY_ISSTRING;
+		key.data = VARDATA_ANY(arg2.value);
+		key.len = VARSIZE_ANY_EXHDR(arg2.value);
+		result.value = false;
+		if ((header & JB_FOBJECT) != 0)
+			result.value = jsonb_find_key(container, key.data, key.len, &jval);
+		else if ((header & JB_FARRAY) != 0)
+		{
+			/* string elements of array also match */
+			for (i=0; i < count; i++)
+			{
+				jsonb_fetch_child(container, count, i, &jval);
+				if (jsonb_scalar_equal(kcxt, &jval, &key))
+				{
+					result.value = true;
+					break;
+				}
+			}
+		}
+	}
+	return result;
+}
+
+/*
+ * jsonb @> jsonb
+ */
+STATIC_FUNCTION(pg_bool_t)
+pgfn_jsonb_contains(kern_context *kcxt, pg_jsonb_t arg1, pg_jsonb_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+		result.value = jsonb_deep_contains(kcxt,
+										   VARDATA_ANY(arg1.value),
+										   VARDATA_ANY(arg2.value));
+	return result;
+}
+
+/*
+ * jsonb <@ jsonb
+ */
+STATIC_FUNCTION(pg_bool_t)
+pgfn_jsonb_contained(kern_context *kcxt, pg_jsonb_t arg1, pg_jsonb_t arg2)
+{
+	return pgfn_jsonb_contains(kcxt, arg2, arg1);
+}
+
+/*
+ * (jsonb ->> / #>> path) = text, and <>
+ *
+ * Device code cannot construct a new text datum, so text extraction is
+ * evaluated together with the comparison. Numeric and container values
+ * need their textual form, so CPU rechecks them.
+ */
+STATIC_FUNCTION(pg_bool_t)
+jsonb_path_text_compare(kern_context *kcxt, pg_jsonb_t arg1,
+						pg_bytea_t arg2, pg_text_t arg3, cl_bool negative)
+{
+	pg_bool_t	result;
+	kern_jsonb_value jval;
+	const char *str;
+	cl_uint		len;
+
+	result.isnull = arg1.isnull | arg2.isnull | arg3.isnull;
+	if (result.isnull)
+		return result;
+	if (!jsonb_extract_path(kcxt, VARDATA_ANY(arg1.value),
+							(const kern_jsonb_path *)VARDATA_ANY(arg2.value),
+							&jval))
+	{
+		result.isnull = true;
+		return result;
+	}
+	switch (jval.type)
+	{
+		case JENTRY_ISSTRING:
+			str = jval.data;
+			len = jval.len;
+			break;
+		case JENTRY_ISBOOL_TRUE:
+			str = "true";
+			len = 4;
+			break;
+		case JENTRY_ISBOOL_FALSE:
+			str = "false";
+			len = 5;
+			break;
+		case JENTRY_ISNULL:
+			result.isnull = true;
+			return result;
+		default:
+			result.isnull = true;
+			STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+			return result;
+	}
+	result.value = (len == VARSIZE_ANY_EXHDR(arg3.value) &&
+					memcmp(str, VARDATA_ANY(arg3.value), len) == 0);
+	if (negative)
+		result.value = !result.value;
+	return result;
+}
+
+STATIC_FUNCTION(pg_bool_t)
+pgfn_jsonb_path_text_eq(kern_context *kcxt, pg_jsonb_t arg1,
+						pg_bytea_t arg2, pg_text_t arg3)
+{
+	return jsonb_path_text_compare(kcxt, arg1, arg2, arg3, false);
+}
+
+STATIC_FUNCTION(pg_bool_t)
+pgfn_jsonb_path_text_ne(kern_context *kcxt, pg_jsonb_t arg1,
+						pg_bytea_t arg2, pg_text_t arg3)
+{
+	return jsonb_path_text_compare(kcxt, arg1, arg2, arg3, true);
+}
+
+#endif	/* __CUDACC__ */
+#endif	/* CUDA_JSONLIB_H */
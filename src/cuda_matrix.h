@@ -1046,6 +1046,102 @@ PGSTROM_MATRIX_GROUPBY_TEMPLATE(Add,FP32,cl_float,atomicAdd,0.0)
 //PGSTROM_MATRIX_GROUPBY_TEMPLATE(Max,FP32,cl_float,atomicMax,-FLT_MAX)
 //PGSTROM_MATRIX_GROUPBY_TEMPLATE(Min,FP32,cl_float,atomicMin, FLT_MAX)
 
+/* ----------------------------------------------------------------
+ *
+ * Matrix multiplication support for PL/CUDA functions
+ *
+ * pgstromMatrixMultiply(FP32|FP64)(MatrixType *C,		:out
+ *                                  MatrixType *A,		:in
+ *                                  MatrixType *B,		:in
+ *                                  cl_bool     transA)	:in
+ *
+ * It computes C = A * B, or C = t(A) * B if 'transA' is true, by all the
+ * thread blocks in the grid cooperatively. Every block computes a tile of
+ * MATRIX_GEMM_TILE_SZ x MATRIX_GEMM_TILE_SZ using shared memory, thus
+ * block size has to be MATRIX_GEMM_TILE_SZ^2. The caller must initialize
+ * 'C' with the suitable height and width prior to the invocation.
+ * It returns false if matrix size or block size is not acceptable.
+ *
+ * ---------------------------------------------------------------- */
+#define MATRIX_GEMM_TILE_SZ		16
+
+#define PGSTROM_MATRIX_MULTIPLY_TEMPLATE(SUFFIX,BASETYPE)				\
+	STATIC_FUNCTION(cl_bool)											\
+	pgstromMatrixMultiply##SUFFIX(MatrixType *C,						\
+								  MatrixType *A,						\
+								  MatrixType *B,						\
+								  cl_bool transA)						\
+	{																	\
+		__shared__ BASETYPE	tile_a[MATRIX_GEMM_TILE_SZ]					\
+							      [MATRIX_GEMM_TILE_SZ + 1];			\
+		__shared__ BASETYPE	tile_b[MATRIX_GEMM_TILE_SZ]					\
+							      [MATRIX_GEMM_TILE_SZ + 1];			\
+		cl_uint		height = ARRAY_MATRIX_HEIGHT(C);					\
+		cl_uint		width  = ARRAY_MATRIX_WIDTH(C);						\
+		cl_uint		lda    = ARRAY_MATRIX_HEIGHT(A);					\
+		cl_uint		ldb    = ARRAY_MATRIX_HEIGHT(B);					\
+		cl_uint		common = (transA ? ARRAY_MATRIX_HEIGHT(A)			\
+							         : ARRAY_MATRIX_WIDTH(A));			\
+		BASETYPE   *a_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(A);		\
+		BASETYPE   *b_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(B);		\
+		BASETYPE   *c_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(C);		\
+		cl_uint		tx = get_local_id() % MATRIX_GEMM_TILE_SZ;			\
+		cl_uint		ty = get_local_id() / MATRIX_GEMM_TILE_SZ;			\
+		cl_uint		ntiles_h;											\
+		cl_uint		ntiles_w;											\
+		cl_uint		index, k, kk;										\
+																		\
+		/* sanity checks */												\
+		if (get_local_size() != MATRIX_GEMM_TILE_SZ * MATRIX_GEMM_TILE_SZ) \
+			return false;												\
+		if ((transA ? ARRAY_MATRIX_WIDTH(A)								\
+			        : ARRAY_MATRIX_HEIGHT(A)) != height ||				\
+			ARRAY_MATRIX_HEIGHT(B) != common ||							\
+			ARRAY_MATRIX_WIDTH(B) != width)								\
+			return false;												\
+		ntiles_h = (height + MATRIX_GEMM_TILE_SZ - 1) / MATRIX_GEMM_TILE_SZ; \
+		ntiles_w = (width  + MATRIX_GEMM_TILE_SZ - 1) / MATRIX_GEMM_TILE_SZ; \
+																		\
+		for (index = get_global_index();								\
+			 index < ntiles_h * ntiles_w;								\
+			 index += get_global_size() / get_local_size())				\
+		{																\
+			cl_uint		row = (index % ntiles_h) * MATRIX_GEMM_TILE_SZ + tx; \
+			cl_uint		col = (index / ntiles_h) * MATRIX_GEMM_TILE_SZ + ty; \
+			BASETYPE	sum = 0.0;										\
+																		\
+			for (k=0; k < common; k += MATRIX_GEMM_TILE_SZ)				\
+			{															\
+				cl_uint		ka = k + ty;								\
+				cl_uint		kb = k + tx;								\
+																		\
+				/* tile_a[tx][ty] = op(A)[row, ka] */					\
+				if (row < height && ka < common)						\
+					tile_a[tx][ty] = (transA							\
+									  ? a_values[(size_t)row * lda + ka] \
+									  : a_values[(size_t)ka * lda + row]); \
+				else													\
+					tile_a[tx][ty] = 0.0;								\
+				/* tile_b[tx][ty] = B[kb, col] */						\
+				if (kb < common && col < width)							\
+					tile_b[tx][ty] = b_values[(size_t)col * ldb + kb];	\
+				else													\
+					tile_b[tx][ty] = 0.0;								\
+				__syncthreads();										\
+																		\
+				for (kk=0; kk < MATRIX_GEMM_TILE_SZ; kk++)				\
+					sum += tile_a[tx][kk] * tile_b[kk][ty];				\
+				__syncthreads();										\
+			}															\
+			if (row < height && col < width)							\
+				c_values[(size_t)col * height + row] = sum;				\
+		}																\
+		return true;													\
+	}
+
+PGSTROM_MATRIX_MULTIPLY_TEMPLATE(FP32,cl_float)
+PGSTROM_MATRIX_MULTIPLY_TEMPLATE(FP64,cl_double)
+
 
 #endif	/* __CUDACC__ */
 #endif	/* CUDA_MATRIX_H */
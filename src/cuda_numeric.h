@@ -668,6 +668,61 @@ pgfn_numeric_int8(kern_context *kcxt, pg_numeric_t arg)
 	return numeric_to_integer(kcxt, arg, sizeof(v.value));
 }
 
+/*
+ * pgfn_numeric_fixed_int8
+ *
+ * It converts a numeric value into the scaled 64bit integer, that is,
+ * arg * 10^scale, for the fixed-point aggregation of numeric(p,s).
+ * Unlike numeric_to_integer(), it never rounds off the fraction; any
+ * values not fit to the scale is rechecked by CPU.
+ */
+STATIC_FUNCTION(pg_int8_t)
+pgfn_numeric_fixed_int8(kern_context *kcxt, pg_numeric_t arg, pg_int4_t scale)
+{
+	pg_int8_t	v;
+	int			sign, expo;
+	cl_ulong	mant;
+
+	if (arg.isnull || scale.isnull)
+	{
+		v.isnull = true;
+		v.value  = 0;
+		return v;
+	}
+	expo = PG_NUMERIC_EXPONENT(arg.value) + scale.value;
+	sign = PG_NUMERIC_SIGN(arg.value);
+	mant = PG_NUMERIC_MANTISSA(arg.value);
+
+	if (mant != 0)
+	{
+		while (expo < 0)
+		{
+			if (mant % 10 != 0)
+				goto recheck;
+			mant /= 10;
+			expo++;
+		}
+		while (expo > 0)
+		{
+			if (mant > (cl_ulong)LONG_MAX / 10)
+				goto recheck;
+			mant *= 10;
+			expo--;
+		}
+		if (mant > (cl_ulong)LONG_MAX)
+			goto recheck;
+	}
+	v.isnull = false;
+	v.value  = (sign == 0 ? (cl_long)mant : -((cl_long)mant));
+	return v;
+
+recheck:
+	v.isnull = true;
+	v.value  = 0;
+	STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+	return v;
+}
+
 STATIC_INLINE(pg_float2_t)
 pgfn_numeric_float2(kern_context *kcxt, pg_numeric_t arg)
 {
@@ -71,6 +71,11 @@ typedef struct
 	cl_ulong		working_usage;
 	cl_ulong		results_bufsz;
 	cl_ulong		results_usage;
+	/* multi-device execution (#plcuda_num_devices) */
+	cl_uint			device_index;	/* index of the device; 0 is primary */
+	cl_uint			num_devices;	/* number of devices which run kernels */
+	/* streaming execution of the main kernel (#plcuda_num_chunks) */
+	cl_uint			num_chunks;		/* number of main kernel launches */
 	cl_int			nargs;
 	kern_colmeta	retmeta;	/* result data type */
 	kern_colmeta	argmeta[FLEXIBLE_ARRAY_MEMBER];	/* argument's data types */
@@ -95,6 +100,47 @@ typedef struct
 		return;									\
 	} while(0)
 
+/*
+ * plcuda_device_portion
+ *
+ * It tells the range [*p_start, *p_end) of @nitems to be processed by the
+ * current device, when PL/CUDA function runs on multiple devices. Every
+ * device launches the kernels with the same number of threads, so the code
+ * block is responsible to pick up its own portion of the argument.
+ */
+STATIC_INLINE(void)
+plcuda_device_portion(kern_plcuda *kplcuda, cl_ulong nitems,
+					  cl_ulong *p_start, cl_ulong *p_end)
+{
+	cl_ulong	unitsz = (nitems + kplcuda->num_devices - 1)
+						/ kplcuda->num_devices;
+
+	*p_start = Min(unitsz * kplcuda->device_index, nitems);
+	*p_end   = Min(unitsz * (kplcuda->device_index + 1), nitems);
+}
+
+/*
+ * plcuda_chunk_portion
+ *
+ * It tells the range [*p_start, *p_end) of @nitems to be processed by the
+ * @chunk_index'th launch of the main kernel on the current device. Portion
+ * of the large arguments for the chunk is uploaded just before the launch,
+ * and transfer of the next chunk runs in parallel to the kernel.
+ */
+STATIC_INLINE(void)
+plcuda_chunk_portion(kern_plcuda *kplcuda, cl_uint chunk_index,
+					 cl_ulong nitems, cl_ulong *p_start, cl_ulong *p_end)
+{
+	cl_ulong	start;
+	cl_ulong	end;
+	cl_ulong	unitsz;
+
+	plcuda_device_portion(kplcuda, nitems, &start, &end);
+	unitsz = (end - start + kplcuda->num_chunks - 1) / kplcuda->num_chunks;
+	*p_start = Min(start + unitsz * chunk_index, end);
+	*p_end   = Min(start + unitsz * (chunk_index + 1), end);
+}
+
 /*
  * composite data type support in kernel space
  */
@@ -134,6 +180,7 @@ typedef struct
 /* column 'compression' option */
 #define GSTORE_COMPRESSION__NONE		0
 #define GSTORE_COMPRESSION__PGLZ		1
+#define GSTORE_COMPRESSION__BITPACK		2
 
 #ifdef __CUDACC__
 typedef union {
@@ -159,6 +206,52 @@ pg_reggstore_param(kern_context *kcxt, cl_uint param_id)
 	return retval;
 }
 
+/*
+ * plcuda_results_store_tuple
+ *
+ * It appends a row on the results buffer of set-returning PL/CUDA function,
+ * in KDS_FORMAT_ROW. Any thread can call this routine concurrently.
+ * If no space left, it sets StromError_DataStoreNoSpace and returns false.
+ */
+STATIC_FUNCTION(cl_bool)
+plcuda_results_store_tuple(kern_context *kcxt,
+						   kern_data_store *kds_results,
+						   Datum *tup_values,
+						   cl_bool *tup_isnull)
+{
+	cl_uint		required;
+	cl_uint		nitems;
+	cl_uint		usage;
+	cl_uint		pos;
+
+	assert(kds_results->format == KDS_FORMAT_ROW);
+	required = MAXALIGN(offsetof(kern_tupitem, htup) +
+						compute_heaptuple_size(kcxt,
+											   kds_results,
+											   tup_values,
+											   tup_isnull));
+	nitems = atomicAdd(&kds_results->nitems, 1);
+	usage = atomicAdd(&kds_results->usage, required);
+	if (KERN_DATA_STORE_HEAD_LENGTH(kds_results) +
+		STROMALIGN(sizeof(cl_uint) * (nitems + 1)) +
+		usage + required > kds_results->length)
+	{
+		STROM_SET_ERROR(&kcxt->e, StromError_DataStoreNoSpace);
+		return false;
+	}
+	pos = kds_results->length - (usage + required);
+	KERN_DATA_STORE_ROWINDEX(kds_results)[nitems] = pos;
+	form_kern_heaptuple((kern_tupitem *)((char *)kds_results + pos),
+						kds_results->ncols,
+						kds_results->colmeta,
+						NULL,
+						NULL,
+						0,
+						tup_values,
+						tup_isnull);
+	return true;
+}
+
 #endif
 
 #endif	/* CUDA_PLCUDA.H */
@@ -62,6 +62,14 @@ typedef struct
 #define WORDNUM(x)			((x) / BITS_PER_BITMAPWORD)
 #define BITNUM(x)			((x) % BITS_PER_BITMAPWORD)
 
+#define PGCACHE_MAX_BUILDERS	64
+
+typedef struct
+{
+	Latch	   *latch;			/* NULL, if builder is not running */
+	bool		is_idle;		/* true, if builder is waiting for jobs */
+} program_builder_state;
+
 typedef struct
 {
 	volatile slock_t lock;
@@ -72,11 +80,36 @@ typedef struct
 	dlist_head	build_list;		/* build pending list */
 	dlist_head	addr_list;
 	dlist_head	free_list[PGCACHE_CHUNKSZ_MAX_BIT + 1];
+	int			num_active_builders;
+	program_builder_state builders[PGCACHE_MAX_BUILDERS];
 	char		base[FLEXIBLE_ARRAY_MEMBER];
 } program_cache_head;
 
+/*
+ * program_cache_file - on-disk image of the PTX binary already built.
+ * It allows to skip NVRTC after restart of the postmaster, if the file
+ * was built with identical source, extra_flags and target_cc.
+ */
+typedef struct
+{
+	cl_uint			magic;
+	pg_crc32		signature;		/* version of NVRTC and cuda_*.h */
+	pg_crc32		crc;
+	cl_int			target_cc;
+	cl_int			extra_flags;
+	size_t			kern_deflen;
+	size_t			kern_srclen;
+	size_t			ptx_length;
+	pg_crc32		ptx_crc;
+	char			data[FLEXIBLE_ARRAY_MEMBER];
+} program_cache_file;
+
+#define PGCACHE_FILE_MAGIC			0x50535458	/* 'PSTX' */
+
 /* ---- GUC variables ---- */
 static int		program_cache_size_kb;
+static char	   *program_cache_dir;
+static int		num_program_builders;
 static bool		pgstrom_debug_jit_compile_options;
 
 /* ---- static variables ---- */
@@ -88,9 +121,13 @@ static program_cache_head *pgcache_head = NULL;
 #undef PGSTROM_CUDA
 static void	   *curand_wrapper_lib = NULL;
 static size_t	curand_wrapper_libsz;
+static pg_crc32	program_cache_file_signature;
+static int		program_builder_id = -1;
+static volatile bool program_builder_got_sigterm = false;
 
 /* ---- forward declarations ---- */
 static void put_cuda_program_entry_nolock(program_cache_entry *entry);
+void pgstrom_program_builder_main(Datum arg);
 
 
 /*
@@ -397,6 +434,10 @@ construct_flat_cuda_source(uint32 extra_flags,
 	if ((extra_flags & DEVKERNEL_NEEDS_RANGETYPE) == DEVKERNEL_NEEDS_RANGETYPE)
 		ofs += snprintf(source + ofs, len - ofs,
 						"#include \"cuda_rangetype.h\"\n");
+	/* cuda_jsonlib.h */
+	if ((extra_flags & DEVKERNEL_NEEDS_JSONLIB) == DEVKERNEL_NEEDS_JSONLIB)
+		ofs += snprintf(source + ofs, len - ofs,
+						"#include \"cuda_jsonlib.h\"\n");
 	/* cuda_primitive.h (must be last) */
 	if ((extra_flags & DEVKERNEL_NEEDS_PRIMITIVE) == DEVKERNEL_NEEDS_PRIMITIVE)
 		ofs += snprintf(source + ofs, len - ofs,
@@ -447,6 +488,9 @@ construct_flat_cuda_source(uint32 extra_flags,
 		"    pg_daterange_t   daterange_v;\n"
 		"#endif\n"	/* CUDA_TIMELIB_H */
 		"#endif\n"	/* CUDA_RANGETYPE_H */
+		"#ifdef CUDA_JSONLIB_H\n"
+		"    pg_jsonb_t       jsonb_v;\n"
+		"#endif\n"
 		"#ifdef CUDA_MATRIX_H\n"
 		"    pg_array_t       array_v;\n"
 		"    pg_matrix_t      matrix_v;\n"
@@ -468,6 +512,18 @@ construct_flat_cuda_source(uint32 extra_flags,
 	if (extra_flags & DEVKERNEL_NEEDS_GPUPREAGG)
 		ofs += snprintf(source + ofs, len - ofs,
 						"#include \"cuda_gpupreagg.h\"\n");
+	/* GpuSort */
+	if (extra_flags & DEVKERNEL_NEEDS_GPUSORT)
+		ofs += snprintf(source + ofs, len - ofs,
+						"#include \"cuda_gpusort.h\"\n");
+	/* GpuWindow */
+	if (extra_flags & DEVKERNEL_NEEDS_GPUWINDOW)
+		ofs += snprintf(source + ofs, len - ofs,
+						"#include \"cuda_gpuwindow.h\"\n");
+	/* GPU accelerated COPY FROM */
+	if (extra_flags & DEVKERNEL_NEEDS_GPUCOPY)
+		ofs += snprintf(source + ofs, len - ofs,
+						"#include \"cuda_gpucopy.h\"\n");
 	/* PL/CUDA functions */
 	if (extra_flags & DEVKERNEL_NEEDS_PLCUDA)
 		ofs += snprintf(source + ofs, len - ofs,
@@ -645,6 +701,249 @@ writeout_temporary_file(char *tempfile, const char *suffix,
 	fclose(filp);
 }
 
+/*
+ * program_cache_file_pathname - file path of the on-disk program cache
+ */
+static inline bool
+program_cache_file_pathname(char *pathname, program_cache_entry *entry)
+{
+	if (!program_cache_dir || program_cache_dir[0] == '\0')
+		return false;
+	snprintf(pathname, MAXPGPATH, "%s/%08x.sm%d.%08x.ptx",
+			 program_cache_dir,
+			 entry->crc,
+			 entry->target_cc,
+			 entry->extra_flags);
+	return true;
+}
+
+/*
+ * lookup_cuda_program_file
+ *
+ * It tries to load the PTX image of the supplied program entry from the
+ * on-disk program cache. It returns a malloc'ed buffer, or NULL if no
+ * valid cache file exists.
+ */
+static char *
+lookup_cuda_program_file(program_cache_entry *entry, size_t *p_ptx_length)
+{
+	program_cache_file *pcfile = NULL;
+	char		pathname[MAXPGPATH];
+	char	   *ptx_image = NULL;
+	struct stat	st_buf;
+	size_t		offset;
+	ssize_t		nbytes;
+	pg_crc32	ptx_crc;
+	bool		is_stale = false;
+	int			fdesc;
+
+	if (!program_cache_file_pathname(pathname, entry))
+		return NULL;
+	fdesc = open(pathname, O_RDONLY);
+	if (fdesc < 0)
+	{
+		if (errno != ENOENT)
+			wlog("failed to open \"%s\": %m", pathname);
+		return NULL;
+	}
+	if (fstat(fdesc, &st_buf) != 0)
+	{
+		wlog("failed on fstat(\"%s\"): %m", pathname);
+		goto out;
+	}
+	if (st_buf.st_size < offsetof(program_cache_file, data))
+	{
+		is_stale = true;	/* corrupted */
+		goto out;
+	}
+	pcfile = malloc(st_buf.st_size);
+	if (!pcfile)
+		goto out;
+	for (offset = 0; offset < st_buf.st_size; offset += nbytes)
+	{
+		nbytes = read(fdesc,
+					  (char *)pcfile + offset,
+					  st_buf.st_size - offset);
+		if (nbytes < 0 && errno == EINTR)
+			nbytes = 0;
+		else if (nbytes <= 0)
+		{
+			wlog("failed on read(\"%s\"): %m", pathname);
+			goto out;
+		}
+	}
+
+	/* built by other version of NVRTC or cuda_xxxx.h, or corrupted? */
+	if (pcfile->magic != PGCACHE_FILE_MAGIC ||
+		pcfile->signature != program_cache_file_signature ||
+		st_buf.st_size != (offsetof(program_cache_file, data) +
+						   pcfile->kern_deflen +
+						   pcfile->kern_srclen +
+						   pcfile->ptx_length))
+	{
+		is_stale = true;
+		goto out;
+	}
+	/* is it really identical program? */
+	if (pcfile->crc != entry->crc ||
+		pcfile->target_cc != entry->target_cc ||
+		pcfile->extra_flags != entry->extra_flags ||
+		pcfile->kern_deflen != entry->kern_deflen ||
+		pcfile->kern_srclen != entry->kern_srclen ||
+		memcmp(pcfile->data,
+			   entry->kern_define,
+			   entry->kern_deflen) != 0 ||
+		memcmp(pcfile->data + pcfile->kern_deflen,
+			   entry->kern_source,
+			   entry->kern_srclen) != 0)
+		goto out;
+
+	offset = pcfile->kern_deflen + pcfile->kern_srclen;
+	INIT_LEGACY_CRC32(ptx_crc);
+	COMP_LEGACY_CRC32(ptx_crc, pcfile->data + offset, pcfile->ptx_length);
+	FIN_LEGACY_CRC32(ptx_crc);
+	if (ptx_crc != pcfile->ptx_crc)
+	{
+		is_stale = true;
+		goto out;
+	}
+
+	ptx_image = malloc(pcfile->ptx_length);
+	if (ptx_image)
+	{
+		memcpy(ptx_image, pcfile->data + offset, pcfile->ptx_length);
+		*p_ptx_length = pcfile->ptx_length;
+	}
+out:
+	if (pcfile)
+		free(pcfile);
+	close(fdesc);
+	/* stale file shall never be reused, so remove it */
+	if (is_stale && unlink(pathname) != 0 && errno != ENOENT)
+		wlog("failed on unlink(\"%s\"): %m", pathname);
+	return ptx_image;
+}
+
+/*
+ * cleanup_cuda_program_files
+ *
+ * It removes the files in the on-disk program cache that are never reused
+ * by the current installation; PTX images built by other version of NVRTC
+ * or cuda_xxxx.h files, corrupted ones, and temporary files left by crash.
+ */
+static void
+cleanup_cuda_program_files(void)
+{
+	DIR		   *dir;
+	struct dirent *dent;
+	char		pathname[MAXPGPATH];
+
+	if (!program_cache_dir || program_cache_dir[0] == '\0')
+		return;
+	dir = AllocateDir(program_cache_dir);
+	while ((dent = ReadDir(dir, program_cache_dir)) != NULL)
+	{
+		program_cache_file pcfile;
+		const char *pos;
+		bool		is_stale = true;
+		int			fdesc;
+
+		if (strcmp(dent->d_name, ".") == 0 ||
+			strcmp(dent->d_name, "..") == 0)
+			continue;
+		snprintf(pathname, MAXPGPATH, "%s/%s",
+				 program_cache_dir, dent->d_name);
+		/* only ones named by program_cache_file_pathname() */
+		pos = strrchr(dent->d_name, '.');
+		if (pos && strcmp(pos, ".ptx") == 0)
+		{
+			fdesc = open(pathname, O_RDONLY);
+			if (fdesc < 0)
+				continue;
+			if (read(fdesc, &pcfile, offsetof(program_cache_file, data))
+				== offsetof(program_cache_file, data) &&
+				pcfile.magic == PGCACHE_FILE_MAGIC &&
+				pcfile.signature == program_cache_file_signature)
+				is_stale = false;
+			close(fdesc);
+		}
+		else if (!strstr(dent->d_name, ".ptx."))
+			continue;	/* not a file of the program cache */
+
+		if (is_stale && unlink(pathname) != 0 && errno != ENOENT)
+			elog(LOG, "failed on unlink(\"%s\"): %m", pathname);
+	}
+	FreeDir(dir);
+}
+
+/*
+ * writeout_cuda_program_file
+ *
+ * It writes out the PTX image built to the on-disk program cache.
+ * Any errors are not critical, so we just report them to the log.
+ */
+static void
+writeout_cuda_program_file(program_cache_entry *entry,
+						   const char *ptx_image, size_t ptx_length)
+{
+	program_cache_file pcfile;
+	char		pathname[MAXPGPATH];
+	char		tempname[MAXPGPATH];
+	struct iovec iov[4];
+	size_t		total;
+	ssize_t		nbytes;
+	int			fdesc;
+
+	if (!program_cache_file_pathname(pathname, entry))
+		return;
+	snprintf(tempname, sizeof(tempname), "%s.%d.%lu",
+			 pathname, MyProcPid, (unsigned long)pthread_self());
+	fdesc = open(tempname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fdesc < 0)
+	{
+		wlog("failed to open \"%s\": %m", tempname);
+		return;
+	}
+	memset(&pcfile, 0, offsetof(program_cache_file, data));
+	pcfile.magic		= PGCACHE_FILE_MAGIC;
+	pcfile.signature	= program_cache_file_signature;
+	pcfile.crc			= entry->crc;
+	pcfile.target_cc	= entry->target_cc;
+	pcfile.extra_flags	= entry->extra_flags;
+	pcfile.kern_deflen	= entry->kern_deflen;
+	pcfile.kern_srclen	= entry->kern_srclen;
+	pcfile.ptx_length	= ptx_length;
+	INIT_LEGACY_CRC32(pcfile.ptx_crc);
+	COMP_LEGACY_CRC32(pcfile.ptx_crc, ptx_image, ptx_length);
+	FIN_LEGACY_CRC32(pcfile.ptx_crc);
+
+	iov[0].iov_base = &pcfile;
+	iov[0].iov_len  = offsetof(program_cache_file, data);
+	iov[1].iov_base = entry->kern_define;
+	iov[1].iov_len  = entry->kern_deflen;
+	iov[2].iov_base = entry->kern_source;
+	iov[2].iov_len  = entry->kern_srclen;
+	iov[3].iov_base = (void *)ptx_image;
+	iov[3].iov_len  = ptx_length;
+	total = (iov[0].iov_len + iov[1].iov_len +
+			 iov[2].iov_len + iov[3].iov_len);
+	nbytes = writev(fdesc, iov, lengthof(iov));
+	if (nbytes != total)
+	{
+		wlog("failed on writev(\"%s\"): %m", tempname);
+		close(fdesc);
+		unlink(tempname);
+		return;
+	}
+	close(fdesc);
+	/* atomic replacement, concurrent readers never see partial file */
+	if (rename(tempname, pathname) != 0)
+	{
+		wlog("failed on rename(\"%s\",\"%s\"): %m", tempname, pathname);
+		unlink(tempname);
+	}
+}
+
 /*
  * pgstrom_cuda_source_string
  *
@@ -742,6 +1041,7 @@ build_cuda_program(program_cache_entry *src_entry)
 	size_t			ptx_length = 0;
 	char		   *build_log = NULL;
 	size_t			log_length;
+	bool			from_file = false;
 	int				pindex;
 	int				hindex;
 	size_t			offset;
@@ -749,17 +1049,39 @@ build_cuda_program(program_cache_entry *src_entry)
 
 	Assert(!src_entry->build_chain.prev && !src_entry->build_chain.next);
 
-	/* Make a nvrtcProgram object */
-	source = construct_flat_cuda_source(src_entry->extra_flags,
-										src_entry->kern_define,
-										src_entry->kern_source);
-	if (!source)
-		werror("out of memory");
+	/*
+	 * Try to load the PTX image from the on-disk program cache; identical
+	 * GPU program might be built prior to the restart of postmaster.
+	 */
+	ptx_image = lookup_cuda_program_file(src_entry, &ptx_length);
+	if (ptx_image)
+	{
+		from_file = true;
+		build_log = strdup("loaded from the program cache file");
+		if (!build_log)
+		{
+			free(ptx_image);
+			werror("out of memory");
+		}
+		log_length = strlen(build_log);
+	}
+	else
+	{
+		/* Make a nvrtcProgram object */
+		source = construct_flat_cuda_source(src_entry->extra_flags,
+											src_entry->kern_define,
+											src_entry->kern_source);
+		if (!source)
+			werror("out of memory");
+	}
 
 	STROM_TRY();
 	{
 		char	gpu_arch_option[256];
 
+		if (from_file)
+			goto setup_entry;
+
 		rc = nvrtcCreateProgram(&program,
 								source,
 								"pg-strom",
@@ -850,9 +1172,14 @@ build_cuda_program(program_cache_entry *src_entry)
 			werror("failed on nvrtcDestroyProgram: %s",
 				   nvrtcGetErrorString(rc));
 
+		/* save the PTX image for the next startup */
+		if (ptx_image)
+			writeout_cuda_program_file(src_entry, ptx_image, ptx_length);
+
 		/*
 		 * Allocation of a new entry, to keep ptx_image/build_log
 		 */
+	setup_entry:
 		length = (MAXALIGN(src_entry->kern_deflen + 1) +
 				  MAXALIGN(src_entry->kern_srclen + 1) +
 				  MAXALIGN(ptx_length + 1) +
@@ -950,6 +1277,12 @@ build_cuda_program(program_cache_entry *src_entry)
 	}
 	STROM_END_TRY();
 
+	free(build_log);
+	if (ptx_image)
+		free(ptx_image);
+	if (source)
+		free(source);
+
 	return bin_entry;
 }
 
@@ -957,21 +1290,25 @@ build_cuda_program(program_cache_entry *src_entry)
  * pgstrom_try_build_cuda_program
  *
  * It picks up a program entry that is not built yet, if any, then runs
- * NVRTC and linker to construct an executable binary.
- * Because linker process needs a valid CUDA context, only GpuContext
- * worker can call this function.
+ * NVRTC to construct a PTX image. Linkage of the run-time libraries
+ * needs a valid CUDA context, so it is deferred to the module load.
+ * It is called by the program builder workers, or GpuContext workers if
+ * no program builder is running.
  */
 bool
 pgstrom_try_build_cuda_program(void)
 {
 	dlist_node	   *dnode;
 	program_cache_entry *entry;
+	MemoryContext	oldcxt = CurrentMemoryContext;
+	bool			build_failed = false;
 
-	Assert(GpuWorkerCurrentContext != NULL);
+	Assert(GpuWorkerCurrentContext != NULL || program_builder_id >= 0);
 
 	/* Is there any pending CUDA program? */
 	SpinLockAcquire(&pgcache_head->lock);
-	if (dlist_is_empty(&pgcache_head->build_list))
+	if (dlist_is_empty(&pgcache_head->build_list) ||
+		(GpuWorkerCurrentContext && pgcache_head->num_active_builders > 0))
 	{
 		SpinLockRelease(&pgcache_head->lock);
 		return false;		/* no programs were built */
@@ -992,7 +1329,8 @@ pgstrom_try_build_cuda_program(void)
 	 * This thread will focus on the program build, so some other
 	 * worker needs to process the pending tasks.
 	 */
-	pthreadCondSignal(GpuWorkerCurrentContext->cond);
+	if (GpuWorkerCurrentContext)
+		pthreadCondSignal(GpuWorkerCurrentContext->cond);
 
 	STROM_TRY();
 	{
@@ -1000,26 +1338,202 @@ pgstrom_try_build_cuda_program(void)
 	}
 	STROM_CATCH();
 	{
-		/*
-		 * Unlike CUDA_PROGRAM_BUILD_FAILURE case, exceptions are usually
-		 * raised by resource starvation, thus, restart of GPU server may
-		 * be able to build the GPU program on the next trial.
-		 * So, CUDA program entry is backed to the build pending list.
-		 */
-		SpinLockAcquire(&pgcache_head->lock);
-		dlist_push_tail(&pgcache_head->build_list, &entry->build_chain);
-		put_cuda_program_entry_nolock(entry);
-		SpinLockRelease(&pgcache_head->lock);
+		if (program_builder_id >= 0)
+		{
+			ErrorData  *edata;
 
-		STROM_RE_THROW();
+			/*
+			 * An ERROR terminates the program builder, then postmaster
+			 * restarts it and it picks up the same entry again. So, the
+			 * entry is marked as build failure here, and the backends
+			 * waiting for the build report the error.
+			 */
+			MemoryContextSwitchTo(oldcxt);
+			edata = CopyErrorData();
+			FlushErrorState();
+
+			elog(LOG, "PG-Strom: failed on build of GPU program (ProgramId=%lu): %s",
+				 entry->program_id, edata->message);
+
+			SpinLockAcquire(&pgcache_head->lock);
+			entry->error_code = edata->sqlerrcode;
+			snprintf(entry->error_msg, PGCACHE_MIN_ERRORMSG_BUFSIZE,
+					 "build failure: %s", edata->message);
+			entry->ptx_image = CUDA_PROGRAM_BUILD_FAILURE;
+			put_cuda_program_entry_nolock(entry);
+			SpinLockRelease(&pgcache_head->lock);
+
+			FreeErrorData(edata);
+			build_failed = true;
+		}
+		else
+		{
+			/*
+			 * Unlike CUDA_PROGRAM_BUILD_FAILURE case, exceptions are
+			 * usually raised by resource starvation, thus, restart of GPU
+			 * server may be able to build the GPU program on the next
+			 * trial. So, CUDA program entry is backed to the build pending
+			 * list.
+			 */
+			SpinLockAcquire(&pgcache_head->lock);
+			dlist_push_tail(&pgcache_head->build_list, &entry->build_chain);
+			put_cuda_program_entry_nolock(entry);
+			SpinLockRelease(&pgcache_head->lock);
+
+			STROM_RE_THROW();
+		}
 	}
 	STROM_END_TRY();
 
-	put_cuda_program_entry(entry);
+	if (!build_failed)
+		put_cuda_program_entry(entry);
 
 	return true;
 }
 
+/*
+ * wakeup_cuda_program_builder - wake up an idle program builder, if any
+ */
+static void
+wakeup_cuda_program_builder(void)
+{
+	Latch	   *latch = NULL;
+	int			i;
+
+	SpinLockAcquire(&pgcache_head->lock);
+	for (i=0; i < num_program_builders; i++)
+	{
+		program_builder_state *builder = &pgcache_head->builders[i];
+
+		if (builder->latch && builder->is_idle)
+		{
+			builder->is_idle = false;
+			latch = builder->latch;
+			break;
+		}
+	}
+	SpinLockRelease(&pgcache_head->lock);
+
+	if (latch)
+		SetLatch(latch);
+}
+
+/*
+ * pgstrom_program_builder_sigterm
+ */
+static void
+pgstrom_program_builder_sigterm(SIGNAL_ARGS)
+{
+	int		saved_errno = errno;
+
+	program_builder_got_sigterm = true;
+
+	pg_memory_barrier();
+
+	SetLatch(MyLatch);
+
+	errno = saved_errno;
+}
+
+/*
+ * pgstrom_program_builder_on_shutdown
+ */
+static void
+pgstrom_program_builder_on_shutdown(int code, Datum arg)
+{
+	program_builder_state *builder = &pgcache_head->builders[program_builder_id];
+
+	SpinLockAcquire(&pgcache_head->lock);
+	if (builder->latch)
+	{
+		builder->latch = NULL;
+		builder->is_idle = false;
+		pgcache_head->num_active_builders--;
+	}
+	SpinLockRelease(&pgcache_head->lock);
+}
+
+/*
+ * pgstrom_program_builder_main
+ *
+ * Main routine of the background worker which runs NVRTC on the pending
+ * GPU programs. Multiple builders allow to compile programs concurrently.
+ */
+void
+pgstrom_program_builder_main(Datum arg)
+{
+	program_builder_state *builder;
+	int			ev;
+
+	program_builder_id = DatumGetInt32(arg);
+	Assert(program_builder_id >= 0 &&
+		   program_builder_id < num_program_builders);
+	pqsignal(SIGTERM, pgstrom_program_builder_sigterm);
+	BackgroundWorkerUnblockSignals();
+
+	builder = &pgcache_head->builders[program_builder_id];
+	SpinLockAcquire(&pgcache_head->lock);
+	builder->latch = MyLatch;
+	builder->is_idle = false;
+	pgcache_head->num_active_builders++;
+	SpinLockRelease(&pgcache_head->lock);
+
+	PG_ENSURE_ERROR_CLEANUP(pgstrom_program_builder_on_shutdown, 0);
+	{
+		while (!program_builder_got_sigterm)
+		{
+			ResetLatch(MyLatch);
+
+			if (pgstrom_try_build_cuda_program())
+				continue;
+
+			SpinLockAcquire(&pgcache_head->lock);
+			builder->is_idle = true;
+			SpinLockRelease(&pgcache_head->lock);
+
+			ev = WaitLatch(MyLatch,
+						   WL_LATCH_SET |
+						   WL_TIMEOUT |
+						   WL_POSTMASTER_DEATH,
+						   10000L
+#if PG_VERSION_NUM >= 100000
+						   ,PG_WAIT_EXTENSION
+#endif
+				);
+			if (ev & WL_POSTMASTER_DEATH)
+				elog(FATAL, "Unexpected postmaster dead");
+
+			SpinLockAcquire(&pgcache_head->lock);
+			builder->is_idle = false;
+			SpinLockRelease(&pgcache_head->lock);
+		}
+	}
+	PG_END_ENSURE_ERROR_CLEANUP(pgstrom_program_builder_on_shutdown, 0);
+	pgstrom_program_builder_on_shutdown(0, 0);
+	proc_exit(1);
+}
+
+/*
+ * pgstrom_cuda_program_is_ready
+ *
+ * It checks whether the GPU program is already built, or not. Build failure
+ * is also considered as ready, because its error shall be raised on load.
+ */
+bool
+pgstrom_cuda_program_is_ready(ProgramId program_id)
+{
+	program_cache_entry *entry;
+	bool		retval = false;
+
+	SpinLockAcquire(&pgcache_head->lock);
+	entry = lookup_cuda_program_entry_nolock(program_id);
+	if (entry && entry->ptx_image != NULL)
+		retval = true;
+	SpinLockRelease(&pgcache_head->lock);
+
+	return retval;
+}
+
 /*
  * pgstrom_create_cuda_program
  *
@@ -1193,6 +1707,7 @@ __pgstrom_create_cuda_program(GpuContext *gcontext,
 	/*
 	 * Start asynchronous code build with NVRTC
 	 */
+	wakeup_cuda_program_builder();
 	pthreadCondSignal(gcontext->cond);
 
 	/* wait for completion of build, if needed */
@@ -1281,6 +1796,9 @@ pgstrom_build_session_info(StringInfo buf,
 	/* put text/string info */
 	if ((extra_flags & DEVKERNEL_NEEDS_TEXTLIB) != 0)
 		assign_textlib_session_info(buf);
+	/* size of the per-thread varlena buffer */
+	appendStringInfo(buf, "#define KERN_CONTEXT_VARLENA_BUFSZ %u\n",
+					 gts ? gts->varlena_bufsz : 0);
 
 	/* enables device projection? */
 	if ((extra_flags & DEVKERNEL_NEEDS_GPUSCAN) != 0)
@@ -1556,6 +2074,7 @@ pgstrom_init_cuda_program(void)
 {
 	int			major;
 	int			minor;
+	int			i;
 	nvrtcResult	rc;
 
 	/*
@@ -1572,6 +2091,36 @@ pgstrom_init_cuda_program(void)
 							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
 							NULL, NULL, NULL);
 
+	/*
+	 * directory of the on-disk program cache
+	 */
+	DefineCustomStringVariable("pg_strom.program_cache_dir",
+							   "directory to save GPU programs already built",
+							   NULL,
+							   &program_cache_dir,
+							   "pg_strom_cache",
+							   PGC_POSTMASTER,
+							   GUC_NOT_IN_SAMPLE | GUC_SUPERUSER_ONLY,
+							   NULL, NULL, NULL);
+	if (program_cache_dir && program_cache_dir[0] != '\0' &&
+		mkdir(program_cache_dir, S_IRWXU) != 0 && errno != EEXIST)
+		elog(ERROR, "could not create directory \"%s\": %m",
+			 program_cache_dir);
+
+	/*
+	 * number of background workers for program build
+	 */
+	DefineCustomIntVariable("pg_strom.num_program_builders",
+							"number of background workers to build GPU programs",
+							NULL,
+							&num_program_builders,
+							2,
+							0,
+							PGCACHE_MAX_BUILDERS,
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
 	/*
 	 * Enables debug option on GPU kernel build
 	 */
@@ -1599,12 +2148,54 @@ pgstrom_init_cuda_program(void)
 #include "cuda_filelist"
 #undef PGSTROM_CUDA
 
+	/*
+	 * signature of the on-disk program cache; PTX image built by different
+	 * version of NVRTC or cuda_xxxx.h files shall not be reused.
+	 */
+	INIT_LEGACY_CRC32(program_cache_file_signature);
+	COMP_LEGACY_CRC32(program_cache_file_signature, &major, sizeof(int));
+	COMP_LEGACY_CRC32(program_cache_file_signature, &minor, sizeof(int));
+#define PGSTROM_CUDA(x)												\
+	{																	\
+		struct stat	st_buf;												\
+																		\
+		if (stat(pgstrom_cuda_##x##_pathname, &st_buf) == 0)			\
+		{																\
+			COMP_LEGACY_CRC32(program_cache_file_signature,				\
+							  &st_buf.st_mtime, sizeof(time_t));		\
+			COMP_LEGACY_CRC32(program_cache_file_signature,				\
+							  &st_buf.st_size, sizeof(off_t));			\
+		}																\
+	}
+#include "cuda_filelist"
+#undef PGSTROM_CUDA
+	FIN_LEGACY_CRC32(program_cache_file_signature);
+	cleanup_cuda_program_files();
+
 	/* allocation of static shared memory */
 	RequestAddinShmemSpace(offsetof(program_cache_head, base) +
 						   ((size_t)program_cache_size_kb << 10));
 	shmem_startup_next = shmem_startup_hook;
 	shmem_startup_hook = pgstrom_startup_cuda_program;
 
+	/* registration of program builder workers */
+	for (i=0; i < num_program_builders; i++)
+	{
+		BackgroundWorker worker;
+
+		memset(&worker, 0, sizeof(BackgroundWorker));
+		snprintf(worker.bgw_name, sizeof(worker.bgw_name),
+				 "PG-Strom program-builder%d", i+1);
+		worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+		worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+		worker.bgw_restart_time = 2;
+		snprintf(worker.bgw_library_name, BGW_MAXLEN, "pg_strom");
+		snprintf(worker.bgw_function_name, BGW_MAXLEN,
+				 "pgstrom_program_builder_main");
+		worker.bgw_main_arg = Int32GetDatum(i);
+		RegisterBackgroundWorker(&worker);
+	}
+
 	/* build wrapper library objects */
 	build_wrapper_libraries("cuda_curand.h",
 							&curand_wrapper_lib,
@@ -17,6 +17,55 @@
  */
 #ifndef CUDA_TEXTLIB_H
 #define CUDA_TEXTLIB_H
+
+/*
+ * kern_regex_dfa
+ *
+ * DFA table of a regular expression pattern, compiled on the host side
+ * (see codegen.c) and delivered to the device as a bytea parameter.
+ * Input bytes are mapped to equivalence classes by @classmap, then the
+ * next state is fetched from the transition table. State 0 is the start
+ * state. All the fields are cl_ushort/cl_uchar, so the payload needs only
+ * 2-bytes alignment.
+ */
+#define KERN_REGEX_DFA_ACCEPT_ANY	0x0001	/* match regardless of the rest */
+#define KERN_REGEX_DFA_ACCEPT_EOS	0x0002	/* match only at end of string */
+#define KERN_REGEX_DFA_DEAD			0xffff	/* no more match is possible */
+
+typedef struct
+{
+	cl_ushort	nstates;	/* number of DFA states */
+	cl_ushort	nclasses;	/* number of byte equivalence classes */
+	cl_uchar	classmap[256];
+	/*
+	 * data[nstates] - accept flags of each state, followed by
+	 * data[nstates * nclasses] - transition table
+	 */
+	cl_ushort	data[FLEXIBLE_ARRAY_MEMBER];
+} kern_regex_dfa;
+
+/*
+ * kern_like_pattern
+ *
+ * LIKE pattern that contains '%' only at the head and/or the tail, and no
+ * '_'. Codegen classifies the pattern and unescapes the fixed string, so
+ * device code can run a simple comparison or substring search instead of
+ * the generic recursive matcher. @bitap is the shift-and mask table of
+ * the needle, if mode is SUBSTR and nlen is less than or equal to 32.
+ */
+#define KERN_LIKE_PATTERN_EXACT		1	/* 'foo' */
+#define KERN_LIKE_PATTERN_PREFIX	2	/* 'foo%' */
+#define KERN_LIKE_PATTERN_SUFFIX	3	/* '%foo' */
+#define KERN_LIKE_PATTERN_SUBSTR	4	/* '%foo%' */
+
+typedef struct
+{
+	cl_uint		mode;
+	cl_uint		nlen;
+	cl_uint		bitap[256];
+	char		needle[FLEXIBLE_ARRAY_MEMBER];
+} kern_like_pattern;
+
 #ifdef __CUDACC__
 
 /* ----------------------------------------------------------------
@@ -321,15 +370,219 @@ pgfn_textlen(kern_context *kcxt, pg_text_t arg1)
 {
 	pg_int4_t	result;
 
-	/* NOTE: At this moment, we don't support any special encodings,
-	 * so no multibytes character is assumed.
-	 */
+	result.isnull = arg1.isnull;
+	if (!result.isnull)
+	{
+		const char *pos = VARDATA_ANY(arg1.value);
+		const char *end = pos + VARSIZE_ANY_EXHDR(arg1.value);
+		cl_int		len = 0;
+
+		/* count number of characters according to the encoding */
+		while (pos < end)
+		{
+			pos += pg_wchar_mblen(pos);
+			len++;
+		}
+		result.value = len;
+	}
+	return result;
+}
+
+STATIC_FUNCTION(pg_int4_t)
+pgfn_textoctetlen(kern_context *kcxt, pg_text_t arg1)
+{
+	pg_int4_t	result;
+
 	result.isnull = arg1.isnull;
 	if (!result.isnull)
 		result.value = toast_raw_datum_size(kcxt, arg1.value) - VARHDRSZ;
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *
+ * Text functions that construct a new varlena datum
+ *
+ * The result is allocated on the per-thread varlena buffer of the
+ * kern_context. If it runs out, StromError_CpuReCheck is raised.
+ * ----------------------------------------------------------------
+ */
+STATIC_INLINE(pg_text_t)
+pg_text_alloc(kern_context *kcxt, cl_uint len)
+{
+	pg_text_t	result;
+
+	result.value = (varlena *)kern_context_alloc(kcxt, VARHDRSZ + len);
+	result.isnull = !result.value;
+	if (result.value)
+		SET_VARSIZE(result.value, VARHDRSZ + len);
+	return result;
+}
+
+STATIC_FUNCTION(pg_text_t)
+text_substring(kern_context *kcxt, varlena *str,
+			   cl_int S, cl_int L, cl_bool length_not_specified)
+{
+	pg_text_t	result;
+	const char *pos = VARDATA_ANY(str);
+	const char *end = pos + VARSIZE_ANY_EXHDR(str);
+	const char *head;
+	cl_int		S1 = Max(S, 1);
+	cl_long		L1 = -1;	/* up to the end of string */
+	cl_long		i;
+
+	if (!length_not_specified)
+	{
+		if (L < 0)
+		{
+			/* negative length raises an error on CPU */
+			result.isnull = true;
+			STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+			return result;
+		}
+		if ((cl_long)S + (cl_long)L < 1)
+			L1 = 0;
+		else
+			L1 = (cl_long)S + (cl_long)L - (cl_long)S1;
+	}
+	/* skip the characters prior to S1 */
+	for (i=1; i < S1 && pos < end; i++)
+		pos += pg_wchar_mblen(pos);
+	head = Min(pos, end);
+	if (L1 < 0)
+		pos = end;
+	else
+	{
+		for (i=0; i < L1 && pos < end; i++)
+			pos += pg_wchar_mblen(pos);
+	}
+	pos = Min(pos, end);
+
+	/* no need to copy, if whole the string is the result */
+	if (head == VARDATA_ANY(str) && pos == end)
+	{
+		result.isnull = false;
+		result.value = str;
+		return result;
+	}
+	result = pg_text_alloc(kcxt, pos - head);
+	if (!result.isnull)
+		memcpy(VARDATA(result.value), head, pos - head);
+	return result;
+}
+
+STATIC_FUNCTION(pg_text_t)
+pgfn_text_substring(kern_context *kcxt,
+					pg_text_t arg1, pg_int4_t arg2, pg_int4_t arg3)
+{
+	pg_text_t	result;
+
+	if (arg1.isnull || arg2.isnull || arg3.isnull)
+	{
+		result.isnull = true;
+		return result;
+	}
+	return text_substring(kcxt, arg1.value, arg2.value, arg3.value, false);
+}
+
+STATIC_FUNCTION(pg_text_t)
+pgfn_text_substring_nolen(kern_context *kcxt,
+						  pg_text_t arg1, pg_int4_t arg2)
+{
+	pg_text_t	result;
+
+	if (arg1.isnull || arg2.isnull)
+	{
+		result.isnull = true;
+		return result;
+	}
+	return text_substring(kcxt, arg1.value, arg2.value, -1, true);
+}
+
+/*
+ * lower/upper - only available on C-locale, so ASCII characters are
+ * converted as asc_tolower() / asc_toupper() doing.
+ */
+STATIC_FUNCTION(pg_text_t)
+pgfn_lower(kern_context *kcxt, pg_text_t arg1)
+{
+	pg_text_t	result;
+	const char *src;
+	char	   *dst;
+	cl_uint		i, len;
+
+	if (arg1.isnull)
+		return arg1;
+	src = VARDATA_ANY(arg1.value);
+	len = VARSIZE_ANY_EXHDR(arg1.value);
+	result = pg_text_alloc(kcxt, len);
+	if (!result.isnull)
+	{
+		dst = VARDATA(result.value);
+		for (i=0; i < len; i++)
+		{
+			char	c = src[i];
+
+			dst[i] = (c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+		}
+	}
+	return result;
+}
+
+STATIC_FUNCTION(pg_text_t)
+pgfn_upper(kern_context *kcxt, pg_text_t arg1)
+{
+	pg_text_t	result;
+	const char *src;
+	char	   *dst;
+	cl_uint		i, len;
+
+	if (arg1.isnull)
+		return arg1;
+	src = VARDATA_ANY(arg1.value);
+	len = VARSIZE_ANY_EXHDR(arg1.value);
+	result = pg_text_alloc(kcxt, len);
+	if (!result.isnull)
+	{
+		dst = VARDATA(result.value);
+		for (i=0; i < len; i++)
+		{
+			char	c = src[i];
+
+			dst[i] = (c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c);
+		}
+	}
+	return result;
+}
+
+STATIC_FUNCTION(pg_text_t)
+pgfn_textcat(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2)
+{
+	pg_text_t	result;
+	cl_uint		len1;
+	cl_uint		len2;
+
+	if (arg1.isnull || arg2.isnull)
+	{
+		result.isnull = true;
+		return result;
+	}
+	len1 = VARSIZE_ANY_EXHDR(arg1.value);
+	len2 = VARSIZE_ANY_EXHDR(arg2.value);
+	/* no need to copy, if either of them is empty */
+	if (len2 == 0)
+		return arg1;
+	if (len1 == 0)
+		return arg2;
+	result = pg_text_alloc(kcxt, len1 + len2);
+	if (!result.isnull)
+	{
+		memcpy(VARDATA(result.value), VARDATA_ANY(arg1.value), len1);
+		memcpy(VARDATA(result.value) + len1, VARDATA_ANY(arg2.value), len2);
+	}
+	return result;
+}
+
 /*
  * varchar(*) type definition
  */
@@ -668,6 +921,156 @@ pgfn_texticnlike(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2)
 #undef LIKE_FALSE
 #undef LIKE_ABORT
 
+/*
+ * LIKE with pre-classified pattern
+ *
+ * Unlike GenericMatchText, it has neither backtracking nor abort, and the
+ * shift-and loop consumes one byte per iteration in the same way, so
+ * threads in a warp stay convergent even on long text values.
+ */
+STATIC_FUNCTION(cl_bool)
+LikeMatchFastPath(const kern_like_pattern *lpat,
+				  const cl_uchar *s, cl_uint slen)
+{
+	const cl_uchar *needle = (const cl_uchar *)lpat->needle;
+	cl_uint		nlen = lpat->nlen;
+	cl_uint		i;
+
+	if (slen < nlen)
+		return false;
+	switch (lpat->mode)
+	{
+		case KERN_LIKE_PATTERN_EXACT:
+			return (slen == nlen && memcmp(s, needle, nlen) == 0);
+		case KERN_LIKE_PATTERN_PREFIX:
+			return (memcmp(s, needle, nlen) == 0);
+		case KERN_LIKE_PATTERN_SUFFIX:
+			return (memcmp(s + slen - nlen, needle, nlen) == 0);
+		case KERN_LIKE_PATTERN_SUBSTR:
+			if (nlen == 0)
+				return true;
+			if (nlen <= 32)
+			{
+				cl_uint		hit = (1U << (nlen - 1));
+				cl_uint		state = 0;
+
+				for (i=0; i < slen; i++)
+				{
+					state = ((state << 1) | 1U) & lpat->bitap[s[i]];
+					if ((state & hit) != 0)
+						return true;
+				}
+			}
+			else
+			{
+				for (i=0; i <= slen - nlen; i++)
+				{
+					if (s[i] == needle[0] &&
+						memcmp(s + i + 1, needle + 1, nlen - 1) == 0)
+						return true;
+				}
+			}
+			return false;
+		default:
+			break;
+	}
+	return false;
+}
+
+STATIC_FUNCTION(pg_bool_t)
+pgfn_textlike_fastpath(kern_context *kcxt, pg_text_t arg1, pg_bytea_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		const cl_uchar *s = (const cl_uchar *)VARDATA_ANY(arg1.value);
+		cl_uint		slen = VARSIZE_ANY_EXHDR(arg1.value);
+
+		result.value = LikeMatchFastPath((const kern_like_pattern *)
+										 VARDATA_ANY(arg2.value), s, slen);
+	}
+	return result;
+}
+
+STATIC_FUNCTION(pg_bool_t)
+pgfn_textnlike_fastpath(kern_context *kcxt, pg_text_t arg1, pg_bytea_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		const cl_uchar *s = (const cl_uchar *)VARDATA_ANY(arg1.value);
+		cl_uint		slen = VARSIZE_ANY_EXHDR(arg1.value);
+
+		result.value = !LikeMatchFastPath((const kern_like_pattern *)
+										  VARDATA_ANY(arg2.value), s, slen);
+	}
+	return result;
+}
+
+/* ----------------------------------------------------------------
+ *
+ * Regular expression (~, ~*, !~, !~*) by pre-compiled DFA
+ *
+ * ----------------------------------------------------------------
+ */
+STATIC_FUNCTION(cl_bool)
+RegexMatchDFA(const kern_regex_dfa *dfa, const cl_uchar *s, cl_uint slen)
+{
+	const cl_ushort *accept = dfa->data;
+	const cl_ushort *trans = dfa->data + dfa->nstates;
+	cl_uint		nclasses = dfa->nclasses;
+	cl_uint		curr = 0;
+	cl_uint		i;
+
+	for (i=0; i < slen; i++)
+	{
+		if ((accept[curr] & KERN_REGEX_DFA_ACCEPT_ANY) != 0)
+			return true;
+		curr = trans[curr * nclasses + dfa->classmap[s[i]]];
+		if (curr == KERN_REGEX_DFA_DEAD)
+			return false;
+	}
+	return (accept[curr] != 0);
+}
+
+STATIC_FUNCTION(pg_bool_t)
+pgfn_textregexeq_dfa(kern_context *kcxt, pg_text_t arg1, pg_bytea_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		const cl_uchar *s = (const cl_uchar *)VARDATA_ANY(arg1.value);
+		cl_uint		slen = VARSIZE_ANY_EXHDR(arg1.value);
+
+		result.value = RegexMatchDFA((const kern_regex_dfa *)
+									 VARDATA_ANY(arg2.value), s, slen);
+	}
+	return result;
+}
+
+STATIC_FUNCTION(pg_bool_t)
+pgfn_textregexne_dfa(kern_context *kcxt, pg_text_t arg1, pg_bytea_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		const cl_uchar *s = (const cl_uchar *)VARDATA_ANY(arg1.value);
+		cl_uint		slen = VARSIZE_ANY_EXHDR(arg1.value);
+
+		result.value = !RegexMatchDFA((const kern_regex_dfa *)
+									  VARDATA_ANY(arg2.value), s, slen);
+	}
+	return result;
+}
+
 
 
 #else	/* __CUDACC__ */
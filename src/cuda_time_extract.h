@@ -929,5 +929,282 @@ pgfn_extract_time(kern_context *kcxt, pg_text_t arg1, pg_time_t arg2)
 	return result;
 }
 
+/*
+ * date_trunc(text,timestamp[tz])
+ */
+STATIC_INLINE(cl_int)
+isoweek2j(int year, int week)
+{
+	int		day0, day4;
+
+	/* fourth day of current year */
+	day4 = date2j(year, 1, 4);
+	/* day0 == offset to first day of week (Monday) */
+	day0 = j2day(day4 - 1);
+
+	return ((week - 1) * 7) + (day4 - day0);
+}
+
+/*
+ * date_trunc_tm - truncates fields of struct pg_tm according to the unit;
+ * returns false if unit is not supported. *redotz is set if timezone offset
+ * has to be determined again for the truncated date.
+ */
+STATIC_FUNCTION(cl_bool)
+date_trunc_tm(int val, struct pg_tm *tm, fsec_t *fsec, cl_bool *redotz)
+{
+	*redotz = false;
+	switch (val)
+	{
+		case DTK_WEEK:
+			{
+				int		woy = date2isoweek(tm->tm_year,
+										   tm->tm_mon,
+										   tm->tm_mday);
+				/*
+				 * If it is week 52/53 and the month is January, then
+				 * the week must belong to the previous year. Also, some
+				 * December dates belong to the next year.
+				 */
+				if (woy >= 52 && tm->tm_mon == 1)
+					--tm->tm_year;
+				if (woy <= 1 && tm->tm_mon == MONTHS_PER_YEAR)
+					++tm->tm_year;
+				j2date(isoweek2j(tm->tm_year, woy),
+					   &tm->tm_year, &tm->tm_mon, &tm->tm_mday);
+			}
+			tm->tm_hour = 0;
+			tm->tm_min = 0;
+			tm->tm_sec = 0;
+			*fsec = 0;
+			*redotz = true;
+			return true;
+		case DTK_MILLENNIUM:
+			/* see comments in timestamptz_trunc */
+			if (tm->tm_year > 0)
+				tm->tm_year = ((tm->tm_year + 999) / 1000) * 1000 - 999;
+			else
+				tm->tm_year = -((999 - (tm->tm_year - 1)) / 1000) * 1000 + 1;
+		case DTK_CENTURY:
+			/* see comments in timestamptz_trunc */
+			if (tm->tm_year > 0)
+				tm->tm_year = ((tm->tm_year + 99) / 100) * 100 - 99;
+			else
+				tm->tm_year = -((99 - (tm->tm_year - 1)) / 100) * 100 + 1;
+		case DTK_DECADE:
+			/* see comments in timestamptz_trunc */
+			if (val != DTK_MILLENNIUM && val != DTK_CENTURY)
+			{
+				if (tm->tm_year > 0)
+					tm->tm_year = (tm->tm_year / 10) * 10;
+				else
+					tm->tm_year = -((8 - (tm->tm_year - 1)) / 10) * 10;
+			}
+		case DTK_YEAR:
+			tm->tm_mon = 1;
+		case DTK_QUARTER:
+			tm->tm_mon = (3 * ((tm->tm_mon - 1) / 3)) + 1;
+		case DTK_MONTH:
+			tm->tm_mday = 1;
+		case DTK_DAY:
+			tm->tm_hour = 0;
+			*redotz = true;		/* for all cases >= DAY */
+		case DTK_HOUR:
+			tm->tm_min = 0;
+		case DTK_MINUTE:
+			tm->tm_sec = 0;
+		case DTK_SECOND:
+			*fsec = 0;
+			return true;
+		case DTK_MILLISEC:
+			*fsec = (*fsec / 1000) * 1000;
+			return true;
+		case DTK_MICROSEC:
+			return true;
+		default:
+			break;
+	}
+	return false;
+}
+
+STATIC_FUNCTION(pg_timestamp_t)
+pgfn_date_trunc_timestamp(kern_context *kcxt,
+						  pg_text_t arg1, pg_timestamp_t arg2)
+{
+	pg_timestamp_t	result;
+	cl_int			type, val;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (result.isnull)
+		return result;
+	if (TIMESTAMP_NOT_FINITE(arg2.value))
+	{
+		result.value = arg2.value;
+		return result;
+	}
+	if (extract_decode_unit(arg1.value, &type, &val) && type == UNITS)
+	{
+		fsec_t		fsec;
+		struct pg_tm tm;
+		cl_bool		redotz;
+
+		if (timestamp2tm(arg2.value, NULL, &tm, &fsec, NULL) &&
+			date_trunc_tm(val, &tm, &fsec, &redotz) &&
+			tm2timestamp(&tm, fsec, NULL, &result.value))
+			return result;
+	}
+	STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+	result.isnull = true;
+	return result;
+}
+
+STATIC_FUNCTION(pg_timestamptz_t)
+pgfn_date_trunc_timestamptz(kern_context *kcxt,
+							pg_text_t arg1, pg_timestamptz_t arg2)
+{
+	pg_timestamptz_t result;
+	cl_int			type, val;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (result.isnull)
+		return result;
+	if (TIMESTAMP_NOT_FINITE(arg2.value))
+	{
+		result.value = arg2.value;
+		return result;
+	}
+	if (extract_decode_unit(arg1.value, &type, &val) && type == UNITS)
+	{
+		fsec_t		fsec;
+		int			tz;
+		struct pg_tm tm;
+		cl_bool		redotz;
+
+		if (timestamp2tm(arg2.value, &tz, &tm, &fsec, NULL) &&
+			date_trunc_tm(val, &tm, &fsec, &redotz))
+		{
+			if (redotz)
+				tz = DetermineTimeZoneOffset(&tm, &session_timezone_state);
+			if (tm2timestamp(&tm, fsec, &tz, &result.value))
+				return result;
+		}
+	}
+	STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+	result.isnull = true;
+	return result;
+}
+
+/*
+ * time_bucket(interval,timestamp[tz])
+ *
+ * Fixed width buckets (days and time) are aligned to 2000-01-03, the first
+ * Monday after the PostgreSQL epoch, so that weekly buckets begin on Monday.
+ * Monthly buckets are aligned to 2000-01-01. timestamptz is bucketed in UTC.
+ * Any combination the host implementation raises an error on is handed back
+ * to CPU.
+ */
+#define TIME_BUCKET_ORIGIN_FIXED	(2 * USECS_PER_DAY)
+#define TIME_BUCKET_ORIGIN_YEAR		2000
+
+STATIC_FUNCTION(cl_bool)
+time_bucket_common(Interval width, Timestamp ts, Timestamp *result)
+{
+	if (TIMESTAMP_NOT_FINITE(ts))
+	{
+		*result = ts;
+		return true;
+	}
+
+	if (width.month != 0)
+	{
+		struct pg_tm tm;
+		fsec_t		fsec;
+		cl_long		months;
+		cl_long		offset;
+
+		if (width.month < 0 || width.day != 0 || width.time != 0)
+			return false;
+		if (!timestamp2tm(ts, NULL, &tm, &fsec, NULL))
+			return false;
+		months = ((tm.tm_year - TIME_BUCKET_ORIGIN_YEAR) * MONTHS_PER_YEAR +
+				  (tm.tm_mon - 1));
+		offset = months % width.month;
+		if (offset < 0)
+			offset += width.month;
+		months -= offset;
+		tm.tm_year = (months >= 0
+					  ? months / MONTHS_PER_YEAR
+					  : -((MONTHS_PER_YEAR - 1 - months) / MONTHS_PER_YEAR));
+		tm.tm_mon = months - tm.tm_year * MONTHS_PER_YEAR + 1;
+		tm.tm_year += TIME_BUCKET_ORIGIN_YEAR;
+		tm.tm_mday = 1;
+		tm.tm_hour = 0;
+		tm.tm_min = 0;
+		tm.tm_sec = 0;
+
+		return tm2timestamp(&tm, 0, NULL, result);
+	}
+	else
+	{
+		TimeOffset	period;
+		TimeOffset	offset;
+
+		/* interval out of range; let CPU raise an error */
+		if (width.day > LONG_MAX / USECS_PER_DAY ||
+			width.day < LONG_MIN / USECS_PER_DAY)
+			return false;
+		period = width.day * USECS_PER_DAY;
+		if (width.time > 0 ? period > LONG_MAX - width.time
+						   : period < LONG_MIN - width.time)
+			return false;
+		period += width.time;
+		if (period <= 0)
+			return false;
+		/* same as ORIGIN + floor(delta / period) * period, without overflow */
+		offset = (ts - TIME_BUCKET_ORIGIN_FIXED) % period;
+		if (offset < 0)
+			offset += period;
+		if (ts < LONG_MIN + offset)
+			return false;
+		*result = ts - offset;
+		/* result is never later than ts, but may go before Julian day 0 */
+		if (*result < -((Timestamp)POSTGRES_EPOCH_JDATE * USECS_PER_DAY))
+			return false;
+	}
+	return true;
+}
+
+STATIC_FUNCTION(pg_timestamp_t)
+pgfn_time_bucket_timestamp(kern_context *kcxt,
+						   pg_interval_t arg1, pg_timestamp_t arg2)
+{
+	pg_timestamp_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull &&
+		!time_bucket_common(arg1.value, arg2.value, &result.value))
+	{
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		result.isnull = true;
+	}
+	return result;
+}
+
+STATIC_FUNCTION(pg_timestamptz_t)
+pgfn_time_bucket_timestamptz(kern_context *kcxt,
+							 pg_interval_t arg1, pg_timestamptz_t arg2)
+{
+	pg_timestamptz_t result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull &&
+		!time_bucket_common(arg1.value, arg2.value, &result.value))
+	{
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		result.isnull = true;
+	}
+	return result;
+}
+
 #endif /* __CUDACC__ */
 #endif /* CUDA_TIME_EXTRACT_H */
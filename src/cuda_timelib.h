@@ -1734,7 +1734,7 @@ pgfn_timestamptz_timetz(kern_context *kcxt, pg_timestamptz_t arg1)
 		result.isnull = true;
 	else if (TIMESTAMP_NOT_FINITE(arg1.value))
 		result.isnull = true;
-	else if (timestamp2tm(arg1.value, &tz, &tm, &fsec, NULL) != 0)
+	else if (!timestamp2tm(arg1.value, &tz, &tm, &fsec, NULL))
 	{
 		// ERRCODE_DATETIME_VALUE_OUT_OF_RANGE
 		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
@@ -1851,6 +1851,116 @@ pgfn_timestamp_timestamptz(kern_context *kcxt, pg_timestamp_t arg1)
 	return timestamp2timestamptz(kcxt, arg1);
 }
 
+/*
+ * AT TIME ZONE operators
+ *
+ * Constant zone name is resolved on the host side, then replaced by
+ * a pair of int4 parameters (see pgstrom_devfunc_timezone_lookup), so
+ * the kernel source does not depend on the zone name. Zones with a fixed
+ * UTC offset are given as seconds east of Greenwich on @gmtoff. Zones with
+ * DST rules are supported only if it is the session TimeZone; hash of its
+ * name is given on @tzhash to detect TimeZone changes after planning.
+ * Only one of them is not NULL.
+ */
+STATIC_FUNCTION(pg_timestamp_t)
+pgfn_timestamptz_zone(kern_context *kcxt, pg_int4_t gmtoff,
+					  pg_int4_t tzhash, pg_timestamptz_t arg)
+{
+	pg_timestamp_t	result;
+
+	if (!tzhash.isnull)
+	{
+		if ((cl_uint)tzhash.value != SESSION_TIMEZONE_HASH)
+		{
+			STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+			result.isnull = true;
+			return result;
+		}
+		return pgfn_timestamptz_timestamp(kcxt, arg);
+	}
+	result.isnull = gmtoff.isnull | arg.isnull;
+	if (!result.isnull)
+	{
+		if (TIMESTAMP_NOT_FINITE(arg.value))
+			result.value = arg.value;
+		else
+			result.value = dt2local(arg.value, -gmtoff.value);
+	}
+	return result;
+}
+
+STATIC_FUNCTION(pg_timestamptz_t)
+pgfn_timestamp_zone(kern_context *kcxt, pg_int4_t gmtoff,
+					pg_int4_t tzhash, pg_timestamp_t arg)
+{
+	pg_timestamptz_t result;
+
+	if (!tzhash.isnull)
+	{
+		if ((cl_uint)tzhash.value != SESSION_TIMEZONE_HASH)
+		{
+			STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+			result.isnull = true;
+			return result;
+		}
+		return pgfn_timestamp_timestamptz(kcxt, arg);
+	}
+	result.isnull = gmtoff.isnull | arg.isnull;
+	if (!result.isnull)
+	{
+		if (TIMESTAMP_NOT_FINITE(arg.value))
+			result.value = arg.value;
+		else
+			result.value = dt2local(arg.value, gmtoff.value);
+	}
+	return result;
+}
+
+STATIC_FUNCTION(pg_timestamp_t)
+pgfn_timestamptz_izone(kern_context *kcxt,
+					   pg_interval_t zone, pg_timestamptz_t arg)
+{
+	pg_timestamp_t	result;
+
+	result.isnull = zone.isnull | arg.isnull;
+	if (result.isnull)
+		return result;
+	if (TIMESTAMP_NOT_FINITE(arg.value))
+		result.value = arg.value;
+	else if (zone.value.month != 0 || zone.value.day != 0)
+	{
+		// ERRCODE_INVALID_PARAMETER_VALUE
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		result.isnull = true;
+	}
+	else
+		result.value = dt2local(arg.value,
+								-(zone.value.time / USECS_PER_SEC));
+	return result;
+}
+
+STATIC_FUNCTION(pg_timestamptz_t)
+pgfn_timestamp_izone(kern_context *kcxt,
+					 pg_interval_t zone, pg_timestamp_t arg)
+{
+	pg_timestamptz_t result;
+
+	result.isnull = zone.isnull | arg.isnull;
+	if (result.isnull)
+		return result;
+	if (TIMESTAMP_NOT_FINITE(arg.value))
+		result.value = arg.value;
+	else if (zone.value.month != 0 || zone.value.day != 0)
+	{
+		// ERRCODE_INVALID_PARAMETER_VALUE
+		STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
+		result.isnull = true;
+	}
+	else
+		result.value = dt2local(arg.value, zone.value.time / USECS_PER_SEC);
+	return result;
+}
+
 /*
  * Simple comparison
  */
@@ -2135,8 +2245,9 @@ pgfn_timestamptz_pl_interval(kern_context *kcxt,
 		{
 			struct pg_tm tm;
 			fsec_t fsec;
+			int tz;
 
-			if (timestamp2tm(arg1.value, NULL, &tm, &fsec, NULL) != 0)
+			if (!timestamp2tm(arg1.value, &tz, &tm, &fsec, NULL))
 			{
 				// ERRCODE_DATETIME_VALUE_OUT_OF_RANGE
 				STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
@@ -2160,7 +2271,8 @@ pgfn_timestamptz_pl_interval(kern_context *kcxt,
 			if (tm.tm_mday > day_tab[isleap(tm.tm_year)][tm.tm_mon - 1])
 				tm.tm_mday = (day_tab[isleap(tm.tm_year)][tm.tm_mon - 1]);
 
-			if (tm2timestamp(&tm, fsec, NULL, &arg1.value) != 0)
+			tz = DetermineTimeZoneOffset(&tm, &session_timezone_state);
+			if (!tm2timestamp(&tm, fsec, &tz, &arg1.value))
 			{
 				// ERRCODE_DATETIME_VALUE_OUT_OF_RANGE
 				STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
@@ -2174,8 +2286,9 @@ pgfn_timestamptz_pl_interval(kern_context *kcxt,
 			struct pg_tm tm;
 			fsec_t fsec;
 			int julian;
+			int tz;
 
-			if (timestamp2tm(arg1.value, NULL, &tm, &fsec, NULL) != 0)
+			if (!timestamp2tm(arg1.value, &tz, &tm, &fsec, NULL))
 			{
 				// ERRCODE_DATETIME_VALUE_OUT_OF_RANGE
 				STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
@@ -2187,7 +2300,8 @@ pgfn_timestamptz_pl_interval(kern_context *kcxt,
 			julian = date2j(tm.tm_year, tm.tm_mon, tm.tm_mday) + arg2.value.day;
 			j2date(julian, &tm.tm_year, &tm.tm_mon, &tm.tm_mday);
 
-			if (tm2timestamp(&tm, fsec, NULL, &arg1.value) != 0)
+			tz = DetermineTimeZoneOffset(&tm, &session_timezone_state);
+			if (!tm2timestamp(&tm, fsec, &tz, &arg1.value))
 			{
 				// ERRCODE_DATETIME_VALUE_OUT_OF_RANGE;
 				STROM_SET_ERROR(&kcxt->e, StromError_CpuReCheck);
@@ -3624,6 +3738,12 @@ assign_timelib_session_info(StringInfo buf)
 		"#define SetEpochTimestamp() (%ldLL)\n",
 		SetEpochTimestamp());
 
+	/* hash of the session TimeZone name, see pgfn_timestamp[tz]_zone */
+	appendStringInfo(
+		buf,
+		"#define SESSION_TIMEZONE_HASH 0x%08xU\n",
+		pgstrom_timezone_name_hash(pg_get_timezone_name(session_timezone)));
+
 	appendStringInfo(
 		buf,
 		"\n"
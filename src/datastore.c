@@ -83,6 +83,28 @@ KDS_fetch_tuple_row(TupleTableSlot *slot,
 	return false;
 }
 
+/*
+ * PDS_restore_slot_reference - restores the original tts_values/tts_isnull
+ * of the slot which referenced KDS_FORMAT_SLOT directly, if any.
+ * It must be called prior to release of the slot, because these arrays are
+ * pfree'd with the slot.
+ */
+void
+PDS_restore_slot_reference(GpuTaskState *gts)
+{
+	TupleTableSlot *slot = gts->curr_ref_slot;
+
+	if (slot)
+	{
+		ExecClearTuple(slot);
+		slot->tts_values = gts->curr_ref_values;
+		slot->tts_isnull = gts->curr_ref_isnull;
+		gts->curr_ref_slot = NULL;
+		gts->curr_ref_values = NULL;
+		gts->curr_ref_isnull = NULL;
+	}
+}
+
 static inline bool
 KDS_fetch_tuple_slot(TupleTableSlot *slot,
 					 kern_data_store *kds,
@@ -91,22 +113,23 @@ KDS_fetch_tuple_slot(TupleTableSlot *slot,
 	if (gts->curr_index < kds->nitems)
 	{
 		size_t	row_index = gts->curr_index++;
-		Datum  *tts_values = KERN_DATA_STORE_VALUES(kds, row_index);
-		bool   *tts_isnull = KERN_DATA_STORE_ISNULL(kds, row_index);
-		int		natts = slot->tts_tupleDescriptor->natts;
 
-		memcpy(slot->tts_values, tts_values, sizeof(Datum) * natts);
-		memcpy(slot->tts_isnull, tts_isnull, sizeof(bool) * natts);
-#ifdef NOT_USED
 		/*
-		 * XXX - pointer reference is better than memcpy from performance
-		 * perspectives, however, we need to ensure tts_values/tts_isnull
-		 * shall be restored when pgstrom-data-store is released.
-		 * It will be cause of complicated / invisible bugs.
+		 * Slot references tts_values/tts_isnull on the KDS directly, instead
+		 * of memcpy per row. It is safe because values by reference already
+		 * point the KDS, so the virtual tuple is valid only while the KDS is
+		 * valid in either case. The original arrays of the slot are kept
+		 * on the GTS, then restored by PDS_restore_slot_reference().
 		 */
-		slot->tts_values = tts_values;
-		slot->tts_isnull = tts_isnull;
-#endif
+		if (gts->curr_ref_slot != slot)
+		{
+			PDS_restore_slot_reference(gts);
+			gts->curr_ref_slot = slot;
+			gts->curr_ref_values = slot->tts_values;
+			gts->curr_ref_isnull = slot->tts_isnull;
+		}
+		slot->tts_values = KERN_DATA_STORE_VALUES(kds, row_index);
+		slot->tts_isnull = KERN_DATA_STORE_ISNULL(kds, row_index);
 		ExecStoreVirtualTuple(slot);
 		return true;
 	}
@@ -129,7 +152,8 @@ KDS_fetch_tuple_block(TupleTableSlot *slot,
 	{
 		block_nr = KERN_DATA_STORE_BLOCK_BLCKNR(kds, gts->curr_index);
 		hpage = KERN_DATA_STORE_BLOCK_PGPAGE(kds, gts->curr_index);
-		Assert(PageIsAllVisible(hpage));
+		Assert(PageIsAllVisible(hpage) ||
+			   (gts->nvme_sstate && gts->nvme_sstate->gpu_mvcc));
 		max_lp_index = PageGetMaxOffsetNumber(hpage);
 		while (gts->curr_lp_index < max_lp_index)
 		{
@@ -141,10 +165,14 @@ KDS_fetch_tuple_block(TupleTableSlot *slot,
 
 			tuple->t_len = ItemIdGetLength(lpp);
 			BlockIdSet(&tuple->t_self.ip_blkid, block_nr);
-			tuple->t_self.ip_posid = lp_index;
+			tuple->t_self.ip_posid = lp_index + 1;
 			tuple->t_tableOid = (rel ? RelationGetRelid(rel) : InvalidOid);
 			tuple->t_data = (HeapTupleHeader)((char *)hpage +
 											  ItemIdGetOffset(lpp));
+			/* block loaded by NVMe-Strom may not be all-visible */
+			if (!PageIsAllVisible(hpage) &&
+				!PDS_recheck_visibility(gts, tuple))
+				continue;
 			ExecStoreTuple(tuple, slot, InvalidBuffer, false);
 			return true;
 		}
@@ -180,9 +208,28 @@ KDS_fetch_tuple_column(TupleTableSlot *slot,
 
 	for (j=0; j < tupdesc->natts; j++)
 	{
-		void   *addr = kern_get_datum_column(kds, j, row_index);
+		void   *addr;
 		int		attlen = kds->colmeta[j].attlen;
 
+		if (kds->colmeta[j].attpacked)
+		{
+			cl_long		value;
+
+			if (!kern_get_packed_column(kds, j, row_index, &value))
+				slot->tts_isnull[j] = true;
+			else
+			{
+				slot->tts_isnull[j] = false;
+				if (attlen == sizeof(cl_short))
+					slot->tts_values[j] = Int16GetDatum((cl_short)value);
+				else if (attlen == sizeof(cl_int))
+					slot->tts_values[j] = Int32GetDatum((cl_int)value);
+				else
+					slot->tts_values[j] = Int64GetDatum(value);
+			}
+			continue;
+		}
+		addr = kern_get_datum_column(kds, j, row_index);
 		if (!addr)
 			slot->tts_isnull[j] = true;
 		else
@@ -212,6 +259,10 @@ PDS_fetch_tuple(TupleTableSlot *slot,
 				pgstrom_data_store *pds,
 				GpuTaskState *gts)
 {
+	/* slot shall be deformed onto its own arrays, unless KDS_FORMAT_SLOT */
+	if (gts->curr_ref_slot == slot && pds->kds.format != KDS_FORMAT_SLOT)
+		PDS_restore_slot_reference(gts);
+
 	switch (pds->kds.format)
 	{
 		case KDS_FORMAT_ROW:
@@ -256,6 +307,11 @@ __PDS_clone(pgstrom_data_store *pds_old,
 	pg_atomic_init_u32(&pds_new->refcnt, 1);
 	pds_new->nblocks_uncached = 0;
 	pds_new->filedesc = -1;
+	pds_new->nblocks_zcopy = 0;
+	pds_new->zcopy_blocks = NULL;
+	pds_new->mmap_base = NULL;
+	pds_new->mmap_length = 0;
+	pds_new->kds_dev = NULL;
 	memcpy(&pds_new->kds,
 		   &pds_old->kds,
 		   KERN_DATA_STORE_HEAD_LENGTH(&pds_old->kds));
@@ -295,7 +351,29 @@ PDS_release(pgstrom_data_store *pds)
 	Assert(refcnt >= 0);
 	if (refcnt == 0)
 	{
-		if (pds->kds.format != KDS_FORMAT_BLOCK)
+		/* ccache file to be loaded by NVMe-Strom */
+		if (pds->kds.format == KDS_FORMAT_COLUMN && pds->filedesc >= 0)
+			close(pds->filedesc);
+
+		if (pds->mmap_base != NULL)
+		{
+			/* PDS header is also a part of the memory-mapped ccache file */
+			void	   *mmap_base = pds->mmap_base;
+			size_t		mmap_length = pds->mmap_length;
+
+#if CUDA_VERSION >= 11010
+			rc = cuCtxPushCurrent(gcontext->cuda_context);
+			if (rc == CUDA_SUCCESS)
+			{
+				/* it may not be registered, so ignore the error */
+				(void) cuMemHostUnregister(&pds->kds);
+				cuCtxPopCurrent(NULL);
+			}
+#endif
+			if (munmap(mmap_base, mmap_length) != 0)
+				werror("failed on munmap: %m");
+		}
+		else if (pds->kds.format != KDS_FORMAT_BLOCK)
 		{
 			rc = gpuMemFree(gcontext, (CUdeviceptr) pds);
 			if (rc != CUDA_SUCCESS)
@@ -373,6 +451,7 @@ init_kernel_data_store(kern_data_store *kds,
 		kds->colmeta[i].atttypmod = (cl_int)attr->atttypmod;
 		kds->colmeta[i].va_offset = 0;
 		kds->colmeta[i].extra_sz = 0;
+		kds->colmeta[i].attpacked = false;
 		if (attcacheoff >= 0)
 			attcacheoff += attr->attlen;
 		/*
@@ -402,6 +481,7 @@ init_kernel_data_store(kern_data_store *kds,
 			kds->colmeta[i].atttypmod = (cl_int)attr->atttypmod;
 			kds->colmeta[i].va_offset = 0;
 			kds->colmeta[i].extra_sz = 0;
+			kds->colmeta[i].attpacked = false;
 		}
 	}
 }
@@ -435,6 +515,11 @@ __PDS_create_row(GpuContext *gcontext,
 						   KDS_FORMAT_ROW, INT_MAX);
 	pds->nblocks_uncached = 0;
 	pds->filedesc = -1;
+	pds->nblocks_zcopy = 0;
+	pds->zcopy_blocks = NULL;
+	pds->mmap_base = NULL;
+	pds->mmap_length = 0;
+	pds->kds_dev = NULL;
 
 	return pds;
 }
@@ -471,6 +556,11 @@ __PDS_create_hash(GpuContext *gcontext,
 						   KDS_FORMAT_HASH, INT_MAX);
 	pds->nblocks_uncached = 0;
 	pds->filedesc = -1;
+	pds->nblocks_zcopy = 0;
+	pds->zcopy_blocks = NULL;
+	pds->mmap_base = NULL;
+	pds->mmap_length = 0;
+	pds->kds_dev = NULL;
 
 	return pds;
 }
@@ -512,6 +602,11 @@ __PDS_create_slot(GpuContext *gcontext,
 						   KDS_FORMAT_SLOT, nrooms);
 	pds->nblocks_uncached = 0;
 	pds->filedesc = -1;
+	pds->nblocks_zcopy = 0;
+	pds->zcopy_blocks = NULL;
+	pds->mmap_base = NULL;
+	pds->mmap_length = 0;
+	pds->kds_dev = NULL;
 
 	return pds;
 }
@@ -551,6 +646,11 @@ __PDS_create_block(GpuContext *gcontext,
     pds->kds.nrows_per_block = nvme_sstate->nrows_per_block;
     pds->nblocks_uncached = 0;
 	pds->filedesc = -1;
+	pds->nblocks_zcopy = 0;
+	pds->zcopy_blocks = NULL;
+	pds->mmap_base = NULL;
+	pds->mmap_length = 0;
+	pds->kds_dev = NULL;
 
 	return pds;
 }
@@ -750,6 +850,29 @@ PDS_init_heapscan_state(GpuTaskState *gts,
 	nvme_sstate->nblocks_per_chunk = nblocks_per_chunk;
 	nvme_sstate->curr_segno = InvalidBlockNumber;
 	nvme_sstate->curr_vmbuffer = InvalidBuffer;
+	/*
+	 * GpuScan can check visibility of the tuples on GPU, so NVMe-Strom is
+	 * also applied on the blocks not all-visible. Rows in-doubt are marked
+	 * on the recheck bitmap, thus, CPU fallback has to be enabled.
+	 * Serializable transaction needs predicate locks for each tuple.
+	 */
+	nvme_sstate->gpu_mvcc = (gts->task_kind == GpuTaskKind_GpuScan &&
+							 pgstrom_gpuscan_mvcc_check &&
+							 pgstrom_cpu_fallback_enabled &&
+							 IsMVCCSnapshot(estate->es_snapshot) &&
+							 !estate->es_snapshot->takenDuringRecovery &&
+							 !IsolationIsSerializable());
+	/*
+	 * GpuScan with device projection can read all-visible blocks on the
+	 * shared buffer directly, because CPU does not reference the source
+	 * blocks unless fallback or recheck.
+	 */
+	nvme_sstate->zero_copy = (gts->task_kind == GpuTaskKind_GpuScan &&
+							  pgstrom_gpuscan_zero_copy &&
+							  pgstrom_cpu_fallback_enabled &&
+							  ((CustomScan *)gts->css.ss.ps.plan)
+							  ->custom_scan_tlist != NIL &&
+							  gpuMemRegisterSharedBuffers(gcontext));
 	nvme_sstate->nr_segs = nr_segs;
 	nvme_sstate_open_files(gcontext, nvme_sstate, relation);
 
@@ -787,6 +910,44 @@ PDS_end_heapscan_state(GpuTaskState *gts)
 	}
 }
 
+/*
+ * PDS_invalidate_invisible_tuples
+ *
+ * It invalidates line items of the invisible tuples on the copy of the
+ * block (@dpage), under the shared lock of the source @buffer.
+ */
+static void
+PDS_invalidate_invisible_tuples(Relation relation, Snapshot snapshot,
+								Buffer buffer, BlockNumber blknum,
+								Page dpage)
+{
+	int				lines = PageGetMaxOffsetNumber(dpage);
+	OffsetNumber	lineoff;
+	ItemId			lpp;
+
+	for (lineoff = FirstOffsetNumber, lpp = PageGetItemId(dpage, lineoff);
+		 lineoff <= lines;
+		 lineoff++, lpp++)
+	{
+		HeapTupleData	tup;
+		bool			valid;
+
+		if (!ItemIdIsNormal(lpp))
+			continue;
+
+		tup.t_tableOid = RelationGetRelid(relation);
+		tup.t_data = (HeapTupleHeader) PageGetItem((Page) dpage, lpp);
+		tup.t_len = ItemIdGetLength(lpp);
+		ItemPointerSet(&tup.t_self, blknum, lineoff);
+
+		valid = HeapTupleSatisfiesVisibility(&tup, snapshot, buffer);
+		CheckForSerializableConflictOut(valid, relation, &tup,
+										buffer, snapshot);
+		if (!valid)
+			ItemIdSetUnused(lpp);
+	}
+}
+
 /*
  * PDS_exec_heapscan_block - PDS scan for KDS_FORMAT_BLOCK format
  */
@@ -816,12 +977,14 @@ PDS_exec_heapscan_block(pgstrom_data_store *pds,
 
 	/*
 	 * NVMe-Strom can be applied only when filesystem supports the feature,
-	 * and the current source block is all-visible.
+	 * and the current source block is all-visible, or GPU checks visibility
+	 * of the tuples by itself.
 	 * Elsewhere, we will go fallback with synchronized buffer scan.
 	 */
 	if (RelationCanUseNvmeStrom(relation) &&
-		VM_ALL_VISIBLE(relation, blknum,
-					   &nvme_sstate->curr_vmbuffer))
+		(nvme_sstate->gpu_mvcc ||
+		 VM_ALL_VISIBLE(relation, blknum,
+						&nvme_sstate->curr_vmbuffer)))
 	{
 		BufferTag	newTag;
 		uint32		newHash;
@@ -882,8 +1045,33 @@ PDS_exec_heapscan_block(pgstrom_data_store *pds,
 #endif
 	/* we will check tuple's visibility under the shared lock */
 	LockBuffer(buffer, BUFFER_LOCK_SHARE);
-	nr_loaded = pds->kds.nitems - pds->nblocks_uncached;
 	spage = (Page) BufferGetPage(buffer);
+
+	/*
+	 * All-visible blocks on the shared buffer are read by GPU kernel
+	 * directly, if zero-copy mode. The buffer is kept pinned, and its
+	 * page LSN is checked again when the task is back to the backend.
+	 * Only WAL-logged relation updates the LSN on modification.
+	 */
+	if (nvme_sstate->zero_copy &&
+		PageIsAllVisible(spage) &&
+		!snapshot->takenDuringRecovery &&
+		RelationNeedsWAL(relation))
+	{
+		PDSZeroCopyBlock *zcopy = &pds->zcopy_blocks[pds->nblocks_zcopy++];
+
+		Assert(pds->zcopy_blocks != NULL);
+		zcopy->buffer = buffer;
+		zcopy->blknum = blknum;
+		zcopy->lsn = PageGetLSN(spage);
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		pds->kds.nitems++;
+
+		return true;
+	}
+	nr_loaded = (pds->kds.nitems -
+				 pds->nblocks_uncached -
+				 pds->nblocks_zcopy);
 	dpage = (Page) KERN_DATA_STORE_BLOCK_PGPAGE(&pds->kds, nr_loaded);
 	memcpy(dpage, spage, BLCKSZ);
 	block_nums[nr_loaded] = blknum;
@@ -894,33 +1082,8 @@ PDS_exec_heapscan_block(pgstrom_data_store *pds,
 	 */
 	all_visible = PageIsAllVisible(dpage) && !snapshot->takenDuringRecovery;
 	if (!all_visible)
-	{
-		int				lines = PageGetMaxOffsetNumber(dpage);
-		OffsetNumber	lineoff;
-		ItemId			lpp;
-
-		for (lineoff = FirstOffsetNumber, lpp = PageGetItemId(dpage, lineoff);
-			 lineoff <= lines;
-			 lineoff++, lpp++)
-		{
-			HeapTupleData	tup;
-			bool			valid;
-
-			if (!ItemIdIsNormal(lpp))
-				continue;
-
-			tup.t_tableOid = RelationGetRelid(relation);
-			tup.t_data = (HeapTupleHeader) PageGetItem((Page) dpage, lpp);
-			tup.t_len = ItemIdGetLength(lpp);
-			ItemPointerSet(&tup.t_self, blknum, lineoff);
-
-			valid = HeapTupleSatisfiesVisibility(&tup, snapshot, buffer);
-			CheckForSerializableConflictOut(valid, relation, &tup,
-											buffer, snapshot);
-			if (!valid)
-				ItemIdSetUnused(lpp);
-		}
-	}
+		PDS_invalidate_invisible_tuples(relation, snapshot,
+										buffer, blknum, dpage);
 	UnlockReleaseBuffer(buffer);
 	/* dpage became all-visible also */
 	PageSetAllVisible(dpage);
@@ -1040,6 +1203,200 @@ PDS_exec_heapscan_row(pgstrom_data_store *pds,
 	return true;
 }
 
+/*
+ * PDS_recheck_visibility
+ *
+ * It checks visibility of the tuple on the block loaded by NVMe-Strom but
+ * not all-visible, using the current version of the block on the shared
+ * buffer, because commit log lookup may set hint bits. Contents of the
+ * visible tuple are identical to the one on the loaded block, and the line
+ * item of the invisible tuple can be reused only by the tuple which is
+ * also invisible to the snapshot.
+ */
+bool
+PDS_recheck_visibility(GpuTaskState *gts, HeapTuple tuple)
+{
+	Relation		relation = gts->css.ss.ss_currentRelation;
+	Snapshot		snapshot = gts->css.ss.ps.state->es_snapshot;
+	BlockNumber		blknum = ItemPointerGetBlockNumber(&tuple->t_self);
+	OffsetNumber	lineoff = ItemPointerGetOffsetNumber(&tuple->t_self);
+	Buffer			buffer;
+	Page			page;
+	ItemId			lpp;
+	bool			valid = false;
+
+	buffer = ReadBuffer(relation, blknum);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buffer);
+	if (lineoff <= PageGetMaxOffsetNumber(page))
+	{
+		lpp = PageGetItemId(page, lineoff);
+		if (ItemIdIsNormal(lpp))
+		{
+			HeapTupleData	htup;
+
+			htup.t_tableOid = RelationGetRelid(relation);
+			htup.t_data = (HeapTupleHeader) PageGetItem(page, lpp);
+			htup.t_len = ItemIdGetLength(lpp);
+			htup.t_self = tuple->t_self;
+
+			valid = HeapTupleSatisfiesVisibility(&htup, snapshot, buffer);
+		}
+	}
+	UnlockReleaseBuffer(buffer);
+
+	return valid;
+}
+
+/*
+ * PDS_check_zero_copy
+ *
+ * It checks whether the blocks read by GPU kernel from the shared buffer
+ * directly were not modified during the task execution. If any, GPU may
+ * see the block under modification, so caller has to discard the result.
+ */
+bool
+PDS_check_zero_copy(pgstrom_data_store *pds)
+{
+	cl_uint		i;
+	bool		unchanged = true;
+
+	for (i=0; i < pds->nblocks_zcopy && unchanged; i++)
+	{
+		PDSZeroCopyBlock *zcopy = &pds->zcopy_blocks[i];
+		Page		spage;
+
+		LockBuffer(zcopy->buffer, BUFFER_LOCK_SHARE);
+		spage = BufferGetPage(zcopy->buffer);
+		if (PageGetLSN(spage) != zcopy->lsn || !PageIsAllVisible(spage))
+			unchanged = false;
+		LockBuffer(zcopy->buffer, BUFFER_LOCK_UNLOCK);
+	}
+	return unchanged;
+}
+
+/*
+ * PDS_materialize_zero_copy
+ *
+ * It copies the blocks read by GPU kernel from the shared buffer to the
+ * PDS, for CPU fallback or recheck. Visible tuples are never modified
+ * while the buffer is pinned, so the current version of the block is
+ * consistent to the one GPU has seen, once invisible tuples are removed.
+ */
+void
+PDS_materialize_zero_copy(GpuTaskState *gts, pgstrom_data_store *pds)
+{
+	Relation	relation = gts->css.ss.ss_currentRelation;
+	Snapshot	snapshot = gts->css.ss.ps.state->es_snapshot;
+	BlockNumber *block_nums;
+	cl_uint		nr_loaded;
+	cl_uint		i;
+
+	Assert(pds->kds.format == KDS_FORMAT_BLOCK);
+	block_nums = (BlockNumber *)KERN_DATA_STORE_BODY(&pds->kds);
+	nr_loaded = (pds->kds.nitems -
+				 pds->nblocks_uncached -
+				 pds->nblocks_zcopy);
+	for (i=0; i < pds->nblocks_zcopy; i++)
+	{
+		PDSZeroCopyBlock *zcopy = &pds->zcopy_blocks[i];
+		Page		dpage;
+
+		Assert(block_nums[nr_loaded + i] == zcopy->blknum);
+		dpage = (Page) KERN_DATA_STORE_BLOCK_PGPAGE(&pds->kds, nr_loaded + i);
+		LockBuffer(zcopy->buffer, BUFFER_LOCK_SHARE);
+		memcpy(dpage, BufferGetPage(zcopy->buffer), BLCKSZ);
+		if (!PageIsAllVisible(dpage))
+			PDS_invalidate_invisible_tuples(relation, snapshot,
+											zcopy->buffer,
+											zcopy->blknum, dpage);
+		LockBuffer(zcopy->buffer, BUFFER_LOCK_UNLOCK);
+		PageSetAllVisible(dpage);
+	}
+}
+
+/*
+ * PDS_unpin_zero_copy
+ *
+ * It releases the buffers pinned for zero-copy. Once unpinned, the host
+ * portion of the blocks is valid only if materialized.
+ */
+void
+PDS_unpin_zero_copy(pgstrom_data_store *pds)
+{
+	cl_uint		i;
+
+	if (!pds->zcopy_blocks)
+		return;
+	for (i=0; i < pds->nblocks_zcopy; i++)
+		ReleaseBuffer(pds->zcopy_blocks[i].buffer);
+	pfree(pds->zcopy_blocks);
+	pds->zcopy_blocks = NULL;
+}
+
+/*
+ * PDS_prefetch_heapscan
+ *
+ * It issues asynchronous read-ahead of the blocks up to a chunk ahead of
+ * the current block, if outer scan reads the blocks via shared buffer.
+ * Storage can load the blocks of the next chunk during the GPU kernel
+ * execution of the previous chunks, instead of synchronous read of
+ * ReadBufferExtended() for each blocks.
+ */
+static void
+PDS_prefetch_heapscan(GpuTaskState *gts, pgstrom_data_store *pds,
+					  Relation relation, HeapScanDesc hscan)
+{
+#ifdef USE_PREFETCH
+	BlockNumber		blknum = hscan->rs_cblock;
+	BlockNumber		nblocks = hscan->rs_nblocks;
+	BlockNumber		distance;
+	BlockNumber		ahead;
+
+	if (!pgstrom_heapscan_prefetch || nblocks == 0)
+		return;
+	/* blocks to be loaded by NVMe-Strom need no page cache */
+	if (pds->kds.format == KDS_FORMAT_BLOCK)
+	{
+		if (RelationCanUseNvmeStrom(relation))
+			return;
+		distance = gts->nvme_sstate->nblocks_per_chunk;
+	}
+	else if (gts->chunk_size_curr > 0)
+		distance = gts->chunk_size_curr / BLCKSZ;
+	else
+		distance = pgstrom_chunk_size() / BLCKSZ;
+	/* no more blocks than the ones assigned to this scan */
+	if (hscan->rs_numblocks != InvalidBlockNumber)
+		distance = Min(distance, hscan->rs_numblocks);
+
+	/*
+	 * Restart the read-ahead from the current block, if scan position
+	 * was moved by rescan or block assignment of the parallel scan.
+	 */
+	if (gts->prefetch_blknum == InvalidBlockNumber)
+		ahead = 0;
+	else
+		ahead = (gts->prefetch_blknum + nblocks - blknum) % nblocks;
+	if (ahead > distance ||
+		gts->prefetch_blknum == InvalidBlockNumber)
+	{
+		gts->prefetch_blknum = blknum;
+		ahead = 0;
+	}
+
+	while (ahead < distance)
+	{
+		/* end of the scan? */
+		if (ahead > 0 && gts->prefetch_blknum == hscan->rs_startblock)
+			break;
+		PrefetchBuffer(relation, MAIN_FORKNUM, gts->prefetch_blknum);
+		gts->prefetch_blknum = (gts->prefetch_blknum + 1) % nblocks;
+		ahead++;
+	}
+#endif
+}
+
 /*
  * PDS_exec_heapscan - PDS scan entrypoint
  */
@@ -1052,11 +1409,19 @@ PDS_exec_heapscan(GpuTaskState *gts, pgstrom_data_store *pds)
 
 	CHECK_FOR_INTERRUPTS();
 
+	PDS_prefetch_heapscan(gts, pds, relation, hscan);
+
 	if (pds->kds.format == KDS_FORMAT_ROW)
 		retval = PDS_exec_heapscan_row(pds, relation, hscan);
 	else if (pds->kds.format == KDS_FORMAT_BLOCK)
 	{
 		Assert(gts->nvme_sstate);
+		/* buffers to be pinned for zero-copy, if any */
+		if (gts->nvme_sstate->zero_copy && !pds->zcopy_blocks)
+			pds->zcopy_blocks =
+				MemoryContextAlloc(gts->css.ss.ps.state->es_query_cxt,
+								   sizeof(PDSZeroCopyBlock) *
+								   pds->kds.nrooms);
 		retval = PDS_exec_heapscan_block(pds, relation, hscan,
 										 gts->nvme_sstate);
 	}
@@ -1163,6 +1528,50 @@ KDS_insert_hashitem(kern_data_store *kds,
 	return true;
 }
 
+/*
+ * PDS_fillup_ccache_chunks
+ *
+ * It fills up the chunks of ccache file at the tail of KDS_FORMAT_COLUMN,
+ * using synchronous read APIs.
+ */
+static void
+PDS_fillup_ccache_chunks(pgstrom_data_store *pds)
+{
+	cl_uint			nchunks = pds->nblocks_uncached;
+	BlockNumber	   *chunk_ids = PDS_CCACHE_CHUNK_IDS(pds);
+	char		   *dest_addr;
+	loff_t			curr_fpos;
+	size_t			curr_size;
+	ssize_t			nbytes;
+	cl_uint			i, j;
+
+	Assert(pds->filedesc >= 0);
+	dest_addr = (char *)&pds->kds + pds->kds.length - (size_t)BLCKSZ * nchunks;
+	for (i=0; i < nchunks; i = j)
+	{
+		/* merge the neighbor chunks */
+		for (j = i + 1; j < nchunks; j++)
+		{
+			if (chunk_ids[j] != chunk_ids[j-1] + 1)
+				break;
+		}
+		curr_fpos = (loff_t)chunk_ids[i] * BLCKSZ;
+		curr_size = (size_t)BLCKSZ * (j - i);
+		while (curr_size > 0)
+		{
+			nbytes = pread(pds->filedesc, dest_addr, curr_size, curr_fpos);
+			Assert(nbytes <= curr_size);
+			if (nbytes < 0 || (nbytes == 0 && errno != EINTR))
+				elog(ERROR, "failed on pread(2): %m");
+			dest_addr += nbytes;
+			curr_fpos += nbytes;
+			curr_size -= nbytes;
+		}
+	}
+	Assert(dest_addr == (char *)&pds->kds + pds->kds.length);
+	pds->nblocks_uncached = 0;
+}
+
 /*
  * PDS_fillup_blocks
  *
@@ -1179,6 +1588,12 @@ PDS_fillup_blocks(pgstrom_data_store *pds)
 	size_t			curr_size;
 	BlockNumber	   *block_nums;
 
+	if (pds->kds.format == KDS_FORMAT_COLUMN)
+	{
+		if (pds->nblocks_uncached > 0)
+			PDS_fillup_ccache_chunks(pds);
+		return;
+	}
 	if (pds->kds.format != KDS_FORMAT_BLOCK)
 		elog(ERROR, "Bug? only KDS_FORMAT_BLOCK can be filled up");
 
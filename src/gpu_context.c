@@ -31,6 +31,7 @@ typedef struct
 	pthread_mutex_t		mutex;
 	pthread_cond_t		cond;
 	pg_atomic_uint32	command;
+	GpuContextActivity	activity;
 } GpuContextIPCEntry;
 
 typedef struct
@@ -44,13 +45,22 @@ typedef struct
 /* variables */
 static shmem_startup_hook_type shmem_startup_next = NULL;
 static pg_atomic_uint32 *global_num_running_tasks;	/* shared */
+static pg_atomic_uint32 *global_sum_share_weight;	/* shared */
+static pg_atomic_uint32 *global_num_cuda_contexts;	/* shared */
 static GpuContextIPCHead *gcontext_ipc_head;	/* shared */
 int					global_max_async_tasks;		/* GUC */
 int					local_max_async_tasks;		/* GUC */
+static int			gpu_share_weight;			/* GUC */
 int					max_num_gpucontext;			/* GUC */
+static int			nvme_max_prefetch_tasks;	/* GUC */
+static bool			numa_node_binding;			/* GUC */
+static int			max_cuda_contexts_per_device;	/* GUC */
+static int			num_cuda_context_slots = 0;	/* held by this backend */
 static slock_t		activeGpuContextLock;
 static dlist_head	activeGpuContextList;
 
+Datum pgstrom_gpu_activity(PG_FUNCTION_ARGS);
+
 /*
  * Resource tracker of GpuContext
  *
@@ -525,6 +535,14 @@ ReleaseLocalResources(GpuContext *gcontext, bool normal_exit)
 			elog(WARNING, "Failed on cuCtxDestroy: %s", errorText(rc));
 		gcontext->cuda_context = NULL;
 	}
+	if (gcontext->cuda_context_slot)
+	{
+		pg_atomic_sub_fetch_u32(&global_num_cuda_contexts[gcontext->cuda_dindex],
+								1);
+		Assert(num_cuda_context_slots > 0);
+		num_cuda_context_slots--;
+		gcontext->cuda_context_slot = false;
+	}
 
 	/* OK, release other resources */
 	for (i=0; i < RESTRACK_HASHSIZE; i++)
@@ -657,6 +675,346 @@ GpuContextWorkerReportError(int elevel,
 		siglongjmp(*GpuWorkerExceptionStack, 1);
 }
 
+/*
+ * GpuContextRequestReclaimMemory
+ *
+ * It asks all the GpuContexts on the same device, including the caller
+ * itself, to release their idle device memory segments. Worker threads of
+ * the GpuContexts are woken up to run gpuMemReclaimSegment().
+ */
+void
+GpuContextRequestReclaimMemory(GpuContext *gcontext)
+{
+	dlist_iter	iter;
+
+	SpinLockAcquire(&gcontext_ipc_head->lock);
+	dlist_foreach(iter, &gcontext_ipc_head->active_list[gcontext->cuda_dindex])
+	{
+		GpuContextIPCEntry *ipc_entry =
+			dlist_container(GpuContextIPCEntry, chain, iter.cur);
+
+		pg_atomic_fetch_or_u32(&ipc_entry->command,
+							   GPUCTX_CMD__RECLAIM_MEMORY);
+		pthreadCondSignal(&ipc_entry->cond);
+	}
+	SpinLockRelease(&gcontext_ipc_head->lock);
+}
+
+/*
+ * GpuContextDispatchTask / GpuContextCompleteTask
+ *
+ * They track the number of in-flight GpuTasks of the GpuContext, and
+ * system-wide counters of the device; number of running tasks and sum of
+ * the share weight of the GpuContexts that have any in-flight tasks.
+ * The caller must hold gcontext->mutex.
+ */
+void
+GpuContextDispatchTask(GpuContext *gcontext)
+{
+	if (gcontext->num_inflight_tasks++ == 0)
+	{
+		Assert(gcontext->share_weight == 0);
+		gcontext->share_weight = gpu_share_weight;
+		pg_atomic_add_fetch_u32(gcontext->global_sum_share_weight,
+								gcontext->share_weight);
+	}
+	pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
+	pg_atomic_add_fetch_u32(&gcontext->activity->num_pending_tasks, 1);
+}
+
+void
+GpuContextCompleteTask(GpuContext *gcontext)
+{
+	Assert(gcontext->num_inflight_tasks > 0);
+	pg_atomic_sub_fetch_u32(gcontext->global_num_running_tasks, 1);
+	if (--gcontext->num_inflight_tasks == 0)
+	{
+		pg_atomic_sub_fetch_u32(gcontext->global_sum_share_weight,
+								gcontext->share_weight);
+		gcontext->share_weight = 0;
+	}
+}
+
+/*
+ * GpuContextCanDispatchTask
+ *
+ * It checks whether the GpuContext can dispatch one more GpuTask under
+ * pg_strom.global_max_async_tasks. Once the device gets busy (more than
+ * half of the soft limit), a GpuContext can dispatch tasks only within
+ * its fair share, in proportion to pg_strom.gpu_share_weight; so a huge
+ * batch scan does not starve small interactive queries.
+ * The caller must hold gcontext->mutex.
+ */
+bool
+GpuContextCanDispatchTask(GpuContext *gcontext)
+{
+	uint32		num_running;
+	uint64		sum_weight;
+	uint64		weight;
+	uint64		fair_share;
+
+	num_running = pg_atomic_read_u32(gcontext->global_num_running_tasks);
+	if (num_running >= global_max_async_tasks)
+		return false;
+	if (num_running < global_max_async_tasks / 2)
+		return true;
+
+	sum_weight = pg_atomic_read_u32(gcontext->global_sum_share_weight);
+	weight = gcontext->share_weight;
+	if (weight == 0)
+	{
+		/* not active yet, so not counted in the sum */
+		weight = gpu_share_weight;
+		sum_weight += weight;
+	}
+	fair_share = Max((uint64)global_max_async_tasks * weight /
+					 Max(sum_weight, 1), 1);
+
+	return (gcontext->num_inflight_tasks < fair_share);
+}
+
+/*
+ * GpuContextUpdateNvmeStat
+ *
+ * It updates moving average of the SSD-to-GPU Direct DMA time and GPU
+ * kernel execution time, in microseconds. Negative value is ignored.
+ */
+void
+GpuContextUpdateNvmeStat(GpuContext *gcontext,
+						 double dma_usec, double kern_usec)
+{
+	pthreadMutexLock(gcontext->mutex);
+	if (dma_usec >= 0.0)
+	{
+		if (gcontext->nvme_dma_usec == 0.0)
+			gcontext->nvme_dma_usec = dma_usec;
+		else
+			gcontext->nvme_dma_usec = (0.8 * gcontext->nvme_dma_usec +
+									   0.2 * dma_usec);
+	}
+	if (kern_usec >= 0.0)
+	{
+		if (gcontext->nvme_kern_usec == 0.0)
+			gcontext->nvme_kern_usec = kern_usec;
+		else
+			gcontext->nvme_kern_usec = (0.8 * gcontext->nvme_kern_usec +
+										0.2 * kern_usec);
+	}
+	pthreadMutexUnlock(gcontext->mutex);
+}
+
+/*
+ * GpuContextNvmePrefetchDepth
+ *
+ * Number of tasks whose DMA shall be kicked in advance per worker. If DMA
+ * takes N times longer than GPU kernel, N tasks have to be in-flight to
+ * keep GPU kernel busy.
+ */
+static int
+GpuContextNvmePrefetchDepth(GpuContext *gcontext)
+{
+	double		dma_usec;
+	double		kern_usec;
+	int			depth;
+
+	if (nvme_max_prefetch_tasks == 0)
+		return 0;
+	pthreadMutexLock(gcontext->mutex);
+	dma_usec = gcontext->nvme_dma_usec;
+	kern_usec = gcontext->nvme_kern_usec;
+	pthreadMutexUnlock(gcontext->mutex);
+
+	if (dma_usec <= 0.0 || kern_usec <= 0.0)
+		return 1;
+	depth = (int) ceil(dma_usec / kern_usec);
+
+	return Max(1, Min(depth, nvme_max_prefetch_tasks));
+}
+
+/*
+ * GpuContextWorkerPrefetchTasks
+ *
+ * It moves the pending tasks of the same GTS to the local list of the
+ * worker, and kicks their DMA in advance, so DMA of the next chunks is
+ * overlapped with the kernel execution of the current chunk.
+ */
+static void
+GpuContextWorkerPrefetchTasks(GpuContext *gcontext,
+							  GpuTaskState *gts,
+							  dlist_head *prefetch_tasks,
+							  int *p_num_prefetch)
+{
+	GpuTask	   *gtask;
+	int			depth;
+
+	if (!gts->cb_prefetch_task)
+		return;
+	depth = GpuContextNvmePrefetchDepth(gcontext);
+	while (*p_num_prefetch < depth)
+	{
+		pthreadMutexLock(gcontext->mutex);
+		/*
+		 * Tasks already completed but not consumed by the backend yet are
+		 * also counted, because prefetch makes no sense if the backend is
+		 * the bottleneck; it just holds more i/o mapped memory.
+		 */
+		if (dlist_is_empty(&gcontext->pending_tasks) ||
+			*p_num_prefetch + gts->num_ready_tasks >= depth)
+		{
+			pthreadMutexUnlock(gcontext->mutex);
+			break;
+		}
+		gtask = dlist_container(GpuTask, chain,
+								dlist_head_node(&gcontext->pending_tasks));
+		if (gtask->gts != gts)
+		{
+			pthreadMutexUnlock(gcontext->mutex);
+			break;
+		}
+		dlist_delete(&gtask->chain);
+		pthreadMutexUnlock(gcontext->mutex);
+
+		/*
+		 * Even if DMA cannot be kicked (e.g, no i/o mapped memory right
+		 * now), the task is kept in the local list, then processed by
+		 * this worker as usual.
+		 */
+		gts->cb_prefetch_task(gtask);
+		dlist_push_tail(prefetch_tasks, &gtask->chain);
+		(*p_num_prefetch)++;
+	}
+}
+
+/*
+ * GpuContextWorkerReleasePrefetchTasks
+ *
+ * It releases the tasks in the local list of the worker on termination,
+ * like rescan or release of the GTS. cb_release_task has to wait for the
+ * DMA already kicked, prior to release of the destination buffer.
+ */
+static void
+GpuContextWorkerReleasePrefetchTasks(GpuContext *gcontext,
+									 dlist_head *prefetch_tasks,
+									 int *p_num_prefetch)
+{
+	GpuContextActivity *activity = gcontext->activity;
+	GpuTask	   *gtask;
+	GpuTaskState *gts;
+
+	while (!dlist_is_empty(prefetch_tasks))
+	{
+		gtask = dlist_container(GpuTask, chain,
+								dlist_pop_head_node(prefetch_tasks));
+		(*p_num_prefetch)--;
+		gts = gtask->gts;
+
+		pg_atomic_sub_fetch_u32(&activity->num_pending_tasks, 1);
+		pthreadMutexLock(gcontext->mutex);
+		Assert(gts->num_running_tasks > 0);
+		gts->num_running_tasks--;
+		GpuContextCompleteTask(gcontext);
+		pthreadMutexUnlock(gcontext->mutex);
+
+		gts->cb_release_task(gtask);
+	}
+	Assert(*p_num_prefetch == 0);
+}
+
+/*
+ * GpuContextWorkerProcessTask
+ */
+static void
+GpuContextWorkerProcessTask(GpuContext *gcontext, GpuTask *gtask)
+{
+	GpuContextActivity *activity = gcontext->activity;
+	GpuTaskState *gts = gtask->gts;
+	CUmodule	cuda_module;
+	TimestampTz	tv_begin;
+	uint64		range_id;
+	cl_int		retval;
+
+	pgstromStatQueueWait(gtask);
+	pg_atomic_sub_fetch_u32(&activity->num_pending_tasks, 1);
+	pg_atomic_add_fetch_u32(&activity->num_running_tasks, 1);
+	tv_begin = GetCurrentTimestamp();
+	range_id = pgstromNvtxRangeStart(gts, "JIT build");
+	cuda_module = GpuContextLookupModule(gcontext,
+										 gtask->program_id);
+	pgstromNvtxRangeEnd(range_id);
+	pgstromStatJitBuild(gts, tv_begin);
+	tv_begin = GetCurrentTimestamp();
+	do {
+		/*
+		 * pgstromProcessGpuTask() returns the following status:
+		 *
+		 *  0 : GpuTask gets completed successfully, then task
+		 *      object shall be backed to the backend.
+		 * >0 : Unable to launch GpuTask due to lack of GPU's
+		 *      resource. It shall be retried after a short wait.
+		 * <0 : GpuTask gets completed successfully, and the
+		 *      handler wants to release GpuTask immediately.
+		 */
+		range_id = pgstromNvtxRangeStart(gts, "process task");
+		retval = gts->cb_process_task(gtask, cuda_module);
+		pgstromNvtxRangeEnd(range_id);
+		if (retval > 0)
+		{
+			/* wait for 40ms */
+			pg_usleep(40000L);
+		}
+		else if (gtask->kerror.errcode != StromError_Success)
+		{
+			/* GPU kernel completed with error status */
+			werror("GPU kernel error - %s",
+				   errorTextKernel(&gtask->kerror));
+		}
+		else if (retval == 0)
+		{
+			/* Back GpuTask to GTS */
+			pthreadMutexLock(gcontext->mutex);
+			dlist_push_tail(&gts->ready_tasks,
+							&gtask->chain);
+			gts->num_running_tasks--;
+			gts->num_ready_tasks++;
+			GpuContextCompleteTask(gcontext);
+			pthreadMutexUnlock(gcontext->mutex);
+
+			SetLatch(MyLatch);
+		}
+		else
+		{
+			/*
+			 * Release GpuTask immediately, expect for the last
+			 * GpuTask when retval==-2.
+			 */
+			pthreadMutexLock(gcontext->mutex);
+			GpuContextCompleteTask(gcontext);
+			if (--gts->num_running_tasks == 0 &&
+				retval == -2 &&
+				gts->scan_done)
+			{
+				wnotice("last one task");
+				dlist_push_tail(&gts->ready_tasks,
+								&gtask->chain);
+				gts->num_ready_tasks++;
+				pthreadMutexUnlock(gcontext->mutex);
+			}
+			else
+			{
+				pthreadMutexUnlock(gcontext->mutex);
+
+				gts->cb_release_task(gtask);
+			}
+			SetLatch(MyLatch);
+		}
+	} while (retval > 0);
+
+	pg_atomic_add_fetch_u64(&activity->gpu_task_usec,
+							GetCurrentTimestamp() - tv_begin);
+	pg_atomic_add_fetch_u64(&activity->num_completed_tasks, 1);
+	pg_atomic_sub_fetch_u32(&activity->num_running_tasks, 1);
+}
+
 /*
  * GpuContextWorkerMain
  */
@@ -665,6 +1023,8 @@ GpuContextWorkerMain(void *arg)
 {
 	GpuContext	   *gcontext = arg;
 	dlist_node	   *dnode;
+	dlist_head		prefetch_tasks;	/* tasks whose DMA is kicked */
+	int				num_prefetch = 0;
 	GpuTask		   *gtask;
 	CUresult		rc;
 	uint32			command;
@@ -673,6 +1033,7 @@ GpuContextWorkerMain(void *arg)
 	/* setup worker index */
 	GpuWorkerIndex = pg_atomic_fetch_add_u32(&gcontext->worker_index, 1);
 	Assert(GpuWorkerIndex < gcontext->num_workers);
+	dlist_init(&prefetch_tasks);
 
 	rc = cuCtxSetCurrent(gcontext->cuda_context);
 	if (rc != CUDA_SUCCESS)
@@ -688,9 +1049,19 @@ GpuContextWorkerMain(void *arg)
 	{
 		while (pg_atomic_read_u32(&gcontext->terminate_workers) == 0)
 		{
-			GpuTaskState *gts;
-			CUmodule	cuda_module;
-			cl_int		retval;
+			/* tasks already prefetched shall be processed first */
+			if (num_prefetch > 0)
+			{
+				dnode = dlist_pop_head_node(&prefetch_tasks);
+				gtask = dlist_container(GpuTask, chain, dnode);
+				num_prefetch--;
+
+				GpuContextWorkerPrefetchTasks(gcontext, gtask->gts,
+											  &prefetch_tasks,
+											  &num_prefetch);
+				GpuContextWorkerProcessTask(gcontext, gtask);
+				continue;
+			}
 
 			/* try asyncronous program build if any */
 			if (pgstrom_try_build_cuda_program())
@@ -724,72 +1095,16 @@ GpuContextWorkerMain(void *arg)
 				gtask = dlist_container(GpuTask, chain, dnode);
 				pthreadMutexUnlock(gcontext->mutex);
 
-				gts = gtask->gts;
-				cuda_module = GpuContextLookupModule(gcontext,
-													 gtask->program_id);
-				do {
-					/*
-					 * pgstromProcessGpuTask() returns the following status:
-					 *
-					 *  0 : GpuTask gets completed successfully, then task
-					 *      object shall be backed to the backend.
-					 * >0 : Unable to launch GpuTask due to lack of GPU's
-					 *      resource. It shall be retried after a short wait.
-					 * <0 : GpuTask gets completed successfully, and the
-					 *      handler wants to release GpuTask immediately.
-					 */
-					retval = gts->cb_process_task(gtask, cuda_module);
-					if (retval > 0)
-					{
-						/* wait for 40ms */
-						pg_usleep(40000L);
-					}
-					else if (gtask->kerror.errcode != StromError_Success)
-					{
-						/* GPU kernel completed with error status */
-						werror("GPU kernel error - %s",
-							   errorTextKernel(&gtask->kerror));
-					}
-					else if (retval == 0)
-					{
-						/* Back GpuTask to GTS */
-						pthreadMutexLock(gcontext->mutex);
-						dlist_push_tail(&gts->ready_tasks,
-										&gtask->chain);
-						gts->num_running_tasks--;
-						gts->num_ready_tasks++;
-						pthreadMutexUnlock(gcontext->mutex);
-
-						SetLatch(MyLatch);
-					}
-					else
-					{
-						/*
-						 * Release GpuTask immediately, expect for the last
-						 * GpuTask when retval==-2.
-						 */
-						pthreadMutexLock(gcontext->mutex);
-						if (--gts->num_running_tasks == 0 &&
-							retval == -2 &&
-							gts->scan_done)
-						{
-							wnotice("last one task");
-							dlist_push_tail(&gts->ready_tasks,
-											&gtask->chain);
-							gts->num_ready_tasks++;
-							pthreadMutexUnlock(gcontext->mutex);
-						}
-						else
-						{
-							pthreadMutexUnlock(gcontext->mutex);
-
-							gts->cb_release_task(gtask);
-						}
-						SetLatch(MyLatch);
-					}
-				} while (retval > 0);
+				GpuContextWorkerPrefetchTasks(gcontext, gtask->gts,
+											  &prefetch_tasks,
+											  &num_prefetch);
+				GpuContextWorkerProcessTask(gcontext, gtask);
 			}
 		}
+		/* prefetched tasks are never processed any more */
+		GpuContextWorkerReleasePrefetchTasks(gcontext,
+											 &prefetch_tasks,
+											 &num_prefetch);
 	}
 	STROM_CATCH();
 	{
@@ -821,6 +1136,88 @@ gpuInit(unsigned int flags)
 	return rc;
 }
 
+/*
+ * GpuContextInitActivity
+ */
+static void
+GpuContextInitActivity(GpuContextActivity *activity, int cuda_dindex)
+{
+	activity->backend_pid = MyProcPid;
+	activity->cuda_dindex = cuda_dindex;
+	activity->since = GetCurrentTimestamp();
+	pg_atomic_init_u32(&activity->num_pending_tasks, 0);
+	pg_atomic_init_u32(&activity->num_running_tasks, 0);
+	pg_atomic_init_u64(&activity->num_completed_tasks, 0);
+	pg_atomic_init_u64(&activity->dma_send_nbytes, 0);
+	pg_atomic_init_u64(&activity->dma_recv_nbytes, 0);
+	pg_atomic_init_u64(&activity->gpu_task_usec, 0);
+	pg_atomic_init_u64(&activity->gpumem_usage, 0);
+	pg_atomic_init_u64(&activity->nvme_nbytes, 0);
+	pg_atomic_init_u64(&activity->nvme_usec, 0);
+}
+
+/*
+ * GpuContextBindNumaNode - binds the parallel worker process to the CPUs
+ * on the NUMA node of the GPU device, to avoid memory access and DMA
+ * across the inter-socket link. It is applied only once per process,
+ * because a parallel worker executes a particular query only.
+ */
+static void
+GpuContextBindNumaNode(int cuda_dindex)
+{
+	static bool	numa_node_bound = false;
+	int			numa_node = devAttrs[cuda_dindex].DEV_NUMA_NODE;
+	char		namebuf[MAXPGPATH];
+	char		linebuf[2048];
+	char	   *tok, *pos;
+	FILE	   *filp;
+	cpu_set_t	cpuset;
+	int			ncpus = 0;
+
+	if (!numa_node_binding ||
+		!IsParallelWorker() ||
+		numa_node_bound ||
+		numa_node < 0)
+		return;
+	numa_node_bound = true;
+
+	/* cpulist is like "0-13,28-41" */
+	snprintf(namebuf, sizeof(namebuf),
+			 "/sys/devices/system/node/node%d/cpulist", numa_node);
+	filp = AllocateFile(namebuf, "r");
+	if (!filp)
+	{
+		elog(LOG, "failed to open \"%s\": %m", namebuf);
+		return;
+	}
+	if (!fgets(linebuf, sizeof(linebuf), filp))
+		linebuf[0] = '\0';
+	FreeFile(filp);
+
+	CPU_ZERO(&cpuset);
+	for (tok = strtok_r(linebuf, ",\n", &pos);
+		 tok != NULL;
+		 tok = strtok_r(NULL, ",\n", &pos))
+	{
+		int		lower, upper, i;
+
+		if (sscanf(tok, "%d-%d", &lower, &upper) != 2)
+			lower = upper = atoi(tok);
+		for (i = lower; i <= upper && i < CPU_SETSIZE; i++)
+		{
+			CPU_SET(i, &cpuset);
+			ncpus++;
+		}
+	}
+	if (ncpus == 0)
+		return;
+	if (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) != 0)
+		elog(LOG, "failed on sched_setaffinity: %m");
+	else
+		elog(DEBUG1, "parallel worker %d is bound to NUMA node %d (GPU%d)",
+			 ParallelWorkerNumber, numa_node, devAttrs[cuda_dindex].DEV_ID);
+}
+
 /*
  * GetGpuContext - acquire a free GpuContext
  */
@@ -875,6 +1272,7 @@ AllocGpuContext(int cuda_dindex, bool never_use_mps)
 					   ? ParallelWorkerNumber
 					   : MyProc->pgprocno) % numDevAttrs;
 	}
+	GpuContextBindNumaNode(cuda_dindex);
 
 	/* Pick up IPC stuff */
 	SpinLockAcquire(&gcontext_ipc_head->lock);
@@ -889,6 +1287,7 @@ AllocGpuContext(int cuda_dindex, bool never_use_mps)
 	pthreadMutexInit(&ipc_entry->mutex, 1);
 	pthreadCondInit(&ipc_entry->cond);
 	pg_atomic_init_u32(&ipc_entry->command, 0);
+	GpuContextInitActivity(&ipc_entry->activity, cuda_dindex);
 
 	/* setup fields */
 	pg_atomic_init_u32(&gcontext->refcnt, 1);
@@ -913,9 +1312,14 @@ AllocGpuContext(int cuda_dindex, bool never_use_mps)
 	gcontext->worker_is_running = false;
 	gcontext->global_num_running_tasks
 		= &global_num_running_tasks[cuda_dindex];
+	gcontext->global_sum_share_weight
+		= &global_sum_share_weight[cuda_dindex];
+	gcontext->num_inflight_tasks = 0;
+	gcontext->share_weight = 0;
 	gcontext->mutex		= &ipc_entry->mutex;
 	gcontext->cond		= &ipc_entry->cond;
 	gcontext->command	= &ipc_entry->command;
+	gcontext->activity	= &ipc_entry->activity;
 	pg_atomic_init_u32(&gcontext->terminate_workers, 0);
 	dlist_init(&gcontext->pending_tasks);
 	gcontext->num_workers = num_workers;
@@ -981,6 +1385,65 @@ create_cuda_context(GpuContext *gcontext,
 	*p_cuda_context	= cuda_context;
 }
 
+/*
+ * acquire_cuda_context_slot - waits for a free slot of CUDA context on the
+ * device, if pg_strom.max_cuda_contexts_per_device is configured. Every
+ * CUDA context consumes device memory and time for its setup, so a large
+ * number of concurrent sessions should share a limited number of slots.
+ * Contexts are always counted, even if unlimited, to apply a new limit
+ * on reload correctly.
+ * Backends which already hold a slot (e.g, nested query in SQL functions)
+ * and parallel workers never wait, because the slot they wait for may be
+ * held by themselves or by their leader process that waits for them.
+ */
+static void
+acquire_cuda_context_slot(GpuContext *gcontext)
+{
+	pg_atomic_uint32 *counter = &global_num_cuda_contexts[gcontext->cuda_dindex];
+	uint32		curval;
+	bool		waiting = false;
+
+	Assert(!gcontext->cuda_context_slot);
+	if (num_cuda_context_slots > 0 || IsParallelWorker())
+	{
+		pg_atomic_add_fetch_u32(counter, 1);
+		goto out;
+	}
+	for (;;)
+	{
+		curval = pg_atomic_read_u32(counter);
+		if (max_cuda_contexts_per_device <= 0 ||
+			curval < (uint32) max_cuda_contexts_per_device)
+		{
+			if (pg_atomic_compare_exchange_u32(counter, &curval, curval + 1))
+				break;
+			continue;
+		}
+
+		if (!waiting)
+		{
+			elog(DEBUG1, "waiting for a free CUDA context slot on GPU%d",
+				 devAttrs[gcontext->cuda_dindex].DEV_ID);
+			waiting = true;
+		}
+		/* statement_timeout or query cancel can break the wait */
+		CHECK_FOR_INTERRUPTS();
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET |
+						 WL_TIMEOUT |
+						 WL_POSTMASTER_DEATH,
+						 10L
+#if PG_VERSION_NUM >= 100000
+						 ,PG_WAIT_EXTENSION
+#endif
+			);
+		ResetLatch(MyLatch);
+	}
+out:
+	num_cuda_context_slots++;
+	gcontext->cuda_context_slot = true;
+}
+
 /*
  * ActivateGpuContext - kicks worker threads for workq
  */
@@ -989,10 +1452,14 @@ ActivateGpuContext(GpuContext *gcontext)
 {
 	/* Also create CUDA context on demand */
 	if (!gcontext->cuda_context)
+	{
+		if (!gcontext->cuda_context_slot)
+			acquire_cuda_context_slot(gcontext);
 		create_cuda_context(gcontext,
 							gcontext->cuda_dindex,
 							&gcontext->cuda_device,
 							&gcontext->cuda_context);
+	}
 
 	if (!gcontext->worker_is_running)
 	{
@@ -1069,6 +1536,9 @@ PutGpuContext(GpuContext *gcontext)
 		SpinLockRelease(&activeGpuContextLock);
 		/* wait for completion of worker threads */
 		SynchronizeGpuContext(gcontext);
+		/* tasks not completed (e.g, by errors) are no longer running */
+		while (gcontext->num_inflight_tasks > 0)
+			GpuContextCompleteTask(gcontext);
 		/* cleanup local resources */
 		ReleaseLocalResources(gcontext, true);
 	}
@@ -1260,6 +1730,118 @@ gpucontext_shmem_exit_cleanup(int code, Datum arg)
 	}
 }
 
+/*
+ * pgstrom_gpu_activity - SQL function to dump activity of GpuContexts
+ */
+Datum
+pgstrom_gpu_activity(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	Datum		values[12];
+	bool		isnull[12];
+	HeapTuple	tuple;
+	GpuContextActivity *activity;
+	List	   *activity_list;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+		GpuContextIPCEntry *ipc_entry;
+		GpuContextActivity *lcopy;
+		dlist_iter		iter;
+		int				i, nitems = 0;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(12, false);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  1, "device_nr",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  2, "pid",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  3, "since",
+						   TIMESTAMPTZOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  4, "running_tasks",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  5, "pending_tasks",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  6, "completed_tasks",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  7, "dma_send_bytes",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  8, "dma_recv_bytes",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  9, "gpu_task_time",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 10, "gpumem_usage",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 11, "nvme_bytes",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 12, "nvme_time",
+						   FLOAT8OID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+
+		/*
+		 * Counters are updated by atomic operations without locks, so we
+		 * take snapshot of the active entries under the spinlock, then
+		 * read the counters of the local copy. Number of the entries is
+		 * never larger than max_num_gpucontext, so the buffer is allocated
+		 * prior to the spinlock; no palloc under the spinlock.
+		 */
+		lcopy = palloc(sizeof(GpuContextActivity) * max_num_gpucontext);
+		SpinLockAcquire(&gcontext_ipc_head->lock);
+		for (i=0; i < numDevAttrs; i++)
+		{
+			dlist_foreach(iter, &gcontext_ipc_head->active_list[i])
+			{
+				ipc_entry = dlist_container(GpuContextIPCEntry,
+											chain, iter.cur);
+				Assert(nitems < max_num_gpucontext);
+				memcpy(&lcopy[nitems++], &ipc_entry->activity,
+					   sizeof(GpuContextActivity));
+			}
+		}
+		SpinLockRelease(&gcontext_ipc_head->lock);
+
+		activity_list = NIL;
+		for (i=0; i < nitems; i++)
+			activity_list = lappend(activity_list, &lcopy[i]);
+
+		fncxt->user_fctx = activity_list;
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+	activity_list = (List *)fncxt->user_fctx;
+
+	if (activity_list == NIL)
+		SRF_RETURN_DONE(fncxt);
+	activity = linitial(activity_list);
+	fncxt->user_fctx = list_delete_first(activity_list);
+
+	memset(isnull, 0, sizeof(isnull));
+	Assert(activity->cuda_dindex >= 0 &&
+		   activity->cuda_dindex < numDevAttrs);
+	values[0] = Int32GetDatum(devAttrs[activity->cuda_dindex].DEV_ID);
+	values[1] = Int32GetDatum(activity->backend_pid);
+	values[2] = TimestampTzGetDatum(activity->since);
+	values[3] = Int32GetDatum(pg_atomic_read_u32(&activity->num_running_tasks));
+	values[4] = Int32GetDatum(pg_atomic_read_u32(&activity->num_pending_tasks));
+	values[5] = Int64GetDatum(pg_atomic_read_u64(&activity->num_completed_tasks));
+	values[6] = Int64GetDatum(pg_atomic_read_u64(&activity->dma_send_nbytes));
+	values[7] = Int64GetDatum(pg_atomic_read_u64(&activity->dma_recv_nbytes));
+	values[8] = Float8GetDatum((double)
+			pg_atomic_read_u64(&activity->gpu_task_usec) / 1000.0);
+	values[9] = Int64GetDatum(pg_atomic_read_u64(&activity->gpumem_usage));
+	values[10] = Int64GetDatum(pg_atomic_read_u64(&activity->nvme_nbytes));
+	values[11] = Float8GetDatum((double)
+			pg_atomic_read_u64(&activity->nvme_usec) / 1000.0);
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_gpu_activity);
+
 /*
  * pgstrom_startup_gpu_context
  */
@@ -1281,6 +1863,24 @@ pgstrom_startup_gpu_context(void)
 	for (i=0; i < numDevAttrs; i++)
 		pg_atomic_init_u32(&global_num_running_tasks[i], 0);
 
+	global_sum_share_weight =
+		ShmemInitStruct("Global sum of GPU share weight",
+						sizeof(pg_atomic_uint32) * numDevAttrs,
+						&found);
+	if (found)
+		elog(ERROR, "Bug? Global sum of GPU share weight exists");
+	for (i=0; i < numDevAttrs; i++)
+		pg_atomic_init_u32(&global_sum_share_weight[i], 0);
+
+	global_num_cuda_contexts =
+		ShmemInitStruct("Global number of CUDA contexts",
+						sizeof(pg_atomic_uint32) * numDevAttrs,
+						&found);
+	if (found)
+		elog(ERROR, "Bug? Global number of CUDA contexts exists");
+	for (i=0; i < numDevAttrs; i++)
+		pg_atomic_init_u32(&global_num_cuda_contexts[i], 0);
+
 	gcontext_ipc_head =
 		ShmemInitStruct("IPC stuff for GpuContex",
 						MAXALIGN(offsetof(GpuContextIPCHead,
@@ -1335,6 +1935,46 @@ pgstrom_init_gpu_context(void)
 							PGC_SUSET,
 							GUC_NOT_IN_SAMPLE,
 							NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.gpu_share_weight",
+			"Weight of the fair share of GPU tasks when GPU is busy",
+							NULL,
+							&gpu_share_weight,
+							100,
+							1,
+							10000,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.nvme_max_prefetch_tasks",
+			"Max number of GpuTasks per worker whose SSD-to-GPU DMA is kicked in advance",
+							NULL,
+							&nvme_max_prefetch_tasks,
+							4,
+							0,
+							64,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("pg_strom.numa_node_binding",
+			"Turn on/off binding of parallel workers to the NUMA node of GPU",
+							 NULL,
+							 &numa_node_binding,
+							 false,
+							 PGC_SUSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pg_strom.max_cuda_contexts_per_device",
+			"Max number of concurrent CUDA contexts per device (0 = unlimited)",
+							NULL,
+							&max_cuda_contexts_per_device,
+							0,
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
 
 	max_nprocs = MaxConnections + max_worker_processes;
 	DefineCustomIntVariable("pg_strom.max_number_of_gpucontext",
@@ -1354,6 +1994,8 @@ pgstrom_init_gpu_context(void)
 
 	/* shared memory */
 	RequestAddinShmemSpace(MAXALIGN(sizeof(pg_atomic_uint32) * numDevAttrs) +
+						   MAXALIGN(sizeof(pg_atomic_uint32) * numDevAttrs) +
+						   MAXALIGN(sizeof(pg_atomic_uint32) * numDevAttrs) +
 						   MAXALIGN(offsetof(GpuContextIPCHead,
 											ipc_entries[max_num_gpucontext])) +
 						   MAXALIGN(sizeof(dlist_head) * numDevAttrs));
@@ -62,6 +62,427 @@ Datum pgstrom_gpu_num_cuda_cores(PG_FUNCTION_ARGS);
 Datum pgstrom_gpu_cc_major(PG_FUNCTION_ARGS);
 Datum pgstrom_gpu_cc_minor(PG_FUNCTION_ARGS);
 Datum pgstrom_gpu_pci_id(PG_FUNCTION_ARGS);
+Datum pgstrom_gpu_device_benchmark(PG_FUNCTION_ARGS);
+Datum pgstrom_gpu_cost_calibration_invalidator(PG_FUNCTION_ARGS);
+
+/*
+ * sysfs_lookup_numa_node - walks up the sysfs device path to the nearest
+ * entry that has numa_node attribute, usually the PCI device itself.
+ */
+static int
+sysfs_lookup_numa_node(const char *sysfs_path)
+{
+	char		namebuf[MAXPGPATH];
+	char	   *pos;
+	FILE	   *filp;
+	int			numa_node = -1;
+
+	strncpy(namebuf, sysfs_path, sizeof(namebuf) - 20);
+	namebuf[sizeof(namebuf) - 20] = '\0';
+	while ((pos = strrchr(namebuf, '/')) != NULL &&
+		   pos - namebuf > (int) strlen("/sys/devices"))
+	{
+		strcpy(pos, "/numa_node");
+		filp = AllocateFile(namebuf, "r");
+		if (filp)
+		{
+			if (fscanf(filp, "%d", &numa_node) != 1)
+				numa_node = -1;
+			FreeFile(filp);
+			break;
+		}
+		*pos = '\0';
+	}
+	return numa_node;
+}
+
+/*
+ * pgstrom_collect_gpu_topology - resolves the location of the GPU device
+ * on the PCIe bus and NUMA node, using sysfs.
+ */
+static void
+pgstrom_collect_gpu_topology(DevAttributes *dattrs)
+{
+	char		namebuf[MAXPGPATH];
+	char		pathbuf[PATH_MAX];
+
+	dattrs->DEV_NUMA_NODE = -1;
+	dattrs->DEV_PCIE_PATH[0] = '\0';
+
+	snprintf(namebuf, sizeof(namebuf),
+			 "/sys/bus/pci/devices/%04x:%02x:%02x.0",
+			 dattrs->PCI_DOMAIN_ID,
+			 dattrs->PCI_BUS_ID,
+			 dattrs->PCI_DEVICE_ID);
+	if (!realpath(namebuf, pathbuf))
+	{
+		elog(LOG, "PG-Strom: unable to resolve \"%s\" of GPU%d: %m",
+			 namebuf, dattrs->DEV_ID);
+		return;
+	}
+	if (strlen(pathbuf) >= sizeof(dattrs->DEV_PCIE_PATH))
+	{
+		elog(LOG, "PG-Strom: sysfs path of GPU%d is too long: %s",
+			 dattrs->DEV_ID, pathbuf);
+		return;
+	}
+	strcpy(dattrs->DEV_PCIE_PATH, pathbuf);
+	dattrs->DEV_NUMA_NODE = sysfs_lookup_numa_node(pathbuf);
+}
+
+/*
+ * pcie_topology_score - closeness of the GPU and the block device on the
+ * PCIe bus. Number of the common components of the sysfs path is larger
+ * if both devices are under the same root complex, then the same PCIe
+ * switch, for example. Devices on the same NUMA node gets one more point,
+ * even if they have no common root complex.
+ */
+static int
+pcie_topology_score(DevAttributes *dattrs,
+					const char *dev_path, int dev_numa_node)
+{
+	const char *gpu_path = dattrs->DEV_PCIE_PATH;
+	int			score = 0;
+	int			i;
+
+	if (gpu_path[0] == '\0')
+		return 0;
+	/* skip "/sys/devices/" */
+	i = strlen("/sys/devices/");
+	if (strncmp(gpu_path, dev_path, i) != 0)
+		return 0;
+	for (;;)
+	{
+		if (gpu_path[i] != dev_path[i])
+			break;
+		if (gpu_path[i] == '\0')
+			break;
+		if (gpu_path[i] == '/')
+			score += 2;
+		i++;
+	}
+	if (dattrs->DEV_NUMA_NODE >= 0 &&
+		dattrs->DEV_NUMA_NODE == dev_numa_node)
+		score++;
+	return score;
+}
+
+/*
+ * GetOptimalGpusForFile - returns a bitmap of the GPUs (by cuda_dindex)
+ * closest to the block device where the file is stored. If it is a
+ * software RAID volume (md or dm), its underlying devices are checked.
+ * 0 means no preference; the topology is unknown or not a block device.
+ */
+cl_ulong
+GetOptimalGpusForFile(int fdesc)
+{
+	struct stat	stat_buf;
+	char		namebuf[MAXPGPATH];
+	char		pathbuf[PATH_MAX];
+	List	   *dev_paths = NIL;
+	ListCell   *lc;
+	int			scores[sizeof(cl_ulong) * BITS_PER_BYTE];
+	int			best_score = 0;
+	cl_ulong	optimal_gpus = 0;
+	int			i, ndevs;
+
+	if (fstat(fdesc, &stat_buf) != 0)
+	{
+		elog(LOG, "failed on fstat: %m");
+		return 0;
+	}
+	snprintf(namebuf, sizeof(namebuf), "/sys/dev/block/%u:%u",
+			 major(stat_buf.st_dev),
+			 minor(stat_buf.st_dev));
+	if (!realpath(namebuf, pathbuf))
+		return 0;	/* not a block device; tmpfs, nfs, ... */
+
+	if (strncmp(pathbuf, "/sys/devices/virtual/", 21) != 0)
+		dev_paths = list_make1(pstrdup(pathbuf));
+	else
+	{
+		DIR			   *dir;
+		struct dirent  *dent;
+		char		   *slaves = psprintf("%s/slaves", pathbuf);
+
+		dir = AllocateDir(slaves);
+		if (!dir)
+			return 0;
+		while ((dent = ReadDir(dir, slaves)) != NULL)
+		{
+			if (dent->d_name[0] == '.')
+				continue;
+			snprintf(namebuf, sizeof(namebuf),
+					 "/sys/class/block/%s", dent->d_name);
+			if (realpath(namebuf, pathbuf))
+				dev_paths = lappend(dev_paths, pstrdup(pathbuf));
+		}
+		FreeDir(dir);
+	}
+
+	ndevs = Min(numDevAttrs, lengthof(scores));
+	memset(scores, 0, sizeof(scores));
+	foreach (lc, dev_paths)
+	{
+		char   *dev_path = lfirst(lc);
+		int		dev_numa_node = sysfs_lookup_numa_node(dev_path);
+
+		for (i=0; i < ndevs; i++)
+			scores[i] += pcie_topology_score(&devAttrs[i],
+											 dev_path, dev_numa_node);
+	}
+	for (i=0; i < ndevs; i++)
+	{
+		if (scores[i] > best_score)
+		{
+			best_score = scores[i];
+			optimal_gpus = (1UL << i);
+		}
+		else if (scores[i] > 0 && scores[i] == best_score)
+			optimal_gpus |= (1UL << i);
+	}
+	list_free_deep(dev_paths);
+
+	return optimal_gpus;
+}
+
+/*
+ * On-disk cache of the gpuinfo output
+ *
+ * gpuinfo command has to initialize CUDA runtime and to query hundreds of
+ * attributes for each device, so it takes a few seconds on the host with
+ * many GPUs. Its output is kept in the data directory with a signature of
+ * the hardware/driver configuration, then reused on the next startup (or
+ * promotion of the standby) unless the configuration is changed.
+ */
+#define GPUINFO_CACHE_FILENAME		"pg_strom_gpuinfo.cache"
+#define GPUINFO_CACHE_HEADER		"# PG-Strom gpuinfo cache (signature=%08x)\n"
+
+static int
+gpuinfo_cache_name_cmp(const void *a, const void *b)
+{
+	return strcmp(*((char * const *) a), *((char * const *) b));
+}
+
+/*
+ * gpuinfo_cache_append_file - appends contents of the file, if any
+ */
+static void
+gpuinfo_cache_append_file(StringInfo buf, const char *fname)
+{
+	char		linebuf[1024];
+	FILE	   *filp;
+
+	filp = AllocateFile(fname, "r");
+	if (!filp)
+		return;
+	appendStringInfo(buf, "%s:\n", fname);
+	while (fgets(linebuf, sizeof(linebuf), filp) != NULL)
+		appendStringInfoString(buf, linebuf);
+	FreeFile(filp);
+}
+
+/*
+ * gpuinfo_cache_append_tree - appends the sorted entries of the directory
+ * tree, if any. It is used to track the MIG instances.
+ */
+static void
+gpuinfo_cache_append_tree(StringInfo buf, const char *dname, int depth)
+{
+	DIR		   *dir;
+	struct dirent *dent;
+	char	  **names = NULL;
+	int			nitems = 0;
+	int			nrooms = 0;
+	int			i;
+
+	if (depth <= 0)
+		return;
+	dir = AllocateDir(dname);
+	if (!dir)
+		return;
+	while ((dent = ReadDir(dir, dname)) != NULL)
+	{
+		if (dent->d_name[0] == '.')
+			continue;
+		if (nitems == nrooms)
+		{
+			nrooms = 2 * nrooms + 16;
+			names = (names ? repalloc(names, sizeof(char *) * nrooms)
+					 : palloc(sizeof(char *) * nrooms));
+		}
+		names[nitems++] = psprintf("%s/%s", dname, dent->d_name);
+	}
+	FreeDir(dir);
+	if (nitems > 0)
+		qsort(names, nitems, sizeof(char *), gpuinfo_cache_name_cmp);
+	for (i=0; i < nitems; i++)
+	{
+		appendStringInfo(buf, "entry=%s\n", names[i]);
+		gpuinfo_cache_append_tree(buf, names[i], depth - 1);
+	}
+}
+
+/*
+ * gpuinfo_cache_signature - CRC of the driver version, PCI bus-id and
+ * information of the installed GPUs, MIG instances, boot-id of the kernel,
+ * CUDA_VISIBLE_DEVICES and the gpuinfo command itself.
+ * It must not initialize CUDA driver in the postmaster, so the attributes
+ * which are not exposed to /proc (like compute mode or ECC mode) are not
+ * tracked directly; the boot-id expires the cache on the reboot, which
+ * resets the compute mode and applies the pending ECC/MIG mode.
+ * It returns false if the configuration is unknown; no cache in this case.
+ */
+static bool
+gpuinfo_cache_signature(pg_crc32 *p_signature)
+{
+	StringInfoData buf;
+	char		linebuf[1024];
+	FILE	   *filp;
+	DIR		   *dir;
+	struct dirent *dent;
+	struct stat	stat_buf;
+	char	  **names = NULL;
+	int			nitems = 0;
+	int			nrooms = 0;
+	const char *env;
+	pg_crc32	signature;
+	int			i;
+
+	initStringInfo(&buf);
+	/* NVIDIA driver version */
+	filp = AllocateFile("/proc/driver/nvidia/version", "r");
+	if (!filp)
+		return false;
+	if (!fgets(linebuf, sizeof(linebuf), filp))
+	{
+		FreeFile(filp);
+		return false;
+	}
+	FreeFile(filp);
+	appendStringInfo(&buf, "driver=%s", linebuf);
+
+	/* PCI bus-id of the GPUs, in order */
+	dir = AllocateDir("/proc/driver/nvidia/gpus");
+	if (!dir)
+		return false;
+	while ((dent = ReadDir(dir, "/proc/driver/nvidia/gpus")) != NULL)
+	{
+		if (dent->d_name[0] == '.')
+			continue;
+		if (nitems == nrooms)
+		{
+			nrooms = 2 * nrooms + 16;
+			names = (names ? repalloc(names, sizeof(char *) * nrooms)
+					 : palloc(sizeof(char *) * nrooms));
+		}
+		names[nitems++] = pstrdup(dent->d_name);
+	}
+	FreeDir(dir);
+	if (nitems > 0)
+		qsort(names, nitems, sizeof(char *), gpuinfo_cache_name_cmp);
+	for (i=0; i < nitems; i++)
+	{
+		appendStringInfo(&buf, "gpu=%s\n", names[i]);
+		snprintf(linebuf, sizeof(linebuf),
+				 "/proc/driver/nvidia/gpus/%s/information", names[i]);
+		gpuinfo_cache_append_file(&buf, linebuf);
+	}
+
+	/* MIG instances, if any */
+	gpuinfo_cache_append_tree(&buf, "/proc/driver/nvidia/capabilities", 5);
+
+	/* boot-id of the kernel */
+	gpuinfo_cache_append_file(&buf, "/proc/sys/kernel/random/boot_id");
+
+	/* CUDA_VISIBLE_DEVICES */
+	env = getenv("CUDA_VISIBLE_DEVICES");
+	appendStringInfo(&buf, "visible=%s\n", env ? env : "");
+
+	/* gpuinfo command, updated on re-installation */
+	if (stat(CMD_GPUINFO_PATH, &stat_buf) != 0)
+		return false;
+	appendStringInfo(&buf, "gpuinfo=%ld.%ld\n",
+					 (long) stat_buf.st_mtime,
+					 (long) stat_buf.st_size);
+
+	INIT_LEGACY_CRC32(signature);
+	COMP_LEGACY_CRC32(signature, buf.data, buf.len);
+	FIN_LEGACY_CRC32(signature);
+	pfree(buf.data);
+
+	*p_signature = signature;
+	return true;
+}
+
+/*
+ * gpuinfo_cache_read - loads the gpuinfo output from the cache file, if
+ * its signature matches.
+ */
+static bool
+gpuinfo_cache_read(StringInfo output, pg_crc32 signature)
+{
+	char		header[80];
+	char		linebuf[2048];
+	FILE	   *filp;
+
+	filp = AllocateFile(GPUINFO_CACHE_FILENAME, PG_BINARY_R);
+	if (!filp)
+		return false;
+	snprintf(header, sizeof(header), GPUINFO_CACHE_HEADER, signature);
+	if (!fgets(linebuf, sizeof(linebuf), filp) ||
+		strcmp(linebuf, header) != 0)
+	{
+		FreeFile(filp);
+		return false;
+	}
+	while (fgets(linebuf, sizeof(linebuf), filp) != NULL)
+		appendStringInfoString(output, linebuf);
+	FreeFile(filp);
+
+	return true;
+}
+
+/*
+ * gpuinfo_cache_write - saves the gpuinfo output to the cache file.
+ * Failure is not fatal; gpuinfo shall run on the next startup again.
+ */
+static void
+gpuinfo_cache_write(const char *output, pg_crc32 signature)
+{
+	char		tempname[MAXPGPATH];
+	FILE	   *filp;
+
+	snprintf(tempname, sizeof(tempname), "%s.%d",
+			 GPUINFO_CACHE_FILENAME, MyProcPid);
+	filp = AllocateFile(tempname, PG_BINARY_W);
+	if (!filp)
+	{
+		elog(LOG, "PG-Strom: could not open \"%s\": %m", tempname);
+		return;
+	}
+	if (fprintf(filp, GPUINFO_CACHE_HEADER, signature) < 0 ||
+		fputs(output, filp) < 0)
+	{
+		elog(LOG, "PG-Strom: could not write \"%s\": %m", tempname);
+		FreeFile(filp);
+		unlink(tempname);
+		return;
+	}
+	if (FreeFile(filp) != 0)
+	{
+		elog(LOG, "PG-Strom: could not close \"%s\": %m", tempname);
+		unlink(tempname);
+		return;
+	}
+	/* atomic replacement */
+	if (rename(tempname, GPUINFO_CACHE_FILENAME) != 0)
+	{
+		elog(LOG, "PG-Strom: could not rename \"%s\" to \"%s\": %m",
+			 tempname, GPUINFO_CACHE_FILENAME);
+		unlink(tempname);
+	}
+}
 
 /*
  * pgstrom_collect_gpu_device
@@ -70,9 +491,16 @@ static void
 pgstrom_collect_gpu_device(void)
 {
 	StringInfoData str;
+	StringInfoData output;
 	char	   *cmdline;
-	char		linebuf[2048];
+	char	   *output_copy = NULL;
+	char	   *linebuf;
+	char	   *saveptr;
+	char		buffer[2048];
+	size_t		nbytes;
 	FILE	   *filp;
+	pg_crc32	signature;
+	bool		has_signature;
 	char	   *tok_attr;
 	char	   *tok_val;
 	char	   *pos;
@@ -82,13 +510,26 @@ pgstrom_collect_gpu_device(void)
 	int			i, j;
 
 	initStringInfo(&str);
+	initStringInfo(&output);
 
-	cmdline = psprintf("%s -md", CMD_GPUINFO_PATH);
-	filp = OpenPipeStream(cmdline, PG_BINARY_R);
+	has_signature = gpuinfo_cache_signature(&signature);
+	if (!has_signature || !gpuinfo_cache_read(&output, signature))
+	{
+		cmdline = psprintf("%s -md", CMD_GPUINFO_PATH);
+		filp = OpenPipeStream(cmdline, PG_BINARY_R);
+		while ((nbytes = fread(buffer, 1, sizeof(buffer), filp)) > 0)
+			appendBinaryStringInfo(&output, buffer, nbytes);
+		ClosePipeStream(filp);
+		/* saved to the cache once parsed successfully */
+		if (has_signature)
+			output_copy = pstrdup(output.data);
+	}
 
-	while (fgets(linebuf, sizeof(linebuf), filp) != NULL)
+	for (linebuf = strtok_r(output.data, "\n", &saveptr);
+		 linebuf != NULL;
+		 linebuf = strtok_r(NULL, "\n", &saveptr))
 	{
-		/* trim '\n' on the tail */
+		/* trim spaces on the tail */
 		pos = linebuf + strlen(linebuf);
 		while (pos > linebuf && isspace(*--pos))
 			*pos = '\0';
@@ -165,7 +606,7 @@ pgstrom_collect_gpu_device(void)
 		else
 			elog(ERROR, "unexpected gpuinfo -md input:\n%s", linebuf);
 	}
-	ClosePipeStream(filp);
+	pfree(output.data);
 
 	for (i=0, j=0; i < num_devices; i++)
 	{
@@ -219,6 +660,9 @@ pgstrom_collect_gpu_device(void)
 		else
 			dattrs->CORES_PER_MPU = 0;	/* unknown */
 
+		/* Location of the device on PCIe bus and NUMA node */
+		pgstrom_collect_gpu_topology(dattrs);
+
 		/* Log brief CUDA device properties */
 		resetStringInfo(&str);
 		appendStringInfo(&str, "GPU%d %s (",
@@ -252,6 +696,9 @@ pgstrom_collect_gpu_device(void)
 		appendStringInfo(&str, ", CC %d.%d",
 						 dattrs->COMPUTE_CAPABILITY_MAJOR,
 						 dattrs->COMPUTE_CAPABILITY_MINOR);
+		if (dattrs->DEV_NUMA_NODE >= 0)
+			appendStringInfo(&str, ", NUMA node %d",
+							 dattrs->DEV_NUMA_NODE);
 		elog(LOG, "PG-Strom: %s", str.data);
 
 		if (i != j)
@@ -263,8 +710,16 @@ pgstrom_collect_gpu_device(void)
 	numDevAttrs = j;
 	if (numDevAttrs == 0)
 		elog(ERROR, "PG-Strom: no supported GPU devices found");
+
+	if (output_copy)
+	{
+		gpuinfo_cache_write(output_copy, signature);
+		pfree(output_copy);
+	}
 }
 
+static void gpu_calibration_invalidator(Datum arg, Oid relid);
+
 /*
  * pgstrom_init_gpu_device
  */
@@ -292,6 +747,8 @@ pgstrom_init_gpu_device(void)
 	}
 	/* collect device properties by gpuinfo command */
 	pgstrom_collect_gpu_device();
+	/* invalidation of the calibrated cost factors */
+	CacheRegisterRelcacheCallback(gpu_calibration_invalidator, 0);
 }
 
 /*
@@ -390,7 +847,29 @@ largest_workgroup_size(size_t *p_grid_size,
 
 /*
  * gpuOptimalBlockSize - a simple wrapper of cuOccupancyMaxPotentialBlockSize
+ *
+ * Results are cached per worker thread, because the same kernel is
+ * launched for every chunk with the same parameters, and the occupancy
+ * calculator is not cheap compared to the kernel for small chunks.
+ * @max_num_threads is not a part of the cache key, because it only clamps
+ * the grid size after the lookup. CUfunction is valid during the lifetime
+ * of the worker thread, because CUDA modules are released on cuCtxDestroy()
+ * after the termination of the workers.
  */
+#define OPTIMAL_BLOCKSIZE_CACHE_NSLOTS		32
+typedef struct
+{
+	CUfunction	kern_function;
+	size_t		dynamic_shmem_per_block;
+	size_t		dynamic_shmem_per_thread;
+	int			min_grid_sz;
+	int			opt_grid_sz;
+	int			block_sz;
+} optimal_blocksize_cache_entry;
+
+static __thread optimal_blocksize_cache_entry
+	optimal_blocksize_cache[OPTIMAL_BLOCKSIZE_CACHE_NSLOTS];
+
 CUresult
 gpuOptimalBlockSize(size_t *p_grid_sz,
 					size_t *p_block_sz,
@@ -399,12 +878,34 @@ gpuOptimalBlockSize(size_t *p_grid_sz,
 					size_t dynamic_shmem_per_block,
 					size_t dynamic_shmem_per_thread)
 {
+	optimal_blocksize_cache_entry *entry = NULL;
 	int		min_grid_sz;
 	int		opt_grid_sz;
 	int		max_grid_sz;
 	int		block_sz;
 	CUresult rc;
 
+	if (GpuWorkerCurrentContext)
+	{
+		pg_crc32	hash;
+
+		INIT_LEGACY_CRC32(hash);
+		COMP_LEGACY_CRC32(hash, &kern_function, sizeof(CUfunction));
+		COMP_LEGACY_CRC32(hash, &dynamic_shmem_per_block, sizeof(size_t));
+		COMP_LEGACY_CRC32(hash, &dynamic_shmem_per_thread, sizeof(size_t));
+		FIN_LEGACY_CRC32(hash);
+		entry = &optimal_blocksize_cache[hash % OPTIMAL_BLOCKSIZE_CACHE_NSLOTS];
+		if (entry->kern_function == kern_function &&
+			entry->dynamic_shmem_per_block == dynamic_shmem_per_block &&
+			entry->dynamic_shmem_per_thread == dynamic_shmem_per_thread)
+		{
+			min_grid_sz = entry->min_grid_sz;
+			opt_grid_sz = entry->opt_grid_sz;
+			block_sz = entry->block_sz;
+			goto found;
+		}
+	}
+
 	__dynamic_shmem_per_block = dynamic_shmem_per_block;
 	__dynamic_shmem_per_thread = dynamic_shmem_per_thread;
 	rc = cuOccupancyMaxPotentialBlockSize(&min_grid_sz,
@@ -415,17 +916,27 @@ gpuOptimalBlockSize(size_t *p_grid_sz,
 										  0);
 	if (rc != CUDA_SUCCESS)
 		return rc;
+	rc = cuOccupancyMaxActiveBlocksPerMultiprocessor(&opt_grid_sz,
+													 kern_function,
+													 block_sz,
+													 dynamic_shmem_per_block +
+													 dynamic_shmem_per_thread *
+													 block_sz);
+	if (rc != CUDA_SUCCESS)
+		return rc;
+
+	if (entry)
+	{
+		entry->kern_function = kern_function;
+		entry->dynamic_shmem_per_block = dynamic_shmem_per_block;
+		entry->dynamic_shmem_per_thread = dynamic_shmem_per_thread;
+		entry->min_grid_sz = min_grid_sz;
+		entry->opt_grid_sz = opt_grid_sz;
+		entry->block_sz = block_sz;
+	}
+found:
 	if (p_grid_sz)
 	{
-		size_t		dyn_shmem_sz = (dynamic_shmem_per_block +
-									dynamic_shmem_per_thread * block_sz);
-		rc = cuOccupancyMaxActiveBlocksPerMultiprocessor(&opt_grid_sz,
-														 kern_function,
-														 block_sz,
-														 dyn_shmem_sz);
-		if (rc != CUDA_SUCCESS)
-			return rc;
-
 		max_grid_sz = (max_num_threads + block_sz - 1) / block_sz;
 		*p_grid_sz = Max(min_grid_sz, Min(max_grid_sz, opt_grid_sz));
 	}
@@ -475,8 +986,8 @@ pgstrom_device_info(PG_FUNCTION_ARGS)
 	}
 	fncxt = SRF_PERCALL_SETUP();
 
-	dindex = fncxt->call_cntr / (lengthof(DevAttrCatalog) + 2);
-	aindex = fncxt->call_cntr % (lengthof(DevAttrCatalog) + 2);
+	dindex = fncxt->call_cntr / (lengthof(DevAttrCatalog) + 4);
+	aindex = fncxt->call_cntr % (lengthof(DevAttrCatalog) + 4);
 
 	if (dindex >= numDevAttrs)
 		SRF_RETURN_DONE(fncxt);
@@ -492,6 +1003,18 @@ pgstrom_device_info(PG_FUNCTION_ARGS)
 		att_name = "GPU Total RAM Size";
 		att_value = format_bytesz(dattrs->DEV_TOTAL_MEMSZ);
 	}
+	else if (aindex == lengthof(DevAttrCatalog) + 2)
+	{
+		att_name = "NUMA node of the device";
+		att_value = psprintf("%d", dattrs->DEV_NUMA_NODE);
+	}
+	else if (aindex == lengthof(DevAttrCatalog) + 3)
+	{
+		att_name = "PCIe topology of the device";
+		att_value = (dattrs->DEV_PCIE_PATH[0] != '\0'
+					 ? dattrs->DEV_PCIE_PATH
+					 : "Unknown");
+	}
 	else
 	{
 		int		i = aindex - 2;
@@ -686,3 +1209,453 @@ pgstrom_gpu_pci_id(PG_FUNCTION_ARGS)
 	PG_RETURN_TEXT_P(cstring_to_text(temp));
 }
 PG_FUNCTION_INFO_V1(pgstrom_gpu_pci_id);
+
+/*
+ * ----------------------------------------------------------------
+ *
+ * Calibration of the GPU cost model
+ *
+ * pgstrom.gpu_device_benchmark() measures the setup time, kernel launch
+ * latency, host-to-device DMA bandwidth and throughput of simple operators
+ * for each device, and throughput of operators invoked by the executor on
+ * CPU as a reference. pgstrom.gpu_cost_calibrate() saves them into the
+ * pgstrom.gpu_cost_calibration table.
+ * If pg_strom.gpu_cost_calibration is enabled, the planner translates the
+ * measured time into cost factors relative to cpu_operator_cost, instead
+ * of the static pg_strom.gpu_(setup|dma|operator)_cost.
+ *
+ * ----------------------------------------------------------------
+ */
+#define CALIBRATION_NITEMS		(16U << 20)		/* 16M items (64MB) */
+#define CALIBRATION_NLOOPS		8		/* number of operators per item */
+#define CALIBRATION_NLAUNCHES	100
+#define CALIBRATION_NDMA		4
+#define CALIBRATION_CPU_NLOOPS	(4U << 20)
+#define CALIBRATION_NATTRS		6
+
+/*
+ * calibration_ptx - kernels to measure launch latency and throughput of
+ * simple operators. A LCG step per loop is a proxy of device operators.
+ */
+static const char *calibration_ptx =
+	".version 4.0\n"
+	".target sm_30\n"
+	".address_size 64\n"
+	"\n"
+	".visible .entry calibration_empty()\n"
+	"{\n"
+	"	ret;\n"
+	"}\n"
+	"\n"
+	".visible .entry calibration_ops(.param .u64 buffer,\n"
+	"                                .param .u32 nitems,\n"
+	"                                .param .u32 nloops)\n"
+	"{\n"
+	"	.reg .pred	%p<3>;\n"
+	"	.reg .b32	%r<9>;\n"
+	"	.reg .b64	%rd<5>;\n"
+	"\n"
+	"	ld.param.u64	%rd1, [buffer];\n"
+	"	ld.param.u32	%r1, [nitems];\n"
+	"	ld.param.u32	%r2, [nloops];\n"
+	"	mov.u32	%r3, %ctaid.x;\n"
+	"	mov.u32	%r4, %ntid.x;\n"
+	"	mov.u32	%r5, %tid.x;\n"
+	"	mad.lo.s32	%r6, %r3, %r4, %r5;\n"
+	"	setp.ge.u32	%p1, %r6, %r1;\n"
+	"	@%p1 bra	DONE;\n"
+	"	cvta.to.global.u64	%rd2, %rd1;\n"
+	"	mul.wide.u32	%rd3, %r6, 4;\n"
+	"	add.s64	%rd4, %rd2, %rd3;\n"
+	"	ld.global.u32	%r7, [%rd4];\n"
+	"	mov.u32	%r8, 0;\n"
+	"LOOP:\n"
+	"	mad.lo.s32	%r7, %r7, 1664525, 1013904223;\n"
+	"	add.s32	%r8, %r8, 1;\n"
+	"	setp.lt.u32	%p2, %r8, %r2;\n"
+	"	@%p2 bra	LOOP;\n"
+	"	st.global.u32	[%rd4], %r7;\n"
+	"DONE:\n"
+	"	ret;\n"
+	"}\n";
+
+/* elapsed time in microseconds */
+static inline double
+calibration_elapsed_usec(instr_time *tv_begin)
+{
+	instr_time	tv_curr;
+
+	INSTR_TIME_SET_CURRENT(tv_curr);
+	INSTR_TIME_SUBTRACT(tv_curr, *tv_begin);
+
+	return INSTR_TIME_GET_DOUBLE(tv_curr) * 1000000.0;
+}
+
+/*
+ * benchmark_cpu_operator - nanoseconds per operator invoked by fmgr
+ */
+static double
+benchmark_cpu_operator(void)
+{
+	instr_time	tv;
+	Datum		value = Int32GetDatum(0);
+	cl_uint		i;
+
+	INSTR_TIME_SET_CURRENT(tv);
+	for (i=0; i < CALIBRATION_CPU_NLOOPS; i++)
+		value = DirectFunctionCall2(int4larger, value, Int32GetDatum(i));
+	if (DatumGetInt32(value) < 0)
+		elog(ERROR, "Bug? unexpected result of the CPU benchmark");
+	return (calibration_elapsed_usec(&tv) * 1000.0 /
+			(double)CALIBRATION_CPU_NLOOPS);
+}
+
+/*
+ * benchmark_gpu_device - measures the device on @cuda_dindex
+ */
+static void
+benchmark_gpu_device(cl_int cuda_dindex, double *results)
+{
+	CUdevice	cuda_device;
+	CUcontext	cuda_context = NULL;
+	CUmodule	cuda_module;
+	CUfunction	kern_empty;
+	CUfunction	kern_ops;
+	CUdeviceptr	m_buffer;
+	void	   *h_buffer;
+	size_t		length = sizeof(cl_uint) * CALIBRATION_NITEMS;
+	cl_uint		nitems = CALIBRATION_NITEMS;
+	cl_uint		nloops = CALIBRATION_NLOOPS;
+	void	   *kern_args[3];
+	instr_time	tv;
+	double		setup_usec;
+	double		launch_usec;
+	double		dma_usec;
+	double		ops_usec;
+	CUresult	rc;
+	int			i;
+
+	PG_TRY();
+	{
+		rc = gpuInit(0);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuInit: %s", errorText(rc));
+
+		/* setup time; context creation, module load and the first launch */
+		INSTR_TIME_SET_CURRENT(tv);
+		rc = cuDeviceGet(&cuda_device, devAttrs[cuda_dindex].DEV_ID);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuDeviceGet: %s", errorText(rc));
+		rc = cuCtxCreate(&cuda_context, 0, cuda_device);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuCtxCreate: %s", errorText(rc));
+		rc = cuModuleLoadData(&cuda_module, calibration_ptx);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuModuleLoadData: %s", errorText(rc));
+		rc = cuModuleGetFunction(&kern_empty, cuda_module,
+								 "calibration_empty");
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuModuleGetFunction: %s", errorText(rc));
+		rc = cuModuleGetFunction(&kern_ops, cuda_module,
+								 "calibration_ops");
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuModuleGetFunction: %s", errorText(rc));
+		rc = cuLaunchKernel(kern_empty, 1, 1, 1, 1, 1, 1, 0, NULL, NULL, NULL);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuLaunchKernel: %s", errorText(rc));
+		rc = cuCtxSynchronize();
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuCtxSynchronize: %s", errorText(rc));
+		setup_usec = calibration_elapsed_usec(&tv);
+
+		/* kernel launch latency */
+		INSTR_TIME_SET_CURRENT(tv);
+		for (i=0; i < CALIBRATION_NLAUNCHES; i++)
+		{
+			rc = cuLaunchKernel(kern_empty, 1, 1, 1, 1, 1, 1,
+								0, NULL, NULL, NULL);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuLaunchKernel: %s", errorText(rc));
+			rc = cuCtxSynchronize();
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuCtxSynchronize: %s", errorText(rc));
+		}
+		launch_usec = calibration_elapsed_usec(&tv) / CALIBRATION_NLAUNCHES;
+
+		/* host-to-device DMA bandwidth */
+		rc = cuMemAllocHost(&h_buffer, length);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemAllocHost: %s", errorText(rc));
+		memset(h_buffer, 0, length);
+		rc = cuMemAlloc(&m_buffer, length);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemAlloc: %s", errorText(rc));
+
+		INSTR_TIME_SET_CURRENT(tv);
+		for (i=0; i < CALIBRATION_NDMA; i++)
+		{
+			rc = cuMemcpyHtoD(m_buffer, h_buffer, length);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+		}
+		dma_usec = calibration_elapsed_usec(&tv) / CALIBRATION_NDMA;
+
+		/* throughput of simple operators */
+		kern_args[0] = &m_buffer;
+		kern_args[1] = &nitems;
+		kern_args[2] = &nloops;
+		INSTR_TIME_SET_CURRENT(tv);
+		rc = cuLaunchKernel(kern_ops,
+							(nitems + 255) / 256, 1, 1,
+							256, 1, 1,
+							0, NULL, kern_args, NULL);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuLaunchKernel: %s", errorText(rc));
+		rc = cuCtxSynchronize();
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuCtxSynchronize: %s", errorText(rc));
+		ops_usec = calibration_elapsed_usec(&tv) - launch_usec;
+
+		/* resources are released on cuCtxDestroy(); no need to care */
+		rc = cuCtxDestroy(cuda_context);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuCtxDestroy: %s", errorText(rc));
+		cuda_context = NULL;
+	}
+	PG_CATCH();
+	{
+		if (cuda_context)
+			cuCtxDestroy(cuda_context);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	results[0] = setup_usec;
+	results[1] = launch_usec;
+	results[2] = dma_usec * (double)(1UL << 20) / (double)length;
+	results[3] = (Max(ops_usec, 0.0) * 1000.0 /
+				  ((double)nitems * (double)nloops));
+}
+
+/*
+ * pgstrom_gpu_device_benchmark - SQL function to run the benchmark
+ */
+Datum
+pgstrom_gpu_device_benchmark(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	cl_int		dindex;
+	double		results[4];
+	double		cpu_nsec;
+	Datum		values[CALIBRATION_NATTRS];
+	bool		isnull[CALIBRATION_NATTRS];
+	HeapTuple	tuple;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+		double		   *p_cpu_nsec;
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(CALIBRATION_NATTRS, false);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "device_nr",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "setup_usec",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "launch_usec",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "dma_usec_per_mb",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 5, "gpu_op_nsec",
+						   FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 6, "cpu_op_nsec",
+						   FLOAT8OID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+
+		p_cpu_nsec = palloc(sizeof(double));
+		*p_cpu_nsec = benchmark_cpu_operator();
+		fncxt->user_fctx = p_cpu_nsec;
+
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+
+	dindex = fncxt->call_cntr;
+	if (dindex >= numDevAttrs)
+		SRF_RETURN_DONE(fncxt);
+	cpu_nsec = *((double *)fncxt->user_fctx);
+	benchmark_gpu_device(dindex, results);
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = Int32GetDatum(devAttrs[dindex].DEV_ID);
+	values[1] = Float8GetDatum(results[0]);
+	values[2] = Float8GetDatum(results[1]);
+	values[3] = Float8GetDatum(results[2]);
+	values[4] = Float8GetDatum(results[3]);
+	values[5] = Float8GetDatum(cpu_nsec);
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_gpu_device_benchmark);
+
+/*
+ * Backend local cache of the pgstrom.gpu_cost_calibration table.
+ * It shall be reloaded on the relcache invalidation; fired by the trigger
+ * below, because DML on the table does not invalidate its relcache.
+ */
+typedef struct
+{
+	cl_int		device_nr;
+	double		values[CALIBRATION_NATTRS - 1];
+} gpuCostCalibration;
+
+static bool					gpu_calibration_valid = false;
+static Oid					gpu_calibration_relid = InvalidOid;
+static int					gpu_calibration_nitems = 0;
+static gpuCostCalibration  *gpu_calibration_items = NULL;
+
+static void
+gpu_calibration_invalidator(Datum arg, Oid relid)
+{
+	if (!OidIsValid(relid) || relid == gpu_calibration_relid)
+		gpu_calibration_valid = false;
+}
+
+static bool
+gpu_calibration_load(void)
+{
+	Oid			namespace_oid;
+	Oid			relid;
+	Relation	rel;
+	TupleDesc	tupdesc;
+	SysScanDesc	sscan;
+	HeapTuple	tuple;
+	int			nitems = 0;
+	gpuCostCalibration *items;
+
+	namespace_oid = get_namespace_oid("pgstrom", true);
+	if (!OidIsValid(namespace_oid))
+		return false;
+	relid = get_relname_relid("gpu_cost_calibration", namespace_oid);
+	if (!OidIsValid(relid))
+		return false;
+	if (gpu_calibration_valid && gpu_calibration_relid == relid)
+		return (gpu_calibration_nitems > 0);
+
+	rel = heap_open(relid, AccessShareLock);
+	tupdesc = RelationGetDescr(rel);
+	if (tupdesc->natts < CALIBRATION_NATTRS)
+		elog(ERROR, "pgstrom.gpu_cost_calibration has unexpected definition");
+	items = MemoryContextAlloc(TopMemoryContext,
+							   sizeof(gpuCostCalibration) * numDevAttrs);
+	sscan = systable_beginscan(rel, InvalidOid, false, NULL, 0, NULL);
+	while (HeapTupleIsValid(tuple = systable_getnext(sscan)) &&
+		   nitems < numDevAttrs)
+	{
+		Datum	values[CALIBRATION_NATTRS];
+		bool	isnull[CALIBRATION_NATTRS];
+		int		i;
+
+		heap_deform_tuple(tuple, tupdesc, values, isnull);
+		for (i=0; i < CALIBRATION_NATTRS; i++)
+		{
+			if (isnull[i])
+				break;
+		}
+		if (i < CALIBRATION_NATTRS)
+			continue;
+		items[nitems].device_nr = DatumGetInt32(values[0]);
+		for (i=1; i < CALIBRATION_NATTRS; i++)
+			items[nitems].values[i-1] = DatumGetFloat8(values[i]);
+		/* CPU reference must be valid */
+		if (items[nitems].values[4] > 0.0)
+			nitems++;
+	}
+	systable_endscan(sscan);
+	heap_close(rel, AccessShareLock);
+
+	if (gpu_calibration_items)
+		pfree(gpu_calibration_items);
+	gpu_calibration_items = items;
+	gpu_calibration_nitems = nitems;
+	gpu_calibration_relid = relid;
+	gpu_calibration_valid = true;
+
+	return (nitems > 0);
+}
+
+/*
+ * pgstrom_gpu_cost_calibration_invalidator
+ *
+ * Statement trigger on the pgstrom.gpu_cost_calibration table, to let the
+ * other backends reload the calibrated cost factors.
+ */
+Datum
+pgstrom_gpu_cost_calibration_invalidator(PG_FUNCTION_ARGS)
+{
+	TriggerData	   *trigdata = (TriggerData *) fcinfo->context;
+
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		elog(ERROR, "%s: must be called as trigger", __FUNCTION__);
+	if (!TRIGGER_FIRED_AFTER(trigdata->tg_event))
+		elog(ERROR, "%s: must be configured as AFTER trigger", __FUNCTION__);
+	CacheInvalidateRelcache(trigdata->tg_relation);
+
+	PG_RETURN_POINTER(NULL);
+}
+PG_FUNCTION_INFO_V1(pgstrom_gpu_cost_calibration_invalidator);
+
+/*
+ * pgstrom_gpu_cost_factors
+ *
+ * It returns the cost factors for GPU; the calibrated ones if
+ * pg_strom.gpu_cost_calibration is enabled and the measurement exists,
+ * or the static configuration elsewhere. As GpuContext is assigned to
+ * a device at the execution time, average of the devices is used.
+ */
+void
+pgstrom_gpu_cost_factors(double *p_gpu_setup_cost,
+						 double *p_gpu_dma_cost,
+						 double *p_gpu_operator_cost)
+{
+	double		sum[CALIBRATION_NATTRS - 1];
+	double		cost_per_nsec;
+	double		chunk_mb;
+	int			i, j;
+
+	if (!pgstrom_gpu_cost_calibration || !gpu_calibration_load())
+	{
+		*p_gpu_setup_cost = pgstrom_gpu_setup_cost;
+		*p_gpu_dma_cost = pgstrom_gpu_dma_cost;
+		*p_gpu_operator_cost = pgstrom_gpu_operator_cost;
+		return;
+	}
+
+	memset(sum, 0, sizeof(sum));
+	for (i=0; i < gpu_calibration_nitems; i++)
+	{
+		for (j=0; j < CALIBRATION_NATTRS - 1; j++)
+			sum[j] += gpu_calibration_items[i].values[j];
+	}
+	for (j=0; j < CALIBRATION_NATTRS - 1; j++)
+		sum[j] /= (double) gpu_calibration_nitems;
+
+	/*
+	 * cpu_operator_cost is the cost per operator on CPU, so we can
+	 * translate the measured time to the cost unit.
+	 * sum[] = setup_usec, launch_usec, dma_usec_per_mb, gpu_op_nsec
+	 * and cpu_op_nsec
+	 */
+	cost_per_nsec = cpu_operator_cost / sum[4];
+	chunk_mb = (double) pgstrom_chunk_size() / (double)(1UL << 20);
+	*p_gpu_setup_cost = sum[0] * 1000.0 * cost_per_nsec;
+	/* DMA cost is per chunk, including kernel launch per chunk */
+	*p_gpu_dma_cost = ((sum[2] * chunk_mb + sum[1]) * 1000.0 *
+					   cost_per_nsec);
+	*p_gpu_operator_cost = sum[3] * cost_per_nsec;
+}
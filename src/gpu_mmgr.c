@@ -28,6 +28,8 @@ typedef enum
 	GpuMemKind__ManagedMemory	= (1 << 1),
 	GpuMemKind__IOMapMemory		= (1 << 2),
 	GpuMemKind__HostMemory		= (1 << 3),
+	GpuMemKind__SharedMemory	= (1 << 4),
+	GpuMemKind__SlabMemory		= (1 << 5),
 } GpuMemKind;
 
 typedef struct
@@ -56,12 +58,67 @@ typedef struct
 	GpuMemKind		gm_kind;	/* one of GpuMemKind__* */
 	CUdeviceptr		m_segment;	/* device pointer of the segment */
 	unsigned long	iomap_handle; /* only if GpuMemKind__IOMapMemory */
+	cl_uint			pool_generation; /* only if GpuMemKind__SharedMemory */
+	cl_int			slab_kindnum;	/* only if GpuMemKind__SlabMemory */
+	cl_int			slab_class;		/* only if GpuMemKind__SlabMemory */
 	slock_t			lock;		/* protection of chunks */
 	pg_atomic_uint32 num_active_chunks; /* # of active chunks */
 	dlist_head		free_chunks[GPUMEM_CHUNKSZ_MAX_BIT + 1];
 	GpuMemChunk		gm_chunks[FLEXIBLE_ARRAY_MEMBER];
 } GpuMemSegment;
 
+/*
+ * GpuMemSlabHead - size-class allocator for small chunks
+ *
+ * Small requests (up to GPUMEM_SLAB_MAX) of the normal and managed memory
+ * are served from the slab pages, instead of the buddy allocator.
+ * Each thread of the GpuContext (the backend itself and worker threads)
+ * has its own magazine of free objects per size-class, so usual alloc/free
+ * takes no lock. Magazines are refilled from / flushed to the depot of the
+ * size-class, protected by the mutex.
+ * A slab page is a GpuMemSegment with GpuMemKind__SlabMemory, and never
+ * released until the GpuContext gets destroyed.
+ */
+#define GPUMEM_SLAB_MIN_BIT			8		/* 256B */
+#define GPUMEM_SLAB_MAX_BIT			13		/* 8KB */
+#define GPUMEM_SLAB_MAX				(1UL << GPUMEM_SLAB_MAX_BIT)
+#define GPUMEM_SLAB_NCLASSES		(GPUMEM_SLAB_MAX_BIT - GPUMEM_SLAB_MIN_BIT + 1)
+#define GPUMEM_SLAB_PAGESZ			(1UL << 20)		/* 1MB */
+#define GPUMEM_SLAB_MAGAZINESZ		32
+
+#define GPUMEM_SLAB_KIND__NORMAL	0
+#define GPUMEM_SLAB_KIND__MANAGED	1
+#define GPUMEM_SLAB_NKINDS			2
+
+typedef struct
+{
+	CUdeviceptr		m_devptr;
+	GpuMemSegment  *gm_page;
+} GpuMemSlabItem;
+
+typedef struct
+{
+	cl_int			nitems;
+	GpuMemSlabItem	items[GPUMEM_SLAB_MAGAZINESZ];
+} GpuMemSlabMagazine;
+
+typedef struct
+{
+	pthread_mutex_t	mutex;
+	cl_int			nitems;
+	cl_int			nrooms;
+	GpuMemSlabItem *items;		/* stack of free objects */
+} GpuMemSlabDepot;
+
+typedef struct GpuMemSlabHead
+{
+	slock_t			lock;		/* protection of the page list */
+	dlist_head		page_list;	/* list of slab pages */
+	GpuMemSlabDepot	depots[GPUMEM_SLAB_NKINDS][GPUMEM_SLAB_NCLASSES];
+	cl_int			nslots;		/* the backend + worker threads */
+	GpuMemSlabMagazine magazines[FLEXIBLE_ARRAY_MEMBER];
+} GpuMemSlabHead;
+
 /* statistics of GPU memory usage (shared; per device) */
 //to be used for memory release request mechanism
 typedef struct
@@ -72,6 +129,38 @@ typedef struct
 	pg_atomic_uint64	iomap_usage;
 } GpuMemStatistics;
 
+/*
+ * GpuMemSharedPool - device-wide pool of the normal device memory
+ *
+ * GPU memory keeper allocates a large device memory region per device on
+ * the first demand of the device, then exports the IPC handle of the
+ * region. Backends open the region by the IPC handle, and borrow
+ * pgstrom_chunk_size() chunks from the pool prior to allocation of their
+ * private segments. The chunks are back
+ * to the pool immediately on release, so idle device memory is never kept
+ * by a particular GpuContext.
+ * A GpuContext which opened the region has a proxy GpuMemSegment with
+ * GpuMemKind__SharedMemory, to map the device pointer to the chunks.
+ */
+typedef struct
+{
+	pid_t			owner_pid;	/* 0, if free chunk */
+	uintptr_t		owner_ctx;	/* GpuContext of the owner process */
+	cl_int			next_free;	/* index of the next free chunk, or -1 */
+} GpuMemSharedChunk;
+
+typedef struct
+{
+	slock_t			lock;
+	bool			is_ready;	/* true, if m_handle is valid */
+	cl_uint			generation;	/* incremented for each pool setup */
+	CUipcMemHandle	m_handle;	/* IPC handle of the pool */
+	cl_int			nchunks;	/* # of chunks in the pool */
+	cl_int			nfree;		/* # of free chunks */
+	cl_int			free_head;	/* index of the first free chunk, or -1 */
+	GpuMemSharedChunk *chunks;	/* array of nchunks */
+} GpuMemSharedPool;
+
 /*
  * GpuMemPreserved
  */
@@ -105,10 +194,21 @@ typedef struct
  */
 #define GPUMEM_PRESERVED_HASH_NSLOTS		500
 
+/*
+ * GPU memory keeper does not create CUDA context (and the shared pool) of
+ * the devices on its startup, because it takes a few hundreds milliseconds
+ * per device. Backends set the bit of the device in @devices_wanted when
+ * they need the device, then the keeper sets up the device on demand.
+ * Devices out of the bitmap are set up on the startup of the keeper.
+ */
+#define GPUMEM_KEEPER_DEVICE_BIT(cuda_dindex)			\
+	((cuda_dindex) < 64 ? (1UL << (cuda_dindex)) : 0UL)
+
 typedef struct
 {
 	Latch		   *gmemp_keeper;
 	slock_t			lock;
+	pg_atomic_uint64 devices_wanted;
 	/* list of GpuMemPreservedRequest */
 	dlist_head		gmemp_req_pending_list;
 	dlist_head		gmemp_req_free_list;
@@ -127,9 +227,14 @@ static shmem_startup_hook_type shmem_startup_next = NULL;
 static GpuMemStatistics *gm_stat_array = NULL;
 static int			gpu_memory_segment_size_kb;	/* GUC */
 static size_t		gm_segment_sz;	/* bytesize */
+static int			gpu_memory_shared_pool_size_kb;	/* GUC */
+static cl_int		gm_pool_nchunks;	/* # of chunks per device */
+static bool			gpu_memory_oversubscribe;	/* GUC */
+static GpuMemSharedPool *gm_pool_array = NULL;	/* per device */
 
 static bool			nvme_strom_enabled;			/* GUC */
 static int			nvme_strom_threshold_kb;	/* GUC */
+static bool			nvme_strom_gpu_topology_aware;	/* GUC */
 
 static int			num_preserved_gpu_memory_regions;	/* GUC */
 static bool			gpummgr_bgworker_got_signal = false;
@@ -241,6 +346,140 @@ gpuMemFreeChunk(GpuContext *gcontext,
     return CUDA_SUCCESS;
 }
 
+/*
+ * __gpuMemPutSharedChunk - back a chunk to the free list of the pool
+ *
+ * NOTE: caller must hold gm_pool->lock
+ */
+static void
+__gpuMemPutSharedChunk(GpuMemSharedPool *gm_pool, cl_int index)
+{
+	GpuMemSharedChunk *gm_pchunk;
+
+	Assert(index >= 0 && index < gm_pool->nchunks);
+	gm_pchunk = &gm_pool->chunks[index];
+	Assert(gm_pchunk->owner_pid != 0);
+	gm_pchunk->owner_pid = 0;
+	gm_pchunk->owner_ctx = 0;
+	gm_pchunk->next_free = gm_pool->free_head;
+	gm_pool->free_head = index;
+	gm_pool->nfree++;
+}
+
+/*
+ * gpuMemPutSharedChunk
+ */
+static void
+gpuMemPutSharedChunk(GpuContext *gcontext, cl_int index,
+					 cl_uint pool_generation)
+{
+	GpuMemSharedPool  *gm_pool = &gm_pool_array[gcontext->cuda_dindex];
+	GpuMemSharedChunk *gm_pchunk;
+
+	SpinLockAcquire(&gm_pool->lock);
+	/*
+	 * Once GPU memory keeper gets restarted, chunks of the older pool are
+	 * already invalid, so we have nothing to do.
+	 */
+	if (gm_pool->is_ready &&
+		gm_pool->generation == pool_generation &&
+		index >= 0 && index < gm_pool->nchunks)
+	{
+		gm_pchunk = &gm_pool->chunks[index];
+		if (gm_pchunk->owner_pid == MyProcPid &&
+			gm_pchunk->owner_ctx == (uintptr_t) gcontext)
+			__gpuMemPutSharedChunk(gm_pool, index);
+	}
+	SpinLockRelease(&gm_pool->lock);
+}
+
+/*
+ * gpuMemFreeSharedChunk
+ */
+static CUresult
+gpuMemFreeSharedChunk(GpuContext *gcontext,
+					  CUdeviceptr m_deviceptr,
+					  GpuMemSegment *gm_seg)
+{
+	cl_long		index;
+
+	Assert(gm_seg->gm_kind == GpuMemKind__SharedMemory);
+	Assert(m_deviceptr >= gm_seg->m_segment &&
+		   m_deviceptr <  gm_seg->m_segment +
+		   (size_t)gm_pool_nchunks * pgstrom_chunk_size());
+	index = (m_deviceptr - gm_seg->m_segment) / pgstrom_chunk_size();
+	gpuMemPutSharedChunk(gcontext, index, gm_seg->pool_generation);
+	pg_atomic_fetch_sub_u32(&gm_seg->num_active_chunks, 1);
+
+	return CUDA_SUCCESS;
+}
+
+/*
+ * gpuMemSlabMagazine - magazine of the current thread, if any
+ */
+static inline GpuMemSlabMagazine *
+gpuMemSlabMagazine(GpuContext *gcontext, cl_int kindnum, cl_int sclass)
+{
+	GpuMemSlabHead *gm_slab = gcontext->gm_slab;
+	cl_int		slot;
+
+	if (!GpuWorkerCurrentContext)
+		slot = 0;		/* backend itself */
+	else if (GpuWorkerCurrentContext == gcontext &&
+			 GpuWorkerIndex >= 0 &&
+			 GpuWorkerIndex + 1 < gm_slab->nslots)
+		slot = GpuWorkerIndex + 1;
+	else
+		return NULL;	/* thread of other GpuContext */
+
+	return &gm_slab->magazines[(slot * GPUMEM_SLAB_NKINDS +
+								kindnum) * GPUMEM_SLAB_NCLASSES + sclass];
+}
+
+/*
+ * gpuMemFreeSlab
+ */
+static CUresult
+gpuMemFreeSlab(GpuContext *gcontext,
+			   CUdeviceptr m_deviceptr,
+			   GpuMemSegment *gm_page)
+{
+	GpuMemSlabMagazine *gm_mag;
+	GpuMemSlabDepot	*gm_depot;
+	cl_int		kindnum = gm_page->slab_kindnum;
+	cl_int		sclass = gm_page->slab_class;
+
+	Assert(gm_page->gm_kind == GpuMemKind__SlabMemory);
+	Assert(m_deviceptr >= gm_page->m_segment &&
+		   m_deviceptr <  gm_page->m_segment + GPUMEM_SLAB_PAGESZ);
+	pg_atomic_fetch_sub_u32(&gm_page->num_active_chunks, 1);
+
+	gm_mag = gpuMemSlabMagazine(gcontext, kindnum, sclass);
+	if (gm_mag && gm_mag->nitems < GPUMEM_SLAB_MAGAZINESZ)
+	{
+		gm_mag->items[gm_mag->nitems].m_devptr = m_deviceptr;
+		gm_mag->items[gm_mag->nitems].gm_page = gm_page;
+		gm_mag->nitems++;
+		return CUDA_SUCCESS;
+	}
+
+	/* magazine is full, so flush half of them to the depot */
+	gm_depot = &gcontext->gm_slab->depots[kindnum][sclass];
+	pthreadMutexLock(&gm_depot->mutex);
+	while (gm_mag && gm_mag->nitems > GPUMEM_SLAB_MAGAZINESZ / 2)
+	{
+		Assert(gm_depot->nitems < gm_depot->nrooms);
+		gm_depot->items[gm_depot->nitems++] = gm_mag->items[--gm_mag->nitems];
+	}
+	Assert(gm_depot->nitems < gm_depot->nrooms);
+	gm_depot->items[gm_depot->nitems].m_devptr = m_deviceptr;
+	gm_depot->items[gm_depot->nitems].gm_page = gm_page;
+	gm_depot->nitems++;
+	pthreadMutexUnlock(&gm_depot->mutex);
+
+	return CUDA_SUCCESS;
+}
+
 /*
  * gpuMemFreeExtra
  */
@@ -255,6 +494,12 @@ gpuMemFreeExtra(GpuContext *gcontext,
 		return cuMemFree(m_deviceptr);
 	else if (extra == GPUMEM_HOST_RAW_EXTRA)
 		return cuMemFreeHost((void *)m_deviceptr);
+	else if (((GpuMemSegment *)extra)->gm_kind == GpuMemKind__SharedMemory)
+		return gpuMemFreeSharedChunk(gcontext, m_deviceptr,
+									 (GpuMemSegment *)extra);
+	else if (((GpuMemSegment *)extra)->gm_kind == GpuMemKind__SlabMemory)
+		return gpuMemFreeSlab(gcontext, m_deviceptr,
+							  (GpuMemSegment *)extra);
 	return gpuMemFreeChunk(gcontext, m_deviceptr, (GpuMemSegment *)extra);
 }
 
@@ -487,6 +732,44 @@ gpuMemSplitChunk(GpuMemSegment *gm_seg, cl_int mclass)
 	return true;
 }
 
+/*
+ * gpuMemUpdateSegmentStat - update statistics on allocation / release of
+ * a device memory segment
+ */
+static void
+gpuMemUpdateSegmentStat(GpuContext *gcontext, GpuMemKind gm_kind, bool is_alloc)
+{
+	GpuMemStatistics *gm_stat = &gm_stat_array[gcontext->cuda_dindex];
+	pg_atomic_uint64 *usage;
+
+	switch (gm_kind)
+	{
+		case GpuMemKind__NormalMemory:
+			usage = &gm_stat->normal_usage;
+			break;
+		case GpuMemKind__ManagedMemory:
+			usage = &gm_stat->managed_usage;
+			break;
+		case GpuMemKind__IOMapMemory:
+			usage = &gm_stat->iomap_usage;
+			break;
+		default:
+			return;		/* not a device memory */
+	}
+	if (is_alloc)
+	{
+		pg_atomic_add_fetch_u64(usage, gm_segment_sz);
+		pg_atomic_add_fetch_u64(&gcontext->activity->gpumem_usage,
+								gm_segment_sz);
+	}
+	else
+	{
+		pg_atomic_sub_fetch_u64(usage, gm_segment_sz);
+		pg_atomic_sub_fetch_u64(&gcontext->activity->gpumem_usage,
+								gm_segment_sz);
+	}
+}
+
 /*
  * gpuMemAllocChunk
  */
@@ -497,7 +780,6 @@ gpuMemAllocChunk(GpuMemKind gm_kind,
 				 cl_int mclass,
 				 const char *filename, int lineno)
 {
-	GpuMemStatistics *gm_stat;
 	GpuMemSegment  *gm_seg;
 	GpuMemChunk	   *gm_chunk;
 	CUdeviceptr		m_deviceptr;
@@ -703,22 +985,259 @@ retry:
 	dlist_push_head(gm_segment_list, &gm_seg->chain);
 
 	/* update statistics */
-	gm_stat = &gm_stat_array[gcontext->cuda_dindex];
-	switch (gm_kind)
+	gpuMemUpdateSegmentStat(gcontext, gm_kind, true);
+	goto retry;
+}
+
+/*
+ * gpummgrWantDevice - asks GPU memory keeper to set up the device
+ */
+static void
+gpummgrWantDevice(cl_int cuda_dindex)
+{
+	cl_ulong	mask = GPUMEM_KEEPER_DEVICE_BIT(cuda_dindex);
+	Latch	   *keeper;
+
+	if ((pg_atomic_fetch_or_u64(&gmemp_head->devices_wanted,
+								mask) & mask) != 0)
+		return;		/* already requested */
+	keeper = gmemp_head->gmemp_keeper;
+	if (keeper)
+		SetLatch(keeper);
+}
+
+/*
+ * gpuMemAllocSharedChunk - borrow a chunk from the device-wide pool
+ */
+static CUresult
+gpuMemAllocSharedChunk(GpuContext *gcontext,
+					   CUdeviceptr *p_deviceptr,
+					   const char *filename, int lineno)
+{
+	GpuMemSharedPool  *gm_pool;
+	GpuMemSharedChunk *gm_pchunk;
+	GpuMemSegment  *gm_seg = NULL;
+	CUipcMemHandle	m_handle;
+	CUdeviceptr		m_segment;
+	CUdeviceptr		m_deviceptr;
+	cl_uint			pool_generation;
+	cl_int			index;
+	CUresult		rc;
+
+	if (!gm_pool_array)
+		return CUDA_ERROR_OUT_OF_MEMORY;	/* pool is not configured */
+	gm_pool = &gm_pool_array[gcontext->cuda_dindex];
+
+	SpinLockAcquire(&gm_pool->lock);
+	if (!gm_pool->is_ready)
 	{
-		case GpuMemKind__NormalMemory:
-			pg_atomic_add_fetch_u64(&gm_stat->normal_usage, gm_segment_sz);
-			break;
-		case GpuMemKind__ManagedMemory:
-			pg_atomic_add_fetch_u64(&gm_stat->managed_usage, gm_segment_sz);
-			break;
-		case GpuMemKind__IOMapMemory:
-			pg_atomic_add_fetch_u64(&gm_stat->iomap_usage, gm_segment_sz);
-			break;
-		default:
-			break;
+		SpinLockRelease(&gm_pool->lock);
+		/* kicks setup of the pool; private segment is used this time */
+		gpummgrWantDevice(gcontext->cuda_dindex);
+		return CUDA_ERROR_OUT_OF_MEMORY;
 	}
-	goto retry;
+	if (gm_pool->free_head < 0)
+	{
+		SpinLockRelease(&gm_pool->lock);
+		return CUDA_ERROR_OUT_OF_MEMORY;
+	}
+	index = gm_pool->free_head;
+	gm_pchunk = &gm_pool->chunks[index];
+	Assert(gm_pchunk->owner_pid == 0);
+	gm_pool->free_head = gm_pchunk->next_free;
+	gm_pool->nfree--;
+	gm_pchunk->owner_pid = MyProcPid;
+	gm_pchunk->owner_ctx = (uintptr_t) gcontext;
+	gm_pchunk->next_free = -1;
+	pool_generation = gm_pool->generation;
+	memcpy(&m_handle, &gm_pool->m_handle, sizeof(CUipcMemHandle));
+	SpinLockRelease(&gm_pool->lock);
+
+	/*
+	 * Lookup the proxy segment of the current generation, or open the IPC
+	 * handle of the pool if first time.
+	 */
+	pthreadRWLockWriteLock(&gcontext->gm_rwlock);
+	if (!dlist_is_empty(&gcontext->gm_shared_list))
+	{
+		gm_seg = dlist_container(GpuMemSegment, chain,
+								 dlist_head_node(&gcontext->gm_shared_list));
+		if (gm_seg->pool_generation != pool_generation)
+			gm_seg = NULL;
+	}
+
+	if (!gm_seg)
+	{
+		gm_seg = calloc(1, offsetof(GpuMemSegment, gm_chunks));
+		if (!gm_seg)
+		{
+			rc = CUDA_ERROR_OUT_OF_MEMORY;
+			goto error_1;
+		}
+
+		rc = cuCtxPushCurrent(gcontext->cuda_context);
+		if (rc != CUDA_SUCCESS)
+		{
+			wnotice("failed on cuCtxPushCurrent: %s", errorText(rc));
+			goto error_2;
+		}
+		rc = cuIpcOpenMemHandle(&m_segment, m_handle,
+								CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+		cuCtxPopCurrent(NULL);
+		if (rc != CUDA_SUCCESS)
+		{
+			wnotice("failed on cuIpcOpenMemHandle: %s", errorText(rc));
+			goto error_2;
+		}
+		gm_seg->gm_kind			= GpuMemKind__SharedMemory;
+		gm_seg->m_segment		= m_segment;
+		gm_seg->pool_generation	= pool_generation;
+		SpinLockInit(&gm_seg->lock);
+		pg_atomic_init_u32(&gm_seg->num_active_chunks, 0);
+		dlist_push_head(&gcontext->gm_shared_list, &gm_seg->chain);
+	}
+	pg_atomic_fetch_add_u32(&gm_seg->num_active_chunks, 1);
+	pthreadRWLockUnlock(&gcontext->gm_rwlock);
+
+	m_deviceptr = gm_seg->m_segment + (size_t)index * pgstrom_chunk_size();
+	if (!trackGpuMem(gcontext, m_deviceptr, gm_seg,
+					 filename, lineno))
+	{
+		gpuMemFreeSharedChunk(gcontext, m_deviceptr, gm_seg);
+		return CUDA_ERROR_OUT_OF_MEMORY;
+	}
+	*p_deviceptr = m_deviceptr;
+	return CUDA_SUCCESS;
+
+error_2:
+	free(gm_seg);
+error_1:
+	pthreadRWLockUnlock(&gcontext->gm_rwlock);
+	gpuMemPutSharedChunk(gcontext, index, pool_generation);
+	return rc;
+}
+
+/*
+ * gpuMemSlabNewPage - allocation of a new slab page
+ *
+ * NOTE: caller must hold gm_depot->mutex
+ */
+static CUresult
+gpuMemSlabNewPage(GpuContext *gcontext, GpuMemSlabDepot *gm_depot,
+				  cl_int kindnum, cl_int sclass)
+{
+	GpuMemSlabHead *gm_slab = gcontext->gm_slab;
+	GpuMemSegment  *gm_page;
+	GpuMemSlabItem *items;
+	CUdeviceptr		m_segment;
+	size_t			unit_sz = (1UL << (sclass + GPUMEM_SLAB_MIN_BIT));
+	cl_int			i, nobjs = GPUMEM_SLAB_PAGESZ / unit_sz;
+	CUresult		rc;
+
+	/* depot must have enough room to keep all the objects */
+	items = realloc(gm_depot->items, sizeof(GpuMemSlabItem) *
+					(gm_depot->nrooms + nobjs));
+	if (!items)
+		return CUDA_ERROR_OUT_OF_MEMORY;
+	gm_depot->items = items;
+
+	gm_page = calloc(1, offsetof(GpuMemSegment, gm_chunks));
+	if (!gm_page)
+		return CUDA_ERROR_OUT_OF_MEMORY;
+
+	rc = cuCtxPushCurrent(gcontext->cuda_context);
+	if (rc != CUDA_SUCCESS)
+	{
+		free(gm_page);
+		wnotice("failed on cuCtxPushCurrent: %s", errorText(rc));
+		return rc;
+	}
+	if (kindnum == GPUMEM_SLAB_KIND__MANAGED)
+		rc = cuMemAllocManaged(&m_segment, GPUMEM_SLAB_PAGESZ,
+							   CU_MEM_ATTACH_GLOBAL);
+	else
+		rc = cuMemAlloc(&m_segment, GPUMEM_SLAB_PAGESZ);
+	cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+	{
+		free(gm_page);
+		return rc;
+	}
+	gm_page->gm_kind		= GpuMemKind__SlabMemory;
+	gm_page->m_segment		= m_segment;
+	gm_page->slab_kindnum	= kindnum;
+	gm_page->slab_class		= sclass;
+	SpinLockInit(&gm_page->lock);
+	pg_atomic_init_u32(&gm_page->num_active_chunks, 0);
+
+	SpinLockAcquire(&gm_slab->lock);
+	dlist_push_tail(&gm_slab->page_list, &gm_page->chain);
+	SpinLockRelease(&gm_slab->lock);
+
+	gm_depot->nrooms += nobjs;
+	for (i=nobjs-1; i >= 0; i--)
+	{
+		Assert(gm_depot->nitems < gm_depot->nrooms);
+		items[gm_depot->nitems].m_devptr = m_segment + i * unit_sz;
+		items[gm_depot->nitems].gm_page = gm_page;
+		gm_depot->nitems++;
+	}
+	return CUDA_SUCCESS;
+}
+
+/*
+ * gpuMemAllocSlab - allocation of small chunks
+ */
+static CUresult
+gpuMemAllocSlab(GpuContext *gcontext,
+				CUdeviceptr *p_deviceptr,
+				size_t bytesize, cl_int kindnum,
+				const char *filename, int lineno)
+{
+	GpuMemSlabMagazine *gm_mag;
+	GpuMemSlabDepot	*gm_depot;
+	GpuMemSlabItem	item;
+	cl_int		sclass;
+	CUresult	rc;
+
+	Assert(bytesize <= GPUMEM_SLAB_MAX);
+	sclass = Max(get_next_log2(bytesize),
+				 GPUMEM_SLAB_MIN_BIT) - GPUMEM_SLAB_MIN_BIT;
+	gm_mag = gpuMemSlabMagazine(gcontext, kindnum, sclass);
+	if (gm_mag && gm_mag->nitems > 0)
+		item = gm_mag->items[--gm_mag->nitems];
+	else
+	{
+		/* refill the magazine from the depot */
+		gm_depot = &gcontext->gm_slab->depots[kindnum][sclass];
+		pthreadMutexLock(&gm_depot->mutex);
+		if (gm_depot->nitems == 0)
+		{
+			rc = gpuMemSlabNewPage(gcontext, gm_depot, kindnum, sclass);
+			if (rc != CUDA_SUCCESS)
+			{
+				pthreadMutexUnlock(&gm_depot->mutex);
+				return rc;
+			}
+		}
+		Assert(gm_depot->nitems > 0);
+		item = gm_depot->items[--gm_depot->nitems];
+		while (gm_mag &&
+			   gm_depot->nitems > 0 &&
+			   gm_mag->nitems < GPUMEM_SLAB_MAGAZINESZ / 2)
+			gm_mag->items[gm_mag->nitems++] = gm_depot->items[--gm_depot->nitems];
+		pthreadMutexUnlock(&gm_depot->mutex);
+	}
+	pg_atomic_fetch_add_u32(&item.gm_page->num_active_chunks, 1);
+
+	if (!trackGpuMem(gcontext, item.m_devptr, item.gm_page,
+					 filename, lineno))
+	{
+		gpuMemFreeSlab(gcontext, item.m_devptr, item.gm_page);
+		return CUDA_ERROR_OUT_OF_MEMORY;
+	}
+	*p_deviceptr = item.m_devptr;
+	return CUDA_SUCCESS;
 }
 
 /*
@@ -731,15 +1250,31 @@ __gpuMemAlloc(GpuContext *gcontext,
 			  const char *filename, int lineno)
 {
 	cl_int		mclass = get_next_log2(pgstrom_chunk_size());
+	CUresult	rc;
 
 	if (bytesize > pgstrom_chunk_size())
 		return __gpuMemAllocRaw(gcontext,
 								p_deviceptr,
 								bytesize,
 								filename, lineno);
-	return gpuMemAllocChunk(GpuMemKind__NormalMemory,
-							gcontext, p_deviceptr, mclass,
-							filename, lineno);
+	if (bytesize <= GPUMEM_SLAB_MAX && gcontext->gm_slab)
+		return gpuMemAllocSlab(gcontext, p_deviceptr, bytesize,
+							   GPUMEM_SLAB_KIND__NORMAL,
+							   filename, lineno);
+	/* device-wide shared pool first, if any */
+	rc = gpuMemAllocSharedChunk(gcontext, p_deviceptr,
+								filename, lineno);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+		rc = gpuMemAllocChunk(GpuMemKind__NormalMemory,
+							  gcontext, p_deviceptr, mclass,
+							  filename, lineno);
+	/*
+	 * Under the memory pressure, asks all the GpuContexts on the device to
+	 * release their idle segments. Caller shall retry the allocation later.
+	 */
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+		GpuContextRequestReclaimMemory(gcontext);
+	return rc;
 }
 
 /*
@@ -752,13 +1287,17 @@ __gpuMemAllocIOMap(GpuContext *gcontext,
 				   const char *filename, int lineno)
 {
 	cl_int		mclass = get_next_log2(pgstrom_chunk_size());
+	CUresult	rc;
 
 	/* not supported at this moment */
 	if (bytesize > pgstrom_chunk_size())
 		return CUDA_ERROR_INVALID_VALUE;
-	return gpuMemAllocChunk(GpuMemKind__IOMapMemory,
-                            gcontext, p_deviceptr, mclass,
-							filename, lineno);
+	rc = gpuMemAllocChunk(GpuMemKind__IOMapMemory,
+						  gcontext, p_deviceptr, mclass,
+						  filename, lineno);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+		GpuContextRequestReclaimMemory(gcontext);
+	return rc;
 }
 
 /*
@@ -781,11 +1320,80 @@ __gpuMemAllocManaged(GpuContext *gcontext,
 									   bytesize,
 									   flags,
 									   filename, lineno);
+	if (bytesize <= GPUMEM_SLAB_MAX && gcontext->gm_slab)
+		return gpuMemAllocSlab(gcontext, p_deviceptr, bytesize,
+							   GPUMEM_SLAB_KIND__MANAGED,
+							   filename, lineno);
 	return gpuMemAllocChunk(GpuMemKind__ManagedMemory,
 							gcontext, p_deviceptr, mclass,
 							filename, lineno);
 }
 
+/*
+ * gpuMemAdvisePreferDevice
+ *
+ * It advises the driver to keep the managed memory region on the current
+ * device as long as possible, and to map it to the device on eviction
+ * instead of page-faults. The first @read_mostly_sz bytes are also advised
+ * as read-mostly, so they are duplicated rather than migrated on access
+ * from the host or other devices. Hints are just hints; errors are ignored.
+ */
+void
+gpuMemAdvisePreferDevice(GpuContext *gcontext,
+						 CUdeviceptr m_deviceptr,
+						 size_t bytesize,
+						 size_t read_mostly_sz)
+{
+	if (cuCtxPushCurrent(gcontext->cuda_context) != CUDA_SUCCESS)
+		return;
+	if (read_mostly_sz > 0)
+		(void) cuMemAdvise(m_deviceptr,
+						   Min(read_mostly_sz, bytesize),
+						   CU_MEM_ADVISE_SET_READ_MOSTLY,
+						   gcontext->cuda_device);
+	(void) cuMemAdvise(m_deviceptr, bytesize,
+					   CU_MEM_ADVISE_SET_PREFERRED_LOCATION,
+					   gcontext->cuda_device);
+	(void) cuMemAdvise(m_deviceptr, bytesize,
+					   CU_MEM_ADVISE_SET_ACCESSED_BY,
+					   gcontext->cuda_device);
+	cuCtxPopCurrent(NULL);
+}
+
+/*
+ * __gpuMemAllocOversubscribe
+ *
+ * Fallback allocation for large buffers when the device memory is exhausted.
+ * It returns a managed memory region that can exceed the physical device
+ * memory (Pascal or later), advised to stay on the current device.
+ * It returns CUDA_ERROR_OUT_OF_MEMORY if pg_strom.gpu_memory_oversubscribe
+ * is disabled, so caller can handle it as usual.
+ */
+CUresult
+__gpuMemAllocOversubscribe(GpuContext *gcontext,
+						   CUdeviceptr *p_deviceptr,
+						   size_t bytesize,
+						   size_t read_mostly_sz,
+						   const char *filename, int lineno)
+{
+	CUdeviceptr	m_deviceptr;
+	CUresult	rc;
+
+	if (!gpu_memory_oversubscribe)
+		return CUDA_ERROR_OUT_OF_MEMORY;
+	rc = __gpuMemAllocManagedRaw(gcontext,
+								 &m_deviceptr,
+								 bytesize,
+								 CU_MEM_ATTACH_GLOBAL,
+								 filename, lineno);
+	if (rc != CUDA_SUCCESS)
+		return rc;
+	gpuMemAdvisePreferDevice(gcontext, m_deviceptr,
+							 bytesize, read_mostly_sz);
+	*p_deviceptr = m_deviceptr;
+	return CUDA_SUCCESS;
+}
+
 /*
  * __gpuMemAllocHost
  */
@@ -848,6 +1456,8 @@ __gpuMemPreservedRequest(cl_int cuda_dindex,
 	gmemp_req->cuda_dindex = cuda_dindex;
 	gmemp_req->bytesize = bytesize;
 
+	pg_atomic_fetch_or_u64(&gmemp_head->devices_wanted,
+						   GPUMEM_KEEPER_DEVICE_BIT(cuda_dindex));
 	dlist_push_tail(&gmemp_head->gmemp_req_pending_list,
 					&gmemp_req->chain);
 	SetLatch(gmemp_head->gmemp_keeper);
@@ -938,6 +1548,7 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 	dlist_node	   *dnode_i;
 	dlist_node	   *dnode_m;
 	dlist_node	   *dnode_h;
+	dlist_mutable_iter miter;
 	GpuMemSegment  *gm_seg;
 	CUresult		rc;
 
@@ -973,6 +1584,7 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 					werror("failed on cuMemFree: %s", errorText(rc));
 				}
 				dlist_delete(&gm_seg->chain);
+				gpuMemUpdateSegmentStat(gcontext, gm_seg->gm_kind, false);
 				free(gm_seg);
 				break;
 			}
@@ -991,6 +1603,7 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 					werror("failed on cuMemFree: %s", errorText(rc));
 				}
 				dlist_delete(&gm_seg->chain);
+				gpuMemUpdateSegmentStat(gcontext, gm_seg->gm_kind, false);
 				free(gm_seg);
 				break;
 			}
@@ -1009,6 +1622,7 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 					werror("failed on cuMemFree: %s", errorText(rc));
 				}
 				dlist_delete(&gm_seg->chain);
+				gpuMemUpdateSegmentStat(gcontext, gm_seg->gm_kind, false);
 				free(gm_seg);
 			}
 		}
@@ -1030,24 +1644,136 @@ gpuMemReclaimSegment(GpuContext *gcontext)
 			}
 		}
 	}
-	pthreadRWLockUnlock(&gcontext->gm_rwlock);
-}
+
+	/*
+	 * Proxy segments of the older shared pool (only if GPU memory keeper
+	 * was restarted) are no longer needed once all the chunks got released.
+	 */
+	dlist_foreach_modify(miter, &gcontext->gm_shared_list)
+	{
+		gm_seg = dlist_container(GpuMemSegment, chain, miter.cur);
+		Assert(gm_seg->gm_kind == GpuMemKind__SharedMemory);
+		if (miter.cur != dlist_head_node(&gcontext->gm_shared_list) &&
+			pg_atomic_read_u32(&gm_seg->num_active_chunks) == 0)
+		{
+			rc = cuIpcCloseMemHandle(gm_seg->m_segment);
+			if (rc != CUDA_SUCCESS)
+				wnotice("failed on cuIpcCloseMemHandle: %s", errorText(rc));
+			dlist_delete(&gm_seg->chain);
+			free(gm_seg);
+		}
+	}
+	pthreadRWLockUnlock(&gcontext->gm_rwlock);
+}
 
 /*
  * gpuIpcMemCopyToHost / gpuIpcMemCopyFromHost
+ *
+ * If @callback is given, data is transferred chunk by chunk through a pair
+ * of pinned host buffers, instead of a host buffer of the whole length.
+ * The callback fills up (host-to-device) or consumes (device-to-host) the
+ * chunk, and it runs in parallel to the asynchronous DMA of the other
+ * buffer, so the preparation of the next chunk overlaps the data transfer.
  */
+#define GPU_IPC_STREAM_CHUNK_SIZE		(32UL << 20)	/* 32MB */
+
+static void
+__gpuIpcMemCopyStream(CUdeviceptr m_deviceptr,
+					  size_t length,
+					  bool host_to_device,
+					  gpuIpcMemCopyCallback callback,
+					  void *cb_private,
+					  void *hbuf[2],
+					  CUevent events[2],
+					  CUstream stream)
+{
+	size_t		chunk_sz = GPU_IPC_STREAM_CHUNK_SIZE;
+	size_t		curr, next;
+	size_t		nbytes;
+	int			k;
+	CUresult	rc;
+
+	if (host_to_device)
+	{
+		for (curr=0, k=0; curr < length; curr += nbytes, k ^= 1)
+		{
+			nbytes = Min(length - curr, chunk_sz);
+			/* wait for completion of the DMA from the buffer, if any */
+			rc = cuEventSynchronize(events[k]);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuEventSynchronize: %s",
+					 errorText(rc));
+			callback(hbuf[k], curr, nbytes, cb_private);
+
+			rc = cuMemcpyHtoDAsync(m_deviceptr + curr,
+								   hbuf[k], nbytes, stream);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyHtoDAsync: %s",
+					 errorText(rc));
+			rc = cuEventRecord(events[k], stream);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuEventRecord: %s", errorText(rc));
+		}
+	}
+	else
+	{
+		/* kick DMA of the first chunk */
+		nbytes = Min(length, chunk_sz);
+		rc = cuMemcpyDtoHAsync(hbuf[0], m_deviceptr, nbytes, stream);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyDtoHAsync: %s", errorText(rc));
+		rc = cuEventRecord(events[0], stream);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuEventRecord: %s", errorText(rc));
+
+		for (curr=0, k=0; curr < length; curr = next, k ^= 1)
+		{
+			nbytes = Min(length - curr, chunk_sz);
+			next = curr + nbytes;
+			/* kick DMA of the next chunk prior to the callback */
+			if (next < length)
+			{
+				rc = cuMemcpyDtoHAsync(hbuf[k^1], m_deviceptr + next,
+									   Min(length - next, chunk_sz),
+									   stream);
+				if (rc != CUDA_SUCCESS)
+					elog(ERROR, "failed on cuMemcpyDtoHAsync: %s",
+						 errorText(rc));
+				rc = cuEventRecord(events[k^1], stream);
+				if (rc != CUDA_SUCCESS)
+					elog(ERROR, "failed on cuEventRecord: %s",
+						 errorText(rc));
+			}
+			rc = cuEventSynchronize(events[k]);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuEventSynchronize: %s",
+					 errorText(rc));
+			callback(hbuf[k], curr, nbytes, cb_private);
+		}
+	}
+	rc = cuStreamSynchronize(stream);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuStreamSynchronize: %s", errorText(rc));
+}
+
 static void
 __gpuIpcMemCopyCommon(cl_int cuda_dindex,
 					  CUipcMemHandle ipc_mhandle,
 					  size_t offset,
 					  void *hbuffer,
 					  size_t length,
-					  bool host_to_device)
+					  bool host_to_device,
+					  gpuIpcMemCopyCallback callback,
+					  void *cb_private)
 {
 	CUdevice	cuda_device;
 	CUcontext	cuda_context = NULL;
 	CUdeviceptr	m_deviceptr = 0UL;
+	CUstream	stream = NULL;
+	CUevent		events[2] = { NULL, NULL };
+	void	   *hbuf[2] = { NULL, NULL };
 	CUresult	rc;
+	int			k;
 
 	PG_TRY();
 	{
@@ -1076,7 +1802,25 @@ __gpuIpcMemCopyCommon(cl_int cuda_dindex,
 		else if (rc != CUDA_SUCCESS)
 			elog(ERROR, "failed on cuIpcOpenMemHandle: %s", errorText(rc));
 
-		if (host_to_device)
+		if (callback)
+		{
+			rc = cuStreamCreate(&stream, CU_STREAM_NON_BLOCKING);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuStreamCreate: %s", errorText(rc));
+			for (k=0; k < 2; k++)
+			{
+				rc = cuEventCreate(&events[k], CU_EVENT_DISABLE_TIMING);
+				if (rc != CUDA_SUCCESS)
+					elog(ERROR, "failed on cuEventCreate: %s", errorText(rc));
+				rc = cuMemAllocHost(&hbuf[k], GPU_IPC_STREAM_CHUNK_SIZE);
+				if (rc != CUDA_SUCCESS)
+					elog(ERROR, "failed on cuMemAllocHost: %s", errorText(rc));
+			}
+			__gpuIpcMemCopyStream(m_deviceptr + offset, length,
+								  host_to_device, callback, cb_private,
+								  hbuf, events, stream);
+		}
+		else if (host_to_device)
 		{
 			rc = cuMemcpyHtoD(m_deviceptr + offset, hbuffer, length);
 			if (rc != CUDA_SUCCESS)
@@ -1089,6 +1833,7 @@ __gpuIpcMemCopyCommon(cl_int cuda_dindex,
 				elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
 		}
 
+		/* resources are released on cuCtxDestroy(); no need to care */
 		rc = cuIpcCloseMemHandle(m_deviceptr);
 		if (rc != CUDA_SUCCESS)
 			elog(ERROR, "failed on cuIpcCloseMemHandle: %s", errorText(rc));
@@ -1130,7 +1875,7 @@ gpuIpcMemCopyFromHost(cl_int cuda_dindex,
 					  size_t length)
 {
 	__gpuIpcMemCopyCommon(cuda_dindex, ipc_mhandle, offset,
-						  hbuffer, length, true);
+						  hbuffer, length, true, NULL, NULL);
 }
 
 void
@@ -1141,7 +1886,31 @@ gpuIpcMemCopyToHost(void *hbuffer,
 					size_t length)
 {
 	__gpuIpcMemCopyCommon(cuda_dindex, ipc_mhandle, offset,
-						  hbuffer, length, false);
+						  hbuffer, length, false, NULL, NULL);
+}
+
+void
+gpuIpcMemCopyFromHostStream(cl_int cuda_dindex,
+							CUipcMemHandle ipc_mhandle,
+							size_t offset,
+							size_t length,
+							gpuIpcMemCopyCallback callback,
+							void *cb_private)
+{
+	__gpuIpcMemCopyCommon(cuda_dindex, ipc_mhandle, offset,
+						  NULL, length, true, callback, cb_private);
+}
+
+void
+gpuIpcMemCopyToHostStream(cl_int cuda_dindex,
+						  CUipcMemHandle ipc_mhandle,
+						  size_t offset,
+						  size_t length,
+						  gpuIpcMemCopyCallback callback,
+						  void *cb_private)
+{
+	__gpuIpcMemCopyCommon(cuda_dindex, ipc_mhandle, offset,
+						  NULL, length, false, callback, cb_private);
 }
 
 /*
@@ -1150,11 +1919,33 @@ gpuIpcMemCopyToHost(void *hbuffer,
 void
 pgstrom_gpu_mmgr_init_gpucontext(GpuContext *gcontext)
 {
+	GpuMemSlabHead *gm_slab;
+	cl_int		nslots;
+	cl_int		i, j;
+
 	pthreadRWLockInit(&gcontext->gm_rwlock);
 	dlist_init(&gcontext->gm_normal_list);
 	dlist_init(&gcontext->gm_iomap_list);
 	dlist_init(&gcontext->gm_managed_list);
 	dlist_init(&gcontext->gm_hostmem_list);
+	dlist_init(&gcontext->gm_shared_list);
+
+	/* slab allocator for small chunks; buddy allocator serves if none */
+	nslots = 1 + local_max_async_tasks;
+	gm_slab = calloc(1, offsetof(GpuMemSlabHead,
+								 magazines[nslots * GPUMEM_SLAB_NKINDS *
+										   GPUMEM_SLAB_NCLASSES]));
+	if (!gm_slab)
+		return;
+	SpinLockInit(&gm_slab->lock);
+	dlist_init(&gm_slab->page_list);
+	for (i=0; i < GPUMEM_SLAB_NKINDS; i++)
+	{
+		for (j=0; j < GPUMEM_SLAB_NCLASSES; j++)
+			pthreadMutexInit(&gm_slab->depots[i][j].mutex, 0);
+	}
+	gm_slab->nslots = nslots;
+	gcontext->gm_slab = gm_slab;
 }
 
 /*
@@ -1170,6 +1961,7 @@ pgstrom_gpu_mmgr_cleanup_gpucontext(GpuContext *gcontext)
 	GpuMemStatistics *gm_stat = &gm_stat_array[gcontext->cuda_dindex];
 	GpuMemSegment  *gm_seg;
 	dlist_node	   *dnode;
+	cl_int			i;
 
 	Assert(!gcontext->cuda_context);
 
@@ -1203,6 +1995,54 @@ pgstrom_gpu_mmgr_cleanup_gpucontext(GpuContext *gcontext)
 		gm_seg = dlist_container(GpuMemSegment, chain, dnode);
 		free(gm_seg);
 	}
+
+	while (!dlist_is_empty(&gcontext->gm_shared_list))
+	{
+		dnode = dlist_pop_head_node(&gcontext->gm_shared_list);
+		gm_seg = dlist_container(GpuMemSegment, chain, dnode);
+		free(gm_seg);
+	}
+
+	if (gcontext->gm_slab)
+	{
+		GpuMemSlabHead *gm_slab = gcontext->gm_slab;
+
+		while (!dlist_is_empty(&gm_slab->page_list))
+		{
+			dnode = dlist_pop_head_node(&gm_slab->page_list);
+			gm_seg = dlist_container(GpuMemSegment, chain, dnode);
+			free(gm_seg);
+		}
+		for (i=0; i < GPUMEM_SLAB_NKINDS * GPUMEM_SLAB_NCLASSES; i++)
+		{
+			GpuMemSlabDepot *gm_depot = &gm_slab->depots[0][0] + i;
+
+			if (gm_depot->items)
+				free(gm_depot->items);
+		}
+		free(gm_slab);
+		gcontext->gm_slab = NULL;
+	}
+
+	/* back the chunks borrowed from the shared pool, if still owned */
+	if (gm_pool_array)
+	{
+		GpuMemSharedPool *gm_pool = &gm_pool_array[gcontext->cuda_dindex];
+
+		SpinLockAcquire(&gm_pool->lock);
+		if (gm_pool->is_ready)
+		{
+			for (i=0; i < gm_pool->nchunks; i++)
+			{
+				GpuMemSharedChunk *gm_pchunk = &gm_pool->chunks[i];
+
+				if (gm_pchunk->owner_pid == MyProcPid &&
+					gm_pchunk->owner_ctx == (uintptr_t) gcontext)
+					__gpuMemPutSharedChunk(gm_pool, i);
+			}
+		}
+		SpinLockRelease(&gm_pool->lock);
+	}
 }
 
 /*
@@ -1222,13 +2062,144 @@ gpummgrBgWorkerSigTerm(SIGNAL_ARGS)
 	errno = saved_errno;
 }
 
+/*
+ * gpummgrSetupSharedPool - allocation of the device-wide shared pool
+ */
+static void
+gpummgrSetupSharedPool(cl_int cuda_dindex, CUcontext cuda_context)
+{
+	GpuMemSharedPool *gm_pool = &gm_pool_array[cuda_dindex];
+	size_t			pool_sz = (size_t)gm_pool_nchunks * pgstrom_chunk_size();
+	CUdeviceptr		m_segment;
+	CUipcMemHandle	m_handle;
+	CUresult		rc;
+	cl_int			i;
+
+	rc = cuCtxPushCurrent(cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+
+	rc = cuMemAlloc(&m_segment, pool_sz);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(WARNING, "failed on cuMemAlloc(%zu) for GPU%d shared memory pool: %s",
+			 pool_sz, cuda_dindex, errorText(rc));
+		cuCtxPopCurrent(NULL);
+		return;
+	}
+
+	rc = cuIpcGetMemHandle(&m_handle, m_segment);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(WARNING, "failed on cuIpcGetMemHandle: %s", errorText(rc));
+		cuMemFree(m_segment);
+		cuCtxPopCurrent(NULL);
+		return;
+	}
+
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPopCurrent: %s", errorText(rc));
+
+	SpinLockAcquire(&gm_pool->lock);
+	memcpy(&gm_pool->m_handle, &m_handle, sizeof(CUipcMemHandle));
+	gm_pool->generation++;
+	gm_pool->nchunks = gm_pool_nchunks;
+	for (i=0; i < gm_pool->nchunks; i++)
+	{
+		gm_pool->chunks[i].owner_pid = 0;
+		gm_pool->chunks[i].owner_ctx = 0;
+		gm_pool->chunks[i].next_free = (i + 1 < gm_pool->nchunks ? i + 1 : -1);
+	}
+	gm_pool->nfree = gm_pool->nchunks;
+	gm_pool->free_head = 0;
+	gm_pool->is_ready = true;
+	SpinLockRelease(&gm_pool->lock);
+
+	elog(LOG, "GPU%d: shared memory pool of %zuMB is ready",
+		 cuda_dindex, pool_sz >> 20);
+}
+
+/*
+ * gpummgrSweepSharedPool
+ *
+ * It releases the chunks of the shared pool still owned by the processes
+ * already exited without cleanup.
+ */
+static void
+gpummgrSweepSharedPool(cl_int cuda_dindex)
+{
+	GpuMemSharedPool *gm_pool = &gm_pool_array[cuda_dindex];
+	pid_t		owner_pid;
+	bool		released;
+	cl_int		i;
+
+	for (i=0; i < gm_pool->nchunks; i++)
+	{
+		owner_pid = gm_pool->chunks[i].owner_pid;
+		if (owner_pid == 0 ||
+			kill(owner_pid, 0) == 0 || errno != ESRCH)
+			continue;
+
+		released = false;
+		SpinLockAcquire(&gm_pool->lock);
+		if (gm_pool->chunks[i].owner_pid == owner_pid)
+		{
+			__gpuMemPutSharedChunk(gm_pool, i);
+			released = true;
+		}
+		SpinLockRelease(&gm_pool->lock);
+
+		if (released)
+			elog(LOG, "GPU%d: chunk %d of shared memory pool is released, because PID=%d already exited",
+				 cuda_dindex, i, (int)owner_pid);
+	}
+}
+
+/*
+ * gpummgrSetupDevices - creates CUDA context (and the shared pool, if
+ * configured) of the devices wanted by backends, and not set up yet.
+ */
+static void
+gpummgrSetupDevices(CUcontext *cuda_context, bool is_startup)
+{
+	cl_ulong	wanted;
+	CUdevice	cuda_device;
+	CUresult	rc;
+	int			i;
+
+	wanted = pg_atomic_exchange_u64(&gmemp_head->devices_wanted, 0);
+	for (i=0; i < numDevAttrs; i++)
+	{
+		cl_ulong	mask = GPUMEM_KEEPER_DEVICE_BIT(i);
+
+		if (cuda_context[i])
+			continue;	/* already set up */
+		if (mask != 0 ? (wanted & mask) == 0 : !is_startup)
+			continue;
+
+		rc = cuDeviceGet(&cuda_device, devAttrs[i].DEV_ID);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuDeviceGet: %s", errorText(rc));
+
+		rc = cuCtxCreate(&cuda_context[i],
+						 CU_CTX_SCHED_AUTO,
+						 cuda_device);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuCtxCreate: %s", errorText(rc));
+
+		/* device-wide shared pool, if configured */
+		if (gm_pool_array)
+			gpummgrSetupSharedPool(i, cuda_context[i]);
+	}
+}
+
 /*
  * gpummgrBgWorkerMain - main loop for device memory keeper
  */
 void
 gpummgrBgWorkerMain(Datum arg)
 {
-	CUdevice	cuda_device;
 	CUcontext  *cuda_context;
 	CUresult	rc;
 	pg_crc32	crc;
@@ -1249,21 +2220,10 @@ gpummgrBgWorkerMain(Datum arg)
 	if (!cuda_context)
 		elog(ERROR, "out of memory");
 
-	for (i=0; i < numDevAttrs; i++)
-	{
-		rc = cuDeviceGet(&cuda_device, devAttrs[i].DEV_ID);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on cuDeviceGet: %s", errorText(rc));
-
-		rc = cuCtxCreate(&cuda_context[i],
-						 CU_CTX_SCHED_AUTO,
-						 cuda_device);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on cuCtxCreate: %s", errorText(rc));
-	}
-
 	gmemp_head->gmemp_keeper = MyLatch;
 	pg_memory_barrier();
+	/* devices already wanted, and ones out of the bitmap, if any */
+	gpummgrSetupDevices(cuda_context, true);
 
 	/*
 	 * Event loop
@@ -1273,6 +2233,9 @@ gpummgrBgWorkerMain(Datum arg)
 		GpuMemPreserved		   *gmemp = NULL;
 		GpuMemPreservedRequest *gmemp_req;
 
+		/* setup of the devices on demand */
+		gpummgrSetupDevices(cuda_context, false);
+
 		SpinLockAcquire(&gmemp_head->lock);
 		if (dlist_is_empty(&gmemp_head->gmemp_req_pending_list))
 		{
@@ -1291,14 +2254,35 @@ gpummgrBgWorkerMain(Datum arg)
 			ResetLatch(MyLatch);
 			if (ev & WL_POSTMASTER_DEATH)
 				elog(FATAL, "unexpected Postmaster dead");
+			if ((ev & WL_TIMEOUT) != 0 && gm_pool_array)
+			{
+				for (i=0; i < numDevAttrs; i++)
+				{
+					if (cuda_context[i])
+						gpummgrSweepSharedPool(i);
+				}
+			}
 		}
 		else
 		{
 			gmemp_req = dlist_container(GpuMemPreservedRequest, chain,
-				dlist_pop_head_node(&gmemp_head->gmemp_req_pending_list));
-			memset(&gmemp_req->chain, 0, sizeof(dlist_node));
+				dlist_head_node(&gmemp_head->gmemp_req_pending_list));
 			Assert(gmemp_req->cuda_dindex >= 0 &&
 				   gmemp_req->cuda_dindex < numDevAttrs);
+			if (!cuda_context[gmemp_req->cuda_dindex])
+			{
+				/*
+				 * Device shall be set up on the next loop. The bit may be
+				 * already consumed, so mark the device again; otherwise,
+				 * we would spin on this request forever.
+				 */
+				SpinLockRelease(&gmemp_head->lock);
+				pg_atomic_fetch_or_u64(&gmemp_head->devices_wanted,
+						GPUMEM_KEEPER_DEVICE_BIT(gmemp_req->cuda_dindex));
+				continue;
+			}
+			dlist_delete(&gmemp_req->chain);
+			memset(&gmemp_req->chain, 0, sizeof(dlist_node));
 			if (gmemp_req->bytesize > 0)
 			{
 				/* request for alloc */
@@ -1429,6 +2413,17 @@ gpummgrBgWorkerMain(Datum arg)
 			SpinLockRelease(&gmemp_head->lock);
 		}
 	}
+
+	/* shared pool shall be released on exit of the keeper */
+	if (gm_pool_array)
+	{
+		for (i=0; i < numDevAttrs; i++)
+		{
+			SpinLockAcquire(&gm_pool_array[i].lock);
+			gm_pool_array[i].is_ready = false;
+			SpinLockRelease(&gm_pool_array[i].lock);
+		}
+	}
 }
 
 /*
@@ -1564,6 +2559,7 @@ pgstrom_startup_gpu_mmgr(void)
 		elog(ERROR, "Bug? GPU Device Memory for Multi-Processes exists");
 	memset(gmemp_head, 0, required);
 	SpinLockInit(&gmemp_head->lock);
+	pg_atomic_init_u64(&gmemp_head->devices_wanted, 0);
 	dlist_init(&gmemp_head->gmemp_req_pending_list);
 	dlist_init(&gmemp_head->gmemp_req_free_list);
 	for (i=0; i < lengthof(gmemp_head->gmemp_req_array); i++)
@@ -1579,6 +2575,35 @@ pgstrom_startup_gpu_mmgr(void)
 		dlist_push_tail(&gmemp_head->gmemp_free_list,
 						&gmemp_head->gmemp_array[i].chain);
 	}
+
+	/*
+	 * GpuMemSharedPool
+	 */
+	if (gm_pool_nchunks > 0)
+	{
+		char	   *pos;
+
+		required = (STROMALIGN(sizeof(GpuMemSharedPool) * numDevAttrs) +
+					STROMALIGN(sizeof(GpuMemSharedChunk) *
+							   gm_pool_nchunks) * numDevAttrs);
+		gm_pool_array = ShmemInitStruct("GPU Device Memory Shared Pool",
+										required, &found);
+		if (found)
+			elog(ERROR, "Bug? GPU Device Memory Shared Pool exists");
+		memset(gm_pool_array, 0, required);
+		pos = (char *)gm_pool_array +
+			STROMALIGN(sizeof(GpuMemSharedPool) * numDevAttrs);
+		for (i=0; i < numDevAttrs; i++)
+		{
+			GpuMemSharedPool *gm_pool = &gm_pool_array[i];
+
+			SpinLockInit(&gm_pool->lock);
+			gm_pool->is_ready = false;
+			gm_pool->free_head = -1;
+			gm_pool->chunks = (GpuMemSharedChunk *) pos;
+			pos += STROMALIGN(sizeof(GpuMemSharedChunk) * gm_pool_nchunks);
+		}
+	}
 }
 
 /*
@@ -1638,6 +2663,14 @@ pgstrom_init_gpu_mmgr(void)
 							 PGC_SUSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	DefineCustomBoolVariable("pg_strom.gpu_topology_aware",
+							 "Turn on/off GPU selection by PCIe topology of the storage",
+							 NULL,
+							 &nvme_strom_gpu_topology_aware,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 	/*
 	 * MEMO: Threshold of table's physical size to use NVMe-Strom:
 	 *   ((System RAM size) -
@@ -1679,6 +2712,34 @@ pgstrom_init_gpu_mmgr(void)
 							PGC_POSTMASTER,
 							GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 							NULL, NULL, NULL);
+	/* pg_strom.gpu_memory_shared_pool_size */
+	DefineCustomIntVariable("pg_strom.gpu_memory_shared_pool_size",
+							"size of the device memory pool shared by all the backends, per device",
+							NULL,
+							&gpu_memory_shared_pool_size_kb,
+							0,
+							0,
+							INT_MAX,
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+	gm_pool_nchunks = (((size_t)gpu_memory_shared_pool_size_kb << 10) /
+					   pgstrom_chunk_size());
+	if (gpu_memory_shared_pool_size_kb > 0 && gm_pool_nchunks == 0)
+		elog(ERROR, "pg_strom.gpu_memory_shared_pool_size(%dkB) must be larger than pg_strom.chunk_size(%dkB)",
+			 gpu_memory_shared_pool_size_kb,
+			 (int)(pgstrom_chunk_size() >> 10));
+
+	/* pg_strom.gpu_memory_oversubscribe */
+	DefineCustomBoolVariable("pg_strom.gpu_memory_oversubscribe",
+							 "Turn on/off managed memory fallback of large buffers on device memory shortage",
+							 NULL,
+							 &gpu_memory_oversubscribe,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
 	/*
 	 * Background workers per device, to keep device memory for multi-process
 	 */
@@ -1699,6 +2760,10 @@ pgstrom_init_gpu_mmgr(void)
 	required = STROMALIGN(sizeof(GpuMemStatistics) * numDevAttrs) +
 		STROMALIGN(offsetof(GpuMemPreservedHead,
 							gmemp_array[num_preserved_gpu_memory_regions]));
+	if (gm_pool_nchunks > 0)
+		required += (STROMALIGN(sizeof(GpuMemSharedPool) * numDevAttrs) +
+					 STROMALIGN(sizeof(GpuMemSharedChunk) *
+								gm_pool_nchunks) * numDevAttrs);
 	RequestAddinShmemSpace(required);
 	shmem_startup_next = shmem_startup_hook;
 	shmem_startup_hook = pgstrom_startup_gpu_mmgr;
@@ -1732,10 +2797,169 @@ retry:
 }
 
 /*
- * gpuMemCopyFromSSD - kick SSD-to-GPU Direct DMA, then wait for completion
+ * gpuMemCopyFromSSDColumnLookup - position of the chunk in the sorted array
+ */
+static cl_int
+gpuMemCopyFromSSDColumnLookup(BlockNumber *chunk_ids, cl_uint nitems,
+							  BlockNumber chunk_id)
+{
+	cl_int		head = 0;
+	cl_int		tail = nitems - 1;
+
+	while (head <= tail)
+	{
+		cl_int	curr = (head + tail) / 2;
+
+		if (chunk_ids[curr] == chunk_id)
+			return curr;
+		if (chunk_ids[curr] < chunk_id)
+			head = curr + 1;
+		else
+			tail = curr - 1;
+	}
+	werror("nvme-strom: chunk-id %u was not requested", chunk_id);
+	return -1;	/* not reachable */
+}
+
+/*
+ * gpuMemCopyFromSSDColumnAsync - kicks SSD-to-GPU Direct DMA of
+ * KDS_FORMAT_COLUMN loaded from the columnar cache file.
+ *
+ * Column arrays to be read are located at the tail of KDS, as a series of
+ * BLCKSZ chunks of the file (see pgstrom_ccache_load_chunk). The driver
+ * writes back chunks already on the page cache to the host buffer, from
+ * the tail, and packs the chunks loaded from SSD to the head of the
+ * destination, so we have to move them to the right location on the wait.
+ */
+static void
+gpuMemCopyFromSSDColumnAsync(GpuContext *gcontext,
+							 CUdeviceptr m_kds,
+							 GpuMemSegment *gm_seg,
+							 pgstrom_data_store *pds,
+							 NVMEDmaState *dma_state)
+{
+	StromCmd__MemCopySsdToGpu cmd;
+	cl_uint			nchunks = pds->nblocks_uncached;
+	BlockNumber	   *chunk_ids = PDS_CCACHE_CHUNK_IDS(pds);
+	BlockNumber	   *cmd_ids = chunk_ids + nchunks;
+	size_t			head_sz = pds->kds.length - (size_t)BLCKSZ * nchunks;
+	CUresult		rc;
+
+	/* chunk_ids shall be updated by the driver */
+	memcpy(cmd_ids, chunk_ids, sizeof(BlockNumber) * nchunks);
+
+	memset(&cmd, 0, sizeof(StromCmd__MemCopySsdToGpu));
+	cmd.handle		= gm_seg->iomap_handle;
+	cmd.offset		= (m_kds + head_sz - gm_seg->m_segment);
+	cmd.file_desc	= pds->filedesc;
+	cmd.nr_chunks	= nchunks;
+	cmd.chunk_sz	= BLCKSZ;
+	cmd.relseg_sz	= 0;		/* no segment boundary */
+	cmd.chunk_ids	= cmd_ids;
+	cmd.wb_buffer	= (char *)&pds->kds + head_sz;
+
+	/* (1) kick SSD2GPU P2P DMA */
+	if (nvme_strom_ioctl(STROM_IOCTL__MEMCPY_SSD2GPU, &cmd) != 0)
+		werror("failed on STROM_IOCTL__MEMCPY_SSD2GPU: %m");
+	dma_state->is_running = true;
+	dma_state->dma_task_id = cmd.dma_task_id;
+	dma_state->nr_ram2gpu = cmd.nr_ram2gpu;
+	dma_state->nr_ssd2gpu = cmd.nr_ssd2gpu;
+
+	/* (2) kick RAM2GPU DMA of the KDS header */
+	rc = cuMemcpyHtoDAsync(m_kds,
+						   &pds->kds,
+						   head_sz,
+						   CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+	{
+		gpuMemCopyFromSSDWaitRaw(gcontext, cmd.dma_task_id);
+		dma_state->is_running = false;
+		werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+	}
+}
+
+/*
+ * gpuMemCopyFromSSDColumnWait - waits for completion of the DMA kicked by
+ * gpuMemCopyFromSSDColumnAsync, then moves the chunks if needed.
+ */
+static void
+gpuMemCopyFromSSDColumnWait(GpuContext *gcontext,
+							CUdeviceptr m_kds,
+							pgstrom_data_store *pds,
+							NVMEDmaState *dma_state)
+{
+	cl_uint			nchunks = pds->nblocks_uncached;
+	BlockNumber	   *chunk_ids = PDS_CCACHE_CHUNK_IDS(pds);
+	BlockNumber	   *cmd_ids = chunk_ids + nchunks;
+	size_t			head_sz = pds->kds.length - (size_t)BLCKSZ * nchunks;
+	CUdeviceptr		m_base = m_kds + head_sz;
+	char		   *h_base = (char *)&pds->kds + head_sz;
+	cl_int			i, j, k;
+	CUresult		rc;
+
+	/* (3) wait for completion of SSD2GPU P2P DMA */
+	gpuMemCopyFromSSDWaitRaw(gcontext, dma_state->dma_task_id);
+	dma_state->is_running = false;
+
+	/* nothing to do any more, if no chunks were on the page cache */
+	if (dma_state->nr_ram2gpu == 0)
+		return;
+	Assert(dma_state->nr_ssd2gpu + dma_state->nr_ram2gpu == nchunks);
+
+	/*
+	 * (4) move SSD2GPU chunks to the right location. They are packed to
+	 * the head with keeping the order, so we can move them from the tail
+	 * without overwrite of the chunks not moved yet.
+	 */
+	for (i = dma_state->nr_ssd2gpu - 1; i >= 0; i = j)
+	{
+		k = gpuMemCopyFromSSDColumnLookup(chunk_ids, nchunks, cmd_ids[i]);
+		Assert(k >= i);
+		/* merge the neighbor chunks, unless it makes overlap */
+		for (j = i - 1; j >= 0; j--)
+		{
+			if (cmd_ids[j] + 1 != cmd_ids[j+1] ||
+				(k - i) < (i - j + 1))
+				break;
+		}
+		if (k > i)
+		{
+			rc = cuMemcpyDtoDAsync(m_base + (size_t)BLCKSZ * (k - (i - j - 1)),
+								   m_base + (size_t)BLCKSZ * (j + 1),
+								   (size_t)BLCKSZ * (i - j),
+								   CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuMemcpyDtoDAsync: %s", errorText(rc));
+		}
+	}
+
+	/* (5) kick RAM2GPU DMA of the chunks written back */
+	for (i = nchunks - dma_state->nr_ram2gpu; i < nchunks; i = j)
+	{
+		k = gpuMemCopyFromSSDColumnLookup(chunk_ids, nchunks, cmd_ids[i]);
+		for (j = i + 1; j < nchunks; j++)
+		{
+			if (cmd_ids[j] != cmd_ids[j-1] + 1)
+				break;
+		}
+		rc = cuMemcpyHtoDAsync(m_base + (size_t)BLCKSZ * k,
+							   h_base + (size_t)BLCKSZ * i,
+							   (size_t)BLCKSZ * (j - i),
+							   CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+	}
+}
+
+/*
+ * gpuMemCopyFromSSDAsync - kick SSD-to-GPU Direct DMA, but does not wait
+ * for completion. Caller must call gpuMemCopyFromSSDWait() later, prior
+ * to the kernel launch which references the @m_kds.
  */
 void
-gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
+gpuMemCopyFromSSDAsync(CUdeviceptr m_kds, pgstrom_data_store *pds,
+					   NVMEDmaState *dma_state)
 {
 	GpuContext	   *gcontext = GpuWorkerCurrentContext;
 	StromCmd__MemCopySsdToGpu cmd;
@@ -1754,27 +2978,45 @@ gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
 		gm_seg->gm_kind != GpuMemKind__IOMapMemory ||
 		gm_seg->iomap_handle == 0UL)
 		werror("nvme-strom: invalid device pointer");
-	Assert(pds->kds.format == KDS_FORMAT_BLOCK);
 	Assert(m_kds >= gm_seg->m_segment &&
 		   m_kds + pds->kds.length <= gm_seg->m_segment + gm_segment_sz);
+	memset(dma_state, 0, sizeof(NVMEDmaState));
+	dma_state->tv_kicked = GetCurrentTimestamp();
+	if (pds->kds.format == KDS_FORMAT_COLUMN)
+	{
+		gpuMemCopyFromSSDColumnAsync(gcontext, m_kds, gm_seg, pds, dma_state);
+		return;
+	}
+	Assert(pds->kds.format == KDS_FORMAT_BLOCK);
 	offset = m_kds - gm_seg->m_segment;
 
-	/* nothing special if all the blocks are already loaded */
+	/*
+	 * nothing special if all the blocks are already loaded; except for
+	 * the blocks to be copied from the shared buffer by GPU kernel.
+	 */
 	if (pds->nblocks_uncached == 0)
 	{
+		nr_loaded = pds->kds.nitems - pds->nblocks_zcopy;
+		length = (pds->nblocks_zcopy == 0
+				  ? pds->kds.length
+				  : ((char *)KERN_DATA_STORE_BLOCK_PGPAGE(&pds->kds,
+														  nr_loaded) -
+					 (char *)(&pds->kds)));
 		rc = cuMemcpyHtoDAsync(m_kds,
 							   &pds->kds,
-							   pds->kds.length,
+							   length,
 							   CU_STREAM_PER_THREAD);
 		if (rc != CUDA_SUCCESS)
 			werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
 		return;
 	}
-	Assert(pds->nblocks_uncached <= pds->kds.nitems);
+	Assert(pds->nblocks_uncached + pds->nblocks_zcopy <= pds->kds.nitems);
 	nr_loaded = pds->kds.nitems - pds->nblocks_uncached;
-	length = ((char *)KERN_DATA_STORE_BLOCK_PGPAGE(&pds->kds, nr_loaded) -
+	offset += ((char *)KERN_DATA_STORE_BLOCK_PGPAGE(&pds->kds, nr_loaded) -
+			   (char *)(&pds->kds));
+	length = ((char *)KERN_DATA_STORE_BLOCK_PGPAGE(&pds->kds, nr_loaded -
+												   pds->nblocks_zcopy) -
 			  (char *)(&pds->kds));
-	offset += length;
 
 	/* userspace pointers */
 	block_nums = (BlockNumber *)KERN_DATA_STORE_BODY(&pds->kds) + nr_loaded;
@@ -1794,6 +3036,10 @@ gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
 	/* (1) kick SSD2GPU P2P DMA */
 	if (nvme_strom_ioctl(STROM_IOCTL__MEMCPY_SSD2GPU, &cmd) != 0)
 		werror("failed on STROM_IOCTL__MEMCPY_SSD2GPU: %m");
+	dma_state->is_running = true;
+	dma_state->dma_task_id = cmd.dma_task_id;
+	dma_state->nr_ram2gpu = cmd.nr_ram2gpu;
+	dma_state->nr_ssd2gpu = cmd.nr_ssd2gpu;
 
 	/* (2) kick RAM2GPU DMA (earlier half) */
 	rc = cuMemcpyHtoDAsync(m_kds,
@@ -1803,6 +3049,7 @@ gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
 	if (rc != CUDA_SUCCESS)
 	{
 		gpuMemCopyFromSSDWaitRaw(gcontext, cmd.dma_task_id);
+		dma_state->is_running = false;
 		werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
 	}
 
@@ -1820,11 +3067,162 @@ gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
 		if (rc != CUDA_SUCCESS)
 		{
 			gpuMemCopyFromSSDWaitRaw(gcontext, cmd.dma_task_id);
+			dma_state->is_running = false;
 			werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
 		}
 	}
-	/* (4) wait for completion of SSD2GPU P2P DMA */
-	gpuMemCopyFromSSDWaitRaw(gcontext, cmd.dma_task_id);
+}
+
+/*
+ * gpuMemCopyFromSSDWait - wait for completion of SSD-to-GPU Direct DMA
+ * kicked by gpuMemCopyFromSSDAsync
+ */
+void
+gpuMemCopyFromSSDWait(CUdeviceptr m_kds, pgstrom_data_store *pds,
+					  NVMEDmaState *dma_state)
+{
+	GpuContext	   *gcontext = GpuWorkerCurrentContext;
+	TimestampTz		elapsed;
+
+	if (!dma_state->is_running)
+		return;		/* no P2P DMA was kicked */
+	if (pds->kds.format == KDS_FORMAT_COLUMN)
+		gpuMemCopyFromSSDColumnWait(gcontext, m_kds, pds, dma_state);
+	else
+	{
+		/* (4) wait for completion of SSD2GPU P2P DMA */
+		gpuMemCopyFromSSDWaitRaw(gcontext, dma_state->dma_task_id);
+		dma_state->is_running = false;
+	}
+	elapsed = GetCurrentTimestamp() - dma_state->tv_kicked;
+	GpuContextUpdateNvmeStat(gcontext, (double)elapsed, -1.0);
+	pg_atomic_add_fetch_u64(&gcontext->activity->nvme_nbytes,
+							(uint64)dma_state->nr_ssd2gpu * BLCKSZ);
+	pg_atomic_add_fetch_u64(&gcontext->activity->nvme_usec, elapsed);
+}
+
+/*
+ * gpuMemCopyFromSSD - kick SSD-to-GPU Direct DMA, then wait for completion
+ */
+void
+gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds)
+{
+	NVMEDmaState	dma_state;
+
+	gpuMemCopyFromSSDAsync(m_kds, pds, &dma_state);
+	gpuMemCopyFromSSDWait(m_kds, pds, &dma_state);
+}
+
+/*
+ * gpuMemCopyFromMappedColumn - kick RAM-to-GPU DMA of KDS_FORMAT_COLUMN
+ * built on the memory-mapped ccache file
+ *
+ * It sends the header of the device image (@kds_dev), then the referenced
+ * columns from the file image. Columns of the device image are packed in
+ * order of the column index, so a column is followed by the next one.
+ */
+void
+gpuMemCopyFromMappedColumn(CUdeviceptr m_kds, pgstrom_data_store *pds)
+{
+	kern_data_store *kds_dev = pds->kds_dev;
+	size_t		offset;
+	size_t		nbytes;
+	cl_uint		i, j;
+	CUresult	rc;
+
+	Assert(pds->kds.format == KDS_FORMAT_COLUMN && kds_dev != NULL);
+	rc = cuMemcpyHtoDAsync(m_kds,
+						   kds_dev,
+						   KERN_DATA_STORE_HEAD_LENGTH(kds_dev),
+						   CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+
+	for (i=0; i < kds_dev->ncols; i++)
+	{
+		offset = ((size_t)kds_dev->colmeta[i].va_offset
+				  << MAXIMUM_ALIGNOF_SHIFT);
+		if (offset == 0)
+			continue;
+		nbytes = kds_dev->length - offset;
+		for (j=i+1; j < kds_dev->ncols; j++)
+		{
+			if (kds_dev->colmeta[j].va_offset != 0)
+			{
+				nbytes = (((size_t)kds_dev->colmeta[j].va_offset
+						   << MAXIMUM_ALIGNOF_SHIFT) - offset);
+				break;
+			}
+		}
+		rc = cuMemcpyHtoDAsync(m_kds + offset,
+							   (char *)&pds->kds +
+							   ((size_t)pds->kds.colmeta[i].va_offset
+								<< MAXIMUM_ALIGNOF_SHIFT),
+							   nbytes,
+							   CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+	}
+}
+
+/*
+ * gpuMemRegisterSharedBuffers
+ *
+ * It registers the shared buffer as page-locked host memory, to allow GPU
+ * kernels to read the blocks on the shared buffer directly. GpuContext is
+ * created for each query, so registration is done once per process on
+ * the primary context of the device, with CU_MEMHOSTREGISTER_PORTABLE
+ * to make it visible to all the CUDA contexts. The primary context is
+ * retained until process exit.
+ */
+bool
+gpuMemRegisterSharedBuffers(GpuContext *gcontext)
+{
+	static int	shared_buffers_registered = 0;	/* 1:ok, -1:failed */
+	CUcontext	primary_context;
+	long		pagesize;
+	uintptr_t	head;
+	uintptr_t	tail;
+	CUresult	rc;
+
+	if (shared_buffers_registered != 0)
+		return (shared_buffers_registered > 0);
+
+	shared_buffers_registered = -1;
+	pagesize = sysconf(_SC_PAGESIZE);
+	if (pagesize < 0)
+		elog(ERROR, "failed on sysconf(_SC_PAGESIZE): %m");
+	head = TYPEALIGN_DOWN(pagesize, (uintptr_t)BufferBlocks);
+	tail = TYPEALIGN(pagesize, (uintptr_t)BufferBlocks +
+					 (Size)NBuffers * (Size)BLCKSZ);
+
+	rc = cuDevicePrimaryCtxRetain(&primary_context, gcontext->cuda_device);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(LOG, "failed on cuDevicePrimaryCtxRetain: %s", errorText(rc));
+		return false;
+	}
+	rc = cuCtxPushCurrent(primary_context);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(LOG, "failed on cuCtxPushCurrent: %s", errorText(rc));
+		cuDevicePrimaryCtxRelease(gcontext->cuda_device);
+		return false;
+	}
+	rc = cuMemHostRegister((void *)head, tail - head,
+						   CU_MEMHOSTREGISTER_PORTABLE |
+						   CU_MEMHOSTREGISTER_DEVICEMAP);
+	cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(LOG, "failed on cuMemHostRegister of the shared buffer: %s",
+			 errorText(rc));
+		cuDevicePrimaryCtxRelease(gcontext->cuda_device);
+		return false;
+	}
+	shared_buffers_registered = 1;
+
+	return true;
 }
 
 /*
@@ -1834,11 +3232,11 @@ typedef struct
 {
 	Oid		tablespace_oid;
 	bool	nvme_strom_supported;
+	cl_ulong optimal_gpus;	/* bitmap of GPUs closest to the storage */
 } vfs_nvme_status;
 
 static HTAB	   *vfs_nvme_htable = NULL;
-static Oid		nvme_last_tablespace_oid = InvalidOid;
-static bool		nvme_last_tablespace_supported;
+static vfs_nvme_status *nvme_last_tablespace = NULL;
 
 static void
 vfs_nvme_cache_callback(Datum arg, int cacheid, uint32 hashvalue)
@@ -1848,28 +3246,25 @@ vfs_nvme_cache_callback(Datum arg, int cacheid, uint32 hashvalue)
 	{
 		hash_destroy(vfs_nvme_htable);
 		vfs_nvme_htable = NULL;
-		nvme_last_tablespace_oid = InvalidOid;
+		nvme_last_tablespace = NULL;
 	}
 }
 
-static bool
-TablespaceCanUseNvmeStrom(Oid tablespace_oid)
+static vfs_nvme_status *
+TablespaceLookupNvmeStatus(Oid tablespace_oid)
 {
 	vfs_nvme_status *entry;
 	const char *pathname;
 	int			fdesc;
 	bool		found;
 
-	if (!nvme_strom_enabled)
-		return false;	/* NVMe-Strom is not configured or enabled */
-
 	if (!OidIsValid(tablespace_oid))
 		tablespace_oid = MyDatabaseTableSpace;
 
 	/* quick lookup but sufficient for more than 99.99% cases */
-	if (OidIsValid(nvme_last_tablespace_oid) &&
-		nvme_last_tablespace_oid == tablespace_oid)
-		return nvme_last_tablespace_supported;
+	if (nvme_last_tablespace &&
+		nvme_last_tablespace->tablespace_oid == tablespace_oid)
+		return nvme_last_tablespace;
 
 	if (!vfs_nvme_htable)
 	{
@@ -1889,14 +3284,14 @@ TablespaceCanUseNvmeStrom(Oid tablespace_oid)
 											&found);
 	if (found)
 	{
-		nvme_last_tablespace_oid = tablespace_oid;
-		nvme_last_tablespace_supported = entry->nvme_strom_supported;
-		return entry->nvme_strom_supported;
+		nvme_last_tablespace = entry;
+		return entry;
 	}
 
 	/* check whether the tablespace is supported */
 	entry->tablespace_oid = tablespace_oid;
 	entry->nvme_strom_supported = false;
+	entry->optimal_gpus = 0;
 
 	pathname = GetDatabasePath(MyDatabaseId, tablespace_oid);
 	fdesc = open(pathname, O_RDONLY | O_DIRECTORY);
@@ -1911,7 +3306,13 @@ TablespaceCanUseNvmeStrom(Oid tablespace_oid)
 
 		cmd.fdesc = fdesc;
 		if (nvme_strom_ioctl(STROM_IOCTL__CHECK_FILE, &cmd) == 0)
+		{
 			entry->nvme_strom_supported = true;
+			entry->optimal_gpus = GetOptimalGpusForFile(fdesc);
+			elog(DEBUG1, "tablespace \"%s\" is closest to GPUs 0x%lx",
+				 get_tablespace_name(tablespace_oid),
+				 entry->optimal_gpus);
+		}
 		else
 		{
 			ereport(DEBUG1,
@@ -1919,10 +3320,35 @@ TablespaceCanUseNvmeStrom(Oid tablespace_oid)
 					 errmsg("nvme_strom does not support tablespace \"%s\"",
 							get_tablespace_name(tablespace_oid))));
 		}
+		close(fdesc);
 	}
-	nvme_last_tablespace_oid = tablespace_oid;
-	nvme_last_tablespace_supported = entry->nvme_strom_supported;
-	return entry->nvme_strom_supported;
+	nvme_last_tablespace = entry;
+	return entry;
+}
+
+static bool
+TablespaceCanUseNvmeStrom(Oid tablespace_oid)
+{
+	if (!nvme_strom_enabled)
+		return false;	/* NVMe-Strom is not configured or enabled */
+	return TablespaceLookupNvmeStatus(tablespace_oid)->nvme_strom_supported;
+}
+
+/*
+ * DirectoryCanUseNvmeStrom - checks whether files under the directory can
+ * be loaded using SSD-to-GPU Direct DMA
+ */
+bool
+DirectoryCanUseNvmeStrom(int dir_fdesc)
+{
+	StromCmd__CheckFile cmd;
+
+	if (!nvme_strom_enabled)
+		return false;	/* NVMe-Strom is not configured or enabled */
+
+	memset(&cmd, 0, sizeof(StromCmd__CheckFile));
+	cmd.fdesc = dir_fdesc;
+	return (nvme_strom_ioctl(STROM_IOCTL__CHECK_FILE, &cmd) == 0);
 }
 
 bool
@@ -1935,6 +3361,42 @@ RelationCanUseNvmeStrom(Relation relation)
 	return TablespaceCanUseNvmeStrom(tablespace_oid);
 }
 
+/*
+ * RelationGetOptimalGpuDevice - returns the GPU device closest to the
+ * storage of the relation on the PCIe bus, if it can be loaded using
+ * SSD-to-GPU Direct DMA. If multiple GPUs are equally close, backends
+ * and parallel workers are distributed over them. -1 means no preference.
+ */
+int
+RelationGetOptimalGpuDevice(Relation relation)
+{
+	Oid			tablespace_oid = RelationGetForm(relation)->reltablespace;
+	cl_ulong	optimal_gpus;
+	int			i, k, count = 0;
+
+	if (!nvme_strom_gpu_topology_aware ||
+		!RelationCanUseNvmeStrom(relation))
+		return -1;
+	optimal_gpus = TablespaceLookupNvmeStatus(tablespace_oid)->optimal_gpus;
+	for (i=0; i < numDevAttrs; i++)
+	{
+		if ((optimal_gpus & (1UL << i)) != 0)
+			count++;
+	}
+	if (count == 0)
+		return -1;
+
+	k = (IsParallelWorker()
+		 ? ParallelWorkerNumber
+		 : MyProc->pgprocno) % count;
+	for (i=0; i < numDevAttrs; i++)
+	{
+		if ((optimal_gpus & (1UL << i)) != 0 && k-- == 0)
+			return i;
+	}
+	return -1;
+}
+
 /*
  * RelationWillUseNvmeStrom
  */
@@ -16,6 +16,21 @@
  * GNU General Public License for more details.
  */
 #include "pg_strom.h"
+#ifdef WITH_NVTX
+#include <nvToolsExt.h>
+#endif
+
+/* GUC variables */
+bool			pgstrom_enable_nvtx;			/* GUC */
+static bool		pgstrom_async_jit_fallback;		/* GUC */
+static bool		pgstrom_adaptive_chunk_size;	/* GUC */
+static int		pgstrom_min_chunk_size_kb;		/* GUC */
+
+/*
+ * Chunk size grows while the expected kernel time for the next chunk is
+ * shorter than this threshold; per-task fixed cost is not negligible.
+ */
+#define CHUNK_KERNEL_TIME_TARGET_USEC		20000.0
 
 /*
  * construct_kern_parambuf
@@ -182,6 +197,26 @@ construct_kern_parambuf(List *used_params, ExprContext *econtext,
 	return kparams;
 }
 
+/*
+ * gputask_kind_name
+ */
+static const char *
+gputask_kind_name(GpuTaskKind task_kind)
+{
+	switch (task_kind)
+	{
+		case GpuTaskKind_GpuScan:	return "GpuScan";
+		case GpuTaskKind_GpuJoin:	return "GpuJoin";
+		case GpuTaskKind_GpuPreAgg:	return "GpuPreAgg";
+		case GpuTaskKind_GpuSort:	return "GpuSort";
+		case GpuTaskKind_GpuWindow:	return "GpuWindow";
+		case GpuTaskKind_PL_CUDA:	return "PL/CUDA";
+		case GpuTaskKind_RandGen:	return "RandGen";
+		case GpuTaskKind_GpuCopy:	return "GpuCopy";
+		default:					return "GpuTask";
+	}
+}
+
 /*
  * pgstromInitGpuTaskState
  */
@@ -267,11 +302,28 @@ pgstromInitGpuTaskState(GpuTaskState *gts,
 	gts->ccache_refs = ccache_refs;
 	gts->ccache_count = 0;
 	gts->scan_done = false;
+	gts->tuple_bound = -1;			/* set by the caller, if any */
+	gts->tuple_bound_nitems = 0;
+	gts->curr_ref_slot = NULL;
+	gts->curr_ref_values = NULL;
+	gts->curr_ref_isnull = NULL;
 
 	InstrInit(&gts->outer_instrument, estate->es_instrument);
 	gts->scan_overflow = NULL;
 	gts->outer_pds_suspend = NULL;
 	gts->nvme_sstate = NULL;
+	gts->brin_sstate = NULL;
+	gts->prefetch_blknum = InvalidBlockNumber;
+	gts->chunk_size_curr = 0;		/* set on the first chunk */
+	gts->chunk_usec_per_mb = 0.0;
+	gts->gt_rtstat = NULL;			/* set by the caller, if any */
+	gts->kern_names = NULL;
+	gts->nvtx_label = NULL;
+	if (pgstrom_enable_nvtx)
+		gts->nvtx_label = psprintf("%s (query=%u, node=%d)",
+								   gputask_kind_name(task_kind),
+								   estate->es_plannedstmt->queryId,
+								   gts->css.ss.ps.plan->plan_node_id);
 
 	/*
 	 * NOTE: initialization of HeapScanDesc was moved to the first try of
@@ -287,6 +339,305 @@ pgstromInitGpuTaskState(GpuTaskState *gts,
 	gts->pcxt = NULL;
 }
 
+/*
+ * enqueue_pending_gputask
+ *
+ * It links the GpuTask to the pending list of the GpuContext, then wakes
+ * up a worker thread. The task which the backend will wait for next is
+ * put on the head of the list, not to be queued behind the tasks that are
+ * already running ahead; the first task when GTS has nothing in-flight
+ * (time to the first row) and the terminator task.
+ * The caller must hold gcontext->mutex.
+ */
+static void
+enqueue_pending_gputask(GpuTaskState *gts, GpuTask *gtask, bool is_urgent)
+{
+	GpuContext	   *gcontext = gts->gcontext;
+
+	if (is_urgent ||
+		(gts->num_running_tasks == 0 && gts->num_ready_tasks == 0))
+		dlist_push_head(&gcontext->pending_tasks, &gtask->chain);
+	else
+		dlist_push_tail(&gcontext->pending_tasks, &gtask->chain);
+	gts->num_running_tasks++;
+	gtask->tv_enqueue = (gts->css.ss.ps.instrument
+						 ? GetCurrentTimestamp() : 0);
+	GpuContextDispatchTask(gcontext);
+	pthreadCondSignal(gcontext->cond);
+}
+
+/*
+ * pgstromGpuTaskStateChunkSize
+ *
+ * It returns the length of KDS_FORMAT_ROW to be loaded next. The first
+ * chunk is pg_strom.min_chunk_size to reduce the time to the first row,
+ * then the chunk size is doubled until pg_strom.chunk_size, as long as
+ * the GPU kernel is expected to be short enough. It is controlled by
+ * the feedback from worker threads; see pgstromUpdateChunkKernTime().
+ */
+Size
+pgstromGpuTaskStateChunkSize(GpuTaskState *gts)
+{
+	GpuContext *gcontext = gts->gcontext;
+	Size		max_chunk_size = pgstrom_chunk_size();
+	Size		chunk_size;
+	double		usec_per_mb;
+
+	if (!pgstrom_adaptive_chunk_size)
+		return max_chunk_size;
+	if (gts->chunk_size_curr == 0)
+		gts->chunk_size_curr = Min(((Size)pgstrom_min_chunk_size_kb) << 10,
+								   max_chunk_size);
+	chunk_size = gts->chunk_size_curr;
+
+	if (chunk_size < max_chunk_size)
+	{
+		pthreadMutexLock(gcontext->mutex);
+		usec_per_mb = gts->chunk_usec_per_mb;
+		pthreadMutexUnlock(gcontext->mutex);
+
+		/* no feedback yet, or next chunk is also expected to be short */
+		if (usec_per_mb <= 0.0 ||
+			usec_per_mb * (double)(2 * chunk_size) / (double)(1UL << 20)
+			< CHUNK_KERNEL_TIME_TARGET_USEC)
+			gts->chunk_size_curr = Min(2 * chunk_size, max_chunk_size);
+	}
+	return chunk_size;
+}
+
+/*
+ * pgstromUpdateChunkKernTime
+ *
+ * It updates moving average of the GPU kernel time per MB of the chunk.
+ * It is called by worker threads.
+ */
+void
+pgstromUpdateChunkKernTime(GpuTaskState *gts,
+						   Size chunk_size, double kern_usec)
+{
+	GpuContext *gcontext = gts->gcontext;
+	double		usec_per_mb;
+
+	if (chunk_size == 0 || kern_usec < 0.0)
+		return;
+	usec_per_mb = kern_usec * (double)(1UL << 20) / (double)chunk_size;
+
+	pthreadMutexLock(gcontext->mutex);
+	if (gts->chunk_usec_per_mb <= 0.0)
+		gts->chunk_usec_per_mb = usec_per_mb;
+	else
+		gts->chunk_usec_per_mb = (0.8 * gts->chunk_usec_per_mb +
+								  0.2 * usec_per_mb);
+	pthreadMutexUnlock(gcontext->mutex);
+}
+
+/*
+ * Run-time statistics for EXPLAIN ANALYZE
+ *
+ * pgstromStatTimingBegin() records the per-worker event1 on the stream at
+ * the head of the segment to be measured, then pgstromStatDmaSend() or
+ * pgstromStatDmaRecv() records the event0 at the tail, and waits for its
+ * completion. pgstromStatKernelExec() also works like them, or uses the
+ * event0 already synchronized by the caller if !needs_sync.
+ * They are no-op unless EXPLAIN ANALYZE, because the synchronization in
+ * the middle of the task serializes DMA and kernel execution.
+ * Elsewhere, amount of the DMA is always accumulated to the activity of
+ * GpuContext for pgstrom.pg_stat_gpu_activity, by cheap atomic add.
+ */
+static inline GpuTaskRuntimeStat *
+pgstromStatGetRuntimeStat(GpuTaskState *gts)
+{
+	if (!gts->css.ss.ps.instrument)
+		return NULL;
+	return gts->gt_rtstat;
+}
+
+void
+pgstromStatTimingBegin(GpuTaskState *gts)
+{
+	CUresult	rc;
+
+	if (!pgstromStatGetRuntimeStat(gts))
+		return;
+	rc = cuEventRecord(CU_EVENT1_PER_THREAD, CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+}
+
+static uint64
+pgstromStatTimingEnd(bool needs_sync)
+{
+	float		elapsed;
+	CUresult	rc;
+
+	if (needs_sync)
+	{
+		rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventRecord: %s", errorText(rc));
+		rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventSynchronize: %s", errorText(rc));
+	}
+	rc = cuEventElapsedTime(&elapsed,
+							CU_EVENT1_PER_THREAD,
+							CU_EVENT0_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventElapsedTime: %s", errorText(rc));
+
+	return (uint64)(elapsed * 1000.0);
+}
+
+void
+pgstromStatDmaSend(GpuTaskState *gts, size_t nbytes)
+{
+	GpuTaskRuntimeStat *rtstat = pgstromStatGetRuntimeStat(gts);
+
+	pg_atomic_add_fetch_u64(&gts->gcontext->activity->dma_send_nbytes, nbytes);
+	if (!rtstat)
+		return;
+	pg_atomic_add_fetch_u64(&rtstat->dma_send_usec,
+							pgstromStatTimingEnd(true));
+	pg_atomic_add_fetch_u64(&rtstat->dma_send_nbytes, nbytes);
+}
+
+void
+pgstromStatDmaRecv(GpuTaskState *gts, size_t nbytes)
+{
+	GpuTaskRuntimeStat *rtstat = pgstromStatGetRuntimeStat(gts);
+
+	pg_atomic_add_fetch_u64(&gts->gcontext->activity->dma_recv_nbytes, nbytes);
+	if (!rtstat)
+		return;
+	pg_atomic_add_fetch_u64(&rtstat->dma_recv_usec,
+							pgstromStatTimingEnd(true));
+	pg_atomic_add_fetch_u64(&rtstat->dma_recv_nbytes, nbytes);
+}
+
+void
+pgstromStatKernelExec(GpuTaskState *gts, const char *kern_name,
+					  bool needs_sync)
+{
+	GpuTaskRuntimeStat *rtstat = pgstromStatGetRuntimeStat(gts);
+	int			i;
+
+	if (!rtstat || !gts->kern_names)
+		return;
+	for (i=0; i < GPUTASK_RTSTAT_MAX_KERNELS && gts->kern_names[i]; i++)
+	{
+		if (strcmp(kern_name, gts->kern_names[i]) == 0)
+		{
+			pg_atomic_add_fetch_u64(&rtstat->kern_usec[i],
+									pgstromStatTimingEnd(needs_sync));
+			pg_atomic_add_fetch_u64(&rtstat->kern_ncalls[i], 1);
+			break;
+		}
+	}
+}
+
+/*
+ * pgstromStatQueueWait - called by worker thread when it picks up the task
+ */
+void
+pgstromStatQueueWait(GpuTask *gtask)
+{
+	GpuTaskRuntimeStat *rtstat = pgstromStatGetRuntimeStat(gtask->gts);
+
+	if (!rtstat || gtask->tv_enqueue == 0)
+		return;
+	pg_atomic_add_fetch_u64(&rtstat->queue_wait_usec,
+							GetCurrentTimestamp() - gtask->tv_enqueue);
+	gtask->tv_enqueue = 0;
+}
+
+/*
+ * pgstromStatJitBuild - called by worker thread after the lookup of
+ * CUDA module, that may wait for completion of the JIT build
+ */
+void
+pgstromStatJitBuild(GpuTaskState *gts, TimestampTz tv_begin)
+{
+	GpuTaskRuntimeStat *rtstat = pgstromStatGetRuntimeStat(gts);
+
+	if (!rtstat)
+		return;
+	pg_atomic_add_fetch_u64(&rtstat->jit_build_usec,
+							GetCurrentTimestamp() - tv_begin);
+}
+
+/*
+ * NVTX range instrumentation for Nsight Systems
+ *
+ * pgstromNvtxRangeStart() opens a range labeled with the query-id and the
+ * plan node-id, then pgstromNvtxRangeEnd() closes it. We use start/end
+ * ranges, not push/pop, because an error raised in the middle leaves the
+ * range open but does not break the nesting of the later ranges.
+ * They are no-op unless pg_strom.enable_nvtx, or unless PG-Strom is built
+ * with NVTX.
+ */
+uint64
+pgstromNvtxRangeStart(GpuTaskState *gts, const char *event)
+{
+#ifdef WITH_NVTX
+	char		message[256];
+
+	if (!gts->nvtx_label)
+		return 0;
+	snprintf(message, sizeof(message), "%s: %s", gts->nvtx_label, event);
+	return nvtxRangeStartA(message);
+#else
+	return 0;
+#endif
+}
+
+void
+pgstromNvtxRangeEnd(uint64 range_id)
+{
+#ifdef WITH_NVTX
+	if (range_id != 0)
+		nvtxRangeEnd(range_id);
+#endif
+}
+
+/*
+ * cancel_pending_gputasks
+ *
+ * It detaches the tasks of the GTS that are not picked up by the worker
+ * threads yet, and releases them. Tasks already in-flight are not
+ * interrupted; their results are discarded by the rescan/release handler.
+ */
+static void
+cancel_pending_gputasks(GpuTaskState *gts)
+{
+	GpuContext	   *gcontext = gts->gcontext;
+	dlist_head		cancel_tasks;
+	dlist_mutable_iter iter;
+
+	dlist_init(&cancel_tasks);
+	pthreadMutexLock(gcontext->mutex);
+	dlist_foreach_modify(iter, &gcontext->pending_tasks)
+	{
+		GpuTask	   *gtask = dlist_container(GpuTask, chain, iter.cur);
+
+		if (gtask->gts != gts)
+			continue;
+		dlist_delete(&gtask->chain);
+		dlist_push_tail(&cancel_tasks, &gtask->chain);
+		Assert(gts->num_running_tasks > 0);
+		gts->num_running_tasks--;
+		pg_atomic_sub_fetch_u32(&gcontext->activity->num_pending_tasks, 1);
+		GpuContextCompleteTask(gcontext);
+	}
+	pthreadMutexUnlock(gcontext->mutex);
+
+	while (!dlist_is_empty(&cancel_tasks))
+	{
+		dlist_node *dnode = dlist_pop_head_node(&cancel_tasks);
+
+		gts->cb_release_task(dlist_container(GpuTask, chain, dnode));
+	}
+}
+
 /*
  * fetch_next_gputask
  */
@@ -297,36 +648,58 @@ fetch_next_gputask(GpuTaskState *gts)
 	GpuTask		   *gtask;
 	dlist_node	   *dnode;
 	cl_int			local_num_running_tasks;
-	cl_int			global_num_running_tasks;
 	cl_int			ev;
 
 	CHECK_FOR_GPUCONTEXT(gcontext);
 
+restart:
 	pthreadMutexLock(gcontext->mutex);
 	while (!gts->scan_done)
 	{
 		ResetLatch(MyLatch);
 		local_num_running_tasks = (gts->num_ready_tasks +
 								   gts->num_running_tasks);
-		global_num_running_tasks =
-			pg_atomic_read_u32(gcontext->global_num_running_tasks);
 		if ((local_num_running_tasks < local_max_async_tasks &&
-			 global_num_running_tasks < global_max_async_tasks) ||
+			 GpuContextCanDispatchTask(gcontext)) ||
 			(dlist_is_empty(&gts->ready_tasks) &&
 			 gts->num_running_tasks == 0))
 		{
+			uint64		range_id;
+
 			pthreadMutexUnlock(gcontext->mutex);
+			range_id = pgstromNvtxRangeStart(gts, "create task");
 			gtask = gts->cb_next_task(gts);
+			pgstromNvtxRangeEnd(range_id);
 			pthreadMutexLock(gcontext->mutex);
 			if (!gtask)
 			{
 				gts->scan_done = true;
 				break;
 			}
-			dlist_push_tail(&gcontext->pending_tasks, &gtask->chain);
-			gts->num_running_tasks++;
-			pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
-			pthreadCondSignal(gcontext->cond);
+
+			/*
+			 * If GPU program is still under the JIT compile, the task can be
+			 * processed by CPU fallback code instead of the wait for build.
+			 */
+			if (pgstrom_async_jit_fallback &&
+				gts->cb_async_fallback &&
+				!pgstrom_cuda_program_is_ready(gtask->program_id))
+			{
+				bool	fallback;
+
+				pthreadMutexUnlock(gcontext->mutex);
+				fallback = gts->cb_async_fallback(gtask);
+				pthreadMutexLock(gcontext->mutex);
+				if (fallback)
+				{
+					gtask->cpu_fallback = true;
+					dlist_push_tail(&gts->ready_tasks, &gtask->chain);
+					gts->num_ready_tasks++;
+					pthreadMutexUnlock(gcontext->mutex);
+					goto pickup_gputask;
+				}
+			}
+			enqueue_pending_gputask(gts, gtask, false);
 		}
 		else if (!dlist_is_empty(&gts->ready_tasks))
 		{
@@ -388,6 +761,17 @@ retry:
 	while (dlist_is_empty(&gts->ready_tasks))
 	{
 		Assert(gts->num_running_tasks >= 0);
+		/*
+		 * Once the upper node got sufficient rows, we don't need to wait
+		 * for the in-flight tasks; they shall be synchronized at the end
+		 * of the scan, then the results are discarded.
+		 */
+		if (gts->tuple_bound >= 0 &&
+			gts->tuple_bound_nitems >= gts->tuple_bound)
+		{
+			pthreadMutexUnlock(gcontext->mutex);
+			return NULL;
+		}
 		if (gts->num_running_tasks == 0)
 		{
 			pthreadMutexUnlock(gcontext->mutex);
@@ -409,16 +793,16 @@ retry:
 						gts->num_ready_tasks++;
 					}
 					else
-					{
-						dlist_push_tail(&gcontext->pending_tasks,
-										&gtask->chain);
-						gts->num_running_tasks++;
-						pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
-						pthreadCondSignal(gcontext->cond);
-					}
+						enqueue_pending_gputask(gts, gtask, true);
 					goto retry;
 				}
 				pthreadMutexUnlock(gcontext->mutex);
+				/*
+				 * terminator may rewind the scan to run another round,
+				 * like GpuJoin with partitioned inner hash table.
+				 */
+				if (!gts->scan_done)
+					goto restart;
 			}
 			return NULL;
 		}
@@ -454,6 +838,39 @@ pickup_gputask:
 	return gtask;
 }
 
+/*
+ * pgstromNextTupleGpuTask - fetch a tuple from the current task, and also
+ * accumulates time of CPU fallback for EXPLAIN ANALYZE (and NVTX range)
+ */
+static inline TupleTableSlot *
+pgstromNextTupleGpuTask(GpuTaskState *gts)
+{
+	GpuTaskRuntimeStat *rtstat = pgstromStatGetRuntimeStat(gts);
+	TupleTableSlot *slot;
+	instr_time		tv_begin;
+	instr_time		tv_end;
+	uint64			range_id;
+
+	if (!gts->curr_task->cpu_fallback)
+		return gts->cb_next_tuple(gts);
+
+	range_id = pgstromNvtxRangeStart(gts, "CPU fallback");
+	if (!rtstat)
+		slot = gts->cb_next_tuple(gts);
+	else
+	{
+		INSTR_TIME_SET_CURRENT(tv_begin);
+		slot = gts->cb_next_tuple(gts);
+		INSTR_TIME_SET_CURRENT(tv_end);
+		INSTR_TIME_SUBTRACT(tv_end, tv_begin);
+		pg_atomic_add_fetch_u64(&rtstat->cpu_fallback_usec,
+								INSTR_TIME_GET_MICROSEC(tv_end));
+	}
+	pgstromNvtxRangeEnd(range_id);
+
+	return slot;
+}
+
 /*
  * pgstromExecGpuTaskState
  */
@@ -462,13 +879,14 @@ pgstromExecGpuTaskState(GpuTaskState *gts)
 {
 	TupleTableSlot *slot = gts->css.ss.ss_ScanTupleSlot;
 
-	while (!gts->curr_task || !(slot = gts->cb_next_tuple(gts)))
+	while (!gts->curr_task || !(slot = pgstromNextTupleGpuTask(gts)))
 	{
 		GpuTask	   *gtask = gts->curr_task;
 
 		/* release the current GpuTask object that was already scanned */
 		if (gtask)
 		{
+			PDS_restore_slot_reference(gts);
 			gts->cb_release_task(gtask);
 			gts->curr_task = NULL;
 			gts->curr_index = 0;
@@ -486,6 +904,23 @@ pgstromExecGpuTaskState(GpuTaskState *gts)
 		/* notify a new task is assigned */
 		if (gts->cb_switch_task)
 			gts->cb_switch_task(gts, gtask);
+		/*
+		 * If upper node (like LIMIT) will not require rows more than
+		 * the ones we already have, stop launching the next chunks.
+		 */
+		if (gts->tuple_bound >= 0 && gts->cb_task_nitems)
+		{
+			cl_long		nitems = gts->cb_task_nitems(gtask);
+
+			if (nitems > 0)
+				gts->tuple_bound_nitems += nitems;
+			if (!gts->scan_done &&
+				gts->tuple_bound_nitems >= gts->tuple_bound)
+			{
+				gts->scan_done = true;
+				cancel_pending_gputasks(gts);
+			}
+		}
 	}
 	return slot;
 }
@@ -496,6 +931,8 @@ pgstromExecGpuTaskState(GpuTaskState *gts)
 void
 pgstromRescanGpuTaskState(GpuTaskState *gts)
 {
+	gts->tuple_bound_nitems = 0;
+	PDS_restore_slot_reference(gts);
 	/*
 	 * release all the unprocessed tasks
 	 */
@@ -526,6 +963,8 @@ pgstromReleaseGpuTaskState(GpuTaskState *gts)
 		Assert(gts->num_ready_tasks >= 0);
 		gts->cb_release_task(gtask);
 	}
+	/* slot must have its own arrays prior to release */
+	PDS_restore_slot_reference(gts);
 	/* cleanup per-query PDS-scan state, if any */
 	PDS_end_heapscan_state(gts);
 	InstrEndLoop(&gts->outer_instrument);
@@ -539,6 +978,92 @@ pgstromReleaseGpuTaskState(GpuTaskState *gts)
 	PutGpuContext(gts->gcontext);
 }
 
+/*
+ * pgstromExplainGpuTaskRuntimeStat
+ */
+static void
+pgstromExplainGpuTaskRuntimeStat(GpuTaskState *gts, ExplainState *es)
+{
+	GpuTaskRuntimeStat *rtstat = gts->gt_rtstat;
+	uint64		jit_build_usec = pg_atomic_read_u64(&rtstat->jit_build_usec);
+	uint64		queue_wait_usec = pg_atomic_read_u64(&rtstat->queue_wait_usec);
+	uint64		send_nbytes = pg_atomic_read_u64(&rtstat->dma_send_nbytes);
+	uint64		send_usec = pg_atomic_read_u64(&rtstat->dma_send_usec);
+	uint64		recv_nbytes = pg_atomic_read_u64(&rtstat->dma_recv_nbytes);
+	uint64		recv_usec = pg_atomic_read_u64(&rtstat->dma_recv_usec);
+	uint64		fallback_usec = pg_atomic_read_u64(&rtstat->cpu_fallback_usec);
+	int			i;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		if (jit_build_usec > 0)
+			ExplainPropertyText("JIT Build Time",
+								format_millisec((double)jit_build_usec /
+												1000.0), es);
+		if (queue_wait_usec > 0)
+			ExplainPropertyText("Queue Wait Time",
+								format_millisec((double)queue_wait_usec /
+												1000.0), es);
+		if (send_nbytes > 0)
+			ExplainPropertyText("DMA Send",
+								psprintf("%s, time: %s",
+										 format_bytesz(send_nbytes),
+										 format_millisec((double)send_usec /
+														 1000.0)), es);
+		if (recv_nbytes > 0)
+			ExplainPropertyText("DMA Recv",
+								psprintf("%s, time: %s",
+										 format_bytesz(recv_nbytes),
+										 format_millisec((double)recv_usec /
+														 1000.0)), es);
+	}
+	else
+	{
+		ExplainPropertyFloat("JIT Build Time",
+							 (double)jit_build_usec / 1000.0, 3, es);
+		ExplainPropertyFloat("Queue Wait Time",
+							 (double)queue_wait_usec / 1000.0, 3, es);
+		ExplainPropertyLong("DMA Send Bytes", send_nbytes, es);
+		ExplainPropertyFloat("DMA Send Time",
+							 (double)send_usec / 1000.0, 3, es);
+		ExplainPropertyLong("DMA Recv Bytes", recv_nbytes, es);
+		ExplainPropertyFloat("DMA Recv Time",
+							 (double)recv_usec / 1000.0, 3, es);
+	}
+
+	for (i=0; gts->kern_names &&
+			 i < GPUTASK_RTSTAT_MAX_KERNELS &&
+			 gts->kern_names[i]; i++)
+	{
+		uint64	ncalls = pg_atomic_read_u64(&rtstat->kern_ncalls[i]);
+		uint64	kern_usec = pg_atomic_read_u64(&rtstat->kern_usec[i]);
+		char	label[NAMEDATALEN + 20];
+
+		if (ncalls == 0)
+			continue;
+		snprintf(label, sizeof(label), "Kernel %s", gts->kern_names[i]);
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+			ExplainPropertyText(label,
+								psprintf("calls: " UINT64_FORMAT ", time: %s",
+										 ncalls,
+										 format_millisec((double)kern_usec /
+														 1000.0)), es);
+		else
+			ExplainPropertyFloat(label, (double)kern_usec / 1000.0, 3, es);
+	}
+
+	if (fallback_usec > 0 || es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+			ExplainPropertyText("CPU Fallback Time",
+								format_millisec((double)fallback_usec /
+												1000.0), es);
+		else
+			ExplainPropertyFloat("CPU Fallback Time",
+								 (double)fallback_usec / 1000.0, 3, es);
+	}
+}
+
 /*
  * pgstromExplainGpuTaskState
  */
@@ -574,6 +1099,10 @@ pgstromExplainGpuTaskState(GpuTaskState *gts, ExplainState *es)
 	if (es->analyze && gts->num_cpu_fallbacks > 0)
 		ExplainPropertyLong("CPU fallbacks", gts->num_cpu_fallbacks, es);
 
+	/* Breakdown of the GPU task time, if any */
+	if (es->analyze && gts->gt_rtstat)
+		pgstromExplainGpuTaskRuntimeStat(gts, es);
+
 	/* Source path of the GPU kernel */
 	if (es->verbose &&
 		gts->program_id != INVALID_PROGRAM_ID &&
@@ -599,6 +1128,7 @@ pgstromInitGpuTask(GpuTaskState *gts, GpuTask *gtask)
 	gtask->program_id   = gts->program_id;
 	gtask->gts          = gts;
 	gtask->cpu_fallback = false;
+	gtask->tv_enqueue   = 0;
 }
 
 
@@ -766,5 +1296,42 @@ pgstromExplainOuterScan(GpuTaskState *gts,
 void
 pgstrom_init_gputasks(void)
 {
-	/* nothing to do */
+	/* pg_strom.async_jit_fallback */
+	DefineCustomBoolVariable("pg_strom.async_jit_fallback",
+							 "Runs CPU fallback code while GPU program is built",
+							 NULL,
+							 &pgstrom_async_jit_fallback,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.adaptive_chunk_size */
+	DefineCustomBoolVariable("pg_strom.adaptive_chunk_size",
+							 "Adjusts chunk size according to the GPU kernel time",
+							 NULL,
+							 &pgstrom_adaptive_chunk_size,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.enable_nvtx */
+	DefineCustomBoolVariable("pg_strom.enable_nvtx",
+							 "Emits NVTX ranges for Nsight Systems profiling",
+							 NULL,
+							 &pgstrom_enable_nvtx,
+							 false,
+							 PGC_SUSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.min_chunk_size */
+	DefineCustomIntVariable("pg_strom.min_chunk_size",
+							"Initial chunk size when adaptive chunk size is enabled",
+							NULL,
+							&pgstrom_min_chunk_size_kb,
+							4096,
+							256,
+							65534,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
 }
@@ -0,0 +1,991 @@
+/*
+ * gpucopy.c
+ *
+ * GPU accelerated data loading from CSV files.
+ * ----
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "postgres.h"
+#include "access/heapam.h"
+#include "mb/pg_wchar.h"
+#include "storage/fd.h"
+#include "utils/acl.h"
+#include "pg_strom.h"
+#include "cuda_gpucopy.h"
+
+/*
+ * gpucopyState - state of pgstrom.copy_gpu(); a dummy GpuTaskState to run
+ * the parser on the GpuContext worker, like pgstrom.random_fill().
+ */
+typedef struct
+{
+	GpuTaskState	gts;
+	Relation		rel;
+	const char	   *filename;
+	FILE		   *filp;
+	bool			file_eof;
+	bool			skip_header;
+	cl_char			delimiter;
+	int				ncols;		/* number of non-dropped columns */
+	int			   *attidx;		/* index of the attributes */
+	FmgrInfo	   *in_functions;
+	Oid			   *typioparams;
+	char		   *pending;	/* remaining bytes after the last LF */
+	size_t			pending_len;
+	size_t			buffer_sz;	/* capacity of the text buffer */
+	/* tasks are written out in the order of the file */
+	cl_uint			task_seq;
+	cl_uint			emit_seq;
+	List		   *pending_tasks;
+	/* current position for error messages */
+	cl_ulong		lineno;
+	const char	   *line_buf;
+	cl_uint			line_len;
+} gpucopyState;
+
+/*
+ * gpucopyTask - a chunk of the CSV lines
+ */
+typedef struct
+{
+	GpuTask			task;
+	cl_uint			seq_no;
+	CUdeviceptr		m_results;	/* managed memory by the worker */
+	kern_gpucopy	kern;		/* must be last; followed by the text */
+} gpucopyTask;
+
+/* number of tuples per heap_multi_insert(), same as COPY FROM */
+#define GPUCOPY_INSERT_BATCHSZ		1000
+
+Datum pgstrom_copy_gpu(PG_FUNCTION_ARGS);
+
+/*
+ * gpucopy_column_kind - what GPU can parse on the column
+ */
+static cl_char
+gpucopy_column_kind(Form_pg_attribute attr, cl_char *p_unitsz)
+{
+	switch (attr->atttypid)
+	{
+		case BOOLOID:
+			*p_unitsz = sizeof(cl_bool);
+			return GPUCOPY_KIND__BOOL;
+		case INT2OID:
+			*p_unitsz = sizeof(cl_short);
+			return GPUCOPY_KIND__INT2;
+		case INT4OID:
+			*p_unitsz = sizeof(cl_int);
+			return GPUCOPY_KIND__INT4;
+		case INT8OID:
+			*p_unitsz = sizeof(cl_long);
+			return GPUCOPY_KIND__INT8;
+		case FLOAT4OID:
+			*p_unitsz = sizeof(cl_float);
+			return GPUCOPY_KIND__FLOAT4;
+		case FLOAT8OID:
+			*p_unitsz = sizeof(cl_double);
+			return GPUCOPY_KIND__FLOAT8;
+		case DATEOID:
+			*p_unitsz = sizeof(cl_int);
+			return GPUCOPY_KIND__DATE;
+		case TIMESTAMPOID:
+			/*
+			 * TIMESTAMPTZ depends on the TimeZone, so CPU parses it.
+			 * Also, CPU rounds off the fraction by the typmod, if any.
+			 */
+			if (attr->atttypmod >= 0)
+				break;
+			*p_unitsz = sizeof(cl_long);
+			return GPUCOPY_KIND__TIMESTAMP;
+		default:
+			break;
+	}
+	*p_unitsz = sizeof(kern_copyfield);
+	return GPUCOPY_KIND__CPU;
+}
+
+/*
+ * gpucopy_check_quoted_newline
+ *
+ * CSV allows LF in the quoted field, however, GPU splits the lines on every
+ * LF in the chunk. So, we reject such a file explicitly, rather than
+ * loading the broken rows.
+ */
+static void
+gpucopy_check_quoted_newline(gpucopyState *gcs, const char *buffer,
+							 size_t length)
+{
+	const char *pos;
+	const char *end = buffer + length;
+	bool		in_quote = false;
+
+	/* quick check; most of chunks have no quoted fields */
+	if (!memchr(buffer, '"', length))
+		return;
+	for (pos = buffer; pos < end; pos++)
+	{
+		if (*pos == '"')
+			in_quote = !in_quote;	/* "" in the quoted field toggles twice */
+		else if (*pos == '\n' && in_quote)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("pgstrom.copy_gpu does not support newline in the quoted field of \"%s\"",
+							gcs->filename),
+					 errhint("Use COPY FROM instead.")));
+	}
+}
+
+/*
+ * gpucopy_read_chunk - reads the file up to the last LF in the buffer
+ */
+static size_t
+gpucopy_read_chunk(gpucopyState *gcs, char *buffer)
+{
+	size_t		length = gcs->pending_len;
+	size_t		nbytes;
+	char	   *pos;
+
+	memcpy(buffer, gcs->pending, gcs->pending_len);
+	gcs->pending_len = 0;
+	while (!gcs->file_eof && length < gcs->buffer_sz)
+	{
+		nbytes = fread(buffer + length, 1, gcs->buffer_sz - length,
+					   gcs->filp);
+		if (ferror(gcs->filp))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from file \"%s\": %m",
+							gcs->filename)));
+		if (nbytes == 0)
+			gcs->file_eof = true;
+		length += nbytes;
+
+		if (gcs->skip_header)
+		{
+			pos = memchr(buffer, '\n', length);
+			if (!pos)
+			{
+				if (gcs->file_eof)
+					length = 0;
+				continue;
+			}
+			length -= (pos + 1 - buffer);
+			memmove(buffer, pos + 1, length);
+			gcs->skip_header = false;
+		}
+	}
+	if (length == 0)
+		return 0;
+	gpucopy_check_quoted_newline(gcs, buffer, length);
+
+	/* remaining bytes after the last LF shall be loaded on the next */
+	for (pos = buffer + length - 1; pos >= buffer && *pos != '\n'; pos--);
+	if (pos < buffer)
+	{
+		if (!gcs->file_eof)
+			ereport(ERROR,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("line of \"%s\" is longer than the chunk size",
+							gcs->filename)));
+		/* the last line without LF; a room for LF is reserved */
+		buffer[length++] = '\n';
+	}
+	else if (pos < buffer + length - 1)
+	{
+		if (!gcs->file_eof)
+		{
+			gcs->pending_len = buffer + length - (pos + 1);
+			memcpy(gcs->pending, pos + 1, gcs->pending_len);
+			length = pos + 1 - buffer;
+		}
+		else
+		{
+			/* the last line without LF */
+			buffer[length++] = '\n';
+		}
+	}
+	return length;
+}
+
+/*
+ * gpucopy_next_task
+ */
+static GpuTask *
+gpucopy_next_task(GpuTaskState *gts)
+{
+	gpucopyState   *gcs = (gpucopyState *) gts;
+	gpucopyTask	   *gctask;
+	size_t			head_sz = KERN_GPUCOPY_HEAD_LENGTH(gcs->ncols);
+	size_t			length;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+	int				j;
+
+	if (gcs->file_eof && gcs->pending_len == 0)
+		return NULL;
+
+	/* one more byte for LF at the last line */
+	rc = gpuMemAllocManaged(gts->gcontext,
+							&m_deviceptr,
+							offsetof(gpucopyTask, kern) +
+							head_sz + gcs->buffer_sz + 1,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	gctask = (gpucopyTask *) m_deviceptr;
+
+	length = gpucopy_read_chunk(gcs, (char *)&gctask->kern + head_sz);
+	if (length == 0)
+	{
+		gpuMemFree(gts->gcontext, m_deviceptr);
+		return NULL;
+	}
+	memset(gctask, 0, offsetof(gpucopyTask, kern) + head_sz);
+	pgstromInitGpuTask(gts, &gctask->task);
+	gctask->seq_no = gcs->task_seq++;
+	gctask->kern.length = length;
+	gctask->kern.ncols = gcs->ncols;
+	gctask->kern.delimiter = gcs->delimiter;
+	for (j=0; j < gcs->ncols; j++)
+	{
+		Form_pg_attribute attr = RelationGetDescr(gcs->rel)->attrs[gcs->attidx[j]];
+		cl_char		unitsz;
+
+		gctask->kern.colmeta[j].kind = gpucopy_column_kind(attr, &unitsz);
+		gctask->kern.colmeta[j].unitsz = unitsz;
+	}
+	return &gctask->task;
+}
+
+/*
+ * gpucopy_process_task - runs on the GpuContext worker
+ *
+ * It counts the lines in the chunk, then allocates the results buffer
+ * for them, and kicks the kernels to find out the lines and parse them.
+ */
+static int
+gpucopy_process_task(GpuTask *gtask, CUmodule cuda_module)
+{
+	GpuContext	   *gcontext = GpuWorkerCurrentContext;
+	gpucopyTask	   *gctask = (gpucopyTask *) gtask;
+	kern_gpucopy   *kcopy = &gctask->kern;
+	CUfunction		kern_count_lines;
+	CUfunction		kern_find_lines;
+	CUfunction		kern_parse_lines;
+	CUdeviceptr		m_kcopy = (CUdeviceptr) kcopy;
+	CUdeviceptr		m_blocks = 0UL;
+	CUdeviceptr		m_results = 0UL;
+	CUdeviceptr		m_line_end;
+	cl_uint		   *block_nlines;
+	cl_uint			nblocks;
+	cl_uint			nitems;
+	size_t			grid_sz;
+	size_t			block_sz;
+	size_t			length;
+	void		   *kern_args[3];
+	cl_uint			i, j;
+	CUresult		rc;
+
+	rc = cuModuleGetFunction(&kern_count_lines, cuda_module,
+							 "gpucopy_count_lines");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_find_lines, cuda_module,
+							 "gpucopy_find_lines");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_parse_lines, cuda_module,
+							 "gpucopy_parse_lines");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	/* number of lines for each block */
+	rc = gpuOptimalBlockSize(NULL,
+							 &block_sz,
+							 kern_find_lines,
+							 0,
+							 0, sizeof(cl_uint));
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	length = block_sz * GPUCOPY_BYTES_PER_THREAD;
+	nblocks = (kcopy->length + length - 1) / length;
+	rc = gpuMemAllocManaged(gcontext,
+							&m_blocks,
+							sizeof(cl_uint) * nblocks,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+		goto out_of_resource;
+	else if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	block_nlines = (cl_uint *) m_blocks;
+
+	STROM_TRY();
+	{
+		rc = cuMemPrefetchAsync(m_kcopy,
+								KERN_GPUCOPY_LENGTH(kcopy),
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		pgstromStatDmaSend(gtask->gts, KERN_GPUCOPY_LENGTH(kcopy));
+
+		/*
+		 * KERNEL_FUNCTION(void)
+		 * gpucopy_count_lines(kern_gpucopy *kcopy,
+		 *                     cl_uint *block_nlines)
+		 */
+		kern_args[0] = &m_kcopy;
+		kern_args[1] = &m_blocks;
+		rc = cuLaunchKernel(kern_count_lines,
+							nblocks, 1, 1,
+							block_sz, 1, 1,
+							0,
+							CU_STREAM_PER_THREAD,
+							kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuLaunchKernel: %s", errorText(rc));
+		rc = cuMemPrefetchAsync(m_blocks,
+								sizeof(cl_uint) * nblocks,
+								CU_DEVICE_CPU,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		rc = cuStreamSynchronize(CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuStreamSynchronize: %s", errorText(rc));
+
+	}
+	STROM_CATCH();
+	{
+		gpuMemFree(gcontext, m_blocks);
+		STROM_RE_THROW();
+	}
+	STROM_END_TRY();
+
+	/* block_nlines[] becomes the index of the first line in the block */
+	for (i=0, nitems=0; i < nblocks; i++)
+	{
+		cl_uint		count = block_nlines[i];
+
+		block_nlines[i] = nitems;
+		nitems += count;
+	}
+	Assert(nitems > 0);
+	kcopy->nitems = nitems;
+
+	/* results buffer */
+	length = STROMALIGN(sizeof(cl_uint) * nitems);
+	for (j=0; j < kcopy->ncols; j++)
+	{
+		kern_copycolumn *cmeta = &kcopy->colmeta[j];
+
+		cmeta->values_offset = length;
+		length += STROMALIGN(cmeta->unitsz * nitems);
+		cmeta->nullmap_offset = length;
+		length += STROMALIGN(BITMAPLEN(nitems));
+	}
+	kcopy->row_flags_offset = length;
+	length += STROMALIGN(sizeof(cl_char) * nitems);
+
+	rc = gpuMemAllocManaged(gcontext,
+							&m_results,
+							length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+	{
+		gpuMemFree(gcontext, m_blocks);
+		goto out_of_resource;
+	}
+	else if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	m_line_end = m_results;
+
+	STROM_TRY();
+	{
+		rc = cuMemPrefetchAsync(m_kcopy,
+								KERN_GPUCOPY_HEAD_LENGTH(kcopy->ncols),
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		rc = cuMemPrefetchAsync(m_blocks,
+								sizeof(cl_uint) * nblocks,
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		/* nullmap bits shall be set by the kernel, if not null */
+		rc = cuMemsetD8Async(m_results, 0, length, CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemsetD8Async: %s", errorText(rc));
+
+		/*
+		 * KERNEL_FUNCTION(void)
+		 * gpucopy_find_lines(kern_gpucopy *kcopy,
+		 *                    cl_uint *block_base,
+		 *                    cl_uint *line_end)
+		 */
+		kern_args[0] = &m_kcopy;
+		kern_args[1] = &m_blocks;
+		kern_args[2] = &m_line_end;
+		rc = cuLaunchKernel(kern_find_lines,
+							nblocks, 1, 1,
+							block_sz, 1, 1,
+							sizeof(cl_uint) * block_sz,
+							CU_STREAM_PER_THREAD,
+							kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuLaunchKernel: %s", errorText(rc));
+
+		/*
+		 * KERNEL_FUNCTION(void)
+		 * gpucopy_parse_lines(kern_gpucopy *kcopy,
+		 *                     cl_uint *line_end,
+		 *                     char *results)
+		 */
+		rc = gpuOptimalBlockSize(&grid_sz,
+								 &block_sz,
+								 kern_parse_lines,
+								 nitems,
+								 0, 0);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+		kern_args[0] = &m_kcopy;
+		kern_args[1] = &m_line_end;
+		kern_args[2] = &m_results;
+		rc = cuLaunchKernel(kern_parse_lines,
+							grid_sz, 1, 1,
+							block_sz, 1, 1,
+							0,
+							CU_STREAM_PER_THREAD,
+							kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuLaunchKernel: %s", errorText(rc));
+
+		/* write back the results */
+		rc = cuMemPrefetchAsync(m_results,
+								length,
+								CU_DEVICE_CPU,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		rc = cuMemPrefetchAsync(m_kcopy,
+								KERN_GPUCOPY_LENGTH(kcopy),
+								CU_DEVICE_CPU,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+		rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventRecord: %s", errorText(rc));
+
+		/* Point of synchronization */
+		rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventSynchronize: %s", errorText(rc));
+		pgstromStatDmaRecv(gtask->gts, length);
+	}
+	STROM_CATCH();
+	{
+		gpuMemFree(gcontext, m_blocks);
+		gpuMemFree(gcontext, m_results);
+		STROM_RE_THROW();
+	}
+	STROM_END_TRY();
+	gpuMemFree(gcontext, m_blocks);
+
+	gctask->m_results = m_results;
+	gctask->task.kerror = kcopy->kerror;
+	return 0;
+
+out_of_resource:
+	wnotice("pgstrom.copy_gpu: out of resource");
+	return 100001;
+}
+
+/*
+ * gpucopy_release_task
+ */
+static void
+gpucopy_release_task(GpuTask *gtask)
+{
+	gpucopyTask	   *gctask = (gpucopyTask *) gtask;
+	GpuContext	   *gcontext = gtask->gts->gcontext;
+
+	if (gctask->m_results)
+		gpuMemFree(gcontext, gctask->m_results);
+	gpuMemFree(gcontext, (CUdeviceptr)gctask);
+}
+
+/*
+ * gpucopy_error_callback - error context of pgstrom.copy_gpu()
+ */
+static void
+gpucopy_error_callback(void *arg)
+{
+	gpucopyState   *gcs = (gpucopyState *) arg;
+
+	if (gcs->line_buf)
+		errcontext("pgstrom.copy_gpu %s, line %lu: \"%s\"",
+				   RelationGetRelationName(gcs->rel),
+				   (unsigned long) gcs->lineno,
+				   pnstrdup(gcs->line_buf, Min(gcs->line_len, 100)));
+}
+
+/*
+ * gpucopy_input_field - calls the input function of the column
+ */
+static Datum
+gpucopy_input_field(gpucopyState *gcs, int j,
+					const char *field, cl_uint len, bool escaped)
+{
+	Form_pg_attribute attr = RelationGetDescr(gcs->rel)->attrs[gcs->attidx[j]];
+	char	   *str = palloc(len + 1);
+	cl_uint		i, k;
+
+	if (!escaped)
+		memcpy(str, field, len);
+	else
+	{
+		/* "" in the quoted field means a quote */
+		for (i=0, k=0; i < len; i++)
+		{
+			str[k++] = field[i];
+			if (field[i] == '"')
+				i++;
+		}
+		len = k;
+	}
+	str[len] = '\0';
+	pg_verifymbstr(str, len, false);
+
+	return InputFunctionCall(&gcs->in_functions[j], str,
+							 gcs->typioparams[j], attr->atttypmod);
+}
+
+/*
+ * gpucopy_parse_line - CPU version of the line parser, for the lines GPU
+ * could not parse. It raises an error for the broken lines.
+ */
+static void
+gpucopy_parse_line(gpucopyState *gcs, const char *line, cl_uint len,
+				   Datum *values, bool *isnull)
+{
+	cl_uint		pos = 0;
+	cl_uint		head;
+	cl_uint		flen;
+	bool		quoted;
+	bool		escaped;
+	int			j;
+
+	for (j=0; j < gcs->ncols; j++)
+	{
+		int		anum = gcs->attidx[j];
+
+		quoted = escaped = false;
+		if (pos < len && line[pos] == '"')
+		{
+			quoted = true;
+			head = ++pos;
+			for (;;)
+			{
+				if (pos >= len)
+					ereport(ERROR,
+							(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+							 errmsg("unterminated CSV quoted field")));
+				if (line[pos] == '"')
+				{
+					if (pos + 1 < len && line[pos + 1] == '"')
+					{
+						escaped = true;
+						pos += 2;
+						continue;
+					}
+					break;
+				}
+				pos++;
+			}
+			flen = pos - head;
+			pos++;
+			if (pos < len && line[pos] != gcs->delimiter)
+				ereport(ERROR,
+						(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+						 errmsg("extra data after the closing quote")));
+		}
+		else
+		{
+			head = pos;
+			while (pos < len && line[pos] != gcs->delimiter)
+			{
+				if (line[pos] == '"')
+					ereport(ERROR,
+							(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+							 errmsg("unexpected quote in the unquoted field")));
+				pos++;
+			}
+			flen = pos - head;
+		}
+
+		if (!quoted && flen == 0)
+		{
+			values[anum] = 0;
+			isnull[anum] = true;
+		}
+		else
+		{
+			values[anum] = gpucopy_input_field(gcs, j, line + head,
+											   flen, escaped);
+			isnull[anum] = false;
+		}
+
+		if (j + 1 < gcs->ncols)
+		{
+			if (pos >= len)
+				ereport(ERROR,
+						(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+						 errmsg("missing data for column \"%s\"",
+								NameStr(RelationGetDescr(gcs->rel)->attrs[gcs->attidx[j+1]]->attname))));
+			pos++;
+		}
+		else if (pos != len)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("extra data after last expected column")));
+	}
+}
+
+/*
+ * gpucopy_fetch_row - builds a row from the results of GPU
+ */
+static void
+gpucopy_fetch_row(gpucopyState *gcs, kern_gpucopy *kcopy, char *results,
+				  cl_uint index, Datum *values, bool *isnull)
+{
+	const char *text = KERN_GPUCOPY_TEXT(kcopy);
+	int			j;
+
+	for (j=0; j < kcopy->ncols; j++)
+	{
+		kern_copycolumn *cmeta = &kcopy->colmeta[j];
+		char	   *addr = results + cmeta->values_offset;
+		cl_uint	   *nullmap = (cl_uint *)(results + cmeta->nullmap_offset);
+		int			anum = gcs->attidx[j];
+
+		if ((nullmap[index / 32] & (1U << (index % 32))) == 0)
+		{
+			values[anum] = 0;
+			isnull[anum] = true;
+			continue;
+		}
+		isnull[anum] = false;
+		switch (cmeta->kind)
+		{
+			case GPUCOPY_KIND__BOOL:
+				values[anum] = BoolGetDatum(((cl_bool *)addr)[index]);
+				break;
+			case GPUCOPY_KIND__INT2:
+				values[anum] = Int16GetDatum(((cl_short *)addr)[index]);
+				break;
+			case GPUCOPY_KIND__INT4:
+				values[anum] = Int32GetDatum(((cl_int *)addr)[index]);
+				break;
+			case GPUCOPY_KIND__INT8:
+				values[anum] = Int64GetDatum(((cl_long *)addr)[index]);
+				break;
+			case GPUCOPY_KIND__FLOAT4:
+				values[anum] = Float4GetDatum(((cl_float *)addr)[index]);
+				break;
+			case GPUCOPY_KIND__FLOAT8:
+				values[anum] = Float8GetDatum(((cl_double *)addr)[index]);
+				break;
+			case GPUCOPY_KIND__DATE:
+				values[anum] = DateADTGetDatum(((cl_int *)addr)[index]);
+				break;
+			case GPUCOPY_KIND__TIMESTAMP:
+				values[anum] = TimestampGetDatum(((cl_long *)addr)[index]);
+				break;
+			case GPUCOPY_KIND__CPU:
+				{
+					kern_copyfield *field = (kern_copyfield *)addr + index;
+
+					values[anum] = gpucopy_input_field(
+						gcs, j,
+						text + field->offset,
+						field->length & ~GPUCOPY_FIELD_ESCAPED,
+						(field->length & GPUCOPY_FIELD_ESCAPED) != 0);
+				}
+				break;
+			default:
+				elog(ERROR, "unexpected column kind: %d", cmeta->kind);
+		}
+	}
+}
+
+/*
+ * gpucopy_insert_rows - writes out the parsed rows to the heap
+ */
+static void
+gpucopy_insert_rows(gpucopyState *gcs, gpucopyTask *gctask,
+					BulkInsertState bistate, MemoryContext batch_cxt)
+{
+	TupleDesc	tupdesc = RelationGetDescr(gcs->rel);
+	kern_gpucopy *kcopy = &gctask->kern;
+	const char *text = KERN_GPUCOPY_TEXT(kcopy);
+	char	   *results = (char *) gctask->m_results;
+	cl_uint	   *line_end = (cl_uint *) results;
+	cl_char	   *row_flags = (cl_char *)(results + kcopy->row_flags_offset);
+	HeapTuple	tuples[GPUCOPY_INSERT_BATCHSZ];
+	Datum	   *values = palloc0(sizeof(Datum) * tupdesc->natts);
+	bool	   *isnull = palloc(sizeof(bool) * tupdesc->natts);
+	CommandId	cid = GetCurrentCommandId(true);
+	MemoryContext oldcxt;
+	cl_uint		i, ntuples = 0;
+	cl_uint		head, tail;
+	int			j;
+
+	/* dropped columns are always NULL */
+	memset(isnull, true, sizeof(bool) * tupdesc->natts);
+
+	oldcxt = MemoryContextSwitchTo(batch_cxt);
+	for (i=0; i < kcopy->nitems; i++)
+	{
+		head = (i == 0 ? 0 : line_end[i - 1] + 1);
+		tail = line_end[i];
+		if (tail > head && text[tail - 1] == '\r')
+			tail--;
+		gcs->lineno++;
+		gcs->line_buf = text + head;
+		gcs->line_len = tail - head;
+
+		if (row_flags[i])
+			gpucopy_parse_line(gcs, text + head, tail - head, values, isnull);
+		else
+			gpucopy_fetch_row(gcs, kcopy, results, i, values, isnull);
+		for (j=0; j < gcs->ncols; j++)
+		{
+			Form_pg_attribute attr = tupdesc->attrs[gcs->attidx[j]];
+
+			if (attr->attnotnull && isnull[gcs->attidx[j]])
+				ereport(ERROR,
+						(errcode(ERRCODE_NOT_NULL_VIOLATION),
+						 errmsg("null value in column \"%s\" violates not-null constraint",
+								NameStr(attr->attname))));
+		}
+		tuples[ntuples++] = heap_form_tuple(tupdesc, values, isnull);
+		if (ntuples == GPUCOPY_INSERT_BATCHSZ || i + 1 == kcopy->nitems)
+		{
+			CHECK_FOR_INTERRUPTS();
+			heap_multi_insert(gcs->rel, tuples, ntuples,
+							  cid, 0, bistate);
+			MemoryContextReset(batch_cxt);
+			ntuples = 0;
+		}
+	}
+	gcs->line_buf = NULL;
+	MemoryContextSwitchTo(oldcxt);
+	pfree(values);
+	pfree(isnull);
+}
+
+/*
+ * gpucopy_fetch_task - fetch the next chunk in the order of the file
+ */
+static gpucopyTask *
+gpucopy_fetch_task(gpucopyState *gcs)
+{
+	GpuTask	   *gtask;
+	ListCell   *lc;
+
+	for (;;)
+	{
+		foreach (lc, gcs->pending_tasks)
+		{
+			gpucopyTask	   *gctask = lfirst(lc);
+
+			if (gctask->seq_no == gcs->emit_seq)
+			{
+				gcs->pending_tasks = list_delete_ptr(gcs->pending_tasks,
+													 gctask);
+				gcs->emit_seq++;
+				return gctask;
+			}
+		}
+		gtask = fetch_next_gputask(&gcs->gts);
+		if (!gtask)
+		{
+			Assert(gcs->pending_tasks == NIL);
+			return NULL;
+		}
+		if (gtask->kerror.errcode != StromError_Success)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("GPU kernel error: %s",
+							errorTextKernel(&gtask->kerror))));
+		gcs->pending_tasks = lappend(gcs->pending_tasks, gtask);
+	}
+}
+
+/*
+ * pgstrom_copy_gpu(regclass, text, text, bool)
+ *
+ * It loads the CSV file on the server to the table, like COPY FROM with
+ * CSV format. GPU finds out the lines and fields, then parses the values
+ * of bool, int2, int4, int8, float4, float8, date and timestamp, if
+ * they have simple forms. CPU calls the input function for the other
+ * columns, and parses the lines again if GPU could not parse them.
+ * The target table must not have indexes, triggers and CHECK constraints,
+ * because the rows are written out by heap_multi_insert() bypassing the
+ * executor, as pgstrom.random_fill() doing.
+ */
+Datum
+pgstrom_copy_gpu(PG_FUNCTION_ARGS)
+{
+	Oid				relid = PG_GETARG_OID(0);
+	char		   *filename = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	char		   *delimiter = text_to_cstring(PG_GETARG_TEXT_PP(2));
+	bool			header = PG_GETARG_BOOL(3);
+	Relation		rel;
+	TupleDesc		tupdesc;
+	AclResult		aclresult;
+	gpucopyState   *gcs;
+	GpuContext	   *gcontext;
+	StringInfoData	kern_define;
+	BulkInsertState	bistate;
+	MemoryContext	batch_cxt;
+	ErrorContextCallback errcallback;
+	gpucopyTask	   *gctask;
+	cl_ulong		nrows;
+	int				j;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to load a file by pgstrom.copy_gpu")));
+	if (strlen(delimiter) != 1 ||
+		delimiter[0] == '"' || delimiter[0] == '\n' || delimiter[0] == '\r')
+		elog(ERROR, "pgstrom.copy_gpu: delimiter must be a single one-byte character except for quote and newline");
+
+	rel = heap_open(relid, RowExclusiveLock);
+	if (RelationGetForm(rel)->relkind != RELKIND_RELATION)
+		elog(ERROR, "\"%s\" is not a regular table",
+			 RelationGetRelationName(rel));
+	aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_INSERT);
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, ACL_KIND_CLASS,
+					   RelationGetRelationName(rel));
+	tupdesc = RelationGetDescr(rel);
+	if (RelationGetForm(rel)->relhasindex ||
+		rel->trigdesc != NULL ||
+		(tupdesc->constr && tupdesc->constr->num_check > 0))
+		elog(ERROR, "pgstrom.copy_gpu: \"%s\" must not have indexes, triggers and CHECK constraints",
+			 RelationGetRelationName(rel));
+
+	gcs = palloc0(sizeof(gpucopyState));
+	gcs->rel = rel;
+	gcs->filename = filename;
+	gcs->skip_header = header;
+	gcs->delimiter = delimiter[0];
+	gcs->attidx = palloc0(sizeof(int) * tupdesc->natts);
+	gcs->in_functions = palloc0(sizeof(FmgrInfo) * tupdesc->natts);
+	gcs->typioparams = palloc0(sizeof(Oid) * tupdesc->natts);
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[j];
+		int			k = gcs->ncols;
+		Oid			in_func_oid;
+
+		if (attr->attisdropped)
+			continue;
+		gcs->attidx[k] = j;
+		getTypeInputInfo(attr->atttypid, &in_func_oid,
+						 &gcs->typioparams[k]);
+		fmgr_info(in_func_oid, &gcs->in_functions[k]);
+		gcs->ncols++;
+	}
+	if (gcs->ncols == 0)
+		elog(ERROR, "pgstrom.copy_gpu: \"%s\" has no columns",
+			 RelationGetRelationName(rel));
+	gcs->buffer_sz = pgstrom_chunk_size();
+	gcs->pending = palloc(gcs->buffer_sz);
+
+	gcs->filp = AllocateFile(filename, PG_BINARY_R);
+	if (!gcs->filp)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\" for reading: %m",
+						filename)));
+
+	/* setup a dummy GTS (see plcuda_exec_begin) */
+	gcontext = AllocGpuContext(-1, false);
+	ActivateGpuContext(gcontext);
+	gcs->gts.gcontext = gcontext;
+	gcs->gts.task_kind = GpuTaskKind_GpuCopy;
+	gcs->gts.kern_params = NULL;
+	gcs->gts.ccache_refs = NULL;
+	gcs->gts.tuple_bound = -1;
+	gcs->gts.cb_next_task = gpucopy_next_task;
+	gcs->gts.cb_process_task = gpucopy_process_task;
+	gcs->gts.cb_release_task = gpucopy_release_task;
+	dlist_init(&gcs->gts.ready_tasks);
+
+	initStringInfo(&kern_define);
+	pgstrom_build_session_info(&kern_define,
+							   &gcs->gts,
+							   DEVKERNEL_NEEDS_GPUCOPY |
+							   DEVKERNEL_NEEDS_TIMELIB);
+	gcs->gts.program_id = pgstrom_create_cuda_program(gcontext,
+													  DEVKERNEL_NEEDS_GPUCOPY |
+													  DEVKERNEL_NEEDS_TIMELIB,
+													  "",
+													  kern_define.data,
+													  false,
+													  false);
+	pfree(kern_define.data);
+
+	/*
+	 * GPU parses the next chunks asynchronously, during the insertion of
+	 * the parsed rows by CPU.
+	 */
+	bistate = GetBulkInsertState();
+	batch_cxt = AllocSetContextCreate(CurrentMemoryContext,
+									  "copy_gpu batch context",
+									  ALLOCSET_DEFAULT_SIZES);
+	errcallback.callback = gpucopy_error_callback;
+	errcallback.arg = (void *) gcs;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	if (header)
+		gcs->lineno++;
+	while ((gctask = gpucopy_fetch_task(gcs)) != NULL)
+	{
+		gpucopy_insert_rows(gcs, gctask, bistate, batch_cxt);
+		gpucopy_release_task(&gctask->task);
+	}
+	nrows = gcs->lineno - (header ? 1 : 0);
+
+	error_context_stack = errcallback.previous;
+	MemoryContextDelete(batch_cxt);
+	FreeBulkInsertState(bistate);
+	FreeFile(gcs->filp);
+
+	pgstromReleaseGpuTaskState(&gcs->gts);
+	heap_close(rel, NoLock);
+
+	PG_RETURN_INT64(nrows);
+}
+PG_FUNCTION_INFO_V1(pgstrom_copy_gpu);
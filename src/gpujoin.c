@@ -37,6 +37,7 @@ typedef struct
 		List	   *hash_quals;		/* valid quals, if hash-join */
 		List	   *join_quals;		/* all the device quals, incl hash_quals */
 		Size		ichunk_size;	/* expected inner chunk size */
+		int			inner_nparts;	/* number of inner partitions */
 	} inners[FLEXIBLE_ARRAY_MEMBER];
 } GpuJoinPath;
 
@@ -61,15 +62,21 @@ typedef struct
 	List	   *plan_nrows_in;	/* list of floatVal for planned nrows_in */
 	List	   *plan_nrows_out;	/* list of floatVal for planned nrows_out */
 	List	   *ichunk_size;
+	List	   *inner_nparts;
 	List	   *join_types;
 	List	   *join_quals;
 	List	   *other_quals;
 	List	   *hash_inner_keys;	/* if hash-join */
 	List	   *hash_outer_keys;	/* if hash-join */
+	List	   *range_inner_keys;	/* if nest-loop by range; (lower,upper) */
+	List	   *range_outer_keys;	/* if nest-loop by range; (lower,upper) */
+	bool		depth_reorderable;	/* true, if depths can be reordered */
 	/* supplemental information of ps_tlist */
 	List	   *ps_src_depth;	/* source depth of the ps_tlist entry */
 	List	   *ps_src_resno;	/* source resno of the ps_tlist entry */
 	cl_uint		extra_maxlen;	/* max length of extra area per rows */
+	int			hcache_ngroups;	/* # of key groups in hash-value cache */
+	cl_uint		varlena_bufsz;	/* length of varlena buffer per row */
 } GpuJoinInfo;
 
 static inline void
@@ -94,15 +101,21 @@ form_gpujoin_info(CustomScan *cscan, GpuJoinInfo *gj_info)
 	privs = lappend(privs, gj_info->plan_nrows_in);
 	privs = lappend(privs, gj_info->plan_nrows_out);
 	privs = lappend(privs, gj_info->ichunk_size);
+	privs = lappend(privs, gj_info->inner_nparts);
 	privs = lappend(privs, gj_info->join_types);
 	exprs = lappend(exprs, gj_info->join_quals);
 	exprs = lappend(exprs, gj_info->other_quals);
 	exprs = lappend(exprs, gj_info->hash_inner_keys);
 	exprs = lappend(exprs, gj_info->hash_outer_keys);
+	exprs = lappend(exprs, gj_info->range_inner_keys);
+	exprs = lappend(exprs, gj_info->range_outer_keys);
+	privs = lappend(privs, makeInteger(gj_info->depth_reorderable));
 
 	privs = lappend(privs, gj_info->ps_src_depth);
 	privs = lappend(privs, gj_info->ps_src_resno);
 	privs = lappend(privs, makeInteger(gj_info->extra_maxlen));
+	privs = lappend(privs, makeInteger(gj_info->hcache_ngroups));
+	privs = lappend(privs, makeInteger(gj_info->varlena_bufsz));
 
 	cscan->custom_private = privs;
 	cscan->custom_exprs = exprs;
@@ -133,15 +146,21 @@ deform_gpujoin_info(CustomScan *cscan)
 	gj_info->plan_nrows_in = list_nth(privs, pindex++);
 	gj_info->plan_nrows_out = list_nth(privs, pindex++);
 	gj_info->ichunk_size = list_nth(privs, pindex++);
+	gj_info->inner_nparts = list_nth(privs, pindex++);
 	gj_info->join_types = list_nth(privs, pindex++);
     gj_info->join_quals = list_nth(exprs, eindex++);
 	gj_info->other_quals = list_nth(exprs, eindex++);
 	gj_info->hash_inner_keys = list_nth(exprs, eindex++);
     gj_info->hash_outer_keys = list_nth(exprs, eindex++);
+	gj_info->range_inner_keys = list_nth(exprs, eindex++);
+	gj_info->range_outer_keys = list_nth(exprs, eindex++);
+	gj_info->depth_reorderable = intVal(list_nth(privs, pindex++));
 
 	gj_info->ps_src_depth = list_nth(privs, pindex++);
 	gj_info->ps_src_resno = list_nth(privs, pindex++);
 	gj_info->extra_maxlen = intVal(list_nth(privs, pindex++));
+	gj_info->hcache_ngroups = intVal(list_nth(privs, pindex++));
+	gj_info->varlena_bufsz = intVal(list_nth(privs, pindex++));
 	Assert(pindex == list_length(privs));
 	Assert(eindex == list_length(exprs));
 
@@ -166,6 +185,8 @@ typedef struct
 	JoinType			join_type;
 	double				nrows_ratio;
 	cl_uint				ichunk_size;
+	cl_int				inner_nparts;	/* number of partitions, if > 1 */
+	dsm_segment		  **seg_parts;		/* partitioned inner hash tables */
 #if PG_VERSION_NUM < 100000	
 	List			   *join_quals;		/* single element list of ExprState */
 	List			   *other_quals;	/* single element list of ExprState */
@@ -183,6 +204,17 @@ typedef struct
 	List			   *hash_keybyval;
 	List			   *hash_keytype;
 
+	/*
+	 * Join properties; only nest-loop by range keys
+	 */
+	ExprState		   *range_inner_lower;
+	ExprState		   *range_inner_upper;
+	Oid					range_lower_type;
+	Oid					range_upper_type;
+	kern_rangeitem	   *range_items;	/* built during inner preload */
+	cl_uint				range_nitems;
+	cl_uint				range_nrooms;
+
 	/* CPU Fallback related */
 	AttrNumber		   *inner_dst_resno;
 	AttrNumber			inner_src_anum_min;
@@ -204,6 +236,22 @@ typedef struct
 	CUdeviceptr	   *m_kmrels_array;	/* only master process */
 	dsm_segment	   *seg_kmrels;
 	cl_int			curr_outer_depth;
+	cl_int			part_depth;		/* depth of the partitioned inner */
+	cl_int			curr_part;		/* current partition of the inner */
+	List		   *inner_signature;	/* identity of the inner buffer, if
+										 * shareable with sibling GpuJoins */
+	struct GpuJoinSharedInner *shared_inner; /* inner buffer in use, if any */
+	struct GpuJoinInnerCacheRef *inner_cache_ref; /* inner buffer cache in
+												   * use, if any */
+	struct GpuJoinInnerCacheToken *inner_cache_tokens; /* validity of the
+														* inner relations
+														* prior to preload */
+
+	/* Adaptive depth reordering */
+	bool			depth_reorderable;
+	cl_int		   *depth_order;	/* level -> depth; [num_rels+1] */
+	cl_int		   *depth_work;		/* working area; [num_rels+1] */
+	double		   *depth_ratio;	/* working area; [num_rels+1] */
 
 	/*
 	 * Expressions to be used in the CPU fallback path
@@ -222,6 +270,8 @@ typedef struct
 	int				result_width;
 	/* expected extra length per result tuple  */
 	cl_uint			extra_maxlen;
+	/* number of key groups in the hash-value cache */
+	cl_uint			hcache_ngroups;
 
 	/*
 	 * CPU Fallback
@@ -240,6 +290,13 @@ typedef struct
 	innerState		inners[FLEXIBLE_ARRAY_MEMBER];
 } GpuJoinState;
 
+/* GPU kernels tracked by EXPLAIN ANALYZE */
+static const char *gpujoin_kernel_names[] = {
+	"gpujoin_main",
+	"gpujoin_right_outer",
+	NULL
+};
+
 /*
  * GpuJoinSharedState - shared inner hash/heap buffer
  */
@@ -265,11 +322,13 @@ typedef struct GpuJoinSharedState	GpuJoinSharedState;
  */
 struct GpuJoinRuntimeStat
 {
+	GpuTaskRuntimeStat	c;		/* common statistics */
 	pg_atomic_uint64	ccache_count;
 	pg_atomic_uint64	source_nitems;
 	struct {
 		pg_atomic_uint64 inner_nitems;
 		pg_atomic_uint64 right_nitems;
+		pg_atomic_uint64 input_nitems;	/* # of input rows of this depth */
 	} jstat[FLEXIBLE_ARRAY_MEMBER];
 };
 typedef struct GpuJoinRuntimeStat	GpuJoinRuntimeStat;
@@ -301,6 +360,128 @@ static CustomScanMethods	gpujoin_plan_methods;
 static CustomExecMethods	gpujoin_exec_methods;
 static bool					enable_gpunestloop;
 static bool					enable_gpuhashjoin;
+static int					gpujoin_inner_partition_size_kb;
+static bool					gpujoin_bloom_filter_enabled;
+static bool					gpujoin_adaptive_reorder;
+static bool					gpujoin_sorted_inner_enabled;
+static bool					gpujoin_heavy_hitter_enabled;
+static bool					gpujoin_shared_inner_enabled;
+
+/*
+ * GpuJoinSharedInner - an inner buffer (DSM segment and device memory)
+ * already preloaded by a GpuJoin, and available to the sibling GpuJoins
+ * in the same query which have the identical inner relations; typically,
+ * per-partition GpuJoins under an Append towards a common dimension table.
+ * It is kept until the last GpuJoin which references the buffer is unloaded.
+ */
+typedef struct GpuJoinSharedInner
+{
+	EState		   *estate;			/* query which owns the buffer */
+	GpuContext	   *gcontext;		/* GpuContext which owns device memory */
+	List		   *signature;		/* identity of the inner relations */
+	cl_int			refcnt;
+	dsm_segment	   *seg_kmrels;
+	CUdeviceptr		m_kmrels;
+	CUdeviceptr	   *m_kmrels_array;
+} GpuJoinSharedInner;
+
+static List				   *gpujoin_shared_inners = NIL;
+
+/*
+ * GpuJoinInnerCacheEntry - an inner buffer kept over the executions, to
+ * skip the preload phase on the repeated query with identical inner
+ * relations. The host image (with the signature text next to the image)
+ * is kept on a pinned DSM segment, and the device image is kept on the
+ * preserved device memory. The entry is valid as long as all the inner
+ * relations are entirely all-visible, and have the same number of blocks
+ * and the same LSN of the visibility-map pages. Any modification clears
+ * the visibility-map bit of the page, and only VACUUM can set the bit
+ * again, with a new LSN on the visibility-map page (so we never cache
+ * relations without WAL). Being all-visible also means the buffer contents
+ * are visible to any snapshot. Relcache invalidation (TRUNCATE, ALTER
+ * TABLE and so on) also invalidates the entry.
+ */
+#define GPUJOIN_INNER_CACHE_NSLOTS		32
+#define GPUJOIN_INNER_CACHE_MAX_RELS	8
+
+typedef struct GpuJoinInnerCacheToken
+{
+	BlockNumber		nblocks;		/* number of the heap blocks */
+	XLogRecPtr		vm_lsn;			/* max LSN of the visibility-map */
+} GpuJoinInnerCacheToken;
+
+typedef struct
+{
+	bool			in_use;
+	bool			is_valid;		/* false, if invalidated */
+	cl_int			refcnt;			/* number of GpuJoins which use */
+	Oid				database_oid;
+	cl_int			cuda_dindex;
+	pg_crc32		signature_crc;
+	cl_uint			signature_len;
+	cl_int			nrels;
+	Oid				relids[GPUJOIN_INNER_CACHE_MAX_RELS];
+	GpuJoinInnerCacheToken tokens[GPUJOIN_INNER_CACHE_MAX_RELS];
+	dsm_handle		kmrels_handle;	/* pinned DSM segment */
+	size_t			kmrels_length;	/* length of the image */
+	CUipcMemHandle	m_handle;		/* preserved device memory */
+	TimestampTz		last_used;
+} GpuJoinInnerCacheEntry;
+
+typedef struct
+{
+	slock_t			lock;
+	GpuJoinInnerCacheEntry entries[GPUJOIN_INNER_CACHE_NSLOTS];
+} GpuJoinInnerCacheHead;
+
+/*
+ * GpuJoinInnerCacheRef - a reference to the inner buffer cache entry by
+ * a GpuJoin. It is released on the unload, or end of the query even if
+ * it was aborted.
+ */
+typedef struct GpuJoinInnerCacheRef
+{
+	cl_int			index;			/* index of the cache entry */
+	bool			released;
+	MemoryContextCallback mcb;
+} GpuJoinInnerCacheRef;
+
+static shmem_startup_hook_type shmem_startup_next = NULL;
+static GpuJoinInnerCacheHead *gpujoin_inner_cache_head = NULL;
+static bool					gpujoin_inner_cache_enabled;
+
+/*
+ * Minimum number of inner tuples, and minimum average number of tuples per
+ * distinct hash value, to build sorted items of the inner hash table.
+ */
+#define GPUJOIN_SORTED_INNER_MIN_NITEMS		20000
+#define GPUJOIN_SORTED_INNER_MIN_DUPS		4
+
+/*
+ * Minimum number of inner tuples per heavy hitter key, and upper limit of
+ * the number of heavy hitter keys per depth.
+ */
+#define GPUJOIN_HEAVY_HITTER_MIN_NITEMS		1024
+#define GPUJOIN_HEAVY_HITTER_MAX_NKEYS		256
+
+/*
+ * Minimum number of input rows at a particular depth, to trust the runtime
+ * statistics more than planner's estimation, and the threshold of the cost
+ * reduction for switching the order of depths.
+ */
+#define GPUJOIN_REORDER_MIN_NITEMS		10000
+#define GPUJOIN_REORDER_THRESHOLD		0.80
+
+/*
+ * Upper limit of the number of inner partitions, because each partition
+ * consumes a DSM segment during execution
+ */
+#define GPUJOIN_MAX_INNER_PARTITIONS	32
+
+/*
+ * Upper limit of the bloom filter size per depth (16MB)
+ */
+#define GPUJOIN_BLOOM_MAX_NWORDS		(4UL << 20)
 
 /* static functions */
 static void gpujoin_switch_task(GpuTaskState *gts, GpuTask *gtask);
@@ -308,6 +489,7 @@ static GpuTask *gpujoin_next_task(GpuTaskState *gts);
 static GpuTask *gpujoin_terminator_task(GpuTaskState *gts,
 										cl_bool *task_is_ready);
 static TupleTableSlot *gpujoin_next_tuple(GpuTaskState *gts);
+static bool gpujoin_async_fallback(GpuTask *gtask);
 static pg_crc32 get_tuple_hashvalue(innerState *istate,
 									bool is_inner_hashkeys,
 									TupleTableSlot *slot,
@@ -322,6 +504,20 @@ static char *gpujoin_codegen(PlannerInfo *root,
 static GpuJoinSharedState *createGpuJoinSharedState(GpuJoinState *gjs,
 													ParallelContext *pcxt,
 													void *coordinate);
+static void gpujoinSwitchInnerPartition(GpuJoinState *gjs, cl_int part);
+static void gpujoinReleaseInnerPartitions(GpuJoinState *gjs);
+static void gpujoinBroadcastInnerBuffer(GpuJoinState *gjs, void *hbuf,
+										size_t offset, size_t length);
+static List *gpujoin_inner_signature(GpuJoinState *gjs,
+									 CustomScan *cscan,
+									 GpuJoinInfo *gj_info,
+									 EState *estate);
+static bool gpujoinAttachSharedInner(GpuJoinState *gjs);
+static void gpujoinRegisterSharedInner(GpuJoinState *gjs);
+static bool gpujoinDetachSharedInner(GpuJoinState *gjs);
+static bool gpujoinAttachInnerCache(GpuJoinState *gjs);
+static void gpujoinRegisterInnerCache(GpuJoinState *gjs);
+static void gpujoinReleaseInnerCache(GpuJoinState *gjs);
 
 /*
  * misc declarations
@@ -538,14 +734,26 @@ cost_gpujoin(PlannerInfo *root,
 	Cost		run_cost_per_chunk = 0.0;
 	Cost		startup_delay;
 	Size		inner_buffer_sz = 0;
-	double		gpu_ratio = pgstrom_gpu_operator_cost / cpu_operator_cost;
+	double		gpu_setup_cost;
+	double		gpu_dma_cost;
+	double		gpu_operator_cost;
+	double		gpu_ratio;
 	double		parallel_divisor = 1.0;
 	double		num_chunks;
 	double		outer_ntuples;
 	double		kern_nloops = 1.0;
+	Size		inner_partition_sz = (Size)gpujoin_inner_partition_size_kb << 10;
+	int			inner_nparts = 1;
+	bool		inner_partition_ok = (parallel_nworkers == 0);
 	int			i, num_rels = gpath->num_rels;
 	bool		retval = false;
 
+	/* static or calibrated cost factors */
+	pgstrom_gpu_cost_factors(&gpu_setup_cost,
+							 &gpu_dma_cost,
+							 &gpu_operator_cost);
+	gpu_ratio = gpu_operator_cost / cpu_operator_cost;
+
 	/*
 	 * Cost comes from the outer-path
 	 */
@@ -567,7 +775,7 @@ cost_gpujoin(PlannerInfo *root,
 	}
 	else
 	{
-		startup_cost = pgstrom_gpu_setup_cost + outer_path->startup_cost;
+		startup_cost = gpu_setup_cost + outer_path->startup_cost;
 		run_cost = outer_path->total_cost - outer_path->startup_cost;
 		num_chunks = estimate_num_chunks(outer_path);
 	}
@@ -582,6 +790,19 @@ cost_gpujoin(PlannerInfo *root,
 												gpath,
 												num_chunks,
 												&kern_nloops);
+	/*
+	 * Inner hash table can be partitioned only if outer relation is rewound
+	 * for each partition without any side-effect; no RIGHT/FULL OUTER JOIN
+	 * and no CPU parallel
+	 */
+	for (i=0; i < num_rels; i++)
+	{
+		gpath->inners[i].inner_nparts = 1;
+		if (gpath->inners[i].join_type == JOIN_RIGHT ||
+			gpath->inners[i].join_type == JOIN_FULL)
+			inner_partition_ok = false;
+	}
+
 	/*
 	 * Cost for each depth
 	 */
@@ -595,6 +816,39 @@ cost_gpujoin(PlannerInfo *root,
 		Size		ichunk_size = gpath->inners[i].ichunk_size;
 		QualCost	join_quals_cost;
 
+		/*
+		 * If inner hash table is larger than the threshold, it shall be
+		 * split into multiple partitions by the hash value, then GpuJoin
+		 * runs the outer relation for each partition.
+		 * Only one depth of INNER JOIN can be partitioned.
+		 */
+		if (ichunk_size > inner_partition_sz &&
+			inner_partition_ok &&
+			inner_nparts == 1 &&
+			hash_quals != NIL &&
+			gpath->inners[i].join_type == JOIN_INNER)
+		{
+			inner_nparts = (ichunk_size + inner_partition_sz - 1)
+				/ inner_partition_sz;
+			if (inner_nparts > GPUJOIN_MAX_INNER_PARTITIONS)
+			{
+				if (client_min_messages <= DEBUG1)
+				{
+					StringInfoData buf;
+
+					initStringInfo(&buf);
+					__dump_gpujoin_path(&buf, root, scan_path);
+					elog(DEBUG1, "expected inner size (%zu) on %s needs too many partitions (%d)",
+						 ichunk_size, buf.data, inner_nparts);
+					pfree(buf.data);
+				}
+				return false;
+			}
+			ichunk_size /= inner_nparts;
+			gpath->inners[i].ichunk_size = ichunk_size;
+			gpath->inners[i].inner_nparts = inner_nparts;
+		}
+
 		/*
 		 * FIXME: Right now, KDS_FORMAT_ROW/HASH does not support KDS size
 		 * larger than 4GB because of 32bit index from row_index[] or
@@ -647,7 +901,7 @@ cost_gpujoin(PlannerInfo *root,
 			startup_cost += (cpu_operator_cost * num_hashkeys *
 							 scan_path->rows);
 			/* cost to comput hash value by GPU */
-			run_cost += (pgstrom_gpu_operator_cost *
+			run_cost += (gpu_operator_cost *
 						 num_hashkeys *
 						 outer_ntuples);
 			/* cost to evaluate join qualifiers */
@@ -663,10 +917,34 @@ cost_gpujoin(PlannerInfo *root,
 			 * GpuHashJoin.
 			 */
 			double		inner_ntuples = scan_path->rows;
+			List	   *range_inner_keys;
+			List	   *range_outer_keys;
 
 			/* cost to preload inner heap tuples by CPU */
 			startup_cost += cpu_tuple_cost * inner_ntuples;
 
+			/*
+			 * If range keys are available, inner rows are sorted by CPU,
+			 * then join-qual is evaluated only for the candidate inner
+			 * rows picked up by binary search.
+			 */
+			if (extract_gpujoin_range_keys(scan_path->parent,
+										   gpath->inners[i].join_type,
+										   gpath->inners[i].join_quals,
+										   &range_inner_keys,
+										   &range_outer_keys))
+			{
+				double	nsteps = log2(Max(inner_ntuples, 2.0));
+
+				startup_cost += (2.0 * cpu_operator_cost *
+								 inner_ntuples * nsteps);
+				inner_ntuples = Min(inner_ntuples,
+									nsteps + Max(join_nrows /
+												 parallel_divisor /
+												 Max(outer_ntuples, 1.0),
+												 1.0));
+			}
+
 			/* cost to evaluate join qualifiers */
 			run_cost_per_chunk += (join_quals_cost.per_tuple *
 								   outer_ntuples *
@@ -676,10 +954,13 @@ cost_gpujoin(PlannerInfo *root,
 		outer_ntuples = join_nrows / parallel_divisor;
 	}
 	/* outer DMA send cost */
-	run_cost += (double)num_chunks * pgstrom_gpu_dma_cost;
+	run_cost += (double)num_chunks * gpu_dma_cost;
+	/* outer relation is scanned for each inner partition */
+	if (inner_nparts > 1)
+		run_cost *= (double) inner_nparts;
 	/* inner DMA send cost */
 	run_cost += ((double)inner_buffer_sz /
-				 (double)pgstrom_chunk_size()) * pgstrom_gpu_dma_cost;
+				 (double)pgstrom_chunk_size()) * gpu_dma_cost;
 	/* cost for projection */
 	startup_cost += joinrel->reltarget->cost.startup;
 	run_cost += joinrel->reltarget->cost.per_tuple * gpath->cpath.path.rows;
@@ -729,7 +1010,9 @@ cost_gpujoin(PlannerInfo *root,
 			appendStringInfo(&buf, " %s%s ",
 							 join_type == JOIN_FULL ? "F" :
 							 join_type == JOIN_LEFT ? "L" :
-							 join_type == JOIN_RIGHT ? "R" : "I",
+							 join_type == JOIN_RIGHT ? "R" :
+							 join_type == JOIN_SEMI ? "S" :
+							 join_type == JOIN_ANTI ? "A" : "I",
 							 is_nestloop ? "NL" : "HJ");
 
 			__dump_gpujoin_path(&buf, root, inner_path);
@@ -808,7 +1091,9 @@ create_gpujoin_path(PlannerInfo *root,
 			hash_quals = ip_item->hash_quals;
 		else if (enable_gpunestloop &&
 				 (ip_item->join_type == JOIN_INNER ||
-				  ip_item->join_type == JOIN_LEFT))
+				  ip_item->join_type == JOIN_LEFT ||
+				  ip_item->join_type == JOIN_SEMI ||
+				  ip_item->join_type == JOIN_ANTI))
 			hash_quals = NIL;
 		else
 		{
@@ -823,6 +1108,7 @@ create_gpujoin_path(PlannerInfo *root,
 		gjpath->inners[i].hash_quals = hash_quals;
 		gjpath->inners[i].join_quals = ip_item->join_quals;
 		gjpath->inners[i].ichunk_size = 0;		/* to be set later */
+		gjpath->inners[i].inner_nparts = 1;		/* to be set later */
 		i++;
 	}
 	Assert(i == num_rels);
@@ -950,6 +1236,211 @@ extract_gpuhashjoin_quals(PlannerInfo *root,
 	return hash_quals;
 }
 
+/*
+ * gpujoin_range_key_type - true, if the type is available for range keys
+ *
+ * All of them are 64bit (or shorter) integer internally, so ordering of the
+ * bounds can be compared in the cl_long form.
+ */
+static bool
+gpujoin_range_key_type(Oid type_oid)
+{
+	switch (type_oid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return true;
+		default:
+			break;
+	}
+	return false;
+}
+
+/*
+ * gpujoin_range_key_datum - a bound of range keys in cl_long form
+ */
+static cl_long
+gpujoin_range_key_datum(Oid type_oid, Datum datum)
+{
+	switch (type_oid)
+	{
+		case INT2OID:
+			return (cl_long) DatumGetInt16(datum);
+		case INT4OID:
+			return (cl_long) DatumGetInt32(datum);
+		case INT8OID:
+			return (cl_long) DatumGetInt64(datum);
+		case DATEOID:
+			return (cl_long) DatumGetDateADT(datum);
+		case TIMESTAMPOID:
+			return (cl_long) DatumGetTimestamp(datum);
+		case TIMESTAMPTZOID:
+			return (cl_long) DatumGetTimestampTz(datum);
+		default:
+			elog(ERROR, "unexpected type for range keys: %s",
+				 format_type_be(type_oid));
+	}
+	return 0;	/* not reachable */
+}
+
+/*
+ * make_range_bound_expr - lower() or upper() of the range expression
+ */
+static Expr *
+make_range_bound_expr(Expr *range_expr, bool is_lower)
+{
+	Oid		subtype = get_range_subtype(exprType((Node *)range_expr));
+
+	if (!gpujoin_range_key_type(subtype))
+		return NULL;
+	return (Expr *) makeFuncExpr(is_lower ? F_RANGE_LOWER : F_RANGE_UPPER,
+								 subtype,
+								 list_make1(copyObject(range_expr)),
+								 InvalidOid,
+								 InvalidOid,
+								 COERCE_EXPLICIT_CALL);
+}
+
+/*
+ * extract_gpujoin_range_keys - pick up range keys usable for GpuNestLoop
+ *
+ * If join quals restrict the inner row by a range of the outer row; like
+ * BETWEEN, range @> element or range && range, GpuNestLoop can pick up the
+ * candidate inner rows by binary search on the inner rows sorted by the
+ * lower bound, instead of evaluation of the join quals for all the inner
+ * rows. It returns true if any, with (lower, upper) of the inner keys and
+ * the outer keys; inner lower bound is compared to the outer upper bound,
+ * and inner upper bound is compared to the outer lower bound. Either of
+ * the pairs may be NULL, if the range is not bounded on the side.
+ */
+static bool
+extract_gpujoin_range_keys(RelOptInfo *inner_rel,
+						   JoinType join_type,
+						   List *join_quals,
+						   List **p_range_inner_keys,
+						   List **p_range_outer_keys)
+{
+	Expr	   *inner_lower = NULL;
+	Expr	   *inner_upper = NULL;
+	Expr	   *outer_lower = NULL;
+	Expr	   *outer_upper = NULL;
+	ListCell   *lc;
+
+	foreach (lc, join_quals)
+	{
+		RestrictInfo   *rinfo = lfirst(lc);
+		OpExpr		   *op = (OpExpr *) rinfo->clause;
+		Expr		   *i_expr;
+		Expr		   *o_expr;
+		Expr		   *i_lower = NULL;
+		Expr		   *i_upper = NULL;
+		Expr		   *o_lower = NULL;
+		Expr		   *o_upper = NULL;
+		Relids			relids1;
+		Relids			relids2;
+		bool			inner_is_arg1;
+		Oid				key_type;
+		Oid				opcode;
+
+		/* see extract_gpuhashjoin_quals */
+		if (IS_OUTER_JOIN(join_type) && rinfo->is_pushed_down)
+			continue;
+		if (!is_opclause(op) || list_length(op->args) != 2)
+			continue;
+		relids1 = pull_varnos(linitial(op->args));
+		relids2 = pull_varnos(lsecond(op->args));
+		if (!bms_is_empty(relids1) &&
+			bms_is_subset(relids1, inner_rel->relids) &&
+			!bms_overlap(relids2, inner_rel->relids))
+			inner_is_arg1 = true;
+		else if (!bms_is_empty(relids2) &&
+				 bms_is_subset(relids2, inner_rel->relids) &&
+				 !bms_overlap(relids1, inner_rel->relids))
+			inner_is_arg1 = false;
+		else
+			continue;
+		i_expr = (inner_is_arg1 ? linitial(op->args) : lsecond(op->args));
+		o_expr = (inner_is_arg1 ? lsecond(op->args) : linitial(op->args));
+		key_type = exprType((Node *)o_expr);
+
+		opcode = get_opcode(op->opno);
+		if (opcode == F_RANGE_OVERLAPS ||
+			opcode == F_RANGE_CONTAINS ||
+			opcode == F_RANGE_CONTAINED_BY)
+		{
+			/* both of the ranges shall overlap */
+			i_lower = make_range_bound_expr(i_expr, true);
+			i_upper = make_range_bound_expr(i_expr, false);
+			o_lower = make_range_bound_expr(o_expr, true);
+			o_upper = make_range_bound_expr(o_expr, false);
+		}
+		else if ((opcode == F_RANGE_CONTAINS_ELEM && inner_is_arg1) ||
+				 (opcode == F_ELEM_CONTAINED_BY_RANGE && !inner_is_arg1))
+		{
+			/* outer element shall be in the inner range */
+			if (gpujoin_range_key_type(key_type))
+			{
+				i_lower = make_range_bound_expr(i_expr, true);
+				i_upper = make_range_bound_expr(i_expr, false);
+				o_lower = o_upper = o_expr;
+			}
+		}
+		else if (gpujoin_range_key_type(key_type) &&
+				 exprType((Node *)i_expr) == key_type)
+		{
+			/* btree comparison operators, like BETWEEN */
+			TypeCacheEntry *tcache;
+			int				strategy;
+
+			tcache = lookup_type_cache(key_type, TYPECACHE_BTREE_OPFAMILY);
+			if (!OidIsValid(tcache->btree_opf))
+				continue;
+			strategy = get_op_opfamily_strategy(op->opno, tcache->btree_opf);
+			/* commute the strategy, if 'outer OP inner' form */
+			if (strategy != InvalidStrategy && !inner_is_arg1)
+				strategy = BTCommuteStrategyNumber(strategy);
+			if (strategy == BTLessStrategyNumber ||
+				strategy == BTLessEqualStrategyNumber ||
+				strategy == BTEqualStrategyNumber)
+			{
+				i_lower = i_expr;
+				o_upper = o_expr;
+			}
+			if (strategy == BTGreaterStrategyNumber ||
+				strategy == BTGreaterEqualStrategyNumber ||
+				strategy == BTEqualStrategyNumber)
+			{
+				i_upper = i_expr;
+				o_lower = o_expr;
+			}
+		}
+
+		/* bounds of the outer keys are evaluated on the device */
+		if (!inner_lower && i_lower && o_upper &&
+			pgstrom_device_expression(o_upper))
+		{
+			inner_lower = i_lower;
+			outer_upper = o_upper;
+		}
+		if (!inner_upper && i_upper && o_lower &&
+			pgstrom_device_expression(o_lower))
+		{
+			inner_upper = i_upper;
+			outer_lower = o_lower;
+		}
+	}
+	if (!inner_lower && !inner_upper)
+		return false;
+
+	*p_range_inner_keys = list_make2(inner_lower, inner_upper);
+	*p_range_outer_keys = list_make2(outer_lower, outer_upper);
+	return true;
+}
+
 /*
  * try_add_gpujoin_paths
  */
@@ -973,7 +1464,9 @@ try_add_gpujoin_paths(PlannerInfo *root,
 	if (join_type != JOIN_INNER &&
 		join_type != JOIN_FULL &&
 		join_type != JOIN_RIGHT &&
-		join_type != JOIN_LEFT)
+		join_type != JOIN_LEFT &&
+		join_type != JOIN_SEMI &&
+		join_type != JOIN_ANTI)
 		return;
 
 	/*
@@ -1453,6 +1946,8 @@ build_device_targetlist(GpuJoinPath *gpath,
 	build_device_tlist_walker((Node *)gj_info->other_quals, &context);
 	build_device_tlist_walker((Node *)gj_info->hash_inner_keys, &context);
 	build_device_tlist_walker((Node *)gj_info->hash_outer_keys, &context);
+	build_device_tlist_walker((Node *)gj_info->range_inner_keys, &context);
+	build_device_tlist_walker((Node *)gj_info->range_outer_keys, &context);
 	build_device_tlist_walker((Node *)targetlist, &context);
 
 	Assert(list_length(context.ps_tlist) == list_length(context.ps_depth) &&
@@ -1486,10 +1981,13 @@ PlanGpuJoinPath(PlannerInfo *root,
 	Bitmapset	   *varattnos = NULL;
 	List		   *ccache_refs = NULL;
 	double			outer_nrows;
+	Relids			outer_relids;
+	bool			depth_reorderable = (gjpath->num_rels > 1);
 	int				i, j;
 
 	Assert(gjpath->num_rels + 1 == list_length(custom_plans));
 	outer_plan = linitial(custom_plans);
+	outer_relids = ((Path *)linitial(best_path->custom_paths))->parent->relids;
 
 	cscan = makeNode(CustomScan);
 	cscan->scan.plan.targetlist = tlist;
@@ -1514,6 +2012,8 @@ PlanGpuJoinPath(PlannerInfo *root,
 	{
 		List	   *hash_inner_keys = NIL;
 		List	   *hash_outer_keys = NIL;
+		List	   *range_inner_keys = NIL;
+		List	   *range_outer_keys = NIL;
 		List	   *join_quals = NIL;
 		List	   *other_quals = NIL;
 
@@ -1549,6 +2049,14 @@ PlanGpuJoinPath(PlannerInfo *root,
 				elog(ERROR, "Bug? hash-clause reference bogus varnos");
 		}
 
+		/* GpuNestLoop may probe the inner rows by range keys */
+		if (gjpath->inners[i].hash_quals == NIL)
+			extract_gpujoin_range_keys(gjpath->inners[i].scan_path->parent,
+									   gjpath->inners[i].join_type,
+									   gjpath->inners[i].join_quals,
+									   &range_inner_keys,
+									   &range_outer_keys);
+
 		/*
 		 * Add properties of GpuJoinInfo
 		 */
@@ -1558,6 +2066,8 @@ PlanGpuJoinPath(PlannerInfo *root,
 									pmakeFloat(gjpath->inners[i].join_nrows));
 		gj_info.ichunk_size = lappend_int(gj_info.ichunk_size,
 										  gjpath->inners[i].ichunk_size);
+		gj_info.inner_nparts = lappend_int(gj_info.inner_nparts,
+									gjpath->inners[i].inner_nparts);
 		gj_info.join_types = lappend_int(gj_info.join_types,
 										 gjpath->inners[i].join_type);
 
@@ -1584,11 +2094,34 @@ PlanGpuJoinPath(PlannerInfo *root,
 										  hash_inner_keys);
 		gj_info.hash_outer_keys = lappend(gj_info.hash_outer_keys,
 										  hash_outer_keys);
+		gj_info.range_inner_keys = lappend(gj_info.range_inner_keys,
+										   range_inner_keys);
+		gj_info.range_outer_keys = lappend(gj_info.range_outer_keys,
+										   range_outer_keys);
 		outer_nrows = gjpath->inners[i].join_nrows;
 
+		/*
+		 * Depths can be reordered at runtime only if all of them are
+		 * INNER hash-join, and its join_quals/hash_outer_keys reference
+		 * nothing but the outer relation and its own inner relation.
+		 */
+		if (depth_reorderable)
+		{
+			Relids	inner_relids = gjpath->inners[i].scan_path->parent->relids;
+
+			if (gjpath->inners[i].join_type != JOIN_INNER ||
+				hash_outer_keys == NIL ||
+				!bms_is_subset(pull_varnos((Node *)hash_outer_keys),
+							   outer_relids) ||
+				!bms_is_subset(pull_varnos((Node *)join_quals),
+							   bms_union(outer_relids, inner_relids)))
+				depth_reorderable = false;
+		}
+
 		if (outer_relid)
 		{
 			pull_varattnos((Node *)hash_outer_keys, outer_relid, &varattnos);
+			pull_varattnos((Node *)range_outer_keys, outer_relid, &varattnos);
 			pull_varattnos((Node *)join_quals, outer_relid, &varattnos);
 			pull_varattnos((Node *)other_quals, outer_relid, &varattnos);
 		}
@@ -1618,6 +2151,7 @@ PlanGpuJoinPath(PlannerInfo *root,
 		outerPlan(cscan) = outer_plan;
 	}
 	gj_info.outer_nrows_per_block = gjpath->outer_nrows_per_block;
+	gj_info.depth_reorderable = depth_reorderable;
 
 	/*
 	 * Build a tentative pseudo-scan targetlist. At this point, we cannot
@@ -1641,6 +2175,7 @@ PlanGpuJoinPath(PlannerInfo *root,
 						   context.extra_flags);
 	gj_info.ccache_refs = ccache_refs;
 	gj_info.used_params = context.used_params;
+	gj_info.varlena_bufsz = context.varlena_bufsz;
 
 	form_gpujoin_info(cscan, &gj_info);
 
@@ -1744,6 +2279,7 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 {
 	GpuJoinState   *gjs = (GpuJoinState *) node;
 	ScanState	   *ss = &gjs->gts.css.ss;
+	Relation		scan_rel = ss->ss_currentRelation;
 	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
 	GpuJoinInfo	   *gj_info = deform_gpujoin_info(cscan);
 	TupleDesc		result_tupdesc = GTS_GET_RESULT_TUPDESC(gjs);
@@ -1760,7 +2296,9 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	ProgramId		program_id;
 
 	/* activate a GpuContext for CUDA kernel execution */
-	gjs->gts.gcontext = AllocGpuContext(-1, false);
+	gjs->gts.gcontext = AllocGpuContext(scan_rel
+										? RelationGetOptimalGpuDevice(scan_rel)
+										: -1, false);
 	if (!explain_only)
 		ActivateGpuContext(gjs->gts.gcontext);
 	/*
@@ -1791,7 +2329,9 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	gjs->gts.cb_terminator_task	= gpujoin_terminator_task;
 	gjs->gts.cb_switch_task		= gpujoin_switch_task;
 	gjs->gts.cb_process_task	= gpujoin_process_task;
+	gjs->gts.kern_names			= gpujoin_kernel_names;
 	gjs->gts.cb_release_task	= gpujoin_release_task;
+	gjs->gts.cb_async_fallback	= gpujoin_async_fallback;
 	gjs->gts.outer_nrows_per_block = gj_info->outer_nrows_per_block;
 
 	/* DSM & GPU memory of inner buffer */
@@ -1799,6 +2339,18 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	gjs->m_kmrels_array = NULL;
 	gjs->seg_kmrels = NULL;
 	gjs->curr_outer_depth = -1;
+	gjs->part_depth = 0;
+	gjs->curr_part = 0;
+	gjs->inner_signature = NULL;
+	gjs->shared_inner = NULL;
+	gjs->inner_cache_ref = NULL;
+	gjs->inner_cache_tokens = NULL;
+	/* identity order on the beginning; may be revised at runtime */
+	gjs->depth_reorderable = (gj_info->depth_reorderable &&
+							  gpujoin_adaptive_reorder);
+	gjs->depth_order = palloc0(sizeof(cl_int) * (gj_info->num_rels + 1));
+	gjs->depth_work = palloc0(sizeof(cl_int) * (gj_info->num_rels + 1));
+	gjs->depth_ratio = palloc0(sizeof(double) * (gj_info->num_rels + 1));
 
 	/*
 	 * NOTE: outer_quals, hash_outer_keys and join_quals are intended
@@ -1954,6 +2506,7 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 		Expr	   *other_quals;
 		List	   *hash_inner_keys;
 		List	   *hash_outer_keys;
+		List	   *range_inner_keys;
 		TupleTableSlot *inner_slot;
 		double		plan_nrows_in;
 		double		plan_nrows_out;
@@ -1965,6 +2518,8 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 		plan_nrows_out = floatVal(list_nth(gj_info->plan_nrows_out, i));
 		istate->nrows_ratio = plan_nrows_out / Max(plan_nrows_in, 1.0);
 		istate->ichunk_size = list_nth_int(gj_info->ichunk_size, i);
+		istate->inner_nparts = list_nth_int(gj_info->inner_nparts, i);
+		gjs->depth_order[i+1] = i+1;
 		istate->join_type = (JoinType)list_nth_int(gj_info->join_types, i);
 
 		/*
@@ -2037,6 +2592,30 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 			}
 		}
 
+		range_inner_keys = list_nth(gj_info->range_inner_keys, i);
+		if (range_inner_keys != NIL)
+		{
+			Expr	   *i_lower;
+			Expr	   *i_upper;
+
+			range_inner_keys = fixup_varnode_to_origin(i+1,
+													   gj_info->ps_src_depth,
+													   gj_info->ps_src_resno,
+													   range_inner_keys);
+			i_lower = linitial(range_inner_keys);
+			i_upper = lsecond(range_inner_keys);
+			if (i_lower)
+			{
+				istate->range_inner_lower = ExecInitExpr(i_lower, &ss->ps);
+				istate->range_lower_type = exprType((Node *)i_lower);
+			}
+			if (i_upper)
+			{
+				istate->range_inner_upper = ExecInitExpr(i_upper, &ss->ps);
+				istate->range_upper_type = exprType((Node *)i_upper);
+			}
+		}
+
 		/*
 		 * CPU fallback setup for INNER reference
 		 */
@@ -2071,6 +2650,10 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 										 istate->state);
 	}
 
+	/* identity of the inner buffer, if sibling GpuJoins can share it */
+	gjs->inner_signature = gpujoin_inner_signature(gjs, cscan, gj_info,
+												   estate);
+
 	/*
 	 * Construct CUDA program, and kick asynchronous compile process.
 	 * Note that assign_gpujoin_session_info() is called back from
@@ -2078,6 +2661,8 @@ ExecInitGpuJoin(CustomScanState *node, EState *estate, int eflags)
 	 * to be set prior to the program assignment.
 	 */
 	gjs->extra_maxlen = gj_info->extra_maxlen;
+	gjs->hcache_ngroups = gj_info->hcache_ngroups;
+	gjs->gts.varlena_bufsz = gj_info->varlena_bufsz;
 
 	initStringInfo(&kern_define);
 	pgstrom_build_session_info(&kern_define,
@@ -2180,6 +2765,9 @@ ExecReScanGpuJoin(CustomScanState *node)
 		/* rewind the inner hash/heap buffer */
 		GpuJoinInnerUnload(&gjs->gts, true);
 	}
+	/* rewind the partitioned inner hash table, if still loaded */
+	if (gjs->part_depth > 0 && gjs->curr_part != 0)
+		gpujoinSwitchInnerPartition(gjs, 0);
 	/* common rescan handling */
 	pgstromRescanGpuTaskState(&gjs->gts);
 }
@@ -2259,8 +2847,12 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 		Expr	   *join_quals = lfirst(lc2);
 		Expr	   *other_quals = lfirst(lc3);
 		Expr	   *hash_outer_key = lfirst(lc4);
+		List	   *range_outer_keys;
+		ListCell   *lc5;
 		innerState *istate = &gjs->inners[depth-1];
 		kern_data_store *kds_in = NULL;
+		bool		is_sorted = false;
+		cl_uint		heavy_nkeys = 0;
 		int			indent_width;
 		double		plan_nrows_in;
 		double		plan_nrows_out;
@@ -2272,6 +2864,8 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 		{
 			kern_multirels *kmrels = dsm_segment_address(gjs->seg_kmrels);
 			kds_in = KERN_MULTIRELS_INNER_KDS(kmrels, depth);
+			is_sorted = kmrels->chunks[depth-1].sorted_probe;
+			heavy_nkeys = kmrels->chunks[depth-1].heavy_nitems;
 		}
 
 		/* fetch number of rows */
@@ -2279,9 +2873,13 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 		plan_nrows_out = floatVal(list_nth(gj_info->plan_nrows_out, depth-1));
 		if (gj_rtstat)
 		{
-			exec_nrows_in = (double)
-				(pg_atomic_read_u64(&gj_rtstat->jstat[depth-1].inner_nitems) +
-				 pg_atomic_read_u64(&gj_rtstat->jstat[depth-1].right_nitems));
+			if (gj_info->depth_reorderable)
+				exec_nrows_in = (double)
+					pg_atomic_read_u64(&gj_rtstat->jstat[depth].input_nitems);
+			else
+				exec_nrows_in = (double)
+					(pg_atomic_read_u64(&gj_rtstat->jstat[depth-1].inner_nitems) +
+					 pg_atomic_read_u64(&gj_rtstat->jstat[depth-1].right_nitems));
 			exec_nrows_out1 = (double)
 				pg_atomic_read_u64(&gj_rtstat->jstat[depth].inner_nitems);
 			exec_nrows_out2 = (double)
@@ -2294,14 +2892,18 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 			appendStringInfo(&str, "GpuHash%sJoin",
 							 join_type == JOIN_FULL ? "Full" :
 							 join_type == JOIN_LEFT ? "Left" :
-							 join_type == JOIN_RIGHT ? "Right" : "");
+							 join_type == JOIN_RIGHT ? "Right" :
+							 join_type == JOIN_SEMI ? "Semi" :
+							 join_type == JOIN_ANTI ? "Anti" : "");
 		}
 		else
 		{
 			appendStringInfo(&str, "GpuNestLoop%s",
 							 join_type == JOIN_FULL ? "Full" :
 							 join_type == JOIN_LEFT ? "Left" :
-							 join_type == JOIN_RIGHT ? "Right" : "");
+							 join_type == JOIN_RIGHT ? "Right" :
+							 join_type == JOIN_SEMI ? "Semi" :
+							 join_type == JOIN_ANTI ? "Anti" : "");
 		}
 		snprintf(qlabel, sizeof(qlabel), "Depth% 2d", depth);
 		indent_width = es->indent * 2 + strlen(qlabel) + 2;
@@ -2377,6 +2979,34 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 			}
 		}
 
+		/*
+		 * RangeKeys, if any
+		 */
+		range_outer_keys = list_nth(gj_info->range_outer_keys, depth-1);
+		if (range_outer_keys != NIL)
+		{
+			List	   *range_bounds = NIL;
+
+			foreach (lc5, range_outer_keys)
+			{
+				if (lfirst(lc5))
+					range_bounds = lappend(range_bounds, lfirst(lc5));
+			}
+			temp = deparse_expression((Node *)range_bounds,
+									  dcontext, true, false);
+			if (es->format == EXPLAIN_FORMAT_TEXT)
+			{
+				appendStringInfoSpaces(es->str, indent_width);
+				appendStringInfo(es->str, "RangeKeys: %s\n", temp);
+			}
+			else
+			{
+				snprintf(qlabel, sizeof(qlabel),
+						 "Depth% 2d RangeKeys", depth);
+				ExplainPropertyText(qlabel, temp, es);
+			}
+		}
+
 		/*
 		 * JoinQuals, if any
 		 */
@@ -2424,18 +3054,25 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 			appendStringInfoSpaces(es->str, indent_width);
 			if (!es->analyze)
 			{
-				appendStringInfo(es->str, "KDS-%s (size: %s)",
+				appendStringInfo(es->str, "KDS-%s (size: %s",
 								 hash_outer_key ? "Hash" : "Heap",
 								 format_bytesz(istate->ichunk_size));
 			}
 			else
 			{
-				appendStringInfo(es->str, "KDS-%s (size plan: %s, exec: %s)",
+				appendStringInfo(es->str, "KDS-%s (size plan: %s, exec: %s",
 								 hash_outer_key ? "Hash" : "Heap",
 								 format_bytesz(istate->ichunk_size),
 								 format_bytesz(kds_in->length));
 			}
-			appendStringInfoChar(es->str, '\n');
+			if (istate->inner_nparts > 1)
+				appendStringInfo(es->str, ", partitions: %d",
+								 istate->inner_nparts);
+			if (is_sorted)
+				appendStringInfo(es->str, ", sorted");
+			if (heavy_nkeys > 0)
+				appendStringInfo(es->str, ", heavy hitters: %u", heavy_nkeys);
+			appendStringInfo(es->str, ")\n");
 		}
 		else
 		{
@@ -2454,6 +3091,24 @@ ExplainGpuJoin(CustomScanState *node, List *ancestors, ExplainState *es)
 						 "Depth % 2d KDS Exec Size", depth);
 				ExplainPropertyText(qlabel, format_bytesz(kds_in->length), es);
 			}
+			if (istate->inner_nparts > 1)
+			{
+				snprintf(qlabel, sizeof(qlabel),
+						 "Depth % 2d KDS Partitions", depth);
+				ExplainPropertyInteger(qlabel, istate->inner_nparts, es);
+			}
+			if (is_sorted)
+			{
+				snprintf(qlabel, sizeof(qlabel),
+						 "Depth % 2d KDS Probe", depth);
+				ExplainPropertyText(qlabel, "Sorted", es);
+			}
+			if (heavy_nkeys > 0)
+			{
+				snprintf(qlabel, sizeof(qlabel),
+						 "Depth % 2d KDS Heavy Hitters", depth);
+				ExplainPropertyInteger(qlabel, heavy_nkeys, es);
+			}
 		}
 		depth++;
 	}
@@ -2496,6 +3151,7 @@ ExecGpuJoinInitDSM(CustomScanState *node,
 	/* allocation of an empty multirel buffer */
 	gjs->gj_sstate = createGpuJoinSharedState(gjs, pcxt, coordinate);
 	gjs->gj_rtstat = GPUJOIN_RUNTIME_STAT(gjs->gj_sstate);
+	gjs->gts.gt_rtstat = &gjs->gj_rtstat->c;
 	ExecGpuScanInitDSM(node, pcxt, ((char *)coordinate +
 									gjs->gj_sstate->ss_length));
 }
@@ -2513,6 +3169,7 @@ ExecGpuJoinInitWorker(CustomScanState *node,
 
 	gjs->gj_sstate = gj_sstate;
 	gjs->gj_rtstat = GPUJOIN_RUNTIME_STAT(gjs->gj_sstate);
+	gjs->gts.gt_rtstat = &gjs->gj_rtstat->c;
 	/* ensure to stop workers prior to detach DSM */
 	on_dsm_detach(dsm_find_mapping(gj_sstate->ss_handle),
 				  SynchronizeGpuContextOnDSMDetach,
@@ -2549,6 +3206,7 @@ ExecShutdownGpuJoin(CustomScanState *node)
 	gjs->gj_rtstat = MemoryContextAlloc(CurTransactionContext,
 										MAXALIGN(length));
 	memcpy(gjs->gj_rtstat, gj_rtstat_old, length);
+	gjs->gts.gt_rtstat = &gjs->gj_rtstat->c;
 }
 #endif
 
@@ -2736,7 +3394,8 @@ gpujoin_codegen_var_param_decl(StringInfo source,
 					"    if (!o_buffer)\n"
 					"      htup = NULL;\n"
 					"    else\n"
-					"      htup = KDS_ROW_REF_HTUP(kds_in,o_buffer[%d],\n"
+					"      htup = KDS_ROW_REF_HTUP(kds_in,\n"
+					"                  o_buffer[GPUJOIN_DEPTH_POS(%d)],\n"
 					"                              NULL, NULL);\n",
 					depth,
 					depth,
@@ -2898,6 +3557,54 @@ gpujoin_codegen_join_quals(StringInfo source,
 		"\n");
 }
 
+/*
+ * gpujoin_hash_keys_source_only
+ *
+ * It checks whether the hash keys reference only the columns of the source
+ * relation (depth=0). Hash-value of such keys are identical for all the
+ * combinations derived from a particular source row, so GPU kernel can
+ * cache it per source row.
+ */
+static bool
+gpujoin_hash_keys_source_only(GpuJoinInfo *gj_info,
+							  List *outer_keys,
+							  codegen_context *context)
+{
+	List	   *vars_list;
+	ListCell   *cell;
+	bool		retval = true;
+
+	vars_list = pull_var_clause((Node *)outer_keys,
+								PVC_RECURSE_PLACEHOLDERS);
+	foreach (cell, vars_list)
+	{
+		Var		   *varnode = lfirst(cell);
+		ListCell   *lc1;
+		ListCell   *lc2;
+		int			src_depth = -1;
+
+		forboth (lc1, context->pseudo_tlist,
+				 lc2, gj_info->ps_src_depth)
+		{
+			TargetEntry *tle = lfirst(lc1);
+
+			if (equal(tle->expr, varnode))
+			{
+				src_depth = lfirst_int(lc2);
+				break;
+			}
+		}
+		if (src_depth != 0)
+		{
+			retval = false;
+			break;
+		}
+	}
+	list_free(vars_list);
+
+	return retval;
+}
+
 /*
  * codegen for:
  * STATIC_FUNCTION(cl_uint)
@@ -2986,6 +3693,94 @@ gpujoin_codegen_hash_value(StringInfo source,
 	pfree(body.data);
 }
 
+/*
+ * codegen for:
+ * STATIC_FUNCTION(void)
+ * gpujoin_range_keys_depth%u(kern_context *kcxt,
+ *                            kern_data_store *kds,
+ *                            kern_multirels *kmrels,
+ *                            cl_uint *o_buffer,
+ *                            cl_long *p_lower,
+ *                            cl_long *p_upper)
+ */
+static void
+gpujoin_codegen_range_keys(StringInfo source,
+						   GpuJoinInfo *gj_info,
+						   int cur_depth,
+						   codegen_context *context)
+{
+	StringInfoData	body;
+	List		   *range_outer_keys;
+	ListCell	   *lc;
+	bool			is_lower = true;
+
+	Assert(cur_depth > 0 && cur_depth <= gj_info->num_rels);
+	range_outer_keys = list_nth(gj_info->range_outer_keys, cur_depth - 1);
+	Assert(list_length(range_outer_keys) == 2);
+
+	appendStringInfo(
+		source,
+		"STATIC_FUNCTION(void)\n"
+		"gpujoin_range_keys_depth%u(kern_context *kcxt,\n"
+		"                          kern_data_store *kds,\n"
+		"                          kern_multirels *kmrels,\n"
+		"                          cl_uint *o_buffer,\n"
+		"                          cl_long *p_lower,\n"
+		"                          cl_long *p_upper)\n"
+		"{\n"
+		"  pg_anytype_t temp    __attribute__((unused));\n",
+		cur_depth);
+
+	context->used_vars = NIL;
+	context->param_refs = NULL;
+
+	initStringInfo(&body);
+	appendStringInfo(
+		&body,
+		"  /* bounds of the range keys */\n"
+		"  *p_lower = LONG_MIN;\n"
+		"  *p_upper = LONG_MAX;\n");
+	foreach (lc, range_outer_keys)
+	{
+		Node	   *key_expr = lfirst(lc);
+		Oid			key_type;
+		devtype_info *dtype;
+
+		if (key_expr)
+		{
+			key_type = exprType(key_expr);
+			dtype = pgstrom_devtype_lookup(key_type);
+			if (!dtype)
+				elog(ERROR, "Bug? device type \"%s\" not found",
+					 format_type_be(key_type));
+			appendStringInfo(
+				&body,
+				"  temp.%s_v = %s;\n"
+				"  if (!temp.%s_v.isnull)\n"
+				"    *%s = (cl_long)temp.%s_v.value;\n",
+				dtype->type_name,
+				pgstrom_codegen_expression(key_expr, context),
+				dtype->type_name,
+				is_lower ? "p_lower" : "p_upper",
+				dtype->type_name);
+		}
+		is_lower = false;
+	}
+
+	/*
+	 * variable/params declaration & initialization
+	 */
+	gpujoin_codegen_var_param_decl(source, gj_info,
+								   cur_depth, context);
+	appendStringInfo(
+		source,
+		"%s"
+		"}\n"
+		"\n",
+		body.data);
+	pfree(body.data);
+}
+
 /*
  * gpujoin_codegen_projection
  *
@@ -3133,7 +3928,7 @@ gpujoin_codegen_projection(StringInfo source,
 		appendStringInfo(
 			&body,
 			"  /* ---- extract %s relation (depth=%d) */\n"
-			"  offset = r_buffer[%d];\n",
+			"  offset = r_buffer[GPUJOIN_DEPTH_POS(%d)];\n",
 			depth > 0 ? "inner" : "outer", depth,
 			depth);
 
@@ -3574,6 +4369,7 @@ gpujoin_codegen(PlannerInfo *root,
 				codegen_context *context)
 {
 	StringInfoData source;
+	List	   *hcache_keys;
 	int			depth;
 	ListCell   *cell;
 
@@ -3585,6 +4381,10 @@ gpujoin_codegen(PlannerInfo *root,
 	codegen_gpuscan_quals(&source,
 						  context,
 						  cscan->scan.scanrelid,
+						  (cscan->scan.scanrelid > 0
+						   ? planner_rt_fetch(cscan->scan.scanrelid,
+											  root)->relid
+						   : InvalidOid),
 						  gj_info->outer_quals);
 	/*
 	 * gpujoin_join_quals
@@ -3637,24 +4437,58 @@ gpujoin_codegen(PlannerInfo *root,
 
 	/*
 	 * gpujoin_hash_value
+	 *
+	 * Depths whose hash keys reference only the source relation fetch the
+	 * hash-value from the cache if any. Depths with identical keys share
+	 * the same key group of the cache.
 	 */
 	appendStringInfo(
 		&source,
 		"STATIC_FUNCTION(cl_uint)\n"
 		"gpujoin_hash_value(kern_context *kcxt,\n"
 		"                   cl_uint *pg_crc32_table,\n"
+		"                   kern_gpujoin *kgjoin,\n"
 		"                   kern_data_store *kds,\n"
 		"                   kern_multirels *kmrels,\n"
 		"                   cl_int depth,\n"
 		"                   cl_uint *o_buffer,\n"
 		"                   cl_bool *p_is_null_keys)\n"
 		"{\n"
+		"  cl_ulong *hslot    __attribute__((unused));\n"
+		"  cl_uint   hash     __attribute__((unused));\n"
+		"\n"
 		"  switch (depth)\n"
 		"  {\n");
+	hcache_keys = NIL;
 	depth = 1;
 	foreach (cell, gj_info->hash_outer_keys)
 	{
-		if (lfirst(cell) != NULL)
+		List	   *outer_keys = lfirst(cell);
+		int			hgroup = -1;
+
+		if (outer_keys != NIL &&
+			gpujoin_hash_keys_source_only(gj_info, outer_keys, context))
+		{
+			ListCell   *lc;
+			int			index = 0;
+
+			foreach (lc, hcache_keys)
+			{
+				if (equal(lfirst(lc), outer_keys))
+				{
+					hgroup = index;
+					break;
+				}
+				index++;
+			}
+			if (hgroup < 0)
+			{
+				hgroup = list_length(hcache_keys);
+				hcache_keys = lappend(hcache_keys, outer_keys);
+			}
+		}
+
+		if (outer_keys != NIL && hgroup < 0)
 		{
 			appendStringInfo(
 				&source,
@@ -3664,8 +4498,26 @@ gpujoin_codegen(PlannerInfo *root,
 				"                                      p_is_null_keys);\n",
 				depth, depth);
 		}
+		else if (outer_keys != NIL)
+		{
+			appendStringInfo(
+				&source,
+				"  case %u:\n"
+				"    hslot = gpujoin_hash_cache_slot(kgjoin,%d,o_buffer);\n"
+				"    if (gpujoin_hash_cache_fetch(hslot,&hash,p_is_null_keys))\n"
+				"      return hash;\n"
+				"    hash = gpujoin_hash_value_depth%u(kcxt,pg_crc32_table,\n"
+				"                                      kds,kmrels,o_buffer,\n"
+				"                                      p_is_null_keys);\n"
+				"    gpujoin_hash_cache_store(hslot,hash,*p_is_null_keys);\n"
+				"    return hash;\n",
+				depth, hgroup, depth);
+		}
 		depth++;
 	}
+	gj_info->hcache_ngroups = list_length(hcache_keys);
+	list_free(hcache_keys);
+
 	appendStringInfo(
 		&source,
 		"  default:\n"
@@ -3676,6 +4528,56 @@ gpujoin_codegen(PlannerInfo *root,
 		"}\n"
 		"\n");
 
+	depth = 1;
+	foreach (cell, gj_info->range_outer_keys)
+	{
+		if (lfirst(cell) != NIL)
+			gpujoin_codegen_range_keys(&source, gj_info, depth, context);
+		depth++;
+	}
+
+	/*
+	 * gpujoin_range_keys
+	 */
+	appendStringInfo(
+		&source,
+		"STATIC_FUNCTION(void)\n"
+		"gpujoin_range_keys(kern_context *kcxt,\n"
+		"                   kern_data_store *kds,\n"
+		"                   kern_multirels *kmrels,\n"
+		"                   cl_int depth,\n"
+		"                   cl_uint *o_buffer,\n"
+		"                   cl_long *p_lower,\n"
+		"                   cl_long *p_upper)\n"
+		"{\n"
+		"  switch (depth)\n"
+		"  {\n");
+	depth = 1;
+	foreach (cell, gj_info->range_outer_keys)
+	{
+		if (lfirst(cell) != NIL)
+		{
+			appendStringInfo(
+				&source,
+				"  case %u:\n"
+				"    gpujoin_range_keys_depth%u(kcxt,kds,kmrels,o_buffer,\n"
+				"                               p_lower,p_upper);\n"
+				"    return;\n",
+				depth, depth);
+		}
+		depth++;
+	}
+	appendStringInfo(
+		&source,
+		"  default:\n"
+		"    STROM_SET_ERROR(&kcxt->e, StromError_WrongCodeGeneration);\n"
+		"    break;\n"
+		"  }\n"
+		"  *p_lower = LONG_MIN;\n"
+		"  *p_upper = LONG_MAX;\n"
+		"}\n"
+		"\n");
+
 	/*
 	 * gpujoin_projection
 	 */
@@ -3685,6 +4587,74 @@ gpujoin_codegen(PlannerInfo *root,
 	return source.data;
 }
 
+/*
+ * gpujoin_revise_depth_order
+ *
+ * It revises the order of depths to be run on the next task, according to
+ * the selectivity of each depth observed at runtime. Only INNER hash-join
+ * whose quals are independent from other depths are reordered, so each
+ * depth reduces (or increases) rows by its own ratio regardless of the
+ * order. Then, the order by ascending ratio minimizes the total number of
+ * rows to be probed on the intermediation depths.
+ */
+static void
+gpujoin_revise_depth_order(GpuJoinState *gjs)
+{
+	GpuJoinRuntimeStat *gj_rtstat = gjs->gj_rtstat;
+	cl_int	   *depth_order = gjs->depth_order;
+	cl_int	   *best_order = gjs->depth_work;
+	double	   *depth_ratio = gjs->depth_ratio;
+	cl_int		nrels = gjs->num_rels;
+	double		curr_cost = 0.0;
+	double		best_cost = 0.0;
+	double		nrows;
+	cl_int		i, j;
+
+	if (!gj_rtstat)
+		return;
+	for (i=1; i <= nrels; i++)
+	{
+		cl_ulong	nitems_in;
+		cl_ulong	nitems_out;
+
+		nitems_in  = pg_atomic_read_u64(&gj_rtstat->jstat[i].input_nitems);
+		nitems_out = pg_atomic_read_u64(&gj_rtstat->jstat[i].inner_nitems);
+
+		if (nitems_in >= GPUJOIN_REORDER_MIN_NITEMS)
+			depth_ratio[i] = (double)nitems_out / (double)nitems_in;
+		else
+			depth_ratio[i] = gjs->inners[i-1].nrows_ratio;
+	}
+
+	/* sort depths by ascending ratio */
+	best_order[0] = 0;
+	for (i=1; i <= nrels; i++)
+	{
+		for (j=i; j > 1 && depth_ratio[best_order[j-1]] > depth_ratio[i]; j--)
+			best_order[j] = best_order[j-1];
+		best_order[j] = i;
+	}
+
+	/* cost is the total number of rows to be probed */
+	for (i=1, nrows=1.0; i <= nrels; i++)
+	{
+		curr_cost += nrows;
+		nrows *= depth_ratio[depth_order[i]];
+	}
+	for (i=1, nrows=1.0; i <= nrels; i++)
+	{
+		best_cost += nrows;
+		nrows *= depth_ratio[best_order[i]];
+	}
+
+	if (best_cost < curr_cost * GPUJOIN_REORDER_THRESHOLD)
+	{
+		memcpy(depth_order, best_order, sizeof(cl_int) * (nrels + 1));
+		elog(DEBUG2, "GpuJoin: depth order was revised (cost %.2f -> %.2f)",
+			 curr_cost, best_cost);
+	}
+}
+
 /*
  * GpuJoinSetupTask
  */
@@ -3700,11 +4670,16 @@ GpuJoinSetupTask(struct kern_gpujoin *kgjoin, GpuTaskState *gts,
 	size_t		pstack_sz;
 	size_t		pstack_nrooms;
 	size_t		suspend_sz;
+	size_t		hcache_offset;
+	size_t		hcache_nitems = 0;
+	size_t		hcache_sz = 0;
 	int			mp_count;
+	int			i;
 
 	mp_count = devAttrs[gcontext->cuda_dindex].MULTIPROCESSOR_COUNT;
 	head_sz = STROMALIGN(offsetof(kern_gpujoin,
-								  stat_nitems[gjs->num_rels + 1]));
+								  stat_nitems[gjs->num_rels + 1]) +
+						 sizeof(cl_uint) * (gjs->num_rels + 1));	/* order */
 	param_sz = STROMALIGN(gjs->gts.kern_params->length);
 	pstack_nrooms = 2048;
 	pstack_sz = MAXALIGN(sizeof(cl_uint) *
@@ -3725,6 +4700,21 @@ GpuJoinSetupTask(struct kern_gpujoin *kgjoin, GpuTaskState *gts,
 				  /* threads[] array */
 				  (MAXALIGN(sizeof(cl_uint) * (nrels + 1)) +
 				   MAXALIGN(sizeof(cl_bool) * (nrels + 1))) * 1024);
+	/*
+	 * hash-value cache, if source rows have dense row-index
+	 */
+	hcache_offset = STROMALIGN(head_sz + param_sz +
+							   mp_count * pstack_sz +
+							   mp_count * suspend_sz);
+	if (pds_src &&
+		pds_src->kds.format == KDS_FORMAT_COLUMN &&
+		gjs->hcache_ngroups > 0)
+	{
+		hcache_nitems = pds_src->kds.nitems;
+		hcache_sz = STROMALIGN(sizeof(cl_ulong) * hcache_nitems *
+							   gjs->hcache_ngroups);
+	}
+
 	if (kgjoin)
 	{
 		memset(kgjoin, 0, head_sz);
@@ -3732,17 +4722,46 @@ GpuJoinSetupTask(struct kern_gpujoin *kgjoin, GpuTaskState *gts,
 		kgjoin->pstack_offset = head_sz + param_sz;
 		kgjoin->pstack_nrooms = pstack_nrooms;
 		kgjoin->suspend_offset = head_sz + param_sz + mp_count * pstack_sz;
+		kgjoin->hcache_offset = hcache_offset;
+		kgjoin->hcache_nitems = hcache_nitems;
+		kgjoin->hcache_ngroups = (hcache_nitems > 0 ? gjs->hcache_ngroups : 0);
 		kgjoin->num_rels = gjs->num_rels;
 		kgjoin->src_read_pos = 0;
 
+		/* order of depths to be run */
+		if (gjs->depth_reorderable)
+			gpujoin_revise_depth_order(gjs);
+		for (i=0; i <= nrels; i++)
+			KERN_GPUJOIN_DEPTH_ORDER(kgjoin)[i] = gjs->depth_order[i];
+
 		/* kern_parambuf */
 		memcpy(KERN_GPUJOIN_PARAMBUF(kgjoin),
 			   gjs->gts.kern_params,
 			   gjs->gts.kern_params->length);
 	}
-	return (head_sz + param_sz +
-			mp_count * pstack_sz +
-			mp_count * suspend_sz);
+	return hcache_offset + hcache_sz;
+}
+
+/*
+ * gpujoinResetHashCache
+ *
+ * It clears the hash-value cache prior to the first kernel invocation,
+ * if any. Note that the cache shall be kept on resume of the kernel.
+ */
+void
+gpujoinResetHashCache(kern_gpujoin *kgjoin)
+{
+	CUresult	rc;
+
+	if (kgjoin->hcache_nitems == 0 || kgjoin->hcache_ngroups == 0)
+		return;
+	rc = cuMemsetD32Async((CUdeviceptr)KERN_GPUJOIN_HASH_CACHE(kgjoin),
+						  0,
+						  KERN_GPUJOIN_HASH_CACHE_LENGTH(kgjoin) /
+						  sizeof(cl_uint),
+						  CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemsetD32Async: %s", errorText(rc));
 }
 
 /*
@@ -3879,6 +4898,27 @@ gpujoin_next_task(GpuTaskState *gts)
 	return gtask;
 }
 
+/*
+ * gpujoin_async_fallback
+ *
+ * It prepares the GpuJoinTask to be processed by CPU, during JIT build.
+ */
+static bool
+gpujoin_async_fallback(GpuTask *gtask)
+{
+	GpuJoinTask	   *pgjoin = (GpuJoinTask *) gtask;
+	pgstrom_data_store *pds_src = pgjoin->pds_src;
+
+	if (!pds_src)
+		return false;
+	/* blocks to be loaded by NVMe-Strom must be on the host memory */
+	if (pds_src->kds.format == KDS_FORMAT_BLOCK)
+		PDS_fillup_blocks(pds_src);
+	pgjoin->with_nvme_strom = false;
+
+	return true;
+}
+
 /*
  * gpujoinNextRightOuterJoin
  */
@@ -3985,6 +5025,24 @@ gpujoin_terminator_task(GpuTaskState *gts, cl_bool *task_is_ready)
 	GpuTask		   *gtask = NULL;
 	cl_int			outer_depth;
 
+	/*
+	 * Switch to the next inner partition, then rewind the outer relation
+	 * to run GpuJoin for the new partition. fetch_next_gputask() resumes
+	 * the outer scan because scan_done is reset here.
+	 */
+	if (gjs->part_depth > 0 &&
+		gjs->curr_part + 1 < gjs->inners[gjs->part_depth - 1].inner_nparts)
+	{
+		gpujoinSwitchInnerPartition(gjs, gjs->curr_part + 1);
+		if (gjs->gts.css.ss.ss_currentRelation)
+			gpuscanRewindScanChunk(&gjs->gts);
+		else
+			ExecReScan(outerPlanState(gjs));
+		gjs->gts.scan_overflow = NULL;
+		gjs->gts.scan_done = false;
+		return NULL;
+	}
+
 	/* Has RIGHT/FULL OUTER JOIN? */
 	if (gpujoinHasRightOuterJoin(&gjs->gts))
 	{
@@ -4251,6 +5309,9 @@ gpujoinFallbackHashJoin(int depth, GpuJoinState *gjs)
 	cl_uint			hash;
 	bool			retval;
 
+	/* SEMI JOIN already generated the outer row */
+	if (istate->join_type == JOIN_SEMI && istate->fallback_inner_matched)
+		goto end;
 	do {
 		if (istate->fallback_inner_index == 0)
 		{
@@ -4302,6 +5363,10 @@ gpujoinFallbackHashJoin(int depth, GpuJoinState *gjs)
 	/* update outer join map */
 	if (ojmaps)
 		ojmaps[khitem->rowid] = 1;
+	istate->fallback_inner_matched = true;
+	/* ANTI JOIN generates nothing once matched */
+	if (istate->join_type == JOIN_ANTI)
+		goto end;
 	/* rewind the next depth */
 	if (depth < gjs->num_rels)
 	{
@@ -4314,7 +5379,8 @@ gpujoinFallbackHashJoin(int depth, GpuJoinState *gjs)
 end:
 	if (!istate->fallback_inner_matched &&
 		(istate->join_type == JOIN_LEFT ||
-		 istate->join_type == JOIN_FULL))
+		 istate->join_type == JOIN_FULL ||
+		 istate->join_type == JOIN_ANTI))
 	{
 		istate->fallback_inner_matched = true;
 		gpujoin_fallback_tuple_extract(gjs->slot_fallback,
@@ -4378,6 +5444,15 @@ gpujoinFallbackNestLoop(int depth, GpuJoinState *gjs)
 			/* update outer join map */
 			if (ojmaps)
 				ojmaps[index] = 1;
+			istate->fallback_inner_matched = true;
+			/* SEMI/ANTI JOIN needs no more inner tuples */
+			if (istate->join_type == JOIN_SEMI ||
+				istate->join_type == JOIN_ANTI)
+			{
+				istate->fallback_inner_index = kds_in->nitems;
+				if (istate->join_type == JOIN_ANTI)
+					break;
+			}
 			/* rewind the next depth */
 			if (depth < gjs->num_rels)
 			{
@@ -4391,7 +5466,8 @@ gpujoinFallbackNestLoop(int depth, GpuJoinState *gjs)
 
 	if (!istate->fallback_inner_matched &&
 		(istate->join_type == JOIN_LEFT ||
-		 istate->join_type == JOIN_FULL))
+		 istate->join_type == JOIN_FULL ||
+		 istate->join_type == JOIN_ANTI))
 	{
 		istate->fallback_inner_index = kds_in->nitems;
 		istate->fallback_inner_matched = true;
@@ -4684,6 +5760,9 @@ GpuJoinCreateCombinedProgram(PlanState *node,
 
 	gj_info = deform_gpujoin_info((CustomScan *) gjs->gts.css.ss.ps.plan);
 	extra_flags = (gpa_extra_flags | gj_info->extra_flags);
+	/* per-thread varlena buffer is shared by GpuJoin and GpuPreAgg */
+	gpa_gts->varlena_bufsz = Max(gpa_gts->varlena_bufsz,
+								 gjs->gts.varlena_bufsz);
 	pgstrom_build_session_info(&kern_define,
 							   gpa_gts,
 							   extra_flags & ~DEVKERNEL_NEEDS_GPUJOIN);
@@ -4758,16 +5837,24 @@ gpujoinUpdateRunTimeStat(GpuTaskState *gts, kern_gpujoin *kgjoin)
 {
 	GpuJoinState	   *gjs = (GpuJoinState *)gts;
 	GpuJoinRuntimeStat *gj_rtstat = gjs->gj_rtstat;
+	cl_uint	   *depth_order = KERN_GPUJOIN_DEPTH_ORDER(kgjoin);
 	cl_int		i;
 
 	pg_atomic_fetch_add_u64(&gj_rtstat->source_nitems,
 							kgjoin->source_nitems);
 	pg_atomic_fetch_add_u64(&gj_rtstat->jstat[0].inner_nitems,
 							kgjoin->outer_nitems);
+	/* stat_nitems[] are counted per level, not per depth */
 	for (i=0; i < gjs->num_rels; i++)
 	{
-		pg_atomic_fetch_add_u64(&gj_rtstat->jstat[i+1].inner_nitems,
+		cl_uint		depth = depth_order[i+1];
+
+		pg_atomic_fetch_add_u64(&gj_rtstat->jstat[depth].inner_nitems,
 								kgjoin->stat_nitems[i]);
+		pg_atomic_fetch_add_u64(&gj_rtstat->jstat[depth].input_nitems,
+								i == 0
+								? kgjoin->outer_nitems
+								: kgjoin->stat_nitems[i-1]);
 	}
 }
 
@@ -4857,6 +5944,7 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	CUresult			rc;
 	size_t				grid_sz;
 	size_t				block_sz;
+	uint64				range_id;
 	cl_int				retval = 10001;
 	void			   *kern_args[10];
 
@@ -4876,7 +5964,18 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	/*
 	 * Device memory allocation
 	 */
-	if (pds_src->kds.format != KDS_FORMAT_BLOCK)
+	if (pds_src->kds_dev)
+	{
+		/* only referenced columns of the memory-mapped ccache */
+		rc = gpuMemAlloc(gcontext,
+						 &m_kds_src,
+						 pds_src->kds_dev->length);
+		if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+			goto out_of_resource;
+		else if (rc != CUDA_SUCCESS)
+			werror("failed on gpuMemAlloc: %s", errorText(rc));
+	}
+	else if (pds_src->kds.format != KDS_FORMAT_BLOCK)
 		m_kds_src = (CUdeviceptr)&pds_src->kds;
 	else
 	{
@@ -4910,8 +6009,13 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	/*
 	 * OK, kick a series of GpuJoin invocations
 	 */
-
-	if (pds_src->kds.format != KDS_FORMAT_BLOCK)
+	range_id = pgstromNvtxRangeStart(&gjs->gts, "DMA send");
+	pgstromStatTimingBegin(&gjs->gts);
+	if (pds_src->kds_dev)
+	{
+		gpuMemCopyFromMappedColumn(m_kds_src, pds_src);
+	}
+	else if (pds_src->kds.format != KDS_FORMAT_BLOCK)
 	{
 		rc = cuMemPrefetchAsync(m_kds_src,
 								pds_src->kds.length,
@@ -4934,6 +6038,30 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 		gpuMemCopyFromSSD(m_kds_src,
 						  pds_src);
 	}
+	pgstromStatDmaSend(&gjs->gts, PDS_DEVICE_KDS_HEAD(pds_src)->length);
+	pgstromNvtxRangeEnd(range_id);
+
+	/* bit-packed columns of ccache have to be expanded */
+	if (pds_src->kds.format == KDS_FORMAT_COLUMN &&
+		PDS_DEVICE_KDS_HEAD(pds_src)->has_packed)
+	{
+		CUdeviceptr	m_kds_unpack
+			= gpuscan_unpack_column_store(gcontext,
+										  cuda_module,
+										  PDS_DEVICE_KDS_HEAD(pds_src),
+										  m_kds_src);
+		if (m_kds_unpack == 0UL)
+			goto out_of_resource;
+		if (m_kds_src != (CUdeviceptr)&pds_src->kds)
+		{
+			/* source image on the device is no longer needed */
+			rc = cuStreamSynchronize(CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuStreamSynchronize: %s", errorText(rc));
+			gpuMemFree(gcontext, m_kds_src);
+		}
+		m_kds_src = m_kds_unpack;
+	}
 
 	/* Launch:
 	 * KERNEL_FUNCTION(void)
@@ -4952,6 +6080,9 @@ gpujoin_process_inner_join(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	if (rc != CUDA_SUCCESS)
 		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
 
+	/* clear the hash-value cache, if any */
+	gpujoinResetHashCache(&pgjoin->kern);
+
 resume_gpujoin:
 	kern_args[0] = &m_kgjoin;
 	kern_args[1] = &gjs->m_kmrels;
@@ -4959,6 +6090,8 @@ resume_gpujoin:
 	kern_args[3] = &m_kds_dst;
 	kern_args[4] = &m_nullptr;
 
+	range_id = pgstromNvtxRangeStart(&gjs->gts, "gpujoin_main");
+	pgstromStatTimingBegin(&gjs->gts);
 	rc = cuLaunchKernel(kern_gpujoin_main,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -4977,6 +6110,8 @@ resume_gpujoin:
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	pgstromStatKernelExec(&gjs->gts, "gpujoin_main", false);
+	pgstromNvtxRangeEnd(range_id);
 
 	if (pgstrom_cpu_fallback_enabled &&
 		pgjoin->kern.kerror.errcode == StromError_CpuReCheck)
@@ -5019,7 +6154,7 @@ resume_gpujoin:
 		retval = 0;
 	}
 out_of_resource:
-	if (pds_src->kds.format == KDS_FORMAT_BLOCK && m_kds_src != 0UL)
+	if (m_kds_src != 0UL && m_kds_src != (CUdeviceptr)&pds_src->kds)
 		gpuMemFree(gcontext, m_kds_src);
 	return retval;
 }
@@ -5038,6 +6173,7 @@ gpujoin_process_right_outer(GpuJoinTask *pgjoin, CUmodule cuda_module)
 	Size				grid_sz;
 	Size				block_sz;
 	void			   *kern_args[5];
+	uint64				range_id;
 	cl_int				retval;
 
 	/* sanity checks */
@@ -5076,6 +6212,8 @@ resume_gpujoin:
 	kern_args[3] = &m_kds_dst;
 	kern_args[4] = &m_nullptr;
 
+	range_id = pgstromNvtxRangeStart(&gjs->gts, "gpujoin_right_outer");
+	pgstromStatTimingBegin(&gjs->gts);
 	rc = cuLaunchKernel(kern_gpujoin_main,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -5094,6 +6232,8 @@ resume_gpujoin:
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	pgstromStatKernelExec(&gjs->gts, "gpujoin_right_outer", false);
+	pgstromNvtxRangeEnd(range_id);
 
 	pgjoin->task.kerror = pgjoin->kern.kerror;
 	if (pgstrom_cpu_fallback_enabled &&
@@ -5341,6 +6481,36 @@ gpujoin_compaction_inner_kds(kern_data_store *kds_in)
 	}
 }
 
+/*
+ * gpujoin_inner_hash_build
+ *
+ * It constructs hash table on the hash-format data store once all the
+ * inner tuples are loaded.
+ */
+static void
+gpujoin_inner_hash_build(kern_data_store *kds_hash)
+{
+	cl_uint		   *row_index;
+	cl_uint		   *hash_slot;
+	cl_uint			i, j;
+
+	kds_hash->nslots = __KDS_NSLOTS(kds_hash->nitems);
+	gpujoin_compaction_inner_kds(kds_hash);
+	/* construction of the hash table */
+	row_index = KERN_DATA_STORE_ROWINDEX(kds_hash);
+	hash_slot = KERN_DATA_STORE_HASHSLOT(kds_hash);
+	memset(hash_slot, 0, sizeof(cl_uint) * kds_hash->nslots);
+	for (i=0; i < kds_hash->nitems; i++)
+	{
+		kern_hashitem  *khitem = (kern_hashitem *)
+			((char *)kds_hash + row_index[i] - offsetof(kern_hashitem, t));
+		Assert(khitem->rowid == i);
+		j = khitem->hash % kds_hash->nslots;
+		khitem->next = hash_slot[j];
+		hash_slot[j] = (uintptr_t)khitem - (uintptr_t)kds_hash;
+	}
+}
+
 /*
  * gpujoin_inner_hash_preload
  *
@@ -5354,9 +6524,6 @@ gpujoin_inner_hash_preload(innerState *istate,
 						   size_t kds_offset)
 {
 	TupleTableSlot *scan_slot;
-	cl_uint		   *row_index;
-	cl_uint		   *hash_slot;
-	cl_uint			i, j;
 	pg_crc32		hash;
 	bool			is_null_keys;
 
@@ -5375,129 +6542,697 @@ gpujoin_inner_hash_preload(innerState *istate,
 		 * we don't need to keep this tuple in the 
 		 */
 		if (is_null_keys && (istate->join_type == JOIN_INNER ||
-							 istate->join_type == JOIN_LEFT))
+							 istate->join_type == JOIN_LEFT ||
+							 istate->join_type == JOIN_SEMI ||
+							 istate->join_type == JOIN_ANTI))
 			continue;
 
 		while (!KDS_insert_hashitem(kds_hash, scan_slot, hash))
 			kds_hash = gpujoin_expand_inner_kds(seg, kds_offset);
 	}
-	kds_hash->nslots = __KDS_NSLOTS(kds_hash->nitems);
-	gpujoin_compaction_inner_kds(kds_hash);
-	/* construction of the hash table */
-	row_index = KERN_DATA_STORE_ROWINDEX(kds_hash);
-	hash_slot = KERN_DATA_STORE_HASHSLOT(kds_hash);
-	memset(hash_slot, 0, sizeof(cl_uint) * kds_hash->nslots);
-	for (i=0; i < kds_hash->nitems; i++)
-	{
-		kern_hashitem  *khitem = (kern_hashitem *)
-			((char *)kds_hash + row_index[i] - offsetof(kern_hashitem, t));
-		Assert(khitem->rowid == i);
-		j = khitem->hash % kds_hash->nslots;
-		khitem->next = hash_slot[j];
-		hash_slot[j] = (uintptr_t)khitem - (uintptr_t)kds_hash;
-	}
+	gpujoin_inner_hash_build(kds_hash);
 }
 
 /*
- * gpujoin_inner_heap_preload
+ * gpujoin_inner_hash_partition_preload
  *
- * Preload inner relation to the data store with row-format, for nested-
- * loop execution.
+ * Preload inner relation to the multiple data stores with hash-format,
+ * according to the upper bits of hash value. Each partition is built on
+ * an individual DSM segment, then loaded to kern_multirels one by one.
+ * It returns the largest length of the partitions.
  */
-static void
-gpujoin_inner_heap_preload(innerState *istate,
-						   dsm_segment *seg,
-						   kern_data_store *kds_heap,
-						   size_t kds_offset)
+static size_t
+gpujoin_inner_hash_partition_preload(innerState *istate, TupleDesc ps_desc)
 {
-	PlanState	   *scan_ps = istate->state;
 	TupleTableSlot *scan_slot;
+	kern_data_store *kds_hash;
+	cl_int			i, nparts = istate->inner_nparts;
+	size_t			max_length = 0;
+	pg_crc32		hash;
+	bool			is_null_keys;
+
+	Assert(istate->join_type == JOIN_INNER && nparts > 1);
+	istate->seg_parts = MemoryContextAllocZero(CurTransactionContext,
+											   sizeof(dsm_segment *) * nparts);
+	for (i=0; i < nparts; i++)
+	{
+		dsm_segment	   *seg = dsm_create(pgstrom_chunk_size(), 0);
+
+		init_kernel_data_store(dsm_segment_address(seg),
+							   ps_desc,
+							   dsm_segment_map_length(seg),
+							   KDS_FORMAT_HASH,
+							   UINT_MAX);
+		istate->seg_parts[i] = seg;
+	}
 
 	for (;;)
 	{
-		scan_slot = ExecProcNode(scan_ps);
+		scan_slot = ExecProcNode(istate->state);
 		if (TupIsNull(scan_slot))
 			break;
+
 		(void)ExecFetchSlotTuple(scan_slot);
-		while (!KDS_insert_tuple(kds_heap, scan_slot))
-			kds_heap = gpujoin_expand_inner_kds(seg, kds_offset);
+		hash = get_tuple_hashvalue(istate, true, scan_slot,
+								   &is_null_keys);
+		/* NULL keys never match on INNER JOIN */
+		if (is_null_keys)
+			continue;
+
+		i = (cl_int)(((cl_ulong)hash * (cl_ulong)nparts) >> 32);
+		kds_hash = dsm_segment_address(istate->seg_parts[i]);
+		while (!KDS_insert_hashitem(kds_hash, scan_slot, hash))
+			kds_hash = gpujoin_expand_inner_kds(istate->seg_parts[i], 0);
 	}
-	Assert(kds_heap->nslots == 0);
-	gpujoin_compaction_inner_kds(kds_heap);
-	if (kds_heap->length > (size_t)UINT_MAX)
-		elog(ERROR, "GpuJoin: inner heap table larger than 4GB is not supported right now (%zu bytes)", kds_heap->length);		
+
+	for (i=0; i < nparts; i++)
+	{
+		kds_hash = dsm_segment_address(istate->seg_parts[i]);
+		gpujoin_inner_hash_build(kds_hash);
+		max_length = Max(max_length, kds_hash->length);
+	}
+	return max_length;
 }
 
 /*
- * gpujoin_inner_preload
+ * gpujoin_inner_bloom_build
  *
- * It preload inner relation to the DSM buffer once.
+ * It builds a bloom filter of the inner hash values next to the inner
+ * hash table, then returns the new usage of the kern_multirels.
+ * If inner hash table is partitioned, the bloom filter covers all the
+ * partitions, so we don't need to switch it for each partition.
  */
-static bool
-__gpujoin_inner_preload(GpuJoinState *gjs, bool with_cpu_parallel)
+static size_t
+gpujoin_inner_bloom_build(innerState *istate,
+						  dsm_segment *seg,
+						  size_t kmrels_usage)
 {
-	GpuContext	   *gcontext = gjs->gts.gcontext;
-	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
-	kern_multirels *h_kmrels;
-	kern_data_store *kds;
-	dsm_segment	   *seg;
-	int				i, num_rels = gjs->num_rels;
-	size_t			ojmaps_usage = 0;
-	size_t			kmrels_usage = 0;
-	size_t			required;
-
-	Assert(!IsParallelWorker());
-	gjs->m_kmrels_array = MemoryContextAllocZero(CurTransactionContext,
-											numDevAttrs * sizeof(CUdeviceptr));
-	seg = dsm_create(pgstrom_chunk_size(), 0);
-	h_kmrels = dsm_segment_address(seg);
-	kmrels_usage = STROMALIGN(offsetof(kern_multirels, chunks[num_rels]));
-	memset(h_kmrels, 0, kmrels_usage);
+	kern_multirels *h_kmrels = dsm_segment_address(seg);
+	kern_data_store *kds_hash;
+	cl_int		depth = istate->depth;
+	cl_int		i, nparts = (istate->seg_parts ? istate->inner_nparts : 1);
+	size_t		nitems = 0;
+	size_t		nwords;
+	size_t		dsm_length;
+	cl_uint	   *bloom;
+	cl_uint	   *row_index;
+	cl_uint		j, h1, h2;
 
-	/*
-	 * Load inner relations
-	 */
-	memcpy(h_kmrels->pg_crc32_table,
-		   pg_crc32_table,
-		   sizeof(pg_crc32_table));
-	for (i=0; i < num_rels; i++)
+	for (i=0; i < nparts; i++)
 	{
-		innerState	   *istate = &gjs->inners[i];
-		PlanState	   *scan_ps = istate->state;
-		TupleTableSlot *ps_slot = scan_ps->ps_ResultTupleSlot;
-		TupleDesc		ps_desc = ps_slot->tts_tupleDescriptor;
-		kern_data_store *kds;
-		size_t			dsm_length;
-		size_t			kds_length;
-		size_t			kds_head_sz;
-
-		/* expand DSM on demand */
+		kds_hash = (istate->seg_parts
+					? dsm_segment_address(istate->seg_parts[i])
+					: KERN_MULTIRELS_INNER_KDS(h_kmrels, depth));
+		nitems += kds_hash->nitems;
+	}
+	if (nitems == 0)
+		return kmrels_usage;
+
+	/* about 8 bits per inner tuple, for 2 hash functions */
+	nwords = 1UL << get_next_log2(Max(nitems / 4, 32));
+	nwords = Min(nwords, GPUJOIN_BLOOM_MAX_NWORDS);
+	dsm_length = dsm_segment_map_length(seg);
+	while (kmrels_usage + sizeof(cl_uint) * nwords > dsm_length)
+	{
+		h_kmrels = dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
 		dsm_length = dsm_segment_map_length(seg);
-		kds_head_sz = STROMALIGN(offsetof(kern_data_store,
-										  colmeta[ps_desc->natts]));
-		while (kmrels_usage + kds_head_sz > dsm_length)
-		{
-			h_kmrels = dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
+	}
+	bloom = (cl_uint *)((char *)h_kmrels + kmrels_usage);
+	memset(bloom, 0, sizeof(cl_uint) * nwords);
+
+	for (i=0; i < nparts; i++)
+	{
+		kds_hash = (istate->seg_parts
+					? dsm_segment_address(istate->seg_parts[i])
+					: KERN_MULTIRELS_INNER_KDS(h_kmrels, depth));
+		row_index = KERN_DATA_STORE_ROWINDEX(kds_hash);
+		for (j=0; j < kds_hash->nitems; j++)
+		{
+			kern_hashitem  *khitem = (kern_hashitem *)
+				((char *)kds_hash + row_index[j] - offsetof(kern_hashitem, t));
+
+			h1 = GPUJOIN_BLOOM_HASH1(khitem->hash);
+			h2 = GPUJOIN_BLOOM_HASH2(khitem->hash);
+			bloom[(h1 >> 5) & (nwords-1)] |= (1U << (h1 & 31));
+			bloom[(h2 >> 5) & (nwords-1)] |= (1U << (h2 & 31));
+		}
+	}
+	h_kmrels->chunks[depth-1].bloom_offset = kmrels_usage;
+	h_kmrels->chunks[depth-1].bloom_nwords = nwords;
+
+	return kmrels_usage + STROMALIGN(sizeof(cl_uint) * nwords);
+}
+
+/*
+ * kern_sorteditem_comp - comparison function of qsort
+ */
+static int
+kern_sorteditem_comp(const void *__a, const void *__b)
+{
+	const kern_sorteditem *a = __a;
+	const kern_sorteditem *b = __b;
+
+	if (a->hash < b->hash)
+		return -1;
+	if (a->hash > b->hash)
+		return 1;
+	/* keep the physical order of the items for better memory locality */
+	if (a->offset < b->offset)
+		return -1;
+	if (a->offset > b->offset)
+		return 1;
+	return 0;
+}
+
+/*
+ * gpujoin_inner_sorted_build
+ *
+ * It builds an array of the inner hash items sorted by the hash value next
+ * to the inner hash table, if inner hash table has many duplicated join
+ * keys. Then, GpuHashJoin merges the sequential items of the same hash
+ * value instead of the walk on the hash-slot chain.
+ * In addition, it picks up heavy hitter keys that have extremely many
+ * items, to be merged cooperatively by all the threads in a block.
+ * It returns the new usage of the kern_multirels.
+ */
+static size_t
+gpujoin_inner_sorted_build(innerState *istate,
+						   dsm_segment *seg,
+						   size_t kmrels_usage)
+{
+	kern_multirels *h_kmrels = dsm_segment_address(seg);
+	kern_data_store *kds_hash;
+	kern_sorteditem *sitems;
+	kern_heavyitem *hitems;
+	cl_int		depth = istate->depth;
+	cl_uint	   *row_index;
+	cl_uint		i, j, ndistincts;
+	cl_uint		nheavy = 0;
+	cl_uint		threshold = GPUJOIN_HEAVY_HITTER_MIN_NITEMS;
+	bool		sorted_probe = false;
+	size_t		sorted_sz;
+	size_t		heavy_sz;
+	size_t		dsm_length;
+
+	kds_hash = KERN_MULTIRELS_INNER_KDS(h_kmrels, depth);
+	if (kds_hash->nitems < Min(GPUJOIN_SORTED_INNER_MIN_NITEMS,
+							   GPUJOIN_HEAVY_HITTER_MIN_NITEMS))
+		return kmrels_usage;
+
+	sorted_sz = STROMALIGN(sizeof(kern_sorteditem) * kds_hash->nitems);
+	heavy_sz = STROMALIGN(sizeof(kern_heavyitem) *
+						  GPUJOIN_HEAVY_HITTER_MAX_NKEYS);
+	dsm_length = dsm_segment_map_length(seg);
+	while (kmrels_usage + sorted_sz + heavy_sz > dsm_length)
+	{
+		h_kmrels = dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
+		dsm_length = dsm_segment_map_length(seg);
+		kds_hash = KERN_MULTIRELS_INNER_KDS(h_kmrels, depth);
+	}
+	sitems = (kern_sorteditem *)((char *)h_kmrels + kmrels_usage);
+	hitems = (kern_heavyitem *)((char *)sitems + sorted_sz);
+	row_index = KERN_DATA_STORE_ROWINDEX(kds_hash);
+	for (i=0; i < kds_hash->nitems; i++)
+	{
+		kern_hashitem  *khitem = (kern_hashitem *)
+			((char *)kds_hash + row_index[i] - offsetof(kern_hashitem, t));
+
+		sitems[i].hash = khitem->hash;
+		sitems[i].offset = (uintptr_t)khitem - (uintptr_t)kds_hash;
+	}
+	qsort(sitems, kds_hash->nitems, sizeof(kern_sorteditem),
+		  kern_sorteditem_comp);
+
+	/* sorted items make sense only if many keys are duplicated */
+	for (i=1, ndistincts=1; i < kds_hash->nitems; i++)
+	{
+		if (sitems[i].hash != sitems[i-1].hash)
+			ndistincts++;
+	}
+	if (gpujoin_sorted_inner_enabled &&
+		kds_hash->nitems >= GPUJOIN_SORTED_INNER_MIN_NITEMS &&
+		kds_hash->nitems >= (size_t)ndistincts * GPUJOIN_SORTED_INNER_MIN_DUPS)
+		sorted_probe = true;
+
+	/*
+	 * Heavy hitter keys; threshold shall be raised if too many keys exceed
+	 * the threshold, because the table is looked up by every outer row.
+	 * MEMO: heavy hitters never generate LEFT OUTER rows, and SEMI/ANTI
+	 * JOIN stops the probe on the first match, so no need to merge them.
+	 */
+	if (gpujoin_heavy_hitter_enabled &&
+		istate->join_type != JOIN_LEFT &&
+		istate->join_type != JOIN_FULL &&
+		istate->join_type != JOIN_SEMI &&
+		istate->join_type != JOIN_ANTI)
+	{
+		for (;;)
+		{
+			nheavy = 0;
+			for (i=0; i < kds_hash->nitems; i = j)
+			{
+				for (j=i+1; (j < kds_hash->nitems &&
+							 sitems[j].hash == sitems[i].hash); j++);
+				if (j - i >= threshold)
+				{
+					if (nheavy < GPUJOIN_HEAVY_HITTER_MAX_NKEYS)
+					{
+						hitems[nheavy].hash = sitems[i].hash;
+						hitems[nheavy].sindex = i;
+					}
+					nheavy++;
+				}
+			}
+			if (nheavy <= GPUJOIN_HEAVY_HITTER_MAX_NKEYS)
+				break;
+			threshold *= 2;
+		}
+	}
+	if (!sorted_probe && nheavy == 0)
+		return kmrels_usage;
+
+	h_kmrels->chunks[depth-1].sorted_offset = kmrels_usage;
+	h_kmrels->chunks[depth-1].sorted_nitems = kds_hash->nitems;
+	h_kmrels->chunks[depth-1].sorted_probe = sorted_probe;
+	kmrels_usage += sorted_sz;
+	if (nheavy > 0)
+	{
+		h_kmrels->chunks[depth-1].heavy_offset = kmrels_usage;
+		h_kmrels->chunks[depth-1].heavy_nitems = nheavy;
+		kmrels_usage += STROMALIGN(sizeof(kern_heavyitem) * nheavy);
+	}
+	return kmrels_usage;
+}
+
+/*
+ * gpujoinReleaseInnerPartitions
+ */
+static void
+gpujoinReleaseInnerPartitions(GpuJoinState *gjs)
+{
+	innerState *istate;
+	cl_int		i;
+
+	if (gjs->part_depth == 0)
+		return;
+	istate = &gjs->inners[gjs->part_depth - 1];
+	for (i=0; i < istate->inner_nparts; i++)
+	{
+		if (istate->seg_parts[i])
+			dsm_detach(istate->seg_parts[i]);
+	}
+	pfree(istate->seg_parts);
+	istate->seg_parts = NULL;
+	gjs->part_depth = 0;
+	gjs->curr_part = 0;
+}
+
+/*
+ * gpujoinSwitchInnerPartition
+ *
+ * It replaces the partitioned inner hash table on the kern_multirels, on
+ * both of the host and device memory, by the specified partition.
+ */
+static void
+gpujoinSwitchInnerPartition(GpuJoinState *gjs, cl_int part)
+{
+	innerState	   *istate = &gjs->inners[gjs->part_depth - 1];
+	kern_multirels *h_kmrels = dsm_segment_address(gjs->seg_kmrels);
+	kern_data_store *kds_part;
+	size_t			offset;
+
+	Assert(part >= 0 && part < istate->inner_nparts);
+	kds_part = dsm_segment_address(istate->seg_parts[part]);
+	offset = h_kmrels->chunks[gjs->part_depth - 1].chunk_offset;
+	memcpy((char *)h_kmrels + offset, kds_part, kds_part->length);
+	gpujoinBroadcastInnerBuffer(gjs, kds_part, offset, kds_part->length);
+	gjs->curr_part = part;
+}
+
+/*
+ * gpujoinBroadcastInnerBuffer
+ *
+ * It copies a part of the host inner buffer to the device memory of all the
+ * GPUs which keep a copy of kern_multirels. Host-to-Device DMA is issued
+ * only once towards the current device, then the other devices pull the
+ * image by peer-to-peer copy if they can access the current device over
+ * NVLink or PCIe switch. It avoids host memory bandwidth to be the
+ * bottleneck as number of GPUs grows.
+ */
+static void
+gpujoinBroadcastInnerBuffer(GpuJoinState *gjs, void *hbuf,
+							size_t offset, size_t length)
+{
+	GpuContext	   *gcontext = gjs->gts.gcontext;
+	cl_int			src_dindex = gcontext->cuda_dindex;
+	CUdeviceptr		m_source = gjs->m_kmrels_array[src_dindex];
+	CUdevice		src_device;
+	CUdevice		dst_device;
+	int				can_access_peer;
+	cl_int			i;
+	CUresult		rc;
+
+	Assert(m_source != 0UL);
+	SwitchGpuContext(gcontext, src_dindex);
+	rc = cuMemcpyHtoD(m_source + offset, hbuf, length);
+	SwitchGpuContext(gcontext, -1);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+
+	rc = cuDeviceGet(&src_device, devAttrs[src_dindex].DEV_ID);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuDeviceGet: %s", errorText(rc));
+	for (i=0; i < numDevAttrs; i++)
+	{
+		CUdeviceptr	m_dest = gjs->m_kmrels_array[i];
+
+		if (i == src_dindex || m_dest == 0UL)
+			continue;
+
+		rc = cuDeviceGet(&dst_device, devAttrs[i].DEV_ID);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuDeviceGet: %s", errorText(rc));
+		rc = cuDeviceCanAccessPeer(&can_access_peer, dst_device, src_device);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuDeviceCanAccessPeer: %s", errorText(rc));
+
+		/*
+		 * cuMemcpyPeer() silently stages the data through the host memory
+		 * unless the destination context can access the source context.
+		 * So, peer access is enabled first. Host-to-Device DMA is used
+		 * instead if it is not available.
+		 */
+		if (can_access_peer)
+		{
+			SwitchGpuContext(gcontext, i);
+			rc = cuCtxEnablePeerAccess(gcontext->cuda_context, 0);
+			SwitchGpuContext(gcontext, -1);
+			if (rc != CUDA_SUCCESS &&
+				rc != CUDA_ERROR_PEER_ACCESS_ALREADY_ENABLED)
+			{
+				elog(DEBUG1, "failed on cuCtxEnablePeerAccess: %s",
+					 errorText(rc));
+				can_access_peer = 0;
+			}
+		}
+
+		if (can_access_peer)
+		{
+			/* device memory of other GPUs are already allocated */
+			Assert(gcontext->cuda_context_multi &&
+				   gcontext->cuda_context_multi[i]);
+			rc = cuMemcpyPeer(m_dest + offset,
+							  gcontext->cuda_context_multi[i],
+							  m_source + offset,
+							  gcontext->cuda_context,
+							  length);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyPeer: %s", errorText(rc));
+		}
+		else
+		{
+			SwitchGpuContext(gcontext, i);
+			rc = cuMemcpyHtoD(m_dest + offset, hbuf, length);
+			SwitchGpuContext(gcontext, -1);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+		}
+	}
+}
+
+/*
+ * gpujoin_inner_range_item
+ *
+ * It saves the bounds of range keys of the inner row to be loaded; NULL is
+ * considered as unbounded, because range keys are used only to pick up the
+ * candidate rows. Join quals are evaluated for them anyway.
+ */
+static void
+gpujoin_inner_range_item(innerState *istate,
+						 TupleTableSlot *slot,
+						 cl_uint index)
+{
+	ExprContext	   *econtext = istate->econtext;
+	kern_rangeitem *ritem;
+	Datum			datum;
+	bool			isnull;
+
+	if (istate->range_nitems >= istate->range_nrooms)
+	{
+		cl_uint		nrooms = Max(2 * istate->range_nrooms, 10000);
+
+		if (!istate->range_items)
+			istate->range_items = (kern_rangeitem *)
+				MemoryContextAllocHuge(CurrentMemoryContext,
+									   sizeof(kern_rangeitem) * nrooms);
+		else
+			istate->range_items = (kern_rangeitem *)
+				repalloc_huge(istate->range_items,
+							  sizeof(kern_rangeitem) * nrooms);
+		istate->range_nrooms = nrooms;
+	}
+	ritem = &istate->range_items[istate->range_nitems++];
+	ritem->lower = LONG_MIN;
+	ritem->upper_max = LONG_MAX;
+	ritem->index = index;
+
+	ResetExprContext(econtext);
+	econtext->ecxt_innertuple = slot;
+	if (istate->range_inner_lower)
+	{
+#if PG_VERSION_NUM < 100000
+		datum = ExecEvalExpr(istate->range_inner_lower, econtext,
+							 &isnull, NULL);
+#else
+		datum = ExecEvalExpr(istate->range_inner_lower, econtext, &isnull);
+#endif
+		if (!isnull)
+			ritem->lower = gpujoin_range_key_datum(istate->range_lower_type,
+												   datum);
+	}
+	if (istate->range_inner_upper)
+	{
+#if PG_VERSION_NUM < 100000
+		datum = ExecEvalExpr(istate->range_inner_upper, econtext,
+							 &isnull, NULL);
+#else
+		datum = ExecEvalExpr(istate->range_inner_upper, econtext, &isnull);
+#endif
+		if (!isnull)
+			ritem->upper_max = gpujoin_range_key_datum(istate->range_upper_type,
+													   datum);
+	}
+}
+
+/*
+ * kern_rangeitem_comp - comparison function of qsort
+ */
+static int
+kern_rangeitem_comp(const void *__a, const void *__b)
+{
+	const kern_rangeitem *a = __a;
+	const kern_rangeitem *b = __b;
+
+	if (a->lower < b->lower)
+		return -1;
+	if (a->lower > b->lower)
+		return 1;
+	/* keep the physical order of the items for better memory locality */
+	if (a->index < b->index)
+		return -1;
+	if (a->index > b->index)
+		return 1;
+	return 0;
+}
+
+/*
+ * gpujoin_inner_range_build
+ *
+ * It builds an array of the inner rows sorted by the lower bound of range
+ * keys next to the inner heap, then replaces the upper bound by the running
+ * maximum of them. It allows GpuNestLoop to pick up the candidate rows by
+ * binary search on both of the bounds. It returns the new usage of the
+ * kern_multirels.
+ */
+static size_t
+gpujoin_inner_range_build(innerState *istate,
+						  dsm_segment *seg,
+						  size_t kmrels_usage)
+{
+	kern_multirels *h_kmrels = dsm_segment_address(seg);
+	kern_rangeitem *ritems = istate->range_items;
+	cl_uint		nitems = istate->range_nitems;
+	cl_long		upper_max;
+	size_t		range_sz;
+	size_t		dsm_length;
+	cl_uint		i;
+
+	if (!ritems)
+		return kmrels_usage;
+
+	qsort(ritems, nitems, sizeof(kern_rangeitem), kern_rangeitem_comp);
+	upper_max = LONG_MIN;
+	for (i=0; i < nitems; i++)
+	{
+		upper_max = Max(upper_max, ritems[i].upper_max);
+		ritems[i].upper_max = upper_max;
+	}
+
+	range_sz = STROMALIGN(sizeof(kern_rangeitem) * nitems);
+	dsm_length = dsm_segment_map_length(seg);
+	while (kmrels_usage + range_sz > dsm_length)
+	{
+		h_kmrels = dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
+		dsm_length = dsm_segment_map_length(seg);
+	}
+	memcpy((char *)h_kmrels + kmrels_usage, ritems,
+		   sizeof(kern_rangeitem) * nitems);
+	h_kmrels->chunks[istate->depth-1].range_offset = kmrels_usage;
+	h_kmrels->chunks[istate->depth-1].range_nitems = nitems;
+
+	pfree(istate->range_items);
+	istate->range_items = NULL;
+	istate->range_nitems = 0;
+	istate->range_nrooms = 0;
+
+	return kmrels_usage + range_sz;
+}
+
+/*
+ * gpujoin_inner_heap_preload
+ *
+ * Preload inner relation to the data store with row-format, for nested-
+ * loop execution.
+ */
+static void
+gpujoin_inner_heap_preload(innerState *istate,
+						   dsm_segment *seg,
+						   kern_data_store *kds_heap,
+						   size_t kds_offset)
+{
+	PlanState	   *scan_ps = istate->state;
+	TupleTableSlot *scan_slot;
+	bool			has_range_keys = (istate->range_inner_lower ||
+									  istate->range_inner_upper);
+
+	for (;;)
+	{
+		scan_slot = ExecProcNode(scan_ps);
+		if (TupIsNull(scan_slot))
+			break;
+		(void)ExecFetchSlotTuple(scan_slot);
+		while (!KDS_insert_tuple(kds_heap, scan_slot))
+			kds_heap = gpujoin_expand_inner_kds(seg, kds_offset);
+		if (has_range_keys)
+			gpujoin_inner_range_item(istate, scan_slot, kds_heap->nitems - 1);
+	}
+	Assert(kds_heap->nslots == 0);
+	gpujoin_compaction_inner_kds(kds_heap);
+	if (kds_heap->length > (size_t)UINT_MAX)
+		elog(ERROR, "GpuJoin: inner heap table larger than 4GB is not supported right now (%zu bytes)", kds_heap->length);		
+}
+
+/*
+ * gpujoin_inner_preload
+ *
+ * It preload inner relation to the DSM buffer once.
+ */
+static bool
+__gpujoin_inner_preload(GpuJoinState *gjs, bool with_cpu_parallel,
+						bool allow_partition)
+{
+	GpuContext	   *gcontext = gjs->gts.gcontext;
+	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
+	kern_multirels *h_kmrels;
+	kern_data_store *kds;
+	dsm_segment	   *seg;
+	int				i, num_rels = gjs->num_rels;
+	size_t			ojmaps_usage = 0;
+	size_t			kmrels_usage = 0;
+	size_t			required;
+	bool			kmrels_oversubscribed = false;
+
+	Assert(!IsParallelWorker());
+	gjs->m_kmrels_array = MemoryContextAllocZero(CurTransactionContext,
+											numDevAttrs * sizeof(CUdeviceptr));
+	seg = dsm_create(pgstrom_chunk_size(), 0);
+	h_kmrels = dsm_segment_address(seg);
+	kmrels_usage = STROMALIGN(offsetof(kern_multirels, chunks[num_rels]));
+	memset(h_kmrels, 0, kmrels_usage);
+
+	/*
+	 * Load inner relations
+	 */
+	memcpy(h_kmrels->pg_crc32_table,
+		   pg_crc32_table,
+		   sizeof(pg_crc32_table));
+	for (i=0; i < num_rels; i++)
+	{
+		innerState	   *istate = &gjs->inners[i];
+		PlanState	   *scan_ps = istate->state;
+		TupleTableSlot *ps_slot = scan_ps->ps_ResultTupleSlot;
+		TupleDesc		ps_desc = ps_slot->tts_tupleDescriptor;
+		kern_data_store *kds;
+		size_t			dsm_length;
+		size_t			kds_length;
+		size_t			kds_head_sz;
+		size_t			chunk_length;
+
+		if (istate->inner_nparts > 1 && allow_partition)
+		{
+			kern_data_store *kds_part;
+
+			/*
+			 * Partitioned inner hash table; kern_multirels has a slot for
+			 * the largest partition, and the first one is loaded here.
+			 */
+			Assert(istate->hash_inner_keys != NIL);
+			chunk_length = gpujoin_inner_hash_partition_preload(istate,
+																ps_desc);
 			dsm_length = dsm_segment_map_length(seg);
+			while (kmrels_usage + chunk_length > dsm_length)
+			{
+				h_kmrels = dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
+				dsm_length = dsm_segment_map_length(seg);
+			}
+			kds_part = dsm_segment_address(istate->seg_parts[0]);
+			kds = (kern_data_store *)((char *)h_kmrels + kmrels_usage);
+			memcpy(kds, kds_part, kds_part->length);
+			h_kmrels->chunks[i].chunk_offset = kmrels_usage;
+			gjs->part_depth = istate->depth;
+			gjs->curr_part = 0;
 		}
-		kds = (kern_data_store *)((char *)h_kmrels + kmrels_usage);
-		kds_length = Min(dsm_length - kmrels_usage, 0x100000000L);
-		init_kernel_data_store(kds,
-							   ps_desc,
-							   kds_length,
-							   (istate->hash_inner_keys != NIL
-								? KDS_FORMAT_HASH
-								: KDS_FORMAT_ROW),
-							   UINT_MAX);
-		h_kmrels->chunks[i].chunk_offset = kmrels_usage;
-		if (istate->hash_inner_keys != NIL)
-			gpujoin_inner_hash_preload(istate, seg, kds, kmrels_usage);
 		else
-			gpujoin_inner_heap_preload(istate, seg, kds, kmrels_usage);
+		{
+			/* expand DSM on demand */
+			dsm_length = dsm_segment_map_length(seg);
+			kds_head_sz = STROMALIGN(offsetof(kern_data_store,
+											  colmeta[ps_desc->natts]));
+			while (kmrels_usage + kds_head_sz > dsm_length)
+			{
+				h_kmrels = dsm_resize(seg, TYPEALIGN(BLCKSZ, (3*dsm_length)/2));
+				dsm_length = dsm_segment_map_length(seg);
+			}
+			kds = (kern_data_store *)((char *)h_kmrels + kmrels_usage);
+			kds_length = Min(dsm_length - kmrels_usage, 0x100000000L);
+			init_kernel_data_store(kds,
+								   ps_desc,
+								   kds_length,
+								   (istate->hash_inner_keys != NIL
+									? KDS_FORMAT_HASH
+									: KDS_FORMAT_ROW),
+								   UINT_MAX);
+			h_kmrels->chunks[i].chunk_offset = kmrels_usage;
+			if (istate->hash_inner_keys != NIL)
+				gpujoin_inner_hash_preload(istate, seg, kds, kmrels_usage);
+			else
+				gpujoin_inner_heap_preload(istate, seg, kds, kmrels_usage);
 
-		/* NOTE: gpujoin_inner_xxxx_preload may expand and remap segment */
-		h_kmrels = dsm_segment_address(seg);
-		kds = (kern_data_store *)((char *)h_kmrels + kmrels_usage);
+			/* NOTE: gpujoin_inner_xxxx_preload may expand and remap segment */
+			h_kmrels = dsm_segment_address(seg);
+			kds = (kern_data_store *)((char *)h_kmrels + kmrels_usage);
+			chunk_length = kds->length;
+		}
 
 		if (!istate->hash_outer_keys)
 			h_kmrels->chunks[i].is_nestloop = true;
@@ -5513,7 +7248,37 @@ __gpujoin_inner_preload(GpuJoinState *gjs, bool with_cpu_parallel)
 		{
 			h_kmrels->chunks[i].left_outer = true;
 		}
-		kmrels_usage += STROMALIGN(kds->length);
+		if (istate->join_type == JOIN_SEMI)
+			h_kmrels->chunks[i].semi_join = true;
+		if (istate->join_type == JOIN_ANTI)
+			h_kmrels->chunks[i].anti_join = true;
+		kmrels_usage += STROMALIGN(chunk_length);
+
+		/* bloom filter to skip hash-slot probe by obviously unmatched rows */
+		if (istate->hash_inner_keys != NIL && gpujoin_bloom_filter_enabled)
+		{
+			kmrels_usage = gpujoin_inner_bloom_build(istate, seg,
+													 kmrels_usage);
+			h_kmrels = dsm_segment_address(seg);
+		}
+
+		/* sorted items instead of hash-slot chain, if many duplications */
+		if (istate->hash_inner_keys != NIL &&
+			!istate->seg_parts &&
+			(gpujoin_sorted_inner_enabled || gpujoin_heavy_hitter_enabled))
+		{
+			kmrels_usage = gpujoin_inner_sorted_build(istate, seg,
+													  kmrels_usage);
+			h_kmrels = dsm_segment_address(seg);
+		}
+
+		/* sorted items by range keys, to pick up candidate rows */
+		if (istate->range_inner_lower || istate->range_inner_upper)
+		{
+			kmrels_usage = gpujoin_inner_range_build(istate, seg,
+													 kmrels_usage);
+			h_kmrels = dsm_segment_address(seg);
+		}
 	}
 	Assert(kmrels_usage <= dsm_segment_map_length(seg));
 	h_kmrels->kmrels_length = kmrels_usage;
@@ -5531,10 +7296,15 @@ __gpujoin_inner_preload(GpuJoinState *gjs, bool with_cpu_parallel)
 	{
 		kds = KERN_MULTIRELS_INNER_KDS(h_kmrels, i);
 		/* outer join can produce something from empty */
-		if (gjs->inners[i-1].join_type != JOIN_INNER)
+		if (gjs->inners[i-1].join_type != JOIN_INNER &&
+			gjs->inners[i-1].join_type != JOIN_SEMI)
 			break;
+		/* other partitions may have items */
+		if (i == gjs->part_depth)
+			continue;
 		if (kds->nitems == 0)
 		{
+			gpujoinReleaseInnerPartitions(gjs);
 			dsm_detach(seg);
 			gjs->seg_kmrels = (void *)(~0UL);
 			return false;
@@ -5562,186 +7332,998 @@ __gpujoin_inner_preload(GpuJoinState *gjs, bool with_cpu_parallel)
 		CUdeviceptr	m_deviceptr;
 		CUresult	rc;
 
-		rc = gpuMemAllocDev(gcontext, i,
-							&m_deviceptr,
-							required,
-							&gj_sstate->pergpu[i].m_handle);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on gpuMemAllocDev: %s", errorText(rc));
-		if (i == gcontext->cuda_dindex)
-			gjs->m_kmrels = m_deviceptr;
-		gjs->m_kmrels_array[i] = m_deviceptr;
+		rc = gpuMemAllocDev(gcontext, i,
+							&m_deviceptr,
+							required,
+							&gj_sstate->pergpu[i].m_handle);
+		/*
+		 * On device memory shortage, the inner buffer may be moved to the
+		 * managed memory that can be oversubscribed, unless any parallel
+		 * workers open the buffer by IPC handle. Only the outer-join map
+		 * on the tail is updated by GPU kernel, so the rest is read-mostly.
+		 */
+		if (rc == CUDA_ERROR_OUT_OF_MEMORY &&
+			!with_cpu_parallel &&
+			i == gcontext->cuda_dindex)
+		{
+			rc = gpuMemAllocOversubscribe(gcontext,
+										  &m_deviceptr,
+										  required,
+										  h_kmrels->kmrels_length);
+			if (rc == CUDA_SUCCESS)
+			{
+				elog(DEBUG1, "GpuJoin inner buffer (%zu bytes) is allocated on the managed memory", required);
+				kmrels_oversubscribed = true;
+			}
+		}
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuMemAllocDev: %s", errorText(rc));
+		if (i == gcontext->cuda_dindex)
+			gjs->m_kmrels = m_deviceptr;
+		gjs->m_kmrels_array[i] = m_deviceptr;
+	}
+	/* copy the inner buffer once, then broadcast to other devices */
+	gpujoinBroadcastInnerBuffer(gjs, h_kmrels, 0, required);
+	/* pull the oversubscribed inner buffer onto the device as possible */
+	if (kmrels_oversubscribed)
+	{
+		CUresult	rc;
+
+		SwitchGpuContext(gcontext, gcontext->cuda_dindex);
+		rc = cuMemPrefetchAsync(gjs->m_kmrels, required,
+								gcontext->cuda_device,
+								CU_STREAM_PER_THREAD);
+		SwitchGpuContext(gcontext, -1);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on cuMemPrefetchAsync: %s", errorText(rc));
+	}
+	for (i=0; i < numDevAttrs; i++)
+	{
+		CUresult	rc;
+
+		if (gjs->m_kmrels_array[i] == 0UL)
+			continue;
+		SwitchGpuContext(gcontext, i);
+		rc = cuMemsetD32(gjs->m_kmrels_array[i] +
+						 offsetof(kern_multirels, cuda_dindex),
+						 (unsigned int)i,
+						 1);
+		SwitchGpuContext(gcontext, -1);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemsetD32: %s", errorText(rc));
+	}
+	gj_sstate->kmrels_handle = dsm_segment_handle(seg);
+	gjs->seg_kmrels = seg;
+	return true;
+}
+
+bool
+GpuJoinInnerPreload(GpuTaskState *gts, CUdeviceptr *p_m_kmrels)
+{
+	GpuJoinState   *gjs = (GpuJoinState *) gts;
+	GpuContext	   *gcontext = gjs->gts.gcontext;
+	GpuJoinSharedState *gj_sstate;
+	int				dindex = gcontext->cuda_dindex;
+	bool			with_cpu_parallel = true;
+	uint32			preload_done;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+
+	Assert(pgstrom_planstate_is_gpujoin(&gts->css.ss.ps));
+	if (!gjs->gj_sstate)
+	{
+		Assert(!IsParallelWorker());
+		gjs->gj_sstate = createGpuJoinSharedState(gjs, NULL, NULL);
+		gjs->gj_rtstat = GPUJOIN_RUNTIME_STAT(gjs->gj_sstate);
+		gjs->gts.gt_rtstat = &gjs->gj_rtstat->c;
+		with_cpu_parallel = false;
+	}
+	gj_sstate = gjs->gj_sstate;
+
+	/* preload already done? */
+	if (gjs->seg_kmrels)
+	{
+		if (p_m_kmrels)
+			*p_m_kmrels = gjs->m_kmrels;
+		return (gjs->seg_kmrels != (void *)(~0UL));
+	}
+
+	pg_atomic_add_fetch_u32(&gj_sstate->pergpu[dindex].pg_nworkers, 1);
+	pg_atomic_add_fetch_u32(&gj_sstate->pg_nworkers, 1);
+
+	ResetLatch(&MyProc->procLatch);
+	while ((preload_done = pg_atomic_read_u32(&gj_sstate->preload_done)) == 0)
+	{
+		if (!IsParallelWorker())
+		{
+			/* master process is responsible for inner preloading */
+			if (!with_cpu_parallel && gpujoinAttachSharedInner(gjs))
+				preload_done = 1;	/* inner buffer of the sibling GpuJoin */
+			else if (gpujoinAttachInnerCache(gjs))
+				preload_done = 1;	/* inner buffer of the past execution */
+			else if (__gpujoin_inner_preload(gjs, with_cpu_parallel,
+											 !with_cpu_parallel &&
+											 !p_m_kmrels))
+			{
+				preload_done = 1;	/* valid inner buffer was loaded */
+				gpujoinRegisterInnerCache(gjs);
+				if (!with_cpu_parallel)
+					gpujoinRegisterSharedInner(gjs);
+			}
+			else
+				preload_done = INT_MAX;	/* no need to run GpuJoin */
+			pg_atomic_write_u32(&gj_sstate->preload_done, preload_done);
+
+			/* wake up parallel workers, if any */
+			if (gjs->gts.pcxt)
+			{
+				ParallelContext *pcxt = gjs->gts.pcxt;
+				pid_t		pid;
+				int			i;
+
+				for (i=0; i < pcxt->nworkers_launched; i++)
+				{
+					if (GetBackgroundWorkerPid(pcxt->worker[i].bgwhandle,
+											   &pid) == BGWH_STARTED)
+						ProcSendSignal(pid);
+				}
+			}
+
+			if (preload_done == 1)
+			{
+				if (p_m_kmrels)
+					*p_m_kmrels = gjs->m_kmrels;
+				return true;
+			}
+			return false;
+		}
+		else
+		{
+			/* wait for the completion of inner preload by the master */
+			CHECK_FOR_INTERRUPTS();
+
+			WaitLatch(&MyProc->procLatch,
+					  WL_LATCH_SET,
+					  -1
+#if PG_VERSION_NUM >= 100000
+					  ,PG_WAIT_EXTENSION
+#endif
+				);
+			ResetLatch(&MyProc->procLatch);
+		}
+	}
+	/* the inner buffer ready? */
+	if (preload_done > 1)
+		return false;
+
+	gjs->seg_kmrels = dsm_attach(gj_sstate->kmrels_handle);
+	if (!gjs->seg_kmrels)
+		elog(ERROR, "could not map dynamic shared memory segment");
+
+	rc = gpuIpcOpenMemHandle(gcontext,
+							 &m_deviceptr,
+							 gj_sstate->pergpu[dindex].m_handle,
+							 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+	gjs->m_kmrels = m_deviceptr;
+	if (p_m_kmrels)
+		*p_m_kmrels = m_deviceptr;
+	return true;
+}
+
+/*
+ * GpuJoinInnerUnload
+ */
+void
+GpuJoinInnerUnload(GpuTaskState *gts, bool is_rescan)
+{
+	GpuJoinState   *gjs = (GpuJoinState *) gts;
+	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
+	GpuContext	   *gcontext = gjs->gts.gcontext;
+	cl_int			i;
+	bool			keep_segment = false;
+	CUresult		rc;
+
+	if (!gj_sstate || !gjs->seg_kmrels)
+		return;
+
+	if (!IsParallelWorker())
+	{
+		/* Release partitioned inner hash table, if any */
+		gpujoinReleaseInnerPartitions(gjs);
+		/* Inner buffer cache? (device memory is opened via IPC handle) */
+		if (gjs->inner_cache_ref)
+		{
+			rc = gpuIpcCloseMemHandle(gcontext, gjs->m_kmrels);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuIpcCloseMemHandle: %s",
+					 errorText(rc));
+			gpujoinReleaseInnerCache(gjs);
+		}
+		/* Inner buffer still in use by the sibling GpuJoins? */
+		else if (gjs->shared_inner && gpujoinDetachSharedInner(gjs))
+		{
+			gjs->m_kmrels_array = NULL;
+			keep_segment = true;
+		}
+		/* Release device memory */
+		if (gjs->m_kmrels_array)
+		{
+			for (i=0; i < numDevAttrs; i++)
+			{
+				rc = gpuMemFree(gcontext, gjs->m_kmrels_array[i]);
+				if (rc != CUDA_SUCCESS)
+					elog(ERROR, "failed on gpuMemFree: %s", errorText(rc));
+			}
+			pfree(gjs->m_kmrels_array);
+			gjs->m_kmrels_array = NULL;
+		}
+		/* Reset GpuJoinSharedState, if rescan */
+		if (is_rescan)
+		{
+			gjs->curr_outer_depth		= -1;
+			gj_sstate->kmrels_handle	= UINT_MAX;	/* DSM */
+			pg_atomic_init_u32(&gj_sstate->needs_colocation,
+							   numDevAttrs > 1 ? 1 : 0);
+			pg_atomic_init_u32(&gj_sstate->preload_done, 0);
+			pg_atomic_init_u32(&gj_sstate->pg_nworkers, 0);
+			memset(gj_sstate->pergpu, 0,
+				   offsetof(GpuJoinSharedState, pergpu[numDevAttrs]) -
+				   offsetof(GpuJoinSharedState, pergpu[0]));
+		}
+	}
+	else
+	{
+		rc = gpuIpcCloseMemHandle(gcontext, gjs->m_kmrels);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuIpcCloseMemHandle: %s", errorText(rc));
+	}
+	if (!keep_segment)
+		dsm_detach(gjs->seg_kmrels);
+	gjs->m_kmrels = 0UL;
+	gjs->seg_kmrels = NULL;
+}
+
+/*
+ * gpujoin_inner_signature
+ *
+ * It returns identity of the inner relations, if the inner buffer can be
+ * shared with the sibling GpuJoins in the same query; typically, GpuJoins
+ * on the individual partitions under an Append, which join a common
+ * dimension table. Only simple scans without any parameters are eligible,
+ * so the inner buffer is never reconstructed on rescan. RIGHT/FULL OUTER
+ * JOIN and partitioned inner hash table are not eligible also, because
+ * the outer join map and the current partition are state of individual
+ * GpuJoin. Location fields are ignored by equal(), so the signature is
+ * compared by equal() rather than the text form.
+ */
+static List *
+gpujoin_inner_signature(GpuJoinState *gjs,
+						CustomScan *cscan,
+						GpuJoinInfo *gj_info,
+						EState *estate)
+{
+	List	   *signature = NIL;
+	ListCell   *lc;
+	int			i = 0;
+
+	if ((!gpujoin_shared_inner_enabled &&
+		 !gpujoin_inner_cache_enabled) || IsParallelWorker())
+		return NIL;
+
+	foreach (lc, cscan->custom_plans)
+	{
+		Plan	   *plan = lfirst(lc);
+		innerState *istate = &gjs->inners[i];
+		Index		scanrelid;
+		RangeTblEntry *rte;
+		List	   *tlist;
+		List	   *quals;
+		List	   *hash_inner_keys;
+		List	   *range_inner_keys;
+
+		if (!IsA(plan, SeqScan) ||
+			plan->initPlan != NIL ||
+			!bms_is_empty(plan->allParam) ||
+			istate->join_type == JOIN_RIGHT ||
+			istate->join_type == JOIN_FULL ||
+			istate->inner_nparts > 1)
+			return NIL;
+		scanrelid = ((Scan *) plan)->scanrelid;
+		rte = rt_fetch(scanrelid, estate->es_range_table);
+		if (rte->rtekind != RTE_RELATION)
+			return NIL;
+		/* Var-nodes shall be compared regardless of the range-table index */
+		tlist = copyObject(plan->targetlist);
+		quals = copyObject(plan->qual);
+		ChangeVarNodes((Node *)tlist, scanrelid, 1, 0);
+		ChangeVarNodes((Node *)quals, scanrelid, 1, 0);
+		hash_inner_keys = list_nth(gj_info->hash_inner_keys, i);
+		if (hash_inner_keys != NIL)
+			hash_inner_keys = fixup_varnode_to_origin(i+1,
+													  gj_info->ps_src_depth,
+													  gj_info->ps_src_resno,
+													  hash_inner_keys);
+		range_inner_keys = list_nth(gj_info->range_inner_keys, i);
+		if (range_inner_keys != NIL)
+			range_inner_keys = fixup_varnode_to_origin(i+1,
+													   gj_info->ps_src_depth,
+													   gj_info->ps_src_resno,
+													   range_inner_keys);
+		signature = lappend(signature,
+							lappend(list_make5(makeInteger(istate->join_type),
+											   makeInteger(rte->relid),
+											   tlist,
+											   quals,
+											   hash_inner_keys),
+									range_inner_keys));
+		i++;
+	}
+	return signature;
+}
+
+/*
+ * gpujoin_shared_inner_cleanup
+ *
+ * It forgets the shared inner buffers of the query on its end, even if
+ * it was aborted. DSM segment and device memory are already released by
+ * the resource owner and GpuContext in this case.
+ */
+static void
+gpujoin_shared_inner_cleanup(void *arg)
+{
+	EState	   *estate = arg;
+	List	   *shared_inners = NIL;
+	ListCell   *lc;
+	MemoryContext oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+	foreach (lc, gpujoin_shared_inners)
+	{
+		GpuJoinSharedInner *sinner = lfirst(lc);
+
+		if (sinner->estate == estate)
+			pfree(sinner);
+		else
+			shared_inners = lappend(shared_inners, sinner);
+	}
+	list_free(gpujoin_shared_inners);
+	gpujoin_shared_inners = shared_inners;
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * gpujoinAttachSharedInner
+ *
+ * It looks up the inner buffer already preloaded by the sibling GpuJoin,
+ * and attaches it if any.
+ */
+static bool
+gpujoinAttachSharedInner(GpuJoinState *gjs)
+{
+	EState	   *estate = gjs->gts.css.ss.ps.state;
+	ListCell   *lc;
+
+	if (!gpujoin_shared_inner_enabled || gjs->inner_signature == NIL)
+		return false;
+	foreach (lc, gpujoin_shared_inners)
+	{
+		GpuJoinSharedInner *sinner = lfirst(lc);
+
+		if (sinner->estate == estate &&
+			sinner->gcontext == gjs->gts.gcontext &&
+			equal(sinner->signature, gjs->inner_signature))
+		{
+			sinner->refcnt++;
+			gjs->shared_inner = sinner;
+			gjs->seg_kmrels = sinner->seg_kmrels;
+			gjs->m_kmrels = sinner->m_kmrels;
+			gjs->m_kmrels_array = sinner->m_kmrels_array;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * gpujoinRegisterSharedInner
+ *
+ * It makes the inner buffer just preloaded available to the sibling
+ * GpuJoins in the same query.
+ */
+static void
+gpujoinRegisterSharedInner(GpuJoinState *gjs)
+{
+	EState	   *estate = gjs->gts.css.ss.ps.state;
+	GpuJoinSharedInner *sinner;
+	MemoryContextCallback *mcb;
+	MemoryContext oldcxt;
+	ListCell   *lc;
+	bool		has_callback = false;
+
+	if (!gpujoin_shared_inner_enabled ||
+		gjs->inner_signature == NIL ||
+		gjs->part_depth > 0)
+		return;
+
+	foreach (lc, gpujoin_shared_inners)
+	{
+		sinner = lfirst(lc);
+		if (sinner->estate == estate)
+			has_callback = true;
+	}
+	if (!has_callback)
+	{
+		mcb = MemoryContextAllocZero(estate->es_query_cxt,
+									 sizeof(MemoryContextCallback));
+		mcb->func = gpujoin_shared_inner_cleanup;
+		mcb->arg = estate;
+		MemoryContextRegisterResetCallback(estate->es_query_cxt, mcb);
+	}
+
+	oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+	sinner = palloc0(sizeof(GpuJoinSharedInner));
+	sinner->estate = estate;
+	sinner->gcontext = gjs->gts.gcontext;
+	sinner->signature = gjs->inner_signature;	/* on es_query_cxt */
+	sinner->refcnt = 1;
+	sinner->seg_kmrels = gjs->seg_kmrels;
+	sinner->m_kmrels = gjs->m_kmrels;
+	sinner->m_kmrels_array = gjs->m_kmrels_array;
+	gpujoin_shared_inners = lappend(gpujoin_shared_inners, sinner);
+	MemoryContextSwitchTo(oldcxt);
+
+	gjs->shared_inner = sinner;
+}
+
+/*
+ * gpujoinDetachSharedInner
+ *
+ * It releases a reference to the shared inner buffer, then returns true
+ * if the sibling GpuJoins still reference the buffer. Elsewhere, caller
+ * is responsible to release the DSM segment and device memory.
+ */
+static bool
+gpujoinDetachSharedInner(GpuJoinState *gjs)
+{
+	GpuJoinSharedInner *sinner = gjs->shared_inner;
+
+	Assert(sinner->refcnt > 0);
+	gjs->shared_inner = NULL;
+	if (--sinner->refcnt > 0)
+		return true;
+	gpujoin_shared_inners = list_delete_ptr(gpujoin_shared_inners, sinner);
+	pfree(sinner);
+	return false;
+}
+
+/*
+ * gpujoin_inner_cache_check_relations
+ *
+ * It checks whether all the inner relations are entirely all-visible, and
+ * returns the validity token for each. Any modification on the relation
+ * clears the visibility-map bit, then VACUUM sets the bit with a new LSN
+ * of the visibility-map page, so it is a lightweight validation of the
+ * inner buffer cache; the visibility-map is tiny.
+ */
+static bool
+gpujoin_inner_cache_check_relations(GpuJoinState *gjs,
+									GpuJoinInnerCacheToken *tokens)
+{
+	int			i;
+
+	if (gjs->num_rels > GPUJOIN_INNER_CACHE_MAX_RELS)
+		return false;
+	for (i=0; i < gjs->num_rels; i++)
+	{
+		ScanState  *ss = (ScanState *) gjs->inners[i].state;
+		Relation	rel = ss->ss_currentRelation;
+		BlockNumber	all_visible;
+		BlockNumber	vm_nblocks;
+		BlockNumber	blkno;
+		XLogRecPtr	vm_lsn = InvalidXLogRecPtr;
+
+		if (!rel || !RelationNeedsWAL(rel))
+			return false;
+		tokens[i].nblocks = RelationGetNumberOfBlocks(rel);
+		visibilitymap_count(rel, &all_visible, NULL);
+		if (all_visible != tokens[i].nblocks)
+			return false;
+
+		RelationOpenSmgr(rel);
+		if (!smgrexists(rel->rd_smgr, VISIBILITYMAP_FORKNUM))
+			vm_nblocks = 0;
+		else
+			vm_nblocks = smgrnblocks(rel->rd_smgr, VISIBILITYMAP_FORKNUM);
+		for (blkno=0; blkno < vm_nblocks; blkno++)
+		{
+			Buffer		buffer;
+			XLogRecPtr	lsn;
+
+			buffer = ReadBufferExtended(rel, VISIBILITYMAP_FORKNUM, blkno,
+										RBM_NORMAL, NULL);
+			lsn = BufferGetLSNAtomic(buffer);
+			ReleaseBuffer(buffer);
+			if (lsn > vm_lsn)
+				vm_lsn = lsn;
+		}
+		tokens[i].vm_lsn = vm_lsn;
+	}
+	return true;
+}
+
+/*
+ * gpujoin_inner_cache_token_equal
+ */
+static bool
+gpujoin_inner_cache_token_equal(GpuJoinInnerCacheToken *a,
+								GpuJoinInnerCacheToken *b, int nrels)
+{
+	int			i;
+
+	for (i=0; i < nrels; i++)
+	{
+		if (a[i].nblocks != b[i].nblocks ||
+			a[i].vm_lsn != b[i].vm_lsn)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * gpujoin_inner_cache_signature
+ */
+static char *
+gpujoin_inner_cache_signature(GpuJoinState *gjs,
+							  size_t *p_sig_len,
+							  pg_crc32 *p_sig_crc)
+{
+	char	   *signature = nodeToString(gjs->inner_signature);
+	size_t		sig_len = strlen(signature);
+	pg_crc32	sig_crc;
+
+	INIT_LEGACY_CRC32(sig_crc);
+	COMP_LEGACY_CRC32(sig_crc, signature, sig_len);
+	FIN_LEGACY_CRC32(sig_crc);
+
+	*p_sig_len = sig_len;
+	*p_sig_crc = sig_crc;
+	return signature;
+}
+
+/*
+ * gpujoin_inner_cache_free
+ *
+ * It releases the resources of the cache entry already detached from the
+ * shared memory.
+ */
+static void
+gpujoin_inner_cache_free(GpuJoinInnerCacheEntry *entry)
+{
+	CUresult	rc;
+
+	rc = gpuMemFreePreserved(entry->cuda_dindex, entry->m_handle);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on gpuMemFreePreserved: %s", errorText(rc));
+#if PG_VERSION_NUM >= 100000
+	dsm_unpin_segment(entry->kmrels_handle);
+#endif
+}
+
+/*
+ * gpujoin_inner_cache_sweep
+ *
+ * It releases the invalidated cache entries which are no longer in use.
+ */
+static void
+gpujoin_inner_cache_sweep(void)
+{
+	GpuJoinInnerCacheHead *head = gpujoin_inner_cache_head;
+	GpuJoinInnerCacheEntry temp;
+	int			index;
+	bool		found;
+
+	do {
+		found = false;
+		SpinLockAcquire(&head->lock);
+		for (index=0; index < GPUJOIN_INNER_CACHE_NSLOTS; index++)
+		{
+			GpuJoinInnerCacheEntry *entry = &head->entries[index];
+
+			if (entry->in_use && !entry->is_valid && entry->refcnt == 0)
+			{
+				memcpy(&temp, entry, sizeof(GpuJoinInnerCacheEntry));
+				entry->in_use = false;
+				found = true;
+				break;
+			}
+		}
+		SpinLockRelease(&head->lock);
+		if (found)
+			gpujoin_inner_cache_free(&temp);
+	} while (found);
+}
+
+/*
+ * __gpujoin_inner_cache_release
+ */
+static void
+__gpujoin_inner_cache_release(cl_int index, bool can_free)
+{
+	GpuJoinInnerCacheHead *head = gpujoin_inner_cache_head;
+	GpuJoinInnerCacheEntry *entry = &head->entries[index];
+	GpuJoinInnerCacheEntry temp;
+	bool		do_free = false;
+
+	SpinLockAcquire(&head->lock);
+	Assert(entry->in_use && entry->refcnt > 0);
+	if (--entry->refcnt == 0 && !entry->is_valid && can_free)
+	{
+		memcpy(&temp, entry, sizeof(GpuJoinInnerCacheEntry));
+		entry->in_use = false;
+		do_free = true;
+	}
+	SpinLockRelease(&head->lock);
+	if (do_free)
+		gpujoin_inner_cache_free(&temp);
+}
+
+/*
+ * gpujoin_inner_cache_cleanup
+ *
+ * It releases the reference to the cache entry on end of the query, if not
+ * released yet. Resources of the entry shall be released by the next sweep,
+ * because we may be in the abort path.
+ */
+static void
+gpujoin_inner_cache_cleanup(void *arg)
+{
+	GpuJoinInnerCacheRef *cref = arg;
 
-		rc = cuMemcpyHtoD(m_deviceptr, h_kmrels, required);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
-		rc = cuMemsetD32(m_deviceptr + offsetof(kern_multirels,
-												cuda_dindex),
-						 (unsigned int)i,
-						 1);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on cuMemsetD32: %s", errorText(rc));
+	if (!cref->released)
+	{
+		cref->released = true;
+		__gpujoin_inner_cache_release(cref->index, false);
 	}
-	gj_sstate->kmrels_handle = dsm_segment_handle(seg);
-	gjs->seg_kmrels = seg;
-	return true;
 }
 
-bool
-GpuJoinInnerPreload(GpuTaskState *gts, CUdeviceptr *p_m_kmrels)
+/*
+ * gpujoinAttachInnerCache
+ *
+ * It looks up the inner buffer cache built by the past execution, and
+ * attaches it if still valid.
+ */
+static bool
+gpujoinAttachInnerCache(GpuJoinState *gjs)
 {
-	GpuJoinState   *gjs = (GpuJoinState *) gts;
+	GpuJoinInnerCacheHead *head = gpujoin_inner_cache_head;
+	GpuJoinInnerCacheEntry *entry;
+	GpuJoinInnerCacheRef *cref;
+	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
 	GpuContext	   *gcontext = gjs->gts.gcontext;
-	GpuJoinSharedState *gj_sstate;
-	int				dindex = gcontext->cuda_dindex;
-	bool			with_cpu_parallel = true;
-	uint32			preload_done;
+	EState		   *estate = gjs->gts.css.ss.ps.state;
+	cl_int			dindex = gcontext->cuda_dindex;
+	GpuJoinInnerCacheToken *tokens;
+	TimestampTz		now = GetCurrentTimestamp();
+	char		   *signature;
+	size_t			sig_len;
+	pg_crc32		sig_crc;
+	dsm_handle		kmrels_handle;
+	size_t			kmrels_length;
+	CUipcMemHandle	m_handle;
 	CUdeviceptr		m_deviceptr;
+	dsm_segment	   *seg;
+	int				index;
 	CUresult		rc;
 
-	Assert(pgstrom_planstate_is_gpujoin(&gts->css.ss.ps));
-	if (!gjs->gj_sstate)
-	{
-		Assert(!IsParallelWorker());
-		gjs->gj_sstate = createGpuJoinSharedState(gjs, NULL, NULL);
-		gjs->gj_rtstat = GPUJOIN_RUNTIME_STAT(gjs->gj_sstate);
-		with_cpu_parallel = false;
-	}
-	gj_sstate = gjs->gj_sstate;
+	if (!gpujoin_inner_cache_enabled ||
+		!head ||
+		gjs->inner_signature == NIL ||
+		gjs->num_rels > GPUJOIN_INNER_CACHE_MAX_RELS)
+		return false;
+	/* kept to validate the inner relations after the preload, if miss */
+	tokens = MemoryContextAllocZero(estate->es_query_cxt,
+									sizeof(GpuJoinInnerCacheToken) *
+									gjs->num_rels);
+	if (!gpujoin_inner_cache_check_relations(gjs, tokens))
+		return false;
+	gjs->inner_cache_tokens = tokens;
+	signature = gpujoin_inner_cache_signature(gjs, &sig_len, &sig_crc);
 
-	/* preload already done? */
-	if (gjs->seg_kmrels)
+	gpujoin_inner_cache_sweep();
+	SpinLockAcquire(&head->lock);
+	for (index=0; index < GPUJOIN_INNER_CACHE_NSLOTS; index++)
 	{
-		if (p_m_kmrels)
-			*p_m_kmrels = gjs->m_kmrels;
-		return (gjs->seg_kmrels != (void *)(~0UL));
+		entry = &head->entries[index];
+		if (entry->in_use &&
+			entry->is_valid &&
+			entry->database_oid == MyDatabaseId &&
+			entry->cuda_dindex == dindex &&
+			entry->signature_crc == sig_crc &&
+			entry->signature_len == sig_len &&
+			entry->nrels == gjs->num_rels &&
+			gpujoin_inner_cache_token_equal(entry->tokens, tokens,
+											gjs->num_rels))
+			break;
 	}
-
-	pg_atomic_add_fetch_u32(&gj_sstate->pergpu[dindex].pg_nworkers, 1);
-	pg_atomic_add_fetch_u32(&gj_sstate->pg_nworkers, 1);
-
-	ResetLatch(&MyProc->procLatch);
-	while ((preload_done = pg_atomic_read_u32(&gj_sstate->preload_done)) == 0)
+	if (index >= GPUJOIN_INNER_CACHE_NSLOTS)
 	{
-		if (!IsParallelWorker())
-		{
-			/* master process is responsible for inner preloading */
-			if (__gpujoin_inner_preload(gjs, with_cpu_parallel))
-				preload_done = 1;	/* valid inner buffer was loaded */
-			else
-				preload_done = INT_MAX;	/* no need to run GpuJoin */
-			pg_atomic_write_u32(&gj_sstate->preload_done, preload_done);
-
-			/* wake up parallel workers, if any */
-			if (gjs->gts.pcxt)
-			{
-				ParallelContext *pcxt = gjs->gts.pcxt;
-				pid_t		pid;
-				int			i;
-
-				for (i=0; i < pcxt->nworkers_launched; i++)
-				{
-					if (GetBackgroundWorkerPid(pcxt->worker[i].bgwhandle,
-											   &pid) == BGWH_STARTED)
-						ProcSendSignal(pid);
-				}
-			}
-
-			if (preload_done == 1)
-			{
-				if (p_m_kmrels)
-					*p_m_kmrels = gjs->m_kmrels;
-				return true;
-			}
-			return false;
-		}
-		else
-		{
-			/* wait for the completion of inner preload by the master */
-			CHECK_FOR_INTERRUPTS();
-
-			WaitLatch(&MyProc->procLatch,
-					  WL_LATCH_SET,
-					  -1
-#if PG_VERSION_NUM >= 100000
-					  ,PG_WAIT_EXTENSION
-#endif
-				);
-			ResetLatch(&MyProc->procLatch);
-		}
-	}
-	/* the inner buffer ready? */
-	if (preload_done > 1)
+		SpinLockRelease(&head->lock);
+		pfree(signature);
 		return false;
-
-	gjs->seg_kmrels = dsm_attach(gj_sstate->kmrels_handle);
-	if (!gjs->seg_kmrels)
+	}
+	entry->refcnt++;
+	entry->last_used = now;
+	kmrels_handle = entry->kmrels_handle;
+	kmrels_length = entry->kmrels_length;
+	memcpy(&m_handle, &entry->m_handle, sizeof(CUipcMemHandle));
+	SpinLockRelease(&head->lock);
+
+	/* the reference shall be released on end of the query, at least */
+	cref = MemoryContextAllocZero(estate->es_query_cxt,
+								  sizeof(GpuJoinInnerCacheRef));
+	cref->index = index;
+	cref->released = false;
+	cref->mcb.func = gpujoin_inner_cache_cleanup;
+	cref->mcb.arg = cref;
+	MemoryContextRegisterResetCallback(estate->es_query_cxt, &cref->mcb);
+	gjs->inner_cache_ref = cref;
+
+	seg = dsm_attach(kmrels_handle);
+	if (!seg)
 		elog(ERROR, "could not map dynamic shared memory segment");
+	/* CRC may conflict, so signature text has to be identical also */
+	if (memcmp((char *)dsm_segment_address(seg) + MAXALIGN(kmrels_length),
+			   signature, sig_len + 1) != 0)
+	{
+		dsm_detach(seg);
+		gpujoinReleaseInnerCache(gjs);
+		pfree(signature);
+		return false;
+	}
+	pfree(signature);
 
 	rc = gpuIpcOpenMemHandle(gcontext,
 							 &m_deviceptr,
-							 gj_sstate->pergpu[dindex].m_handle,
+							 m_handle,
 							 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
 	if (rc != CUDA_SUCCESS)
 		elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+	gjs->seg_kmrels = seg;
 	gjs->m_kmrels = m_deviceptr;
-	if (p_m_kmrels)
-		*p_m_kmrels = m_deviceptr;
+	/* parallel workers attach the same buffer */
+	gj_sstate->kmrels_handle = kmrels_handle;
+	memcpy(&gj_sstate->pergpu[dindex].m_handle, &m_handle,
+		   sizeof(CUipcMemHandle));
 	return true;
 }
 
 /*
- * GpuJoinInnerUnload
+ * gpujoinRegisterInnerCache
+ *
+ * It copies the inner buffer just preloaded to the inner buffer cache, if
+ * the inner relations are not modified during the preload.
  */
-void
-GpuJoinInnerUnload(GpuTaskState *gts, bool is_rescan)
+static void
+gpujoinRegisterInnerCache(GpuJoinState *gjs)
 {
-	GpuJoinState   *gjs = (GpuJoinState *) gts;
-	GpuJoinSharedState *gj_sstate = gjs->gj_sstate;
+	GpuJoinInnerCacheHead *head = gpujoin_inner_cache_head;
+	GpuJoinInnerCacheEntry *entry;
+	GpuJoinInnerCacheEntry temp;
 	GpuContext	   *gcontext = gjs->gts.gcontext;
-	cl_int			i;
+	cl_int			dindex = gcontext->cuda_dindex;
+	GpuJoinInnerCacheToken tokens[GPUJOIN_INNER_CACHE_MAX_RELS];
+	TimestampTz		now = GetCurrentTimestamp();
+	kern_multirels *h_kmrels;
+	char		   *signature;
+	size_t			sig_len;
+	pg_crc32		sig_crc;
+	size_t			kmrels_length;
+	dsm_segment	   *seg;
+	dsm_handle		kmrels_handle;
+	CUipcMemHandle	m_handle;
+	int				index;
+	int				victim = -1;
+	bool			do_evict = false;
 	CUresult		rc;
 
-	if (!gj_sstate || !gjs->seg_kmrels)
+#if PG_VERSION_NUM < 100000
+	/* dsm_unpin_segment() is not available */
+	return;
+#endif
+	if (!gpujoin_inner_cache_enabled ||
+		!head ||
+		gjs->inner_signature == NIL ||
+		gjs->part_depth > 0 ||
+		!gjs->inner_cache_tokens ||
+		!gpujoin_inner_cache_check_relations(gjs, tokens))
+		return;
+	/* inner relations might be modified during the preload */
+	if (!gpujoin_inner_cache_token_equal(gjs->inner_cache_tokens, tokens,
+										 gjs->num_rels))
 		return;
+	h_kmrels = dsm_segment_address(gjs->seg_kmrels);
+	Assert(h_kmrels->ojmaps_length == 0);
+	kmrels_length = h_kmrels->kmrels_length;
+	signature = gpujoin_inner_cache_signature(gjs, &sig_len, &sig_crc);
 
-	if (!IsParallelWorker())
+	/* device image on the preserved device memory */
+	rc = gpuMemAllocPreserved(dindex, &m_handle, kmrels_length);
+	if (rc != CUDA_SUCCESS)
 	{
-		/* Release device memory */
-		if (gjs->m_kmrels_array)
+		elog(DEBUG2, "GpuJoin: unable to cache inner buffer (%zu bytes): %s",
+			 kmrels_length, errorText(rc));
+		pfree(signature);
+		return;
+	}
+	PG_TRY();
+	{
+		h_kmrels->cuda_dindex = dindex;
+		gpuIpcMemCopyFromHost(dindex, m_handle, 0, h_kmrels, kmrels_length);
+		h_kmrels->cuda_dindex = numDevAttrs;	/* host side */
+
+		/* host image and signature on the pinned DSM segment */
+		seg = dsm_create(MAXALIGN(kmrels_length) + sig_len + 1, 0);
+		memcpy(dsm_segment_address(seg), h_kmrels, kmrels_length);
+		memcpy((char *)dsm_segment_address(seg) + MAXALIGN(kmrels_length),
+			   signature, sig_len + 1);
+		dsm_pin_segment(seg);
+		kmrels_handle = dsm_segment_handle(seg);
+		dsm_detach(seg);
+	}
+	PG_CATCH();
+	{
+		h_kmrels->cuda_dindex = numDevAttrs;
+		gpuMemFreePreserved(dindex, m_handle);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	pfree(signature);
+
+	/* assign a free slot, or the least recently used one not in use */
+	gpujoin_inner_cache_sweep();
+	SpinLockAcquire(&head->lock);
+	for (index=0; index < GPUJOIN_INNER_CACHE_NSLOTS; index++)
+	{
+		entry = &head->entries[index];
+		if (!entry->in_use)
 		{
-			for (i=0; i < numDevAttrs; i++)
-			{
-				rc = gpuMemFree(gcontext, gjs->m_kmrels_array[i]);
-				if (rc != CUDA_SUCCESS)
-					elog(ERROR, "failed on gpuMemFree: %s", errorText(rc));
-			}
-			pfree(gjs->m_kmrels_array);
-			gjs->m_kmrels_array = NULL;
+			if (victim < 0 || head->entries[victim].in_use)
+				victim = index;
 		}
-		/* Reset GpuJoinSharedState, if rescan */
-		if (is_rescan)
+		else if (entry->is_valid &&
+				 entry->database_oid == MyDatabaseId &&
+				 entry->cuda_dindex == dindex &&
+				 entry->signature_crc == sig_crc &&
+				 entry->signature_len == sig_len)
 		{
-			gjs->curr_outer_depth		= -1;
-			gj_sstate->kmrels_handle	= UINT_MAX;	/* DSM */
-			pg_atomic_init_u32(&gj_sstate->needs_colocation,
-							   numDevAttrs > 1 ? 1 : 0);
-			pg_atomic_init_u32(&gj_sstate->preload_done, 0);
-			pg_atomic_init_u32(&gj_sstate->pg_nworkers, 0);
-			memset(gj_sstate->pergpu, 0,
-				   offsetof(GpuJoinSharedState, pergpu[numDevAttrs]) -
-				   offsetof(GpuJoinSharedState, pergpu[0]));
+			/* concurrent session already cached */
+			victim = -1;
+			break;
+		}
+		else if (entry->refcnt == 0 &&
+				 (victim < 0 ||
+				  (head->entries[victim].in_use &&
+				   head->entries[victim].last_used > entry->last_used)))
+		{
+			victim = index;
 		}
 	}
-	else
+	if (victim >= 0)
 	{
-		rc = gpuIpcCloseMemHandle(gcontext, gjs->m_kmrels);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on gpuIpcCloseMemHandle: %s", errorText(rc));
+		entry = &head->entries[victim];
+		if (entry->in_use)
+		{
+			memcpy(&temp, entry, sizeof(GpuJoinInnerCacheEntry));
+			do_evict = true;
+		}
+		memset(entry, 0, sizeof(GpuJoinInnerCacheEntry));
+		entry->in_use = true;
+		entry->is_valid = true;
+		entry->refcnt = 0;
+		entry->database_oid = MyDatabaseId;
+		entry->cuda_dindex = dindex;
+		entry->signature_crc = sig_crc;
+		entry->signature_len = sig_len;
+		entry->nrels = gjs->num_rels;
+		for (index=0; index < gjs->num_rels; index++)
+		{
+			ScanState  *ss = (ScanState *) gjs->inners[index].state;
+
+			entry->relids[index] = RelationGetRelid(ss->ss_currentRelation);
+			entry->tokens[index] = tokens[index];
+		}
+		entry->kmrels_handle = kmrels_handle;
+		entry->kmrels_length = kmrels_length;
+		memcpy(&entry->m_handle, &m_handle, sizeof(CUipcMemHandle));
+		entry->last_used = now;
 	}
-	dsm_detach(gjs->seg_kmrels);
-	gjs->m_kmrels = 0UL;
-	gjs->seg_kmrels = NULL;
+	SpinLockRelease(&head->lock);
+
+	if (do_evict)
+		gpujoin_inner_cache_free(&temp);
+	if (victim < 0)
+	{
+		memset(&temp, 0, sizeof(GpuJoinInnerCacheEntry));
+		temp.cuda_dindex = dindex;
+		temp.kmrels_handle = kmrels_handle;
+		memcpy(&temp.m_handle, &m_handle, sizeof(CUipcMemHandle));
+		gpujoin_inner_cache_free(&temp);
+	}
+}
+
+/*
+ * gpujoinReleaseInnerCache
+ */
+static void
+gpujoinReleaseInnerCache(GpuJoinState *gjs)
+{
+	GpuJoinInnerCacheRef *cref = gjs->inner_cache_ref;
+
+	if (!cref->released)
+	{
+		cref->released = true;
+		__gpujoin_inner_cache_release(cref->index, true);
+	}
+	gjs->inner_cache_ref = NULL;
+}
+
+/*
+ * gpujoin_inner_cache_invalidator
+ *
+ * relcache callback to invalidate the inner buffer cache which depends on
+ * the relation. Resources shall be released by the next sweep.
+ */
+static void
+gpujoin_inner_cache_invalidator(Datum arg, Oid relid)
+{
+	GpuJoinInnerCacheHead *head = gpujoin_inner_cache_head;
+	int			index, i;
+
+	if (!head)
+		return;
+	SpinLockAcquire(&head->lock);
+	for (index=0; index < GPUJOIN_INNER_CACHE_NSLOTS; index++)
+	{
+		GpuJoinInnerCacheEntry *entry = &head->entries[index];
+
+		if (!entry->in_use ||
+			!entry->is_valid ||
+			entry->database_oid != MyDatabaseId)
+			continue;
+		if (!OidIsValid(relid))
+			entry->is_valid = false;
+		else
+		{
+			for (i=0; i < entry->nrels; i++)
+			{
+				if (entry->relids[i] == relid)
+					entry->is_valid = false;
+			}
+		}
+	}
+	SpinLockRelease(&head->lock);
+}
+
+/*
+ * pgstrom_startup_gpujoin
+ */
+static void
+pgstrom_startup_gpujoin(void)
+{
+	bool		found;
+
+	if (shmem_startup_next)
+		(*shmem_startup_next)();
+
+	gpujoin_inner_cache_head = ShmemInitStruct("PG-Strom GpuJoin Inner Cache",
+											   sizeof(GpuJoinInnerCacheHead),
+											   &found);
+	if (found)
+		elog(ERROR, "Bug? shared memory for GpuJoin inner cache already exists");
+	memset(gpujoin_inner_cache_head, 0, sizeof(GpuJoinInnerCacheHead));
+	SpinLockInit(&gpujoin_inner_cache_head->lock);
 }
 
 /*
@@ -5793,6 +8375,28 @@ gpujoinHasRightOuterJoin(GpuTaskState *gts)
 	return (kmrels->ojmaps_length > 0);
 }
 
+/*
+ * gpujoinHasInnerPartitions
+ *
+ * It returns true, if GpuJoin is planned to split the inner hash table
+ * into multiple partitions. Upper node cannot pull up such GpuJoin,
+ * because it rewinds the outer relation for each partition.
+ */
+bool
+gpujoinHasInnerPartitions(PlanState *ps)
+{
+	GpuJoinState   *gjs = (GpuJoinState *) ps;
+	int				i;
+
+	Assert(pgstrom_planstate_is_gpujoin(ps));
+	for (i=0; i < gjs->num_rels; i++)
+	{
+		if (gjs->inners[i].inner_nparts > 1)
+			return true;
+	}
+	return false;
+}
+
 /*
  * pgstrom_init_gpujoin
  *
@@ -5819,6 +8423,71 @@ pgstrom_init_gpujoin(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* turn on/off bloom filter of inner hash table */
+	DefineCustomBoolVariable("pg_strom.gpujoin_bloom_filter",
+							 "Enables bloom filter of GpuHashJoin inner hash table",
+							 NULL,
+							 &gpujoin_bloom_filter_enabled,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off adaptive reordering of depths */
+	DefineCustomBoolVariable("pg_strom.gpujoin_adaptive_reorder",
+							 "Enables runtime reordering of GpuJoin depths by the observed selectivity",
+							 NULL,
+							 &gpujoin_adaptive_reorder,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off sorted items of inner hash table */
+	DefineCustomBoolVariable("pg_strom.gpujoin_sorted_inner",
+							 "Enables sorted inner hash items of GpuHashJoin for duplicated join keys",
+							 NULL,
+							 &gpujoin_sorted_inner_enabled,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off cooperative processing of heavy hitter keys */
+	DefineCustomBoolVariable("pg_strom.gpujoin_heavy_hitter",
+							 "Enables cooperative GpuHashJoin of heavy hitter join keys by whole the block",
+							 NULL,
+							 &gpujoin_heavy_hitter_enabled,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off sharing of the inner buffer with sibling GpuJoins */
+	DefineCustomBoolVariable("pg_strom.gpujoin_shared_inner",
+							 "Enables to share GpuJoin inner buffer with sibling GpuJoins on the identical inner relations",
+							 NULL,
+							 &gpujoin_shared_inner_enabled,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* turn on/off inner buffer cache over the executions */
+	DefineCustomBoolVariable("pg_strom.gpujoin_inner_cache",
+							 "Enables to cache GpuJoin inner buffer on the preserved device memory for repeated executions",
+							 NULL,
+							 &gpujoin_inner_cache_enabled,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* threshold to split inner hash table into partitions */
+	DefineCustomIntVariable("pg_strom.gpujoin_inner_partition_size",
+							"Max size of inner hash table per partition",
+							NULL,
+							&gpujoin_inner_partition_size_kb,
+							0x60000000 >> 10,
+							pgstrom_chunk_size() >> 10,
+							0x60000000 >> 10,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
 	/* setup path methods */
 	gpujoin_path_methods.CustomName				= "GpuJoin";
 	gpujoin_path_methods.PlanCustomPath			= PlanGpuJoinPath;
@@ -5847,4 +8516,10 @@ pgstrom_init_gpujoin(void)
 	/* hook registration */
 	set_join_pathlist_next = set_join_pathlist_hook;
 	set_join_pathlist_hook = gpujoin_add_join_path;
+
+	/* shared memory for the inner buffer cache */
+	RequestAddinShmemSpace(MAXALIGN(sizeof(GpuJoinInnerCacheHead)));
+	shmem_startup_next = shmem_startup_hook;
+	shmem_startup_hook = pgstrom_startup_gpujoin;
+	CacheRegisterRelcacheCallback(gpujoin_inner_cache_invalidator, 0);
 }
@@ -25,13 +25,23 @@ static CustomScanMethods		gpupreagg_scan_methods;
 static CustomExecMethods		gpupreagg_exec_methods;
 static bool						enable_gpupreagg;
 static bool						enable_pullup_outer_join;
+static bool						enable_fused_outer_join;
+static bool						enable_full_aggregation;
+static bool						enable_spill_final_buffer;
+static bool						enable_shared_final_buffer;
+static bool						enable_compensated_sum;
 
 typedef struct
 {
 	cl_int			num_group_keys;	/* number of grouping keys */
+	bool			full_aggregation; /* GPU produces the final values */
+	bool			small_groupby;	/* warp-level reduction for few groups */
+	cl_int			numeric_fixed_prec; /* max precision of numeric in the
+										 * fixed-point partial sum, if any */
 	double			plan_ngroups;	/* planned number of groups */
 	cl_int			plan_nchunks;	/* planned number of chunks */
 	cl_int			plan_extra_sz;	/* planned size of extra-sz per tuple */
+	cl_uint			varlena_bufsz;	/* length of varlena buffer per slot */
 	Cost			outer_startup_cost; /* copy of @startup_cost in outer */
 	Cost			outer_total_cost; /* copy of @total_cost in outer path */
 	double			outer_nrows;	/* number of estimated outer nrows */
@@ -39,6 +49,8 @@ typedef struct
 	cl_uint			outer_nrows_per_block;
 	Index			outer_scanrelid;/* RTI, if outer path pulled up */
 	Expr		   *outer_quals;	/* device executable quals of outer-scan */
+	List		   *having_quals;	/* HAVING clause on the final values; only
+									 * used by the planner for full aggregation */
 	List		   *tlist_fallback;	/* projection from outer-tlist to GPU's
 									 * initial projection; note that setrefs.c
 									 * should not update this field */
@@ -55,9 +67,13 @@ form_gpupreagg_info(CustomScan *cscan, GpuPreAggInfo *gpa_info)
 	List	   *exprs = NIL;
 
 	privs = lappend(privs, makeInteger(gpa_info->num_group_keys));
+	privs = lappend(privs, makeInteger(gpa_info->full_aggregation));
+	privs = lappend(privs, makeInteger(gpa_info->small_groupby));
+	privs = lappend(privs, makeInteger(gpa_info->numeric_fixed_prec));
 	privs = lappend(privs, pmakeFloat(gpa_info->plan_ngroups));
 	privs = lappend(privs, makeInteger(gpa_info->plan_nchunks));
 	privs = lappend(privs, makeInteger(gpa_info->plan_extra_sz));
+	privs = lappend(privs, makeInteger(gpa_info->varlena_bufsz));
 	privs = lappend(privs, pmakeFloat(gpa_info->outer_startup_cost));
 	privs = lappend(privs, pmakeFloat(gpa_info->outer_total_cost));
 	privs = lappend(privs, pmakeFloat(gpa_info->outer_nrows));
@@ -85,9 +101,13 @@ deform_gpupreagg_info(CustomScan *cscan)
 	int			eindex = 0;
 
 	gpa_info->num_group_keys = intVal(list_nth(privs, pindex++));
+	gpa_info->full_aggregation = intVal(list_nth(privs, pindex++));
+	gpa_info->small_groupby = intVal(list_nth(privs, pindex++));
+	gpa_info->numeric_fixed_prec = intVal(list_nth(privs, pindex++));
 	gpa_info->plan_ngroups = floatVal(list_nth(privs, pindex++));
 	gpa_info->plan_nchunks = intVal(list_nth(privs, pindex++));
 	gpa_info->plan_extra_sz = intVal(list_nth(privs, pindex++));
+	gpa_info->varlena_bufsz = intVal(list_nth(privs, pindex++));
 	gpa_info->outer_startup_cost = floatVal(list_nth(privs, pindex++));
 	gpa_info->outer_total_cost = floatVal(list_nth(privs, pindex++));
 	gpa_info->outer_nrows = floatVal(list_nth(privs, pindex++));
@@ -104,6 +124,33 @@ deform_gpupreagg_info(CustomScan *cscan)
 	return gpa_info;
 }
 
+/*
+ * GpuPreAggFinalBuffer
+ *
+ * A pair of the final reduction buffer and the final hash-slot. Once the
+ * current buffer is expected to overflow, it is spilled out to the host
+ * memory, then reduction continues on a new buffer. The spilled buffers
+ * are returned at the end of the scan, and CPU Agg on the upper level
+ * merges the groups that appear in multiple buffers.
+ */
+typedef struct
+{
+	pgstrom_data_store *pds_final;	/* final reduction buffer */
+	CUdeviceptr		m_kds_final;	/* kds_final to be given to GPU kernel */
+	CUdeviceptr		m_fhash;		/* final hash-slot */
+	CUevent			ev_init_fhash;	/* completion of the hash-slot init */
+	size_t			f_hashsize;		/* initial size of the hash-slot */
+	size_t			f_hashlimit;	/* max size of the hash-slot */
+	size_t			f_nrooms_limit;	/* max number of groups to be kept */
+	/* fields below are protected by f_mutex */
+	size_t			f_ngroups;		/* number of groups by completed tasks */
+	size_t			f_reserved;		/* nrooms reserved by running tasks */
+	size_t			f_nrows_in;		/* rows merged, or to be merged */
+	/* only if final buffer shared by the parallel workers */
+	struct GpuPreAggSharedState *f_sstate;
+	bool			f_ipc_mapped;	/* true, if opened by IPC handle */
+} GpuPreAggFinalBuffer;
+
 /*
  * GpuPreAggSharedState - to be allocated on DSM
  */
@@ -113,6 +160,9 @@ typedef struct
 	struct GpuPreAggSharedState *gpa_sstate;
 	struct GpuPreAggRuntimeStat *gpa_rtstat;
 	cl_bool			combined_gpujoin;
+	cl_bool			fused_gpujoin;
+	cl_bool			full_aggregation;
+	cl_bool			small_groupby;
 	cl_bool			terminator_done;
 	cl_int			num_group_keys;
 	TupleTableSlot *gpreagg_slot;	/* Slot reflects tlist_dev (w/o junks) */
@@ -125,34 +175,68 @@ typedef struct
 	ProjectionInfo *outer_proj;		/* outer tlist -> custom_scan_tlist */
 
 	kern_data_store *kds_slot_head;
-	pgstrom_data_store *pds_final;
-	CUdeviceptr		m_fhash;
-	CUevent			ev_init_fhash;
-	size_t			f_hashsize;
-	size_t			f_hashlimit;
+	GpuPreAggFinalBuffer *fbuf_curr;	/* current final buffer */
+	List		   *fbuf_spilled;	/* list of spilled final buffers */
+	GpuPreAggFinalBuffer *fbuf_shared;	/* shared final buffer, if attached */
+	bool			fbuf_shared_tried;	/* true, if tried to attach */
+	CUdeviceptr		m_fbuf_owned;	/* shared final buffer owned by leader */
 	pthread_mutex_t	f_mutex;
 
 	size_t			plan_nrows_per_chunk;	/* planned nrows/chunk */
 	size_t			plan_nrows_in;	/* num of outer rows planned */
 	size_t			plan_ngroups;	/* num of groups planned */
 	size_t			plan_extra_sz;	/* size of varlena planned */
+	size_t			fixed_nrows_limit; /* max rows per final buffer, if
+										* fixed-point partial sum; or 0 */
 } GpuPreAggState;
 
 struct GpuPreAggRuntimeStat
 {
+	GpuTaskRuntimeStat	c;		/* common statistics */
 	pg_atomic_uint64	source_nitems;
 	pg_atomic_uint64	nitems_filtered;
 	pg_atomic_uint64	num_fallback_rows;
 	pg_atomic_uint64	ccache_count;
 	pg_atomic_uint32	pg_nworkers;
+	pg_atomic_uint32	num_spilled_buffers;
 };
 typedef struct GpuPreAggRuntimeStat	GpuPreAggRuntimeStat;
 
+/* GPU kernels tracked by EXPLAIN ANALYZE */
+static const char *gpupreagg_kernel_names[] = {
+	"gpupreagg_setup_row",
+	"gpupreagg_setup_block",
+	"gpupreagg_setup_column",
+	"gpupreagg_nogroup_reduction",
+	"gpupreagg_groupby_reduction",
+	"gpujoin_main",
+	"gpujoin_right_outer",
+	NULL
+};
+
 struct GpuPreAggSharedState
 {
 	dsm_handle		ss_handle;	/* DSM handle of the SharedState */
 	cl_uint			ss_length;	/* Length of the SharedState */
 	GpuPreAggRuntimeStat gpa_rtstat;	/* Run-time statistics */
+	/*
+	 * Final buffer and hash-slot shared by the participants on the same
+	 * device, if any; see gpupreagg_setup_shared_final_buffer().
+	 * Fields below are protected by @f_lock, except for atomic counters.
+	 */
+	slock_t			f_lock;
+	cl_int			f_cuda_dindex;	/* device of the shared buffer, or -1 */
+	cl_bool			f_returned;		/* true, if already returned */
+	cl_int			f_nattached;	/* # of participants attached */
+	cl_int			f_ndone;		/* # of participants completed */
+	size_t			f_length;		/* length of the kds_final */
+	size_t			f_hashsize;		/* initial size of the hash-slot */
+	size_t			f_hashlimit;	/* max size of the hash-slot */
+	size_t			f_nrooms_limit;	/* max number of groups to be kept */
+	CUipcMemHandle	f_mhandle;		/* IPC handle of kds_final + hash-slot */
+	pg_atomic_uint64 f_ngroups;		/* number of groups by completed tasks */
+	pg_atomic_uint64 f_reserved;	/* nrooms reserved by running tasks */
+	pg_atomic_uint64 f_nrows_in;	/* rows merged, or to be merged */
 };
 typedef struct GpuPreAggSharedState	GpuPreAggSharedState;
 
@@ -182,6 +266,9 @@ typedef struct
 	kern_gpujoin	   *kgjoin;		/* kern_gpujoin, if combined mode */
 	CUdeviceptr			m_kmrels;	/* kern_multirels, if combined mode */
 	cl_int				outer_depth;/* RIGHT OUTER depth, if combined mode */
+	GpuPreAggFinalBuffer *fbuf;		/* final buffer to be used */
+	size_t				f_reserved;	/* nrooms reserved on the fbuf */
+	bool				fbuf_spilled; /* true, if task returns spilled fbuf */
 	kern_gpupreagg		kern;
 } GpuPreAggTask;
 
@@ -193,8 +280,10 @@ static bool		gpupreagg_build_path_target(PlannerInfo *root,
 											PathTarget *target_device,
 											PathTarget *target_input,
 											Bitmapset **p_pfunc_bitmap,
+											int *p_numeric_fixed_prec,
 											Node **p_havingQual,
 											bool *p_can_pullup_outerscan);
+static Expr	   *make_expr_typecast(Expr *expr, Oid target_type);
 static char	   *gpupreagg_codegen(codegen_context *context,
 								  PlannerInfo *root,
 								  CustomScan *cscan,
@@ -206,6 +295,9 @@ static GpuPreAggSharedState *createGpuPreAggSharedState(GpuPreAggState *gpas,
 														ParallelContext *pcxt,
 														void *dsm_addr);
 static void releaseGpuPreAggSharedState(GpuPreAggState *gpas);
+static void gpupreagg_release_final_buffer(GpuContext *gcontext,
+										   GpuPreAggFinalBuffer *fbuf);
+static void gpupreagg_setup_shared_final_buffer(GpuPreAggState *gpas);
 static void resetGpuPreAggSharedState(GpuPreAggState *gpas);
 
 static GpuTask *gpupreagg_next_task(GpuTaskState *gts);
@@ -248,6 +340,13 @@ static TupleTableSlot *gpupreagg_next_tuple(GpuTaskState *gts);
 #define NUMERICARRAYOID		1231	/* see pg_type.h */
 #endif
 
+/*
+ * NOTE: float2 is not a built-in data type, so its OID is not a constant.
+ * The catalog below uses FLOAT2OID_PSEUDO instead, and arguments of
+ * pg_catalog.float2 are mapped to it on aggfunc_lookup_by_oid().
+ */
+#define FLOAT2OID_PSEUDO	((Oid) 0xfffffffeU)
+
 /*
  * List of supported aggregate functions
  */
@@ -298,6 +397,11 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	  "s:pavg", 2, {INT8OID, FLOAT8OID},
 	  {ALTFUNC_EXPR_NROWS, ALTFUNC_EXPR_PSUM}, 0, INT_MAX
 	},
+	{ "avg",    1, {FLOAT2OID_PSEUDO},
+	  "s:favg",     FLOAT8ARRAYOID,
+	  "s:pavg", 2, {INT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS, ALTFUNC_EXPR_PSUM}, 0, INT_MAX
+	},
 #ifdef GPUPREAGG_SUPPORT_NUMERIC
 	{ "avg",	1, {NUMERICOID},
 	  "s:favg_numeric", FLOAT8ARRAYOID,
@@ -460,6 +564,11 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	  "varref", 1, {FLOAT8OID},
 	  {ALTFUNC_EXPR_PSUM}, 0, INT_MAX
 	},
+	{ "sum",    1, {FLOAT2OID_PSEUDO},
+	  "c:sum",      FLOAT8OID,
+	  "varref", 1, {FLOAT8OID},
+	  {ALTFUNC_EXPR_PSUM}, 0, INT_MAX
+	},
 #ifdef GPUPREAGG_SUPPORT_NUMERIC
 	{ "sum",    1, {NUMERICOID},
 	  "s:fsum_numeric", FLOAT8OID,
@@ -508,6 +617,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
 	},
+	{ "stddev",      1, {FLOAT2OID_PSEUDO},
+	  "s:stddev",        FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
 	{ "stddev",      1, {NUMERICOID},
 	  "s:stddev_numeric", FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -551,6 +667,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
 	},
+	{ "stddev_pop",  1, {FLOAT2OID_PSEUDO},
+	  "s:stddev_pop",    FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
 	{ "stddev_pop",  1, {NUMERICOID},
 	  "s:stddev_numeric", FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -594,6 +717,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
 	},
+	{ "stddev_samp", 1, {FLOAT2OID_PSEUDO},
+	  "s:stddev_samp",   FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
 	{ "stddev_samp", 1, {NUMERICOID},
 	  "s:stddev_numeric", FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -637,6 +767,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
 	},
+	{ "variance",    1, {FLOAT2OID_PSEUDO},
+	  "s:variance",      FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
 	{ "variance",    1, {NUMERICOID},
 	  "s:variance_numeric", FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -680,6 +817,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
 	},
+	{ "var_pop",     1, {FLOAT2OID_PSEUDO},
+	  "s:var_pop",       FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
 	{ "var_pop",     1, {NUMERICOID},
 	  "s:var_pop_numeric", FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -723,6 +867,13 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	   ALTFUNC_EXPR_PSUM,
 	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
 	},
+	{ "var_samp",    1, {FLOAT2OID_PSEUDO},
+	  "s:var_samp",      FLOAT8ARRAYOID,
+	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
+	  {ALTFUNC_EXPR_NROWS,
+	   ALTFUNC_EXPR_PSUM,
+	   ALTFUNC_EXPR_PSUM_X2}, 0, SHRT_MAX
+	},
 	{ "var_samp",    1, {NUMERICOID},
 	  "s:var_samp_numeric", FLOAT8ARRAYOID,
 	  "s:pvariance", 3, {INT8OID, FLOAT8OID, FLOAT8OID},
@@ -875,12 +1026,31 @@ aggfunc_lookup_by_oid(Oid aggfnoid)
 {
 	Form_pg_proc	proform;
 	HeapTuple		htup;
-	int				i;
+	Oid				argtypes[4];
+	Oid				float2_oid;
+	int				i, j;
 
 	htup = SearchSysCache1(PROCOID, ObjectIdGetDatum(aggfnoid));
 	if (!HeapTupleIsValid(htup))
 		elog(ERROR, "cache lookup failed for function %u", aggfnoid);
 	proform = (Form_pg_proc) GETSTRUCT(htup);
+	if (proform->pronargs > lengthof(argtypes))
+	{
+		ReleaseSysCache(htup);
+		return NULL;
+	}
+	/* float2 argument is compared to FLOAT2OID_PSEUDO */
+	float2_oid = GetSysCacheOid2(TYPENAMENSP,
+								 CStringGetDatum("float2"),
+								 ObjectIdGetDatum(PG_CATALOG_NAMESPACE));
+	for (j=0; j < proform->pronargs; j++)
+	{
+		Oid		type_oid = proform->proargtypes.values[j];
+
+		if (OidIsValid(float2_oid) && type_oid == float2_oid)
+			type_oid = FLOAT2OID_PSEUDO;
+		argtypes[j] = type_oid;
+	}
 
 	for (i=0; i < lengthof(aggfunc_catalog); i++)
 	{
@@ -889,7 +1059,7 @@ aggfunc_lookup_by_oid(Oid aggfnoid)
 		if (strcmp(catalog->aggfn_name, NameStr(proform->proname)) == 0 &&
 			catalog->aggfn_nargs == proform->pronargs &&
 			memcmp(catalog->aggfn_argtypes,
-				   proform->proargtypes.values,
+				   argtypes,
 				   sizeof(Oid) * catalog->aggfn_nargs) == 0)
 		{
 			/* check status of device NUMERIC type support */
@@ -920,7 +1090,10 @@ cost_gpupreagg(PlannerInfo *root,
 			   int parallel_nworkers,
 			   double num_groups)
 {
-	double		gpu_cpu_ratio = pgstrom_gpu_operator_cost / cpu_operator_cost;
+	double		gpu_setup_cost;
+	double		gpu_dma_cost;
+	double		gpu_operator_cost;
+	double		gpu_cpu_ratio;
 	double		ntuples_out;
 	Cost		startup_cost;
 	Cost		run_cost;
@@ -931,6 +1104,12 @@ cost_gpupreagg(PlannerInfo *root,
 	cl_int		index;
 	ListCell   *lc;
 
+	/* static or calibrated cost factors */
+	pgstrom_gpu_cost_factors(&gpu_setup_cost,
+							 &gpu_dma_cost,
+							 &gpu_operator_cost);
+	gpu_cpu_ratio = gpu_operator_cost / cpu_operator_cost;
+
 	/* Cost come from the underlying path */
 	if (gpa_info->outer_scanrelid == 0)
 	{
@@ -949,7 +1128,7 @@ cost_gpupreagg(PlannerInfo *root,
 			outer_total -= cpu_tuple_cost * input_path->rows;
 		}
 		else
-			outer_total += pgstrom_gpu_setup_cost;
+			outer_total += gpu_setup_cost;
 
 		gpa_info->outer_startup_cost = outer_startup;
 		gpa_info->outer_total_cost   = outer_total;
@@ -1046,7 +1225,7 @@ cost_gpupreagg(PlannerInfo *root,
 	startup_cost += (target_device->cost.per_tuple * input_path->rows +
 					 target_device->cost.startup) * gpu_cpu_ratio;
 	/* Cost estimation for grouping */
-	startup_cost += (pgstrom_gpu_operator_cost *
+	startup_cost += (gpu_operator_cost *
 					 num_group_keys *
 					 input_path->rows);
 	/* Cost estimation for aggregate function */
@@ -1105,6 +1284,7 @@ make_gpupreagg_path(PlannerInfo *root,
 					PathTarget *target_partial,
 					PathTarget *target_device,
 					Bitmapset *pfunc_bitmap,
+					int numeric_fixed_prec,
 					Path *input_path,
 					double num_groups,
 					bool can_pullup_outerscan)
@@ -1117,6 +1297,7 @@ make_gpupreagg_path(PlannerInfo *root,
 	/* obviously, not suitable for GpuPreAgg */
 	if (num_groups < 1.0 || num_groups > (double)INT_MAX)
 		return NULL;
+	gpa_info->numeric_fixed_prec = numeric_fixed_prec;
 
 	/* Try to pull up input_path if simple relation scan */
 	if (!can_pullup_outerscan ||
@@ -1157,13 +1338,172 @@ make_gpupreagg_path(PlannerInfo *root,
 	return cpath;
 }
 
+/*
+ * replace_aggref_by_final_value
+ *
+ * It replaces the final Aggref by an expression that computes the final
+ * value from the partial aggregation result. It works only if the GPU
+ * kernel reduced all the input rows of a group into one partial result,
+ * thus, the final aggregate function shall transit its state once.
+ */
+static Node *
+replace_aggref_by_final_value(Node *node, bool *p_failed)
+{
+	if (!node)
+		return NULL;
+	if (IsA(node, Aggref))
+	{
+		Aggref		   *aggref = (Aggref *) node;
+		TargetEntry	   *tle;
+		Expr		   *expr;
+		Oid				expr_type;
+		HeapTuple		tuple;
+		Form_pg_aggregate agg_form;
+
+		/* DISTINCT needs the final Agg node */
+		if (aggref->aggdistinct)
+		{
+			*p_failed = true;
+			return node;
+		}
+		Assert(list_length(aggref->args) == 1);
+		tle = linitial(aggref->args);
+		expr = tle->expr;
+		expr_type = exprType((Node *) expr);
+
+		tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(aggref->aggfnoid));
+		if (!HeapTupleIsValid(tuple))
+			elog(ERROR, "cache lookup failed for pg_aggregate %u",
+				 aggref->aggfnoid);
+		agg_form = (Form_pg_aggregate) GETSTRUCT(tuple);
+		if (agg_form->aggtranstype == expr_type)
+		{
+			/* partial result is the transition state as is */
+			if (OidIsValid(agg_form->aggfinalfn))
+				expr = (Expr *)makeFuncExpr(agg_form->aggfinalfn,
+											aggref->aggtype,
+											list_make1(expr),
+											aggref->aggcollid,
+											aggref->inputcollid,
+											COERCE_EXPLICIT_CALL);
+		}
+		else if (SearchSysCacheExists2(CASTSOURCETARGET,
+									   ObjectIdGetDatum(expr_type),
+									   ObjectIdGetDatum(aggref->aggtype)))
+		{
+			/* e.g) sum(int8) has internal state, but equivalent to cast */
+			expr = make_expr_typecast(expr, aggref->aggtype);
+		}
+		else
+		{
+			elog(DEBUG2, "unable to make final value of %s by GPU",
+				 format_procedure(aggref->aggfnoid));
+			*p_failed = true;
+		}
+		ReleaseSysCache(tuple);
+
+		return (Node *) expr;
+	}
+	return expression_tree_mutator(node, replace_aggref_by_final_value,
+								   p_failed);
+}
+
+/*
+ * try_add_gpupreagg_full_path
+ *
+ * If a single GPU device handles the whole input stream of a GROUP BY
+ * aggregation, the final buffer of GpuPreAgg already keeps exactly one
+ * partial result per group. So, we can drop the final Agg node and apply
+ * the final functions on the projection of GpuPreAgg instead.
+ */
+static void
+try_add_gpupreagg_full_path(PlannerInfo *root,
+							RelOptInfo *group_rel,
+							CustomPath *cpath,
+							PathTarget *target_final,
+							PathTarget *target_upper,
+							Node *havingQual,
+							double num_groups)
+{
+	Query		   *parse = root->parse;
+	CustomPath	   *fpath;
+	GpuPreAggInfo  *gpa_info;
+	PathTarget	   *target_full;
+	Path		   *final_path;
+	List		   *having_quals = NIL;
+	QualCost		qual_cost;
+	bool			failed = false;
+
+	if (!enable_full_aggregation)
+		return;
+	/* no-group aggregation is cheap enough on CPU */
+	if (!parse->groupClause || parse->groupingSets)
+		return;
+	/* partial results are generated by multiple processes or devices */
+	if (cpath->path.parallel_workers > 0 || numDevAttrs != 1)
+		return;
+	/* fixed-point partial sum may be split into multiple final buffers */
+	gpa_info = linitial(cpath->custom_private);
+	if (gpa_info->numeric_fixed_prec > 0)
+		return;
+
+	target_full = copy_pathtarget(target_final);
+	target_full->exprs = (List *)
+		replace_aggref_by_final_value((Node *) target_final->exprs, &failed);
+	if (failed)
+		return;
+
+	/*
+	 * HAVING clause is also evaluated on the final values, by GpuPreAgg
+	 * itself as a host qualifier, prior to the projection. So, groups
+	 * are filtered out without any final Agg node.
+	 */
+	if (havingQual)
+	{
+		having_quals = (List *)
+			replace_aggref_by_final_value(havingQual, &failed);
+		if (failed)
+			return;
+	}
+
+	/* GpuPreAgg path in the full aggregation mode */
+	gpa_info = palloc(sizeof(GpuPreAggInfo));
+	memcpy(gpa_info, linitial(cpath->custom_private),
+		   sizeof(GpuPreAggInfo));
+	gpa_info->full_aggregation = true;
+	gpa_info->having_quals = having_quals;
+
+	fpath = makeNode(CustomPath);
+	memcpy(fpath, cpath, sizeof(CustomPath));
+	fpath->path.parallel_safe = false;
+	if (having_quals != NIL)
+	{
+		cost_qual_eval(&qual_cost, having_quals, root);
+		fpath->path.startup_cost += qual_cost.startup;
+		fpath->path.total_cost += (qual_cost.startup +
+								   qual_cost.per_tuple * fpath->path.rows);
+	}
+	fpath->custom_private = list_make3(gpa_info,
+									   lsecond(cpath->custom_private),
+									   lthird(cpath->custom_private));
+	final_path = (Path *)create_projection_path(root,
+												group_rel,
+												&fpath->path,
+												target_full);
+	final_path->rows = num_groups;
+	add_path(group_rel, pgstrom_create_dummy_path(root,
+												  final_path,
+												  target_upper));
+}
+
 /*
  * try_add_gpupreagg_paths
  */
 static void
 try_add_gpupreagg_paths(PlannerInfo *root,
 						RelOptInfo *group_rel,
-						Path *input_path)
+						Path *input_path,
+						GroupingSetsPath *gsets_path)
 {
 	Query		   *parse = root->parse;
 	PathTarget	   *target_upper	= root->upper_targets[UPPERREL_GROUP_AGG];
@@ -1175,8 +1515,10 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 	Path		   *final_path;
 	Path		   *sort_path;
 	Bitmapset	   *pfunc_bitmap;
+	int				numeric_fixed_prec;
 	Node		   *havingQual;
 	double			num_groups;
+	double			num_partial_groups;
 	bool			can_sort;
 	bool			can_hash;
 	bool			can_pullup_outerscan = true;
@@ -1190,6 +1532,7 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 									 target_device,
 									 input_path->pathtarget,
 									 &pfunc_bitmap,
+									 &numeric_fixed_prec,
 									 &havingQual,
 									 &can_pullup_outerscan))
 		return;
@@ -1231,9 +1574,13 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 		get_agg_clause_costs(root, havingQual,
 							 AGGSPLIT_SIMPLE, &agg_final_costs);
 	}
-	/* GpuPreAgg does not support ordered aggregation */
-	if (agg_final_costs.numOrderedAggs > 0)
-		return;
+	/*
+	 * NOTE: Aggregate with ORDER BY is already rejected, so @numOrderedAggs
+	 * counts aggregates with DISTINCT and ordered-set aggregates. They add
+	 * extra grouping keys to GpuPreAgg, see make_distinct_aggref() and
+	 * make_percentile_aggref(). So, hashed final aggregation is not
+	 * available.
+	 */
 
 	/* Estimated number of groups */
 	if (!parse->groupClause)
@@ -1245,6 +1592,29 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 		num_groups = pathnode->rows;
 	}
 
+	/*
+	 * DISTINCT keys increases number of the groups by GpuPreAgg, and
+	 * GpuPreAgg groups by the finest level of the grouping sets, not
+	 * the sum of the groups in the individual grouping sets.
+	 */
+	num_partial_groups = num_groups;
+	if (agg_final_costs.numOrderedAggs > 0 || parse->groupingSets)
+	{
+		List	   *group_exprs = NIL;
+		ListCell   *lc;
+		int			i = 0;
+
+		foreach (lc, target_partial->exprs)
+		{
+			if (get_pathtarget_sortgroupref(target_partial, i++))
+				group_exprs = lappend(group_exprs, lfirst(lc));
+		}
+		if (group_exprs != NIL)
+			num_partial_groups = estimate_num_groups(root, group_exprs,
+													 input_path->rows,
+													 NULL);
+	}
+
 	/*
 	 * construction of GpuPreAgg pathnode on top of the cheapest total
 	 * cost pathnode (partial aggregation)
@@ -1253,12 +1623,20 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 								target_partial,
 								target_device,
 								pfunc_bitmap,
+								numeric_fixed_prec,
 								input_path,
-								num_groups,
+								num_partial_groups,
 								can_pullup_outerscan);
 	if (!cpath)
 		return;
 
+	/* try GpuPreAgg that produces the final values by itself */
+	try_add_gpupreagg_full_path(root, group_rel, cpath,
+								target_final,
+								target_upper,
+								havingQual,
+								num_groups);
+
 	/*
 	 * If GpuPreAgg pathnode is parallel-safe, inject Gather node prior to
 	 * the final aggregation step.
@@ -1292,9 +1670,56 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 				agg_final_costs.numOrderedAggs == 0 &&
 				grouping_is_hashable(parse->groupClause));
 
-	/* make a final grouping path (nogroup) */
-	if (!parse->groupClause)
+	/*
+	 * make a final grouping path (grouping sets)
+	 *
+	 * GpuPreAgg runs partial aggregation on the finest grouping level, that
+	 * is the union of all the grouping keys, then GroupingSets node rolls up
+	 * the partial results into the individual grouping sets. We follow the
+	 * strategy and rollups chosen by the built-in GroupingSetsPath.
+	 */
+	if (parse->groupingSets)
+	{
+		Path	   *gsets_input = partial_path;
+
+		if (!gsets_path)
+			return;		/* give up */
+#if PG_VERSION_NUM >= 100000
+		if (gsets_path->aggstrategy != AGG_HASHED)
+#endif
+		{
+			if (!can_sort)
+				return;
+			if (root->group_pathkeys != NIL)
+				gsets_input = (Path *)
+					create_sort_path(root,
+									 group_rel,
+									 partial_path,
+									 root->group_pathkeys,
+									 -1.0);
+		}
+		final_path = (Path *)
+			create_groupingsets_path(root,
+									 group_rel,
+									 gsets_input,
+									 target_final,
+									 (List *) havingQual,
+#if PG_VERSION_NUM < 100000
+									 gsets_path->rollup_lists,
+									 gsets_path->rollup_groupclauses,
+#else
+									 gsets_path->aggstrategy,
+									 gsets_path->rollups,
+#endif
+									 &agg_final_costs,
+									 num_groups);
+		add_path(group_rel, pgstrom_create_dummy_path(root,
+													  final_path,
+													  target_upper));
+	}
+	else if (!parse->groupClause)
 	{
+		/* make a final grouping path (nogroup) */
 		final_path = (Path *)create_agg_path(root,
 											 group_rel,
 											 partial_path,
@@ -1320,62 +1745,7 @@ try_add_gpupreagg_paths(PlannerInfo *root,
 								 partial_path,
 								 root->group_pathkeys,
 								 -1.0);
-			if (parse->groupingSets)
-			{
-#if PG_VERSION_NUM < 100000
-				List	   *rollup_lists = NIL;
-				List	   *rollup_groupclauses = NIL;
-#else
-				AggStrategy	rollup_strategy = AGG_PLAIN;
-				List	   *rollup_data_list = NIL;
-#endif
-				bool		found = false;
-				ListCell   *lc;
-
-				/*
-				 * TODO: In this version, we expect group_rel->pathlist have
-				 * a GroupingSetsPath constructed by the built-in code.
-				 * It may not be right, if multiple CSP/FDW is installed and
-				 * cheaper path already eliminated the standard path.
-				 * However, it is a corner case now, and we don't support
-				 * this scenario _right now_.
-				 */
-				foreach (lc, group_rel->pathlist)
-				{
-					GroupingSetsPath   *pathnode = lfirst(lc);
-
-					if (IsA(pathnode, GroupingSetsPath))
-					{
-#if PG_VERSION_NUM < 100000
-						rollup_groupclauses = pathnode->rollup_groupclauses;
-						rollup_lists = pathnode->rollup_lists;
-#else
-						rollup_strategy = pathnode->aggstrategy;
-						rollup_data_list = pathnode->rollups;
-#endif
-						found = true;
-						break;
-					}
-				}
-				if (!found)
-					return;		/* give up */
-				final_path = (Path *)
-					create_groupingsets_path(root,
-											 group_rel,
-											 sort_path,
-											 target_final,
-											 (List *)parse->havingQual,
-#if PG_VERSION_NUM < 100000
-											 rollup_lists,
-											 rollup_groupclauses,
-#else
-											 rollup_strategy,
-											 rollup_data_list,
-#endif
-											 &agg_final_costs,
-											 num_groups);
-			}
-			else if (parse->hasAggs)
+			if (parse->hasAggs)
 				final_path = (Path *)
 					create_agg_path(root,
 									group_rel,
@@ -1444,6 +1814,7 @@ gpupreagg_add_grouping_paths(PlannerInfo *root,
 							 RelOptInfo *group_rel)
 {
 	Path	   *input_path;
+	GroupingSetsPath *gsets_path = NULL;
 	ListCell   *lc;
 
 	if (create_upper_paths_next)
@@ -1464,9 +1835,32 @@ gpupreagg_add_grouping_paths(PlannerInfo *root,
 		return;
 	}
 
+	/*
+	 * GroupingSetsPath constructed by the built-in code tells us the rollups
+	 * for the final aggregation. It has to be picked up prior to add_path()
+	 * by ourselves, because GpuPreAgg paths may eliminate the built-in one.
+	 *
+	 * TODO: It may not be right, if multiple CSP/FDW is installed and
+	 * cheaper path already eliminated the standard path. However, it is
+	 * a corner case now, and we don't support this scenario _right now_.
+	 */
+	if (root->parse->groupingSets)
+	{
+		foreach (lc, group_rel->pathlist)
+		{
+			if (IsA(lfirst(lc), GroupingSetsPath))
+			{
+				gsets_path = lfirst(lc);
+				break;
+			}
+		}
+		if (!gsets_path)
+			return;
+	}
+
 	/* traditional GpuPreAgg + Agg path consideration */
 	input_path = input_rel->cheapest_total_path;
-	try_add_gpupreagg_paths(root, group_rel, input_path);
+	try_add_gpupreagg_paths(root, group_rel, input_path, gsets_path);
 
 	/*
 	 * add GpuPreAgg + Gather + Agg path for CPU+GPU hybrid parallel
@@ -1476,7 +1870,7 @@ gpupreagg_add_grouping_paths(PlannerInfo *root,
 		foreach (lc, input_rel->partial_pathlist)
 		{
 			input_path = lfirst(lc);
-			try_add_gpupreagg_paths(root, group_rel, input_path);
+			try_add_gpupreagg_paths(root, group_rel, input_path, gsets_path);
 		}
 	}
 }
@@ -1549,7 +1943,8 @@ is_altfunc_expression(Node *node)
 		 strcmp(NameStr(form_proc->proname), "pcov_y") == 0 ||
 		 strcmp(NameStr(form_proc->proname), "pcov_x2") == 0 ||
 		 strcmp(NameStr(form_proc->proname), "pcov_y2") == 0 ||
-		 strcmp(NameStr(form_proc->proname), "pcov_xy") == 0))
+		 strcmp(NameStr(form_proc->proname), "pcov_xy") == 0 ||
+		 strcmp(NameStr(form_proc->proname), "pcomp") == 0))
 		retval = true;
 	ReleaseSysCache(tuple);
 
@@ -1968,6 +2363,32 @@ make_alternative_aggref(Aggref *aggref,
 			*p_pfunc_bitmap = bms_add_member(*p_pfunc_bitmap,
 											 list_length(target_device->exprs) - 1);
 		}
+		/*
+		 * In the compensated summation mode, float8 sum is accumulated with
+		 * PCOMP(pfunc) that keeps rounding errors of the pfunc. It is always
+		 * located after the pfunc, and the partial result is PFUNC + PCOMP.
+		 */
+		if (enable_compensated_sum &&
+			action != ALTFUNC_EXPR_NROWS &&
+			action != ALTFUNC_EXPR_PMIN &&
+			action != ALTFUNC_EXPR_PMAX &&
+			pfunc->funcresulttype == FLOAT8OID)
+		{
+			FuncExpr   *pcomp = make_altfunc_simple_expr("pcomp",
+														 (Expr *)pfunc);
+			if (!list_member(target_device->exprs, pcomp))
+			{
+				add_column_to_pathtarget(target_device, (Expr *)pcomp, 0);
+				*p_pfunc_bitmap = bms_add_member(*p_pfunc_bitmap,
+											list_length(target_device->exprs) - 1);
+			}
+			pfunc = makeFuncExpr(F_FLOAT8PL,
+								 FLOAT8OID,
+								 list_make2(pfunc, pcomp),
+								 InvalidOid,
+								 InvalidOid,
+								 COERCE_EXPLICIT_CALL);
+		}
 		/* append to the argument list */
 		altfunc_args = lappend(altfunc_args, (Expr *)pfunc);
 	}
@@ -2073,70 +2494,539 @@ make_alternative_aggref(Aggref *aggref,
 typedef struct
 {
 	bool		device_executable;
+	bool		can_pullup_outerscan;
 	Query	   *parse;
 	PathTarget *target_upper;
 	PathTarget *target_partial;
 	PathTarget *target_device;
 	PathTarget *target_input;
 	Bitmapset  *pfunc_bitmap;
+	int			numeric_fixed_prec;	/* max precision of fixed-point sum */
+	Index		max_sortgroupref;	/* for extra grouping keys */
 } gpupreagg_build_path_target_context;
 
-static Node *
-replace_expression_by_altfunc(Node *node,
-							  gpupreagg_build_path_target_context *con)
+/*
+ * add_extra_grouping_key
+ *
+ * It adds @expr as an extra grouping key of GpuPreAgg, in addition to the
+ * GROUP BY clause. @expr must be on the input items, as grouping keys are.
+ */
+static bool
+add_extra_grouping_key(Expr *expr,
+					   gpupreagg_build_path_target_context *con)
 {
-	PathTarget *target_input = con->target_input;
-	ListCell   *lc;
+	PathTarget	   *target_partial = con->target_partial;
+	PathTarget	   *target_device = con->target_device;
+	Oid				type_oid = exprType((Node *) expr);
+	devtype_info   *dtype;
+	Index			sortgroupref;
+	ListCell	   *lc;
+	int				i;
 
-	if (!node)
-		return NULL;
-	if (IsA(node, Aggref))
+	dtype = pgstrom_devtype_lookup(type_oid);
+	if (!dtype || !OidIsValid(dtype->type_eqfunc))
 	{
-		Node   *aggfn = make_alternative_aggref((Aggref *)node,
-												con->target_partial,
-												con->target_device,
-												con->target_input,
-												&con->pfunc_bitmap);
-		if (!aggfn)
-			con->device_executable = false;
-		return aggfn;
+		elog(DEBUG2, "extra grouping key is not device comparable: %s",
+			 nodeToString(expr));
+		return false;
 	}
 
-	foreach (lc, target_input->exprs)
+	i = 0;
+	foreach (lc, target_device->exprs)
 	{
-		Expr   *expr_in = lfirst(lc);
-
-		if (equal(node, expr_in))
-		{
-			add_new_column_to_pathtarget(con->target_partial,
-										 copyObject(expr_in));
-			add_new_column_to_pathtarget(con->target_device,
-										 copyObject(expr_in));
-			return copyObject(node);
-		}
+		if (equal(expr, lfirst(lc)))
+			break;
+		i++;
 	}
-	if (IsA(node, Var) || IsA(node, PlaceHolderVar))
-		elog(ERROR, "Bug? referenced variable is neither grouping-key nor its dependent key: %s",
-			 nodeToString(node));
-	return expression_tree_mutator(node, replace_expression_by_altfunc, con);
+	if (!lc)
+	{
+		elog(DEBUG2, "extra grouping key is not on the input tlist: %s",
+			 nodeToString(expr));
+		return false;
+	}
+	/* see the comment at gpupreagg_build_path_target */
+	if (!IsA(expr, Var) &&
+		!IsA(expr, Param) &&
+		!IsA(expr, Const) &&
+		(!pgstrom_device_expression(expr) || !get_typbyval(type_oid)))
+		con->can_pullup_outerscan = false;
+
+	sortgroupref = target_device->sortgrouprefs[i];
+	if (sortgroupref == 0)
+	{
+		sortgroupref = ++con->max_sortgroupref;
+		target_device->sortgrouprefs[i] = sortgroupref;
+		add_column_to_pathtarget(target_partial, copyObject(expr),
+								 sortgroupref);
+	}
+	return true;
 }
 
 /*
- * gpupreagg_build_path_target
- *
- *
+ * make_distinct_aggref
  *
+ * An aggregate function with DISTINCT depends on only the set of unique
+ * values of the argument. So, GpuPreAgg can deduplicate the argument on
+ * the device if it is added to the grouping keys, then the final Agg node
+ * runs the original Aggref (with DISTINCT) on the partial results.
+ * Other partial aggregation results are also consistent, because results
+ * of the finer groups are merged by the final aggregation.
  */
-static bool
-gpupreagg_build_path_target(PlannerInfo *root,			/* in */
-							PathTarget *target_upper,	/* in */
-							PathTarget *target_final,	/* out */
-							PathTarget *target_partial,	/* out */
-							PathTarget *target_device,	/* out */
-							PathTarget *target_input,	/* in */
-							Bitmapset **p_pfunc_bitmap,	/* out */
-							Node **p_havingQual,		/* out */
-							bool *p_can_pullup_outerscan) /* out */
+static Node *
+make_distinct_aggref(Aggref *aggref,
+					 gpupreagg_build_path_target_context *con)
+{
+	Query		   *parse = con->parse;
+	TargetEntry	   *tle;
+	Expr		   *expr;
+	ListCell	   *lc;
+
+	if (aggref->aggorder ||
+		aggref->aggfilter ||
+		aggref->aggvariadic ||
+		aggref->aggkind != AGGKIND_NORMAL ||
+		list_length(aggref->args) != 1)
+	{
+		elog(DEBUG2, "Aggregate with DISTINCT is not supported: %s",
+			 nodeToString(aggref));
+		return NULL;
+	}
+	tle = linitial(aggref->args);
+	expr = tle->expr;
+
+	/* DISTINCT key is same to the grouping key? Nonsense. */
+	foreach (lc, parse->groupClause)
+	{
+		SortGroupClause *sgc = lfirst(lc);
+
+		if (equal(expr, get_sortgroupclause_expr(sgc, parse->targetList)))
+			return NULL;
+	}
+
+	if (!add_extra_grouping_key(expr, con))
+		return NULL;
+
+	return copyObject(aggref);
+}
+
+/*
+ * make_percentile_aggref
+ *
+ * percentile_cont and percentile_disc need all the values of the group,
+ * so partial state cannot be built by reduction. Instead, GpuPreAgg adds
+ * the ORDER BY key to the grouping keys, and counts number of rows for
+ * each distinct value. Then, pgstrom.percentile_cont/percentile_disc
+ * computes the exact percentile from the pairs of value and count.
+ * It works well when the ORDER BY key has relatively small cardinality,
+ * like latency in milliseconds, compared to the number of input rows.
+ */
+static Node *
+make_percentile_aggref(Aggref *aggref,
+					   gpupreagg_build_path_target_context *con)
+{
+	PathTarget	   *target_device = con->target_device;
+	TargetEntry	   *tle;
+	SortGroupClause *sgc;
+	Expr		   *fraction;
+	Expr		   *expr;
+	FuncExpr	   *pfunc;
+	Node		   *temp;
+	char		   *func_name;
+	Oid				func_argtypes[3];
+	Oid				func_oid;
+	Aggref		   *aggref_new;
+
+	if (aggref->aggkind != AGGKIND_ORDERED_SET ||
+		aggref->aggdistinct ||
+		aggref->aggvariadic ||
+		aggref->aggtype != FLOAT8OID ||
+		get_func_namespace(aggref->aggfnoid) != PG_CATALOG_NAMESPACE ||
+		list_length(aggref->aggdirectargs) != 1 ||
+		list_length(aggref->args) != 1 ||
+		list_length(aggref->aggorder) != 1)
+		goto not_supported;
+
+	func_name = get_func_name(aggref->aggfnoid);
+	if (strcmp(func_name, "percentile_cont") != 0 &&
+		strcmp(func_name, "percentile_disc") != 0)
+		goto not_supported;
+
+	/* fraction must be constant within the group */
+	fraction = linitial(aggref->aggdirectargs);
+	if (exprType((Node *) fraction) != FLOAT8OID ||
+		contain_var_clause((Node *) fraction) ||
+		contain_volatile_functions((Node *) fraction))
+		goto not_supported;
+
+	/* only ascending order by float8 */
+	tle = linitial(aggref->args);
+	expr = tle->expr;
+	sgc = linitial(aggref->aggorder);
+	if (exprType((Node *) expr) != FLOAT8OID ||
+		sgc->sortop != lookup_type_cache(FLOAT8OID,
+										 TYPECACHE_LT_OPR)->lt_opr)
+		goto not_supported;
+
+	/* NROWS(X IS NOT NULL [AND FILTER]) for each distinct X */
+	pfunc = make_altfunc_nrows_expr(aggref);
+	temp = replace_expression_by_outerref((Node *)pfunc->args,
+										  con->target_input);
+	if (!pgstrom_device_expression((Expr *) temp))
+		goto not_supported;
+
+	if (!add_extra_grouping_key(expr, con))
+		return NULL;
+
+	if (!list_member(target_device->exprs, pfunc))
+	{
+		add_column_to_pathtarget(target_device, (Expr *)pfunc, 0);
+		con->pfunc_bitmap = bms_add_member(con->pfunc_bitmap,
+									list_length(target_device->exprs) - 1);
+	}
+	add_new_column_to_pathtarget(con->target_partial, (Expr *)pfunc);
+
+	/* construction of the final Aggref */
+	func_argtypes[0] = FLOAT8OID;
+	func_argtypes[1] = FLOAT8OID;
+	func_argtypes[2] = INT8OID;
+	func_oid = GetSysCacheOid3(PROCNAMEARGSNSP,
+							   PointerGetDatum(func_name),
+							   PointerGetDatum(buildoidvector(func_argtypes, 3)),
+							   ObjectIdGetDatum(get_namespace_oid("pgstrom",
+																  false)));
+	if (!OidIsValid(func_oid))
+		elog(ERROR, "cache lookup failed for function %s",
+			 funcname_signature_string(func_name, 3, NIL, func_argtypes));
+
+	aggref_new = makeNode(Aggref);
+	aggref_new->aggfnoid		= func_oid;
+	aggref_new->aggtype			= FLOAT8OID;
+	aggref_new->aggcollid		= InvalidOid;
+	aggref_new->inputcollid		= InvalidOid;
+	aggref_new->aggtranstype	= INTERNALOID;
+	aggref_new->aggargtypes		= list_make3_oid(FLOAT8OID,
+												 FLOAT8OID,
+												 INT8OID);
+	aggref_new->aggdirectargs	= NIL;
+	aggref_new->args			= list_make3(makeTargetEntry(copyObject(fraction),
+															 1, NULL, false),
+											 makeTargetEntry(copyObject(expr),
+															 2, NULL, false),
+											 makeTargetEntry((Expr *)pfunc,
+															 3, NULL, false));
+	aggref_new->aggorder		= NIL;
+	aggref_new->aggdistinct		= NIL;
+	aggref_new->aggfilter		= NULL;	/* moved to GpuPreAgg */
+	aggref_new->aggstar			= false;
+	aggref_new->aggvariadic		= false;
+	aggref_new->aggkind			= AGGKIND_NORMAL;
+	aggref_new->agglevelsup		= 0;
+	aggref_new->aggsplit		= AGGSPLIT_SIMPLE;
+	aggref_new->location		= aggref->location;
+
+	return (Node *)aggref_new;
+
+not_supported:
+	elog(DEBUG2, "ORDERED SET Aggregation is not supported: %s",
+		 nodeToString(aggref));
+	return NULL;
+}
+
+/*
+ * make_numeric_fixed_final_aggref - constructor of the final Aggref of
+ * the fixed-point numeric aggregation; it takes the partial result (int8)
+ * as an argument.
+ */
+static Aggref *
+make_numeric_fixed_final_aggref(Aggref *aggref, const char *func_name,
+								Oid namespace_oid, Expr *pfunc)
+{
+	Oid			func_argtype = INT8OID;
+	Oid			func_oid;
+	HeapTuple	tuple;
+	Form_pg_aggregate agg_form;
+	Aggref	   *aggref_new;
+
+	func_oid = GetSysCacheOid3(PROCNAMEARGSNSP,
+							   PointerGetDatum(func_name),
+							   PointerGetDatum(buildoidvector(&func_argtype, 1)),
+							   ObjectIdGetDatum(namespace_oid));
+	if (!OidIsValid(func_oid))
+		elog(ERROR, "cache lookup failed for function %s",
+			 funcname_signature_string(func_name, 1, NIL, &func_argtype));
+	tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(func_oid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for pg_aggregate %u", func_oid);
+	agg_form = (Form_pg_aggregate) GETSTRUCT(tuple);
+
+	aggref_new = makeNode(Aggref);
+	aggref_new->aggfnoid		= func_oid;
+	aggref_new->aggtype			= get_func_rettype(func_oid);
+	aggref_new->aggcollid		= InvalidOid;
+	aggref_new->inputcollid		= InvalidOid;
+	aggref_new->aggtranstype	= agg_form->aggtranstype;
+	aggref_new->aggargtypes		= list_make1_oid(INT8OID);
+	aggref_new->aggdirectargs	= NIL;
+	aggref_new->args			= list_make1(makeTargetEntry(pfunc,
+															 1,
+															 NULL,
+															 false));
+	aggref_new->aggorder		= NIL;
+	aggref_new->aggdistinct		= NIL;
+	aggref_new->aggfilter		= NULL;	/* moved to GpuPreAgg */
+	aggref_new->aggstar			= false;
+	aggref_new->aggvariadic		= false;
+	aggref_new->aggkind			= AGGKIND_NORMAL;
+	aggref_new->agglevelsup		= 0;
+	aggref_new->aggsplit		= AGGSPLIT_SIMPLE;
+	aggref_new->location		= aggref->location;
+
+	ReleaseSysCache(tuple);
+
+	return aggref_new;
+}
+
+/*
+ * make_numeric_fixed_aggref
+ *
+ * SUM/AVG of numeric(p,s) is processed in the fixed-point representation,
+ * if precision is small enough. Device code decodes the numeric once into
+ * X * 10^s as int8, then accumulates it in the integer domain. The final
+ * Agg node sums up the partial results in numeric, and scales back them
+ * by pgstrom.numeric_fixed_sum/avg.
+ *
+ * NOTE: int128 is not a candidate of the partial state, because we have
+ * no atomic operation for 128bit integer on the device side.
+ *
+ * The partial sum has to keep the headroom for the rows to be accumulated
+ * on a group. numeric(12,s) leaves INT64_MAX / 10^12 (about 9.2M) rows per
+ * final buffer; GpuPreAgg switches the final buffer, or processes the
+ * chunk by CPU, prior to the overflow. See gpupreagg_reserve_final_buffer.
+ *
+ * It returns NULL if aggref is not a candidate of the fixed-point version,
+ * then caller falls back to the float8 based alternative aggregation.
+ */
+#define NUMERIC_FIXED_MAX_PRECISION		12
+
+static Node *
+make_numeric_fixed_aggref(Aggref *aggref,
+						  gpupreagg_build_path_target_context *con)
+{
+	PathTarget	   *target_device = con->target_device;
+	Oid				namespace_oid = get_namespace_oid("pgstrom", false);
+	TargetEntry	   *tle;
+	const char	   *func_name;
+	bool			is_avg;
+	int32			typmod;
+	int32			precision;
+	int32			scale;
+	Oid				func_argtypes[3];
+	Oid				func_oid;
+	Expr		   *expr;
+	FuncExpr	   *pfunc_sum;
+	FuncExpr	   *pfunc_nrows = NULL;
+	Node		   *temp;
+	List		   *final_args;
+
+	if (!pgstrom_enable_numeric_type ||
+		aggref->aggorder ||
+		aggref->aggdistinct ||
+		aggref->aggkind != AGGKIND_NORMAL ||
+		aggref->aggtype != NUMERICOID ||
+		list_length(aggref->args) != 1 ||
+		get_func_namespace(aggref->aggfnoid) != PG_CATALOG_NAMESPACE)
+		return NULL;
+
+	func_name = get_func_name(aggref->aggfnoid);
+	if (strcmp(func_name, "sum") == 0)
+		is_avg = false;
+	else if (strcmp(func_name, "avg") == 0)
+		is_avg = true;
+	else
+		return NULL;
+
+	/* only numeric with declared precision/scale */
+	tle = linitial(aggref->args);
+	if (exprType((Node *) tle->expr) != NUMERICOID)
+		return NULL;
+	typmod = exprTypmod((Node *) tle->expr);
+	if (typmod < (int32) VARHDRSZ)
+		return NULL;
+	precision = ((typmod - VARHDRSZ) >> 16) & 0xffff;
+	scale = (typmod - VARHDRSZ) & 0xffff;
+	if (precision > NUMERIC_FIXED_MAX_PRECISION)
+		return NULL;
+	con->numeric_fixed_prec = Max(con->numeric_fixed_prec, precision);
+
+	/* PSUM(numeric_fixed_int8(X, s)) */
+	func_argtypes[0] = NUMERICOID;
+	func_argtypes[1] = INT4OID;
+	func_oid = GetSysCacheOid3(PROCNAMEARGSNSP,
+							   PointerGetDatum("numeric_fixed_int8"),
+							   PointerGetDatum(buildoidvector(func_argtypes, 2)),
+							   ObjectIdGetDatum(namespace_oid));
+	if (!OidIsValid(func_oid))
+		elog(ERROR, "alternative function not found: %s",
+			 funcname_signature_string("numeric_fixed_int8", 2,
+									   NIL, func_argtypes));
+	expr = (Expr *) makeFuncExpr(func_oid,
+								 INT8OID,
+								 list_make2(copyObject(tle->expr),
+											makeConst(INT4OID,
+													  -1,
+													  InvalidOid,
+													  sizeof(int32),
+													  Int32GetDatum(scale),
+													  false,
+													  true)),
+								 InvalidOid,
+								 InvalidOid,
+								 COERCE_EXPLICIT_CALL);
+	expr = make_expr_conditional(expr, aggref->aggfilter, true);
+	pfunc_sum = make_altfunc_simple_expr("psum", expr);
+	temp = replace_expression_by_outerref((Node *)pfunc_sum->args,
+										  con->target_input);
+	if (!pgstrom_device_expression((Expr *) temp))
+		return NULL;
+
+	/* NROWS(X IS NOT NULL [AND FILTER]) for AVG */
+	if (is_avg)
+	{
+		pfunc_nrows = make_altfunc_nrows_expr(aggref);
+		temp = replace_expression_by_outerref((Node *)pfunc_nrows->args,
+											  con->target_input);
+		if (!pgstrom_device_expression((Expr *) temp))
+			return NULL;
+	}
+
+	if (!list_member(target_device->exprs, pfunc_sum))
+	{
+		add_column_to_pathtarget(target_device, (Expr *)pfunc_sum, 0);
+		con->pfunc_bitmap = bms_add_member(con->pfunc_bitmap,
+									list_length(target_device->exprs) - 1);
+	}
+	add_new_column_to_pathtarget(con->target_partial, (Expr *)pfunc_sum);
+	final_args = list_make1(make_numeric_fixed_final_aggref(aggref, "sum",
+												PG_CATALOG_NAMESPACE,
+												(Expr *)pfunc_sum));
+	if (pfunc_nrows)
+	{
+		if (!list_member(target_device->exprs, pfunc_nrows))
+		{
+			add_column_to_pathtarget(target_device, (Expr *)pfunc_nrows, 0);
+			con->pfunc_bitmap = bms_add_member(con->pfunc_bitmap,
+									list_length(target_device->exprs) - 1);
+		}
+		add_new_column_to_pathtarget(con->target_partial,
+									 (Expr *)pfunc_nrows);
+		final_args = lappend(final_args,
+							 make_numeric_fixed_final_aggref(aggref, "sum",
+												namespace_oid,
+												(Expr *)pfunc_nrows));
+	}
+	final_args = lappend(final_args, makeConst(INT4OID,
+											   -1,
+											   InvalidOid,
+											   sizeof(int32),
+											   Int32GetDatum(scale),
+											   false,
+											   true));
+
+	/* pgstrom.numeric_fixed_sum/avg to scale back the sum */
+	func_name = (is_avg ? "numeric_fixed_avg" : "numeric_fixed_sum");
+	func_argtypes[0] = NUMERICOID;
+	if (is_avg)
+	{
+		func_argtypes[1] = INT8OID;
+		func_argtypes[2] = INT4OID;
+	}
+	else
+		func_argtypes[1] = INT4OID;
+	func_oid = GetSysCacheOid3(PROCNAMEARGSNSP,
+							   PointerGetDatum(func_name),
+							   PointerGetDatum(buildoidvector(func_argtypes,
+												list_length(final_args))),
+							   ObjectIdGetDatum(namespace_oid));
+	if (!OidIsValid(func_oid))
+		elog(ERROR, "cache lookup failed for function %s",
+			 funcname_signature_string(func_name, list_length(final_args),
+									   NIL, func_argtypes));
+	return (Node *) makeFuncExpr(func_oid,
+								 NUMERICOID,
+								 final_args,
+								 InvalidOid,
+								 InvalidOid,
+								 COERCE_EXPLICIT_CALL);
+}
+
+static Node *
+replace_expression_by_altfunc(Node *node,
+							  gpupreagg_build_path_target_context *con)
+{
+	PathTarget *target_input = con->target_input;
+	ListCell   *lc;
+
+	if (!node)
+		return NULL;
+	if (IsA(node, Aggref))
+	{
+		Node   *aggfn;
+
+		if (((Aggref *) node)->aggdistinct)
+			aggfn = make_distinct_aggref((Aggref *)node, con);
+		else if (AGGKIND_IS_ORDERED_SET(((Aggref *) node)->aggkind))
+			aggfn = make_percentile_aggref((Aggref *)node, con);
+		else
+		{
+			aggfn = make_numeric_fixed_aggref((Aggref *)node, con);
+			if (!aggfn)
+				aggfn = make_alternative_aggref((Aggref *)node,
+												con->target_partial,
+												con->target_device,
+												con->target_input,
+												&con->pfunc_bitmap);
+		}
+		if (!aggfn)
+			con->device_executable = false;
+		return aggfn;
+	}
+
+	foreach (lc, target_input->exprs)
+	{
+		Expr   *expr_in = lfirst(lc);
+
+		if (equal(node, expr_in))
+		{
+			add_new_column_to_pathtarget(con->target_partial,
+										 copyObject(expr_in));
+			add_new_column_to_pathtarget(con->target_device,
+										 copyObject(expr_in));
+			return copyObject(node);
+		}
+	}
+	if (IsA(node, Var) || IsA(node, PlaceHolderVar))
+		elog(ERROR, "Bug? referenced variable is neither grouping-key nor its dependent key: %s",
+			 nodeToString(node));
+	return expression_tree_mutator(node, replace_expression_by_altfunc, con);
+}
+
+/*
+ * gpupreagg_build_path_target
+ *
+ *
+ *
+ */
+static bool
+gpupreagg_build_path_target(PlannerInfo *root,			/* in */
+							PathTarget *target_upper,	/* in */
+							PathTarget *target_final,	/* out */
+							PathTarget *target_partial,	/* out */
+							PathTarget *target_device,	/* out */
+							PathTarget *target_input,	/* in */
+							Bitmapset **p_pfunc_bitmap,	/* out */
+							int *p_numeric_fixed_prec,	/* out */
+							Node **p_havingQual,		/* out */
+							bool *p_can_pullup_outerscan) /* out */
 {
 	gpupreagg_build_path_target_context con;
 	Query	   *parse = root->parse;
@@ -2146,12 +3036,20 @@ gpupreagg_build_path_target(PlannerInfo *root,			/* in */
 
 	memset(&con, 0, sizeof(con));
 	con.device_executable = true;
+	con.can_pullup_outerscan = true;
 	con.parse			= parse;
 	con.target_upper	= target_upper;
 	con.target_partial	= target_partial;
 	con.target_device	= target_device;
 	con.target_input	= target_input;
 	con.pfunc_bitmap    = NULL;
+	foreach (lc, parse->targetList)
+	{
+		TargetEntry *tle = lfirst(lc);
+
+		con.max_sortgroupref = Max(con.max_sortgroupref,
+								   tle->ressortgroupref);
+	}
 
 	/*
 	 * NOTE: Not to inject unnecessary projection on the sub-path node,
@@ -2260,11 +3158,14 @@ gpupreagg_build_path_target(PlannerInfo *root,			/* in */
 			return false;
 	}
 	*p_havingQual = havingQual;
+	if (!con.can_pullup_outerscan)
+		*p_can_pullup_outerscan = false;
 
 	set_pathtarget_cost_width(root, target_final);
 	set_pathtarget_cost_width(root, target_partial);
 	set_pathtarget_cost_width(root, target_device);
 	*p_pfunc_bitmap = con.pfunc_bitmap;
+	*p_numeric_fixed_prec = con.numeric_fixed_prec;
 
 	return true;
 }
@@ -2380,7 +3281,7 @@ PlanGpuPreAggPath(PlannerInfo *root,
 
 	/* setup CustomScan node */
 	cscan->scan.plan.targetlist = tlist;
-	cscan->scan.plan.qual = NIL;
+	cscan->scan.plan.qual = gpa_info->having_quals;
 	outerPlan(cscan) = outer_plan;
 	cscan->scan.scanrelid = gpa_info->outer_scanrelid;
 	cscan->flags = best_path->flags;
@@ -2404,6 +3305,7 @@ PlanGpuPreAggPath(PlannerInfo *root,
 	gpa_info->extra_flags = context.extra_flags;
 	gpa_info->ccache_refs = ccache_refs;
 	gpa_info->used_params = context.used_params;
+	gpa_info->varlena_bufsz = context.varlena_bufsz;
 
 	form_gpupreagg_info(cscan, gpa_info);
 
@@ -2664,6 +3566,18 @@ codegen_projection_partial_funcion(FuncExpr *f,
 		}
 		*p_null_const_value = dtype->zero_const;		
 	}
+	else if (strcmp(proc_name, "pcomp") == 0)
+	{
+		/* rounding error is zero on the initial projection */
+		expr = (Expr *)makeConst(FLOAT8OID,
+								 -1,
+								 InvalidOid,
+								 sizeof(float8),
+								 Float8GetDatum(0.0),
+								 false,
+								 FLOAT8PASSBYVAL);
+		*p_null_const_value = "0.0";
+	}
 	else if (strcmp(proc_name, "pcov_x")  == 0 ||
 			 strcmp(proc_name, "pcov_y")  == 0 ||
 			 strcmp(proc_name, "pcov_x2") == 0 ||
@@ -3279,6 +4193,40 @@ gpupreagg_codegen_keymatch(StringInfo kern,
 		"}\n\n");
 }
 
+/*
+ * gpupreagg_lookup_pcomp_column
+ *
+ * It returns attribute number of the PCOMP() column paired with the
+ * supplied partial function, or 0 if not compensated summation.
+ */
+static AttrNumber
+gpupreagg_lookup_pcomp_column(TargetEntry *tle, List *tlist_dev)
+{
+	ListCell   *lc;
+
+	foreach (lc, tlist_dev)
+	{
+		TargetEntry *temp = lfirst(lc);
+		FuncExpr   *f = (FuncExpr *) temp->expr;
+		char	   *func_name;
+		bool		is_pcomp;
+
+		if (temp->resjunk || !IsA(f, FuncExpr) ||
+			list_length(f->args) != 1 ||
+			!equal(linitial(f->args), tle->expr))
+			continue;
+		func_name = get_func_name(f->funcid);
+		is_pcomp = (strcmp(func_name, "pcomp") == 0);
+		pfree(func_name);
+		if (is_pcomp)
+		{
+			Assert(temp->resno > tle->resno);
+			return temp->resno;
+		}
+	}
+	return 0;
+}
+
 /*
  * gpupreagg_codegen_common_calc
  *
@@ -3287,7 +4235,8 @@ gpupreagg_codegen_keymatch(StringInfo kern,
 static const char *
 gpupreagg_codegen_common_calc(TargetEntry *tle,
 							  codegen_context *context,
-							  bool is_atomic_ops)
+							  bool is_atomic_ops,
+							  AttrNumber pcomp_resno)
 {
 	FuncExpr	   *f = (FuncExpr *)tle->expr;
 	char		   *func_name;
@@ -3312,7 +4261,8 @@ gpupreagg_codegen_common_calc(TargetEntry *tle,
 			 strcmp(func_name, "pcov_y") == 0 ||
 			 strcmp(func_name, "pcov_x2") == 0 ||
 			 strcmp(func_name, "pcov_y2") == 0 ||
-			 strcmp(func_name, "pcov_xy") == 0)
+			 strcmp(func_name, "pcov_xy") == 0 ||
+			 strcmp(func_name, "pcomp") == 0)
 		aggcalc_ops = "add";
 	else
 		elog(ERROR, "Bug? unexpected partial function expression: %s",
@@ -3350,11 +4300,13 @@ gpupreagg_codegen_common_calc(TargetEntry *tle,
 			elog(ERROR, "Bug? %s is not expected to use for GpuPreAgg",
 				 format_type_be(dtype->type_oid));
 	}
+	Assert(pcomp_resno == 0 || dtype->type_oid == FLOAT8OID);
 	snprintf(sbuffer, sizeof(sbuffer),
-			 "aggcalc_%s_%s_%s",
+			 "aggcalc_%s_%s_%s%s",
 			 is_atomic_ops ? "atomic" : "normal",
 			 aggcalc_ops,
-			 aggcalc_type);
+			 aggcalc_type,
+			 pcomp_resno > 0 ? "_comp" : "");
 	return sbuffer;
 }
 
@@ -3375,7 +4327,8 @@ gpupreagg_codegen_local_calc(StringInfo kern,
 		"                     cl_bool *p_acm_isnull,\n"
 		"                     Datum   *p_acm_datum,\n"
 		"                     cl_bool  new_isnull,\n"
-		"                     Datum    new_datum)\n"
+		"                     Datum    new_datum,\n"
+		"                     Datum   *comp_values)\n"
 		"{\n"
 		"  switch (attnum)\n"
 		"  {\n");
@@ -3383,19 +4336,33 @@ gpupreagg_codegen_local_calc(StringInfo kern,
 	{
 		TargetEntry	   *tle = lfirst(lc);
 		const char	   *label;
+		AttrNumber		pcomp_resno;
 
 		/* only partial aggregate function's arguments */
 		if (tle->resjunk || !is_altfunc_expression((Node *)tle->expr))
 			continue;
 
-		label = gpupreagg_codegen_common_calc(tle, context, true);
-		appendStringInfo(
-			kern,
-			"  case %d:\n"
-			"    %s(p_acm_isnull,p_acm_datum,new_isnull,new_datum);\n"
-			"    break;\n",
-			tle->resno - 1,
-			label);
+		pcomp_resno = gpupreagg_lookup_pcomp_column(tle, tlist_dev);
+		label = gpupreagg_codegen_common_calc(tle, context, true,
+											  pcomp_resno);
+		if (pcomp_resno > 0)
+			appendStringInfo(
+				kern,
+				"  case %d:\n"
+				"    %s(p_acm_isnull,p_acm_datum,new_isnull,new_datum,\n"
+				"       comp_values+%d);\n"
+				"    break;\n",
+				tle->resno - 1,
+				label,
+				pcomp_resno - 1);
+		else
+			appendStringInfo(
+				kern,
+				"  case %d:\n"
+				"    %s(p_acm_isnull,p_acm_datum,new_isnull,new_datum);\n"
+				"    break;\n",
+				tle->resno - 1,
+				label);
 	}
 	appendStringInfoString(
 		kern,
@@ -3427,20 +4394,35 @@ gpupreagg_codegen_global_calc(StringInfo kern,
 	{
 		TargetEntry	   *tle = lfirst(lc);
 		const char	   *label;
+		AttrNumber		pcomp_resno;
 
 		/* only partial aggregate function's arguments */
 		if (tle->resjunk || !is_altfunc_expression((Node *)tle->expr))
 			continue;
 
-		label = gpupreagg_codegen_common_calc(tle, context, true);
-		appendStringInfo(
-			kern,
-			"  %s(dst_isnull+%d, dst_values+%d, src_isnull[%d], src_values[%d]);\n",
-			label,
-			tle->resno - 1,
-			tle->resno - 1,
-			tle->resno - 1,
-			tle->resno - 1);
+		pcomp_resno = gpupreagg_lookup_pcomp_column(tle, tlist_dev);
+		label = gpupreagg_codegen_common_calc(tle, context, true,
+											  pcomp_resno);
+		if (pcomp_resno > 0)
+			appendStringInfo(
+				kern,
+				"  %s(dst_isnull+%d, dst_values+%d, src_isnull[%d], src_values[%d],\n"
+				"     dst_values+%d);\n",
+				label,
+				tle->resno - 1,
+				tle->resno - 1,
+				tle->resno - 1,
+				tle->resno - 1,
+				pcomp_resno - 1);
+		else
+			appendStringInfo(
+				kern,
+				"  %s(dst_isnull+%d, dst_values+%d, src_isnull[%d], src_values[%d]);\n",
+				label,
+				tle->resno - 1,
+				tle->resno - 1,
+				tle->resno - 1,
+				tle->resno - 1);
 	}
 	appendStringInfoString(
 		kern,
@@ -3464,7 +4446,8 @@ gpupreagg_codegen_nogroup_calc(StringInfo kern,
 		"                       cl_bool *p_acm_isnull,"
 		"                       Datum   *p_acm_datum,"
 		"                       cl_bool  new_isnull,"
-		"                       Datum    new_datum)"
+		"                       Datum    new_datum,"
+		"                       Datum   *comp_values)"
 		"{\n"
 		"  switch (attnum)\n"
 		"  {\n");
@@ -3472,18 +4455,32 @@ gpupreagg_codegen_nogroup_calc(StringInfo kern,
 	{
 		TargetEntry	   *tle = lfirst(lc);
 		const char	   *label;
+		AttrNumber		pcomp_resno;
 
 		/* only partial aggregate function's arguments */
 		if (tle->resjunk || !is_altfunc_expression((Node *)tle->expr))
 			continue;
-		label = gpupreagg_codegen_common_calc(tle, context, false);
-		appendStringInfo(
-			kern,
-			"  case %d:\n"
-			"    %s(p_acm_isnull, p_acm_datum, new_isnull, new_datum);\n"
-			"    break;\n",
-			tle->resno - 1,
-			label);
+		pcomp_resno = gpupreagg_lookup_pcomp_column(tle, tlist_dev);
+		label = gpupreagg_codegen_common_calc(tle, context, false,
+											  pcomp_resno);
+		if (pcomp_resno > 0)
+			appendStringInfo(
+				kern,
+				"  case %d:\n"
+				"    %s(p_acm_isnull, p_acm_datum, new_isnull, new_datum,\n"
+				"       comp_values+%d);\n"
+				"    break;\n",
+				tle->resno - 1,
+				label,
+				pcomp_resno - 1);
+		else
+			appendStringInfo(
+				kern,
+				"  case %d:\n"
+				"    %s(p_acm_isnull, p_acm_datum, new_isnull, new_datum);\n"
+				"    break;\n",
+				tle->resno - 1,
+				label);
 	}
 	appendStringInfoString(
 		kern,
@@ -3546,6 +4543,8 @@ gpupreagg_codegen(codegen_context *context,
 	{
 		codegen_gpuscan_quals(&body, context,
 							  cscan->scan.scanrelid,
+							  planner_rt_fetch(cscan->scan.scanrelid,
+											   root)->relid,
 							  gpa_info->outer_quals);
 		context->extra_flags |= DEVKERNEL_NEEDS_GPUSCAN;
 	}
@@ -3580,6 +4579,15 @@ gpupreagg_codegen(codegen_context *context,
 	gpupreagg_codegen_global_calc(&body, context, tlist_dev);
 	/* gpupreagg_nogroup_calc */
 	gpupreagg_codegen_nogroup_calc(&body, context, tlist_dev);
+	/*
+	 * Only a few groups are expected, atomic operations on the same local
+	 * buffer from the threads in a warp are heavily contended. So, reduction
+	 * kernel merges the values in a warp first, using gpupreagg_nogroup_calc
+	 * above. See GPUPREAGG_SMALL_GROUPBY at gpupreagg_groupby_reduction.
+	 */
+	gpa_info->small_groupby = (gpa_info->num_group_keys > 0 &&
+							   gpa_info->plan_ngroups <=
+							   (double)GPUPREAGG_SMALL_GROUPBY_NGROUPS);
 	/* merge above kernel functions */
 	appendStringInfoString(&kern, body.data);
 	pfree(body.data);
@@ -3659,6 +4667,13 @@ assign_gpupreagg_session_info(StringInfo buf, GpuTaskState *gts)
 		appendStringInfo(buf, "#define GPUPREAGG_HAS_OUTER_QUALS 1\n");
 	if (gpas->combined_gpujoin)
 		appendStringInfo(buf, "#define GPUPREAGG_COMBINED_JOIN 1\n");
+	if (gpas->fused_gpujoin)
+		appendStringInfo(buf,
+						 "#define GPUPREAGG_FUSED_NOGROUP 1\n"
+						 "#define GPUPREAGG_NUM_SLOT_COLUMNS %d\n",
+						 gpas->kds_slot_head->ncols);
+	if (gpas->small_groupby)
+		appendStringInfo(buf, "#define GPUPREAGG_SMALL_GROUPBY 1\n");
 }
 
 /*
@@ -3708,7 +4723,9 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
 
 	Assert(scan_rel ? outerPlan(node) == NULL : outerPlan(cscan) != NULL);
 	/* activate a GpuContext for CUDA kernel execution */
-	gpas->gts.gcontext = AllocGpuContext(-1, false);
+	gpas->gts.gcontext = AllocGpuContext(scan_rel
+										 ? RelationGetOptimalGpuDevice(scan_rel)
+										 : -1, false);
 	if (!explain_only)
 		ActivateGpuContext(gpas->gts.gcontext);
 
@@ -3723,10 +4740,22 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
 	gpas->gts.cb_terminator_task = gpupreagg_terminator_task;
 	gpas->gts.cb_next_tuple      = gpupreagg_next_tuple;
 	gpas->gts.cb_process_task    = gpupreagg_process_task;
+	gpas->gts.kern_names         = gpupreagg_kernel_names;
 	gpas->gts.cb_release_task    = gpupreagg_release_task;
 	gpas->gts.outer_nrows_per_block = gpa_info->outer_nrows_per_block;
 
 	gpas->num_group_keys     = gpa_info->num_group_keys;
+	gpas->full_aggregation   = gpa_info->full_aggregation;
+	gpas->small_groupby      = gpa_info->small_groupby;
+	if (gpa_info->numeric_fixed_prec > 0)
+	{
+		int64		unit = 1;
+		int			k;
+
+		for (k=0; k < gpa_info->numeric_fixed_prec; k++)
+			unit *= 10;
+		gpas->fixed_nrows_limit = PG_INT64_MAX / unit;
+	}
 
 	/* initialization of the outer relation */
 	if (outerPlan(cscan))
@@ -3736,11 +4765,34 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
 		Assert(!scan_rel);
 		Assert(!gpa_info->outer_quals );
 		outer_ps = ExecInitNode(outerPlan(cscan), estate, eflags);
+		/*
+		 * Combined GpuJoin+GpuPreAgg detaches the per-thread varlena buffer
+		 * on the projection, so expressions that construct varlena datum
+		 * always fall back to CPU. Run them individually in this case.
+		 * Also, fixed-point partial sum needs the number of rows per task
+		 * to be bounded prior to the kernel, but GpuJoin may generate any
+		 * number of rows from a chunk.
+		 */
 		if (enable_pullup_outer_join &&
 			pgstrom_planstate_is_gpujoin(outer_ps) &&
-			!outer_ps->ps_ProjInfo)
+			!gpujoinHasInnerPartitions(outer_ps) &&
+			!outer_ps->ps_ProjInfo &&
+			gpa_info->numeric_fixed_prec == 0 &&
+			gpa_info->varlena_bufsz == 0 &&
+			((GpuTaskState *) outer_ps)->varlena_bufsz == 0)
 		{
 			gpas->combined_gpujoin = true;
+			/*
+			 * No-group aggregation can be fused to the GpuJoin kernel; it
+			 * accumulates the joined rows onto the final buffer directly,
+			 * without intermediation of kds_slot. Because the final buffer
+			 * is already updated on the kernel error, it is not available
+			 * if CPU fallback is enabled.
+			 */
+			if (enable_fused_outer_join &&
+				gpas->num_group_keys == 0 &&
+				!pgstrom_cpu_fallback_enabled)
+				gpas->fused_gpujoin = true;
 		}
 		outerPlanState(gpas) = outer_ps;
 		/* GpuPreAgg don't need re-initialization of projection info */
@@ -3806,6 +4858,7 @@ ExecInitGpuPreAgg(CustomScanState *node, EState *estate, int eflags)
     gpas->plan_nrows_in		= gpa_info->outer_nrows;
 	gpas->plan_ngroups		= gpa_info->plan_ngroups;
 	gpas->plan_extra_sz		= gpa_info->plan_extra_sz;
+	gpas->gts.varlena_bufsz	= gpa_info->varlena_bufsz;
 
 	/* Get CUDA program and async build if any */
 	if (gpas->combined_gpujoin)
@@ -3858,6 +4911,7 @@ ExecGpuPreAgg(CustomScanState *node)
 	{
 		gpas->gpa_sstate = createGpuPreAggSharedState(gpas, NULL, NULL);
 		gpas->gpa_rtstat = &gpas->gpa_sstate->gpa_rtstat;
+		gpas->gts.gt_rtstat = &gpas->gpa_rtstat->c;
 	}
 	return ExecScan(&node->ss,
 					(ExecScanAccessMtd) pgstromExecGpuTaskState,
@@ -3872,12 +4926,14 @@ ExecEndGpuPreAgg(CustomScanState *node)
 {
 	GpuPreAggState *gpas = (GpuPreAggState *) node;
 	GpuContext	   *gcontext = gpas->gts.gcontext;
+	GpuPreAggFinalBuffer *fbuf = gpas->fbuf_curr;
+	ListCell	   *lc;
 	CUresult		rc;
 
 	/* wait for completion of any asynchronous GpuTask */
-	if (gpas->ev_init_fhash)
+	if (fbuf && fbuf->ev_init_fhash)
 	{
-		if ((rc = cuEventRecord(gpas->ev_init_fhash,
+		if ((rc = cuEventRecord(fbuf->ev_init_fhash,
 								CU_STREAM_PER_THREAD)) != CUDA_SUCCESS)
 			elog(WARNING, "failed on cuEventRecord: %s", errorText(rc));
 	}
@@ -3887,12 +4943,21 @@ ExecEndGpuPreAgg(CustomScanState *node)
 		ExecEndNode(outerPlanState(node));
 
 	/* release final buffer / hashslot */
-	if (gpas->pds_final)
-		PDS_release(gpas->pds_final);
-	if (gpas->m_fhash)
-		gpuMemFree(gcontext, gpas->m_fhash);
+	if (fbuf)
+		gpupreagg_release_final_buffer(gcontext, fbuf);
+	foreach (lc, gpas->fbuf_spilled)
+		gpupreagg_release_final_buffer(gcontext, lfirst(lc));
+	if (gpas->fbuf_shared && gpas->fbuf_shared != fbuf)
+		gpupreagg_release_final_buffer(gcontext, gpas->fbuf_shared);
+	if (gpas->m_fbuf_owned != 0UL)
+	{
+		rc = gpuMemFree(gcontext, gpas->m_fbuf_owned);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on gpuMemFree: %s", errorText(rc));
+	}
 
 	/* release any other resources */
+	PDS_restore_slot_reference(&gpas->gts);
 	if (gpas->gpreagg_slot)
 		ExecDropSingleTupleTableSlot(gpas->gpreagg_slot);
 	if (gpas->outer_slot)
@@ -3953,6 +5018,9 @@ ExecGpuPreAggInitDSM(CustomScanState *node,
 	/* allocation of shared state */
 	gpas->gpa_sstate = createGpuPreAggSharedState(gpas, pcxt, coordinate);
 	gpas->gpa_rtstat = &gpas->gpa_sstate->gpa_rtstat;
+	gpas->gts.gt_rtstat = &gpas->gpa_rtstat->c;
+	/* final buffer shared by the participants, if possible */
+	gpupreagg_setup_shared_final_buffer(gpas);
 	ExecGpuScanInitDSM(node, pcxt, ((char *)coordinate +
 									gpas->gpa_sstate->ss_length));
 }
@@ -3970,6 +5038,7 @@ ExecGpuPreAggInitWorker(CustomScanState *node,
 
 	gpas->gpa_sstate = gpa_sstate;
 	gpas->gpa_rtstat = &gpas->gpa_sstate->gpa_rtstat;
+	gpas->gts.gt_rtstat = &gpas->gpa_rtstat->c;
 	pg_atomic_add_fetch_u32(&gpa_sstate->gpa_rtstat.pg_nworkers, 1);
 	on_dsm_detach(dsm_find_mapping(gpa_sstate->ss_handle),
 				  SynchronizeGpuContextOnDSMDetach,
@@ -4003,6 +5072,7 @@ ExecShutdownGpuPreAgg(CustomScanState *node)
 	memcpy(gpas->gpa_rtstat,
 		   gpa_rtstat_old,
 		   sizeof(GpuPreAggRuntimeStat));
+	gpas->gts.gt_rtstat = &gpas->gpa_rtstat->c;
 }
 #endif
 
@@ -4038,6 +5108,8 @@ ExplainGpuPreAgg(CustomScanState *node, List *ancestors, ExplainState *es)
 	/* shows reduction policy */
 	if (gpas->num_group_keys == 0)
 		policy = "NoGroup";
+	else if (gpas->small_groupby)
+		policy = "Local (Warp)";
 	else
 		policy = "Local";
 	ExplainPropertyText("Reduction", policy, es);
@@ -4062,10 +5134,17 @@ ExplainGpuPreAgg(CustomScanState *node, List *ancestors, ExplainState *es)
 							gpa_info->outer_nrows,
 							gpa_info->outer_width);
 	/* combined GpuJoin + GpuPreAgg? */
-	if (gpas->combined_gpujoin)
+	if (gpas->fused_gpujoin)
+		ExplainPropertyText("Combined GpuJoin", "fused", es);
+	else if (gpas->combined_gpujoin)
 		ExplainPropertyText("Combined GpuJoin", "enabled", es);
 	else if (es->format != EXPLAIN_FORMAT_TEXT)
 		ExplainPropertyText("Combined GpuJoin", "disabled", es);
+	/* GPU produces the final aggregation? */
+	if (gpas->full_aggregation)
+		ExplainPropertyText("Full Aggregation", "enabled", es);
+	else if (es->format != EXPLAIN_FORMAT_TEXT)
+		ExplainPropertyText("Full Aggregation", "disabled", es);
 	/* other common fields */
 	pgstromExplainGpuTaskState(&gpas->gts, es);
 	/* other run-time statistics, if any */
@@ -4074,9 +5153,15 @@ ExplainGpuPreAgg(CustomScanState *node, List *ancestors, ExplainState *es)
 		uint64		num_fallback_rows
 			= pg_atomic_read_u64(&gpa_rtstat->num_fallback_rows);
 
+		uint32		num_spilled_buffers
+			= pg_atomic_read_u32(&gpa_rtstat->num_spilled_buffers);
+
 		if (num_fallback_rows > 0)
 			ExplainPropertyLong("Num of CPU fallback rows",
 								num_fallback_rows, es);
+		if (num_spilled_buffers > 0)
+			ExplainPropertyLong("Num of spilled final buffers",
+								num_spilled_buffers, es);
 	}
 }
 
@@ -4100,6 +5185,12 @@ createGpuPreAggSharedState(GpuPreAggState *gpas,
 	gpa_sstate->ss_handle = (pcxt ? dsm_segment_handle(pcxt->seg) : UINT_MAX);
 	gpa_sstate->ss_length = ss_length;
 	pg_atomic_init_u32(&gpa_sstate->gpa_rtstat.pg_nworkers, 0);
+	pg_atomic_init_u32(&gpa_sstate->gpa_rtstat.num_spilled_buffers, 0);
+	SpinLockInit(&gpa_sstate->f_lock);
+	gpa_sstate->f_cuda_dindex = -1;
+	pg_atomic_init_u64(&gpa_sstate->f_ngroups, 0);
+	pg_atomic_init_u64(&gpa_sstate->f_reserved, 0);
+	pg_atomic_init_u64(&gpa_sstate->f_nrows_in, 0);
 
 	return gpa_sstate;
 }
@@ -4119,33 +5210,24 @@ releaseGpuPreAggSharedState(GpuPreAggState *gpas)
 static void
 resetGpuPreAggSharedState(GpuPreAggState *gpas)
 {
-	/* nothing to do */
+	GpuPreAggSharedState *gpa_sstate = gpas->gpa_sstate;
+
+	/*
+	 * The shared final buffer is already returned by the last participant,
+	 * so the next round uses private final buffers.
+	 */
+	if (gpa_sstate && !IsParallelWorker())
+		gpa_sstate->f_cuda_dindex = -1;
 }
 
 /*
- * gpupreagg_alloc_final_buffer
+ * gpupreagg_final_hashsize - initial size of the final hash-slot
  */
-static void
-gpupreagg_alloc_final_buffer(GpuPreAggState *gpas)
+static size_t
+gpupreagg_final_hashsize(GpuPreAggState *gpas)
 {
-	GpuContext	   *gcontext = gpas->gts.gcontext;
-	TupleTableSlot *gpa_slot = gpas->gpreagg_slot;
-	TupleDesc		gpa_tupdesc = gpa_slot->tts_tupleDescriptor;
-	pgstrom_data_store *pds_final;
-	size_t			f_hashsize;
-	size_t			f_hashlimit;
-	CUdeviceptr		m_fhash;
-	CUresult		rc;
-
-	if (gpas->pds_final)
-		return;
+	size_t		f_hashsize;
 
-	/* final buffer allocation */
-	pds_final = PDS_create_slot(gcontext,
-								gpa_tupdesc,
-								0xffff8000UL);	/* 4GB - 32KB */
-	/* final hash-slot allocation */
-	f_hashlimit = (size_t)((double)pds_final->kds.nrooms * 1.33);
 	if (gpas->plan_ngroups < 400000)
 		f_hashsize = 4 * gpas->plan_ngroups;
 	else if (gpas->plan_ngroups < 1200000)
@@ -4165,6 +5247,32 @@ gpupreagg_alloc_final_buffer(GpuPreAggState *gpas)
 											 hash_slot[0]))
 			/ sizeof(pagg_hashslot);
 	}
+	return f_hashsize;
+}
+
+/*
+ * gpupreagg_alloc_final_buffer
+ */
+static GpuPreAggFinalBuffer *
+gpupreagg_alloc_final_buffer(GpuPreAggState *gpas)
+{
+	GpuContext	   *gcontext = gpas->gts.gcontext;
+	TupleTableSlot *gpa_slot = gpas->gpreagg_slot;
+	TupleDesc		gpa_tupdesc = gpa_slot->tts_tupleDescriptor;
+	GpuPreAggFinalBuffer *fbuf;
+	pgstrom_data_store *pds_final;
+	size_t			f_hashsize;
+	size_t			f_hashlimit;
+	CUdeviceptr		m_fhash;
+	CUresult		rc;
+
+	/* final buffer allocation */
+	pds_final = PDS_create_slot(gcontext,
+								gpa_tupdesc,
+								0xffff8000UL);	/* 4GB - 32KB */
+	/* final hash-slot allocation */
+	f_hashlimit = (size_t)((double)pds_final->kds.nrooms * 1.33);
+	f_hashsize = gpupreagg_final_hashsize(gpas);
 
 	/*
 	 * Hash table allocation up to @f_hashlimit items, however, it initially
@@ -4178,11 +5286,437 @@ gpupreagg_alloc_final_buffer(GpuPreAggState *gpas)
 							CU_MEM_ATTACH_GLOBAL);
 	if (rc != CUDA_SUCCESS)
 		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
-	gpas->pds_final		= pds_final;
-	gpas->m_fhash		= m_fhash;
-	gpas->ev_init_fhash	= NULL;
-	gpas->f_hashsize	= f_hashsize;
-	gpas->f_hashlimit	= f_hashlimit;
+	/*
+	 * The final buffer is updated by GPU kernel all through the scan, so
+	 * it should stay on the device even if other managed memory is
+	 * oversubscribed. Once spilled, it is advised to the host instead.
+	 */
+	gpuMemAdvisePreferDevice(gcontext,
+							 (CUdeviceptr)&pds_final->kds,
+							 pds_final->kds.length, 0);
+	gpuMemAdvisePreferDevice(gcontext, m_fhash,
+							 offsetof(kern_global_hashslot,
+									  hash_slot[f_hashlimit]), 0);
+	fbuf = palloc0(sizeof(GpuPreAggFinalBuffer));
+	fbuf->pds_final		= pds_final;
+	fbuf->m_kds_final	= (CUdeviceptr)&pds_final->kds;
+	fbuf->m_fhash		= m_fhash;
+	fbuf->ev_init_fhash	= NULL;
+	fbuf->f_hashsize	= f_hashsize;
+	fbuf->f_hashlimit	= f_hashlimit;
+	fbuf->f_nrooms_limit = Min(pds_final->kds.nrooms,
+							   GLOBAL_HASHSLOT_THRESHOLD(f_hashlimit));
+	return fbuf;
+}
+
+/*
+ * gpupreagg_release_final_buffer
+ */
+static void
+gpupreagg_release_final_buffer(GpuContext *gcontext,
+							   GpuPreAggFinalBuffer *fbuf)
+{
+	CUresult	rc;
+
+	/* shared final buffer is owned by the leader; just unmap */
+	if (fbuf->f_sstate)
+	{
+		if (fbuf->f_ipc_mapped)
+		{
+			rc = gpuIpcCloseMemHandle(gcontext, fbuf->m_kds_final);
+			if (rc != CUDA_SUCCESS)
+				elog(WARNING, "failed on gpuIpcCloseMemHandle: %s",
+					 errorText(rc));
+		}
+		fbuf->f_ipc_mapped = false;
+		fbuf->m_kds_final = 0UL;
+		fbuf->m_fhash = 0UL;
+		return;
+	}
+	if (fbuf->pds_final)
+		PDS_release(fbuf->pds_final);
+	fbuf->pds_final = NULL;
+	if (fbuf->m_fhash)
+		gpuMemFree(gcontext, fbuf->m_fhash);
+	fbuf->m_fhash = 0UL;
+}
+
+/*
+ * gpupreagg_setup_shared_final_buffer
+ *
+ * It allocates a final buffer and hash-slot on the device memory, to be
+ * shared by the leader and parallel workers on the same device, instead
+ * of the private final buffer for each. So, device memory consumption and
+ * the number of groups CPU has to merge are not multiplied by the number
+ * of workers. Only the leader calls this routine at ExecInitDSM, then it
+ * owns the device memory by the end of the query.
+ *
+ * Datum of the values by reference point the device memory mapped by each
+ * process; it is not portable across the processes. So, the final buffer
+ * is shared only when all the columns are by value.
+ * Also, the participant switches to the private final buffer once the
+ * shared one may overflow; thus, spill of the final buffer must be allowed.
+ */
+static void
+gpupreagg_setup_shared_final_buffer(GpuPreAggState *gpas)
+{
+	GpuPreAggSharedState *gpa_sstate = gpas->gpa_sstate;
+	GpuContext	   *gcontext = gpas->gts.gcontext;
+	TupleDesc		tupdesc = gpas->gpreagg_slot->tts_tupleDescriptor;
+	kern_data_store *kds_head;
+	kern_global_hashslot f_hash_head;
+	size_t			unitsz;
+	size_t			nrooms;
+	size_t			f_length;
+	size_t			f_hashsize;
+	size_t			f_hashlimit;
+	CUdeviceptr		m_deviceptr;
+	CUdeviceptr		m_fhash;
+	CUipcMemHandle	m_handle;
+	CUresult		rc;
+	int				j;
+
+	if (!enable_shared_final_buffer ||
+		!enable_spill_final_buffer ||
+		gpas->num_group_keys == 0 ||
+		gpas->full_aggregation ||
+		!gcontext->cuda_context)
+		return;
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		if (!tupdesc->attrs[j]->attbyval)
+			return;
+	}
+
+	/*
+	 * Unlike the private final buffer on the managed memory, physical
+	 * device memory is consumed on allocation. So, it is sized by the
+	 * estimated number of groups, up to 4GB.
+	 */
+	unitsz = LONGALIGN((sizeof(Datum) + sizeof(char)) * tupdesc->natts);
+	nrooms = Max(2 * gpas->plan_ngroups, 65536);
+	f_length = KDS_CALCULATE_HEAD_LENGTH(tupdesc->natts) + unitsz * nrooms;
+	if (f_length > 0xffff8000UL)
+	{
+		nrooms = (0xffff8000UL -
+				  KDS_CALCULATE_HEAD_LENGTH(tupdesc->natts)) / unitsz;
+		f_length = KDS_CALCULATE_HEAD_LENGTH(tupdesc->natts) + unitsz * nrooms;
+	}
+	f_length = STROMALIGN(f_length);
+	f_hashlimit = (size_t)((double)nrooms * 1.33);
+	f_hashsize = Min(gpupreagg_final_hashsize(gpas), f_hashlimit);
+
+	rc = gpuMemAllocDev(gcontext, gcontext->cuda_dindex,
+						&m_deviceptr,
+						f_length + offsetof(kern_global_hashslot,
+											hash_slot[f_hashlimit]),
+						&m_handle);
+	if (rc != CUDA_SUCCESS)
+		return;		/* use private final buffer instead */
+	gpas->m_fbuf_owned = m_deviceptr;
+	m_fhash = m_deviceptr + f_length;
+
+	/*
+	 * Initialization of the KDS header and the final hash-slot, like
+	 * gpupreagg_init_final_hash() doing for the private final buffer.
+	 */
+	kds_head = palloc(KDS_CALCULATE_HEAD_LENGTH(tupdesc->natts));
+	init_kernel_data_store(kds_head, tupdesc, f_length,
+						   KDS_FORMAT_SLOT, nrooms);
+	memset(&f_hash_head, 0, sizeof(kern_global_hashslot));
+	f_hash_head.hash_size = f_hashsize;
+	f_hash_head.hash_limit = f_hashlimit;
+
+	rc = cuCtxPushCurrent(gcontext->cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+	rc = cuMemcpyHtoD(m_deviceptr, kds_head,
+					  KERN_DATA_STORE_HEAD_LENGTH(kds_head));
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+	rc = cuMemcpyHtoD(m_fhash, &f_hash_head,
+					  offsetof(kern_global_hashslot, hash_slot));
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyHtoD: %s", errorText(rc));
+	/* pagg_hashslot shall be initialized to (hash=0, index=EMPTY) */
+	m_fhash += offsetof(kern_global_hashslot, hash_slot);
+	rc = cuMemsetD2D32(m_fhash, sizeof(pagg_hashslot),
+					   0, 1, f_hashlimit);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemsetD2D32: %s", errorText(rc));
+	rc = cuMemsetD2D32(m_fhash + sizeof(cl_uint), sizeof(pagg_hashslot),
+					   0xffffffffU, 1, f_hashlimit);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemsetD2D32: %s", errorText(rc));
+	rc = cuCtxSynchronize();
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxSynchronize: %s", errorText(rc));
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on cuCtxPopCurrent: %s", errorText(rc));
+	pfree(kds_head);
+
+	/* workers are not launched yet, so no locks are needed */
+	gpa_sstate->f_cuda_dindex = gcontext->cuda_dindex;
+	gpa_sstate->f_returned = false;
+	gpa_sstate->f_nattached = 0;
+	gpa_sstate->f_ndone = 0;
+	gpa_sstate->f_length = f_length;
+	gpa_sstate->f_hashsize = f_hashsize;
+	gpa_sstate->f_hashlimit = f_hashlimit;
+	gpa_sstate->f_nrooms_limit = Min(nrooms,
+									 GLOBAL_HASHSLOT_THRESHOLD(f_hashlimit));
+	memcpy(&gpa_sstate->f_mhandle, &m_handle, sizeof(CUipcMemHandle));
+}
+
+/*
+ * gpupreagg_attach_shared_final_buffer
+ *
+ * It attaches the shared final buffer, if any on the same device, and not
+ * returned yet by the last participant.
+ */
+static GpuPreAggFinalBuffer *
+gpupreagg_attach_shared_final_buffer(GpuPreAggState *gpas)
+{
+	GpuPreAggSharedState *gpa_sstate = gpas->gpa_sstate;
+	GpuContext	   *gcontext = gpas->gts.gcontext;
+	GpuPreAggFinalBuffer *fbuf;
+	CUdeviceptr		m_deviceptr;
+	bool			ipc_mapped = false;
+	bool			attached = false;
+	CUresult		rc;
+
+	if (!gpa_sstate || gpa_sstate->f_cuda_dindex != gcontext->cuda_dindex)
+		return NULL;
+	if (gpas->m_fbuf_owned != 0UL)
+		m_deviceptr = gpas->m_fbuf_owned;
+	else
+	{
+		rc = gpuIpcOpenMemHandle(gcontext,
+								 &m_deviceptr,
+								 gpa_sstate->f_mhandle,
+								 CU_IPC_MEM_LAZY_ENABLE_PEER_ACCESS);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuIpcOpenMemHandle: %s", errorText(rc));
+		ipc_mapped = true;
+	}
+
+	SpinLockAcquire(&gpa_sstate->f_lock);
+	if (!gpa_sstate->f_returned)
+	{
+		gpa_sstate->f_nattached++;
+		attached = true;
+	}
+	SpinLockRelease(&gpa_sstate->f_lock);
+	if (!attached)
+	{
+		if (ipc_mapped)
+		{
+			rc = gpuIpcCloseMemHandle(gcontext, m_deviceptr);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuIpcCloseMemHandle: %s",
+					 errorText(rc));
+		}
+		return NULL;
+	}
+	fbuf = palloc0(sizeof(GpuPreAggFinalBuffer));
+	fbuf->pds_final		= NULL;		/* not accessible from the host */
+	fbuf->m_kds_final	= m_deviceptr;
+	fbuf->m_fhash		= m_deviceptr + gpa_sstate->f_length;
+	fbuf->ev_init_fhash	= NULL;		/* already initialized */
+	fbuf->f_hashsize	= gpa_sstate->f_hashsize;
+	fbuf->f_hashlimit	= gpa_sstate->f_hashlimit;
+	fbuf->f_nrooms_limit = gpa_sstate->f_nrooms_limit;
+	fbuf->f_sstate		= gpa_sstate;
+	fbuf->f_ipc_mapped	= ipc_mapped;
+
+	return fbuf;
+}
+
+/*
+ * gpupreagg_detach_shared_final_buffer
+ *
+ * It detaches the shared final buffer once all the tasks of this process
+ * are completed. The last participant copies the final buffer to the host,
+ * then returns it as a private final buffer.
+ */
+static GpuPreAggFinalBuffer *
+gpupreagg_detach_shared_final_buffer(GpuPreAggState *gpas)
+{
+	GpuPreAggFinalBuffer *fbuf = gpas->fbuf_shared;
+	GpuPreAggSharedState *gpa_sstate = fbuf->f_sstate;
+	GpuContext	   *gcontext = gpas->gts.gcontext;
+	GpuPreAggFinalBuffer *fbuf_host = NULL;
+	bool			is_last = false;
+
+	SpinLockAcquire(&gpa_sstate->f_lock);
+	gpa_sstate->f_ndone++;
+	if (gpa_sstate->f_ndone == gpa_sstate->f_nattached)
+	{
+		gpa_sstate->f_returned = true;
+		is_last = true;
+	}
+	SpinLockRelease(&gpa_sstate->f_lock);
+
+	if (is_last)
+	{
+		TupleDesc	tupdesc = gpas->gpreagg_slot->tts_tupleDescriptor;
+		size_t		head_sz = KDS_CALCULATE_HEAD_LENGTH(tupdesc->natts);
+		pgstrom_data_store *pds_final;
+		kern_data_store *kds;
+		size_t		nitems;
+		CUresult	rc;
+
+		pds_final = PDS_create_slot(gcontext, tupdesc,
+									offsetof(pgstrom_data_store, kds) +
+									gpa_sstate->f_length);
+		kds = &pds_final->kds;
+
+		rc = cuCtxPushCurrent(gcontext->cuda_context);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+		rc = cuMemcpyDtoH(kds, fbuf->m_kds_final, head_sz);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+		nitems = Min(kds->nitems, kds->nrooms);
+		rc = cuMemcpyDtoH((char *)kds + head_sz,
+						  fbuf->m_kds_final + head_sz,
+						  KDS_CALCULATE_SLOT_LENGTH(kds->ncols,
+													nitems) - head_sz);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+		rc = cuCtxPopCurrent(NULL);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on cuCtxPopCurrent: %s", errorText(rc));
+		kds->nitems = nitems;
+
+		fbuf_host = palloc0(sizeof(GpuPreAggFinalBuffer));
+		fbuf_host->pds_final	= pds_final;
+		fbuf_host->m_kds_final	= (CUdeviceptr)kds;
+		fbuf_host->f_nrooms_limit = kds->nrooms;
+	}
+	gpupreagg_release_final_buffer(gcontext, fbuf);
+	gpas->fbuf_shared = NULL;
+
+	return fbuf_host;
+}
+
+/*
+ * gpupreagg_reserve_final_buffer
+ *
+ * It reserves @nrooms groups on the current final buffer for the new task.
+ * If the final buffer may overflow by the new groups, it detaches the
+ * current one and switches to a new one. The detached one is advised to
+ * stay on the host memory, because no new groups are added any more,
+ * then it shall be returned at the end of the scan.
+ * The capacity check and the reservation are done at once, because the
+ * shared final buffer is also reserved by the concurrent participants.
+ * Note that full aggregation mode never spills the final buffer, because
+ * nobody merges the groups that appear in multiple buffers.
+ *
+ * Fixed-point partial sum of numeric also limits the number of rows to be
+ * merged to a final buffer, because a group can accumulate all of them.
+ * The @nrooms is also the upper bound of the rows by the task, so the
+ * partial sum never overflows (even temporarily between the concurrent
+ * atomic additions) as long as the total is less than fixed_nrows_limit.
+ * If it is not possible to switch the final buffer, it returns false, and
+ * the caller has to process the task by CPU, prior to the GPU kernel.
+ */
+static bool
+gpupreagg_reserve_final_buffer(GpuPreAggState *gpas, size_t nrooms)
+{
+	GpuPreAggFinalBuffer *fbuf = gpas->fbuf_curr;
+	size_t			nrows_limit = gpas->fixed_nrows_limit;
+	bool			can_spill = (!gpas->full_aggregation &&
+								 enable_spill_final_buffer);
+	bool			may_spill = (gpas->num_group_keys > 0 && can_spill);
+	bool			need_spill;
+	CUresult		rc;
+
+	/* a task by itself may exceed the limit, if very large chunk */
+	if (nrows_limit > 0 && nrooms > nrows_limit)
+		return false;
+
+	if (fbuf->f_sstate)
+	{
+		GpuPreAggSharedState *gpa_sstate = fbuf->f_sstate;
+		uint64		f_ngroups;
+		uint64		f_reserved;
+		uint64		f_nrows_in;
+
+		for (;;)
+		{
+			f_nrows_in = pg_atomic_read_u64(&gpa_sstate->f_nrows_in);
+			if (nrows_limit > 0 && f_nrows_in + nrooms > nrows_limit)
+				goto switch_buffer;
+			if (pg_atomic_compare_exchange_u64(&gpa_sstate->f_nrows_in,
+											   &f_nrows_in,
+											   f_nrows_in + nrooms))
+				break;
+		}
+
+		for (;;)
+		{
+			f_ngroups = pg_atomic_read_u64(&gpa_sstate->f_ngroups);
+			f_reserved = pg_atomic_read_u64(&gpa_sstate->f_reserved);
+			if (may_spill &&
+				f_ngroups + f_reserved > 0 &&
+				f_ngroups + f_reserved + nrooms > fbuf->f_nrooms_limit)
+				break;
+			if (pg_atomic_compare_exchange_u64(&gpa_sstate->f_reserved,
+											   &f_reserved,
+											   f_reserved + nrooms))
+				return true;
+		}
+		/* no rows shall be merged to the shared buffer by this task */
+		pg_atomic_sub_fetch_u64(&gpa_sstate->f_nrows_in, nrooms);
+	switch_buffer:
+		/*
+		 * The shared final buffer is never spilled, because it is returned
+		 * by the last participant. This process just switches to a private
+		 * one.
+		 */
+		if (!can_spill)
+			return false;
+		fbuf = gpas->fbuf_curr = gpupreagg_alloc_final_buffer(gpas);
+	}
+	else
+	{
+		pthreadMutexLock(&gpas->f_mutex);
+		need_spill = ((may_spill &&
+					   fbuf->f_ngroups + fbuf->f_reserved > 0 &&
+					   fbuf->f_ngroups + fbuf->f_reserved +
+					   nrooms > fbuf->f_nrooms_limit) ||
+					  (nrows_limit > 0 &&
+					   fbuf->f_nrows_in + nrooms > nrows_limit));
+		if (!need_spill)
+		{
+			fbuf->f_reserved += nrooms;
+			fbuf->f_nrows_in += nrooms;
+		}
+		pthreadMutexUnlock(&gpas->f_mutex);
+		if (!need_spill)
+			return true;
+		if (!can_spill)
+			return false;
+
+		rc = cuMemAdvise((CUdeviceptr)&fbuf->pds_final->kds,
+						 fbuf->pds_final->kds.length,
+						 CU_MEM_ADVISE_SET_PREFERRED_LOCATION,
+						 CU_DEVICE_CPU);
+		if (rc != CUDA_SUCCESS)
+			elog(WARNING, "failed on cuMemAdvise: %s", errorText(rc));
+		gpas->fbuf_spilled = lappend(gpas->fbuf_spilled, fbuf);
+		fbuf = gpas->fbuf_curr = gpupreagg_alloc_final_buffer(gpas);
+		pg_atomic_add_fetch_u32(&gpas->gpa_rtstat->num_spilled_buffers, 1);
+	}
+	/* reservation on the new private final buffer */
+	pthreadMutexLock(&gpas->f_mutex);
+	fbuf->f_reserved += nrooms;
+	fbuf->f_nrows_in += nrooms;
+	pthreadMutexUnlock(&gpas->f_mutex);
+
+	return true;
 }
 
 /*
@@ -4206,10 +5740,21 @@ gpupreagg_create_task(GpuPreAggState *gpas,
 	CUresult		rc;
 	Size			head_sz;
 	Size			kgjoin_len = 0;
+	bool			cpu_fallback = false;
 
 	/* allocation of the final-buffer on demand */
-	if (!gpas->pds_final)
-		gpupreagg_alloc_final_buffer(gpas);
+	if (!gpas->fbuf_curr)
+	{
+		/* try to attach the shared final buffer first */
+		if (!gpas->fbuf_shared_tried)
+		{
+			gpas->fbuf_shared = gpupreagg_attach_shared_final_buffer(gpas);
+			gpas->fbuf_shared_tried = true;
+			gpas->fbuf_curr = gpas->fbuf_shared;
+		}
+		if (!gpas->fbuf_curr)
+			gpas->fbuf_curr = gpupreagg_alloc_final_buffer(gpas);
+	}
 
 	/* rough estimation of the result buffer */
 	if (!pds_src)
@@ -4242,8 +5787,12 @@ gpupreagg_create_task(GpuPreAggState *gpas,
 		kds_slot_length = STROMALIGN(offsetof(kern_data_store,
 											  colmeta[gpa_tupdesc->natts])) +
 			STROMALIGN(LONGALIGN((sizeof(Datum) + sizeof(char)) *
-								 gpa_tupdesc->natts) * kds_slot_nrooms);
+								 gpa_tupdesc->natts) * kds_slot_nrooms) +
+			STROMALIGN(gpas->gts.varlena_bufsz) * kds_slot_nrooms;
 	}
+	/* reserve the final buffer, or switch it if it may overflow */
+	if (!gpupreagg_reserve_final_buffer(gpas, kds_slot_nrooms))
+		cpu_fallback = true;
 	/* allocation of GpuPreAggTask */
 	head_sz = STROMALIGN(offsetof(GpuPreAggTask, kern.kparams) +
 						 gpas->gts.kern_params->length);
@@ -4267,6 +5816,18 @@ gpupreagg_create_task(GpuPreAggState *gpas,
 	gpreagg->pds_src = pds_src;
 	gpreagg->kds_slot_nrooms = kds_slot_nrooms;
 	gpreagg->kds_slot_length = kds_slot_length;
+	gpreagg->fbuf = gpas->fbuf_curr;
+	/*
+	 * The final buffer is already reserved for the new groups by this task.
+	 * It is just an estimation, because GpuJoin may generate more rows than
+	 * the source.
+	 * If no room for the fixed-point partial sum, the task is processed by
+	 * CPU without reservation; it is exact because nothing is merged yet.
+	 */
+	if (!cpu_fallback)
+		gpreagg->f_reserved = kds_slot_nrooms;
+	else
+		gpreagg->task.cpu_fallback = true;
 	if (gpas->combined_gpujoin)
 	{
 		GpuTaskState   *outer_gts = (GpuTaskState *) outerPlanState(gpas);
@@ -4402,6 +5963,37 @@ gpupreagg_terminator_task(GpuTaskState *gts, cl_bool *task_is_ready)
 			}
 		}
 	}
+	/* detach the shared final buffer; the last participant returns it */
+	if (gpas->fbuf_shared)
+	{
+		GpuPreAggFinalBuffer *fbuf_shared = gpas->fbuf_shared;
+		GpuPreAggFinalBuffer *fbuf_host;
+
+		fbuf_host = gpupreagg_detach_shared_final_buffer(gpas);
+		if (gpas->fbuf_curr == fbuf_shared)
+			gpas->fbuf_curr = fbuf_host;
+		else if (fbuf_host)
+			gpas->fbuf_spilled = lappend(gpas->fbuf_spilled, fbuf_host);
+		if (!gpas->fbuf_curr)
+		{
+			/* no private final buffer, and others return the groups */
+			Assert(gpas->fbuf_spilled == NIL);
+			gpas->terminator_done = true;
+			return NULL;
+		}
+	}
+	/* returns the spilled final buffers first, if any */
+	if (gpas->fbuf_spilled != NIL)
+	{
+		GpuPreAggTask  *gpreagg;
+
+		gpreagg = (GpuPreAggTask *)gpupreagg_create_task(gpas, NULL, 0UL, -1);
+		gpreagg->fbuf = linitial(gpas->fbuf_spilled);
+		gpreagg->fbuf_spilled = true;
+		gpas->fbuf_spilled = list_delete_first(gpas->fbuf_spilled);
+		*task_is_ready = true;
+		return &gpreagg->task;
+	}
 	/* setup a terminator task */
 	gpas->terminator_done = true;
 	*task_is_ready = true;
@@ -4489,7 +6081,7 @@ gpupreagg_next_tuple(GpuTaskState *gts)
 {
 	GpuPreAggState	   *gpas = (GpuPreAggState *) gts;
 	GpuPreAggTask	   *gpreagg = (GpuPreAggTask *) gpas->gts.curr_task;
-	pgstrom_data_store *pds_final = gpas->pds_final;
+	pgstrom_data_store *pds_final = gpreagg->fbuf->pds_final;
 	TupleTableSlot	   *slot = NULL;
 
 	if (gpreagg->task.cpu_fallback)
@@ -4511,6 +6103,7 @@ gpupreagg_init_final_hash(GpuPreAggTask *gpreagg,
 						  CUmodule cuda_module)
 {
 	GpuPreAggState *gpas = (GpuPreAggState *)gpreagg->task.gts;
+	GpuPreAggFinalBuffer *fbuf = gpreagg->fbuf;
 	CUfunction	kern_init_fhash;
 	CUevent		ev_init_fhash;
 	CUresult	rc;
@@ -4518,10 +6111,14 @@ gpupreagg_init_final_hash(GpuPreAggTask *gpreagg,
 	size_t		block_sz;
 	void	   *kern_args[3];
 
+	/* shared final buffer is already initialized by the leader */
+	if (fbuf->f_sstate)
+		return;
+
 	pthreadMutexLock(&gpas->f_mutex);
 	STROM_TRY();
 	{
-		if (!gpas->ev_init_fhash)
+		if (!fbuf->ev_init_fhash)
 		{
 			rc = cuModuleGetFunction(&kern_init_fhash,
 									 cuda_module,
@@ -4537,14 +6134,14 @@ gpupreagg_init_final_hash(GpuPreAggTask *gpreagg,
 			rc = gpuOptimalBlockSize(&grid_sz,
 									 &block_sz,
 									 kern_init_fhash,
-									 gpas->f_hashsize,
+									 fbuf->f_hashsize,
 									 0, 0);
 			if (rc != CUDA_SUCCESS)
 				werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
 
-			kern_args[0] = &gpas->m_fhash;
-			kern_args[1] = &gpas->f_hashsize;
-			kern_args[2] = &gpas->f_hashlimit;
+			kern_args[0] = &fbuf->m_fhash;
+			kern_args[1] = &fbuf->f_hashsize;
+			kern_args[2] = &fbuf->f_hashlimit;
 			rc = cuLaunchKernel(kern_init_fhash,
 								grid_sz, 1, 1,
 								block_sz, 1, 1,
@@ -4560,7 +6157,7 @@ gpupreagg_init_final_hash(GpuPreAggTask *gpreagg,
 			if (rc != CUDA_SUCCESS)
 				werror("failed on cuEventRecord: %s", errorText(rc));
 
-			gpas->ev_init_fhash = ev_init_fhash;
+			fbuf->ev_init_fhash = ev_init_fhash;
 
 			rc = cuStreamSynchronize(CU_STREAM_PER_THREAD);
 			if (rc != CUDA_SUCCESS)
@@ -4576,7 +6173,7 @@ gpupreagg_init_final_hash(GpuPreAggTask *gpreagg,
 	pthreadMutexUnlock(&gpas->f_mutex);
 	/* Point of synchronization */
 	rc = cuStreamWaitEvent(CU_STREAM_PER_THREAD,
-						   gpas->ev_init_fhash,
+						   fbuf->ev_init_fhash,
 						   0);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuStreamWaitEvent: %s", errorText(rc));
@@ -4608,23 +6205,24 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 {
 	GpuPreAggState *gpas = (GpuPreAggState *) gpreagg->task.gts;
 	GpuContext	   *gcontext = gpas->gts.gcontext;
-	pgstrom_data_store *pds_final = gpas->pds_final;
 	pgstrom_data_store *pds_src = gpreagg->pds_src;
 	cl_char			kds_src_format = pds_src->kds.format;
 	const char	   *kfunc_setup;
+	const char	   *kfunc_reduction;
 	CUfunction		kern_setup;
 	CUfunction		kern_reduction;
 	CUdeviceptr		m_gpreagg = (CUdeviceptr)&gpreagg->kern;
 	CUdeviceptr		m_nullptr = 0UL;
 	CUdeviceptr		m_kds_src = 0UL;
 	CUdeviceptr		m_kds_slot = 0UL;
-	CUdeviceptr		m_kds_final = (CUdeviceptr)&pds_final->kds;
-	CUdeviceptr		m_fhash = gpas->m_fhash;
+	CUdeviceptr		m_kds_final = gpreagg->fbuf->m_kds_final;
+	CUdeviceptr		m_fhash = gpreagg->fbuf->m_fhash;
 	int				sm_count;
 	size_t			grid_sz;
 	size_t			block_sz;
 	void		   *kern_args[6];
 	CUresult		rc;
+	uint64			range_id;
 	int				retval = 1;
 
 	/*
@@ -4650,11 +6248,12 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuModuleGetFunction: %s", errorText(rc));
 
+	kfunc_reduction = (gpreagg->kern.num_group_keys == 0
+					   ? "gpupreagg_nogroup_reduction"
+					   : "gpupreagg_groupby_reduction");
 	rc = cuModuleGetFunction(&kern_reduction,
 							 cuda_module,
-							 gpreagg->kern.num_group_keys == 0
-							 ? "gpupreagg_nogroup_reduction"
-							 : "gpupreagg_groupby_reduction");
+							 kfunc_reduction);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuModuleGetFunction: %s", errorText(rc));
 
@@ -4662,7 +6261,18 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	 * Device memory allocation for short term
 	 */
 	/* kds_src */
-	if (kds_src_format != KDS_FORMAT_BLOCK)
+	if (pds_src->kds_dev)
+	{
+		/* only referenced columns of the memory-mapped ccache */
+		rc = gpuMemAlloc(gcontext,
+						 &m_kds_src,
+						 pds_src->kds_dev->length);
+		if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+			goto out_of_resource;
+		else if (rc != CUDA_SUCCESS)
+			werror("failed on gpuMemAlloc: %s", errorText(rc));
+	}
+	else if (kds_src_format != KDS_FORMAT_BLOCK)
 		m_kds_src = (CUdeviceptr)&pds_src->kds;
 	else
 	{
@@ -4712,7 +6322,13 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	 */
 
 	/* source data to be reduced */
-	if (kds_src_format != KDS_FORMAT_BLOCK)
+	range_id = pgstromNvtxRangeStart(&gpas->gts, "DMA send");
+	pgstromStatTimingBegin(&gpas->gts);
+	if (pds_src->kds_dev)
+	{
+		gpuMemCopyFromMappedColumn(m_kds_src, pds_src);
+	}
+	else if (kds_src_format != KDS_FORMAT_BLOCK)
 	{
 		rc = cuMemPrefetchAsync(m_kds_src,
 								pds_src->kds.length,
@@ -4734,6 +6350,30 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	{
 		gpuMemCopyFromSSD(m_kds_src, pds_src);
 	}
+	pgstromStatDmaSend(&gpas->gts, PDS_DEVICE_KDS_HEAD(pds_src)->length);
+	pgstromNvtxRangeEnd(range_id);
+
+	/* bit-packed columns of ccache have to be expanded */
+	if (kds_src_format == KDS_FORMAT_COLUMN &&
+		PDS_DEVICE_KDS_HEAD(pds_src)->has_packed)
+	{
+		CUdeviceptr	m_kds_unpack
+			= gpuscan_unpack_column_store(gcontext,
+										  cuda_module,
+										  PDS_DEVICE_KDS_HEAD(pds_src),
+										  m_kds_src);
+		if (m_kds_unpack == 0UL)
+			goto out_of_resource;
+		if (m_kds_src != (CUdeviceptr)&pds_src->kds)
+		{
+			/* source image on the device is no longer needed */
+			rc = cuStreamSynchronize(CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuStreamSynchronize: %s", errorText(rc));
+			gpuMemFree(gcontext, m_kds_src);
+		}
+		m_kds_src = m_kds_unpack;
+	}
 
 	/*
 	 * Launch:
@@ -4753,6 +6393,8 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	kern_args[0] = &m_gpreagg;
 	kern_args[1] = &m_kds_src;
 	kern_args[2] = &m_kds_slot;
+	range_id = pgstromNvtxRangeStart(&gpas->gts, kfunc_setup);
+	pgstromStatTimingBegin(&gpas->gts);
 	rc = cuLaunchKernel(kern_setup,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -4762,6 +6404,8 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 						NULL);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuLaunchKernel: %s", errorText(rc));
+	pgstromStatKernelExec(&gpas->gts, kfunc_setup, true);
+	pgstromNvtxRangeEnd(range_id);
 
 	/*
 	 * Launch:
@@ -4786,6 +6430,8 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	kern_args[2] = &m_kds_slot;
 	kern_args[3] = &m_kds_final;
 	kern_args[4] = &m_fhash;
+	range_id = pgstromNvtxRangeStart(&gpas->gts, kfunc_reduction);
+	pgstromStatTimingBegin(&gpas->gts);
 	rc = cuLaunchKernel(kern_reduction,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -4804,6 +6450,8 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	pgstromStatKernelExec(&gpas->gts, kfunc_reduction, false);
+	pgstromNvtxRangeEnd(range_id);
 
 	/*
 	 * XXX - Even though we speculatively allocate large virtual device
@@ -4820,9 +6468,12 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 	/*
      * Clear the error code if CPU fallback case.
      * Elsewhere, update run-time statistics.
+     * Full aggregation mode never falls back, because fallback rows are
+     * partial results that nobody merges to the final values.
      */
 	gpreagg->task.kerror = gpreagg->kern.kerror;
 	if (pgstrom_cpu_fallback_enabled &&
+		!gpas->full_aggregation &&
 		gpreagg->task.kerror.errcode == StromError_CpuReCheck)
 	{
 		gpreagg->task.kerror.errcode = StromError_Success;
@@ -4837,7 +6488,7 @@ gpupreagg_process_reduction_task(GpuPreAggTask *gpreagg,
 		retval = -1;
 	}
 out_of_resource:
-	if (kds_src_format == KDS_FORMAT_BLOCK && m_kds_src != 0UL)
+	if (m_kds_src != 0UL && m_kds_src != (CUdeviceptr)&pds_src->kds)
 		gpuMemFree(gcontext, m_kds_src);
 	if (m_kds_slot != 0UL)
 		gpuMemFree(gcontext, m_kds_slot);
@@ -4854,24 +6505,26 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 {
 	GpuPreAggState *gpas = (GpuPreAggState *) gpreagg->task.gts;
 	GpuContext	   *gcontext = gpas->gts.gcontext;
-	pgstrom_data_store *pds_final = gpas->pds_final;
 	pgstrom_data_store *pds_src = gpreagg->pds_src;
 	kern_gpujoin   *kgjoin = gpreagg->kgjoin;
+	const char	   *kfunc_gpujoin;
+	const char	   *kfunc_reduction = NULL;
 	CUfunction		kern_gpujoin_main;
-	CUfunction		kern_gpupreagg_reduction;
+	CUfunction		kern_gpupreagg_reduction = NULL;
 	CUdeviceptr		m_gpreagg = (CUdeviceptr)&gpreagg->kern;
 	CUdeviceptr		m_kgjoin = (CUdeviceptr)kgjoin;
 	CUdeviceptr		m_kmrels = gpreagg->m_kmrels;
 	CUdeviceptr		m_kds_src = 0UL;
 	CUdeviceptr		m_kds_slot = 0UL;
-	CUdeviceptr		m_kds_final = (CUdeviceptr)&pds_final->kds;
-	CUdeviceptr		m_fhash = gpas->m_fhash;
+	CUdeviceptr		m_kds_final = gpreagg->fbuf->m_kds_final;
+	CUdeviceptr		m_fhash = gpreagg->fbuf->m_fhash;
 	CUdeviceptr		m_kparams = ((CUdeviceptr)&gpreagg->kern +
 								 offsetof(kern_gpupreagg, kparams));
 	CUresult		rc;
 	size_t			grid_sz;
 	size_t			block_sz;
 	void		   *kern_args[10];
+	uint64			range_id;
 	int				retval = 1;
 
 	/*
@@ -4884,28 +6537,45 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 	 *
 	 * XXX - needs to kick RIGHT OUTER JOIN
 	 */
+	kfunc_gpujoin = (pds_src != NULL
+					 ? "gpujoin_main"
+					 : "gpujoin_right_outer");
 	rc = cuModuleGetFunction(&kern_gpujoin_main,
 							 cuda_module,
-							 pds_src != NULL
-							 ? "gpujoin_main"
-							 : "gpujoin_right_outer");
+							 kfunc_gpujoin);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuModuleGetFunction: %s", errorText(rc));
 
-	rc = cuModuleGetFunction(&kern_gpupreagg_reduction,
-							 cuda_module,
-							 gpreagg->kern.num_group_keys == 0
-							 ? "gpupreagg_nogroup_reduction"
-							 : "gpupreagg_groupby_reduction");
-	if (rc != CUDA_SUCCESS)
-		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	/* fused mode does not need the reduction kernel */
+	if (!gpas->fused_gpujoin)
+	{
+		kfunc_reduction = (gpreagg->kern.num_group_keys == 0
+						   ? "gpupreagg_nogroup_reduction"
+						   : "gpupreagg_groupby_reduction");
+		rc = cuModuleGetFunction(&kern_gpupreagg_reduction,
+								 cuda_module,
+								 kfunc_reduction);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	}
 
 	/* allocation of kds_src */
 	if (!pds_src)
 		m_kds_src = 0UL;
 	else
 	{
-		if (pds_src->kds.format != KDS_FORMAT_BLOCK)
+		if (pds_src->kds_dev)
+		{
+			/* only referenced columns of the memory-mapped ccache */
+			rc = gpuMemAlloc(gcontext,
+							 &m_kds_src,
+							 pds_src->kds_dev->length);
+			if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+				goto out_of_resource;
+			else if (rc != CUDA_SUCCESS)
+				werror("failed on gpuMemAlloc: %s", errorText(rc));
+		}
+		else if (pds_src->kds.format != KDS_FORMAT_BLOCK)
 			m_kds_src = (CUdeviceptr)&pds_src->kds;
 		else
 		{
@@ -4935,22 +6605,34 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 		}
 	}
 
-	/* allocation of kds_slot */
-	rc = gpuMemAllocManaged(gcontext,
-							&m_kds_slot,
-							gpreagg->kds_slot_length,
-							CU_MEM_ATTACH_GLOBAL);
-	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
-		goto out_of_resource;
-	else if (rc != CUDA_SUCCESS)
-		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	/*
+	 * allocation of kds_slot, if not fused mode. Elsewhere, GpuJoin kernel
+	 * accumulates the joined rows onto the kds_final directly.
+	 */
+	if (!gpas->fused_gpujoin)
+	{
+		rc = gpuMemAllocManaged(gcontext,
+								&m_kds_slot,
+								gpreagg->kds_slot_length,
+								CU_MEM_ATTACH_GLOBAL);
+		if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+			goto out_of_resource;
+		else if (rc != CUDA_SUCCESS)
+			werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	}
 
 	/*
 	 * OK, kick a series of GpuPreAgg invocations
 	 */
 	if (pds_src)
 	{
-		if (pds_src->kds.format != KDS_FORMAT_BLOCK)
+		range_id = pgstromNvtxRangeStart(&gpas->gts, "DMA send");
+		pgstromStatTimingBegin(&gpas->gts);
+		if (pds_src->kds_dev)
+		{
+			gpuMemCopyFromMappedColumn(m_kds_src, pds_src);
+		}
+		else if (pds_src->kds.format != KDS_FORMAT_BLOCK)
 		{
 			rc = cuMemPrefetchAsync(m_kds_src,
 									pds_src->kds.length,
@@ -4972,6 +6654,32 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 		{
 			gpuMemCopyFromSSD(m_kds_src, pds_src);
 		}
+		pgstromStatDmaSend(&gpas->gts, PDS_DEVICE_KDS_HEAD(pds_src)->length);
+		pgstromNvtxRangeEnd(range_id);
+
+		/* bit-packed columns of ccache have to be expanded */
+		if (pds_src->kds.format == KDS_FORMAT_COLUMN &&
+			PDS_DEVICE_KDS_HEAD(pds_src)->has_packed)
+		{
+			CUdeviceptr	m_kds_unpack
+				= gpuscan_unpack_column_store(gcontext,
+											  cuda_module,
+											  PDS_DEVICE_KDS_HEAD(pds_src),
+											  m_kds_src);
+			if (m_kds_unpack == 0UL)
+				goto out_of_resource;
+			if (m_kds_src != (CUdeviceptr)&pds_src->kds)
+			{
+				/* source image on the device is no longer needed */
+				rc = cuStreamSynchronize(CU_STREAM_PER_THREAD);
+				if (rc != CUDA_SUCCESS)
+					werror("failed on cuStreamSynchronize: %s", errorText(rc));
+				gpuMemFree(gcontext, m_kds_src);
+			}
+			m_kds_src = m_kds_unpack;
+		}
+		/* clear the hash-value cache, if any */
+		gpujoinResetHashCache(kgjoin);
 	}
 	else
 	{
@@ -4982,10 +6690,13 @@ gpupreagg_process_combined_task(GpuPreAggTask *gpreagg, CUmodule cuda_module)
 
 resume_kernel:
 	/* init or reset kds_slot */
-	memcpy((void *)m_kds_slot, gpas->kds_slot_head,
-		   KERN_DATA_STORE_HEAD_LENGTH(gpas->kds_slot_head));
-	((kern_data_store *)m_kds_slot)->length = gpreagg->kds_slot_length;
-	((kern_data_store *)m_kds_slot)->nrooms = gpreagg->kds_slot_nrooms;
+	if (m_kds_slot != 0UL)
+	{
+		memcpy((void *)m_kds_slot, gpas->kds_slot_head,
+			   KERN_DATA_STORE_HEAD_LENGTH(gpas->kds_slot_head));
+		((kern_data_store *)m_kds_slot)->length = gpreagg->kds_slot_length;
+		((kern_data_store *)m_kds_slot)->nrooms = gpreagg->kds_slot_nrooms;
+	}
 
 	/*
 	 * Launch:
@@ -5019,9 +6730,11 @@ resume_kernel:
 		kern_args[2] = &m_kds_src;
 	else
 		kern_args[2] = &gpreagg->outer_depth;
-	kern_args[3] = &m_kds_slot;
+	kern_args[3] = (gpas->fused_gpujoin ? &m_kds_final : &m_kds_slot);
 	kern_args[4] = &m_kparams;
 
+	range_id = pgstromNvtxRangeStart(&gpas->gts, kfunc_gpujoin);
+	pgstromStatTimingBegin(&gpas->gts);
 	rc = cuLaunchKernel(kern_gpujoin_main,
 						grid_sz, 1, 1,
 						block_sz, 1, 1,
@@ -5031,6 +6744,8 @@ resume_kernel:
 						NULL);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuLaunchKernel: %s", errorText(rc));
+	pgstromStatKernelExec(&gpas->gts, kfunc_gpujoin, true);
+	pgstromNvtxRangeEnd(range_id);
 
 	/*
 	 * Launch:
@@ -5041,29 +6756,34 @@ resume_kernel:
 	 *                          kern_data_store *kds_final,
 	 *                          kern_global_hashslot *f_hash)
 	 */
-	rc = gpuOptimalBlockSize(&grid_sz,
-							 &block_sz,
-							 kern_gpupreagg_reduction,
-							 0,		/* max activation */
-							 0,
-							 sizeof(int));
-	if (rc != CUDA_SUCCESS)
-		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
-
-	kern_args[0] = &m_gpreagg;
-	kern_args[1] = &m_kgjoin;
-	kern_args[2] = &m_kds_slot;
-	kern_args[3] = &m_kds_final;
-	kern_args[4] = &m_fhash;
-	rc = cuLaunchKernel(kern_gpupreagg_reduction,
-						grid_sz, 1, 1,
-						block_sz, 1, 1,
-						sizeof(cl_int) * block_sz,	/* for StairlikeSum */
-						CU_STREAM_PER_THREAD,
-						kern_args,
-						NULL);
-	if (rc != CUDA_SUCCESS)
-		werror("failed on cuLaunchKernel: %s", errorText(rc));
+	if (!gpas->fused_gpujoin)
+	{
+		rc = gpuOptimalBlockSize(&grid_sz,
+								 &block_sz,
+								 kern_gpupreagg_reduction,
+								 0,		/* max activation */
+								 0,
+								 sizeof(int));
+		if (rc != CUDA_SUCCESS)
+			werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+
+		kern_args[0] = &m_gpreagg;
+		kern_args[1] = &m_kgjoin;
+		kern_args[2] = &m_kds_slot;
+		kern_args[3] = &m_kds_final;
+		kern_args[4] = &m_fhash;
+		range_id = pgstromNvtxRangeStart(&gpas->gts, kfunc_reduction);
+		pgstromStatTimingBegin(&gpas->gts);
+		rc = cuLaunchKernel(kern_gpupreagg_reduction,
+							grid_sz, 1, 1,
+							block_sz, 1, 1,
+							sizeof(cl_int) * block_sz,	/* for StairlikeSum */
+							CU_STREAM_PER_THREAD,
+							kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuLaunchKernel: %s", errorText(rc));
+	}
 
 	rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
@@ -5073,8 +6793,14 @@ resume_kernel:
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	if (!gpas->fused_gpujoin)
+	{
+		pgstromStatKernelExec(&gpas->gts, kfunc_reduction, false);
+		pgstromNvtxRangeEnd(range_id);
+	}
 
 	if (pgstrom_cpu_fallback_enabled &&
+		!gpas->full_aggregation &&
 		kgjoin->kerror.errcode == StromError_CpuReCheck)
 	{
 		/* CPU fallback by GpuJoin */
@@ -5090,6 +6816,7 @@ resume_kernel:
 		retval = 0;
 	}
 	else if (pgstrom_cpu_fallback_enabled &&
+			 !gpas->full_aggregation &&
 			 gpreagg->kern.kerror.errcode == StromError_CpuReCheck)
 	{
 		/* CPU fallback by GpuPreAgg */
@@ -5122,7 +6849,7 @@ resume_kernel:
 	}
 out_of_resource:
 	if (pds_src &&
-		pds_src->kds.format == KDS_FORMAT_BLOCK && m_kds_src != 0UL)
+		m_kds_src != 0UL && m_kds_src != (CUdeviceptr)&pds_src->kds)
 		gpuMemFree(gcontext, m_kds_src);
 	if (m_kds_slot != 0UL)
 		gpuMemFree(gcontext, m_kds_slot);
@@ -5138,6 +6865,10 @@ gpupreagg_process_task(GpuTask *gtask, CUmodule cuda_module)
 	GpuPreAggTask  *gpreagg = (GpuPreAggTask *) gtask;
 	int		retval;
 
+	/* already assigned to CPU fallback on construction */
+	if (gpreagg->task.cpu_fallback)
+		return 0;
+
 	if (!gpreagg->kgjoin)
 		retval = gpupreagg_process_reduction_task(gpreagg, cuda_module);
 	else
@@ -5153,8 +6884,30 @@ static void
 gpupreagg_release_task(GpuTask *gtask)
 {
 	GpuPreAggTask  *gpreagg = (GpuPreAggTask *)gtask;
+	GpuPreAggState *gpas = (GpuPreAggState *) gtask->gts;
+	GpuPreAggFinalBuffer *fbuf = gpreagg->fbuf;
 	GpuContext	   *gcontext = gtask->gts->gcontext;
 
+	/* update usage of the final buffer */
+	if (fbuf->f_sstate)
+	{
+		/* add f_ngroups first not to under-estimate the usage */
+		pg_atomic_add_fetch_u64(&fbuf->f_sstate->f_ngroups,
+								gpreagg->kern.num_groups);
+		pg_atomic_sub_fetch_u64(&fbuf->f_sstate->f_reserved,
+								gpreagg->f_reserved);
+	}
+	else
+	{
+		pthreadMutexLock(&gpas->f_mutex);
+		Assert(fbuf->f_reserved >= gpreagg->f_reserved);
+		fbuf->f_reserved -= gpreagg->f_reserved;
+		fbuf->f_ngroups += gpreagg->kern.num_groups;
+		pthreadMutexUnlock(&gpas->f_mutex);
+	}
+	/* spilled final buffer is no longer referenced */
+	if (gpreagg->fbuf_spilled)
+		gpupreagg_release_final_buffer(gcontext, fbuf);
 	if (gpreagg->pds_src)
 		PDS_release(gpreagg->pds_src);
 	gpuMemFree(gcontext, (CUdeviceptr)gpreagg);
@@ -5184,6 +6937,51 @@ pgstrom_init_gpupreagg(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* pg_strom.fused_outer_join */
+	DefineCustomBoolVariable("pg_strom.fused_outer_join",
+							 "Enables to fuse no-group GpuPreAgg into the pulled-up GpuJoin kernel",
+							 NULL,
+							 &enable_fused_outer_join,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpupreagg_spill_final_buffer */
+	DefineCustomBoolVariable("pg_strom.gpupreagg_spill_final_buffer",
+							 "Enables GpuPreAgg to spill out the final buffer on overflow",
+							 NULL,
+							 &enable_spill_final_buffer,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpupreagg_shared_final_buffer */
+	DefineCustomBoolVariable("pg_strom.gpupreagg_shared_final_buffer",
+							 "Enables parallel workers of GpuPreAgg to share the final buffer on the same device",
+							 NULL,
+							 &enable_shared_final_buffer,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpupreagg_compensated_sum */
+	DefineCustomBoolVariable("pg_strom.gpupreagg_compensated_sum",
+							 "Enables GpuPreAgg to use compensated summation for float8",
+							 NULL,
+							 &enable_compensated_sum,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpupreagg_full_aggregation */
+	DefineCustomBoolVariable("pg_strom.gpupreagg_full_aggregation",
+							 "Enables GpuPreAgg to produce the final aggregation without CPU Agg",
+							 NULL,
+							 &enable_full_aggregation,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 	/* initialization of path method table */
 	memset(&gpupreagg_path_methods, 0, sizeof(CustomPathMethods));
 	gpupreagg_path_methods.CustomName          = "GpuPreAgg";
@@ -25,6 +25,11 @@ static CustomScanMethods	gpuscan_plan_methods;
 static CustomExecMethods	gpuscan_exec_methods;
 static bool					enable_gpuscan;
 static bool					enable_pullup_outer_scan;
+static bool					enable_brin_filter;
+static bool					enable_late_materialization;
+bool						pgstrom_gpuscan_mvcc_check;		/* GUC */
+bool						pgstrom_heapscan_prefetch;		/* GUC */
+bool						pgstrom_gpuscan_zero_copy;		/* GUC */
 
 /*
  * form/deform interface of private field of CustomScan(GpuScan)
@@ -35,7 +40,9 @@ typedef struct {
 	cl_uint		extra_flags;	/* extra libraries to be included */
 	cl_uint		proj_tuple_sz;	/* nbytes of the expected result tuple size */
 	cl_uint		proj_extra_sz;	/* length of extra-buffer on kernel */
+	cl_uint		varlena_bufsz;	/* length of varlena-buffer on kernel */
 	cl_uint		nrows_per_block;/* estimated tuple density per block */
+	cl_long		tuple_bound;	/* bound by LIMIT clause, or -1 if none */
 	List	   *ccache_refs;	/* attributed to be referenced by ccache */
 	List	   *used_params;
 	List	   *dev_quals;		/* implicitly-ANDed device quals */
@@ -51,7 +58,9 @@ form_gpuscan_info(CustomScan *cscan, GpuScanInfo *gs_info)
 	privs = lappend(privs, makeInteger(gs_info->extra_flags));
 	privs = lappend(privs, makeInteger(gs_info->proj_tuple_sz));
 	privs = lappend(privs, makeInteger(gs_info->proj_extra_sz));
+	privs = lappend(privs, makeInteger(gs_info->varlena_bufsz));
 	privs = lappend(privs, makeInteger(gs_info->nrows_per_block));
+	privs = lappend(privs, makeInteger(gs_info->tuple_bound));
 	privs = lappend(privs, gs_info->ccache_refs);
 	exprs = lappend(exprs, gs_info->used_params);
 	exprs = lappend(exprs, gs_info->dev_quals);
@@ -73,7 +82,9 @@ deform_gpuscan_info(CustomScan *cscan)
 	gs_info->extra_flags = intVal(list_nth(privs, pindex++));
 	gs_info->proj_tuple_sz = intVal(list_nth(privs, pindex++));
 	gs_info->proj_extra_sz = intVal(list_nth(privs, pindex++));
+	gs_info->varlena_bufsz = intVal(list_nth(privs, pindex++));
 	gs_info->nrows_per_block = intVal(list_nth(privs, pindex++));
+	gs_info->tuple_bound = intVal(list_nth(privs, pindex++));
 	gs_info->ccache_refs = list_nth(privs, pindex++);
 	gs_info->used_params = list_nth(exprs, eindex++);
 	gs_info->dev_quals = list_nth(exprs, eindex++);
@@ -82,8 +93,11 @@ deform_gpuscan_info(CustomScan *cscan)
 }
 
 typedef struct {
+	GpuTaskRuntimeStat c;		/* common statistics */
 	pg_atomic_uint64 nitems_filtered;
+	pg_atomic_uint64 nitems_rechecked;
 	pg_atomic_uint64 ccache_count;
+	pg_atomic_uint64 nblocks_brin_skipped;
 } GpuScanRuntimeStat;
 
 typedef struct {
@@ -108,17 +122,55 @@ typedef struct {
 	/* resource for CPU fallback */
 	TupleTableSlot *base_slot;
 	ProjectionInfo *base_proj;
+	/* device resident gstore_fdw, if any */
+	bool			gstore_scan;	/* true, if scan on gstore_fdw */
+	bool			gstore_done;	/* true, if the chunk is already fetched */
+	bool			gstore_ipcmem;	/* true, if opened by IPC handle */
+	CUdeviceptr		m_kds_gstore;
 } GpuScanState;
 
+/* GPU kernels tracked by EXPLAIN ANALYZE */
+static const char *gpuscan_kernel_names[] = {
+	"gpuscan_exec_quals_row",
+	"gpuscan_exec_quals_block",
+	"gpuscan_exec_quals_column",
+	NULL
+};
+
+/*
+ * GpuScanBrinState - block filter by BRIN index
+ *
+ * Scan keys are built on ExecInitGpuScan from the 'column OP constant'
+ * qualifiers on the indexed columns. The candidate block ranges are built
+ * on the first fetch of the chunk, as a sorted array of [start, end).
+ */
+typedef struct GpuScanBrinState
+{
+	Oid				index_oid;
+	char		   *index_name;
+	int				nkeys;
+	ScanKeyData	   *scan_keys;
+	bool			is_ready;		/* true, if @ranges are built */
+	BlockNumber		nblocks;		/* rs_nblocks when @ranges are built */
+	cl_uint			nranges;
+	BlockNumber	   *ranges;			/* pair of [start, end) */
+} GpuScanBrinState;
+
 typedef struct
 {
 	GpuTask				task;
 	bool				with_nvme_strom;
 	bool				with_projection;
+	/* SSD-to-GPU Direct DMA kicked in advance, if any */
+	CUdeviceptr			m_kds_prefetch;
+	/* device resident gstore_fdw; pds_src has only KDS header */
+	CUdeviceptr			m_kds_gstore;
+	NVMEDmaState		dma_state;
 	/* DMA buffers */
 	pgstrom_data_store *pds_src;
 	pgstrom_data_store *pds_dst;
 	kern_resultbuf	   *kresults;
+	cl_uint				recheck_index;	/* next bit of the recheck bitmap */
 	kern_gpuscan		kern;
 } GpuScanTask;
 
@@ -128,8 +180,11 @@ typedef struct
 static GpuTask  *gpuscan_next_task(GpuTaskState *gts);
 static TupleTableSlot *gpuscan_next_tuple(GpuTaskState *gts);
 static void gpuscan_switch_task(GpuTaskState *gts, GpuTask *gtask);
+static cl_long gpuscan_task_nitems(GpuTask *gtask);
 static int gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module);
 static void gpuscan_release_task(GpuTask *gtask);
+static bool gpuscan_async_fallback(GpuTask *gtask);
+static bool gpuscan_prefetch_task(GpuTask *gtask);
 
 static GpuScanSharedState *createGpuScanSharedState(GpuScanState *gss,
 													ParallelContext *pcxt,
@@ -158,12 +213,16 @@ cost_gpuscan_common(PlannerInfo *root,
 {
 	Cost		startup_cost = 0.0;
 	Cost		run_cost = 0.0;
-	double		gpu_ratio = pgstrom_gpu_operator_cost / cpu_operator_cost;
+	double		gpu_setup_cost;
+	double		gpu_dma_cost;
+	double		gpu_operator_cost;
+	double		gpu_ratio;
 	double		parallel_divisor = (double) parallel_workers;
 	double		ntuples = scan_rel->tuples;
 	double		nchunks;
 	double		selectivity;
 	double		spc_seq_page_cost;
+	bool		device_resident;
 	cl_uint		nrows_per_block;
 	Size		heap_size;
 	Size		htup_size;
@@ -173,6 +232,12 @@ cost_gpuscan_common(PlannerInfo *root,
 		   scan_rel->relid > 0 &&
 		   scan_rel->relid < root->simple_rel_array_size);
 
+	/* static or calibrated cost factors */
+	pgstrom_gpu_cost_factors(&gpu_setup_cost,
+							 &gpu_dma_cost,
+							 &gpu_operator_cost);
+	gpu_ratio = gpu_operator_cost / cpu_operator_cost;
+
 	/* selectivity of device executable qualifiers */
 	selectivity = clause_selectivity(root,
 									 (Node *)scan_quals,
@@ -180,6 +245,10 @@ cost_gpuscan_common(PlannerInfo *root,
 									 JOIN_INNER,
 									 NULL);
 
+	/* gstore_fdw is already loaded onto the GPU device memory */
+	device_resident = (root->simple_rte_array[scan_rel->relid]->relkind ==
+					   RELKIND_FOREIGN_TABLE);
+
 	/* fetch estimated page cost for tablespace containing the table */
 	/*
 	 * TODO: we may need to discount page cost if NVMe-Strom is capable
@@ -195,7 +264,7 @@ cost_gpuscan_common(PlannerInfo *root,
 	 * Once NVMe-Strom driver supports hardware configuration info,
 	 * we follow it.
 	 */
-	if (ScanPathWillUseNvmeStrom(root, scan_rel))
+	if (!device_resident && ScanPathWillUseNvmeStrom(root, scan_rel))
 	{
 		/* FIXME: discount 50% if NVMe-Strom is ready */
 		spc_seq_page_cost /= 1.5;
@@ -212,7 +281,8 @@ cost_gpuscan_common(PlannerInfo *root,
 	 * On the other hands, planner usually choose PG-Strom's path
 	 * for large scale of data.
 	 */
-	run_cost += spc_seq_page_cost * (double)scan_rel->pages;
+	if (!device_resident)
+		run_cost += spc_seq_page_cost * (double)scan_rel->pages;
 
 	/*
 	 * Cost adjustment by CPU parallelism, if used.
@@ -236,12 +306,12 @@ cost_gpuscan_common(PlannerInfo *root,
 		 * be shared with all the worker process, so we can discount the
 		 * cost by parallel_divisor.
 		 */
-		startup_cost += pgstrom_gpu_setup_cost / parallel_divisor;
+		startup_cost += gpu_setup_cost / parallel_divisor;
 	}
 	else
 	{
 		parallel_divisor = 1.0;
-		startup_cost += pgstrom_gpu_setup_cost;
+		startup_cost += gpu_setup_cost;
 	}
 
 	/* estimation for number of chunks (assume KDS_FORMAT_ROW) */
@@ -280,7 +350,8 @@ cost_gpuscan_common(PlannerInfo *root,
 	ntuples *= selectivity;
 
 	/* Cost for DMA transfer (host/storage --> GPU) */
-	run_cost += pgstrom_gpu_dma_cost * nchunks;
+	if (!device_resident)
+		run_cost += gpu_dma_cost * nchunks;
 
 	*p_parallel_divisor = parallel_divisor;
 	*p_scan_ntuples = ntuples / parallel_divisor;
@@ -299,14 +370,20 @@ cost_for_dma_receive(RelOptInfo *rel, double ntuples)
 	PathTarget *reltarget = rel->reltarget;
 	cl_int		nattrs = list_length(reltarget->exprs);
 	cl_int		width_per_tuple;
+	double		gpu_setup_cost;
+	double		gpu_dma_cost;
+	double		gpu_operator_cost;
 
+	pgstrom_gpu_cost_factors(&gpu_setup_cost,
+							 &gpu_dma_cost,
+							 &gpu_operator_cost);
 	if (ntuples < 0.0)
 		ntuples = rel->rows;
 	width_per_tuple = offsetof(kern_tupitem, htup) +
 		MAXALIGN(offsetof(HeapTupleHeaderData,
 						  t_bits[BITMAPLEN(nattrs)])) +
 		MAXALIGN(reltarget->width);
-	return pgstrom_gpu_dma_cost *
+	return gpu_dma_cost *
 		(((double)width_per_tuple * ntuples) / (double)pgstrom_chunk_size());
 }
 
@@ -420,6 +497,7 @@ gpuscan_add_scan_path(PlannerInfo *root,
 	Path	   *pathnode;
 	List	   *dev_quals = NIL;
 	List	   *host_quals = NIL;
+	bool		is_gstore = false;
 	ListCell   *lc;
 
 	/* call the secondary hook */
@@ -441,8 +519,15 @@ gpuscan_add_scan_path(PlannerInfo *root,
 	/* only base relation we can handle */
 	if (rte->rtekind != RTE_RELATION)
 		return;
-	if (rte->relkind != RELKIND_RELATION &&
-		rte->relkind != RELKIND_MATVIEW)
+	if (rte->relkind == RELKIND_FOREIGN_TABLE)
+	{
+		/* gstore_fdw pinned on a particular device can be scanned */
+		if (gstore_fdw_pinning_device(rte->relid) < 0)
+			return;
+		is_gstore = true;
+	}
+	else if (rte->relkind != RELKIND_RELATION &&
+			 rte->relkind != RELKIND_MATVIEW)
 		return;
 
 	/* Check whether the qualifier can run on GPU device */
@@ -466,7 +551,8 @@ gpuscan_add_scan_path(PlannerInfo *root,
 	add_path(baserel, pathnode);
 
 	/* If appropriate, consider parallel GpuScan */
-	if (baserel->consider_parallel && baserel->lateral_relids == NULL)
+	if (!is_gstore &&
+		baserel->consider_parallel && baserel->lateral_relids == NULL)
 	{
 		int		parallel_nworkers;
 
@@ -501,13 +587,14 @@ gpuscan_add_scan_path(PlannerInfo *root,
  */
 void
 codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
-					  Index scanrelid, Expr *dev_quals)
+					  Index scanrelid, Oid relid, Expr *dev_quals)
 {
 	devtype_info   *dtype;
 	StringInfoData	tfunc;
 	StringInfoData	cfunc;
 	StringInfoData	temp;
 	Var			   *var;
+	char		   *cse_code = NULL;
 	char		   *expr_code = NULL;
 	ListCell	   *lc;
 
@@ -519,7 +606,10 @@ codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
 		goto output;
 
 	/* Let's walk on the device expression tree */
+	cse_code = pgstrom_codegen_common_subexprs(list_make1(dev_quals),
+											   context);
 	expr_code = pgstrom_codegen_expression((Node *)dev_quals, context);
+	context->cse_exprs = NIL;
 	/* Const/Param declarations */
 	pgstrom_codegen_param_declarations(&cfunc, context);
 	pgstrom_codegen_param_declarations(&tfunc, context);
@@ -541,49 +631,16 @@ codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
 	}
 
 	/*
-	 * Var declarations - if qualifier uses only one variables (like x > 0),
-	 * the pg_xxxx_vref() service routine is more efficient because it may
-	 * use attcacheoff to skip walking on tuple attributes.
+	 * Var declarations, and extraction from the heap-tuple. The columns
+	 * are fetched up to the last referenced one, specialized by the
+	 * attributes of the relation; fixed offsets for the leading fixed-length
+	 * NOT NULL columns, and no null-bitmap checks for NOT NULL columns.
 	 */
-	if (list_length(context->used_vars) <= 1)
-	{
-		foreach (lc, context->used_vars)
-		{
-			var = lfirst(lc);
-
-			if (var->varattno <= 0)
-				elog(ERROR, "Bug? system column appeared in expression");
-
-			dtype = pgstrom_devtype_lookup(var->vartype);
-			appendStringInfo(
-				&tfunc,
-				"  pg_%s_t %s_%u;\n\n"
-				"  addr = kern_get_datum_tuple(kds->colmeta,htup,%u);\n"
-				"  %s_%u = pg_%s_datum_ref(kcxt,addr);\n",
-				dtype->type_name,
-				context->var_label,
-				var->varattno,
-				var->varattno - 1,
-				context->var_label,
-                var->varattno,
-				dtype->type_name);
-			appendStringInfo(
-				&cfunc,
-				"  pg_%s_t %s_%u;\n\n"
-				"  addr = kern_get_datum_column(kds,%u,row_index);\n"
-				"  %s_%u = pg_%s_datum_ref(kcxt,addr);\n",
-				dtype->type_name,
-				context->var_label,
-				var->varattno,
-				var->varattno - 1,
-				context->var_label,
-				var->varattno,
-				dtype->type_name);
-		}
-	}
-	else
+	if (context->used_vars != NIL)
 	{
 		AttrNumber		anum, varattno_max = 0;
+		cl_uint			offset = 0;
+		bool			in_prefix = true;
 
 		/* declarations */
 		/* note that no expression including system column reference are*/
@@ -603,13 +660,55 @@ codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
 		}
 		appendStringInfoString(&tfunc, temp.data);
 		appendStringInfoString(&cfunc, temp.data);
+		resetStringInfo(&temp);
 
 		appendStringInfoString(
 			&tfunc,
 			"  assert(htup != NULL);\n"
-			"  EXTRACT_HEAP_TUPLE_BEGIN(addr, kds, htup);\n");
+			"  EXTRACT_HEAP_TUPLE_BEGIN_SPEC(kds, htup);\n");
 		for (anum=1; anum <= varattno_max; anum++)
 		{
+			HeapTuple	tup;
+			Form_pg_attribute attr;
+			int			attlen;
+			int			attalign;
+			bool		attnotnull;
+
+			tup = SearchSysCache2(ATTNUM,
+								  ObjectIdGetDatum(relid),
+								  Int16GetDatum(anum));
+			if (!HeapTupleIsValid(tup))
+				elog(ERROR, "cache lookup failed for attribute %d of relation %u",
+					 anum, relid);
+			attr = (Form_pg_attribute) GETSTRUCT(tup);
+			attlen = attr->attlen;
+			attalign = att_align_nominal(1, attr->attalign);
+			attnotnull = (attr->attnotnull && !attr->attisdropped);
+			ReleaseSysCache(tup);
+
+			if (in_prefix && attlen > 0 && attnotnull)
+			{
+				offset = TYPEALIGN(attalign, offset);
+				appendStringInfo(
+					&temp,
+					"  EXTRACT_HEAP_TUPLE_FIXED(addr, %u, %u);\n",
+					anum - 1, offset);
+				offset += attlen;
+			}
+			else
+			{
+				if (in_prefix && anum > 1)
+					appendStringInfo(
+						&tfunc,
+						"  EXTRACT_HEAP_TUPLE_SEEK(%u, %u);\n",
+						anum - 1, offset);
+				in_prefix = false;
+				appendStringInfo(
+					&tfunc,
+					"  EXTRACT_HEAP_TUPLE_NEXT_SPEC(addr, %d, %d, %s);\n",
+					attlen, attalign, attnotnull ? "true" : "false");
+			}
+
 			foreach (lc, context->used_vars)
 			{
 				var = lfirst(lc);
@@ -618,6 +717,9 @@ codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
 				{
 					dtype = pgstrom_devtype_lookup(var->vartype);
 
+					/* fixed offset is needed only if referenced */
+					if (in_prefix)
+						appendStringInfoString(&tfunc, temp.data);
 					appendStringInfo(
 						&tfunc,
 						"  %s_%u = pg_%s_datum_ref(kcxt,addr);\n",
@@ -635,16 +737,15 @@ codegen_gpuscan_quals(StringInfo kern, codegen_context *context,
 					break;	/* no need to read same value twice */
 				}
 			}
-
-			if (anum < varattno_max)
-				appendStringInfoString(
-					&tfunc,
-					"  EXTRACT_HEAP_TUPLE_NEXT(addr);\n");
+			resetStringInfo(&temp);
 		}
 		appendStringInfoString(
 			&tfunc,
 			"  EXTRACT_HEAP_TUPLE_END();\n");
 	}
+	/* common subexpressions, evaluated only once */
+	appendStringInfoString(&tfunc, cse_code);
+	appendStringInfoString(&cfunc, cse_code);
 output:
 	appendStringInfo(
 		kern,
@@ -683,6 +784,7 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 {
 	TupleDesc		tupdesc = RelationGetDescr(relation);
 	List		   *tlist_dev = NIL;
+	List		   *exprs_dev = NIL;
 	AttrNumber	   *varremaps;
 	Bitmapset	   *varattnos;
 	ListCell	   *lc;
@@ -978,6 +1080,25 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 			"  EXTRACT_HEAP_TUPLE_END();\n"
 			"\n");
 
+	/*
+	 * step.2 - common subexpressions across the target-list are evaluated
+	 * only once, on the CSE_xx variables.
+	 */
+	foreach (lc, tlist_dev)
+	{
+		TargetEntry	   *tle = lfirst(lc);
+
+		if (!IsA(tle->expr, Var))
+			exprs_dev = lappend(exprs_dev, tle->expr);
+	}
+	if (exprs_dev != NIL)
+	{
+		char   *cse_code = pgstrom_codegen_common_subexprs(exprs_dev,
+														   context);
+		appendStringInfoString(&tbody, cse_code);
+		appendStringInfoString(&cbody, cse_code);
+	}
+
 	/*
 	 * step.3 - execute expression node, then store the result onto KVAR_xx
 	 */
@@ -1013,6 +1134,7 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 		appendStringInfoString(&tbody, temp.data);
         appendStringInfoString(&cbody, temp.data);
 	}
+	context->cse_exprs = NIL;
 
 	/*
 	 * step.5 - Store the expressions on the slot.
@@ -1093,6 +1215,7 @@ codegen_gpuscan_projection(StringInfo kern, codegen_context *context,
 		cdecl.data,
 		cbody.data);
 	list_free(tlist_dev);
+	list_free(exprs_dev);
 	pfree(temp.data);
 	pfree(tdecl.data);
 	pfree(cdecl.data);
@@ -1374,7 +1497,13 @@ bufsz_estimate_gpuscan_projection(RelOptInfo *baserel,
 			proj_tuple_sz += (dtype->type_length > 0
 							  ? dtype->type_length
 							  : get_typavgwidth(type_oid, type_mod));
-			if (!dtype->type_byval)
+			/*
+			 * NOTE: varlena datum by reference (like text) points either
+			 * the source buffer or the per-thread varlena buffer, so it
+			 * does not consume the extra buffer.
+			 */
+			if (!dtype->type_byval &&
+				(dtype->type_length != -1 || dtype->extra_sz > 0))
 			{
 				if (dtype->extra_sz == 0)
 					elog(ERROR, "Bug? device type '%s' has indirect/varlena definition but no extra-size parameter at expression of: %s",
@@ -1457,11 +1586,32 @@ PlanGpuScanPath(PlannerInfo *root,
 	initStringInfo(&kern);
 	initStringInfo(&source);
 	pgstrom_init_codegen_context(&context);
-	codegen_gpuscan_quals(&kern, &context, baserel->relid, dev_quals_expr);
+	codegen_gpuscan_quals(&kern, &context, baserel->relid, rte->relid,
+						  dev_quals_expr);
 	tlist_dev = build_gpuscan_projection(baserel->relid, relation,
 										 tlist,
 										 host_quals,
 										 dev_quals);
+	/*
+	 * Late materialization - if device projection just picks up a subset
+	 * of the columns, GPU writes back only offset of the rows survived,
+	 * then CPU fetches the referenced columns from the source buffer.
+	 * It is valid only if source buffer is also kept on the host side.
+	 */
+	if (tlist_dev != NIL &&
+		enable_late_materialization &&
+		RelationGetForm(relation)->relkind != RELKIND_FOREIGN_TABLE)
+	{
+		foreach (cell, tlist_dev)
+		{
+			TargetEntry	   *tle = lfirst(cell);
+
+			if (!IsA(tle->expr, Var))
+				break;
+		}
+		if (!cell)
+			tlist_dev = NIL;
+	}
 	bufsz_estimate_gpuscan_projection(baserel, relation, tlist_dev,
 									  &proj_tuple_sz,
 									  &proj_extra_sz);
@@ -1505,9 +1655,26 @@ PlanGpuScanPath(PlannerInfo *root,
 		DEVKERNEL_NEEDS_DYNPARA | DEVKERNEL_NEEDS_GPUSCAN;
 	gs_info->proj_tuple_sz = proj_tuple_sz;
 	gs_info->proj_extra_sz = proj_extra_sz;
+	gs_info->varlena_bufsz = context.varlena_bufsz;
 	gs_info->ccache_refs = ccache_refs;
 	gs_info->used_params = context.used_params;
 	gs_info->dev_quals = dev_quals;
+	/*
+	 * If GpuScan is the only relation scan of the query with LIMIT clause,
+	 * and every row returned by GPU is also returned to the upper node,
+	 * we can stop the scan once the chunks already processed have rows
+	 * more than the limit.
+	 * NOTE: planner already sets -1 on @limit_tuples if any aggregation,
+	 * grouping, DISTINCT, window functions or SRFs are used.
+	 */
+	gs_info->tuple_bound = -1;
+	if (root->limit_tuples >= 0.0 &&
+		baserel->reloptkind == RELOPT_BASEREL &&
+		bms_equal(root->all_baserels, baserel->relids) &&
+		root->query_pathkeys == NIL &&
+		root->parse->rowMarks == NIL &&
+		host_quals == NIL)
+		gs_info->tuple_bound = (cl_long) ceil(root->limit_tuples);
 	form_gpuscan_info(cscan, gs_info);
 
 	return &cscan->scan.plan;
@@ -1692,6 +1859,119 @@ assign_gpuscan_session_info(StringInfo buf, GpuTaskState *gts)
 	}
 }
 
+/*
+ * gpuscan_init_brin_state
+ *
+ * It picks up a BRIN index on the relation which can evaluate the largest
+ * number of 'column OP constant' form qualifiers, then builds scan keys.
+ * NULL shall be returned if no BRIN index is applicable.
+ */
+static GpuScanBrinState *
+gpuscan_init_brin_state(Relation relation, Index scanrelid, List *quals)
+{
+	GpuScanBrinState *brin_sstate = NULL;
+	List	   *index_oids;
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	if (!enable_brin_filter || quals == NIL)
+		return NULL;
+
+	index_oids = RelationGetIndexList(relation);
+	foreach (lc1, index_oids)
+	{
+		Oid				index_oid = lfirst_oid(lc1);
+		Relation		index_rel = index_open(index_oid, AccessShareLock);
+		Form_pg_index	ind = index_rel->rd_index;
+		ScanKeyData	   *scan_keys;
+		int				nkeys = 0;
+
+		if (index_rel->rd_rel->relam != BRIN_AM_OID || !IndexIsValid(ind))
+		{
+			index_close(index_rel, NoLock);
+			continue;
+		}
+		scan_keys = palloc0(sizeof(ScanKeyData) * list_length(quals));
+		foreach (lc2, quals)
+		{
+			OpExpr	   *op = lfirst(lc2);
+			Var		   *var;
+			Const	   *con;
+			Oid			opno;
+			Oid			opfamily;
+			Oid			lefttype;
+			Oid			righttype;
+			int			strategy;
+			int			indexcol;
+
+			if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+				continue;
+			if (IsA(linitial(op->args), Var) && IsA(lsecond(op->args), Const))
+			{
+				var = linitial(op->args);
+				con = lsecond(op->args);
+				opno = op->opno;
+			}
+			else if (IsA(linitial(op->args), Const) &&
+					 IsA(lsecond(op->args), Var))
+			{
+				con = linitial(op->args);
+				var = lsecond(op->args);
+				opno = get_commutator(op->opno);
+				if (!OidIsValid(opno))
+					continue;
+			}
+			else
+				continue;
+			if (var->varno != scanrelid ||
+				var->varlevelsup > 0 ||
+				var->varattno <= 0 ||
+				con->constisnull)
+				continue;
+
+			for (indexcol=0; indexcol < ind->indnatts; indexcol++)
+			{
+				if (ind->indkey.values[indexcol] == var->varattno)
+					break;
+			}
+			if (indexcol >= ind->indnatts)
+				continue;
+			opfamily = index_rel->rd_opfamily[indexcol];
+			if (get_op_opfamily_strategy(opno, opfamily) == InvalidStrategy)
+				continue;
+			get_op_opfamily_properties(opno, opfamily, false,
+									   &strategy, &lefttype, &righttype);
+			ScanKeyEntryInitialize(&scan_keys[nkeys++],
+								   0,
+								   indexcol + 1,
+								   strategy,
+								   righttype,
+								   op->inputcollid,
+								   get_opcode(opno),
+								   con->constvalue);
+		}
+
+		if (nkeys > 0 && (!brin_sstate || nkeys > brin_sstate->nkeys))
+		{
+			if (!brin_sstate)
+				brin_sstate = palloc0(sizeof(GpuScanBrinState));
+			else
+				pfree(brin_sstate->scan_keys);
+			brin_sstate->index_oid = index_oid;
+			brin_sstate->index_name =
+				pstrdup(RelationGetRelationName(index_rel));
+			brin_sstate->nkeys = nkeys;
+			brin_sstate->scan_keys = scan_keys;
+		}
+		else
+			pfree(scan_keys);
+		index_close(index_rel, NoLock);
+	}
+	list_free(index_oids);
+
+	return brin_sstate;
+}
+
 /*
  * gpuscan_create_scan_state - allocation of GpuScanState
  */
@@ -1722,6 +2002,7 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	CustomScan	   *cscan = (CustomScan *)node->ss.ps.plan;
 	GpuScanInfo	   *gs_info = deform_gpuscan_info(cscan);
 	GpuContext	   *gcontext;
+	cl_int			cuda_dindex = -1;
 	bool			explain_only = ((eflags & EXEC_FLAG_EXPLAIN_ONLY) != 0);
 	List		   *dev_tlist = NIL;
 	List		   *dev_quals_raw;
@@ -1736,7 +2017,18 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	Assert(innerPlan(node) == NULL);
 
 	/* setup GpuContext for CUDA kernel execution */
-	gcontext = AllocGpuContext(-1, false);
+	/* gstore_fdw has to be processed on the device where it is pinned */
+	if (RelationGetForm(scan_rel)->relkind == RELKIND_FOREIGN_TABLE)
+	{
+		gss->gstore_scan = true;
+		cuda_dindex = gstore_fdw_pinning_device(RelationGetRelid(scan_rel));
+	}
+	else
+	{
+		/* prefer the GPU closest to the storage, if SSD-to-GPU Direct */
+		cuda_dindex = RelationGetOptimalGpuDevice(scan_rel);
+	}
+	gcontext = AllocGpuContext(cuda_dindex, false);
 	if (!explain_only)
 		ActivateGpuContext(gcontext);
 	gss->gts.gcontext = gcontext;
@@ -1762,7 +2054,7 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	pgstromInitGpuTaskState(&gss->gts,
 							gcontext,
 							GpuTaskKind_GpuScan,
-							gs_info->ccache_refs,
+							gss->gstore_scan ? NIL : gs_info->ccache_refs,
 							gs_info->used_params,
 							estate);
 	gss->gts.cb_next_task   = gpuscan_next_task;
@@ -1770,6 +2062,12 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	gss->gts.cb_switch_task = gpuscan_switch_task;
 	gss->gts.cb_process_task = gpuscan_process_task;
 	gss->gts.cb_release_task = gpuscan_release_task;
+	gss->gts.cb_async_fallback = gpuscan_async_fallback;
+	gss->gts.cb_prefetch_task = gpuscan_prefetch_task;
+	gss->gts.cb_task_nitems = gpuscan_task_nitems;
+	gss->gts.kern_names = gpuscan_kernel_names;
+	/* bound of rows by LIMIT clause, if any */
+	gss->gts.tuple_bound = gs_info->tuple_bound;
 	/* estimated number of rows per block */
 	gss->gts.outer_nrows_per_block = gs_info->nrows_per_block;
 
@@ -1782,6 +2080,16 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	dev_quals_raw = (List *)fixup_varnode_to_origin((Node *)gs_info->dev_quals,
 													cscan->custom_scan_tlist);
 	dev_quals_expr = make_ands_explicit(dev_quals_raw);
+	/* qualifiers to be checked with zone-map of the columnar cache */
+	if (gss->gts.ccache_refs)
+		gss->gts.ccache_zone_quals =
+			pgstrom_ccache_zonemap_quals(scan_rel,
+										 cscan->scan.scanrelid,
+										 dev_quals_raw);
+	/* BRIN index to skip heap blocks which never satisfy the quals */
+	gss->gts.brin_sstate = gpuscan_init_brin_state(scan_rel,
+												   cscan->scan.scanrelid,
+												   dev_quals_raw);
 #if PG_VERSION_NUM < 100000
 	gss->dev_quals = list_make1(ExecInitExpr(dev_quals_expr,
 											 &gss->gts.css.ss.ps));
@@ -1812,6 +2120,7 @@ ExecInitGpuScan(CustomScanState *node, EState *estate, int eflags)
 	/* device projection related resource consumption */
 	gss->proj_tuple_sz = gs_info->proj_tuple_sz;
 	gss->proj_extra_sz = gs_info->proj_extra_sz;
+	gss->gts.varlena_bufsz = gs_info->varlena_bufsz;
 	/* 'tableoid' should not change during relation scan */
 	gss->scan_tuple.t_tableOid = RelationGetRelid(scan_rel);
 	/* initialize resource for CPU fallback */
@@ -1910,6 +2219,7 @@ ExecGpuScan(CustomScanState *node)
 	{
 		gss->gs_sstate = createGpuScanSharedState(gss, NULL, NULL);
 		gss->gs_rtstat = &gss->gs_sstate->gs_rtstat;
+		gss->gts.gt_rtstat = &gss->gs_rtstat->c;
 	}
 	return ExecScan(&node->ss,
 					(ExecScanAccessMtd) pgstromExecGpuTaskState,
@@ -1929,6 +2239,14 @@ ExecEndGpuScan(CustomScanState *node)
 	/* reset fallback resources */
 	if (gss->base_slot)
 		ExecDropSingleTupleTableSlot(gss->base_slot);
+	/* close device memory of gstore_fdw, if any */
+	if (gss->m_kds_gstore != 0UL)
+	{
+		if (gss->gstore_ipcmem)
+			gpuIpcCloseMemHandle(gss->gts.gcontext, gss->m_kds_gstore);
+		else
+			gpuMemFree(gss->gts.gcontext, gss->m_kds_gstore);
+	}
 	pgstromReleaseGpuTaskState(&gss->gts);
 }
 
@@ -1947,7 +2265,13 @@ ExecReScanGpuScan(CustomScanState *node)
 	/* common rescan handling */
 	pgstromRescanGpuTaskState(&gss->gts);
 	/* rewind the position to read */
-	gpuscanRewindScanChunk(&gss->gts);
+	if (gss->gstore_scan)
+	{
+		gss->gstore_done = false;
+		ExecScanReScan(&gss->gts.css.ss);
+	}
+	else
+		gpuscanRewindScanChunk(&gss->gts);
 }
 
 /*
@@ -1984,6 +2308,7 @@ ExecGpuScanInitDSM(CustomScanState *node,
 	{
 		gss->gs_sstate = createGpuScanSharedState(gss, pcxt, coordinate);
 		gss->gs_rtstat = &gss->gs_sstate->gs_rtstat;
+		gss->gts.gt_rtstat = &gss->gs_rtstat->c;
 		on_dsm_detach(pcxt->seg,
 					  SynchronizeGpuContextOnDSMDetach,
 					  PointerGetDatum(gss->gts.gcontext));
@@ -2021,6 +2346,7 @@ ExecGpuScanInitWorker(CustomScanState *node,
 	{
 		gss->gs_sstate = (GpuScanSharedState *)coordinate;
 		gss->gs_rtstat = &gss->gs_sstate->gs_rtstat;
+		gss->gts.gt_rtstat = &gss->gs_rtstat->c;
 		on_dsm_detach(dsm_find_mapping(gss->gs_sstate->ss_handle),
 					  SynchronizeGpuContextOnDSMDetach,
 					  PointerGetDatum(gss->gts.gcontext));
@@ -2063,6 +2389,7 @@ ExecShutdownGpuScan(CustomScanState *node)
 		memcpy(gss->gs_rtstat,
 			   gs_rtstat_old,
 			   sizeof(GpuScanRuntimeStat));
+		gss->gts.gt_rtstat = &gss->gs_rtstat->c;
 	}
 }
 #endif
@@ -2082,10 +2409,15 @@ ExplainGpuScan(CustomScanState *node, List *ancestors, ExplainState *es)
 	char			   *exprstr;
 	ListCell		   *lc;
 	uint64				nitems_filtered = 0;
+	uint64				nitems_rechecked = 0;
+	uint64				nblocks_brin_skipped = 0;
 
 	if (gs_rtstat)
 	{
 		nitems_filtered = pg_atomic_read_u64(&gs_rtstat->nitems_filtered);
+		nitems_rechecked = pg_atomic_read_u64(&gs_rtstat->nitems_rechecked);
+		nblocks_brin_skipped =
+			pg_atomic_read_u64(&gs_rtstat->nblocks_brin_skipped);
 		gss->gts.ccache_count = pg_atomic_read_u64(&gs_rtstat->ccache_count);
 	}
 
@@ -2124,6 +2456,31 @@ ExplainGpuScan(CustomScanState *node, List *ancestors, ExplainState *es)
 			ExplainPropertyLong("Rows Removed by GPU Filter",
 								nitems_filtered / instr->nloops, es);
 		}
+		if (gss->gts.css.ss.ps.instrument && nitems_rechecked > 0)
+		{
+			Instrumentation *instr = gss->gts.css.ss.ps.instrument;
+
+			ExplainPropertyLong("Rows Rechecked by CPU",
+								nitems_rechecked / instr->nloops, es);
+		}
+	}
+
+	/* Show device resident gstore_fdw */
+	if (gss->gstore_scan)
+		ExplainPropertyText("GPU Store", "device resident", es);
+
+	/* Show BRIN index used for block filter */
+	if (gss->gts.brin_sstate)
+	{
+		ExplainPropertyText("BRIN Filter",
+							gss->gts.brin_sstate->index_name, es);
+		if (gss->gts.css.ss.ps.instrument && nblocks_brin_skipped > 0)
+		{
+			Instrumentation *instr = gss->gts.css.ss.ps.instrument;
+
+			ExplainPropertyLong("Blocks Skipped by BRIN Filter",
+								nblocks_brin_skipped / instr->nloops, es);
+		}
 	}
 
 	/* common portion of EXPLAIN */
@@ -2175,15 +2532,28 @@ gpuscan_create_task(GpuScanState *gss,
 	kern_resultbuf *kresults = NULL;
 	GpuScanTask	   *gscan;
 	cl_uint			nresults = 0;
+	cl_uint			recheck_width = 0;
+	cl_uint			recheck_nbits;
+	cl_uint			snapshot_length = 0;
+	Snapshot		snapshot = gss->gts.css.ss.ps.state->es_snapshot;
 	size_t			length;
 	CUdeviceptr		m_deviceptr;
 	CUresult		rc;
 
 	/*
 	 * allocation of destination buffer
+	 *
+	 * If no device projection is required, GPU kernel writes back only
+	 * offset of the rows (or line items) survived, then CPU fetches the
+	 * tuples from the source buffer; unless KDS_FORMAT_BLOCK is partially
+	 * loaded by NVMe-Strom, because uncached blocks are not on the host.
 	 */
 	if (pds_src->kds.format == KDS_FORMAT_ROW && !gss->dev_projection)
 		nresults = pds_src->kds.nitems;
+	else if (pds_src->kds.format == KDS_FORMAT_BLOCK &&
+			 pds_src->nblocks_uncached == 0 &&
+			 !gss->dev_projection)
+		nresults = pds_src->kds.nitems * MaxHeapTuplesPerPage;
 	else
 	{
 		double	ntuples = pds_src->kds.nitems;
@@ -2205,12 +2575,40 @@ gpuscan_create_task(GpuScanState *gss,
 								 length);
 	}
 
+	/*
+	 * rows that need CPU recheck are marked on the bitmap, instead of
+	 * the fallback of whole the chunk. KDS_FORMAT_BLOCK assigns bits
+	 * for each line item of the blocks.
+	 */
+	if (pgstrom_cpu_fallback_enabled)
+	{
+		if (pds_src->kds.format == KDS_FORMAT_ROW)
+			recheck_width = 1;
+		else if (pds_src->kds.format == KDS_FORMAT_BLOCK)
+			recheck_width = MaxHeapTuplesPerPage;
+	}
+	recheck_nbits = pds_src->kds.nitems * recheck_width;
+
+	/*
+	 * MVCC snapshot, if NVMe-Strom loaded blocks not all-visible
+	 */
+	if (pds_src->kds.format == KDS_FORMAT_BLOCK &&
+		pds_src->nblocks_uncached > 0 &&
+		gss->gts.nvme_sstate->gpu_mvcc)
+	{
+		Assert(recheck_width == MaxHeapTuplesPerPage);
+		snapshot_length = offsetof(kern_snapshot,
+								   xip[snapshot->xcnt + snapshot->subxcnt]);
+	}
+
 	/*
 	 * allocation of pgstrom_gpuscan
 	 */
 	length = (STROMALIGN(offsetof(GpuScanTask, kern.kparams)) +
 			  STROMALIGN(gss->gts.kern_params->length) +
-			  STROMALIGN(offsetof(kern_resultbuf, results[nresults])));
+			  STROMALIGN(offsetof(kern_resultbuf, results[nresults])) +
+			  STROMALIGN(sizeof(cl_uint) * ((recheck_nbits + 31) / 32)) +
+			  STROMALIGN(snapshot_length));
 	rc = gpuMemAllocManaged(gcontext,
 							&m_deviceptr,
 							length,
@@ -2221,10 +2619,11 @@ gpuscan_create_task(GpuScanState *gss,
 	memset(gscan, 0, (offsetof(GpuScanTask, kern) +
 					  offsetof(kern_gpuscan, kparams)));
 	pgstromInitGpuTask(&gss->gts, &gscan->task);
-	gscan->with_nvme_strom = (pds_src->kds.format == KDS_FORMAT_BLOCK &&
-							  pds_src->nblocks_uncached > 0);
+	gscan->with_nvme_strom = (pds_src->nblocks_uncached > 0);
 	gscan->pds_src = pds_src;
 	gscan->pds_dst = pds_dst;
+	gscan->kern.recheck_width = recheck_width;
+	gscan->kern.recheck_nbits = recheck_nbits;
 
 	/* kern_parambuf */
 	memcpy(KERN_GPUSCAN_PARAMBUF(&gscan->kern),
@@ -2237,10 +2636,177 @@ gpuscan_create_task(GpuScanState *gss,
 	kresults->nrooms = nresults;
 	if (!pds_dst)
 		gscan->kresults = kresults;
+	/* bitmap of rows to be re-checked by CPU */
+	memset(KERN_GPUSCAN_RECHECKBUF(&gscan->kern), 0,
+		   KERN_GPUSCAN_RECHECKBUF_LENGTH(&gscan->kern));
+	/* MVCC snapshot, if any */
+	gscan->kern.snapshot_length = snapshot_length;
+	if (snapshot_length > 0)
+	{
+		kern_snapshot  *ksnap = KERN_GPUSCAN_SNAPSHOT(&gscan->kern);
+
+		ksnap->xmin = snapshot->xmin;
+		ksnap->xmax = snapshot->xmax;
+		ksnap->xcnt = snapshot->xcnt;
+		ksnap->subxcnt = snapshot->subxcnt;
+		ksnap->suboverflowed = snapshot->suboverflowed;
+		memcpy(ksnap->xip, snapshot->xip,
+			   sizeof(TransactionId) * snapshot->xcnt);
+		memcpy(ksnap->xip + snapshot->xcnt, snapshot->subxip,
+			   sizeof(TransactionId) * snapshot->subxcnt);
+	}
 
 	return gscan;
 }
 
+/*
+ * gpuscan_brin_build_ranges
+ *
+ * It runs bitmap scan on the BRIN index, then builds an array of the
+ * candidate block ranges. BRIN index returns all the blocks of the block
+ * range as lossy pages, and unsummarized ranges are always candidates.
+ */
+static void
+gpuscan_brin_build_ranges(GpuTaskState *gts, HeapScanDesc scan)
+{
+	GpuScanBrinState *brin_sstate = gts->brin_sstate;
+	EState		   *estate = gts->css.ss.ps.state;
+	MemoryContext	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+	Relation		index_rel;
+	IndexScanDesc	iscan;
+	TIDBitmap	   *tbm;
+	TBMIterator	   *iterator;
+	TBMIterateResult *tbmres;
+	cl_uint			nrooms = 32;
+	cl_uint			nranges = 0;
+	BlockNumber	   *ranges = palloc(sizeof(BlockNumber) * 2 * nrooms);
+
+	index_rel = index_open(brin_sstate->index_oid, AccessShareLock);
+	iscan = index_beginscan_bitmap(index_rel,
+								   estate->es_snapshot,
+								   brin_sstate->nkeys);
+	index_rescan(iscan, brin_sstate->scan_keys, brin_sstate->nkeys, NULL, 0);
+#if PG_VERSION_NUM < 100000
+	tbm = tbm_create(work_mem * 1024L);
+#else
+	tbm = tbm_create(work_mem * 1024L, NULL);
+#endif
+	index_getbitmap(iscan, tbm);
+	index_endscan(iscan);
+	index_close(index_rel, NoLock);
+
+	iterator = tbm_begin_iterate(tbm);
+	while ((tbmres = tbm_iterate(iterator)) != NULL)
+	{
+		BlockNumber	blkno = tbmres->blockno;
+
+		if (blkno >= scan->rs_nblocks)
+			break;
+		if (nranges > 0 && ranges[2 * nranges - 1] == blkno)
+			ranges[2 * nranges - 1]++;
+		else
+		{
+			if (nranges == nrooms)
+			{
+				nrooms *= 2;
+				ranges = repalloc(ranges, sizeof(BlockNumber) * 2 * nrooms);
+			}
+			ranges[2 * nranges]     = blkno;
+			ranges[2 * nranges + 1] = blkno + 1;
+			nranges++;
+		}
+	}
+	tbm_end_iterate(iterator);
+	tbm_free(tbm);
+
+	brin_sstate->nblocks = scan->rs_nblocks;
+	brin_sstate->nranges = nranges;
+	brin_sstate->ranges = ranges;
+	brin_sstate->is_ready = true;
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * gpuscan_brin_check_block
+ *
+ * It returns true, if the current block of the scan is a candidate of the
+ * BRIN index. Elsewhere, @scan->rs_cblock is advanced to the next candidate
+ * block (or, the end of the blocks reserved by the parallel scan), then
+ * returns false.
+ */
+static bool
+gpuscan_brin_check_block(GpuTaskState *gts, HeapScanDesc scan)
+{
+	GpuScanBrinState *brin_sstate = gts->brin_sstate;
+	BlockNumber		blkno = scan->rs_cblock;
+	BlockNumber		next = InvalidBlockNumber;
+	BlockNumber		nskips;
+	cl_uint			lo, hi;
+
+	if (blkno == InvalidBlockNumber)
+		return true;	/* end of the scan */
+	if (!brin_sstate->is_ready)
+		gpuscan_brin_build_ranges(gts, scan);
+	/* blocks appended after the BRIN index scan */
+	if (blkno >= brin_sstate->nblocks)
+		return true;
+
+	/* find the first range which ends after the current block */
+	lo = 0;
+	hi = brin_sstate->nranges;
+	while (lo < hi)
+	{
+		cl_uint		mid = (lo + hi) / 2;
+
+		if (brin_sstate->ranges[2 * mid + 1] <= blkno)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < brin_sstate->nranges)
+	{
+		if (brin_sstate->ranges[2 * lo] <= blkno)
+			return true;
+		next = brin_sstate->ranges[2 * lo];
+	}
+	else if (scan->rs_nblocks > brin_sstate->nblocks)
+		next = brin_sstate->nblocks;
+
+	if (scan->rs_numblocks != InvalidBlockNumber)
+	{
+		/* parallel scan can skip only the blocks already reserved */
+		Assert(scan->rs_numblocks > 0);
+		if (BlockNumberIsValid(next))
+			nskips = Min(next - blkno, scan->rs_numblocks);
+		else
+			nskips = scan->rs_numblocks;
+		scan->rs_cblock += nskips;
+		scan->rs_numblocks -= nskips;
+		if (scan->rs_cblock >= scan->rs_nblocks)
+			scan->rs_cblock = 0;
+	}
+	else
+	{
+		/* synchronized scan is disabled, so no wrap-around */
+		Assert(scan->rs_startblock == 0);
+		if (BlockNumberIsValid(next))
+			nskips = next - blkno;
+		else
+			nskips = scan->rs_nblocks - blkno;
+		scan->rs_cblock = next;
+	}
+
+	if (gts->task_kind == GpuTaskKind_GpuScan)
+	{
+		GpuScanState   *gss = (GpuScanState *) gts;
+
+		if (gss->gs_rtstat)
+			pg_atomic_add_fetch_u64(&gss->gs_rtstat->nblocks_brin_skipped,
+									nskips);
+	}
+	return false;
+}
+
 /*
  * gpuscan_parallel_nextpage
  *
@@ -2252,6 +2818,8 @@ static pgstrom_data_store *
 gpuscan_parallel_nextpage(HeapScanDesc scan,
 						  GpuContext *gcontext,
 						  Relids ccache_refs,
+						  List *ccache_zone_quals,
+						  bool ccache_nvme_strom,
 						  cl_uint nr_blocks)
 {
 	Relation		relation = scan->rs_rd;
@@ -2386,10 +2954,14 @@ out_unlock:
 	{
 		PG_TRY();
 		{
-			pds_column = pgstrom_ccache_load_chunk(cc_chunk,
-												   gcontext,
-												   relation,
-												   ccache_refs);
+			if (pgstrom_ccache_check_zonemap(cc_chunk,
+											 relation,
+											 ccache_zone_quals))
+				pds_column = pgstrom_ccache_load_chunk(cc_chunk,
+													   gcontext,
+													   relation,
+													   ccache_refs,
+													   ccache_nvme_strom);
 		}
 		PG_CATCH();
 		{
@@ -2398,6 +2970,16 @@ out_unlock:
 		}
 		PG_END_TRY();
 		pgstrom_ccache_put_chunk(cc_chunk);
+
+		/*
+		 * In case when the chunk is skipped by zone-map and no gap blocks
+		 * are reserved, try to pick up the next range.
+		 */
+		if (!pds_column && nr_blocks == 0)
+		{
+			cc_chunk = NULL;
+			goto retry;
+		}
 	}
 	scan->rs_cblock = page;
 	scan->rs_numblocks = nr_blocks;
@@ -2415,6 +2997,8 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 	HeapScanDesc	scan;
 	pgstrom_data_store *pds = NULL;
 	pgstrom_data_store *pds_column = NULL;
+	/* only GpuScan can load ccache chunks using NVMe-Strom right now */
+	bool			ccache_nvme_strom = (gts->task_kind == GpuTaskKind_GpuScan);
 
 	/*
 	 * Setup scan-descriptor, if the scan is not parallel, of if we're
@@ -2424,9 +3008,15 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 	{
 		EState	   *estate = gts->css.ss.ps.state;
 
-		gts->css.ss.ss_currentScanDesc = heap_beginscan(base_rel,
-														estate->es_snapshot,
-														0, NULL);
+		/*
+		 * Synchronized scan is not used with BRIN block filter, because it
+		 * jumps to the next candidate block without wrap-around.
+		 */
+		gts->css.ss.ss_currentScanDesc =
+			heap_beginscan_strat(base_rel,
+								 estate->es_snapshot,
+								 0, NULL,
+								 true, !gts->brin_sstate);
 		/*
 		 * Try to choose NVMe-Strom, if relation is deployed on the supported
 		 * tablespace and expected total i/o size is enough large than cache-
@@ -2486,11 +3076,15 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 				{
 					PG_TRY();
 					{
-						pds_column =
-							pgstrom_ccache_load_chunk(cc_chunk,
-													  gts->gcontext,
-													  scan->rs_rd,
-													  gts->ccache_refs);
+						if (pgstrom_ccache_check_zonemap(cc_chunk,
+														 scan->rs_rd,
+													gts->ccache_zone_quals))
+							pds_column =
+								pgstrom_ccache_load_chunk(cc_chunk,
+														  gts->gcontext,
+														  scan->rs_rd,
+														  gts->ccache_refs,
+														  ccache_nvme_strom);
 					}
 					PG_CATCH();
 					{
@@ -2508,6 +3102,9 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 						ss_report_location(scan->rs_rd, scan->rs_cblock);
 					if (scan->rs_cblock == scan->rs_startblock)
 						scan->rs_cblock = InvalidBlockNumber;
+					/* whole the chunk is skipped by zone-map? */
+					if (!pds_column)
+						continue;
 					break;
 				}
 			}
@@ -2555,12 +3152,18 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 			pds_column = gpuscan_parallel_nextpage(scan,
 												   gts->gcontext,
 												   gts->ccache_refs,
+												   gts->ccache_zone_quals,
+												   ccache_nvme_strom,
 												   nblocks_atonce);
 			/* no more blocks to read? */
 			if (scan->rs_numblocks == 0)
 				break;
 		}
 
+		/* skip blocks which are not candidate of the BRIN index */
+		if (gts->brin_sstate && !gpuscan_brin_check_block(gts, scan))
+			continue;
+
 		/* allocation of row-based PDS on demand */
 		if (!pds)
 		{
@@ -2571,7 +3174,7 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 			else
 				pds = PDS_create_row(gts->gcontext,
 									 RelationGetDescr(base_rel),
-									 pgstrom_chunk_size());
+									 pgstromGpuTaskStateChunkSize(gts));
 			pds->kds.table_oid = RelationGetRelid(base_rel);
 		}
 		/* scan next block */
@@ -2608,9 +3211,33 @@ gpuscanExecScanChunk(GpuTaskState *gts)
 	else if (pds->kds.nitems == 0)
 	{
 		Assert(!BlockNumberIsValid(scan->rs_cblock));
+		PDS_unpin_zero_copy(pds);
 		PDS_release(pds);
 		pds = NULL;
 	}
+	else if (pds->kds.format == KDS_FORMAT_BLOCK &&
+			 pds->nblocks_zcopy > 0)
+	{
+		/*
+		 * Blocks to be copied from the shared buffer by GPU kernel are
+		 * located next to the blocks already loaded, then the blocks to
+		 * be read by NVMe-Strom follows.
+		 */
+		BlockNumber	   *block_nums
+			= (BlockNumber *)KERN_DATA_STORE_BODY(&pds->kds);
+		cl_uint			nr_loaded = (pds->kds.nitems -
+									 pds->nblocks_uncached -
+									 pds->nblocks_zcopy);
+		cl_uint			i;
+
+		if (pds->kds.nitems < pds->kds.nrooms &&
+			pds->nblocks_uncached > 0)
+			memmove(block_nums + (pds->kds.nitems - pds->nblocks_uncached),
+					block_nums + (pds->kds.nrooms - pds->nblocks_uncached),
+					sizeof(BlockNumber) * pds->nblocks_uncached);
+		for (i=0; i < pds->nblocks_zcopy; i++)
+			block_nums[nr_loaded + i] = pds->zcopy_blocks[i].blknum;
+	}
 	else if (pds->kds.format == KDS_FORMAT_BLOCK &&
 			 pds->kds.nitems < pds->kds.nrooms &&
 			 pds->nblocks_uncached > 0)
@@ -2642,53 +3269,157 @@ out:
 static void
 gpuscan_switch_task(GpuTaskState *gts, GpuTask *gtask)
 {
-	GpuScanTask		   *gscan	__attribute__((unused))
-		= (GpuScanTask *) gtask;
+	GpuScanTask		   *gscan = (GpuScanTask *) gtask;
+	pgstrom_data_store *pds_src = gscan->pds_src;
+
+	/*
+	 * If GPU kernel read the blocks on the shared buffer directly, and
+	 * any of them were modified during the execution, we cannot trust
+	 * the result; so whole the chunk goes to CPU fallback.
+	 * CPU fallback and recheck need the source blocks on the host.
+	 */
+	if (pds_src && pds_src->zcopy_blocks)
+	{
+		if (!gscan->task.cpu_fallback && !PDS_check_zero_copy(pds_src))
+		{
+			gscan->task.cpu_fallback = true;
+			gts->num_cpu_fallbacks++;
+		}
+		if (gscan->task.cpu_fallback || gscan->kern.recheck_nitems > 0)
+			PDS_materialize_zero_copy(gts, pds_src);
+		PDS_unpin_zero_copy(pds_src);
+	}
 }
 
 /*
- * gpuscan_next_task
+ * gpuscan_task_nitems
+ *
+ * It returns number of rows the task will return to the upper node.
+ * Rows in CPU fallback or rechecks are not known at this point.
  */
-static GpuTask *
-gpuscan_next_task(GpuTaskState *gts)
+static cl_long
+gpuscan_task_nitems(GpuTask *gtask)
 {
-	GpuScanState	   *gss = (GpuScanState *) gts;
-	GpuScanRuntimeStat *gs_rtstat = gss->gs_rtstat;
-	GpuScanTask		   *gscan;
-	pgstrom_data_store *pds;
-
-	pds = gpuscanExecScanChunk(gts);
-	if (!pds)
-		return NULL;
-	if (pds->kds.format == KDS_FORMAT_COLUMN)
-		pg_atomic_add_fetch_u64(&gs_rtstat->ccache_count, 1);
-	gscan = gpuscan_create_task(gss, pds);
+	GpuScanTask		   *gscan = (GpuScanTask *) gtask;
 
-	return &gscan->task;
+	if (gscan->task.cpu_fallback || gscan->kern.recheck_nitems > 0)
+		return -1;
+	if (gscan->pds_dst)
+		return gscan->pds_dst->kds.nitems;
+	if (gscan->kresults && !gscan->kresults->all_visible)
+		return gscan->kresults->nitems;
+	return -1;
 }
 
 /*
- * gpuscan_next_tuple_fallback - GPU fallback case
+ * gpuscan_gstore_exec_chunk
+ *
+ * It opens the device memory of gstore_fdw, then returns a PDS that has
+ * only the KDS header copied from the device. Whole the gstore_fdw is
+ * processed by one GpuScanTask without DMA of the data.
  */
-static TupleTableSlot *
-gpuscan_next_tuple_fallback(GpuScanState *gss, GpuScanTask *gscan)
+static pgstrom_data_store *
+gpuscan_gstore_exec_chunk(GpuScanState *gss)
 {
-	pgstrom_data_store *pds_src = gscan->pds_src;
-	GpuScanRuntimeStat *gs_rtstat = gss->gs_rtstat;
-	ExprContext		   *econtext = gss->gts.css.ss.ps.ps_ExprContext;
-	TupleTableSlot	   *slot = NULL;
+	GpuContext	   *gcontext = gss->gts.gcontext;
+	Relation		frel = gss->gts.css.ss.ss_currentRelation;
+	pgstrom_data_store *pds;
+	kern_data_store	kds_head;
+	CUdeviceptr		m_deviceptr;
+	size_t			length;
+	CUresult		rc;
 
-retry_next:
-	ExecClearTuple(gss->base_slot);
-	if (!PDS_fetch_tuple(gss->base_slot, pds_src, &gss->gts))
+	if (gss->gstore_done)
 		return NULL;
+	if (gss->m_kds_gstore == 0UL)
+		gss->m_kds_gstore = gstore_fdw_open_device_memory(gcontext, frel,
+														  &gss->gstore_ipcmem);
+	rc = cuCtxPushCurrent(gcontext->cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
+	rc = cuMemcpyDtoH(&kds_head, gss->m_kds_gstore,
+					  offsetof(kern_data_store, colmeta));
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+	Assert(kds_head.format == KDS_FORMAT_COLUMN);
+	length = KERN_DATA_STORE_HEAD_LENGTH(&kds_head);
 
-	ResetExprContext(econtext);
-	econtext->ecxt_scantuple = gss->base_slot;
-
-	/*
-	 * (1) - Evaluation of dev_quals if any
-	 */
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							offsetof(pgstrom_data_store, kds) + length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	pds = (pgstrom_data_store *) m_deviceptr;
+	memset(&pds->chain, 0, sizeof(dlist_node));
+	pds->gcontext = gcontext;
+	pg_atomic_init_u32(&pds->refcnt, 1);
+	pds->nblocks_uncached = 0;
+	pds->filedesc = -1;
+	pds->nblocks_zcopy = 0;
+	pds->zcopy_blocks = NULL;
+	pds->mmap_base = NULL;
+	pds->mmap_length = 0;
+	pds->kds_dev = NULL;
+	rc = cuMemcpyDtoH(&pds->kds, gss->m_kds_gstore, length);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemcpyDtoH: %s", errorText(rc));
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPopCurrent: %s", errorText(rc));
+	gss->gstore_done = true;
+
+	if (pds->kds.nitems == 0)
+	{
+		PDS_release(pds);
+		return NULL;
+	}
+	return pds;
+}
+
+/*
+ * gpuscan_next_task
+ */
+static GpuTask *
+gpuscan_next_task(GpuTaskState *gts)
+{
+	GpuScanState	   *gss = (GpuScanState *) gts;
+	GpuScanRuntimeStat *gs_rtstat = gss->gs_rtstat;
+	GpuScanTask		   *gscan;
+	pgstrom_data_store *pds;
+
+	if (gss->gstore_scan)
+		pds = gpuscan_gstore_exec_chunk(gss);
+	else
+		pds = gpuscanExecScanChunk(gts);
+	if (!pds)
+		return NULL;
+	if (pds->kds.format == KDS_FORMAT_COLUMN && !gss->gstore_scan)
+		pg_atomic_add_fetch_u64(&gs_rtstat->ccache_count, 1);
+	gscan = gpuscan_create_task(gss, pds);
+	if (gss->gstore_scan)
+		gscan->m_kds_gstore = gss->m_kds_gstore;
+
+	return &gscan->task;
+}
+
+/*
+ * gpuscan_exec_fallback - evaluation of dev_quals and projection on CPU
+ * for the tuple on the base_slot. It returns NULL if filtered out.
+ */
+static TupleTableSlot *
+gpuscan_exec_fallback(GpuScanState *gss)
+{
+	GpuScanRuntimeStat *gs_rtstat = gss->gs_rtstat;
+	ExprContext		   *econtext = gss->gts.css.ss.ps.ps_ExprContext;
+	TupleTableSlot	   *slot = NULL;
+
+	ResetExprContext(econtext);
+	econtext->ecxt_scantuple = gss->base_slot;
+
+	/*
+	 * (1) - Evaluation of dev_quals if any
+	 */
 	if (gss->dev_quals)
 	{
 		bool		retval;
@@ -2700,7 +3431,7 @@ retry_next:
 		if (!retval)
 		{
 			pg_atomic_add_fetch_u64(&gs_rtstat->nitems_filtered, 1);
-			goto retry_next;
+			return NULL;
 		}
 	}
 
@@ -2726,6 +3457,87 @@ retry_next:
 	return slot;
 }
 
+/*
+ * gpuscan_next_tuple_fallback - GPU fallback case
+ */
+static TupleTableSlot *
+gpuscan_next_tuple_fallback(GpuScanState *gss, GpuScanTask *gscan)
+{
+	pgstrom_data_store *pds_src = gscan->pds_src;
+	TupleTableSlot	   *slot;
+
+	do {
+		ExecClearTuple(gss->base_slot);
+		if (!PDS_fetch_tuple(gss->base_slot, pds_src, &gss->gts))
+			return NULL;
+		slot = gpuscan_exec_fallback(gss);
+	} while (!slot);
+
+	return slot;
+}
+
+/*
+ * gpuscan_next_tuple_recheck - rows marked on the recheck bitmap by GPU
+ */
+static TupleTableSlot *
+gpuscan_next_tuple_recheck(GpuScanState *gss, GpuScanTask *gscan)
+{
+	kern_data_store	   *kds_src = &gscan->pds_src->kds;
+	kern_gpuscan	   *kgpuscan = &gscan->kern;
+	cl_uint			   *bitmap = KERN_GPUSCAN_RECHECKBUF(kgpuscan);
+	HeapTuple			tuple = &gss->scan_tuple;
+	TupleTableSlot	   *slot = NULL;
+
+	if (kgpuscan->recheck_nitems == 0)
+		return NULL;
+	while (!slot && gscan->recheck_index < kgpuscan->recheck_nbits)
+	{
+		cl_uint		bit = gscan->recheck_index++;
+
+		if ((bit & 31) == 0 && bitmap[bit / 32] == 0)
+		{
+			gscan->recheck_index = bit + 32;
+			continue;
+		}
+		if ((bitmap[bit / 32] & (1U << (bit & 31))) == 0)
+			continue;
+
+		if (kds_src->format == KDS_FORMAT_ROW)
+		{
+			kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(kds_src, bit);
+
+			tuple->t_data = &tupitem->htup;
+			tuple->t_self = tupitem->t_self;
+			tuple->t_len  = tupitem->t_len;
+		}
+		else
+		{
+			cl_uint		block_id = bit / kgpuscan->recheck_width;
+			cl_uint		line_no = bit % kgpuscan->recheck_width;
+			PageHeader	hpage;
+			ItemId		lpp;
+
+			Assert(kds_src->format == KDS_FORMAT_BLOCK);
+			hpage = (PageHeader)KERN_DATA_STORE_BLOCK_PGPAGE(kds_src,
+															 block_id);
+			lpp = PageGetItemId(hpage, line_no + 1);
+			Assert(ItemIdIsNormal(lpp));
+			tuple->t_data = (HeapTupleHeader) PageGetItem(hpage, lpp);
+			tuple->t_len = ItemIdGetLength(lpp);
+			ItemPointerSet(&tuple->t_self,
+						   KERN_DATA_STORE_BLOCK_BLCKNR(kds_src, block_id),
+						   line_no + 1);
+			/* visibility is in-doubt, if not all-visible */
+			if (!PageIsAllVisible(hpage) &&
+				!PDS_recheck_visibility(&gss->gts, tuple))
+				continue;
+		}
+		ExecStoreTuple(tuple, gss->base_slot, InvalidBuffer, false);
+		slot = gpuscan_exec_fallback(gss);
+	}
+	return slot;
+}
+
 /*
  * gpuscan_next_tuple
  */
@@ -2783,6 +3595,8 @@ gpuscan_next_tuple(GpuTaskState *gts)
 			ExecStoreTuple(tuple, slot, InvalidBuffer, false);
 		}
 	}
+	if (!slot && !gscan->task.cpu_fallback)
+		slot = gpuscan_next_tuple_recheck(gss, gscan);
 	return slot;
 }
 
@@ -2798,6 +3612,323 @@ gpuscanRewindScanChunk(GpuTaskState *gts)
 	ExecScanReScan(&gts->css.ss);
 }
 
+/*
+ * gpuscan_writeback_uncached_blocks
+ *
+ * In case of NVMe-Strom, it writes back blocks that are not loaded onto
+ * CPU RAM yet, for CPU fallback or recheck.
+ */
+static void
+gpuscan_writeback_uncached_blocks(GpuScanTask *gscan, CUdeviceptr m_kds_src)
+{
+	pgstrom_data_store *pds_src = gscan->pds_src;
+	void	   *p_dest;
+	size_t		offset;
+	CUresult	rc;
+
+	if (!gscan->with_nvme_strom || pds_src->nblocks_uncached == 0)
+		return;
+
+	/* ccache chunks are located at the tail of KDS_FORMAT_COLUMN */
+	if (pds_src->kds.format == KDS_FORMAT_COLUMN)
+	{
+		offset = (pds_src->kds.length -
+				  (size_t)BLCKSZ * pds_src->nblocks_uncached);
+		p_dest = (char *)&pds_src->kds + offset;
+	}
+	else
+	{
+		p_dest = KERN_DATA_STORE_BLOCK_PGPAGE(&pds_src->kds, 0);
+		offset = (uintptr_t)p_dest - (uintptr_t)&pds_src->kds;
+	}
+	rc = cuMemcpyDtoHAsync(p_dest,
+						   m_kds_src + offset,
+						   pds_src->nblocks_uncached * BLCKSZ,
+						   CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemcpyDtoHAsync: %s", errorText(rc));
+
+	rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+
+	/* Point of synchronization */
+	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventSynchronize: %s", errorText(rc));
+}
+
+/*
+ * gpuscan_writeback_gstore_chunk
+ *
+ * In case of device resident gstore_fdw, pds_src has only KDS header.
+ * So, it copies whole the device image to the host memory for CPU
+ * fallback or recheck.
+ */
+static void
+gpuscan_writeback_gstore_chunk(GpuScanTask *gscan)
+{
+	GpuContext	   *gcontext = GpuWorkerCurrentContext;
+	pgstrom_data_store *pds_src = gscan->pds_src;
+	pgstrom_data_store *pds_new;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+
+	if (gscan->m_kds_gstore == 0UL)
+		return;
+
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							offsetof(pgstrom_data_store,
+									 kds) + pds_src->kds.length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	pds_new = (pgstrom_data_store *) m_deviceptr;
+	memset(&pds_new->chain, 0, sizeof(dlist_node));
+	pds_new->gcontext = gcontext;
+	pg_atomic_init_u32(&pds_new->refcnt, 1);
+	pds_new->nblocks_uncached = 0;
+	pds_new->filedesc = -1;
+	pds_new->nblocks_zcopy = 0;
+	pds_new->zcopy_blocks = NULL;
+	pds_new->mmap_base = NULL;
+	pds_new->mmap_length = 0;
+	pds_new->kds_dev = NULL;
+
+	rc = cuMemcpyDtoH(&pds_new->kds,
+					  gscan->m_kds_gstore,
+					  pds_src->kds.length);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemcpyDtoH: %s", errorText(rc));
+
+	PDS_release(pds_src);
+	gscan->pds_src = pds_new;
+	gscan->m_kds_gstore = 0UL;
+}
+
+/*
+ * gpuscan_unpack_column_store
+ *
+ * KDS_FORMAT_COLUMN of gstore_fdw or ccache may have bit-packed columns,
+ * however, GPU kernels reference the values array by pointer. So, it
+ * constructs a plain image on the device prior to the kernel execution.
+ * Bit-packed columns are expanded by GPU kernel, and others are copied
+ * by DtoD.
+ * It returns 0 if no device memory is available right now.
+ */
+CUdeviceptr
+gpuscan_unpack_column_store(GpuContext *gcontext,
+							CUmodule cuda_module,
+							kern_data_store *kds_head,
+							CUdeviceptr m_kds_src)
+{
+	kern_data_store *kds_dst;
+	CUfunction		kern_unpack;
+	CUdeviceptr		m_kds_dst;
+	size_t			nitems = kds_head->nitems;
+	size_t			head_sz = KERN_DATA_STORE_HEAD_LENGTH(kds_head);
+	size_t			length;
+	size_t			offset;
+	size_t			nbytes;
+	size_t			grid_sz;
+	size_t			block_sz;
+	void		   *kern_args[3];
+	cl_uint			j;
+	CUresult		rc;
+
+	Assert(kds_head->format == KDS_FORMAT_COLUMN && kds_head->has_packed);
+	rc = cuModuleGetFunction(&kern_unpack,
+							 cuda_module,
+							 "gpuscan_unpack_column");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	/* length of the plain image */
+	length = head_sz;
+	for (j=0; j < kds_head->ncols; j++)
+	{
+		kern_colmeta   *cmeta = &kds_head->colmeta[j];
+
+		if (cmeta->va_offset == 0)
+			continue;
+		if (cmeta->attlen < 0)
+			nbytes = MAXALIGN(sizeof(cl_uint) * nitems);
+		else
+			nbytes = MAXALIGN(TYPEALIGN(cmeta->attalign,
+										cmeta->attlen) * nitems);
+		length += nbytes + ((size_t)cmeta->extra_sz << MAXIMUM_ALIGNOF_SHIFT);
+	}
+
+	rc = gpuMemAllocManaged(gcontext,
+							&m_kds_dst,
+							length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+		return 0UL;
+	else if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	kds_dst = (kern_data_store *)m_kds_dst;
+	memcpy(kds_dst, kds_head, head_sz);
+	kds_dst->length = length;
+	kds_dst->has_packed = false;
+
+	offset = head_sz;
+	for (j=0; j < kds_head->ncols; j++)
+	{
+		kern_colmeta   *cmeta = &kds_dst->colmeta[j];
+
+		if (cmeta->va_offset == 0)
+			continue;
+		if (cmeta->attlen < 0)
+			nbytes = MAXALIGN(sizeof(cl_uint) * nitems);
+		else
+			nbytes = MAXALIGN(TYPEALIGN(cmeta->attalign,
+										cmeta->attlen) * nitems);
+		nbytes += ((size_t)cmeta->extra_sz << MAXIMUM_ALIGNOF_SHIFT);
+		if (!cmeta->attpacked)
+		{
+			rc = cuMemcpyDtoDAsync(m_kds_dst + offset,
+								   m_kds_src + ((size_t)cmeta->va_offset
+												<< MAXIMUM_ALIGNOF_SHIFT),
+								   nbytes,
+								   CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuMemcpyDtoDAsync: %s", errorText(rc));
+		}
+		cmeta->va_offset = (offset >> MAXIMUM_ALIGNOF_SHIFT);
+		cmeta->attpacked = false;
+		offset += nbytes;
+	}
+	Assert(offset == length);
+
+	rc = cuMemPrefetchAsync(m_kds_dst,
+							head_sz,
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+	/*
+	 * KERNEL_FUNCTION(void)
+	 * gpuscan_unpack_column(kern_data_store *kds_dst,
+	 *                       kern_data_store *kds_src,
+	 *                       cl_uint colidx)
+	 */
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_unpack,
+							 nitems,
+							 0,
+							 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	for (j=0; j < kds_head->ncols; j++)
+	{
+		if (kds_head->colmeta[j].va_offset == 0 ||
+			!kds_head->colmeta[j].attpacked)
+			continue;
+		kern_args[0] = &m_kds_dst;
+		kern_args[1] = &m_kds_src;
+		kern_args[2] = &j;
+		rc = cuLaunchKernel(kern_unpack,
+							grid_sz, 1, 1,
+							block_sz, 1, 1,
+							0,
+							CU_STREAM_PER_THREAD,
+							kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuLaunchKernel: %s", errorText(rc));
+	}
+	return m_kds_dst;
+}
+
+/*
+ * gpuscan_gather_zero_copy_blocks
+ *
+ * It kicks GPU kernel to copy the all-visible blocks on the shared buffer,
+ * registered as page-locked host memory, to the KDS_FORMAT_BLOCK on the
+ * device memory, instead of memcpy() by CPU. It returns the array of
+ * buffer-ids to be released after the kernel completion, or 0 if no
+ * device memory is available right now.
+ */
+static CUdeviceptr
+gpuscan_gather_zero_copy_blocks(GpuContext *gcontext,
+								CUmodule cuda_module,
+								pgstrom_data_store *pds_src,
+								CUdeviceptr m_kds_src)
+{
+	CUfunction		kern_gather;
+	CUdeviceptr		m_buffers;
+	CUdeviceptr		m_buffer_ids;
+	cl_uint		   *buffer_ids;
+	cl_uint			base_index;
+	cl_uint			nblocks = pds_src->nblocks_zcopy;
+	size_t			grid_sz;
+	size_t			block_sz;
+	void		   *kern_args[5];
+	cl_uint			i;
+	CUresult		rc;
+
+	rc = cuModuleGetFunction(&kern_gather,
+							 cuda_module,
+							 "gpuscan_gather_blocks");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	rc = cuMemHostGetDevicePointer(&m_buffers, BufferBlocks, 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemHostGetDevicePointer: %s", errorText(rc));
+
+	rc = gpuMemAllocManaged(gcontext,
+							&m_buffer_ids,
+							sizeof(cl_uint) * nblocks,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+		return 0UL;
+	else if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAllocManaged: %s", errorText(rc));
+	buffer_ids = (cl_uint *) m_buffer_ids;
+	for (i=0; i < nblocks; i++)
+		buffer_ids[i] = pds_src->zcopy_blocks[i].buffer - 1;
+	base_index = pds_src->kds.nitems - pds_src->nblocks_uncached - nblocks;
+
+	/*
+	 * KERNEL_FUNCTION(void)
+	 * gpuscan_gather_blocks(kern_data_store *kds_src,
+	 *                       char *buffer_blocks,
+	 *                       cl_uint *buffer_ids,
+	 *                       cl_uint base_index,
+	 *                       cl_uint nblocks)
+	 */
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_gather,
+							 0,
+							 0,
+							 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	grid_sz = Min(grid_sz, nblocks);
+	kern_args[0] = &m_kds_src;
+	kern_args[1] = &m_buffers;
+	kern_args[2] = &m_buffer_ids;
+	kern_args[3] = &base_index;
+	kern_args[4] = &nblocks;
+	rc = cuLaunchKernel(kern_gather,
+						grid_sz, 1, 1,
+						block_sz, 1, 1,
+						0,
+						CU_STREAM_PER_THREAD,
+						kern_args,
+						NULL);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuLaunchKernel: %s", errorText(rc));
+
+	return m_buffer_ids;
+}
+
 /*
  * gpuscan_process_task
  */
@@ -2806,12 +3937,15 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 {
 	GpuContext	   *gcontext = GpuWorkerCurrentContext;
 	GpuScanTask	   *gscan = (GpuScanTask *) gtask;
+	GpuTaskState   *gts = gscan->task.gts;
 	pgstrom_data_store *pds_src = gscan->pds_src;
 	pgstrom_data_store *pds_dst = gscan->pds_dst;
 	CUfunction		kern_gpuscan_quals;
 	CUdeviceptr		m_gpuscan = (CUdeviceptr)&gscan->kern;
 	CUdeviceptr		m_kds_src = 0UL;
 	CUdeviceptr		m_kds_dst = (pds_dst ? (CUdeviceptr)&pds_dst->kds : 0UL);
+	CUdeviceptr		m_kds_gstore = gscan->m_kds_gstore;
+	CUdeviceptr		m_buffer_ids = 0UL;
 	const char	   *kern_fname;
 	void		   *kern_args[5];
 	size_t			offset;
@@ -2822,6 +3956,8 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	size_t			nitems_out;
 	size_t			extra_size;
 	CUresult		rc;
+	TimestampTz		tv_launch;
+	uint64			range_id;
 	int				retval = 100001;
 
 	/*
@@ -2851,24 +3987,47 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	 * So, if we cannot allocate i/o mapped device memory, we try to read
 	 * the blocks synchronously then kicks usual RAM->GPU DMA.
 	 */
-	if (pds_src->kds.format != KDS_FORMAT_BLOCK)
-		m_kds_src = (CUdeviceptr)&pds_src->kds;
-	else
+	if (m_kds_gstore != 0UL)
 	{
-		if (gscan->with_nvme_strom)
+		/* gstore_fdw is already resident on the device memory */
+		m_kds_src = m_kds_gstore;
+	}
+	else if (gscan->m_kds_prefetch != 0UL)
+	{
+		/* DMA is already kicked by gpuscan_prefetch_task */
+		Assert(gscan->with_nvme_strom);
+		m_kds_src = gscan->m_kds_prefetch;
+	}
+	else if (gscan->with_nvme_strom)
+	{
+		rc = gpuMemAllocIOMap(gcontext,
+							  &m_kds_src,
+							  pds_src->kds.length);
+		if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+		{
+			PDS_fillup_blocks(pds_src);
+			gscan->with_nvme_strom = false;
+		}
+		else if (rc != CUDA_SUCCESS)
+			werror("failed on gpuMemAllocIOMap: %s", errorText(rc));
+	}
+
+	if (m_kds_src == 0UL)
+	{
+		if (pds_src->kds_dev)
 		{
-			rc = gpuMemAllocIOMap(gcontext,
-								  &m_kds_src,
-								  pds_src->kds.length);
+			/* only referenced columns of the memory-mapped ccache */
+			rc = gpuMemAlloc(gcontext,
+							 &m_kds_src,
+							 pds_src->kds_dev->length);
 			if (rc == CUDA_ERROR_OUT_OF_MEMORY)
-			{
-				PDS_fillup_blocks(pds_src);
-				gscan->with_nvme_strom = false;
-			}
+				goto out_of_resource;
 			else if (rc != CUDA_SUCCESS)
-				werror("failed on gpuMemAllocIOMap: %s", errorText(rc));
+				werror("failed on gpuMemAlloc: %s", errorText(rc));
 		}
-		if (m_kds_src == 0UL)
+		else if (pds_src->kds.format != KDS_FORMAT_BLOCK)
+			m_kds_src = (CUdeviceptr)&pds_src->kds;
+		else
 		{
 			rc = gpuMemAlloc(gcontext,
 							 &m_kds_src,
@@ -2883,6 +4042,8 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	/*
 	 * OK, enqueue a series of requests
 	 */
+	range_id = pgstromNvtxRangeStart(gts, "DMA send");
+	pgstromStatTimingBegin(gts);
 	length = KERN_GPUSCAN_DMASEND_LENGTH(&gscan->kern);
 	rc = cuMemPrefetchAsync((CUdeviceptr)&gscan->kern,
 							length,
@@ -2892,7 +4053,21 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 
 	/* kern_data_store *kds_src */
-	if (pds_src->kds.format != KDS_FORMAT_BLOCK)
+	if (m_kds_gstore != 0UL)
+	{
+		/* no DMA is needed */
+	}
+	else if (gscan->with_nvme_strom)
+	{
+		if (gscan->m_kds_prefetch == 0UL)
+			gpuMemCopyFromSSDAsync(m_kds_src, pds_src, &gscan->dma_state);
+		gpuMemCopyFromSSDWait(m_kds_src, pds_src, &gscan->dma_state);
+	}
+	else if (pds_src->kds_dev)
+	{
+		gpuMemCopyFromMappedColumn(m_kds_src, pds_src);
+	}
+	else if (pds_src->kds.format != KDS_FORMAT_BLOCK)
 	{
 		rc = cuMemPrefetchAsync(m_kds_src,
 								pds_src->kds.length,
@@ -2901,7 +4076,7 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 		if (rc != CUDA_SUCCESS)
 			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 	}
-	else if (!gscan->with_nvme_strom)
+	else if (pds_src->nblocks_zcopy == 0)
 	{
 		rc = cuMemcpyHtoDAsync(m_kds_src,
 							   &pds_src->kds,
@@ -2912,8 +4087,71 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	}
 	else
 	{
-		Assert(pds_src->kds.format == KDS_FORMAT_BLOCK);
-		gpuMemCopyFromSSD(m_kds_src, pds_src);
+		/* skip the blocks to be copied from the shared buffer */
+		cl_uint		nr_loaded = (pds_src->kds.nitems -
+								 pds_src->nblocks_uncached -
+								 pds_src->nblocks_zcopy);
+
+		length = ((char *)KERN_DATA_STORE_BLOCK_PGPAGE(&pds_src->kds,
+													   nr_loaded) -
+				  (char *)&pds_src->kds);
+		rc = cuMemcpyHtoDAsync(m_kds_src,
+							   &pds_src->kds,
+							   length,
+							   CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+		offset = ((char *)KERN_DATA_STORE_BLOCK_PGPAGE(&pds_src->kds,
+													   nr_loaded +
+													   pds_src->nblocks_zcopy) -
+				  (char *)&pds_src->kds);
+		if (offset < pds_src->kds.length)
+		{
+			rc = cuMemcpyHtoDAsync(m_kds_src + offset,
+								   (char *)&pds_src->kds + offset,
+								   pds_src->kds.length - offset,
+								   CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuMemcpyHtoDAsync: %s", errorText(rc));
+		}
+	}
+	pgstromStatDmaSend(gts, (KERN_GPUSCAN_DMASEND_LENGTH(&gscan->kern) +
+							 (m_kds_gstore != 0UL
+							  ? 0 : PDS_DEVICE_KDS_HEAD(pds_src)->length)));
+	pgstromNvtxRangeEnd(range_id);
+
+	/* all-visible blocks on the shared buffer are copied by GPU kernel */
+	if (pds_src->nblocks_zcopy > 0)
+	{
+		m_buffer_ids = gpuscan_gather_zero_copy_blocks(gcontext,
+													   cuda_module,
+													   pds_src,
+													   m_kds_src);
+		if (m_buffer_ids == 0UL)
+			goto out_of_resource;
+	}
+
+	/* bit-packed columns of gstore_fdw or ccache have to be expanded */
+	if (pds_src->kds.format == KDS_FORMAT_COLUMN &&
+		PDS_DEVICE_KDS_HEAD(pds_src)->has_packed)
+	{
+		CUdeviceptr	m_kds_unpack
+			= gpuscan_unpack_column_store(gcontext,
+										  cuda_module,
+										  PDS_DEVICE_KDS_HEAD(pds_src),
+										  m_kds_src);
+		if (m_kds_unpack == 0UL)
+			goto out_of_resource;
+		if (m_kds_src != m_kds_gstore &&
+			m_kds_src != (CUdeviceptr)&pds_src->kds)
+		{
+			/* source image on the device is no longer needed */
+			rc = cuStreamSynchronize(CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuStreamSynchronize: %s", errorText(rc));
+			gpuMemFree(gcontext, m_kds_src);
+		}
+		m_kds_src = m_kds_unpack;
 	}
 
 	/* head of the kds_dst, if any */
@@ -2943,6 +4181,9 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	kern_args[0] = &m_gpuscan;
 	kern_args[1] = &m_kds_src;
 	kern_args[2] = &m_kds_dst;
+	tv_launch = GetCurrentTimestamp();
+	range_id = pgstromNvtxRangeStart(gts, kern_fname);
+	pgstromStatTimingBegin(gts);
 
 	rc = cuLaunchKernel(kern_gpuscan_quals,
 						grid_sz, 1, 1,
@@ -2962,6 +4203,15 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
 	if (rc != CUDA_SUCCESS)
 		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	pgstromStatKernelExec(gts, kern_fname, false);
+	pgstromNvtxRangeEnd(range_id);
+	if (gscan->with_nvme_strom)
+		GpuContextUpdateNvmeStat(gcontext, -1.0,
+								 (double)(GetCurrentTimestamp() - tv_launch));
+	else if (pds_src->kds.format == KDS_FORMAT_ROW)
+		pgstromUpdateChunkKernTime(gscan->task.gts,
+								   pds_src->kds.length,
+								   (double)(GetCurrentTimestamp() - tv_launch));
 
 	/*
 	 * Check GPU kernel status and nitems/usage
@@ -2977,8 +4227,17 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 		GpuScanState	   *gss = (GpuScanState *)gscan->task.gts;
 		GpuScanRuntimeStat *gs_rtstat = gss->gs_rtstat;
 
+		/* rows marked on the recheck bitmap must be on the host memory */
+		if (gscan->kern.recheck_nitems > 0)
+		{
+			gpuscan_writeback_uncached_blocks(gscan, m_kds_src);
+			gpuscan_writeback_gstore_chunk(gscan);
+		}
 		pg_atomic_add_fetch_u64(&gs_rtstat->nitems_filtered,
-								nitems_in - nitems_out);
+								nitems_in - nitems_out -
+								gscan->kern.recheck_nitems);
+		pg_atomic_add_fetch_u64(&gs_rtstat->nitems_rechecked,
+								gscan->kern.recheck_nitems);
 	}
 	else
 	{
@@ -2993,33 +4252,14 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 			 * In case of NVMe-Strom, we have to write-back blocks that are
 			 * not loaded onto CPU RAM yet, for fallback processing.
 			 */
-			if (gscan->with_nvme_strom &&
-				pds_dst->nblocks_uncached > 0)
-			{
-				void  *p_dest = KERN_DATA_STORE_BLOCK_PGPAGE(&pds_src->kds, 0);
-
-				offset = (uintptr_t)p_dest - (uintptr_t)&pds_src->kds;
-				rc = cuMemcpyDtoHAsync(p_dest,
-									   m_kds_src + offset,
-									   pds_src->nblocks_uncached * BLCKSZ,
-									   CU_STREAM_PER_THREAD);
-				if (rc != CUDA_SUCCESS)
-					werror("failed on cuMemcpyDtoHAsync: %s", errorText(rc));
-
-				rc = cuEventRecord(CU_EVENT0_PER_THREAD,
-								   CU_STREAM_PER_THREAD);
-				if (rc != CUDA_SUCCESS)
-					werror("failed on cuEventRecord: %s", errorText(rc));
-
-				/* Point of synchronization */
-				rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
-				if (rc != CUDA_SUCCESS)
-					werror("failed on cuEventSynchronize: %s", errorText(rc));
-			}
+			gpuscan_writeback_uncached_blocks(gscan, m_kds_src);
+			gpuscan_writeback_gstore_chunk(gscan);
 		}
 		goto out_of_resource;
 	}
 
+	range_id = pgstromNvtxRangeStart(gts, "DMA recv");
+	pgstromStatTimingBegin(gts);
 	if (pds_dst)
 	{
 		if (nitems_out > 0)
@@ -3040,6 +4280,8 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 									CU_STREAM_PER_THREAD);
 			if (rc != CUDA_SUCCESS)
 				werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+			pgstromStatDmaRecv(gts, (extra_size + length +
+									 sizeof(cl_uint) * nitems_out));
 		}
 	}
 	else
@@ -3053,13 +4295,21 @@ gpuscan_process_task(GpuTask *gtask, CUmodule cuda_module)
 								CU_STREAM_PER_THREAD);
 		if (rc != CUDA_SUCCESS)
 			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		pgstromStatDmaRecv(gts, offsetof(kern_resultbuf,
+										 results[nitems_out]));
 	}
+	pgstromNvtxRangeEnd(range_id);
 
 out_of_resource:
 	if (retval > 0)
 		wnotice("GpuScan: out of resource");
-	if (pds_src->kds.format == KDS_FORMAT_BLOCK)
+	if (m_buffer_ids != 0UL)
+		gpuMemFree(gcontext, m_buffer_ids);
+	if (m_kds_src != 0UL &&
+		m_kds_src != m_kds_gstore &&
+		m_kds_src != (CUdeviceptr)&pds_src->kds)
 		gpuMemFree(gcontext, m_kds_src);
+	gscan->m_kds_prefetch = 0UL;
 	return retval;
 }
 
@@ -3072,13 +4322,72 @@ gpuscan_release_task(GpuTask *gtask)
 	GpuScanTask	   *gscan = (GpuScanTask *) gtask;
 	GpuTaskState   *gts = gscan->task.gts;
 
+	/* prefetched but not processed; only happen on the worker thread */
+	if (gscan->m_kds_prefetch != 0UL)
+	{
+		Assert(GpuWorkerCurrentContext != NULL);
+		gpuMemCopyFromSSDWait(gscan->m_kds_prefetch,
+							  gscan->pds_src,
+							  &gscan->dma_state);
+		gpuMemFree(gts->gcontext, gscan->m_kds_prefetch);
+		gscan->m_kds_prefetch = 0UL;
+	}
 	if (gscan->pds_src)
+	{
+		PDS_unpin_zero_copy(gscan->pds_src);
 		PDS_release(gscan->pds_src);
+	}
 	if (gscan->pds_dst)
 		PDS_release(gscan->pds_dst);
 	gpuMemFree(gts->gcontext, (CUdeviceptr) gscan);
 }
 
+/*
+ * gpuscan_prefetch_task
+ *
+ * It kicks SSD-to-GPU Direct DMA of the task prior to gpuscan_process_task,
+ * on the GPU worker thread.
+ */
+static bool
+gpuscan_prefetch_task(GpuTask *gtask)
+{
+	GpuScanTask	   *gscan = (GpuScanTask *) gtask;
+	CUdeviceptr		m_kds_src = 0UL;
+	CUresult		rc;
+
+	if (!gscan->with_nvme_strom || gscan->m_kds_prefetch != 0UL)
+		return false;
+	rc = gpuMemAllocIOMap(GpuWorkerCurrentContext,
+						  &m_kds_src,
+						  gscan->pds_src->kds.length);
+	if (rc != CUDA_SUCCESS)
+		return false;	/* gpuscan_process_task will handle it */
+	gscan->m_kds_prefetch = m_kds_src;
+	gpuMemCopyFromSSDAsync(m_kds_src, gscan->pds_src, &gscan->dma_state);
+
+	return true;
+}
+
+/*
+ * gpuscan_async_fallback
+ *
+ * It prepares the GpuScanTask to be processed by CPU, during JIT build.
+ */
+static bool
+gpuscan_async_fallback(GpuTask *gtask)
+{
+	GpuScanTask	   *gscan = (GpuScanTask *) gtask;
+	pgstrom_data_store *pds_src = gscan->pds_src;
+
+	/* blocks to be loaded by NVMe-Strom must be on the host memory */
+	if (pds_src->kds.format == KDS_FORMAT_BLOCK ||
+		pds_src->kds.format == KDS_FORMAT_COLUMN)
+		PDS_fillup_blocks(pds_src);
+	gscan->with_nvme_strom = false;
+
+	return true;
+}
+
 /*
  * pgstrom_init_gpuscan
  */
@@ -3103,6 +4412,51 @@ pgstrom_init_gpuscan(void)
 							 PGC_USERSET,
                              GUC_NOT_IN_SAMPLE,
                              NULL, NULL, NULL);
+	/* pg_strom.enable_brin_filter */
+	DefineCustomBoolVariable("pg_strom.enable_brin_filter",
+							 "Enables to skip heap blocks by BRIN index on GpuScan",
+							 NULL,
+							 &enable_brin_filter,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpuscan_late_materialization */
+	DefineCustomBoolVariable("pg_strom.gpuscan_late_materialization",
+							 "Enables GpuScan to write back only row-offsets, instead of the projected tuples",
+							 NULL,
+							 &enable_late_materialization,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpuscan_mvcc_check */
+	DefineCustomBoolVariable("pg_strom.gpuscan_mvcc_check",
+							 "Enables GpuScan to check visibility of the tuples on GPU, to apply NVMe-Strom on the blocks not all-visible",
+							 NULL,
+							 &pgstrom_gpuscan_mvcc_check,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.heapscan_prefetch */
+	DefineCustomBoolVariable("pg_strom.heapscan_prefetch",
+							 "Enables to prefetch the blocks of the next chunk, if outer scan reads the blocks via shared buffer",
+							 NULL,
+							 &pgstrom_heapscan_prefetch,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpuscan_zero_copy */
+	DefineCustomBoolVariable("pg_strom.gpuscan_zero_copy",
+							 "Enables GpuScan to read all-visible blocks on the shared buffer directly from GPU",
+							 NULL,
+							 &pgstrom_gpuscan_zero_copy,
+							 false,
+							 PGC_SUSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 
 	/* setup path methods */
 	memset(&gpuscan_path_methods, 0, sizeof(gpuscan_path_methods));
@@ -0,0 +1,1056 @@
+/*
+ * gpusort.c
+ *
+ * GPU accelerated top-k sorting for ORDER BY ... LIMIT
+ * ----
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "postgres.h"
+#include "access/nbtree.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
+#include "utils/lsyscache.h"
+#include "utils/ruleutils.h"
+#include "utils/tuplesort.h"
+#include "pg_strom.h"
+#include "cuda_gpusort.h"
+
+static CustomScanMethods	gpusort_scan_methods;
+static CustomExecMethods	gpusort_exec_methods;
+static bool					enable_gpusort;
+static int					gpusort_max_bound;
+
+/* minimum number of rows per partition of gpusort_topk_local */
+#define GPUSORT_MIN_PART_SIZE		2048
+
+typedef struct
+{
+	cl_uint			bound;			/* LIMIT + OFFSET */
+	cl_uint			part_size;		/* rows per partition; 2^N */
+	int				numCols;		/* number of sort-key columns */
+	AttrNumber	   *sortColIdx;		/* attnums of the outer tuple */
+	Oid			   *sortOperators;	/* OIDs of operators to sort them by */
+	Oid			   *collations;		/* OIDs of collations */
+	bool		   *nullsFirst;		/* NULLS FIRST/LAST directions */
+	char		   *kern_source;
+	int				extra_flags;
+	List		   *used_params;	/* referenced Const/Param */
+} GpuSortInfo;
+
+static inline void
+form_gpusort_info(CustomScan *cscan, GpuSortInfo *gs_info)
+{
+	List	   *privs = NIL;
+	List	   *exprs = NIL;
+	List	   *temp;
+	int			i;
+
+	privs = lappend(privs, makeInteger(gs_info->bound));
+	privs = lappend(privs, makeInteger(gs_info->part_size));
+	privs = lappend(privs, makeInteger(gs_info->numCols));
+	/* sortColIdx */
+	temp = NIL;
+	for (i=0; i < gs_info->numCols; i++)
+		temp = lappend(temp, makeInteger(gs_info->sortColIdx[i]));
+	privs = lappend(privs, temp);
+	/* sortOperators */
+	temp = NIL;
+	for (i=0; i < gs_info->numCols; i++)
+		temp = lappend(temp, makeInteger(gs_info->sortOperators[i]));
+	privs = lappend(privs, temp);
+	/* collations */
+	temp = NIL;
+	for (i=0; i < gs_info->numCols; i++)
+		temp = lappend(temp, makeInteger(gs_info->collations[i]));
+	privs = lappend(privs, temp);
+	/* nullsFirst */
+	temp = NIL;
+	for (i=0; i < gs_info->numCols; i++)
+		temp = lappend(temp, makeInteger(gs_info->nullsFirst[i]));
+	privs = lappend(privs, temp);
+	privs = lappend(privs, makeString(gs_info->kern_source));
+	privs = lappend(privs, makeInteger(gs_info->extra_flags));
+	exprs = lappend(exprs, gs_info->used_params);
+
+	cscan->custom_private = privs;
+	cscan->custom_exprs = exprs;
+}
+
+static inline GpuSortInfo *
+deform_gpusort_info(CustomScan *cscan)
+{
+	GpuSortInfo *gs_info = palloc0(sizeof(GpuSortInfo));
+	List	   *privs = cscan->custom_private;
+	List	   *exprs = cscan->custom_exprs;
+	List	   *temp;
+	ListCell   *lc;
+	int			pindex = 0;
+	int			eindex = 0;
+	int			i;
+
+	gs_info->bound = intVal(list_nth(privs, pindex++));
+	gs_info->part_size = intVal(list_nth(privs, pindex++));
+	gs_info->numCols = intVal(list_nth(privs, pindex++));
+	/* sortColIdx */
+	temp = list_nth(privs, pindex++);
+	Assert(list_length(temp) == gs_info->numCols);
+	gs_info->sortColIdx = palloc0(sizeof(AttrNumber) * gs_info->numCols);
+	i = 0;
+	foreach (lc, temp)
+		gs_info->sortColIdx[i++] = intVal(lfirst(lc));
+	/* sortOperators */
+	temp = list_nth(privs, pindex++);
+	Assert(list_length(temp) == gs_info->numCols);
+	gs_info->sortOperators = palloc0(sizeof(Oid) * gs_info->numCols);
+	i = 0;
+	foreach (lc, temp)
+		gs_info->sortOperators[i++] = intVal(lfirst(lc));
+	/* collations */
+	temp = list_nth(privs, pindex++);
+	Assert(list_length(temp) == gs_info->numCols);
+	gs_info->collations = palloc0(sizeof(Oid) * gs_info->numCols);
+	i = 0;
+	foreach (lc, temp)
+		gs_info->collations[i++] = intVal(lfirst(lc));
+	/* nullsFirst */
+	temp = list_nth(privs, pindex++);
+	Assert(list_length(temp) == gs_info->numCols);
+	gs_info->nullsFirst = palloc0(sizeof(bool) * gs_info->numCols);
+	i = 0;
+	foreach (lc, temp)
+		gs_info->nullsFirst[i++] = intVal(lfirst(lc));
+	gs_info->kern_source = strVal(list_nth(privs, pindex++));
+	gs_info->extra_flags = intVal(list_nth(privs, pindex++));
+	gs_info->used_params = list_nth(exprs, eindex++);
+
+	return gs_info;
+}
+
+/*
+ * GpuSortState - state object of GpuSort
+ */
+typedef struct
+{
+	GpuTaskState	gts;
+	cl_uint			bound;
+	cl_uint			part_size;
+	int				numCols;
+	AttrNumber	   *sortColIdx;
+	Oid			   *sortOperators;
+	Oid			   *collations;
+	bool		   *nullsFirst;
+	TupleTableSlot *outer_slot;
+	Tuplesortstate *tuplesort;		/* bounded sort of the candidates */
+	bool			sort_done;
+	/* run-time statistics */
+	cl_ulong		nitems_in;		/* # of rows loaded from the outer */
+	cl_ulong		nitems_out;		/* # of candidates returned by GPU */
+} GpuSortState;
+
+/*
+ * GpuSortTask - a chunk of the outer rows to be reduced to top-k
+ */
+typedef struct
+{
+	GpuTask			task;
+	pgstrom_data_store *pds_src;	/* KDS_FORMAT_ROW */
+	cl_uint			nitems_out;		/* # of candidate rows */
+	cl_uint		   *results;		/* index of the candidate rows */
+	kern_gpusort	kern;
+} GpuSortTask;
+
+/* static functions */
+static Node *CreateGpuSortScanState(CustomScan *cscan);
+static GpuTask *gpusort_next_task(GpuTaskState *gts);
+static int	gpusort_process_task(GpuTask *gtask, CUmodule cuda_module);
+static void gpusort_release_task(GpuTask *gtask);
+
+/*
+ * pgstrom_plan_is_gpusort
+ */
+bool
+pgstrom_plan_is_gpusort(const Plan *plan)
+{
+	if (IsA(plan, CustomScan) &&
+		((CustomScan *) plan)->methods == &gpusort_scan_methods)
+		return true;
+	return false;
+}
+
+/*
+ * gpusort_codegen_keycomp
+ *
+ * STATIC_FUNCTION(cl_int)
+ * gpusort_keycomp(kern_context *kcxt,
+ *                 kern_data_store *kds,
+ *                 cl_uint x_index,
+ *                 cl_uint y_index);
+ */
+static char *
+gpusort_codegen_keycomp(GpuSortInfo *gs_info,
+						List *outer_tlist,
+						codegen_context *context)
+{
+	StringInfoData	kern;
+	int				i;
+
+	initStringInfo(&kern);
+	appendStringInfoString(
+		&kern,
+		"STATIC_FUNCTION(cl_int)\n"
+		"gpusort_keycomp(kern_context *kcxt,\n"
+		"                kern_data_store *kds,\n"
+		"                cl_uint x_index,\n"
+		"                cl_uint y_index)\n"
+		"{\n"
+		"  HeapTupleHeaderData *htup_x = kern_get_tuple_row(kds, x_index);\n"
+		"  HeapTupleHeaderData *htup_y = kern_get_tuple_row(kds, y_index);\n"
+		"  pg_anytype_t KVAR_X  __attribute__((unused));\n"
+		"  pg_anytype_t KVAR_Y  __attribute__((unused));\n"
+		"  void       *addr;\n"
+		"  pg_int4_t   comp;\n\n"
+		"  assert(kds->format == KDS_FORMAT_ROW);\n\n");
+
+	for (i=0; i < gs_info->numCols; i++)
+	{
+		AttrNumber	colidx = gs_info->sortColIdx[i];
+		TargetEntry *tle = get_tle_by_resno(outer_tlist, colidx);
+		Oid			sort_type = exprType((Node *) tle->expr);
+		Oid			opfamily;
+		Oid			opcintype;
+		int16		strategy;
+		devtype_info *dtype;
+		devfunc_info *dfunc;
+
+		/* direction of the sorting */
+		if (!get_ordering_op_properties(gs_info->sortOperators[i],
+										&opfamily,
+										&opcintype,
+										&strategy))
+			elog(ERROR, "operator %u is not a valid ordering operator",
+				 gs_info->sortOperators[i]);
+
+		dtype = pgstrom_devtype_lookup_and_track(sort_type, context);
+		if (!dtype)
+			elog(ERROR, "device type %s lookup failed",
+				 format_type_be(sort_type));
+		dfunc = pgstrom_devfunc_lookup_type_compare(dtype,
+													gs_info->collations[i]);
+		if (!dfunc)
+			elog(ERROR, "device type %s has no compare function",
+				 format_type_be(sort_type));
+		pgstrom_devfunc_track(context, dfunc);
+
+		appendStringInfo(
+			&kern,
+			"  /* sort key comparison on the column %d */\n"
+			"  addr = kern_get_datum_tuple(kds->colmeta,htup_x,%d);\n"
+			"  KVAR_X.%s_v = pg_%s_datum_ref(kcxt,addr);\n"
+			"  addr = kern_get_datum_tuple(kds->colmeta,htup_y,%d);\n"
+			"  KVAR_Y.%s_v = pg_%s_datum_ref(kcxt,addr);\n"
+			"  if (!KVAR_X.%s_v.isnull && !KVAR_Y.%s_v.isnull)\n"
+			"  {\n"
+			"    comp = pgfn_%s(kcxt, KVAR_X.%s_v, KVAR_Y.%s_v);\n"
+			"    if (comp.value != 0)\n"
+			"      return %s;\n"
+			"  }\n"
+			"  else if (KVAR_X.%s_v.isnull && !KVAR_Y.%s_v.isnull)\n"
+			"    return %d;\n"
+			"  else if (!KVAR_X.%s_v.isnull && KVAR_Y.%s_v.isnull)\n"
+			"    return %d;\n"
+			"\n",
+			colidx,
+			colidx - 1,
+			dtype->type_name, dtype->type_name,
+			colidx - 1,
+			dtype->type_name, dtype->type_name,
+			dtype->type_name, dtype->type_name,
+			dfunc->func_devname, dtype->type_name, dtype->type_name,
+			strategy == BTGreaterStrategyNumber ? "-comp.value" : "comp.value",
+			dtype->type_name, dtype->type_name,
+			gs_info->nullsFirst[i] ? -1 : 1,
+			dtype->type_name, dtype->type_name,
+			gs_info->nullsFirst[i] ? 1 : -1);
+	}
+	appendStringInfoString(
+		&kern,
+		"  return 0;\n"
+		"}\n");
+
+	return kern.data;
+}
+
+/*
+ * gpusort_post_planner
+ *
+ * It replaces the Sort node under the Limit node by GpuSort, if LIMIT (and
+ * OFFSET) are constant and small enough to keep the top-k rows on the
+ * shared memory. Every chunk of the outer rows is reduced to the top-k
+ * candidates by GPU, then CPU runs a bounded sort on the candidates only.
+ */
+void
+gpusort_post_planner(PlannedStmt *pstmt, Limit *limit)
+{
+	Sort	   *sort = (Sort *) limit->plan.lefttree;
+	Plan	   *subplan;
+	Const	   *con;
+	int64		bound;
+	double		nrows;
+	double		num_chunks;
+	double		gpu_setup_cost;
+	double		gpu_dma_cost;
+	double		gpu_operator_cost;
+	Cost		sort_cost;
+	Cost		gpu_cost;
+	CustomScan *cscan;
+	GpuSortInfo	gs_info;
+	codegen_context context;
+	ListCell   *lc;
+	int			i;
+
+	/* nothing to do, if feature is turned off */
+	if (!pgstrom_enabled || !enable_gpusort)
+		return;
+	Assert(IsA(sort, Sort));
+	subplan = outerPlan(sort);
+	if (sort->plan.qual != NIL || !subplan)
+		return;
+
+	/* LIMIT and OFFSET must be constant */
+	con = (Const *) limit->limitCount;
+	if (!con || !IsA(con, Const) || con->constisnull ||
+		con->consttype != INT8OID)
+		return;
+	bound = DatumGetInt64(con->constvalue);
+	con = (Const *) limit->limitOffset;
+	if (con)
+	{
+		if (!IsA(con, Const) || con->consttype != INT8OID)
+			return;
+		if (!con->constisnull && DatumGetInt64(con->constvalue) > 0)
+			bound += DatumGetInt64(con->constvalue);
+	}
+	if (bound <= 0 || bound > gpusort_max_bound)
+		return;
+
+	/* Sort shall not have projection; all the tlist are simple Var */
+	if (list_length(sort->plan.targetlist) != list_length(subplan->targetlist))
+		return;
+	foreach (lc, sort->plan.targetlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+		Var		   *var = (Var *) tle->expr;
+
+		if (!IsA(var, Var) || var->varno != OUTER_VAR)
+			return;
+	}
+
+	/*
+	 * Sort keys must be device comparable, and the ordering operator must
+	 * be the default btree one, because GPU code compares the keys using
+	 * the type's compare function.
+	 */
+	memset(&gs_info, 0, sizeof(GpuSortInfo));
+	gs_info.numCols = sort->numCols;
+	gs_info.sortColIdx = palloc0(sizeof(AttrNumber) * sort->numCols);
+	for (i=0; i < sort->numCols; i++)
+	{
+		TargetEntry *tle = get_tle_by_resno(sort->plan.targetlist,
+											sort->sortColIdx[i]);
+		Var		   *var;
+		Oid			opfamily;
+		Oid			opcintype;
+		int16		strategy;
+		devtype_info *dtype;
+
+		if (!tle)
+			return;
+		var = (Var *) tle->expr;
+		dtype = pgstrom_devtype_lookup(var->vartype);
+		if (!dtype ||
+			!pgstrom_devfunc_lookup_type_compare(dtype, sort->collations[i]))
+			return;
+		if (!get_ordering_op_properties(sort->sortOperators[i],
+										&opfamily,
+										&opcintype,
+										&strategy) ||
+			opcintype != var->vartype ||
+			get_opfamily_proc(opfamily,
+							  opcintype,
+							  opcintype,
+							  BTORDER_PROC) != dtype->type_cmpfunc)
+			return;
+		/* key on the outer tuple */
+		gs_info.sortColIdx[i] = var->varattno;
+	}
+
+	/*
+	 * Cost estimation; GPU runs bitonic-sorting on every partition with
+	 * log2(part_size) steps, for log(nrows / bound) rounds at most. CPU
+	 * loads the outer rows to the chunks, then sorts the candidates.
+	 */
+	nrows = subplan->plan_rows;
+	if (nrows <= (double) bound)
+		return;		/* no rows to be eliminated */
+	gs_info.bound = bound;
+	gs_info.part_size = Max(GPUSORT_MIN_PART_SIZE,
+							1U << get_next_log2(2 * gs_info.bound));
+
+	pgstrom_gpu_cost_factors(&gpu_setup_cost,
+							 &gpu_dma_cost,
+							 &gpu_operator_cost);
+	num_chunks = ceil(nrows * (double) subplan->plan_width /
+					  (double) pgstrom_chunk_size());
+	gpu_cost = (gpu_setup_cost +
+				gpu_dma_cost * num_chunks +
+				cpu_operator_cost * nrows +
+				gpu_operator_cost * sort->numCols * nrows *
+				log2(gs_info.part_size) * log2(gs_info.part_size) +
+				2.0 * cpu_operator_cost * sort->numCols *
+				num_chunks * bound * log2(2.0 * bound));
+	sort_cost = sort->plan.total_cost - subplan->total_cost;
+	elog(DEBUG1,
+		 "GpuSort (cost=%.2f) has%sadvantage to Sort (cost=%.2f)",
+		 gpu_cost, gpu_cost >= sort_cost ? " no " : " ", sort_cost);
+	if (gpu_cost >= sort_cost)
+		return;
+
+	/*
+	 * OK, let's construct a GpuSort node. Its custom_scan_tlist is
+	 * identical to the outer tlist, so the candidate rows fetched from
+	 * the KDS_FORMAT_ROW can be returned as scan tuples.
+	 */
+	cscan = makeNode(CustomScan);
+	cscan->scan.plan.plan_node_id = sort->plan.plan_node_id;
+	cscan->scan.plan.startup_cost = subplan->total_cost + gpu_cost;
+	cscan->scan.plan.total_cost = (cscan->scan.plan.startup_cost +
+								   cpu_operator_cost * bound);
+	cscan->scan.plan.plan_rows = sort->plan.plan_rows;
+	cscan->scan.plan.plan_width = sort->plan.plan_width;
+	cscan->scan.plan.targetlist = NIL;
+	cscan->scan.plan.initPlan = sort->plan.initPlan;
+	cscan->scan.scanrelid = 0;
+	cscan->custom_scan_tlist = NIL;
+	cscan->custom_relids = NULL;
+	cscan->methods = &gpusort_scan_methods;
+	foreach (lc, sort->plan.targetlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+		Var		   *var = copyObject(tle->expr);
+
+		var->varno = INDEX_VAR;
+		cscan->scan.plan.targetlist =
+			lappend(cscan->scan.plan.targetlist,
+					makeTargetEntry((Expr *) var,
+									tle->resno,
+									tle->resname,
+									tle->resjunk));
+	}
+	foreach (lc, subplan->targetlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+		Var		   *var;
+
+		var = makeVar(OUTER_VAR,
+					  tle->resno,
+					  exprType((Node *) tle->expr),
+					  exprTypmod((Node *) tle->expr),
+					  exprCollation((Node *) tle->expr),
+					  0);
+		cscan->custom_scan_tlist =
+			lappend(cscan->custom_scan_tlist,
+					makeTargetEntry((Expr *) var,
+									tle->resno,
+									tle->resname,
+									false));
+	}
+	outerPlan(cscan) = subplan;
+
+	gs_info.sortOperators = sort->sortOperators;
+	gs_info.collations = sort->collations;
+	gs_info.nullsFirst = sort->nullsFirst;
+	pgstrom_init_codegen_context(&context);
+	gs_info.kern_source = gpusort_codegen_keycomp(&gs_info,
+												  subplan->targetlist,
+												  &context);
+	gs_info.extra_flags = context.extra_flags | DEVKERNEL_NEEDS_GPUSORT;
+	gs_info.used_params = context.used_params;
+	form_gpusort_info(cscan, &gs_info);
+
+	limit->plan.lefttree = &cscan->scan.plan;
+}
+
+/*
+ * CreateGpuSortScanState
+ */
+static Node *
+CreateGpuSortScanState(CustomScan *cscan)
+{
+	/* see the comment at CreateGpuPreAggScanState */
+	GpuSortState   *gss = MemoryContextAllocZero(CurTransactionContext,
+												 sizeof(GpuSortState));
+	/* Set tag and executor callbacks */
+	NodeSetTag(gss, T_CustomScanState);
+	gss->gts.css.flags = cscan->flags;
+	gss->gts.css.methods = &gpusort_exec_methods;
+
+	return (Node *) gss;
+}
+
+/*
+ * ExecInitGpuSort
+ */
+static void
+ExecInitGpuSort(CustomScanState *node, EState *estate, int eflags)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	GpuSortInfo	   *gs_info = deform_gpusort_info(cscan);
+	PlanState	   *outer_ps;
+	StringInfoData	kern_define;
+	bool			explain_only = ((eflags & EXEC_FLAG_EXPLAIN_ONLY) != 0);
+
+	Assert(outerPlan(cscan) != NULL);
+	/* GpuSort returns the candidates only once; see gpusort_post_planner */
+	if ((eflags & EXEC_FLAG_BACKWARD) != 0)
+		elog(ERROR, "GpuSort does not support backward scan");
+	/* activate a GpuContext for CUDA kernel execution */
+	gss->gts.gcontext = AllocGpuContext(-1, false);
+	if (!explain_only)
+		ActivateGpuContext(gss->gts.gcontext);
+
+	/* setup common GpuTaskState fields */
+	pgstromInitGpuTaskState(&gss->gts,
+							gss->gts.gcontext,
+							GpuTaskKind_GpuSort,
+							NIL,
+							gs_info->used_params,
+							estate);
+	gss->gts.cb_next_task    = gpusort_next_task;
+	gss->gts.cb_process_task = gpusort_process_task;
+	gss->gts.cb_release_task = gpusort_release_task;
+
+	gss->bound         = gs_info->bound;
+	gss->part_size     = gs_info->part_size;
+	gss->numCols       = gs_info->numCols;
+	gss->sortColIdx    = gs_info->sortColIdx;
+	gss->sortOperators = gs_info->sortOperators;
+	gss->collations    = gs_info->collations;
+	gss->nullsFirst    = gs_info->nullsFirst;
+
+	/* initialization of the outer relation; no random access is needed */
+	outer_ps = ExecInitNode(outerPlan(cscan), estate,
+							eflags & ~(EXEC_FLAG_REWIND |
+									   EXEC_FLAG_BACKWARD |
+									   EXEC_FLAG_MARK));
+	outerPlanState(gss) = outer_ps;
+	gss->outer_slot = MakeSingleTupleTableSlot(ExecGetResultType(outer_ps));
+
+	/* Get CUDA program and async build if any */
+	initStringInfo(&kern_define);
+	pgstrom_build_session_info(&kern_define,
+							   &gss->gts,
+							   gs_info->extra_flags);
+	gss->gts.program_id = pgstrom_create_cuda_program(gss->gts.gcontext,
+													  gs_info->extra_flags,
+													  gs_info->kern_source,
+													  kern_define.data,
+													  false,
+													  explain_only);
+	pfree(kern_define.data);
+}
+
+/*
+ * gpusort_create_task
+ */
+static GpuTask *
+gpusort_create_task(GpuSortState *gss, pgstrom_data_store *pds_src)
+{
+	GpuContext	   *gcontext = gss->gts.gcontext;
+	GpuSortTask	   *gsort;
+	size_t			head_sz;
+	size_t			length;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+
+	head_sz = (STROMALIGN(offsetof(GpuSortTask, kern.kparams)) +
+			   STROMALIGN(gss->gts.kern_params->length));
+	length = head_sz + STROMALIGN(sizeof(cl_uint) * gss->bound);
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	gsort = (GpuSortTask *) m_deviceptr;
+	memset(gsort, 0, (offsetof(GpuSortTask, kern) +
+					  offsetof(kern_gpusort, kparams)));
+	pgstromInitGpuTask(&gss->gts, &gsort->task);
+	gsort->pds_src = pds_src;
+	gsort->results = (cl_uint *)((char *)gsort + head_sz);
+	gsort->kern.bound = gss->bound;
+	gsort->kern.part_size = gss->part_size;
+	memcpy(KERN_GPUSORT_PARAMBUF(&gsort->kern),
+		   gss->gts.kern_params,
+		   gss->gts.kern_params->length);
+
+	return &gsort->task;
+}
+
+/*
+ * gpusort_next_task - loads the outer rows onto a chunk
+ */
+static GpuTask *
+gpusort_next_task(GpuTaskState *gts)
+{
+	GpuSortState   *gss = (GpuSortState *) gts;
+	PlanState	   *outer_ps = outerPlanState(gss);
+	TupleDesc		tupdesc = ExecGetResultType(outer_ps);
+	pgstrom_data_store *pds = NULL;
+	TupleTableSlot *slot;
+
+	while (true)
+	{
+		if (gss->gts.scan_overflow)
+		{
+			if (gss->gts.scan_overflow == (void *)(~0UL))
+				break;
+			slot = gss->gts.scan_overflow;
+			gss->gts.scan_overflow = NULL;
+		}
+		else
+		{
+			slot = ExecProcNode(outer_ps);
+			if (TupIsNull(slot))
+			{
+				gss->gts.scan_overflow = (void *)(~0UL);
+				break;
+			}
+		}
+
+		/* create a new data-store on demand */
+		if (!pds)
+		{
+			pds = PDS_create_row(gts->gcontext,
+								 tupdesc,
+								 pgstrom_chunk_size());
+		}
+
+		if (!PDS_insert_tuple(pds, slot))
+		{
+			gss->gts.scan_overflow = slot;
+			break;
+		}
+		gss->nitems_in++;
+	}
+	if (!pds)
+		return NULL;
+	return gpusort_create_task(gss, pds);
+}
+
+/*
+ * gpusort_process_task
+ *
+ * It reduces the rows in the chunk to the top-k candidates by repeated
+ * steps of gpusort_topk_local, then writes back the index of them only.
+ */
+static int
+gpusort_process_task(GpuTask *gtask, CUmodule cuda_module)
+{
+	GpuContext	   *gcontext = GpuWorkerCurrentContext;
+	GpuSortTask	   *gsort = (GpuSortTask *) gtask;
+	GpuTaskState   *gts = gtask->gts;
+	pgstrom_data_store *pds_src = gsort->pds_src;
+	CUfunction		kern_topk_local;
+	CUdeviceptr		m_gpusort = (CUdeviceptr)&gsort->kern;
+	CUdeviceptr		m_kds_src = (CUdeviceptr)&pds_src->kds;
+	CUdeviceptr		m_index = 0UL;
+	CUdeviceptr		m_index_in;
+	CUdeviceptr		m_index_out;
+	cl_uint			bound = gsort->kern.bound;
+	cl_uint			part_size = gsort->kern.part_size;
+	cl_uint			nitems = pds_src->kds.nitems;
+	cl_uint			nitems_max;
+	cl_uint			i;
+	size_t			grid_sz;
+	size_t			block_sz;
+	void		   *kern_args[5];
+	CUresult		rc;
+
+	/* no rows to be eliminated */
+	if (nitems <= bound)
+	{
+		for (i=0; i < nitems; i++)
+			gsort->results[i] = i;
+		gsort->nitems_out = nitems;
+		return 0;
+	}
+
+	rc = cuModuleGetFunction(&kern_topk_local, cuda_module,
+							 "gpusort_topk_local");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	/* two index buffers; the first step shall produce the largest one */
+	nitems_max = KERN_GPUSORT_NITEMS_OUT(nitems, bound, part_size);
+	rc = gpuMemAlloc(gcontext, &m_index,
+					 2 * sizeof(cl_uint) * nitems_max);
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+	{
+		wnotice("GpuSort: out of resource");
+		return 100001;
+	}
+	else if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAlloc: %s", errorText(rc));
+
+	STROM_TRY();
+	{
+		pgstromStatTimingBegin(gts);
+		rc = cuMemPrefetchAsync(m_gpusort,
+								KERN_GPUSORT_LENGTH(&gsort->kern),
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		rc = cuMemPrefetchAsync(m_kds_src,
+								pds_src->kds.length,
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		pgstromStatDmaSend(gts, (KERN_GPUSORT_LENGTH(&gsort->kern) +
+								 pds_src->kds.length));
+
+		/*
+		 * KERNEL_FUNCTION(void)
+		 * gpusort_topk_local(kern_gpusort *kgpusort,
+		 *                    kern_data_store *kds_src,
+		 *                    cl_uint *index_in,
+		 *                    cl_uint *index_out,
+		 *                    cl_uint nitems_in)
+		 */
+		rc = gpuOptimalBlockSize(&grid_sz,
+								 &block_sz,
+								 kern_topk_local,
+								 part_size / 2,
+								 sizeof(cl_uint) * part_size,
+								 0);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+
+		pgstromStatTimingBegin(gts);
+		m_index_in = 0UL;		/* identical index on the first step */
+		m_index_out = m_index;
+		while (nitems > bound)
+		{
+			grid_sz = (nitems + part_size - 1) / part_size;
+			kern_args[0] = &m_gpusort;
+			kern_args[1] = &m_kds_src;
+			kern_args[2] = &m_index_in;
+			kern_args[3] = &m_index_out;
+			kern_args[4] = &nitems;
+			rc = cuLaunchKernel(kern_topk_local,
+								grid_sz, 1, 1,
+								block_sz, 1, 1,
+								sizeof(cl_uint) * part_size,
+								CU_STREAM_PER_THREAD,
+								kern_args,
+								NULL);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuLaunchKernel: %s", errorText(rc));
+			nitems = KERN_GPUSORT_NITEMS_OUT(nitems, bound, part_size);
+			m_index_in = m_index_out;
+			m_index_out = (m_index_out == m_index
+						   ? m_index + sizeof(cl_uint) * nitems_max
+						   : m_index);
+		}
+		pgstromStatKernelExec(gts, "gpusort_topk_local", true);
+
+		/* write back the index of candidates */
+		pgstromStatTimingBegin(gts);
+		rc = cuMemcpyDtoHAsync(gsort->results,
+							   m_index_in,
+							   sizeof(cl_uint) * nitems,
+							   CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemcpyDtoHAsync: %s", errorText(rc));
+		rc = cuMemPrefetchAsync(m_gpusort,
+								offsetof(kern_gpusort, kparams),
+								CU_DEVICE_CPU,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+		rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventRecord: %s", errorText(rc));
+
+		/* Point of synchronization */
+		rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventSynchronize: %s", errorText(rc));
+		pgstromStatDmaRecv(gts, sizeof(cl_uint) * nitems);
+	}
+	STROM_CATCH();
+	{
+		gpuMemFree(gcontext, m_index);
+		STROM_RE_THROW();
+	}
+	STROM_END_TRY();
+	gpuMemFree(gcontext, m_index);
+
+	gsort->nitems_out = nitems;
+	gsort->task.kerror = gsort->kern.kerror;
+	if (pgstrom_cpu_fallback_enabled &&
+		gsort->task.kerror.errcode == StromError_CpuReCheck)
+	{
+		/* all the rows in the chunk are candidates */
+		memset(&gsort->task.kerror, 0, sizeof(kern_errorbuf));
+		gsort->task.cpu_fallback = true;
+		gsort->nitems_out = pds_src->kds.nitems;
+	}
+	return 0;
+}
+
+/*
+ * gpusort_release_task
+ */
+static void
+gpusort_release_task(GpuTask *gtask)
+{
+	GpuSortTask	   *gsort = (GpuSortTask *) gtask;
+	GpuTaskState   *gts = gsort->task.gts;
+
+	if (gsort->pds_src)
+		PDS_release(gsort->pds_src);
+	gpuMemFree(gts->gcontext, (CUdeviceptr) gsort);
+}
+
+/*
+ * gpusort_run_tasks - runs all the GpuSortTasks, then sorts the candidates
+ */
+static void
+gpusort_run_tasks(GpuSortState *gss)
+{
+	TupleTableSlot *slot = gss->outer_slot;
+	HeapTupleData	tuple;
+	GpuTask		   *gtask;
+	cl_uint			i;
+
+	gss->tuplesort = tuplesort_begin_heap(slot->tts_tupleDescriptor,
+										  gss->numCols,
+										  gss->sortColIdx,
+										  gss->sortOperators,
+										  gss->collations,
+										  gss->nullsFirst,
+										  work_mem,
+										  false);
+	tuplesort_set_bound(gss->tuplesort, gss->bound);
+
+	while ((gtask = fetch_next_gputask(&gss->gts)) != NULL)
+	{
+		GpuSortTask	   *gsort = (GpuSortTask *) gtask;
+		kern_data_store *kds = &gsort->pds_src->kds;
+
+		if (gtask->kerror.errcode != StromError_Success)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("GPU kernel error: %s",
+							errorTextKernel(&gtask->kerror))));
+		if (gtask->cpu_fallback)
+			gss->gts.num_cpu_fallbacks++;
+
+		for (i=0; i < gsort->nitems_out; i++)
+		{
+			cl_uint			row_index = (gtask->cpu_fallback
+										 ? i : gsort->results[i]);
+			kern_tupitem   *tup_item = KERN_DATA_STORE_TUPITEM(kds, row_index);
+
+			tuple.t_len = tup_item->t_len;
+			tuple.t_self = tup_item->t_self;
+			tuple.t_tableOid = InvalidOid;
+			tuple.t_data = &tup_item->htup;
+			ExecStoreTuple(&tuple, slot, InvalidBuffer, false);
+			tuplesort_puttupleslot(gss->tuplesort, slot);
+		}
+		gss->nitems_out += gsort->nitems_out;
+		ExecClearTuple(slot);
+		gpusort_release_task(gtask);
+	}
+	tuplesort_performsort(gss->tuplesort);
+	gss->sort_done = true;
+}
+
+/*
+ * gpusort_exec_scan - access method of ExecScan
+ */
+static TupleTableSlot *
+gpusort_exec_scan(CustomScanState *node)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+	TupleTableSlot *slot = gss->gts.css.ss.ss_ScanTupleSlot;
+
+	if (!gss->sort_done)
+		gpusort_run_tasks(gss);
+#if PG_VERSION_NUM < 100000
+	if (!tuplesort_gettupleslot(gss->tuplesort, true, slot, NULL))
+		ExecClearTuple(slot);
+#else
+	if (!tuplesort_gettupleslot(gss->tuplesort, true, false, slot, NULL))
+		ExecClearTuple(slot);
+#endif
+	return slot;
+}
+
+/*
+ * ExecReCheckGpuSort
+ */
+static bool
+ExecReCheckGpuSort(CustomScanState *node, TupleTableSlot *slot)
+{
+	/* GpuSort does not have qualifiers */
+	return true;
+}
+
+/*
+ * ExecGpuSort
+ */
+static TupleTableSlot *
+ExecGpuSort(CustomScanState *node)
+{
+	return ExecScan(&node->ss,
+					(ExecScanAccessMtd) gpusort_exec_scan,
+					(ExecScanRecheckMtd) ExecReCheckGpuSort);
+}
+
+/*
+ * ExecEndGpuSort
+ */
+static void
+ExecEndGpuSort(CustomScanState *node)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gss->gts.gcontext);
+	/* clean up subtree */
+	ExecEndNode(outerPlanState(node));
+
+	if (gss->tuplesort)
+		tuplesort_end(gss->tuplesort);
+	if (gss->outer_slot)
+		ExecDropSingleTupleTableSlot(gss->outer_slot);
+	pgstromReleaseGpuTaskState(&gss->gts);
+}
+
+/*
+ * ExecReScanGpuSort
+ */
+static void
+ExecReScanGpuSort(CustomScanState *node)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gss->gts.gcontext);
+	/* rewind the outer relation */
+	ExecReScan(outerPlanState(gss));
+	gss->gts.scan_done = false;
+	gss->gts.scan_overflow = NULL;
+	/* common rescan handling */
+	pgstromRescanGpuTaskState(&gss->gts);
+	/* candidates must be sorted again */
+	if (gss->tuplesort)
+		tuplesort_end(gss->tuplesort);
+	gss->tuplesort = NULL;
+	gss->sort_done = false;
+}
+
+/*
+ * ExplainGpuSort
+ */
+static void
+ExplainGpuSort(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+	GpuSortState   *gss = (GpuSortState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	List		   *dcontext;
+	List		   *sort_keys = NIL;
+	int				i;
+
+	/* Set up deparsing context */
+	dcontext = set_deparse_context_planstate(es->deparse_cxt,
+											 (Node *)&gss->gts.css.ss.ps,
+											 ancestors);
+	/* Show sort keys */
+	for (i=0; i < gss->numCols; i++)
+	{
+		TargetEntry *tle = get_tle_by_resno(cscan->custom_scan_tlist,
+											gss->sortColIdx[i]);
+
+		sort_keys = lappend(sort_keys,
+							deparse_expression((Node *) tle->expr,
+											   dcontext,
+											   es->verbose,
+											   false));
+	}
+	ExplainPropertyList("Sort Key", sort_keys, es);
+	ExplainPropertyLong("Top-K Bound", gss->bound, es);
+	if (es->analyze)
+		ExplainPropertyLong("GPU Candidates", gss->nitems_out, es);
+	/* other common fields */
+	pgstromExplainGpuTaskState(&gss->gts, es);
+}
+
+/*
+ * pgstrom_init_gpusort - entrypoint of GpuSort
+ */
+void
+pgstrom_init_gpusort(void)
+{
+	/* pg_strom.enable_gpusort */
+	DefineCustomBoolVariable("pg_strom.enable_gpusort",
+							 "Enables the use of GPU top-k sorting for ORDER BY ... LIMIT",
+							 NULL,
+							 &enable_gpusort,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpusort_max_bound */
+	DefineCustomIntVariable("pg_strom.gpusort_max_bound",
+							"Max number of LIMIT + OFFSET rows for GpuSort",
+							NULL,
+							&gpusort_max_bound,
+							1024,
+							1,
+							4096,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	/* initialization of plan method table */
+	memset(&gpusort_scan_methods, 0, sizeof(CustomScanMethods));
+	gpusort_scan_methods.CustomName          = "GpuSort";
+	gpusort_scan_methods.CreateCustomScanState = CreateGpuSortScanState;
+	RegisterCustomScanMethods(&gpusort_scan_methods);
+
+	/* initialization of exec method table */
+	memset(&gpusort_exec_methods, 0, sizeof(CustomExecMethods));
+	gpusort_exec_methods.CustomName          = "GpuSort";
+	gpusort_exec_methods.BeginCustomScan     = ExecInitGpuSort;
+	gpusort_exec_methods.ExecCustomScan      = ExecGpuSort;
+	gpusort_exec_methods.EndCustomScan       = ExecEndGpuSort;
+	gpusort_exec_methods.ReScanCustomScan    = ExecReScanGpuSort;
+	gpusort_exec_methods.ExplainCustomScan   = ExplainGpuSort;
+}
@@ -0,0 +1,1878 @@
+/*
+ * gpuwindow.c
+ *
+ * GPU accelerated window functions on the partitioned and sorted input
+ * ----
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "postgres.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
+#include "utils/lsyscache.h"
+#include "utils/ruleutils.h"
+#include "pg_strom.h"
+#include "cuda_gpuwindow.h"
+
+static CustomScanMethods	gpuwindow_scan_methods;
+static CustomExecMethods	gpuwindow_exec_methods;
+static bool					enable_gpuwindow;
+
+/* max number of rows in the moving frame; ROWS n PRECEDING */
+#define GPUWINDOW_MAX_FRAME_OFFSET		1000000
+
+typedef struct
+{
+	int				numPartCols;	/* number of partition columns */
+	AttrNumber	   *partColIdx;		/* attnums of the outer tuple */
+	Oid			   *partOperators;	/* equality operators of them */
+	int				ordNumCols;		/* number of ordering columns */
+	AttrNumber	   *ordColIdx;		/* attnums of the outer tuple */
+	Oid			   *ordOperators;	/* equality operators of them */
+	int				nfuncs;			/* number of window functions */
+	List		   *func_kinds;		/* GPUWINDOW_FUNC__* */
+	List		   *func_offsets;	/* ROWS n PRECEDING, or -1 if unbounded */
+	char		   *kern_source;
+	int				extra_flags;
+	List		   *used_params;	/* referenced Const/Param */
+} GpuWindowInfo;
+
+static inline void
+form_gpuwindow_info(CustomScan *cscan, GpuWindowInfo *gw_info)
+{
+	List	   *privs = NIL;
+	List	   *exprs = NIL;
+	List	   *temp;
+	int			i;
+
+	privs = lappend(privs, makeInteger(gw_info->numPartCols));
+	/* partColIdx */
+	temp = NIL;
+	for (i=0; i < gw_info->numPartCols; i++)
+		temp = lappend(temp, makeInteger(gw_info->partColIdx[i]));
+	privs = lappend(privs, temp);
+	/* partOperators */
+	temp = NIL;
+	for (i=0; i < gw_info->numPartCols; i++)
+		temp = lappend(temp, makeInteger(gw_info->partOperators[i]));
+	privs = lappend(privs, temp);
+	privs = lappend(privs, makeInteger(gw_info->ordNumCols));
+	/* ordColIdx */
+	temp = NIL;
+	for (i=0; i < gw_info->ordNumCols; i++)
+		temp = lappend(temp, makeInteger(gw_info->ordColIdx[i]));
+	privs = lappend(privs, temp);
+	/* ordOperators */
+	temp = NIL;
+	for (i=0; i < gw_info->ordNumCols; i++)
+		temp = lappend(temp, makeInteger(gw_info->ordOperators[i]));
+	privs = lappend(privs, temp);
+	privs = lappend(privs, makeInteger(gw_info->nfuncs));
+	privs = lappend(privs, gw_info->func_kinds);
+	privs = lappend(privs, gw_info->func_offsets);
+	privs = lappend(privs, makeString(gw_info->kern_source));
+	privs = lappend(privs, makeInteger(gw_info->extra_flags));
+	exprs = lappend(exprs, gw_info->used_params);
+
+	cscan->custom_private = privs;
+	cscan->custom_exprs = exprs;
+}
+
+static inline GpuWindowInfo *
+deform_gpuwindow_info(CustomScan *cscan)
+{
+	GpuWindowInfo *gw_info = palloc0(sizeof(GpuWindowInfo));
+	List	   *privs = cscan->custom_private;
+	List	   *exprs = cscan->custom_exprs;
+	List	   *temp;
+	ListCell   *lc;
+	int			pindex = 0;
+	int			eindex = 0;
+	int			i;
+
+	gw_info->numPartCols = intVal(list_nth(privs, pindex++));
+	/* partColIdx */
+	temp = list_nth(privs, pindex++);
+	Assert(list_length(temp) == gw_info->numPartCols);
+	gw_info->partColIdx = palloc0(sizeof(AttrNumber) * gw_info->numPartCols);
+	i = 0;
+	foreach (lc, temp)
+		gw_info->partColIdx[i++] = intVal(lfirst(lc));
+	/* partOperators */
+	temp = list_nth(privs, pindex++);
+	Assert(list_length(temp) == gw_info->numPartCols);
+	gw_info->partOperators = palloc0(sizeof(Oid) * gw_info->numPartCols);
+	i = 0;
+	foreach (lc, temp)
+		gw_info->partOperators[i++] = intVal(lfirst(lc));
+	gw_info->ordNumCols = intVal(list_nth(privs, pindex++));
+	/* ordColIdx */
+	temp = list_nth(privs, pindex++);
+	Assert(list_length(temp) == gw_info->ordNumCols);
+	gw_info->ordColIdx = palloc0(sizeof(AttrNumber) * gw_info->ordNumCols);
+	i = 0;
+	foreach (lc, temp)
+		gw_info->ordColIdx[i++] = intVal(lfirst(lc));
+	/* ordOperators */
+	temp = list_nth(privs, pindex++);
+	Assert(list_length(temp) == gw_info->ordNumCols);
+	gw_info->ordOperators = palloc0(sizeof(Oid) * gw_info->ordNumCols);
+	i = 0;
+	foreach (lc, temp)
+		gw_info->ordOperators[i++] = intVal(lfirst(lc));
+	gw_info->nfuncs = intVal(list_nth(privs, pindex++));
+	gw_info->func_kinds = list_nth(privs, pindex++);
+	gw_info->func_offsets = list_nth(privs, pindex++);
+	gw_info->kern_source = strVal(list_nth(privs, pindex++));
+	gw_info->extra_flags = intVal(list_nth(privs, pindex++));
+	gw_info->used_params = list_nth(exprs, eindex++);
+
+	return gw_info;
+}
+
+/*
+ * GpuWindowState - state object of GpuWindow
+ */
+typedef struct
+{
+	GpuTaskState	gts;
+	int				numPartCols;
+	AttrNumber	   *partColIdx;
+	FmgrInfo	   *partEqfunctions;
+	int				ordNumCols;
+	AttrNumber	   *ordColIdx;
+	FmgrInfo	   *ordEqfunctions;
+	int				nfuncs;
+	cl_char			func_kinds[GPUWINDOW_MAX_NFUNCS];
+	cl_long			func_offsets[GPUWINDOW_MAX_NFUNCS];
+	Oid				func_types[GPUWINDOW_MAX_NFUNCS];	/* result type */
+	ExprState	   *arg_states[GPUWINDOW_MAX_NFUNCS];	/* for fallback */
+	Oid				arg_types[GPUWINDOW_MAX_NFUNCS];
+	TupleTableSlot *outer_slot;
+	TupleTableSlot *fallback_slot;
+	TupleTableSlot *prev_slot;		/* last row of the previous chunk */
+	ExprContext	   *fallback_econtext;
+
+	/* chunks shall be returned in the order of outer rows */
+	cl_uint			task_seq;		/* sequence number of the next task */
+	cl_uint			emit_seq;		/* sequence number to be returned */
+	List		   *pending_tasks;	/* completed tasks, but not in order */
+	struct GpuWindowTask *curr_task;
+	cl_uint			curr_index;
+
+	/*
+	 * Running state of the current partition. If a partition continues
+	 * from the previous chunk, the window items on the head segment of the
+	 * chunk are adjusted by the carry.
+	 */
+	cl_long			part_nrows;		/* rows in the partition so far */
+	bool			in_head_seg;	/* row continues the previous chunk */
+	bool			head_is_peer;	/* head row is a peer of the last row */
+	kern_windowitem	last_items[GPUWINDOW_MAX_NFUNCS];
+	kern_windowitem	carry_items[GPUWINDOW_MAX_NFUNCS];
+	kern_windowitem *frame_rings[GPUWINDOW_MAX_NFUNCS];
+} GpuWindowState;
+
+/*
+ * GpuWindowTask - a chunk of the outer rows to run window functions
+ */
+typedef struct GpuWindowTask
+{
+	GpuTask			task;
+	cl_uint			seq_no;			/* order of the chunk */
+	pgstrom_data_store *pds_src;	/* KDS_FORMAT_ROW */
+	kern_windowitem *witems;		/* nfuncs x nitems items */
+	cl_char		   *part_head;		/* true, if head of partition */
+	kern_gpuwindow	kern;
+} GpuWindowTask;
+
+/* static functions */
+static Node *CreateGpuWindowScanState(CustomScan *cscan);
+static GpuTask *gpuwindow_next_task(GpuTaskState *gts);
+static int	gpuwindow_process_task(GpuTask *gtask, CUmodule cuda_module);
+static void gpuwindow_release_task(GpuTask *gtask);
+
+/*
+ * gpuwindow_func_kind - GPUWINDOW_FUNC__* of the window function, or 0
+ */
+static int
+gpuwindow_func_kind(WindowFunc *wfunc)
+{
+	const char *func_name;
+	Oid		   *argtypes;
+	int			nargs;
+
+	if (wfunc->aggfilter != NULL ||
+		get_func_namespace(wfunc->winfnoid) != PG_CATALOG_NAMESPACE)
+		return 0;
+	func_name = get_func_name(wfunc->winfnoid);
+	get_func_signature(wfunc->winfnoid, &argtypes, &nargs);
+
+	if (!wfunc->winagg)
+	{
+		if (nargs != 0)
+			return 0;
+		if (strcmp(func_name, "row_number") == 0)
+			return GPUWINDOW_FUNC__ROW_NUMBER;
+		if (strcmp(func_name, "rank") == 0)
+			return GPUWINDOW_FUNC__RANK;
+		if (strcmp(func_name, "dense_rank") == 0)
+			return GPUWINDOW_FUNC__DENSE_RANK;
+	}
+	else if (nargs == 0)
+	{
+		if (strcmp(func_name, "count") == 0 && wfunc->winstar)
+			return GPUWINDOW_FUNC__COUNT;
+	}
+	else if (nargs == 1)
+	{
+		bool	is_int = (argtypes[0] == INT2OID || argtypes[0] == INT4OID);
+		bool	is_fp = (argtypes[0] == FLOAT4OID || argtypes[0] == FLOAT8OID);
+
+		if (strcmp(func_name, "count") == 0)
+			return GPUWINDOW_FUNC__COUNT;
+		if (strcmp(func_name, "sum") == 0)
+			return (is_int ? GPUWINDOW_FUNC__SUM_INT :
+					is_fp  ? GPUWINDOW_FUNC__SUM_FP : 0);
+		if (strcmp(func_name, "avg") == 0)
+			return (is_int ? GPUWINDOW_FUNC__AVG_INT :
+					is_fp  ? GPUWINDOW_FUNC__AVG_FP : 0);
+	}
+	return 0;
+}
+
+/*
+ * gpuwindow_frame_offset
+ *
+ * It returns number of the preceding rows in the frame of aggregate
+ * functions; -1 means UNBOUNDED PRECEDING. Only ROWS frame that ends at
+ * the CURRENT ROW is supported, because the result is calculated by the
+ * difference of the prefix sum. It returns -2, if not supported.
+ */
+static cl_long
+gpuwindow_frame_offset(WindowAgg *wagg)
+{
+	int			frameOptions = wagg->frameOptions;
+	Const	   *con;
+
+	if ((frameOptions & FRAMEOPTION_ROWS) == 0 ||
+		(frameOptions & FRAMEOPTION_END_CURRENT_ROW) == 0)
+		return -2;
+	if ((frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING) != 0)
+		return -1;
+	if ((frameOptions & FRAMEOPTION_START_CURRENT_ROW) != 0)
+		return 0;
+	if ((frameOptions & FRAMEOPTION_START_VALUE_PRECEDING) != 0)
+	{
+		con = (Const *) wagg->startOffset;
+		if (con && IsA(con, Const) &&
+			con->consttype == INT8OID &&
+			!con->constisnull &&
+			DatumGetInt64(con->constvalue) >= 0 &&
+			DatumGetInt64(con->constvalue) <= GPUWINDOW_MAX_FRAME_OFFSET)
+			return DatumGetInt64(con->constvalue);
+	}
+	return -2;
+}
+
+/*
+ * gpuwindow_pull_funcs - pull up window functions of the WindowAgg
+ */
+static bool
+gpuwindow_pull_funcs_walker(Node *node, List **p_window_funcs)
+{
+	if (!node)
+		return false;
+	if (IsA(node, WindowFunc))
+	{
+		*p_window_funcs = list_append_unique(*p_window_funcs, node);
+		return false;
+	}
+	return expression_tree_walker(node, gpuwindow_pull_funcs_walker,
+								  (void *) p_window_funcs);
+}
+
+/*
+ * gpuwindow_replace_tlist_mutator
+ *
+ * It replaces the references to the outer tuple, and the window functions
+ * by the reference to custom_scan_tlist.
+ */
+typedef struct
+{
+	List	   *window_funcs;
+	int			outer_natts;
+} gpuwindow_replace_tlist_context;
+
+static Node *
+gpuwindow_replace_tlist_mutator(Node *node,
+								gpuwindow_replace_tlist_context *context)
+{
+	if (!node)
+		return NULL;
+	if (IsA(node, Var))
+	{
+		Var	   *var = copyObject(node);
+
+		Assert(var->varno == OUTER_VAR);
+		var->varno = INDEX_VAR;
+		return (Node *) var;
+	}
+	if (IsA(node, WindowFunc))
+	{
+		ListCell   *lc;
+		int			k = 0;
+
+		foreach (lc, context->window_funcs)
+		{
+			if (equal(node, lfirst(lc)))
+				return (Node *) makeVar(INDEX_VAR,
+										context->outer_natts + k + 1,
+										exprType(node),
+										exprTypmod(node),
+										exprCollation(node),
+										0);
+			k++;
+		}
+		elog(ERROR, "Bug? window function not found: %s", nodeToString(node));
+	}
+	return expression_tree_mutator(node, gpuwindow_replace_tlist_mutator,
+								   (void *) context);
+}
+
+/*
+ * gpuwindow_check_key
+ *
+ * Partition/ordering keys must be device comparable by the type's compare
+ * function, and the equality operator must be the default one.
+ */
+static bool
+gpuwindow_check_key(List *outer_tlist, AttrNumber colidx, Oid eqop)
+{
+	TargetEntry *tle = get_tle_by_resno(outer_tlist, colidx);
+	Oid			type_oid;
+	TypeCacheEntry *tcache;
+	devtype_info *dtype;
+
+	if (!tle)
+		return false;
+	type_oid = exprType((Node *) tle->expr);
+	dtype = pgstrom_devtype_lookup(type_oid);
+	if (!dtype ||
+		!pgstrom_devfunc_lookup_type_compare(dtype,
+											 exprCollation((Node *)tle->expr)))
+		return false;
+	tcache = lookup_type_cache(type_oid, TYPECACHE_EQ_OPR);
+	if (tcache->eq_opr != eqop)
+		return false;
+	return true;
+}
+
+/*
+ * gpuwindow_codegen_keycomp
+ *
+ * STATIC_FUNCTION(cl_bool)
+ * <func_name>(kern_context *kcxt,
+ *             kern_data_store *kds,
+ *             cl_uint x_index,
+ *             cl_uint y_index);
+ */
+static void
+gpuwindow_codegen_keycomp(StringInfo kern,
+						  const char *func_name,
+						  int numCols,
+						  AttrNumber *colIdx,
+						  List *outer_tlist,
+						  codegen_context *context)
+{
+	int			i;
+
+	appendStringInfo(
+		kern,
+		"STATIC_FUNCTION(cl_bool)\n"
+		"%s(kern_context *kcxt,\n"
+		"   kern_data_store *kds,\n"
+		"   cl_uint x_index,\n"
+		"   cl_uint y_index)\n"
+		"{\n"
+		"  HeapTupleHeaderData *htup_x __attribute__((unused))\n"
+		"    = kern_get_tuple_row(kds, x_index);\n"
+		"  HeapTupleHeaderData *htup_y __attribute__((unused))\n"
+		"    = kern_get_tuple_row(kds, y_index);\n"
+		"  pg_anytype_t KVAR_X  __attribute__((unused));\n"
+		"  pg_anytype_t KVAR_Y  __attribute__((unused));\n"
+		"  void       *addr     __attribute__((unused));\n"
+		"  pg_int4_t   comp     __attribute__((unused));\n\n",
+		func_name);
+
+	for (i=0; i < numCols; i++)
+	{
+		AttrNumber	colidx = colIdx[i];
+		TargetEntry *tle = get_tle_by_resno(outer_tlist, colidx);
+		Oid			key_type = exprType((Node *) tle->expr);
+		devtype_info *dtype;
+		devfunc_info *dfunc;
+
+		dtype = pgstrom_devtype_lookup_and_track(key_type, context);
+		if (!dtype)
+			elog(ERROR, "device type %s lookup failed",
+				 format_type_be(key_type));
+		dfunc = pgstrom_devfunc_lookup_type_compare(dtype,
+										exprCollation((Node *) tle->expr));
+		if (!dfunc)
+			elog(ERROR, "device type %s has no compare function",
+				 format_type_be(key_type));
+		pgstrom_devfunc_track(context, dfunc);
+
+		appendStringInfo(
+			kern,
+			"  /* key comparison on the column %d */\n"
+			"  addr = kern_get_datum_tuple(kds->colmeta,htup_x,%d);\n"
+			"  KVAR_X.%s_v = pg_%s_datum_ref(kcxt,addr);\n"
+			"  addr = kern_get_datum_tuple(kds->colmeta,htup_y,%d);\n"
+			"  KVAR_Y.%s_v = pg_%s_datum_ref(kcxt,addr);\n"
+			"  if (KVAR_X.%s_v.isnull != KVAR_Y.%s_v.isnull)\n"
+			"    return false;\n"
+			"  if (!KVAR_X.%s_v.isnull)\n"
+			"  {\n"
+			"    comp = pgfn_%s(kcxt, KVAR_X.%s_v, KVAR_Y.%s_v);\n"
+			"    if (comp.value != 0)\n"
+			"      return false;\n"
+			"  }\n"
+			"\n",
+			colidx,
+			colidx - 1,
+			dtype->type_name, dtype->type_name,
+			colidx - 1,
+			dtype->type_name, dtype->type_name,
+			dtype->type_name, dtype->type_name,
+			dtype->type_name,
+			dfunc->func_devname, dtype->type_name, dtype->type_name);
+	}
+	appendStringInfoString(
+		kern,
+		"  return true;\n"
+		"}\n\n");
+}
+
+/*
+ * gpuwindow_codegen_setup_items
+ *
+ * STATIC_FUNCTION(void)
+ * gpuwindow_setup_items(kern_context *kcxt,
+ *                       kern_data_store *kds,
+ *                       cl_uint row_index,
+ *                       cl_bool peer_head,
+ *                       kern_windowitem *witems,
+ *                       cl_uint nitems);
+ */
+static void
+gpuwindow_codegen_setup_items(StringInfo kern,
+							  List *window_funcs,
+							  List *func_kinds,
+							  codegen_context *context)
+{
+	StringInfoData	body;
+	ListCell	   *lc1, *lc2;
+	int				k = 0;
+
+	context->used_vars = NIL;
+	context->param_refs = NULL;
+
+	initStringInfo(&body);
+	forboth (lc1, window_funcs,
+			 lc2, func_kinds)
+	{
+		WindowFunc *wfunc = lfirst(lc1);
+		int			func_kind = lfirst_int(lc2);
+		Node	   *arg = (wfunc->args != NIL ? linitial(wfunc->args) : NULL);
+		devtype_info *dtype = NULL;
+
+		appendStringInfo(
+			&body,
+			"  /* window function %d */\n"
+			"  item = witems + (size_t)%d * nitems + row_index;\n"
+			"  memset(item, 0, sizeof(kern_windowitem));\n",
+			k, k);
+		if (arg)
+		{
+			dtype = pgstrom_devtype_lookup_and_track(exprType(arg), context);
+			if (!dtype)
+				elog(ERROR, "device type %s lookup failed",
+					 format_type_be(exprType(arg)));
+			appendStringInfo(
+				&body,
+				"  temp.%s_v = %s;\n",
+				dtype->type_name,
+				pgstrom_codegen_expression(arg, context));
+		}
+
+		switch (func_kind)
+		{
+			case GPUWINDOW_FUNC__ROW_NUMBER:
+				appendStringInfoString(
+					&body,
+					"  item->count = 1;\n");
+				break;
+			case GPUWINDOW_FUNC__RANK:
+				appendStringInfoString(
+					&body,
+					"  item->ival = (peer_head ? row_index : 0);\n"
+					"  item->count = 1;\n");
+				break;
+			case GPUWINDOW_FUNC__DENSE_RANK:
+				appendStringInfoString(
+					&body,
+					"  item->count = (peer_head ? 1 : 0);\n");
+				break;
+			case GPUWINDOW_FUNC__COUNT:
+				if (!arg)
+					appendStringInfoString(
+						&body,
+						"  item->count = 1;\n");
+				else
+					appendStringInfo(
+						&body,
+						"  item->count = (temp.%s_v.isnull ? 0 : 1);\n",
+						dtype->type_name);
+				break;
+			case GPUWINDOW_FUNC__SUM_INT:
+			case GPUWINDOW_FUNC__AVG_INT:
+				Assert(arg != NULL);
+				appendStringInfo(
+					&body,
+					"  if (!temp.%s_v.isnull)\n"
+					"  {\n"
+					"    item->ival = (cl_long)temp.%s_v.value;\n"
+					"    item->count = 1;\n"
+					"  }\n",
+					dtype->type_name,
+					dtype->type_name);
+				break;
+			case GPUWINDOW_FUNC__SUM_FP:
+			case GPUWINDOW_FUNC__AVG_FP:
+				Assert(arg != NULL);
+				appendStringInfo(
+					&body,
+					"  if (!temp.%s_v.isnull)\n"
+					"  {\n"
+					"    item->fval = (cl_double)temp.%s_v.value;\n"
+					"    item->count = 1;\n"
+					"  }\n",
+					dtype->type_name,
+					dtype->type_name);
+				break;
+			default:
+				elog(ERROR, "unexpected window function kind: %d", func_kind);
+		}
+		k++;
+	}
+
+	appendStringInfoString(
+		kern,
+		"STATIC_FUNCTION(void)\n"
+		"gpuwindow_setup_items(kern_context *kcxt,\n"
+		"                      kern_data_store *kds,\n"
+		"                      cl_uint row_index,\n"
+		"                      cl_bool peer_head,\n"
+		"                      kern_windowitem *witems,\n"
+		"                      cl_uint nitems)\n"
+		"{\n"
+		"  HeapTupleHeaderData *htup = kern_get_tuple_row(kds, row_index);\n"
+		"  kern_windowitem *item;\n"
+		"  pg_anytype_t temp    __attribute__((unused));\n"
+		"  void       *addr     __attribute__((unused));\n");
+	pgstrom_codegen_param_declarations(kern, context);
+	foreach (lc1, context->used_vars)
+	{
+		Var		   *var = lfirst(lc1);
+		devtype_info *vtype = pgstrom_devtype_lookup(var->vartype);
+
+		Assert(var->varno == OUTER_VAR && var->varattno > 0);
+		if (!vtype)
+			elog(ERROR, "device type %s lookup failed",
+				 format_type_be(var->vartype));
+		appendStringInfo(
+			kern,
+			"  pg_%s_t KVAR_%u;\n",
+			vtype->type_name, var->varattno);
+	}
+	appendStringInfoChar(kern, '\n');
+	foreach (lc1, context->used_vars)
+	{
+		Var		   *var = lfirst(lc1);
+		devtype_info *vtype = pgstrom_devtype_lookup(var->vartype);
+
+		appendStringInfo(
+			kern,
+			"  addr = kern_get_datum_tuple(kds->colmeta,htup,%d);\n"
+			"  KVAR_%u = pg_%s_datum_ref(kcxt,addr);\n",
+			var->varattno - 1,
+			var->varattno, vtype->type_name);
+	}
+	appendStringInfo(
+		kern,
+		"\n"
+		"%s"
+		"}\n",
+		body.data);
+	pfree(body.data);
+}
+
+/*
+ * gpuwindow_post_planner
+ *
+ * It replaces the WindowAgg node by GpuWindow, if all the window functions
+ * are supported, and the partition/ordering keys are device comparable.
+ * The outer rows are already sorted by the keys, so GPU marks the head of
+ * partitions and peer groups, then runs segmented scan (prefix sum) to
+ * calculate the window functions. CPU connects the partitions across the
+ * chunks, then returns the rows in the original order.
+ */
+void
+gpuwindow_post_planner(PlannedStmt *pstmt, Plan **p_plan)
+{
+	WindowAgg  *wagg = (WindowAgg *) *p_plan;
+	Plan	   *subplan = outerPlan(wagg);
+	List	   *window_funcs = NIL;
+	List	   *func_kinds = NIL;
+	List	   *func_offsets = NIL;
+	cl_long		frame_offset;
+	double		nrows;
+	double		num_chunks;
+	double		gpu_setup_cost;
+	double		gpu_dma_cost;
+	double		gpu_operator_cost;
+	Cost		window_cost;
+	Cost		gpu_cost;
+	CustomScan *cscan;
+	GpuWindowInfo gw_info;
+	gpuwindow_replace_tlist_context rcontext;
+	codegen_context context;
+	ListCell   *lc;
+	int			i;
+
+	/* nothing to do, if feature is turned off */
+	if (!pgstrom_enabled || !enable_gpuwindow)
+		return;
+	Assert(IsA(wagg, WindowAgg));
+	if (wagg->plan.qual != NIL || !subplan)
+		return;
+
+	/* partition and ordering keys */
+	for (i=0; i < wagg->partNumCols; i++)
+	{
+		if (!gpuwindow_check_key(subplan->targetlist,
+								 wagg->partColIdx[i],
+								 wagg->partOperators[i]))
+			return;
+	}
+	for (i=0; i < wagg->ordNumCols; i++)
+	{
+		if (!gpuwindow_check_key(subplan->targetlist,
+								 wagg->ordColIdx[i],
+								 wagg->ordOperators[i]))
+			return;
+	}
+
+	/* window functions of this node */
+	foreach (lc, wagg->plan.targetlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+
+		gpuwindow_pull_funcs_walker((Node *) tle->expr, &window_funcs);
+	}
+	if (window_funcs == NIL ||
+		list_length(window_funcs) > GPUWINDOW_MAX_NFUNCS)
+		return;
+	frame_offset = gpuwindow_frame_offset(wagg);
+	foreach (lc, window_funcs)
+	{
+		WindowFunc *wfunc = lfirst(lc);
+		int			func_kind;
+
+		if (wfunc->winref != wagg->winref ||
+			!pgstrom_device_expression((Expr *) wfunc->args))
+			return;
+		func_kind = gpuwindow_func_kind(wfunc);
+		switch (func_kind)
+		{
+			case GPUWINDOW_FUNC__ROW_NUMBER:
+			case GPUWINDOW_FUNC__RANK:
+			case GPUWINDOW_FUNC__DENSE_RANK:
+				/* frame is not used */
+				func_offsets = lappend_int(func_offsets, -1);
+				break;
+			case GPUWINDOW_FUNC__COUNT:
+			case GPUWINDOW_FUNC__SUM_INT:
+			case GPUWINDOW_FUNC__AVG_INT:
+				if (frame_offset < -1)
+					return;
+				func_offsets = lappend_int(func_offsets, frame_offset);
+				break;
+			case GPUWINDOW_FUNC__SUM_FP:
+			case GPUWINDOW_FUNC__AVG_FP:
+				/* difference of floating-point prefix sum is not exact */
+				if (frame_offset != -1)
+					return;
+				func_offsets = lappend_int(func_offsets, frame_offset);
+				break;
+			default:
+				return;
+		}
+		func_kinds = lappend_int(func_kinds, func_kind);
+	}
+
+	/*
+	 * Cost estimation; GPU compares the keys and runs segmented scan for
+	 * each window function with log2(block size) steps. CPU loads the outer
+	 * rows to the chunks, then connects the partitions across the chunks.
+	 */
+	nrows = subplan->plan_rows;
+	pgstrom_gpu_cost_factors(&gpu_setup_cost,
+							 &gpu_dma_cost,
+							 &gpu_operator_cost);
+	num_chunks = ceil(nrows * (double) subplan->plan_width /
+					  (double) pgstrom_chunk_size());
+	gpu_cost = (gpu_setup_cost +
+				gpu_dma_cost * num_chunks +
+				cpu_operator_cost * nrows +
+				gpu_operator_cost * nrows *
+				(wagg->partNumCols + wagg->ordNumCols +
+				 list_length(window_funcs) * log2(1024.0)) +
+				cpu_operator_cost * nrows * list_length(window_funcs));
+	window_cost = wagg->plan.total_cost - subplan->total_cost;
+	elog(DEBUG1,
+		 "GpuWindow (cost=%.2f) has%sadvantage to WindowAgg (cost=%.2f)",
+		 gpu_cost, gpu_cost >= window_cost ? " no " : " ", window_cost);
+	if (gpu_cost >= window_cost)
+		return;
+
+	/*
+	 * OK, let's construct a GpuWindow node. Its custom_scan_tlist is the
+	 * outer tlist followed by the window functions, and the tlist of the
+	 * WindowAgg is rewritten to reference them.
+	 */
+	cscan = makeNode(CustomScan);
+	cscan->scan.plan.plan_node_id = wagg->plan.plan_node_id;
+	cscan->scan.plan.startup_cost = subplan->startup_cost + gpu_setup_cost;
+	cscan->scan.plan.total_cost = subplan->total_cost + gpu_cost;
+	cscan->scan.plan.plan_rows = wagg->plan.plan_rows;
+	cscan->scan.plan.plan_width = wagg->plan.plan_width;
+	cscan->scan.plan.initPlan = wagg->plan.initPlan;
+	cscan->scan.scanrelid = 0;
+	cscan->custom_scan_tlist = NIL;
+	cscan->custom_relids = NULL;
+	cscan->methods = &gpuwindow_scan_methods;
+	foreach (lc, subplan->targetlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+		Var		   *var;
+
+		var = makeVar(OUTER_VAR,
+					  tle->resno,
+					  exprType((Node *) tle->expr),
+					  exprTypmod((Node *) tle->expr),
+					  exprCollation((Node *) tle->expr),
+					  0);
+		cscan->custom_scan_tlist =
+			lappend(cscan->custom_scan_tlist,
+					makeTargetEntry((Expr *) var,
+									tle->resno,
+									tle->resname,
+									false));
+	}
+	foreach (lc, window_funcs)
+	{
+		cscan->custom_scan_tlist =
+			lappend(cscan->custom_scan_tlist,
+					makeTargetEntry(copyObject(lfirst(lc)),
+									list_length(cscan->custom_scan_tlist) + 1,
+									NULL,
+									false));
+	}
+	rcontext.window_funcs = window_funcs;
+	rcontext.outer_natts = list_length(subplan->targetlist);
+	cscan->scan.plan.targetlist = (List *)
+		gpuwindow_replace_tlist_mutator((Node *) wagg->plan.targetlist,
+										&rcontext);
+	outerPlan(cscan) = subplan;
+
+	memset(&gw_info, 0, sizeof(GpuWindowInfo));
+	gw_info.numPartCols = wagg->partNumCols;
+	gw_info.partColIdx = wagg->partColIdx;
+	gw_info.partOperators = wagg->partOperators;
+	gw_info.ordNumCols = wagg->ordNumCols;
+	gw_info.ordColIdx = wagg->ordColIdx;
+	gw_info.ordOperators = wagg->ordOperators;
+	gw_info.nfuncs = list_length(window_funcs);
+	gw_info.func_kinds = func_kinds;
+	gw_info.func_offsets = func_offsets;
+
+	pgstrom_init_codegen_context(&context);
+	{
+		StringInfoData	kern;
+
+		initStringInfo(&kern);
+		gpuwindow_codegen_keycomp(&kern, "gpuwindow_partition_equal",
+								  wagg->partNumCols, wagg->partColIdx,
+								  subplan->targetlist, &context);
+		gpuwindow_codegen_keycomp(&kern, "gpuwindow_peer_equal",
+								  wagg->ordNumCols, wagg->ordColIdx,
+								  subplan->targetlist, &context);
+		gpuwindow_codegen_setup_items(&kern, window_funcs, func_kinds,
+									  &context);
+		gw_info.kern_source = kern.data;
+	}
+	gw_info.extra_flags = context.extra_flags | DEVKERNEL_NEEDS_GPUWINDOW;
+	gw_info.used_params = context.used_params;
+	form_gpuwindow_info(cscan, &gw_info);
+
+	*p_plan = &cscan->scan.plan;
+}
+
+/*
+ * CreateGpuWindowScanState
+ */
+static Node *
+CreateGpuWindowScanState(CustomScan *cscan)
+{
+	/* see the comment at CreateGpuPreAggScanState */
+	GpuWindowState *gws = MemoryContextAllocZero(CurTransactionContext,
+												 sizeof(GpuWindowState));
+	/* Set tag and executor callbacks */
+	NodeSetTag(gws, T_CustomScanState);
+	gws->gts.css.flags = cscan->flags;
+	gws->gts.css.methods = &gpuwindow_exec_methods;
+
+	return (Node *) gws;
+}
+
+/*
+ * ExecInitGpuWindow
+ */
+static void
+ExecInitGpuWindow(CustomScanState *node, EState *estate, int eflags)
+{
+	GpuWindowState *gws = (GpuWindowState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	GpuWindowInfo  *gw_info = deform_gpuwindow_info(cscan);
+	PlanState	   *outer_ps;
+	TupleDesc		outer_tupdesc;
+	StringInfoData	kern_define;
+	ListCell	   *lc1, *lc2;
+	int				k;
+	bool			explain_only = ((eflags & EXEC_FLAG_EXPLAIN_ONLY) != 0);
+
+	Assert(outerPlan(cscan) != NULL);
+	/* activate a GpuContext for CUDA kernel execution */
+	gws->gts.gcontext = AllocGpuContext(-1, false);
+	if (!explain_only)
+		ActivateGpuContext(gws->gts.gcontext);
+
+	/* setup common GpuTaskState fields */
+	pgstromInitGpuTaskState(&gws->gts,
+							gws->gts.gcontext,
+							GpuTaskKind_GpuWindow,
+							NIL,
+							gw_info->used_params,
+							estate);
+	gws->gts.cb_next_task    = gpuwindow_next_task;
+	gws->gts.cb_process_task = gpuwindow_process_task;
+	gws->gts.cb_release_task = gpuwindow_release_task;
+
+	/* initialization of the outer relation; no random access is needed */
+	outer_ps = ExecInitNode(outerPlan(cscan), estate,
+							eflags & ~(EXEC_FLAG_REWIND |
+									   EXEC_FLAG_BACKWARD |
+									   EXEC_FLAG_MARK));
+	outerPlanState(gws) = outer_ps;
+	outer_tupdesc = ExecGetResultType(outer_ps);
+	gws->outer_slot = MakeSingleTupleTableSlot(outer_tupdesc);
+	gws->fallback_slot = MakeSingleTupleTableSlot(outer_tupdesc);
+	gws->prev_slot = MakeSingleTupleTableSlot(outer_tupdesc);
+	gws->fallback_econtext = CreateExprContext(estate);
+
+	/* partition and ordering keys */
+	gws->numPartCols = gw_info->numPartCols;
+	gws->partColIdx = gw_info->partColIdx;
+	if (gws->numPartCols > 0)
+		gws->partEqfunctions = execTuplesMatchPrepare(gw_info->numPartCols,
+													  gw_info->partOperators);
+	gws->ordNumCols = gw_info->ordNumCols;
+	gws->ordColIdx = gw_info->ordColIdx;
+	if (gws->ordNumCols > 0)
+		gws->ordEqfunctions = execTuplesMatchPrepare(gw_info->ordNumCols,
+													 gw_info->ordOperators);
+
+	/* window functions */
+	gws->nfuncs = gw_info->nfuncs;
+	Assert(gws->nfuncs <= GPUWINDOW_MAX_NFUNCS);
+	k = 0;
+	forboth (lc1, gw_info->func_kinds,
+			 lc2, gw_info->func_offsets)
+	{
+		TargetEntry *tle = list_nth(cscan->custom_scan_tlist,
+									outer_tupdesc->natts + k);
+		WindowFunc *wfunc = (WindowFunc *) tle->expr;
+
+		Assert(IsA(wfunc, WindowFunc));
+		gws->func_kinds[k] = lfirst_int(lc1);
+		gws->func_offsets[k] = lfirst_int(lc2);
+		gws->func_types[k] = wfunc->wintype;
+		if (wfunc->args != NIL)
+		{
+			Expr   *arg = linitial(wfunc->args);
+
+			gws->arg_states[k] = ExecInitExpr(arg, &gws->gts.css.ss.ps);
+			gws->arg_types[k] = exprType((Node *) arg);
+		}
+		if (gws->func_offsets[k] >= 0)
+			gws->frame_rings[k] = palloc0(sizeof(kern_windowitem) *
+										  (gws->func_offsets[k] + 1));
+		k++;
+	}
+
+	/* Get CUDA program and async build if any */
+	initStringInfo(&kern_define);
+	pgstrom_build_session_info(&kern_define,
+							   &gws->gts,
+							   gw_info->extra_flags);
+	gws->gts.program_id = pgstrom_create_cuda_program(gws->gts.gcontext,
+													  gw_info->extra_flags,
+													  gw_info->kern_source,
+													  kern_define.data,
+													  false,
+													  explain_only);
+	pfree(kern_define.data);
+}
+
+/*
+ * gpuwindow_create_task
+ */
+static GpuTask *
+gpuwindow_create_task(GpuWindowState *gws, pgstrom_data_store *pds_src)
+{
+	GpuContext	   *gcontext = gws->gts.gcontext;
+	GpuWindowTask  *gwin;
+	cl_uint			nitems = pds_src->kds.nitems;
+	size_t			head_sz;
+	size_t			items_sz;
+	size_t			length;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+
+	head_sz = (STROMALIGN(offsetof(GpuWindowTask, kern.kparams)) +
+			   STROMALIGN(gws->gts.kern_params->length));
+	items_sz = STROMALIGN(sizeof(kern_windowitem) * gws->nfuncs * nitems);
+	length = head_sz + items_sz + STROMALIGN(sizeof(cl_char) * nitems);
+	rc = gpuMemAllocManaged(gcontext,
+							&m_deviceptr,
+							length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	gwin = (GpuWindowTask *) m_deviceptr;
+	memset(gwin, 0, (offsetof(GpuWindowTask, kern) +
+					 offsetof(kern_gpuwindow, kparams)));
+	pgstromInitGpuTask(&gws->gts, &gwin->task);
+	gwin->seq_no = gws->task_seq++;
+	gwin->pds_src = pds_src;
+	gwin->witems = (kern_windowitem *)((char *)gwin + head_sz);
+	gwin->part_head = (cl_char *)((char *)gwin->witems + items_sz);
+	gwin->kern.nitems = nitems;
+	gwin->kern.nfuncs = gws->nfuncs;
+	memcpy(gwin->kern.func_kinds, gws->func_kinds,
+		   sizeof(cl_char) * gws->nfuncs);
+	memcpy(KERN_GPUWINDOW_PARAMBUF(&gwin->kern),
+		   gws->gts.kern_params,
+		   gws->gts.kern_params->length);
+
+	return &gwin->task;
+}
+
+/*
+ * gpuwindow_next_task - loads the outer rows onto a chunk
+ */
+static GpuTask *
+gpuwindow_next_task(GpuTaskState *gts)
+{
+	GpuWindowState *gws = (GpuWindowState *) gts;
+	PlanState	   *outer_ps = outerPlanState(gws);
+	TupleDesc		tupdesc = ExecGetResultType(outer_ps);
+	pgstrom_data_store *pds = NULL;
+	TupleTableSlot *slot;
+
+	while (true)
+	{
+		if (gws->gts.scan_overflow)
+		{
+			if (gws->gts.scan_overflow == (void *)(~0UL))
+				break;
+			slot = gws->gts.scan_overflow;
+			gws->gts.scan_overflow = NULL;
+		}
+		else
+		{
+			slot = ExecProcNode(outer_ps);
+			if (TupIsNull(slot))
+			{
+				gws->gts.scan_overflow = (void *)(~0UL);
+				break;
+			}
+		}
+
+		/* create a new data-store on demand */
+		if (!pds)
+		{
+			pds = PDS_create_row(gts->gcontext,
+								 tupdesc,
+								 pgstrom_chunk_size());
+		}
+
+		if (!PDS_insert_tuple(pds, slot))
+		{
+			gws->gts.scan_overflow = slot;
+			break;
+		}
+	}
+	if (!pds)
+		return NULL;
+	return gpuwindow_create_task(gws, pds);
+}
+
+/*
+ * gpuwindow_process_task
+ *
+ * It marks the head of partitions and initializes the window items, then
+ * runs segmented scan on them by three steps; scan within the blocks, scan
+ * on the carry of the blocks, then apply the carry.
+ */
+static int
+gpuwindow_process_task(GpuTask *gtask, CUmodule cuda_module)
+{
+	GpuContext	   *gcontext = GpuWorkerCurrentContext;
+	GpuWindowTask  *gwin = (GpuWindowTask *) gtask;
+	GpuTaskState   *gts = gtask->gts;
+	pgstrom_data_store *pds_src = gwin->pds_src;
+	CUfunction		kern_setup;
+	CUfunction		kern_scan_local;
+	CUfunction		kern_scan_carry;
+	CUfunction		kern_scan_final;
+	CUdeviceptr		m_gpuwindow = (CUdeviceptr)&gwin->kern;
+	CUdeviceptr		m_kds_src = (CUdeviceptr)&pds_src->kds;
+	CUdeviceptr		m_witems = (CUdeviceptr)gwin->witems;
+	CUdeviceptr		m_part_head = (CUdeviceptr)gwin->part_head;
+	CUdeviceptr		m_carry = 0UL;
+	CUdeviceptr		m_block_carry;
+	CUdeviceptr		m_block_head;
+	cl_uint			nitems = gwin->kern.nitems;
+	cl_uint			nfuncs = gwin->kern.nfuncs;
+	cl_uint			nblocks;
+	size_t			grid_sz;
+	size_t			block_sz;
+	size_t			scan_block_sz;
+	size_t			items_sz;
+	void		   *kern_args[5];
+	CUresult		rc;
+
+	rc = cuModuleGetFunction(&kern_setup, cuda_module,
+							 "gpuwindow_setup");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_scan_local, cuda_module,
+							 "gpuwindow_scan_local");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_scan_carry, cuda_module,
+							 "gpuwindow_scan_carry");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+	rc = cuModuleGetFunction(&kern_scan_final, cuda_module,
+							 "gpuwindow_scan_final");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	/* carry of the blocks */
+	rc = gpuOptimalBlockSize(NULL,
+							 &scan_block_sz,
+							 kern_scan_local,
+							 nitems,
+							 0, 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	nblocks = (nitems + scan_block_sz - 1) / scan_block_sz;
+	rc = gpuMemAlloc(gcontext, &m_carry,
+					 STROMALIGN(sizeof(kern_windowitem) * nfuncs * nblocks) +
+					 STROMALIGN(sizeof(cl_char) * nblocks));
+	if (rc == CUDA_ERROR_OUT_OF_MEMORY)
+	{
+		wnotice("GpuWindow: out of resource");
+		return 100001;
+	}
+	else if (rc != CUDA_SUCCESS)
+		werror("failed on gpuMemAlloc: %s", errorText(rc));
+	m_block_carry = m_carry;
+	m_block_head = m_carry + STROMALIGN(sizeof(kern_windowitem) *
+										nfuncs * nblocks);
+	items_sz = (STROMALIGN(sizeof(kern_windowitem) * nfuncs * nitems) +
+				STROMALIGN(sizeof(cl_char) * nitems));
+
+	STROM_TRY();
+	{
+		pgstromStatTimingBegin(gts);
+		rc = cuMemPrefetchAsync(m_gpuwindow,
+								KERN_GPUWINDOW_LENGTH(&gwin->kern),
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		rc = cuMemPrefetchAsync(m_kds_src,
+								pds_src->kds.length,
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		pgstromStatDmaSend(gts, (KERN_GPUWINDOW_LENGTH(&gwin->kern) +
+								 pds_src->kds.length));
+
+		/*
+		 * KERNEL_FUNCTION(void)
+		 * gpuwindow_setup(kern_gpuwindow *kgwin,
+		 *                 kern_data_store *kds_src,
+		 *                 kern_windowitem *witems,
+		 *                 cl_char *part_head)
+		 */
+		rc = gpuOptimalBlockSize(&grid_sz,
+								 &block_sz,
+								 kern_setup,
+								 nitems,
+								 0, 0);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+		pgstromStatTimingBegin(gts);
+		kern_args[0] = &m_gpuwindow;
+		kern_args[1] = &m_kds_src;
+		kern_args[2] = &m_witems;
+		kern_args[3] = &m_part_head;
+		rc = cuLaunchKernel(kern_setup,
+							grid_sz, 1, 1,
+							block_sz, 1, 1,
+							0,
+							CU_STREAM_PER_THREAD,
+							kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuLaunchKernel: %s", errorText(rc));
+		pgstromStatKernelExec(gts, "gpuwindow_setup", true);
+
+		/*
+		 * KERNEL_FUNCTION_MAXTHREADS(void)
+		 * gpuwindow_scan_local(kern_gpuwindow *kgwin,
+		 *                      kern_windowitem *witems,
+		 *                      cl_char *part_head,
+		 *                      kern_windowitem *block_carry,
+		 *                      cl_char *block_head)
+		 */
+		pgstromStatTimingBegin(gts);
+		kern_args[0] = &m_gpuwindow;
+		kern_args[1] = &m_witems;
+		kern_args[2] = &m_part_head;
+		kern_args[3] = &m_block_carry;
+		kern_args[4] = &m_block_head;
+		rc = cuLaunchKernel(kern_scan_local,
+							nblocks, 1, 1,
+							scan_block_sz, 1, 1,
+							0,
+							CU_STREAM_PER_THREAD,
+							kern_args,
+							NULL);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuLaunchKernel: %s", errorText(rc));
+		pgstromStatKernelExec(gts, "gpuwindow_scan_local", true);
+
+		if (nblocks > 1)
+		{
+			/*
+			 * KERNEL_FUNCTION(void)
+			 * gpuwindow_scan_carry(kern_gpuwindow *kgwin,
+			 *                      kern_windowitem *block_carry,
+			 *                      cl_char *block_head,
+			 *                      cl_uint nblocks)
+			 */
+			pgstromStatTimingBegin(gts);
+			kern_args[0] = &m_gpuwindow;
+			kern_args[1] = &m_block_carry;
+			kern_args[2] = &m_block_head;
+			kern_args[3] = &nblocks;
+			rc = cuLaunchKernel(kern_scan_carry,
+								1, 1, 1,
+								nfuncs, 1, 1,
+								0,
+								CU_STREAM_PER_THREAD,
+								kern_args,
+								NULL);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuLaunchKernel: %s", errorText(rc));
+			pgstromStatKernelExec(gts, "gpuwindow_scan_carry", true);
+
+			/*
+			 * KERNEL_FUNCTION_MAXTHREADS(void)
+			 * gpuwindow_scan_final(kern_gpuwindow *kgwin,
+			 *                      kern_windowitem *witems,
+			 *                      cl_char *part_head,
+			 *                      kern_windowitem *block_carry)
+			 */
+			pgstromStatTimingBegin(gts);
+			kern_args[0] = &m_gpuwindow;
+			kern_args[1] = &m_witems;
+			kern_args[2] = &m_part_head;
+			kern_args[3] = &m_block_carry;
+			rc = cuLaunchKernel(kern_scan_final,
+								nblocks, 1, 1,
+								scan_block_sz, 1, 1,
+								0,
+								CU_STREAM_PER_THREAD,
+								kern_args,
+								NULL);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuLaunchKernel: %s", errorText(rc));
+			pgstromStatKernelExec(gts, "gpuwindow_scan_final", true);
+		}
+
+		/* write back the window items */
+		pgstromStatTimingBegin(gts);
+		rc = cuMemPrefetchAsync(m_witems,
+								items_sz,
+								CU_DEVICE_CPU,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		rc = cuMemPrefetchAsync(m_gpuwindow,
+								offsetof(kern_gpuwindow, kparams),
+								CU_DEVICE_CPU,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+		rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventRecord: %s", errorText(rc));
+
+		/* Point of synchronization */
+		rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventSynchronize: %s", errorText(rc));
+		pgstromStatDmaRecv(gts, items_sz);
+	}
+	STROM_CATCH();
+	{
+		gpuMemFree(gcontext, m_carry);
+		STROM_RE_THROW();
+	}
+	STROM_END_TRY();
+	gpuMemFree(gcontext, m_carry);
+
+	gwin->task.kerror = gwin->kern.kerror;
+	if (pgstrom_cpu_fallback_enabled &&
+		gwin->task.kerror.errcode == StromError_CpuReCheck)
+	{
+		/* window items shall be built by CPU */
+		memset(&gwin->task.kerror, 0, sizeof(kern_errorbuf));
+		gwin->task.cpu_fallback = true;
+	}
+	return 0;
+}
+
+/*
+ * gpuwindow_release_task
+ */
+static void
+gpuwindow_release_task(GpuTask *gtask)
+{
+	GpuWindowTask  *gwin = (GpuWindowTask *) gtask;
+	GpuTaskState   *gts = gwin->task.gts;
+
+	if (gwin->pds_src)
+		PDS_release(gwin->pds_src);
+	gpuMemFree(gts->gcontext, (CUdeviceptr) gwin);
+}
+
+/*
+ * gpuwindow_fallback_task
+ *
+ * It builds the window items of the chunk by CPU, as GPU kernel doing.
+ */
+static void
+gpuwindow_fallback_task(GpuWindowState *gws, GpuWindowTask *gwin)
+{
+	kern_data_store *kds = &gwin->pds_src->kds;
+	ExprContext	   *econtext = gws->fallback_econtext;
+	TupleTableSlot *slots[2];
+	HeapTupleData	tuple;
+	cl_uint			nitems = gwin->kern.nitems;
+	cl_uint			i;
+	int				k;
+
+	slots[0] = gws->outer_slot;
+	slots[1] = gws->fallback_slot;
+	for (i=0; i < nitems; i++)
+	{
+		TupleTableSlot *slot = slots[i % 2];
+		TupleTableSlot *prev = slots[(i + 1) % 2];
+		kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(kds, i);
+		bool			part_head;
+		bool			peer_head;
+
+		ResetExprContext(econtext);
+		tuple.t_len = tupitem->t_len;
+		tuple.t_self = tupitem->t_self;
+		tuple.t_tableOid = InvalidOid;
+		tuple.t_data = &tupitem->htup;
+		ExecStoreTuple(&tuple, slot, InvalidBuffer, false);
+
+		part_head = (i == 0 ||
+					 (gws->numPartCols > 0 &&
+					  !execTuplesMatch(prev, slot,
+									   gws->numPartCols,
+									   gws->partColIdx,
+									   gws->partEqfunctions,
+									   econtext->ecxt_per_tuple_memory)));
+		peer_head = (part_head ||
+					 (gws->ordNumCols > 0 &&
+					  !execTuplesMatch(prev, slot,
+									   gws->ordNumCols,
+									   gws->ordColIdx,
+									   gws->ordEqfunctions,
+									   econtext->ecxt_per_tuple_memory)));
+		gwin->part_head[i] = part_head;
+
+		econtext->ecxt_outertuple = slot;
+		for (k=0; k < gws->nfuncs; k++)
+		{
+			kern_windowitem *item = &gwin->witems[(size_t)k * nitems + i];
+			Datum		datum = 0;
+			bool		isnull = true;
+
+			memset(item, 0, sizeof(kern_windowitem));
+			if (gws->arg_states[k])
+			{
+#if PG_VERSION_NUM < 100000
+				datum = ExecEvalExpr(gws->arg_states[k], econtext,
+									 &isnull, NULL);
+#else
+				datum = ExecEvalExpr(gws->arg_states[k], econtext, &isnull);
+#endif
+			}
+			switch (gws->func_kinds[k])
+			{
+				case GPUWINDOW_FUNC__ROW_NUMBER:
+					item->count = 1;
+					break;
+				case GPUWINDOW_FUNC__RANK:
+					item->ival = (peer_head ? i : 0);
+					item->count = 1;
+					break;
+				case GPUWINDOW_FUNC__DENSE_RANK:
+					item->count = (peer_head ? 1 : 0);
+					break;
+				case GPUWINDOW_FUNC__COUNT:
+					item->count = (!gws->arg_states[k] || !isnull ? 1 : 0);
+					break;
+				case GPUWINDOW_FUNC__SUM_INT:
+				case GPUWINDOW_FUNC__AVG_INT:
+					if (!isnull)
+					{
+						item->ival = (gws->arg_types[k] == INT2OID
+									  ? DatumGetInt16(datum)
+									  : DatumGetInt32(datum));
+						item->count = 1;
+					}
+					break;
+				case GPUWINDOW_FUNC__SUM_FP:
+				case GPUWINDOW_FUNC__AVG_FP:
+					if (!isnull)
+					{
+						item->fval = (gws->arg_types[k] == FLOAT4OID
+									  ? DatumGetFloat4(datum)
+									  : DatumGetFloat8(datum));
+						item->count = 1;
+					}
+					break;
+				default:
+					elog(ERROR, "unexpected window function kind: %d",
+						 gws->func_kinds[k]);
+			}
+			if (!part_head)
+				gpuwindow_combine_item(gws->func_kinds[k], item - 1, item);
+		}
+	}
+	ResetExprContext(econtext);
+	ExecClearTuple(slots[0]);
+	ExecClearTuple(slots[1]);
+}
+
+/*
+ * gpuwindow_fetch_task - fetch the next chunk in the order of outer rows
+ */
+static GpuWindowTask *
+gpuwindow_fetch_task(GpuWindowState *gws)
+{
+	GpuTask	   *gtask;
+	ListCell   *lc;
+
+	for (;;)
+	{
+		foreach (lc, gws->pending_tasks)
+		{
+			GpuWindowTask  *gwin = lfirst(lc);
+
+			if (gwin->seq_no == gws->emit_seq)
+			{
+				gws->pending_tasks = list_delete_ptr(gws->pending_tasks,
+													 gwin);
+				gws->emit_seq++;
+				return gwin;
+			}
+		}
+		gtask = fetch_next_gputask(&gws->gts);
+		if (!gtask)
+		{
+			Assert(gws->pending_tasks == NIL);
+			return NULL;
+		}
+		if (gtask->kerror.errcode != StromError_Success)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("GPU kernel error: %s",
+							errorTextKernel(&gtask->kerror))));
+		gws->pending_tasks = lappend(gws->pending_tasks, gtask);
+	}
+}
+
+/*
+ * gpuwindow_store_aggregate - result of aggregate function from the item
+ */
+static void
+gpuwindow_store_aggregate(GpuWindowState *gws, int k,
+						  kern_windowitem *item,
+						  Datum *p_value, bool *p_isnull)
+{
+	*p_isnull = false;
+	switch (gws->func_kinds[k])
+	{
+		case GPUWINDOW_FUNC__COUNT:
+			*p_value = Int64GetDatum(item->count);
+			break;
+		case GPUWINDOW_FUNC__SUM_INT:
+			if (item->count == 0)
+				*p_isnull = true;
+			else
+				*p_value = Int64GetDatum(item->ival);
+			break;
+		case GPUWINDOW_FUNC__SUM_FP:
+			if (item->count == 0)
+				*p_isnull = true;
+			else if (gws->func_types[k] == FLOAT4OID)
+				*p_value = Float4GetDatum((float4) item->fval);
+			else
+				*p_value = Float8GetDatum(item->fval);
+			break;
+		case GPUWINDOW_FUNC__AVG_INT:
+			if (item->count == 0)
+				*p_isnull = true;
+			else
+				*p_value = DirectFunctionCall2(numeric_div,
+								DirectFunctionCall1(int8_numeric,
+											Int64GetDatum(item->ival)),
+								DirectFunctionCall1(int8_numeric,
+											Int64GetDatum(item->count)));
+			break;
+		case GPUWINDOW_FUNC__AVG_FP:
+			if (item->count == 0)
+				*p_isnull = true;
+			else
+				*p_value = Float8GetDatum(item->fval / (double) item->count);
+			break;
+		default:
+			elog(ERROR, "unexpected window function kind: %d",
+				 gws->func_kinds[k]);
+	}
+}
+
+/*
+ * gpuwindow_store_row
+ *
+ * It stores the outer row and results of the window functions on the
+ * scan slot. The window items on the head segment of the chunk are
+ * adjusted by the carry, if partition continues from the previous chunk.
+ */
+static void
+gpuwindow_store_row(GpuWindowState *gws,
+					GpuWindowTask *gwin,
+					cl_uint index,
+					TupleTableSlot *slot)
+{
+	ExprContext	   *econtext = gws->gts.css.ss.ps.ps_ExprContext;
+	TupleTableSlot *outer_slot = gws->outer_slot;
+	kern_data_store *kds = &gwin->pds_src->kds;
+	kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(kds, index);
+	cl_uint			nitems = gwin->kern.nitems;
+	int				natts = outer_slot->tts_tupleDescriptor->natts;
+	HeapTupleData	tuple;
+	MemoryContext	oldcxt;
+	bool			part_head;
+	int				k;
+
+	tuple.t_len = tupitem->t_len;
+	tuple.t_self = tupitem->t_self;
+	tuple.t_tableOid = InvalidOid;
+	tuple.t_data = &tupitem->htup;
+	ExecStoreTuple(&tuple, outer_slot, InvalidBuffer, false);
+
+	if (index == 0)
+	{
+		/* partition may continue from the previous chunk */
+		gws->in_head_seg = false;
+		gws->head_is_peer = false;
+		if (!TupIsNull(gws->prev_slot))
+		{
+			MemoryContext	tmpcxt = econtext->ecxt_per_tuple_memory;
+
+			gws->in_head_seg = (gws->numPartCols == 0 ||
+								execTuplesMatch(gws->prev_slot, outer_slot,
+												gws->numPartCols,
+												gws->partColIdx,
+												gws->partEqfunctions,
+												tmpcxt));
+			gws->head_is_peer = (gws->in_head_seg &&
+								 (gws->ordNumCols == 0 ||
+								  execTuplesMatch(gws->prev_slot, outer_slot,
+												  gws->ordNumCols,
+												  gws->ordColIdx,
+												  gws->ordEqfunctions,
+												  tmpcxt)));
+		}
+		if (gws->in_head_seg)
+			memcpy(gws->carry_items, gws->last_items,
+				   sizeof(kern_windowitem) * gws->nfuncs);
+		else
+			memset(gws->carry_items, 0,
+				   sizeof(kern_windowitem) * gws->nfuncs);
+		part_head = !gws->in_head_seg;
+	}
+	else
+	{
+		part_head = gwin->part_head[index];
+		if (part_head)
+			gws->in_head_seg = false;
+	}
+	if (part_head)
+		gws->part_nrows = 0;
+	gws->part_nrows++;
+
+	/* outer row */
+	ExecClearTuple(slot);
+	slot_getallattrs(outer_slot);
+	memcpy(slot->tts_values, outer_slot->tts_values, sizeof(Datum) * natts);
+	memcpy(slot->tts_isnull, outer_slot->tts_isnull, sizeof(bool) * natts);
+
+	/* window functions */
+	oldcxt = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+	for (k=0; k < gws->nfuncs; k++)
+	{
+		kern_windowitem *items = gwin->witems + (size_t)k * nitems;
+		kern_windowitem	curr = items[index];
+		kern_windowitem	carry;
+		Datum		   *p_value = &slot->tts_values[natts + k];
+		bool		   *p_isnull = &slot->tts_isnull[natts + k];
+
+		if (gws->in_head_seg)
+			carry = gws->carry_items[k];
+		else
+			memset(&carry, 0, sizeof(kern_windowitem));
+
+		*p_isnull = false;
+		switch (gws->func_kinds[k])
+		{
+			case GPUWINDOW_FUNC__ROW_NUMBER:
+				curr.count += carry.count;
+				*p_value = Int64GetDatum(curr.count);
+				break;
+
+			case GPUWINDOW_FUNC__RANK:
+				/* @ival of the carry is the rank of the last row */
+				if (gws->in_head_seg && gws->head_is_peer && curr.ival == 0)
+					curr.ival = carry.ival;
+				else
+					curr.ival = items[curr.ival].count + carry.count;
+				curr.count += carry.count;
+				*p_value = Int64GetDatum(curr.ival);
+				break;
+
+			case GPUWINDOW_FUNC__DENSE_RANK:
+				curr.count += carry.count;
+				if (gws->in_head_seg && gws->head_is_peer)
+					curr.count--;
+				*p_value = Int64GetDatum(curr.count);
+				break;
+
+			default:
+				/* aggregate functions */
+				gpuwindow_combine_item(gws->func_kinds[k], &carry, &curr);
+				if (gws->frame_rings[k])
+				{
+					kern_windowitem *ring = gws->frame_rings[k];
+					cl_long		ring_sz = gws->func_offsets[k] + 1;
+					cl_long		ring_index = (gws->part_nrows - 1) % ring_sz;
+					kern_windowitem	frame = curr;
+
+					/* prefix sum prior to the frame head, if any */
+					if (gws->part_nrows > ring_sz)
+					{
+						frame.ival -= ring[ring_index].ival;
+						frame.fval -= ring[ring_index].fval;
+						frame.count -= ring[ring_index].count;
+					}
+					ring[ring_index] = curr;
+					gpuwindow_store_aggregate(gws, k, &frame,
+											  p_value, p_isnull);
+				}
+				else
+				{
+					gpuwindow_store_aggregate(gws, k, &curr,
+											  p_value, p_isnull);
+				}
+				break;
+		}
+		gws->last_items[k] = curr;
+	}
+	MemoryContextSwitchTo(oldcxt);
+	ExecStoreVirtualTuple(slot);
+
+	/* keep the last row to be compared to the next chunk */
+	if (index == nitems - 1)
+		ExecCopySlot(gws->prev_slot, outer_slot);
+}
+
+/*
+ * gpuwindow_release_pending - releases the tasks not returned yet
+ */
+static void
+gpuwindow_release_pending(GpuWindowState *gws)
+{
+	ListCell   *lc;
+
+	if (gws->curr_task)
+		gpuwindow_release_task(&gws->curr_task->task);
+	gws->curr_task = NULL;
+	gws->curr_index = 0;
+	foreach (lc, gws->pending_tasks)
+		gpuwindow_release_task((GpuTask *) lfirst(lc));
+	list_free(gws->pending_tasks);
+	gws->pending_tasks = NIL;
+}
+
+/*
+ * gpuwindow_exec_scan - access method of ExecScan
+ */
+static TupleTableSlot *
+gpuwindow_exec_scan(CustomScanState *node)
+{
+	GpuWindowState *gws = (GpuWindowState *) node;
+	TupleTableSlot *slot = gws->gts.css.ss.ss_ScanTupleSlot;
+	GpuWindowTask  *gwin;
+
+	for (;;)
+	{
+		gwin = gws->curr_task;
+		if (gwin)
+		{
+			if (gws->curr_index < gwin->kern.nitems)
+			{
+				gpuwindow_store_row(gws, gwin, gws->curr_index++, slot);
+				return slot;
+			}
+			/* release the current task that was already scanned */
+			ExecClearTuple(slot);
+			ExecClearTuple(gws->outer_slot);
+			gpuwindow_release_task(&gwin->task);
+			gws->curr_task = NULL;
+			gws->curr_index = 0;
+		}
+		/* reload the next chunk in the order of outer rows */
+		gwin = gpuwindow_fetch_task(gws);
+		if (!gwin)
+			break;
+		if (gwin->task.cpu_fallback)
+		{
+			gws->gts.num_cpu_fallbacks++;
+			gpuwindow_fallback_task(gws, gwin);
+		}
+		gws->curr_task = gwin;
+		gws->curr_index = 0;
+	}
+	return ExecClearTuple(slot);
+}
+
+/*
+ * ExecReCheckGpuWindow
+ */
+static bool
+ExecReCheckGpuWindow(CustomScanState *node, TupleTableSlot *slot)
+{
+	/* GpuWindow does not have qualifiers */
+	return true;
+}
+
+/*
+ * ExecGpuWindow
+ */
+static TupleTableSlot *
+ExecGpuWindow(CustomScanState *node)
+{
+	return ExecScan(&node->ss,
+					(ExecScanAccessMtd) gpuwindow_exec_scan,
+					(ExecScanRecheckMtd) ExecReCheckGpuWindow);
+}
+
+/*
+ * ExecEndGpuWindow
+ */
+static void
+ExecEndGpuWindow(CustomScanState *node)
+{
+	GpuWindowState *gws = (GpuWindowState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gws->gts.gcontext);
+	/* clean up subtree */
+	ExecEndNode(outerPlanState(node));
+
+	if (gws->outer_slot)
+		ExecClearTuple(gws->outer_slot);
+	gpuwindow_release_pending(gws);
+	if (gws->outer_slot)
+		ExecDropSingleTupleTableSlot(gws->outer_slot);
+	if (gws->fallback_slot)
+		ExecDropSingleTupleTableSlot(gws->fallback_slot);
+	if (gws->prev_slot)
+		ExecDropSingleTupleTableSlot(gws->prev_slot);
+	pgstromReleaseGpuTaskState(&gws->gts);
+}
+
+/*
+ * ExecReScanGpuWindow
+ */
+static void
+ExecReScanGpuWindow(CustomScanState *node)
+{
+	GpuWindowState *gws = (GpuWindowState *) node;
+
+	/* wait for completion of any asynchronous GpuTask */
+	SynchronizeGpuContext(gws->gts.gcontext);
+	/* rewind the outer relation */
+	ExecReScan(outerPlanState(gws));
+	gws->gts.scan_done = false;
+	gws->gts.scan_overflow = NULL;
+	/* common rescan handling */
+	pgstromRescanGpuTaskState(&gws->gts);
+	/* partitions shall be scanned from the head again */
+	ExecClearTuple(gws->outer_slot);
+	gpuwindow_release_pending(gws);
+	ExecClearTuple(gws->prev_slot);
+	gws->task_seq = 0;
+	gws->emit_seq = 0;
+	gws->part_nrows = 0;
+	gws->in_head_seg = false;
+	gws->head_is_peer = false;
+}
+
+/*
+ * ExplainGpuWindow
+ */
+static void
+ExplainGpuWindow(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+	GpuWindowState *gws = (GpuWindowState *) node;
+	CustomScan	   *cscan = (CustomScan *) node->ss.ps.plan;
+	List		   *dcontext;
+	List		   *part_keys = NIL;
+	List		   *ord_keys = NIL;
+	int				i;
+
+	/* Set up deparsing context */
+	dcontext = set_deparse_context_planstate(es->deparse_cxt,
+											 (Node *)&gws->gts.css.ss.ps,
+											 ancestors);
+	/* Show partition and ordering keys */
+	for (i=0; i < gws->numPartCols; i++)
+	{
+		TargetEntry *tle = get_tle_by_resno(cscan->custom_scan_tlist,
+											gws->partColIdx[i]);
+
+		part_keys = lappend(part_keys,
+							deparse_expression((Node *) tle->expr,
+											   dcontext,
+											   es->verbose,
+											   false));
+	}
+	if (part_keys != NIL)
+		ExplainPropertyList("Partition Key", part_keys, es);
+	for (i=0; i < gws->ordNumCols; i++)
+	{
+		TargetEntry *tle = get_tle_by_resno(cscan->custom_scan_tlist,
+											gws->ordColIdx[i]);
+
+		ord_keys = lappend(ord_keys,
+						   deparse_expression((Node *) tle->expr,
+											  dcontext,
+											  es->verbose,
+											  false));
+	}
+	if (ord_keys != NIL)
+		ExplainPropertyList("Order Key", ord_keys, es);
+	/* other common fields */
+	pgstromExplainGpuTaskState(&gws->gts, es);
+}
+
+/*
+ * pgstrom_init_gpuwindow - entrypoint of GpuWindow
+ */
+void
+pgstrom_init_gpuwindow(void)
+{
+	/* pg_strom.enable_gpuwindow */
+	DefineCustomBoolVariable("pg_strom.enable_gpuwindow",
+							 "Enables the use of GPU window functions on the sorted input",
+							 NULL,
+							 &enable_gpuwindow,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	/* initialization of plan method table */
+	memset(&gpuwindow_scan_methods, 0, sizeof(CustomScanMethods));
+	gpuwindow_scan_methods.CustomName          = "GpuWindow";
+	gpuwindow_scan_methods.CreateCustomScanState = CreateGpuWindowScanState;
+	RegisterCustomScanMethods(&gpuwindow_scan_methods);
+
+	/* initialization of exec method table */
+	memset(&gpuwindow_exec_methods, 0, sizeof(CustomExecMethods));
+	gpuwindow_exec_methods.CustomName          = "GpuWindow";
+	gpuwindow_exec_methods.BeginCustomScan     = ExecInitGpuWindow;
+	gpuwindow_exec_methods.ExecCustomScan      = ExecGpuWindow;
+	gpuwindow_exec_methods.EndCustomScan       = ExecEndGpuWindow;
+	gpuwindow_exec_methods.ReScanCustomScan    = ExecReScanGpuWindow;
+	gpuwindow_exec_methods.ExplainCustomScan   = ExplainGpuWindow;
+}
@@ -20,6 +20,10 @@
 
 /*
  * GpuStoreChunk - shared structure
+ *
+ * A gstore_fdw table consists of one or more GpuStoreChunks (segments);
+ * a transaction that only appends rows adds a new segment, and leaves the
+ * existing segments as is. Visible segments are ordered by revision.
  */
 typedef struct
 {
@@ -82,7 +86,10 @@ typedef struct
 		void	   *buffer;
 	} h;
 	size_t			rawsize;
+	cl_int			nsegments;	/* number of segments loaded */
+	bool			compaction;	/* true, if segments shall be merged */
 	/* read/write buffer */
+	size_t			nitems_base; /* number of rows loaded from segments */
 	MVCCAttrs	   *cs_mvcc;	/* t_xmin/t_xmax/t_cid and flags */
 	ccacheBuffer	cc_buf;		/* buffer for regular attributes */
 } GpuStoreBuffer;
@@ -95,16 +102,50 @@ typedef struct
 	GpuStoreBuffer *gs_buffer;
 	cl_ulong		gs_index;
 	AttrNumber		ctid_anum;	/* only UPDATE or DELETE */
+	size_t			nrows_hint;	/* only INSERT; estimated number of rows */
 } GpuStoreExecState;
 
+/*
+ * Upper limit of the planner estimation to expand the read-write buffer
+ * preliminary, and length of the staging buffer to write out a new
+ * version of the GPU device memory image.
+ */
+#define GSTORE_FDW_NROWS_HINT_MAX		(128UL << 20)
+#define GSTORE_FDW_STAGING_SIZE			(64UL << 20)
+/* hard limit of pg_strom.gstore_max_segments */
+#define GSTORE_FDW_MAX_SEGMENTS			64
+/* hard limit of the number of shards */
+#define GSTORE_FDW_MAX_SHARDS			8
+#define GSTORE_FDW_MAX_CHUNKS			(GSTORE_FDW_MAX_SEGMENTS *	\
+										 GSTORE_FDW_MAX_SHARDS)
+
+/*
+ * GpuStoreShards - sharding configuration of gstore_fdw
+ *
+ * 'pinning' option may have multiple GPU devices, then rows are spread
+ * across the devices by round-robin or hash of 'shard_key' column.
+ */
+typedef struct
+{
+	cl_int			nshards;	/* 1, if not sharded */
+	cl_int			devices[GSTORE_FDW_MAX_SHARDS];
+	char		   *shard_key;	/* column name, or NULL if round-robin */
+} GpuStoreShards;
+
 /* ---- static functions ---- */
 static void	gstore_fdw_table_options(Oid gstore_oid,
 									int *p_pinning, int *p_format);
+static void gstore_fdw_table_shards(Oid gstore_oid, GpuStoreShards *shards);
+static Datum gstore_fdw_buffer_getattr(ccacheBuffer *cc_buf,
+									   Form_pg_attribute attr,
+									   int j, size_t row_index,
+									   bool *p_isnull);
 static void gstore_fdw_column_options(Oid gstore_oid, AttrNumber attnum,
 									  int *p_compression);
 
 /* ---- static variables ---- */
 static int				gstore_max_relations;		/* GUC */
+static int				gstore_max_segments;		/* GUC */
 static shmem_startup_hook_type shmem_startup_next;
 static object_access_hook_type object_access_next;
 static GpuStoreHead	   *gstore_head = NULL;
@@ -118,11 +159,14 @@ Datum pgstrom_gstore_fdw_format(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_nitems(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_nattrs(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_fdw_rawsize(PG_FUNCTION_ARGS);
+Datum pgstrom_gstore_fdw_compact(PG_FUNCTION_ARGS);
 Datum pgstrom_reggstore_in(PG_FUNCTION_ARGS);
 Datum pgstrom_reggstore_out(PG_FUNCTION_ARGS);
 Datum pgstrom_reggstore_recv(PG_FUNCTION_ARGS);
 Datum pgstrom_reggstore_send(PG_FUNCTION_ARGS);
 Datum pgstrom_gstore_export_ipchandle(PG_FUNCTION_ARGS);
+Datum pgstrom_gstore_export_ipchandle_shards(PG_FUNCTION_ARGS);
+Datum pgstrom_gstore_export_column_layout(PG_FUNCTION_ARGS);
 
 /*
  * gstore_fdw_chunk_visibility - equivalent to HeapTupleSatisfiesMVCC,
@@ -286,14 +330,19 @@ gstore_fdw_chunk_hashvalue(Oid gstore_oid)
 }
 
 /*
- * gstore_fdw_lookup_chunk
+ * gstore_fdw_lookup_segments
+ *
+ * It collects the segments of gstore_fdw visible to the snapshot onto
+ * @segs, in order of the revision, then returns number of the segments.
  */
-static GpuStoreChunk *
-gstore_fdw_lookup_chunk_nolock(Oid gstore_oid, Snapshot snapshot)
+static int
+gstore_fdw_lookup_segments_nolock(Oid gstore_oid, Snapshot snapshot,
+								  GpuStoreChunk **segs)
 {
-	GpuStoreChunk *gs_chunk = NULL;
 	pg_crc32	hash = gstore_fdw_chunk_hashvalue(gstore_oid);
 	int			index = hash % GSTORE_CHUNK_HASH_NSLOTS;
+	int			nsegs = 0;
+	int			k;
 	dlist_iter	iter;
 
 	dlist_foreach(iter, &gstore_head->active_chunks[index])
@@ -305,24 +354,28 @@ gstore_fdw_lookup_chunk_nolock(Oid gstore_oid, Snapshot snapshot)
 			gs_temp->table_oid == gstore_oid &&
 			gstore_fdw_chunk_visibility(gs_temp, snapshot))
 		{
-			if (!gs_chunk)
-				gs_chunk = gs_temp;
-			else
-				elog(ERROR, "Bug? multiple GpuStoreChunks are visible");
+			if (nsegs >= GSTORE_FDW_MAX_CHUNKS)
+				elog(ERROR, "Bug? too many GpuStoreChunks are visible");
+			/* insertion sort by the revision */
+			for (k=nsegs; k > 0 && segs[k-1]->revision > gs_temp->revision; k--)
+				segs[k] = segs[k-1];
+			segs[k] = gs_temp;
+			nsegs++;
 		}
 	}
-	return gs_chunk;
+	return nsegs;
 }
 
-static GpuStoreChunk *
-gstore_fdw_lookup_chunk(Oid gstore_oid, Snapshot snapshot)
+static int
+gstore_fdw_lookup_segments(Oid gstore_oid, Snapshot snapshot,
+						   GpuStoreChunk **segs)
 {
-	GpuStoreChunk  *gs_chunk = NULL;
+	int			nsegs = 0;
 
 	SpinLockAcquire(&gstore_head->lock);
 	PG_TRY();
 	{
-		gs_chunk = gstore_fdw_lookup_chunk_nolock(gstore_oid, snapshot);
+		nsegs = gstore_fdw_lookup_segments_nolock(gstore_oid, snapshot, segs);
 	}
 	PG_CATCH();
 	{
@@ -332,22 +385,117 @@ gstore_fdw_lookup_chunk(Oid gstore_oid, Snapshot snapshot)
 	PG_END_TRY();
 	SpinLockRelease(&gstore_head->lock);
 
-	return gs_chunk;
+	return nsegs;
+}
+
+/*
+ * gstore_fdw_write_pgstrom_chunk
+ *
+ * It writes out the read-write buffer onto the preserved device memory in
+ * KDS_FORMAT_COLUMN, using a staging buffer per a few columns, so a whole
+ * copy of the device memory image never exists on the host side.
+ * It returns the actual length of the device memory image.
+ */
+static size_t
+gstore_fdw_write_pgstrom_chunk(Relation frel,
+							   GpuStoreBuffer *gs_buffer,
+							   GpuStoreChunk *gs_chunk,
+							   bits8 *rowmap, size_t nrooms)
+{
+	TupleDesc	tupdesc = RelationGetDescr(frel);
+	ccacheBuffer *cc_buf = &gs_buffer->cc_buf;
+	kern_data_store *kds;
+	size_t		head_sz;
+	size_t		offset;
+	char	   *stage;
+	size_t		stage_sz = GSTORE_FDW_STAGING_SIZE;
+	size_t		stage_base;
+	size_t		stage_len = 0;
+	int			j;
+
+	Assert(tupdesc->natts == cc_buf->nattrs);
+	head_sz = STROMALIGN(offsetof(kern_data_store,
+								  colmeta[tupdesc->natts + NumOfSystemAttrs]));
+	kds = palloc0(head_sz);
+	init_kernel_data_store(kds,
+						   tupdesc,
+						   SIZE_MAX,	/* to be set later */
+						   KDS_FORMAT_COLUMN,
+						   nrooms);
+	stage = MemoryContextAllocHuge(CurrentMemoryContext, stage_sz);
+	offset = stage_base = head_sz;
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		size_t		length = ccache_buffer_column_length(tupdesc, cc_buf,
+														 j, nrooms);
+		if (length == 0)
+			continue;
+		/* flush the staging buffer, if no space left */
+		if (stage_len + length > stage_sz && stage_len > 0)
+		{
+			gpuIpcMemCopyFromHost(gs_chunk->pinning,
+								  gs_chunk->ipc_mhandle,
+								  stage_base,
+								  stage,
+								  stage_len);
+			stage_base = offset;
+			stage_len = 0;
+		}
+		/* a large column larger than the staging buffer */
+		if (length > stage_sz)
+		{
+			stage_sz = length;
+			stage = repalloc_huge(stage, stage_sz);
+		}
+		length = ccache_copy_buffer_column(kds, tupdesc, cc_buf,
+										   rowmap, nrooms, j,
+										   stage + stage_len, offset);
+		stage_len += length;
+		offset += length;
+	}
+	if (stage_len > 0)
+		gpuIpcMemCopyFromHost(gs_chunk->pinning,
+							  gs_chunk->ipc_mhandle,
+							  stage_base,
+							  stage,
+							  stage_len);
+	/* KDS header shall be written at last */
+	kds->nitems = nrooms;
+	kds->length = offset;
+	gpuIpcMemCopyFromHost(gs_chunk->pinning,
+						  gs_chunk->ipc_mhandle,
+						  0,
+						  kds,
+						  head_sz);
+	pfree(stage);
+	pfree(kds);
+
+	return offset;
 }
 
 /*
  * gstore_fdw_insert_chunk - host-to-device DMA
+ *
+ * If @is_append, the new chunk is added as a new segment next to the
+ * existing segments. Elsewhere, it replaces all the existing segments,
+ * except for the chunks already inserted by the current transaction
+ * (on the other shards).
  */
 static void
-gstore_fdw_insert_chunk(GpuStoreBuffer *gs_buffer, size_t nrooms)
+gstore_fdw_insert_chunk(Relation frel, GpuStoreBuffer *gs_buffer,
+						cl_int cuda_dindex,
+						bits8 *rowmap, size_t nrooms, bool is_append)
 {
+	TupleDesc		tupdesc = RelationGetDescr(frel);
 	CUresult		rc;
 	dlist_node	   *dnode;
 	GpuStoreChunk  *gs_chunk;
+	size_t			length;
 	int				index;
+	int				j;
 	dlist_iter		iter;
 
-	Assert(gs_buffer->pinning < numDevAttrs);
+	Assert(cuda_dindex >= 0 && cuda_dindex < numDevAttrs);
 
 	/* setup GpuStoreChunk */
 	SpinLockAcquire(&gstore_head->lock);
@@ -367,29 +515,35 @@ gstore_fdw_insert_chunk(GpuStoreBuffer *gs_buffer, size_t nrooms)
 	gs_chunk->table_oid = gs_buffer->table_oid;
 	gs_chunk->xmax = InvalidTransactionId;
 	gs_chunk->xmin = GetCurrentTransactionId();
-	gs_chunk->pinning = gs_buffer->pinning;
+	gs_chunk->pinning = cuda_dindex;
 	gs_chunk->format = gs_buffer->format;
-	gs_chunk->rawsize = gs_buffer->rawsize;
 	gs_chunk->nitems = nrooms;
 
+	/* size estimation */
+	length = STROMALIGN(offsetof(kern_data_store,
+								 colmeta[tupdesc->natts + NumOfSystemAttrs]));
+	for (j=0; j < tupdesc->natts; j++)
+		length += ccache_buffer_column_length(tupdesc, &gs_buffer->cc_buf,
+											  j, nrooms);
+
 	/* DMA to device */
-	rc = gpuMemAllocPreserved(gs_buffer->pinning,
+	rc = gpuMemAllocPreserved(gs_chunk->pinning,
 							  &gs_chunk->ipc_mhandle,
-							  gs_buffer->rawsize);
+							  length);
 	if (rc != CUDA_SUCCESS)
 		elog(ERROR, "failed on gpuMemAllocPreserved: %s", errorText(rc));
 
 	PG_TRY();
 	{
-		gpuIpcMemCopyFromHost(gs_chunk->pinning,
-							  gs_chunk->ipc_mhandle,
-							  0,
-							  gs_buffer->h.buffer,
-							  gs_buffer->rawsize);
+		gs_chunk->rawsize = gstore_fdw_write_pgstrom_chunk(frel,
+														   gs_buffer,
+														   gs_chunk,
+														   rowmap, nrooms);
+		Assert(gs_chunk->rawsize <= length);
 	}
 	PG_CATCH();
 	{
-		gpuMemFreePreserved(gs_buffer->pinning,
+		gpuMemFreePreserved(gs_chunk->pinning,
 							gs_chunk->ipc_mhandle);
 		memset(gs_chunk, 0, sizeof(GpuStoreChunk));
 		SpinLockAcquire(&gstore_head->lock);
@@ -407,10 +561,12 @@ gstore_fdw_insert_chunk(GpuStoreBuffer *gs_buffer, size_t nrooms)
 	{
 		GpuStoreChunk  *gs_temp = dlist_container(GpuStoreChunk,
 												  chain, iter.cur);
-		if (gs_temp->hash == gs_chunk->hash &&
+		if (!is_append &&
+			gs_temp->hash == gs_chunk->hash &&
 			gs_temp->database_oid == gs_chunk->database_oid &&
 			gs_temp->table_oid == gs_chunk->table_oid &&
-			gs_temp->xmax == InvalidTransactionId)
+			gs_temp->xmax == InvalidTransactionId &&
+			gs_temp->xmin != gs_chunk->xmin)
 		{
 			gs_temp->xmax = gs_chunk->xmin;
 		}
@@ -437,6 +593,105 @@ gstore_fdw_release_chunk(GpuStoreChunk *gs_chunk)
 					&gs_chunk->chain);
 }
 
+/*
+ * gstore_fdw_insert_shards
+ *
+ * It writes out the visible rows onto the GPU devices of the shards, by
+ * round-robin or hash of the shard_key column. It returns the number
+ * of chunks inserted.
+ */
+static int
+gstore_fdw_insert_shards(Relation frel, GpuStoreBuffer *gs_buffer,
+						 bits8 *rowmap, size_t nrooms, bool is_append)
+{
+	TupleDesc		tupdesc = RelationGetDescr(frel);
+	ccacheBuffer   *cc_buf = &gs_buffer->cc_buf;
+	GpuStoreShards	shards;
+	cl_uchar	   *shard_id;
+	bits8		   *shard_map;
+	size_t			i, nitems = cc_buf->nitems;
+	int				k, nchunks = 0;
+
+	gstore_fdw_table_shards(RelationGetRelid(frel), &shards);
+	if (shards.nshards == 1)
+	{
+		gstore_fdw_insert_chunk(frel, gs_buffer, shards.devices[0],
+								rowmap, nrooms, is_append);
+		return 1;
+	}
+
+	/* assign shard for each rows */
+	shard_id = palloc_huge(sizeof(cl_uchar) * nitems);
+	if (!shards.shard_key)
+	{
+		for (i=0; i < nitems; i++)
+			shard_id[i] = i % shards.nshards;
+	}
+	else
+	{
+		AttrNumber	anum = get_attnum(RelationGetRelid(frel),
+									  shards.shard_key);
+		Form_pg_attribute attr;
+		TypeCacheEntry *tcache;
+
+		if (anum <= InvalidAttrNumber || anum > tupdesc->natts)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("gstore_fdw: shard_key \"%s\" is not a column of \"%s\"",
+							shards.shard_key, RelationGetRelationName(frel))));
+		attr = tupdesc->attrs[anum - 1];
+		tcache = lookup_type_cache(attr->atttypid,
+								   TYPECACHE_HASH_PROC_FINFO);
+		if (!OidIsValid(tcache->hash_proc))
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_FUNCTION),
+					 errmsg("could not identify a hash function for type %s",
+							format_type_be(attr->atttypid))));
+		for (i=0; i < nitems; i++)
+		{
+			Datum		datum;
+			bool		isnull;
+			cl_uint		hash = 0;
+
+			if (att_isnull(i, rowmap))
+				continue;
+			datum = gstore_fdw_buffer_getattr(cc_buf, attr, anum - 1, i,
+											  &isnull);
+			if (!isnull)
+				hash = DatumGetUInt32(FunctionCall1Coll(&tcache->hash_proc_finfo,
+														attr->attcollation,
+														datum));
+			shard_id[i] = hash % shards.nshards;
+		}
+	}
+
+	/* write out every shards */
+	shard_map = palloc_huge(BITMAPLEN(nitems));
+	for (k=0; k < shards.nshards; k++)
+	{
+		size_t		nrooms_shard = 0;
+
+		memset(shard_map, 0, BITMAPLEN(nitems));
+		for (i=0; i < nitems; i++)
+		{
+			if (!att_isnull(i, rowmap) && shard_id[i] == k)
+			{
+				shard_map[i >> 3] |= (1 << (i & 7));
+				nrooms_shard++;
+			}
+		}
+		if (nrooms_shard == 0)
+			continue;
+		gstore_fdw_insert_chunk(frel, gs_buffer, shards.devices[k],
+								shard_map, nrooms_shard, is_append);
+		nchunks++;
+	}
+	pfree(shard_map);
+	pfree(shard_id);
+
+	return nchunks;
+}
+
 /*
  * gstore_fdw_make_buffer_writable
  */
@@ -506,9 +761,87 @@ gstore_fdw_make_buffer_writable(Relation frel, GpuStoreBuffer *gs_buffer)
 			mvcc->xmax_committed = false;
 		}
 	}
+	gs_buffer->nitems_base = nitems;
 	gs_buffer->read_only = false;
 }
 
+/*
+ * gstore_fdw_load_segments
+ *
+ * It makes read-write buffer from multiple segments. The segments prior
+ * to @first are already loaded on the read-only or read-write buffer, then
+ * rows in the following segments are appended. So, the buffer assembled
+ * once is reused for the later revisions that just appended segments.
+ */
+static void
+gstore_fdw_load_segments(Relation frel, GpuStoreBuffer *gs_buffer,
+						 GpuStoreChunk **segs, int nsegs, int first)
+{
+	TupleDesc		tupdesc = RelationGetDescr(frel);
+	ccacheBuffer   *cc_buf = &gs_buffer->cc_buf;
+	TupleTableSlot *slot;
+	size_t			nrooms;
+	size_t			i;
+	int				k;
+
+	Assert(gs_buffer->format == GSTORE_FDW_FORMAT__PGSTROM);
+	Assert(first > 0 && first < nsegs);
+	gstore_fdw_make_buffer_writable(frel, gs_buffer);
+	if (gs_buffer->h.buffer)
+	{
+		pfree(gs_buffer->h.buffer);
+		gs_buffer->h.buffer = NULL;
+	}
+
+	nrooms = cc_buf->nitems + 10000;
+	for (k=first; k < nsegs; k++)
+		nrooms += segs[k]->nitems;
+	if (nrooms > cc_buf->nrooms)
+	{
+		ccache_expand_buffer(tupdesc, cc_buf, nrooms, gs_buffer->memcxt);
+		gs_buffer->cs_mvcc = repalloc_huge(gs_buffer->cs_mvcc,
+										   sizeof(MVCCAttrs) * cc_buf->nrooms);
+	}
+
+	slot = MakeSingleTupleTableSlot(tupdesc);
+	for (k=first; k < nsegs; k++)
+	{
+		GpuStoreChunk  *gs_chunk = segs[k];
+		kern_data_store *kds;
+
+		kds = MemoryContextAllocHuge(CurrentMemoryContext,
+									 gs_chunk->rawsize);
+		gpuIpcMemCopyToHost(kds,
+							gs_chunk->pinning,
+							gs_chunk->ipc_mhandle,
+							0,
+							gs_chunk->rawsize);
+		for (i=0; KDS_fetch_tuple_column(slot, kds, i); i++)
+		{
+			MVCCAttrs  *mvcc = &gs_buffer->cs_mvcc[cc_buf->nitems];
+
+			ccache_buffer_append_row(tupdesc,
+									 cc_buf,
+									 NULL,	/* no system columns */
+									 slot->tts_isnull,
+									 slot->tts_values,
+									 gs_buffer->memcxt);
+			cc_buf->nitems++;
+			/* rows in the segments are all visible */
+			mvcc->xmin = FrozenTransactionId;
+			mvcc->xmax = InvalidTransactionId;
+			mvcc->cid = 0;
+			mvcc->xmin_committed = true;
+			mvcc->xmax_committed = false;
+		}
+		pfree(kds);
+	}
+	ExecDropSingleTupleTableSlot(slot);
+	gs_buffer->nitems_base = cc_buf->nitems;
+	gs_buffer->nsegments = nsegs;
+	gs_buffer->revision = segs[nsegs-1]->revision;
+}
+
 /*
  * gstore_fdw_create_buffer - make a local buffer of GpuStore
  */
@@ -516,7 +849,8 @@ static GpuStoreBuffer *
 gstore_fdw_create_buffer(Relation frel, Snapshot snapshot)
 {
 	GpuStoreBuffer *gs_buffer = NULL;
-	GpuStoreChunk  *gs_chunk = NULL;
+	GpuStoreChunk  *segs[GSTORE_FDW_MAX_CHUNKS];
+	int				nsegs;
 	MemoryContext	memcxt = NULL;
 	bool			found;
 
@@ -542,20 +876,51 @@ gstore_fdw_create_buffer(Relation frel, Snapshot snapshot)
 	if (found)
 	{
 		Assert(gs_buffer->table_oid == RelationGetRelid(frel));
-		gs_chunk = gstore_fdw_lookup_chunk(RelationGetRelid(frel), snapshot);
-		if (!gs_chunk)
+		nsegs = gstore_fdw_lookup_segments(RelationGetRelid(frel),
+										   snapshot, segs);
+		if (nsegs == 0)
 		{
 			if (gs_buffer->revision == 0)
 				return gs_buffer;	/* no gs_chunk right now */
 		}
-		else if (gs_buffer->revision == gs_chunk->revision)
+		else if (gs_buffer->revision == segs[nsegs-1]->revision &&
+				 gs_buffer->nsegments == nsegs)
 			return gs_buffer;		/* ok local buffer is up to date */
+		else if (!gs_buffer->is_dirty &&
+				 gs_buffer->format == GSTORE_FDW_FORMAT__PGSTROM &&
+				 gs_buffer->nsegments > 0 &&
+				 gs_buffer->nsegments < nsegs &&
+				 segs[gs_buffer->nsegments-1]->revision == gs_buffer->revision)
+		{
+			/*
+			 * Someone appended new segments only; all the segments we
+			 * already have are still visible, so load the new ones.
+			 */
+			PG_TRY();
+			{
+				gstore_fdw_load_segments(frel, gs_buffer, segs, nsegs,
+										 gs_buffer->nsegments);
+			}
+			PG_CATCH();
+			{
+				MemoryContextDelete(gs_buffer->memcxt);
+				hash_search(gstore_buffer_htab,
+							&RelationGetRelid(frel),
+							HASH_REMOVE,
+							&found);
+				Assert(found);
+				PG_RE_THROW();
+			}
+			PG_END_TRY();
+			return gs_buffer;
+		}
 		/* oops, local cache is older than in-GPU image... */
 		MemoryContextDelete(gs_buffer->memcxt);
 	}
 	else
 	{
-		gs_chunk = gstore_fdw_lookup_chunk(RelationGetRelid(frel), snapshot);
+		nsegs = gstore_fdw_lookup_segments(RelationGetRelid(frel),
+										   snapshot, segs);
 	}
 
 	/*
@@ -570,7 +935,7 @@ gstore_fdw_create_buffer(Relation frel, Snapshot snapshot)
 		memcxt = AllocSetContextCreate(CacheMemoryContext,
 									   "GpuStoreBuffer",
 									   ALLOCSET_DEFAULT_SIZES);
-		if (!gs_chunk)
+		if (nsegs == 0)
 		{
 			gstore_fdw_table_options(RelationGetRelid(frel),
 									 &pinning, &format);
@@ -581,18 +946,21 @@ gstore_fdw_create_buffer(Relation frel, Snapshot snapshot)
 			gs_buffer->is_dirty  = false;
 			gs_buffer->memcxt    = memcxt;
 			gs_buffer->h.buffer  = NULL;
+			gs_buffer->nsegments = 0;
+			gs_buffer->compaction = false;
 			gs_buffer->cs_mvcc   = NULL;
 			memset(&gs_buffer->cc_buf, 0, sizeof(ccacheBuffer));
 			gstore_fdw_make_buffer_writable(frel, gs_buffer);
 		}
 		else
 		{
+			GpuStoreChunk *gs_chunk = segs[0];
 			size_t		rawsize;
 			void	   *hbuf;
 
 			pinning  = gs_chunk->pinning;
 			format   = gs_chunk->format;
-			revision = gs_chunk->revision;
+			revision = segs[nsegs-1]->revision;
 			rawsize  = gs_chunk->rawsize;
 			hbuf = MemoryContextAllocHuge(memcxt, rawsize);
 
@@ -611,8 +979,13 @@ gstore_fdw_create_buffer(Relation frel, Snapshot snapshot)
 			gs_buffer->memcxt    = memcxt;
 			gs_buffer->h.buffer  = hbuf;
 			gs_buffer->rawsize   = rawsize;
+			gs_buffer->nsegments = nsegs;
+			gs_buffer->compaction = false;
 			gs_buffer->cs_mvcc   = NULL;
 			memset(&gs_buffer->cc_buf, 0, sizeof(ccacheBuffer));
+			/* multiple segments are merged on the read-write buffer */
+			if (nsegs > 1)
+				gstore_fdw_load_segments(frel, gs_buffer, segs, nsegs, 1);
 		}
 	}
 	PG_CATCH();
@@ -643,14 +1016,22 @@ gstoreGetForeignRelSize(PlannerInfo *root,
 						Oid ftable_oid)
 {
 	Snapshot		snapshot;
-	GpuStoreChunk  *gs_chunk;
+	GpuStoreChunk  *segs[GSTORE_FDW_MAX_CHUNKS];
+	size_t			nitems = 0;
+	size_t			rawsize = 0;
+	int				k, nsegs;
 
 	snapshot = RegisterSnapshot(GetTransactionSnapshot());
-	gs_chunk = gstore_fdw_lookup_chunk(ftable_oid, snapshot);
+	nsegs = gstore_fdw_lookup_segments(ftable_oid, snapshot, segs);
 	UnregisterSnapshot(snapshot);
-
-	baserel->rows	= (gs_chunk ? gs_chunk->nitems : 0);
-	baserel->pages	= (gs_chunk ? gs_chunk->rawsize / BLCKSZ : 0);
+	for (k=0; k < nsegs; k++)
+	{
+		nitems  += segs[k]->nitems;
+		rawsize += segs[k]->rawsize;
+	}
+	baserel->rows	= nitems;
+	baserel->tuples	= nitems;
+	baserel->pages	= rawsize / BLCKSZ;
 }
 
 /*
@@ -777,6 +1158,52 @@ gstoreBeginForeignScan(ForeignScanState *node, int eflags)
 	node->fdw_state = (void *) gstate;
 }
 
+/*
+ * gstore_fdw_buffer_getattr - fetch a datum from the read-write buffer
+ */
+static Datum
+gstore_fdw_buffer_getattr(ccacheBuffer *cc_buf, Form_pg_attribute attr,
+						  int j, size_t row_index, bool *p_isnull)
+{
+	void	   *addr;
+	int			unitsz;
+
+	if (attr->attlen < 0)
+	{
+		vl_dict_key *vkey = ((vl_dict_key **)cc_buf->values[j])[row_index];
+
+		if (!vkey)
+		{
+			*p_isnull = true;
+			return (Datum) 0;
+		}
+		*p_isnull = false;
+		return PointerGetDatum(vkey->vl_datum);
+	}
+
+	if (att_isnull(row_index, cc_buf->nullmap[j]))
+	{
+		*p_isnull = true;
+		return (Datum) 0;
+	}
+	*p_isnull = false;
+	unitsz = att_align_nominal(attr->attlen,
+							   attr->attalign);
+	addr = (char *)cc_buf->values[j] + unitsz * row_index;
+	if (!attr->attbyval)
+		return PointerGetDatum(addr);
+	else if (attr->attlen == sizeof(cl_char))
+		return CharGetDatum(*((cl_char *)addr));
+	else if (attr->attlen == sizeof(cl_short))
+		return Int16GetDatum(*((cl_short *)addr));
+	else if (attr->attlen == sizeof(cl_int))
+		return Int32GetDatum(*((cl_int *)addr));
+	else if (attr->attlen == sizeof(cl_long))
+		return Int64GetDatum(*((cl_long *)addr));
+	elog(ERROR, "gstore_fdw: unexpected attlen: %d", attr->attlen);
+	return (Datum) 0;	/* be compiler quiet */
+}
+
 /*
  * gstoreIterateForeignScan
  */
@@ -829,41 +1256,10 @@ lnext:
 		/* OK, tuple is visible */
 		for (j=0; j < tupdesc->natts; j++)
 		{
-			Form_pg_attribute attr = tupdesc->attrs[j];
-			vl_dict_key	*vkey;
-			int			unitsz;
-			void	   *addr;
-
-			if (att_isnull(j, cc_buf->nullmap[j]))
-			{
-				slot->tts_isnull[j] = true;
-				continue;
-			}
-			slot->tts_isnull[j] = false;
-			if (attr->attlen < 0)
-			{
-				vkey = ((vl_dict_key **)cc_buf->values[j])[row_index];
-				slot->tts_values[j] = PointerGetDatum(vkey->vl_datum);
-			}
-			else
-			{
-				unitsz = att_align_nominal(attr->attlen,
-										   attr->attalign);
-				addr = (char *)cc_buf->values[j] + unitsz * row_index;
-				if (!attr->attbyval)
-					slot->tts_values[j] = PointerGetDatum(addr);
-				else if (attr->attlen == sizeof(cl_char))
-					slot->tts_values[j] = CharGetDatum(*((cl_char *)addr));
-				else if (attr->attlen == sizeof(cl_short))
-					slot->tts_values[j] = Int16GetDatum(*((cl_short *)addr));
-				else if (attr->attlen == sizeof(cl_int))
-					slot->tts_values[j] = Int32GetDatum(*((cl_int *)addr));
-				else if (attr->attlen == sizeof(cl_long))
-					slot->tts_values[j] = Int64GetDatum(*((cl_long *)addr));
-				else
-					elog(ERROR, "gstore_fdw: unexpected attlen: %d",
-						 attr->attlen);
-			}
+			slot->tts_values[j]
+				= gstore_fdw_buffer_getattr(cc_buf, tupdesc->attrs[j],
+											j, row_index,
+											&slot->tts_isnull[j]);
 		}
 		ExecStoreVirtualTuple(slot);
 	}
@@ -987,6 +1383,19 @@ gstoreBeginForeignModify(ModifyTableState *mtstate,
 			elog(ERROR, "could not find junk ctid column");
 		gstate->ctid_anum = ctid_anum;
 	}
+	else if (operation == CMD_INSERT)
+	{
+		Plan	   *subplan = mtstate->mt_plans[subplan_index]->plan;
+
+		/*
+		 * INSERT ... SELECT may load massive number of rows at once.
+		 * Planner's estimation allows to expand the read-write buffer
+		 * at once, instead of repeated repalloc for each 20000 rows.
+		 */
+		if (subplan->plan_rows > 10000.0)
+			gstate->nrows_hint = (size_t)Min(subplan->plan_rows,
+											 (double)GSTORE_FDW_NROWS_HINT_MAX);
+	}
 	rrinfo->ri_FdwState = gstate;
 }
 
@@ -1018,10 +1427,25 @@ gstoreExecForeignInsert(EState *estate,
 		gstore_fdw_make_buffer_writable(frel, gs_buffer);
 	cc_buf = &gs_buffer->cc_buf;
 
+	/* expand buffer preliminary, if bulk-loading */
+	if (gstate->nrows_hint > 0)
+	{
+		size_t		nrooms_min = cc_buf->nitems + gstate->nrows_hint;
+
+		if (nrooms_min > cc_buf->nrooms)
+		{
+			ccache_expand_buffer(tupdesc, cc_buf, nrooms_min,
+								 gs_buffer->memcxt);
+			gs_buffer->cs_mvcc = repalloc_huge(gs_buffer->cs_mvcc,
+											   sizeof(MVCCAttrs) *
+											   cc_buf->nrooms);
+		}
+		gstate->nrows_hint = 0;
+	}
 	/* expand buffer on demand */
 	while (cc_buf->nitems >= cc_buf->nrooms)
 	{
-		ccache_expand_buffer(tupdesc, cc_buf, gs_buffer->memcxt);
+		ccache_expand_buffer(tupdesc, cc_buf, 0, gs_buffer->memcxt);
 		gs_buffer->cs_mvcc = repalloc_huge(gs_buffer->cs_mvcc,
 										   sizeof(MVCCAttrs) * cc_buf->nrooms);
 	}
@@ -1095,10 +1519,9 @@ gstoreExecForeignUpdate(EState *estate,
 	/* insert a new version */
 	while (cc_buf->nitems >= cc_buf->nrooms)
 	{
-		ccache_expand_buffer(tupdesc, cc_buf, gs_buffer->memcxt);
+		ccache_expand_buffer(tupdesc, cc_buf, 0, gs_buffer->memcxt);
 		gs_buffer->cs_mvcc = repalloc_huge(gs_buffer->cs_mvcc,
-										   sizeof(HeapTupleFields) *
-										   cc_buf->nrooms);
+										   sizeof(MVCCAttrs) * cc_buf->nrooms);
 	}
 	slot_getallattrs(slot);
 	ccache_buffer_append_row(RelationGetDescr(frel),
@@ -1193,52 +1616,37 @@ gstoreEndForeignModify(EState *estate,
 }
 
 /*
- * gstore_fdw_alloc_pgstrom_buffer
+ * gstore_fdw_check_append_only
+ *
+ * It checks whether the current transaction only appended rows on the
+ * gstore_fdw, and no rows on the existing segments are updated/deleted.
+ * If true, @rowmap is adjusted to pick up the new rows only.
  */
-static void
-gstore_fdw_alloc_pgstrom_buffer(Relation frel,
-								GpuStoreBuffer *gs_buffer,
-								bits8 *rowmap, size_t nrooms)
+static bool
+gstore_fdw_check_append_only(Relation frel, GpuStoreBuffer *gs_buffer,
+							 bits8 *rowmap, size_t *p_nrooms)
 {
-	TupleDesc	tupdesc = RelationGetDescr(frel);
-	ccacheBuffer *cc_buf = &gs_buffer->cc_buf;
-	kern_data_store *kds;
-	size_t		length;
-	int			j, ncols;
-
-	Assert(tupdesc->natts == gs_buffer->cc_buf.nattrs);
-	/* 1. size estimation */
-	ncols = tupdesc->natts + NumOfSystemAttrs;
-	length = STROMALIGN(offsetof(kern_data_store, colmeta[ncols]));
-	for (j=0; j < tupdesc->natts; j++)
+	GpuStoreShards shards;
+	size_t		nitems_base = gs_buffer->nitems_base;
+	size_t		i;
+
+	/* limitation is applied for each shard */
+	gstore_fdw_table_shards(RelationGetRelid(frel), &shards);
+	if (gs_buffer->compaction ||
+		gs_buffer->nsegments == 0 ||
+		gs_buffer->nsegments >= gstore_max_segments * shards.nshards)
+		return false;
+	for (i=0; i < nitems_base; i++)
 	{
-		Form_pg_attribute attr = tupdesc->attrs[j];
-
-		if (attr->attisdropped)
-			continue;
-		if (attr->attlen < 0)
-		{
-			length += (MAXALIGN(sizeof(cl_uint) * nrooms) +
-					   MAXALIGN(cc_buf->extra_sz[j]));
-		}
-		else
-		{
-			int		unitsz = att_align_nominal(attr->attlen,
-											   attr->attalign);
-			length += MAXALIGN(unitsz * nrooms);
-			if (cc_buf->hasnull[j])
-				length += MAXALIGN(BITMAPLEN(nrooms));
-		}
+		if (att_isnull(i, rowmap))
+			return false;
 	}
-	/* 2. allocation */
-	kds = MemoryContextAllocHuge(gs_buffer->memcxt, length);
+	Assert(*p_nrooms >= nitems_base);
+	for (i=0; i < nitems_base; i++)
+		rowmap[i >> 3] &= ~(1 << (i & 7));
+	*p_nrooms -= nitems_base;
 
-	/* 3. write out kern_data_store */
-	ccache_copy_buffer_to_kds(kds, tupdesc, cc_buf, rowmap, nrooms);
-	Assert(kds->length <= length);
-
-	gs_buffer->rawsize = kds->length;
-	gs_buffer->h.kds = kds;
+	return true;
 }
 
 /*
@@ -1259,6 +1667,9 @@ gstoreXactCallbackOnPreCommit(void)
 		Relation	frel;
 		bits8	   *rowmap;
 		size_t		nrooms = gs_buffer->cc_buf.nitems;
+		bool		is_append;
+		int			nchunks;
+		bool		found;
 
 		/* any writes happen? */
 		if (!gs_buffer->is_dirty)
@@ -1269,6 +1680,7 @@ gstoreXactCallbackOnPreCommit(void)
 			pfree(gs_buffer->h.buffer);
 			gs_buffer->h.buffer = NULL;
 		}
+		Assert(gs_buffer->format == GSTORE_FDW_FORMAT__PGSTROM);
 		/* check visibility for each rows (if any) */
 		rowmap = gstore_fdw_visibility_bitmap(gs_buffer, &nrooms);
 
@@ -1284,7 +1696,6 @@ gstoreXactCallbackOnPreCommit(void)
 			pg_crc32	hash = gstore_fdw_chunk_hashvalue(gstore_oid);
 			int			index = hash % GSTORE_CHUNK_HASH_NSLOTS;
 			dlist_iter	iter;
-			bool		found;
 
 			SpinLockAcquire(&gstore_head->lock);
 			dlist_foreach(iter, &gstore_head->active_chunks[index])
@@ -1312,25 +1723,52 @@ gstoreXactCallbackOnPreCommit(void)
 			continue;
 		}
 
-		/* construction of new version of GPU device memory image */
+		/*
+		 * If this transaction only appended rows, a new segment that has
+		 * only the new rows is added, and the existing segments are kept.
+		 * Elsewhere, or once number of the segments reached the limit, all
+		 * the visible rows are merged into a new version of the segment.
+		 */
 		frel = heap_open(gs_buffer->table_oid, NoLock);
-		if (gs_buffer->format == GSTORE_FDW_FORMAT__PGSTROM)
-			gstore_fdw_alloc_pgstrom_buffer(frel, gs_buffer, rowmap, nrooms);
-		else
-			elog(ERROR, "gstore_fdw: unknown format %d", gs_buffer->format);
+		is_append = gstore_fdw_check_append_only(frel, gs_buffer,
+												 rowmap, &nrooms);
+
+		/*
+		 * construction of new version of GPU device memory image; it is
+		 * written out to the device memory column by column, so we don't
+		 * need to have a whole copy on the host side.
+		 */
+		nchunks = 0;
+		if (nrooms > 0)
+			nchunks = gstore_fdw_insert_shards(frel, gs_buffer,
+											   rowmap, nrooms, is_append);
 		heap_close(frel, NoLock);
 		pfree(rowmap);
 
-		/* host-to-device DMA */
-		gstore_fdw_insert_chunk(gs_buffer, nrooms);
-
-		/* release read-write buffer */
-		pfree(gs_buffer->cs_mvcc);
-		gs_buffer->cs_mvcc = NULL;
-		ccache_release_buffer(&gs_buffer->cc_buf);
+		/*
+		 * The read-write buffer is still valid for the next transaction,
+		 * if all the rows are appended to the device memory.
+		 */
+		if (is_append &&
+			nrooms > 0 &&
+			gs_buffer->nitems_base + nrooms == gs_buffer->cc_buf.nitems)
+		{
+			gs_buffer->nsegments += nchunks;
+			gs_buffer->nitems_base = gs_buffer->cc_buf.nitems;
+			gs_buffer->is_dirty = false;
+			continue;
+		}
 
-		gs_buffer->read_only = true;
-		gs_buffer->is_dirty = false;
+		/*
+		 * release the local buffer; read-only buffer shall be loaded from
+		 * the device memory on the next access, if any.
+		 */
+		MemoryContextDelete(gs_buffer->memcxt);
+		hash_search(gstore_buffer_htab,
+					&gs_buffer->table_oid,
+					HASH_REMOVE,
+					&found);
+		Assert(found);
 	}
 }
 
@@ -1491,7 +1929,7 @@ gstoreSubXactCallback(SubXactEvent event, SubTransactionId mySubid,
 /*
  * relation_is_gstore_fdw
  */
-static bool
+bool
 relation_is_gstore_fdw(Oid table_oid)
 {
 	HeapTuple	tup;
@@ -1557,11 +1995,15 @@ relation_is_gstore_fdw(Oid table_oid)
 static void
 __gstore_fdw_table_options(List *options,
 						  int *p_pinning,
-						  int *p_format)
+						  int *p_format,
+						  GpuStoreShards *p_shards)
 {
 	ListCell   *lc;
 	int			pinning = -1;
 	int			format = -1;
+	int			nshards = 0;
+	int			devices[GSTORE_FDW_MAX_SHARDS];
+	char	   *shard_key = NULL;
 
 	foreach (lc, options)
 	{
@@ -1569,15 +2011,52 @@ __gstore_fdw_table_options(List *options,
 
 		if (strcmp(defel->defname, "pinning") == 0)
 		{
+			List	   *dev_list;
+			ListCell   *cell;
+			int			k;
+
 			if (pinning >= 0)
 				ereport(ERROR,
 						(errcode(ERRCODE_SYNTAX_ERROR),
 						 errmsg("\"pinning\" option appears twice")));
-			pinning = atoi(defGetString(defel));
-			if (pinning < 0 || pinning >= numDevAttrs)
+			/* comma separated list of GPU devices, for sharding */
+			if (!SplitIdentifierString(pstrdup(defGetString(defel)),
+									   ',', &dev_list) || dev_list == NIL)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("\"pinning\" must be a list of GPU devices")));
+			if (list_length(dev_list) > GSTORE_FDW_MAX_SHARDS)
+				ereport(ERROR,
+						(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+						 errmsg("\"pinning\" has too many GPU devices (up to %d)",
+								GSTORE_FDW_MAX_SHARDS)));
+			foreach (cell, dev_list)
+			{
+				int		dindex = atoi(lfirst(cell));
+
+				if (dindex < 0 || dindex >= numDevAttrs)
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("\"pinning\" on unavailable GPU device")));
+				for (k=0; k < nshards; k++)
+				{
+					if (devices[k] == dindex)
+						ereport(ERROR,
+								(errcode(ERRCODE_SYNTAX_ERROR),
+								 errmsg("\"pinning\" has GPU device %d twice",
+										dindex)));
+				}
+				devices[nshards++] = dindex;
+			}
+			pinning = devices[0];
+		}
+		else if (strcmp(defel->defname, "shard_key") == 0)
+		{
+			if (shard_key)
 				ereport(ERROR,
-						(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
-						 errmsg("\"pinning\" on unavailable GPU device")));
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("\"shard_key\" option appears twice")));
+			shard_key = defGetString(defel);
 		}
 		else if (strcmp(defel->defname, "format") == 0)
 		{
@@ -1610,6 +2089,10 @@ __gstore_fdw_table_options(List *options,
 				(errcode(ERRCODE_SYNTAX_ERROR),
 				 errmsg("gstore_fdw: No pinning GPU device"),
 				 errhint("use 'pinning' option to specify GPU device")));
+	if (shard_key && nshards < 2)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("gstore_fdw: \"shard_key\" needs multiple GPU devices on \"pinning\"")));
 
 	/* put default if not specified */
 	if (format < 0)
@@ -1620,6 +2103,12 @@ __gstore_fdw_table_options(List *options,
 		*p_pinning = pinning;
 	if (p_format)
 		*p_format = format;
+	if (p_shards)
+	{
+		p_shards->nshards = nshards;
+		memcpy(p_shards->devices, devices, sizeof(int) * nshards);
+		p_shards->shard_key = shard_key;
+	}
 }
 
 static void
@@ -1638,7 +2127,30 @@ gstore_fdw_table_options(Oid gstore_oid, int *p_pinning, int *p_format)
 							&isnull);
 	if (!isnull)
 		options = untransformRelOptions(datum);
-	__gstore_fdw_table_options(options, p_pinning, p_format);
+	__gstore_fdw_table_options(options, p_pinning, p_format, NULL);
+	ReleaseSysCache(tup);
+}
+
+/*
+ * gstore_fdw_table_shards
+ */
+static void
+gstore_fdw_table_shards(Oid gstore_oid, GpuStoreShards *shards)
+{
+	HeapTuple	tup;
+	Datum		datum;
+	bool		isnull;
+	List	   *options = NIL;
+
+	tup = SearchSysCache1(FOREIGNTABLEREL, ObjectIdGetDatum(gstore_oid));
+	if (!HeapTupleIsValid(tup))
+		elog(ERROR, "cache lookup failed for foreign table %u", gstore_oid);
+	datum = SysCacheGetAttr(FOREIGNTABLEREL, tup,
+							Anum_pg_foreign_table_ftoptions,
+							&isnull);
+	if (!isnull)
+		options = untransformRelOptions(datum);
+	__gstore_fdw_table_options(options, NULL, NULL, shards);
 	ReleaseSysCache(tup);
 }
 
@@ -1667,6 +2179,8 @@ __gstore_fdw_column_options(List *options, int *p_compression)
 				compression = GSTORE_COMPRESSION__NONE;
 			else if (pg_strcasecmp(temp, "pglz") == 0)
 				compression = GSTORE_COMPRESSION__PGLZ;
+			else if (pg_strcasecmp(temp, "bitpack") == 0)
+				compression = GSTORE_COMPRESSION__BITPACK;
 			else
 				ereport(ERROR,
 						(errcode(ERRCODE_SYNTAX_ERROR),
@@ -1694,8 +2208,40 @@ gstore_fdw_column_options(Oid gstore_oid, AttrNumber attnum,
 						  int *p_compression)
 {
 	List	   *options = GetForeignColumnOptions(gstore_oid, attnum);
+	Oid			type_oid = get_atttype(gstore_oid, attnum);
+	int			compression;
 
-	__gstore_fdw_column_options(options, p_compression);
+	__gstore_fdw_column_options(options, &compression);
+	/*
+	 * 'bitpack' is only valid for integer-like fixed-length types, and
+	 * 'pglz' is only valid for variable length types.
+	 */
+	if (compression == GSTORE_COMPRESSION__BITPACK)
+	{
+		if (type_oid != INT2OID &&
+			type_oid != INT4OID &&
+			type_oid != INT8OID &&
+			type_oid != DATEOID &&
+			type_oid != TIMEOID &&
+			type_oid != TIMESTAMPOID &&
+			type_oid != TIMESTAMPTZOID)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("gstore_fdw: compression 'bitpack' is not supported on column \"%s\" of type %s",
+							get_attname(gstore_oid, attnum),
+							format_type_be(type_oid))));
+	}
+	else if (compression == GSTORE_COMPRESSION__PGLZ)
+	{
+		if (get_typlen(type_oid) != -1)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("gstore_fdw: compression 'pglz' is not supported on column \"%s\" of type %s",
+							get_attname(gstore_oid, attnum),
+							format_type_be(type_oid))));
+	}
+	if (p_compression)
+		*p_compression = compression;
 }
 
 /*
@@ -1705,13 +2251,17 @@ static void
 gstore_fdw_post_alter(Oid relid, AttrNumber attnum)
 {
 	GpuStoreBuffer *gs_buffer;
-	GpuStoreChunk  *gs_chunk;
+	GpuStoreChunk  *segs[GSTORE_FDW_MAX_CHUNKS];
 	bool			found;
 
 	/* not a gstore_fdw foreign-table */
 	if (!relation_is_gstore_fdw(relid))
 		return;
 
+	/* 'compression' option has to match the data type */
+	if (attnum > 0)
+		gstore_fdw_column_options(relid, attnum, NULL);
+
 	/* we don't allow ALTER FOREIGN TABLE onto non-empty gstore_fdw */
 	if (gstore_buffer_htab)
 	{
@@ -1725,8 +2275,7 @@ gstore_fdw_post_alter(Oid relid, AttrNumber attnum)
 					 errmsg("gstore_fdw: unable to run ALTER FOREIGN TABLE for non-empty gstore_fdw table")));
 	}
 
-	gs_chunk = gstore_fdw_lookup_chunk(relid, GetActiveSnapshot());
-	if (gs_chunk)
+	if (gstore_fdw_lookup_segments(relid, GetActiveSnapshot(), segs) > 0)
 	{
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
@@ -1837,7 +2386,7 @@ pgstrom_gstore_fdw_validator(PG_FUNCTION_ARGS)
 	switch (catalog)
 	{
 		case ForeignTableRelationId:
-			__gstore_fdw_table_options(options, NULL, NULL);
+			__gstore_fdw_table_options(options, NULL, NULL, NULL);
 			break;
 
 		case AttributeRelationId:
@@ -2003,7 +2552,8 @@ pgstrom_gstore_export_ipchandle(PG_FUNCTION_ARGS)
 	Oid				gstore_oid = PG_GETARG_OID(0);
 	AclResult		aclresult;
 	cl_int			pinning;
-	GpuStoreChunk  *gs_chunk;
+	GpuStoreChunk  *segs[GSTORE_FDW_MAX_CHUNKS];
+	int				nsegs;
 	char		   *result;
 
 	if (!relation_is_gstore_fdw(gstore_oid))
@@ -2022,18 +2572,354 @@ pgstrom_gstore_export_ipchandle(PG_FUNCTION_ARGS)
 		elog(ERROR, "gstore_fdw: \"%s\" is not pinned on valid GPU device",
 			 get_rel_name(gstore_oid));
 
-	gs_chunk = gstore_fdw_lookup_chunk(gstore_oid, GetActiveSnapshot());
-	if (!gs_chunk)
+	nsegs = gstore_fdw_lookup_segments(gstore_oid, GetActiveSnapshot(), segs);
+	if (nsegs == 0)
 		PG_RETURN_NULL();
+	if (nsegs > 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("gstore_fdw: \"%s\" consists of %d segments",
+						get_rel_name(gstore_oid), nsegs),
+				 errhint("Run gstore_fdw_compact() to merge the segments, or use gstore_export_ipchandle_shards() instead.")));
 
 	result = palloc(VARHDRSZ + sizeof(CUipcMemHandle));
-	memcpy(result + VARHDRSZ, &gs_chunk->ipc_mhandle, sizeof(CUipcMemHandle));
+	memcpy(result + VARHDRSZ, &segs[0]->ipc_mhandle, sizeof(CUipcMemHandle));
 	SET_VARSIZE(result, VARHDRSZ + sizeof(CUipcMemHandle));
 
 	PG_RETURN_POINTER(result);
 }
 PG_FUNCTION_INFO_V1(pgstrom_gstore_export_ipchandle);
 
+/*
+ * pgstrom_gstore_export_ipchandle_shards
+ *
+ * It returns IPC-handles of all the segments of gstore_fdw, with the GPU
+ * device where the segment locates; for sharded gstore_fdw.
+ */
+Datum
+pgstrom_gstore_export_ipchandle_shards(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	GpuStoreChunk  *gs_chunk;
+	List		   *chunks_list;
+	Datum			values[4];
+	bool			isnull[4];
+	HeapTuple		tuple;
+	char		   *ipchandle;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		Oid				gstore_oid = PG_GETARG_OID(0);
+		GpuStoreChunk  *segs[GSTORE_FDW_MAX_CHUNKS];
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+		AclResult		aclresult;
+		int				k, nsegs;
+
+		if (!relation_is_gstore_fdw(gstore_oid))
+			elog(ERROR, "relation %u is not gstore_fdw foreign table",
+				 gstore_oid);
+		aclresult = pg_class_aclcheck(gstore_oid, GetUserId(), ACL_SELECT);
+		if (aclresult != ACLCHECK_OK)
+			aclcheck_error(aclresult, ACL_KIND_CLASS,
+						   get_rel_name(gstore_oid));
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(4, false);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "pinning",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "nitems",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "rawsize",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 4, "ipc_handle",
+						   BYTEAOID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+
+		chunks_list = NIL;
+		nsegs = gstore_fdw_lookup_segments(gstore_oid,
+										   GetActiveSnapshot(), segs);
+		for (k=0; k < nsegs; k++)
+		{
+			gs_chunk = palloc(sizeof(GpuStoreChunk));
+			memcpy(gs_chunk, segs[k], sizeof(GpuStoreChunk));
+			chunks_list = lappend(chunks_list, gs_chunk);
+		}
+		fncxt->user_fctx = chunks_list;
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+
+	chunks_list = fncxt->user_fctx;
+	if (chunks_list == NIL)
+		SRF_RETURN_DONE(fncxt);
+	gs_chunk = linitial(chunks_list);
+	fncxt->user_fctx = list_delete_first(chunks_list);
+
+	ipchandle = palloc(VARHDRSZ + sizeof(CUipcMemHandle));
+	memcpy(ipchandle + VARHDRSZ, &gs_chunk->ipc_mhandle,
+		   sizeof(CUipcMemHandle));
+	SET_VARSIZE(ipchandle, VARHDRSZ + sizeof(CUipcMemHandle));
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = Int32GetDatum(gs_chunk->pinning);
+	values[1] = Int64GetDatum(gs_chunk->nitems);
+	values[2] = Int64GetDatum(gs_chunk->rawsize);
+	values[3] = PointerGetDatum(ipchandle);
+
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_gstore_export_ipchandle_shards);
+
+/*
+ * pgstrom_gstore_export_column_layout
+ *
+ * It returns location of the values array and NULL bitmap of individual
+ * columns within the device memory region of each segment. Fixed-length
+ * values array and NULL bitmap (1 means valid, LSB first) are compatible
+ * to the buffers of Apache Arrow, so external applications can wrap them
+ * by NumPy typestr without copy, once IPC handle is opened.
+ */
+typedef struct
+{
+	cl_int		segment;
+	cl_int		pinning;
+	AttrNumber	attnum;
+	NameData	attname;
+	const char *typestr;		/* NumPy typestr, if plain */
+	const char *encoding;
+	size_t		nitems;
+	size_t		values_offset;	/* 0, if all-null */
+	size_t		values_length;
+	size_t		nullmap_offset;	/* 0, if no NULLs */
+	size_t		nullmap_length;
+} GpuStoreColumnLayout;
+
+static const char *
+gstore_fdw_numpy_typestr(Oid type_oid)
+{
+	switch (type_oid)
+	{
+		case BOOLOID:
+			return "|b1";
+		case INT2OID:
+			return "<i2";
+		case INT4OID:
+		case DATEOID:		/* days from 2000-01-01 */
+			return "<i4";
+		case INT8OID:
+		case TIMEOID:
+		case TIMESTAMPOID:	/* microseconds from 2000-01-01 */
+		case TIMESTAMPTZOID:
+			return "<i8";
+		case FLOAT4OID:
+			return "<f4";
+		case FLOAT8OID:
+			return "<f8";
+		default:
+			break;
+	}
+	return NULL;
+}
+
+Datum
+pgstrom_gstore_export_column_layout(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *fncxt;
+	GpuStoreColumnLayout *layout;
+	List		   *layout_list;
+	Datum			values[11];
+	bool			isnull[11];
+	HeapTuple		tuple;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		Oid				gstore_oid = PG_GETARG_OID(0);
+		GpuStoreChunk  *segs[GSTORE_FDW_MAX_CHUNKS];
+		Relation		frel;
+		TupleDesc		tupdesc;
+		MemoryContext	oldcxt;
+		AclResult		aclresult;
+		kern_data_store *kds;
+		size_t			head_sz;
+		int				j, k, nsegs;
+
+		if (!relation_is_gstore_fdw(gstore_oid))
+			elog(ERROR, "relation %u is not gstore_fdw foreign table",
+				 gstore_oid);
+		aclresult = pg_class_aclcheck(gstore_oid, GetUserId(), ACL_SELECT);
+		if (aclresult != ACLCHECK_OK)
+			aclcheck_error(aclresult, ACL_KIND_CLASS,
+						   get_rel_name(gstore_oid));
+
+		fncxt = SRF_FIRSTCALL_INIT();
+		oldcxt = MemoryContextSwitchTo(fncxt->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(11, false);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  1, "segment",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  2, "pinning",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  3, "attnum",
+						   INT2OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  4, "attname",
+						   NAMEOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  5, "typestr",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  6, "encoding",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  7, "nitems",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  8, "values_offset",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber)  9, "values_length",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 10, "nullmap_offset",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 11, "nullmap_length",
+						   INT8OID, -1, 0);
+		fncxt->tuple_desc = BlessTupleDesc(tupdesc);
+
+		frel = heap_open(gstore_oid, AccessShareLock);
+		tupdesc = RelationGetDescr(frel);
+		head_sz = KDS_CALCULATE_HEAD_LENGTH(tupdesc->natts +
+											NumOfSystemAttrs);
+		kds = palloc(head_sz);
+
+		layout_list = NIL;
+		nsegs = gstore_fdw_lookup_segments(gstore_oid,
+										   GetActiveSnapshot(), segs);
+		for (k=0; k < nsegs; k++)
+		{
+			GpuStoreChunk  *gs_chunk = segs[k];
+
+			gpuIpcMemCopyToHost(kds,
+								gs_chunk->pinning,
+								gs_chunk->ipc_mhandle,
+								0,
+								head_sz);
+			Assert(kds->format == KDS_FORMAT_COLUMN &&
+				   kds->ncols == tupdesc->natts + NumOfSystemAttrs);
+			for (j=0; j < tupdesc->natts; j++)
+			{
+				Form_pg_attribute attr = tupdesc->attrs[j];
+				kern_colmeta   *cmeta = &kds->colmeta[j];
+				size_t			extra_sz;
+
+				if (attr->attisdropped)
+					continue;
+
+				layout = palloc0(sizeof(GpuStoreColumnLayout));
+				layout->segment = k;
+				layout->pinning = gs_chunk->pinning;
+				layout->attnum = attr->attnum;
+				layout->attname = attr->attname;
+				layout->nitems = kds->nitems;
+				if (cmeta->attlen < 0)
+					layout->encoding = "varlena";
+				else if (cmeta->attpacked)
+					layout->encoding = "bitpack";
+				else
+				{
+					layout->typestr = gstore_fdw_numpy_typestr(attr->atttypid);
+					layout->encoding = "plain";
+				}
+				layout_list = lappend(layout_list, layout);
+
+				if (cmeta->va_offset == 0)
+					continue;	/* all-null */
+				layout->values_offset = ((size_t)cmeta->va_offset
+										 << MAXIMUM_ALIGNOF_SHIFT);
+				extra_sz = ((size_t)cmeta->extra_sz << MAXIMUM_ALIGNOF_SHIFT);
+				if (cmeta->attlen < 0)
+				{
+					/* offsets array and varlena body */
+					layout->values_length = (MAXALIGN(sizeof(cl_uint) *
+													  kds->nitems) +
+											 extra_sz);
+				}
+				else
+				{
+					kern_packed_column pack;
+
+					if (!cmeta->attpacked)
+						layout->values_length =
+							MAXALIGN(TYPEALIGN(cmeta->attalign,
+											   cmeta->attlen) * kds->nitems);
+					else
+					{
+						gpuIpcMemCopyToHost(&pack,
+											gs_chunk->pinning,
+											gs_chunk->ipc_mhandle,
+											layout->values_offset,
+											offsetof(kern_packed_column,
+													 values));
+						layout->values_length =
+							KERN_PACKED_COLUMN_LENGTH(pack.nbits,
+													  kds->nitems);
+					}
+					if (extra_sz > 0)
+					{
+						layout->nullmap_offset = (layout->values_offset +
+												  layout->values_length);
+						layout->nullmap_length = BITMAPLEN(kds->nitems);
+					}
+				}
+			}
+		}
+		heap_close(frel, NoLock);
+		fncxt->user_fctx = layout_list;
+		MemoryContextSwitchTo(oldcxt);
+	}
+	fncxt = SRF_PERCALL_SETUP();
+
+	layout_list = fncxt->user_fctx;
+	if (layout_list == NIL)
+		SRF_RETURN_DONE(fncxt);
+	layout = linitial(layout_list);
+	fncxt->user_fctx = list_delete_first(layout_list);
+
+	memset(isnull, 0, sizeof(isnull));
+	values[0] = Int32GetDatum(layout->segment);
+	values[1] = Int32GetDatum(layout->pinning);
+	values[2] = Int16GetDatum(layout->attnum);
+	values[3] = NameGetDatum(&layout->attname);
+	if (layout->typestr)
+		values[4] = CStringGetTextDatum(layout->typestr);
+	else
+		isnull[4] = true;
+	values[5] = CStringGetTextDatum(layout->encoding);
+	values[6] = Int64GetDatum(layout->nitems);
+	if (layout->values_offset == 0)
+	{
+		isnull[7] = true;
+		isnull[8] = true;
+	}
+	else
+	{
+		values[7] = Int64GetDatum(layout->values_offset);
+		values[8] = Int64GetDatum(layout->values_length);
+	}
+	if (layout->nullmap_offset == 0)
+	{
+		isnull[9] = true;
+		isnull[10] = true;
+	}
+	else
+	{
+		values[9] = Int64GetDatum(layout->nullmap_offset);
+		values[10] = Int64GetDatum(layout->nullmap_length);
+	}
+	tuple = heap_form_tuple(fncxt->tuple_desc, values, isnull);
+
+	SRF_RETURN_NEXT(fncxt, HeapTupleGetDatum(tuple));
+}
+PG_FUNCTION_INFO_V1(pgstrom_gstore_export_column_layout);
+
 /*
  * type_is_reggstore
  */
@@ -2077,11 +2963,21 @@ type_is_reggstore(Oid type_oid)
 	return true;
 }
 
-static CUdeviceptr
-gstore_open_device_memory(GpuContext *gcontext, Relation frel)
+/*
+ * gstore_fdw_open_device_memory
+ *
+ * It returns device address of the KDS_FORMAT_COLUMN image of gstore_fdw.
+ * If device memory of the chunk is up-to-date, it is opened by IPC handle
+ * and *p_ipcmem is set; caller has to close it by gpuIpcCloseMemHandle().
+ * Elsewhere, caller has to release the managed memory by gpuMemFree().
+ */
+CUdeviceptr
+gstore_fdw_open_device_memory(GpuContext *gcontext, Relation frel,
+							  bool *p_ipcmem)
 {
 	TupleDesc		tupdesc = RelationGetDescr(frel);
 	GpuStoreBuffer *gs_buffer;
+	GpuStoreChunk  *segs[GSTORE_FDW_MAX_CHUNKS];
 	GpuStoreChunk  *gs_chunk;
 	CUdeviceptr		m_deviceptr;
 	CUresult		rc;
@@ -2089,29 +2985,29 @@ gstore_open_device_memory(GpuContext *gcontext, Relation frel)
 	size_t			nrooms;
 	size_t			length;
 	cl_int			j, ncols;
+	int				nsegs;
 	bits8		   *rowmap;
 
-	gs_chunk = gstore_fdw_lookup_chunk(RelationGetRelid(frel),
-									   GetActiveSnapshot());
+	nsegs = gstore_fdw_lookup_segments(RelationGetRelid(frel),
+									   GetActiveSnapshot(), segs);
 	gs_buffer = (!gstore_buffer_htab
 				 ? NULL
 				 : hash_search(gstore_buffer_htab,
 							   &RelationGetRelid(frel),
 							   HASH_FIND,
 							   &found));
-	if (gs_chunk)
+	if (nsegs == 1)
 	{
+		gs_chunk = segs[0];
 		/*
 		 * If device memory is valid and up-to-date, open IpcHandle
 		 * and returns this device address.
+		 * Note that a shard of sharded gstore_fdw may locate on another
+		 * device, so it has to be built from the read-write buffer.
 		 */
-		if (!gs_buffer || (gs_buffer->revision == gs_chunk->revision &&
-						   !gs_buffer->is_dirty))
+		if ((!gs_buffer || !gs_buffer->is_dirty) &&
+			gcontext->cuda_dindex == gs_chunk->pinning)
 		{
-			if (gcontext->cuda_dindex != gs_chunk->pinning)
-				elog(ERROR, "Bug? gstore_fdw: \"%s\" has wrong pinning",
-					 RelationGetRelationName(frel));
-
 			rc = cuCtxPushCurrent(gcontext->cuda_context);
 			if (rc != CUDA_SUCCESS)
 				elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
@@ -2127,14 +3023,27 @@ gstore_open_device_memory(GpuContext *gcontext, Relation frel)
 			if (rc != CUDA_SUCCESS)
 				elog(ERROR, "failed on cuCtxPopCurrent: %s", errorText(rc));
 
+			if (p_ipcmem)
+				*p_ipcmem = true;
 			return m_deviceptr;
 		}
 		/* Hmm... on device image is not up to date... */
 	}
+	if (nsegs > 0 && (!gs_buffer || !gs_buffer->is_dirty))
+	{
+		/*
+		 * Multiple segments (or a shard on another device) have to be
+		 * merged into a KDS; it is built from the read-write buffer, as
+		 * if it is not committed yet.
+		 */
+		gs_buffer = gstore_fdw_create_buffer(frel, GetActiveSnapshot());
+	}
 	/*
 	 * corner case: we have neither device memory nor local buffer.
 	 * in this case, we make an empty store.
 	 */
+	if (p_ipcmem)
+		*p_ipcmem = false;
 	if (!gs_buffer)
 	{
 		ncols = tupdesc->natts + NumOfSystemAttrs;
@@ -2158,31 +3067,16 @@ gstore_open_device_memory(GpuContext *gcontext, Relation frel)
 	 * local read-write buffer is up-to-date.
 	 * So, we need to construct in-kernel image.
 	 *
-	 * Logic is almost same to gstore_fdw_alloc_pgstrom_buffer()
+	 * Logic is almost same to gstore_fdw_insert_chunk()
 	 */
+	if (gs_buffer->read_only)
+		gstore_fdw_make_buffer_writable(frel, gs_buffer);
 	rowmap = gstore_fdw_visibility_bitmap(gs_buffer, &nrooms);
 	ncols = tupdesc->natts + NumOfSystemAttrs;
 	length = STROMALIGN(offsetof(kern_data_store, colmeta[ncols]));
 	for (j=0; j < tupdesc->natts; j++)
-	{
-		Form_pg_attribute attr = tupdesc->attrs[j];
-
-		if (attr->attisdropped)
-			continue;
-		if (attr->attlen < 0)
-		{
-			length += (MAXALIGN(sizeof(cl_uint) * nrooms) +
-					   MAXALIGN(gs_buffer->cc_buf.extra_sz[j]));
-		}
-		else
-		{
-			int		unitsz = att_align_nominal(attr->attlen,
-											   attr->attalign);
-			length += MAXALIGN(unitsz * nrooms);
-			if (gs_buffer->cc_buf.hasnull[j])
-				length += MAXALIGN(BITMAPLEN(nrooms));
-		}
-	}
+		length += ccache_buffer_column_length(tupdesc, &gs_buffer->cc_buf,
+											  j, nrooms);
 	rc = gpuMemAllocManaged(gcontext,
 							&m_deviceptr,
 							length,
@@ -2196,6 +3090,25 @@ gstore_open_device_memory(GpuContext *gcontext, Relation frel)
 	return m_deviceptr;
 }
 
+/*
+ * gstore_fdw_pinning_device
+ *
+ * It returns the CUDA device index where gstore_fdw is pinned, or -1.
+ */
+int
+gstore_fdw_pinning_device(Oid gstore_oid)
+{
+	GpuStoreShards shards;
+
+	if (!relation_is_gstore_fdw(gstore_oid))
+		return -1;
+	gstore_fdw_table_shards(gstore_oid, &shards);
+	/* sharded gstore_fdw is not pinned on a particular device */
+	if (shards.nshards != 1 || shards.devices[0] >= numDevAttrs)
+		return -1;
+	return shards.devices[0];
+}
+
 /*
  * gstore_fdw_preferable_device
  */
@@ -2215,6 +3128,7 @@ gstore_fdw_preferable_device(FunctionCallInfo fcinfo)
 	{
 		Oid		gstore_oid;
 		int		pinning;
+		GpuStoreShards shards;
 
 		if (proargtypes->values[i] != REGGSTOREOID)
 			continue;
@@ -2222,7 +3136,11 @@ gstore_fdw_preferable_device(FunctionCallInfo fcinfo)
 		if (!relation_is_gstore_fdw(gstore_oid))
 			elog(ERROR, "relation %u is not gstore_fdw foreign table",
 				 gstore_oid);
-		gstore_fdw_table_options(gstore_oid, &pinning, NULL);
+		gstore_fdw_table_shards(gstore_oid, &shards);
+		/* sharded gstore_fdw is merged on any devices */
+		if (shards.nshards > 1)
+			continue;
+		pinning = shards.devices[0];
 		if (pinning < 0 || pinning >= numDevAttrs)
 			elog(ERROR, "gstore_fdw: \"%s\" is pinned on unknown device %d",
 				 get_rel_name(gstore_oid), pinning);
@@ -2266,6 +3184,8 @@ gstore_fdw_load_function_args(GpuContext *gcontext,
 		Oid			gstore_oid;
 		int			pinning;
 		CUdeviceptr	m_deviceptr;
+		bool		ipcmem;
+		GpuStoreShards shards;
 
 		if (proargtypes->values[i] != REGGSTOREOID)
 			continue;
@@ -2283,19 +3203,22 @@ gstore_fdw_load_function_args(GpuContext *gcontext,
 			elog(ERROR, "relation %u is not gstore_fdw foreign table",
 				 gstore_oid);
 
-		gstore_fdw_table_options(gstore_oid, &pinning, NULL);
+		gstore_fdw_table_shards(gstore_oid, &shards);
+		pinning = (shards.nshards == 1 ? shards.devices[0] : -1);
 		if (pinning >= 0 && gcontext->cuda_dindex != pinning)
 			elog(ERROR, "unable to load gstore_fdw foreign table \"%s\" on the GPU device %d; GpuContext is assigned on the device %d",
 				 get_rel_name(gstore_oid), pinning, gcontext->cuda_dindex);
 
 		frel = heap_open(gstore_oid, AccessShareLock);
-		m_deviceptr = gstore_open_device_memory(gcontext, frel);
+		m_deviceptr = gstore_fdw_open_device_memory(gcontext, frel, &ipcmem);
 		heap_close(frel, NoLock);
 
+		/* negative dindex means m_deviceptr is not IPC memory */
 		gstore_oid_list = lappend_oid(gstore_oid_list, gstore_oid);
 		gstore_devptr_list = lappend(gstore_devptr_list,
 									 (void *)m_deviceptr);
-		gstore_dindex_list = lappend_int(gstore_dindex_list, pinning);
+		gstore_dindex_list = lappend_int(gstore_dindex_list,
+										 ipcmem ? pinning : -1);
 	}
 	ReleaseSysCache(protup);
 	*p_gstore_oid_list = gstore_oid_list;
@@ -2310,7 +3233,7 @@ Datum
 pgstrom_gstore_fdw_format(PG_FUNCTION_ARGS)
 {
 	Oid				gstore_oid = PG_GETARG_OID(0);
-	GpuStoreChunk  *gs_chunk;
+	GpuStoreChunk  *segs[GSTORE_FDW_MAX_CHUNKS];
 	AclResult		aclresult;
 
 	if (!relation_is_gstore_fdw(gstore_oid))
@@ -2320,8 +3243,7 @@ pgstrom_gstore_fdw_format(PG_FUNCTION_ARGS)
 		aclcheck_error(aclresult, ACL_KIND_CLASS,
 					   get_rel_name(gstore_oid));
 
-	gs_chunk = gstore_fdw_lookup_chunk(gstore_oid, GetActiveSnapshot());
-	if (!gs_chunk)
+	if (gstore_fdw_lookup_segments(gstore_oid, GetActiveSnapshot(), segs) == 0)
 		PG_RETURN_NULL();
 
 	/* currently, only 'pgstrom' is the supported format */
@@ -2336,9 +3258,10 @@ Datum
 pgstrom_gstore_fdw_nitems(PG_FUNCTION_ARGS)
 {
 	Oid				gstore_oid = PG_GETARG_OID(0);
-	GpuStoreChunk  *gs_chunk;
+	GpuStoreChunk  *segs[GSTORE_FDW_MAX_CHUNKS];
 	AclResult		aclresult;
 	int64			retval = 0;
+	int				k, nsegs;
 
 	if (!relation_is_gstore_fdw(gstore_oid))
 		PG_RETURN_NULL();
@@ -2347,9 +3270,9 @@ pgstrom_gstore_fdw_nitems(PG_FUNCTION_ARGS)
 		aclcheck_error(aclresult, ACL_KIND_CLASS,
 					   get_rel_name(gstore_oid));
 
-	gs_chunk = gstore_fdw_lookup_chunk(gstore_oid, GetActiveSnapshot());
-	if (gs_chunk)
-		retval = gs_chunk->nitems;
+	nsegs = gstore_fdw_lookup_segments(gstore_oid, GetActiveSnapshot(), segs);
+	for (k=0; k < nsegs; k++)
+		retval += segs[k]->nitems;
 
 	PG_RETURN_INT64(retval);
 }
@@ -2389,8 +3312,9 @@ pgstrom_gstore_fdw_rawsize(PG_FUNCTION_ARGS)
 {
 	Oid				gstore_oid = PG_GETARG_OID(0);
 	AclResult		aclresult;
-	GpuStoreChunk  *gs_chunk;
+	GpuStoreChunk  *segs[GSTORE_FDW_MAX_CHUNKS];
 	int64			retval = 0;
+	int				k, nsegs;
 
 	if (!relation_is_gstore_fdw(gstore_oid))
 		PG_RETURN_NULL();
@@ -2399,14 +3323,54 @@ pgstrom_gstore_fdw_rawsize(PG_FUNCTION_ARGS)
 		aclcheck_error(aclresult, ACL_KIND_CLASS,
 					   get_rel_name(gstore_oid));
 
-	gs_chunk = gstore_fdw_lookup_chunk(gstore_oid, GetActiveSnapshot());
-	if (gs_chunk)
-		retval = gs_chunk->rawsize;
+	nsegs = gstore_fdw_lookup_segments(gstore_oid, GetActiveSnapshot(), segs);
+	for (k=0; k < nsegs; k++)
+		retval += segs[k]->rawsize;
 
 	PG_RETURN_INT64(retval);
 }
 PG_FUNCTION_INFO_V1(pgstrom_gstore_fdw_rawsize);
 
+/*
+ * pgstrom_gstore_fdw_compact
+ *
+ * It merges all the segments of gstore_fdw into one on the commit time.
+ * It returns number of the segments to be merged.
+ */
+Datum
+pgstrom_gstore_fdw_compact(PG_FUNCTION_ARGS)
+{
+	Oid				gstore_oid = PG_GETARG_OID(0);
+	AclResult		aclresult;
+	Relation		frel;
+	GpuStoreBuffer *gs_buffer;
+	int				nsegs;
+
+	if (!relation_is_gstore_fdw(gstore_oid))
+		elog(ERROR, "relation %u is not gstore_fdw foreign table",
+			 gstore_oid);
+	aclresult = pg_class_aclcheck(gstore_oid, GetUserId(), ACL_UPDATE);
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, ACL_KIND_CLASS,
+					   get_rel_name(gstore_oid));
+
+	/* same lock to the gstoreBeginForeignModify */
+	frel = heap_open(gstore_oid, ShareUpdateExclusiveLock);
+	gs_buffer = gstore_fdw_create_buffer(frel, GetActiveSnapshot());
+	nsegs = gs_buffer->nsegments;
+	if (nsegs > 1)
+	{
+		if (gs_buffer->read_only)
+			gstore_fdw_make_buffer_writable(frel, gs_buffer);
+		gs_buffer->compaction = true;
+		gs_buffer->is_dirty = true;
+	}
+	heap_close(frel, NoLock);
+
+	PG_RETURN_INT32(nsegs > 1 ? nsegs : 0);
+}
+PG_FUNCTION_INFO_V1(pgstrom_gstore_fdw_compact);
+
 /*
  * pgstrom_gstore_fdw_chunk_info
  */
@@ -2526,14 +3490,15 @@ static void
 pgstrom_startup_gstore_fdw(void)
 {
 	bool		found;
-	int			i;
+	int			i, nchunks;
 
 	if (shmem_startup_next)
 		(*shmem_startup_next)();
 
+	nchunks = gstore_max_relations * (gstore_max_segments + 1);
 	gstore_head = ShmemInitStruct("GPU Store Control Structure",
 								  offsetof(GpuStoreHead,
-										   gs_chunks[gstore_max_relations]),
+										   gs_chunks[nchunks]),
 								  &found);
 	if (found)
 		elog(ERROR, "Bug? shared memory for gstore_fdw already built");
@@ -2543,7 +3508,7 @@ pgstrom_startup_gstore_fdw(void)
 	dlist_init(&gstore_head->free_chunks);
 	for (i=0; i < GSTORE_CHUNK_HASH_NSLOTS; i++)
 		dlist_init(&gstore_head->active_chunks[i]);
-	for (i=0; i < gstore_max_relations; i++)
+	for (i=0; i < nchunks; i++)
 	{
 		GpuStoreChunk  *gs_chunk = &gstore_head->gs_chunks[i];
 
@@ -2568,8 +3533,19 @@ pgstrom_init_gstore_fdw(void)
 							PGC_POSTMASTER,
 							GUC_NOT_IN_SAMPLE,
 							NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.gstore_max_segments",
+							"maximum number of segments per gstore_fdw relation",
+							NULL,
+							&gstore_max_segments,
+							8,
+							1,
+							GSTORE_FDW_MAX_SEGMENTS,
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
 	RequestAddinShmemSpace(MAXALIGN(offsetof(GpuStoreHead,
-											gs_chunks[gstore_max_relations])));
+									gs_chunks[gstore_max_relations *
+											  (gstore_max_segments + 1)])));
 	shmem_startup_next = shmem_startup_hook;
 	shmem_startup_hook = pgstrom_startup_gstore_fdw;
 
@@ -39,6 +39,57 @@ Datum pgstrom_lo_export_gpu(PG_FUNCTION_ARGS);
 #define fn__lo_lseek64		be_lo_lseek64
 #endif
 
+/*
+ * callbacks of chunked DMA between largeobject and GPU memory
+ */
+typedef struct
+{
+	int			lo_fd;
+	size_t		lo_size;	/* only export */
+} loStreamState;
+
+static void
+__lo_import_gpu_callback(void *hbuffer, size_t offset, size_t length,
+						 void *cb_private)
+{
+	loStreamState *lo_state = cb_private;
+	char	   *pos = hbuffer;
+	int			nwritten;
+
+	while (length > 0)
+	{
+		nwritten = lo_write(lo_state->lo_fd, pos, length);
+		pos += nwritten;
+		length -= nwritten;
+	}
+}
+
+static void
+__lo_export_gpu_callback(void *hbuffer, size_t offset, size_t length,
+						 void *cb_private)
+{
+	loStreamState *lo_state = cb_private;
+	char	   *pos = hbuffer;
+	size_t		nbytes = 0;
+	int			nread;
+
+	if (offset < lo_state->lo_size)
+	{
+		nbytes = Min(length, lo_state->lo_size - offset);
+		while (nbytes > 0)
+		{
+			nread = lo_read(lo_state->lo_fd, pos, nbytes);
+			if (nread <= 0)
+				elog(ERROR, "unexpected end of the largeobject");
+			pos += nread;
+			nbytes -= nread;
+		}
+	}
+	/* zero-fill the region larger than the largeobject */
+	if (pos < (char *)hbuffer + length)
+		memset(pos, 0, (char *)hbuffer + length - pos);
+}
+
 /*
  * oid pgstrom_lo_import_gpu(
  *         int    cuda_dindex, -- index of the source GPU device
@@ -59,9 +110,7 @@ pgstrom_lo_import_gpu(PG_FUNCTION_ARGS)
 	int64		offset = PG_GETARG_INT64(2);
 	int64		length = PG_GETARG_INT64(3);
 	Oid			loid = PG_GETARG_OID(4);
-	int			lo_fd;
-	char	   *hbuffer;
-	char	   *pos;
+	loStreamState lo_state;
 	Datum		datum;
 	CUipcMemHandle ipc_mhandle;
 
@@ -74,17 +123,11 @@ pgstrom_lo_import_gpu(PG_FUNCTION_ARGS)
 			 VARSIZE_ANY_EXHDR(handle), sizeof(CUipcMemHandle));
 	memcpy(&ipc_mhandle, VARDATA_ANY(handle), sizeof(CUipcMemHandle));
 
-	if (offset <= 0)
+	if (offset < 0)
 		elog(ERROR, "wrong offset of GPU memory block: %ld", offset);
 	if (length <= 0)
 		elog(ERROR, "wrong length of GPU memory block: %ld", length);
 
-	hbuffer = MemoryContextAllocHuge(CurrentMemoryContext, length);
-	gpuIpcMemCopyToHost(hbuffer,
-						cuda_dindex,
-						ipc_mhandle,
-						offset,
-						length);
 	/*
 	 * Try to create a new largeobject, if loid is not valid.
 	 * Then, open the largeobject and truncate it if any.
@@ -98,28 +141,24 @@ pgstrom_lo_import_gpu(PG_FUNCTION_ARGS)
 	datum = DirectFunctionCall2(fn__lo_open,
 								ObjectIdGetDatum(loid),
 								Int32GetDatum(INV_WRITE));
-	lo_fd = DatumGetInt32(datum);
+	lo_state.lo_fd = DatumGetInt32(datum);
+	lo_state.lo_size = 0;
 	DirectFunctionCall2(fn__lo_truncate64,
-						Int32GetDatum(lo_fd),
+						Int32GetDatum(lo_state.lo_fd),
 						Int64GetDatum(0));
 	/*
-	 * Write out the buffer to largeobject
+	 * Write out the GPU memory to largeobject chunk by chunk; lo_write()
+	 * of the chunk overlaps DMA of the next chunk.
 	 */
-	pos = hbuffer;
-	while (length > 0)
-	{
-		int		nbytes = Min(length, (1U << 30));	/* up to 1GB at once */
-		int		nwritten;
-
-		nwritten = lo_write(lo_fd, pos, nbytes);
-		pos += nwritten;
-		length -= nwritten;
-	}
-
+	gpuIpcMemCopyToHostStream(cuda_dindex,
+							  ipc_mhandle,
+							  offset,
+							  length,
+							  __lo_import_gpu_callback,
+							  &lo_state);
 	/* close the largeobject */
 	DirectFunctionCall1(fn__lo_close,
-						Int32GetDatum(lo_fd));
-	pfree(hbuffer);
+						Int32GetDatum(lo_state.lo_fd));
 
 	PG_RETURN_OID(loid);
 }
@@ -145,10 +184,8 @@ pgstrom_lo_export_gpu(PG_FUNCTION_ARGS)
 	int64		offset = PG_GETARG_INT64(3);
 	int64		length = PG_GETARG_INT64(4);
 	int			lo_fd;
-	size_t		lo_size;
-	size_t		lo_offset;
+	loStreamState lo_state;
 	Datum		datum;
-	char	   *hbuffer;
 	CUipcMemHandle ipc_mhandle;
 
 	/* sanity checks */
@@ -160,11 +197,10 @@ pgstrom_lo_export_gpu(PG_FUNCTION_ARGS)
 			 VARSIZE_ANY_EXHDR(handle), sizeof(CUipcMemHandle));
 	memcpy(&ipc_mhandle, VARDATA_ANY(handle), sizeof(CUipcMemHandle));
 
-	if (offset <= 0)
+	if (offset < 0)
 		elog(ERROR, "wrong offset of GPU memory block: %ld", offset);
 	if (length <= 0)
 		elog(ERROR, "wrong length of GPU memory block: %ld", length);
-	hbuffer = MemoryContextAllocHuge(CurrentMemoryContext, length);
 
 	/* get length of the largeobject */
 	datum = DirectFunctionCall2(fn__lo_open,
@@ -177,36 +213,27 @@ pgstrom_lo_export_gpu(PG_FUNCTION_ARGS)
 								Int32GetDatum(lo_fd),
 								Int64GetDatum(0),
 								Int32GetDatum(SEEK_END));
-	lo_size = DatumGetInt64(datum);
-	/* rewind to the head, then read the large object */
+	lo_state.lo_fd = lo_fd;
+	lo_state.lo_size = DatumGetInt64(datum);
+	/* rewind to the head */
 	DirectFunctionCall3(fn__lo_lseek64,
-						lo_fd,
+						Int32GetDatum(lo_fd),
 						Int64GetDatum(0),
 						Int32GetDatum(SEEK_SET));
-	lo_offset = 0;
-	while (lo_offset < lo_size)
-	{
-		int		nbytes = Min(lo_size - lo_offset, (1U << 30));
-		int		nread;
-
-		nread = lo_read(lo_fd, hbuffer + lo_offset, nbytes);
-		lo_offset += nread;
-	}
-	if (lo_size < length)
-		memset(hbuffer + lo_size, 0, length - lo_size);
-
-	/* send to GPU memory chunk */
-	gpuIpcMemCopyFromHost(cuda_dindex,
-						  ipc_mhandle,
-						  offset,
-						  hbuffer,
-						  length);
-
+	/*
+	 * send to GPU memory chunk by chunk; lo_read() of the next chunk
+	 * overlaps DMA of the previous chunk.
+	 */
+	gpuIpcMemCopyFromHostStream(cuda_dindex,
+								ipc_mhandle,
+								offset,
+								length,
+								__lo_export_gpu_callback,
+								&lo_state);
 	/* release resources */
 	DirectFunctionCall1(fn__lo_close,
 						Int32GetDatum(lo_fd));
-	pfree(hbuffer);
 
-	PG_RETURN_INT64(lo_size);
+	PG_RETURN_INT64(lo_state.lo_size);
 }
 PG_FUNCTION_INFO_V1(pgstrom_lo_export_gpu);
@@ -31,11 +31,13 @@ static int	pgstrom_chunk_size_kb;
 double		pgstrom_gpu_setup_cost;
 double		pgstrom_gpu_dma_cost;
 double		pgstrom_gpu_operator_cost;
+bool		pgstrom_gpu_cost_calibration;
 
 /* misc static variables */
 static planner_hook_type	planner_hook_next;
 static CustomPathMethods	pgstrom_dummy_path_methods;
 static CustomScanMethods	pgstrom_dummy_plan_methods;
+static int					pgstrom_post_planner_cursor_options;
 /* SQL function declarations */
 Datum pgstrom_license_query(PG_FUNCTION_ARGS);
 
@@ -120,6 +122,15 @@ pgstrom_init_misc_guc(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* use of the cost factors calibrated by the benchmark */
+	DefineCustomBoolVariable("pg_strom.gpu_cost_calibration",
+							 "Enables cost factors calibrated by pgstrom.gpu_cost_calibrate()",
+							 NULL,
+							 &pgstrom_gpu_cost_calibration,
+							 false,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 }
 
 /*
@@ -319,6 +330,32 @@ pgstrom_post_planner_recurse(PlannedStmt *pstmt, Plan **p_plan)
 			}
 			break;
 
+		case T_Limit:
+			{
+				Limit	   *limit = (Limit *) plan;
+
+				/*
+				 * ORDER BY ... LIMIT may be replaced by GpuSort, unless
+				 * scrollable cursor needs backward scan on the plan.
+				 */
+				if (limit->plan.lefttree &&
+					IsA(limit->plan.lefttree, Sort) &&
+					(pgstrom_post_planner_cursor_options &
+					 CURSOR_OPT_SCROLL) == 0)
+					gpusort_post_planner(pstmt, limit);
+			}
+			break;
+
+		case T_WindowAgg:
+			/* WindowAgg may be replaced by GpuWindow */
+			gpuwindow_post_planner(pstmt, p_plan);
+			if (*p_plan != plan)
+			{
+				pgstrom_post_planner_recurse(pstmt, p_plan);
+				return;
+			}
+			break;
+
 		default:
 			break;
 	}
@@ -342,6 +379,7 @@ pgstrom_post_planner(Query *parse,
 	else
 		pstmt = standard_planner(parse, cursorOptions, boundParams);
 
+	pgstrom_post_planner_cursor_options = cursorOptions;
 	pgstrom_post_planner_recurse(pstmt, &pstmt->planTree);
 	foreach (lc, pstmt->subplans)
 		pgstrom_post_planner_recurse(pstmt, (Plan **)&lfirst(lc));
@@ -581,6 +619,8 @@ _PG_init(void)
 	pgstrom_init_gpuscan();
 	pgstrom_init_gpujoin();
 	pgstrom_init_gpupreagg();
+	pgstrom_init_gpusort();
+	pgstrom_init_gpuwindow();
 
 	/* miscellaneous initializations */
 	pgstrom_init_codegen();
@@ -22,6 +22,9 @@
 /* function declarations */
 extern Datum array_matrix_accum(PG_FUNCTION_ARGS);
 extern Datum array_matrix_accum_varbit(PG_FUNCTION_ARGS);
+extern Datum array_matrix_combine(PG_FUNCTION_ARGS);
+extern Datum array_matrix_serialize(PG_FUNCTION_ARGS);
+extern Datum array_matrix_deserialize(PG_FUNCTION_ARGS);
 extern Datum varbit_to_int4_array(PG_FUNCTION_ARGS);
 extern Datum int4_array_to_varbit(PG_FUNCTION_ARGS);
 extern Datum array_matrix_final_bool(PG_FUNCTION_ARGS);
@@ -87,6 +90,12 @@ extern Datum array_matrix_transpose_int4(PG_FUNCTION_ARGS);
 extern Datum array_matrix_transpose_int8(PG_FUNCTION_ARGS);
 extern Datum array_matrix_transpose_float4(PG_FUNCTION_ARGS);
 extern Datum array_matrix_transpose_float8(PG_FUNCTION_ARGS);
+extern Datum array_matrix_multiply_float4(PG_FUNCTION_ARGS);
+extern Datum array_matrix_multiply_float8(PG_FUNCTION_ARGS);
+extern Datum array_matrix_tmultiply_float4(PG_FUNCTION_ARGS);
+extern Datum array_matrix_tmultiply_float8(PG_FUNCTION_ARGS);
+extern Datum array_matrix_dot_float4(PG_FUNCTION_ARGS);
+extern Datum array_matrix_dot_float8(PG_FUNCTION_ARGS);
 extern Datum float4_as_int4(PG_FUNCTION_ARGS);
 extern Datum int4_as_float4(PG_FUNCTION_ARGS);
 extern Datum float8_as_int8(PG_FUNCTION_ARGS);
@@ -303,6 +312,154 @@ array_matrix_accum_varbit(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(array_matrix_accum_varbit);
 
+/*
+ * array_matrix_combine
+ *
+ * It merges the partial array_matrix_state built by parallel workers.
+ * Rows of the 2nd state are not always allocated on the aggregation
+ * context (e.g, deserialized state), so we copy them on the aggcxt.
+ */
+Datum
+array_matrix_combine(PG_FUNCTION_ARGS)
+{
+	array_matrix_state *amstate1;
+	array_matrix_state *amstate2;
+	MemoryContext	aggcxt;
+	MemoryContext	oldcxt;
+	ListCell	   *lc;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (PG_ARGISNULL(1))
+	{
+		if (PG_ARGISNULL(0))
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+	}
+	amstate2 = (array_matrix_state *)PG_GETARG_POINTER(1);
+
+	oldcxt = MemoryContextSwitchTo(aggcxt);
+	if (PG_ARGISNULL(0))
+	{
+		amstate1 = palloc0(sizeof(array_matrix_state));
+		amstate1->elemtype = amstate2->elemtype;
+	}
+	else
+	{
+		amstate1 = (array_matrix_state *)PG_GETARG_POINTER(0);
+		if (amstate1->elemtype != amstate2->elemtype)
+			elog(ERROR, "element type mismatch of array-matrix: %s and %s",
+				 format_type_be(amstate1->elemtype),
+				 format_type_be(amstate2->elemtype));
+	}
+	amstate1->width = Max(amstate1->width, amstate2->width);
+	foreach (lc, amstate2->rows)
+	{
+		struct varlena *row = lfirst(lc);
+		Size		len = VARSIZE(row);
+		struct varlena *copy = palloc(len);
+
+		memcpy(copy, row, len);
+		amstate1->rows = lappend(amstate1->rows, copy);
+	}
+	MemoryContextSwitchTo(oldcxt);
+
+	PG_RETURN_POINTER(amstate1);
+}
+PG_FUNCTION_INFO_V1(array_matrix_combine);
+
+/*
+ * array_matrix_serialize / array_matrix_deserialize
+ *
+ * Serialized form of array_matrix_state is a bytea that contains
+ * the header below, followed by MAXALIGN'ed row arrays.
+ */
+typedef struct
+{
+	Oid			elemtype;
+	cl_uint		width;
+	cl_uint		nrows;
+	cl_uint		__padding__;
+} array_matrix_state_serial;
+
+Datum
+array_matrix_serialize(PG_FUNCTION_ARGS)
+{
+	array_matrix_state *amstate;
+	array_matrix_state_serial *head;
+	bytea	   *result;
+	Size		length;
+	char	   *pos;
+	ListCell   *lc;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	amstate = (array_matrix_state *)PG_GETARG_POINTER(0);
+
+	length = VARHDRSZ + MAXALIGN(sizeof(array_matrix_state_serial));
+	foreach (lc, amstate->rows)
+		length += MAXALIGN(VARSIZE(lfirst(lc)));
+	if (!AllocSizeIsValid(length))
+		elog(ERROR, "array-matrix state is too big to serialize");
+	result = palloc0(length);
+	SET_VARSIZE(result, length);
+
+	head = (array_matrix_state_serial *)VARDATA(result);
+	head->elemtype = amstate->elemtype;
+	head->width = amstate->width;
+	head->nrows = list_length(amstate->rows);
+	pos = (char *)head + MAXALIGN(sizeof(array_matrix_state_serial));
+	foreach (lc, amstate->rows)
+	{
+		struct varlena *row = lfirst(lc);
+
+		memcpy(pos, row, VARSIZE(row));
+		pos += MAXALIGN(VARSIZE(row));
+	}
+	Assert(pos == (char *)result + length);
+
+	PG_RETURN_BYTEA_P(result);
+}
+PG_FUNCTION_INFO_V1(array_matrix_serialize);
+
+Datum
+array_matrix_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate = PG_GETARG_BYTEA_P(0);
+	array_matrix_state *amstate;
+	array_matrix_state_serial *head;
+	Size		length = VARSIZE(sstate) - VARHDRSZ;
+	char	   *buffer;
+	char	   *pos;
+	char	   *end;
+	cl_uint		i;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+	if (length < MAXALIGN(sizeof(array_matrix_state_serial)))
+		elog(ERROR, "corrupted array-matrix state");
+
+	/* rows are referenced on the MAXALIGN'ed copy of the state */
+	buffer = palloc(length);
+	memcpy(buffer, VARDATA(sstate), length);
+	head = (array_matrix_state_serial *)buffer;
+	amstate = palloc0(sizeof(array_matrix_state));
+	amstate->elemtype = head->elemtype;
+	amstate->width = head->width;
+
+	pos = buffer + MAXALIGN(sizeof(array_matrix_state_serial));
+	end = buffer + length;
+	for (i=0; i < head->nrows; i++)
+	{
+		if (pos + VARHDRSZ > end || pos + VARSIZE(pos) > end)
+			elog(ERROR, "corrupted array-matrix state");
+		amstate->rows = lappend(amstate->rows, pos);
+		pos += MAXALIGN(VARSIZE(pos));
+	}
+	PG_RETURN_POINTER(amstate);
+}
+PG_FUNCTION_INFO_V1(array_matrix_deserialize);
+
 #define ARRAY_MATRIX_FINAL_TEMPLATE(R,amstate,BASETYPE)					\
 	do {																\
 		Size		width = (amstate)->width;							\
@@ -1823,6 +1980,154 @@ array_matrix_transpose_float8(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(array_matrix_transpose_float8);
 
+/*
+ * matrix_multiply - C = A * B
+ *
+ * Both of the matrices are column-major, so the innermost loop walks on
+ * a column of A and C sequentially for better cache locality.
+ */
+#define ARRAY_MATRIX_MULTIPLY_TEMPLATE(C,A,B,BASETYPE)					\
+	do {																\
+		Size	height = ARRAY_MATRIX_HEIGHT(A);						\
+		Size	common = ARRAY_MATRIX_WIDTH(A);							\
+		Size	width  = ARRAY_MATRIX_WIDTH(B);							\
+		Size	i, j, k;												\
+		Size	length;													\
+		BASETYPE *A_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(A);		\
+		BASETYPE *B_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(B);		\
+		BASETYPE *C_values;												\
+																		\
+		if (ARRAY_MATRIX_HEIGHT(B) != common)							\
+			elog(ERROR, "matrix size mismatch: (%zu x %zu) * (%d x %zu)", \
+				 height, common, ARRAY_MATRIX_HEIGHT(B), width);		\
+		length = ARRAY_MATRIX_RAWSIZE(sizeof(BASETYPE), height, width);	\
+		if (!AllocSizeIsValid(length))									\
+			elog(ERROR, "matrix array size too large");					\
+		C = create_empty_matrix(ARRAY_MATRIX_ELEMTYPE(A), width, height); \
+		C_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(C);					\
+		memset(C_values, 0, sizeof(BASETYPE) * height * width);			\
+		for (j=0; j < width; j++)										\
+		{																\
+			BASETYPE   *C_column = C_values + j * height;				\
+																		\
+			for (k=0; k < common; k++)									\
+			{															\
+				BASETYPE	b = B_values[j * common + k];				\
+				BASETYPE   *A_column = A_values + k * height;			\
+																		\
+				for (i=0; i < height; i++)								\
+					C_column[i] += A_column[i] * b;						\
+			}															\
+			CHECK_FOR_INTERRUPTS();										\
+		}																\
+	} while(0)
+
+/*
+ * matrix_tmultiply - C = t(A) * B
+ *
+ * Every element of C is a dot product of a column of A and a column of B,
+ * so it is a handy form to build similarity matrix or Gram matrix.
+ */
+#define ARRAY_MATRIX_TMULTIPLY_TEMPLATE(C,A,B,BASETYPE)					\
+	do {																\
+		Size	common = ARRAY_MATRIX_HEIGHT(A);						\
+		Size	height = ARRAY_MATRIX_WIDTH(A);							\
+		Size	width  = ARRAY_MATRIX_WIDTH(B);							\
+		Size	i, j, k;												\
+		Size	length;													\
+		BASETYPE *A_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(A);		\
+		BASETYPE *B_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(B);		\
+		BASETYPE *C_values;												\
+																		\
+		if (ARRAY_MATRIX_HEIGHT(B) != common)							\
+			elog(ERROR, "matrix size mismatch: t(%zu x %zu) * (%d x %zu)", \
+				 common, height, ARRAY_MATRIX_HEIGHT(B), width);		\
+		length = ARRAY_MATRIX_RAWSIZE(sizeof(BASETYPE), height, width);	\
+		if (!AllocSizeIsValid(length))									\
+			elog(ERROR, "matrix array size too large");					\
+		C = create_empty_matrix(ARRAY_MATRIX_ELEMTYPE(A), width, height); \
+		C_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(C);					\
+		for (j=0; j < width; j++)										\
+		{																\
+			BASETYPE   *B_column = B_values + j * common;				\
+																		\
+			for (i=0; i < height; i++)									\
+			{															\
+				BASETYPE   *A_column = A_values + i * common;			\
+				double		sum = 0.0;									\
+																		\
+				for (k=0; k < common; k++)								\
+					sum += (double)A_column[k] * (double)B_column[k];	\
+				C_values[j * height + i] = (BASETYPE) sum;				\
+			}															\
+			CHECK_FOR_INTERRUPTS();										\
+		}																\
+	} while(0)
+
+/*
+ * matrix_dot - per-column dot products of A and B
+ */
+#define ARRAY_MATRIX_DOT_TEMPLATE(V,A,B,BASETYPE)						\
+	do {																\
+		Size	height = ARRAY_MATRIX_HEIGHT(A);						\
+		Size	width  = ARRAY_MATRIX_WIDTH(A);							\
+		Size	i, j;													\
+		BASETYPE *A_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(A);		\
+		BASETYPE *B_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(B);		\
+		BASETYPE *V_values;												\
+																		\
+		if (ARRAY_MATRIX_HEIGHT(B) != height ||							\
+			ARRAY_MATRIX_WIDTH(B) != width)								\
+			elog(ERROR, "matrix size mismatch: (%zu x %zu) . (%d x %d)", \
+				 height, width,											\
+				 ARRAY_MATRIX_HEIGHT(B), ARRAY_MATRIX_WIDTH(B));		\
+		V = create_empty_matrix(ARRAY_MATRIX_ELEMTYPE(A), 1, width);	\
+		V_values = (BASETYPE *)ARRAY_MATRIX_DATAPTR(V);					\
+		for (j=0; j < width; j++)										\
+		{																\
+			double		sum = 0.0;										\
+																		\
+			for (i=0; i < height; i++)									\
+				sum += ((double)A_values[j * height + i] *				\
+						(double)B_values[j * height + i]);				\
+			V_values[j] = (BASETYPE) sum;								\
+		}																\
+	} while(0)
+
+#define ARRAY_MATRIX_BINARY_FUNCTION(NAME,SUFFIX,TYPEOID,BASETYPE,TEMPLATE) \
+	Datum																\
+	array_matrix_##NAME##_##SUFFIX(PG_FUNCTION_ARGS)					\
+	{																	\
+		MatrixType *A = PG_GETARG_MATRIXTYPE_P(0);						\
+		MatrixType *B = PG_GETARG_MATRIXTYPE_P(1);						\
+		MatrixType *result;												\
+																		\
+		if (VARATT_IS_EXPANDED_HEADER(A) ||								\
+			!VALIDATE_ARRAY_MATRIX(A) ||								\
+			VARATT_IS_EXPANDED_HEADER(B) ||								\
+			!VALIDATE_ARRAY_MATRIX(B))									\
+			elog(ERROR, "Array is not like Matrix");					\
+		if (A->ndim > 2 || B->ndim > 2)									\
+			elog(ERROR, "array-cube is not supported");					\
+		Assert(A->elemtype == TYPEOID && B->elemtype == TYPEOID);		\
+		TEMPLATE(result,A,B,BASETYPE);									\
+		PG_RETURN_POINTER(result);										\
+	}																	\
+	PG_FUNCTION_INFO_V1(array_matrix_##NAME##_##SUFFIX)
+
+ARRAY_MATRIX_BINARY_FUNCTION(multiply, float4, FLOAT4OID, float,
+							 ARRAY_MATRIX_MULTIPLY_TEMPLATE);
+ARRAY_MATRIX_BINARY_FUNCTION(multiply, float8, FLOAT8OID, double,
+							 ARRAY_MATRIX_MULTIPLY_TEMPLATE);
+ARRAY_MATRIX_BINARY_FUNCTION(tmultiply, float4, FLOAT4OID, float,
+							 ARRAY_MATRIX_TMULTIPLY_TEMPLATE);
+ARRAY_MATRIX_BINARY_FUNCTION(tmultiply, float8, FLOAT8OID, double,
+							 ARRAY_MATRIX_TMULTIPLY_TEMPLATE);
+ARRAY_MATRIX_BINARY_FUNCTION(dot, float4, FLOAT4OID, float,
+							 ARRAY_MATRIX_DOT_TEMPLATE);
+ARRAY_MATRIX_BINARY_FUNCTION(dot, float8, FLOAT8OID, double,
+							 ARRAY_MATRIX_DOT_TEMPLATE);
+
 /*
  * postgresql_type_rawsize on behalf of type_len(regtype)
  */
@@ -319,9 +319,17 @@ errorTextKernel(kern_errorbuf *kerror)
 		KERN_ENTRY(gpupreagg_setup_column);
 		KERN_ENTRY(gpupreagg_nogroup_reduction);
 		KERN_ENTRY(gpupreagg_groupby_reduction);
+		KERN_ENTRY(gpusort_topk_local);
 		KERN_ENTRY(plcuda_prep_kernel);
 		KERN_ENTRY(plcuda_main_kernel);
 		KERN_ENTRY(plcuda_post_kernel);
+		KERN_ENTRY(gpuwindow_setup);
+		KERN_ENTRY(gpuwindow_scan_local);
+		KERN_ENTRY(gpuwindow_scan_carry);
+		KERN_ENTRY(gpuwindow_scan_final);
+		KERN_ENTRY(gpucopy_count_lines);
+		KERN_ENTRY(gpucopy_find_lines);
+		KERN_ENTRY(gpucopy_parse_lines);
 		default:
 			kernel_name = "unknown kernel";
 			break;
@@ -333,6 +341,129 @@ errorTextKernel(kern_errorbuf *kerror)
 	return buffer;
 }
 
+/*
+ * ----------------------------------------------------------------
+ *
+ * time_bucket - arbitrary width bucketing of timestamp[tz]
+ *
+ * Fixed width buckets (days and time) are aligned to 2000-01-03, the first
+ * Monday after the PostgreSQL epoch, so that weekly buckets begin on Monday.
+ * Monthly buckets are aligned to 2000-01-01. timestamptz is bucketed in UTC.
+ * Device implementation is in cuda_time_extract.h.
+ *
+ * ----------------------------------------------------------------
+ */
+#define TIME_BUCKET_ORIGIN_FIXED	(2 * USECS_PER_DAY)
+#define TIME_BUCKET_ORIGIN_YEAR		2000
+
+Datum pgstrom_time_bucket_timestamp(PG_FUNCTION_ARGS);
+Datum pgstrom_time_bucket_timestamptz(PG_FUNCTION_ARGS);
+
+static Timestamp
+time_bucket_common(Interval *width, Timestamp ts)
+{
+	Timestamp	result;
+
+	if (TIMESTAMP_NOT_FINITE(ts))
+		return ts;
+
+	if (width->month != 0)
+	{
+		struct pg_tm tm;
+		fsec_t		fsec;
+		int64		months;
+		int64		offset;
+
+		if (width->month < 0 || width->day != 0 || width->time != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("time_bucket: width must be either positive months or positive days/time")));
+		if (timestamp2tm(ts, NULL, &tm, &fsec, NULL, NULL) != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+					 errmsg("timestamp out of range")));
+		months = ((tm.tm_year - TIME_BUCKET_ORIGIN_YEAR) * MONTHS_PER_YEAR +
+				  (tm.tm_mon - 1));
+		/* int64 never overflows here, as months is at most a few millions */
+		offset = months % width->month;
+		if (offset < 0)
+			offset += width->month;
+		months -= offset;
+		tm.tm_year = (months >= 0
+					  ? months / MONTHS_PER_YEAR
+					  : -((MONTHS_PER_YEAR - 1 - months) / MONTHS_PER_YEAR));
+		tm.tm_mon = months - tm.tm_year * MONTHS_PER_YEAR + 1;
+		tm.tm_year += TIME_BUCKET_ORIGIN_YEAR;
+		tm.tm_mday = 1;
+		tm.tm_hour = 0;
+		tm.tm_min = 0;
+		tm.tm_sec = 0;
+		if (tm2timestamp(&tm, 0, NULL, &result) != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+					 errmsg("timestamp out of range")));
+	}
+	else
+	{
+		TimeOffset	period;
+		TimeOffset	offset;
+
+		if (width->day > PG_INT64_MAX / USECS_PER_DAY ||
+			width->day < PG_INT64_MIN / USECS_PER_DAY)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+					 errmsg("interval out of range")));
+		period = width->day * USECS_PER_DAY;
+		if (width->time > 0 ? period > PG_INT64_MAX - width->time
+							: period < PG_INT64_MIN - width->time)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+					 errmsg("interval out of range")));
+		period += width->time;
+		if (period <= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("time_bucket: width must be either positive months or positive days/time")));
+		/*
+		 * ts - offset is identical to ORIGIN + floor(delta / period) * period,
+		 * but never overflows in the intermediate product.
+		 */
+		offset = (ts - TIME_BUCKET_ORIGIN_FIXED) % period;
+		if (offset < 0)
+			offset += period;
+		if (ts < PG_INT64_MIN + offset)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+					 errmsg("timestamp out of range")));
+		result = ts - offset;
+		if (!IS_VALID_TIMESTAMP(result))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+					 errmsg("timestamp out of range")));
+	}
+	return result;
+}
+
+Datum
+pgstrom_time_bucket_timestamp(PG_FUNCTION_ARGS)
+{
+	Interval   *width = PG_GETARG_INTERVAL_P(0);
+	Timestamp	ts = PG_GETARG_TIMESTAMP(1);
+
+	PG_RETURN_TIMESTAMP(time_bucket_common(width, ts));
+}
+PG_FUNCTION_INFO_V1(pgstrom_time_bucket_timestamp);
+
+Datum
+pgstrom_time_bucket_timestamptz(PG_FUNCTION_ARGS)
+{
+	Interval   *width = PG_GETARG_INTERVAL_P(0);
+	TimestampTz	ts = PG_GETARG_TIMESTAMPTZ(1);
+
+	PG_RETURN_TIMESTAMPTZ(time_bucket_common(width, ts));
+}
+PG_FUNCTION_INFO_V1(pgstrom_time_bucket_timestamptz);
+
 /*
  * ----------------------------------------------------------------
  *
@@ -13,8 +13,10 @@
 #ifndef PG_STROM_H
 #define PG_STROM_H
 #include "postgres.h"
+#include "access/genam.h"
 #include "access/hash.h"
 #include "access/htup_details.h"
+#include "access/nbtree.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/sysattr.h"
@@ -30,6 +32,7 @@
 #include "catalog/objectaccess.h"
 #include "catalog/objectaddress.h"
 #include "catalog/pg_aggregate.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_attribute.h"
 #include "catalog/pg_cast.h"
 #include "catalog/pg_class.h"
@@ -70,6 +73,7 @@
 #include "nodes/primnodes.h"
 #include "nodes/readfuncs.h"
 #include "nodes/relation.h"
+#include "nodes/tidbitmap.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
@@ -86,6 +90,7 @@
 #include "port/atomics.h"
 #include "postmaster/bgworker.h"
 #include "postmaster/postmaster.h"
+#include "rewrite/rewriteManip.h"
 #include "storage/buf.h"
 #include "storage/buf_internals.h"
 #include "storage/ipc.h"
@@ -107,6 +112,7 @@
 #include "utils/bytea.h"
 #include "utils/cash.h"
 #include "utils/date.h"
+#include "utils/datetime.h"
 #include "utils/fmgroids.h"
 #include "utils/guc.h"
 #include "utils/json.h"
@@ -146,11 +152,14 @@
 #include <float.h>
 #include <limits.h>
 #include <math.h>
+#include <sched.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/vfs.h>
 
 #include "nvme_strom.h"
@@ -214,6 +223,27 @@
 
 #define GPUCTX_CMD__RECLAIM_MEMORY		0x0001
 
+/*
+ * GpuContextActivity - activity of a GpuContext on the shared memory,
+ * for pgstrom.pg_stat_gpu_activity view. Counters are updated by atomic
+ * operations, so it is cheap enough to be always enabled.
+ */
+typedef struct GpuContextActivity
+{
+	int32				backend_pid;
+	int32				cuda_dindex;
+	TimestampTz			since;				/* time of GpuContext creation */
+	pg_atomic_uint32	num_pending_tasks;	/* # of tasks in the queue */
+	pg_atomic_uint32	num_running_tasks;	/* # of tasks on worker threads */
+	pg_atomic_uint64	num_completed_tasks;
+	pg_atomic_uint64	dma_send_nbytes;
+	pg_atomic_uint64	dma_recv_nbytes;
+	pg_atomic_uint64	gpu_task_usec;		/* time to process tasks */
+	pg_atomic_uint64	gpumem_usage;		/* device memory segments */
+	pg_atomic_uint64	nvme_nbytes;		/* SSD-to-GPU Direct DMA */
+	pg_atomic_uint64	nvme_usec;
+} GpuContextActivity;
+
 typedef struct GpuContext
 {
 	dlist_node		chain;
@@ -224,6 +254,7 @@ typedef struct GpuContext
 	cl_int			cuda_dindex;
 	CUdevice		cuda_device;
 	CUcontext		cuda_context;
+	bool			cuda_context_slot;	/* holds a slot of the device */
 	CUcontext	   *cuda_context_multi;	/* valid only multi-device mode */
 	CUevent		   *cuda_events0; /* per-worker general purpose event */
 	CUevent		   *cuda_events1; /* per-worker general purpose event */
@@ -238,6 +269,8 @@ typedef struct GpuContext
 	dlist_head		gm_iomap_list;		/* list of I/O map memory segments */
 	dlist_head		gm_managed_list;	/* list of managed memory segments */
 	dlist_head		gm_hostmem_list;	/* list of Host memory segments */
+	dlist_head		gm_shared_list;		/* list of shared pool proxies */
+	struct GpuMemSlabHead *gm_slab;		/* allocator for small chunks */
 	/* error information buffer */
 	pg_atomic_uint32 error_level;
 	const char	   *error_filename;
@@ -247,11 +280,18 @@ typedef struct GpuContext
 	/* management of the work-queue */
 	bool			worker_is_running;
 	pg_atomic_uint32 *global_num_running_tasks;
+	pg_atomic_uint32 *global_sum_share_weight;
+	cl_int			num_inflight_tasks;	/* protected by mutex */
+	cl_int			share_weight;		/* weight while active, or 0 */
 	pthread_mutex_t	*mutex;				/* IPC stuff */
 	pthread_cond_t	*cond;				/* IPC stuff */
 	pg_atomic_uint32 *command;			/* IPC stuff */
+	GpuContextActivity *activity;		/* IPC stuff */
 	pg_atomic_uint32 terminate_workers;
 	dlist_head		pending_tasks;		/* list of GpuTask */
+	/* statistics to size the prefetch depth (protected by mutex) */
+	cl_double		nvme_dma_usec;		/* avg time of SSD-to-GPU DMA */
+	cl_double		nvme_kern_usec;		/* avg time of GPU kernel */
 	cl_int			num_workers;
 	pg_atomic_uint32 worker_index;
 	pthread_t		worker_threads[FLEXIBLE_ARRAY_MEMBER];
@@ -269,18 +309,45 @@ typedef enum {
 	GpuTaskKind_GpuJoin,
 	GpuTaskKind_GpuPreAgg,
 	GpuTaskKind_GpuSort,
+	GpuTaskKind_GpuWindow,
 	GpuTaskKind_PL_CUDA,
+	GpuTaskKind_RandGen,
+	GpuTaskKind_GpuCopy,
 } GpuTaskKind;
 
 typedef struct GpuTask				GpuTask;
 typedef struct GpuTaskState			GpuTaskState;
 
+/*
+ * GpuTaskRuntimeStat
+ *
+ * Breakdown of the time consumed by GPU tasks, shown by EXPLAIN ANALYZE.
+ * It is a part of the node specific run-time statistics on the shared
+ * memory, so updated by worker threads and CPU parallel workers using
+ * atomic operations. Time is in microseconds.
+ */
+#define GPUTASK_RTSTAT_MAX_KERNELS		8
+
+typedef struct GpuTaskRuntimeStat
+{
+	pg_atomic_uint64	jit_build_usec;		/* wait for JIT build/load */
+	pg_atomic_uint64	queue_wait_usec;	/* wait in the pending queue */
+	pg_atomic_uint64	dma_send_nbytes;
+	pg_atomic_uint64	dma_send_usec;
+	pg_atomic_uint64	dma_recv_nbytes;
+	pg_atomic_uint64	dma_recv_usec;
+	pg_atomic_uint64	cpu_fallback_usec;
+	pg_atomic_uint64	kern_ncalls[GPUTASK_RTSTAT_MAX_KERNELS];
+	pg_atomic_uint64	kern_usec[GPUTASK_RTSTAT_MAX_KERNELS];
+} GpuTaskRuntimeStat;
+
 /*
  * GpuTaskState
  *
  * A common structure of the state machine of GPU related tasks.
  */
 struct NVMEScanState;
+struct GpuScanBrinState;
 
 struct GpuTaskState
 {
@@ -289,9 +356,18 @@ struct GpuTaskState
 	GpuTaskKind		task_kind;		/* one of GpuTaskKind_* */
 	ProgramId		program_id;		/* CUDA Program (to be acquired) */
 	kern_parambuf  *kern_params;	/* Const/Param buffer */
+	cl_uint			varlena_bufsz;	/* varlena buffer per row on device */
 	Relids			ccache_refs;	/* referenced attributed, if ccache */
+	List		   *ccache_zone_quals; /* quals to check zone-map of ccache */
 	long			ccache_count;	/* # of ccache hit */
 	bool			scan_done;		/* True, if no more rows to read */
+	/*
+	 * Bound of the number of rows to be required by the upper node, like
+	 * LIMIT clause, or -1 if unknown. Once @tuple_bound_nitems reached the
+	 * bound, no more tasks are launched and pending ones are cancelled.
+	 */
+	cl_long			tuple_bound;
+	cl_long			tuple_bound_nitems;
 
 	/* fields for outer scan */
 	Cost			outer_startup_cost;	/* copy from the outer path node */
@@ -312,6 +388,16 @@ struct GpuTaskState
 	 * as source data store. Then, SSD2GPU Direct SQL Execution will be kicked.
 	 */
 	struct NVMEScanState *nvme_sstate;
+	struct GpuScanBrinState *brin_sstate; /* block filter by BRIN index */
+	BlockNumber		prefetch_blknum; /* next block to be prefetched */
+
+	/*
+	 * Adaptive chunk size of KDS_FORMAT_ROW; see pgstromGpuTaskStateChunkSize.
+	 * @chunk_usec_per_mb is moving average of the GPU kernel time per MB,
+	 * updated by worker threads (protected with GpuContext->mutex).
+	 */
+	Size			chunk_size_curr;
+	cl_double		chunk_usec_per_mb;
 
 	/*
 	 * fields to fetch rows from the current task
@@ -327,6 +413,13 @@ struct GpuTaskState
 	cl_long			curr_index;		/* current position on the curr_task */
 	cl_long			curr_lp_index;	/* index of LinePointer in a block */
 	HeapTupleData	curr_tuple;		/* internal use of PDS_fetch() */
+	/*
+	 * A slot which references tts_values/tts_isnull on KDS_FORMAT_SLOT
+	 * directly, and its original arrays to be restored; see PDS_fetch().
+	 */
+	TupleTableSlot *curr_ref_slot;
+	Datum		   *curr_ref_values;
+	bool		   *curr_ref_isnull;
 	struct GpuTask *curr_task;	/* a GpuTask currently processed */
 
 	/* callbacks used by gputasks.c */
@@ -338,6 +431,12 @@ struct GpuTaskState
 	int			  (*cb_process_task)(GpuTask *gtask,
 									 CUmodule cuda_module);
 	void		  (*cb_release_task)(GpuTask *gtask);
+	/* optional; it prepares the task for CPU execution during JIT build */
+	bool		  (*cb_async_fallback)(GpuTask *gtask);
+	/* optional; it kicks DMA of the task prior to cb_process_task */
+	bool		  (*cb_prefetch_task)(GpuTask *gtask);
+	/* optional; number of rows the task returns for sure, or -1 */
+	cl_long		  (*cb_task_nitems)(GpuTask *gtask);
 	/* list of GpuTasks (protexted with GpuContext->mutex) */
 	dlist_head		ready_tasks;	/* list of tasks already processed */
 	cl_uint			num_running_tasks;	/* # of running tasks */
@@ -346,6 +445,20 @@ struct GpuTaskState
 	/* misc fields */
 	cl_long			num_cpu_fallbacks;	/* # of CPU fallback chunks */
 
+	/*
+	 * Run-time statistics for EXPLAIN ANALYZE. @gt_rtstat points the portion
+	 * of the node specific statistics, and @kern_names is NULL-terminated
+	 * array of the GPU kernel names being tracked.
+	 */
+	GpuTaskRuntimeStat *gt_rtstat;
+	const char	  **kern_names;
+
+	/*
+	 * Label of the NVTX ranges, like "GpuScan (query=1234, node=2)", or
+	 * NULL if pg_strom.enable_nvtx is off. Worker threads never modify it.
+	 */
+	char		   *nvtx_label;
+
 	/* co-operation with CPU parallel */
 	ParallelContext	*pcxt;
 };
@@ -368,6 +481,7 @@ struct GpuTask
 	ProgramId		program_id;		/* same with GTS's one */
 	GpuTaskState   *gts;			/* GTS reference in the backend */
 	bool			cpu_fallback;	/* true, if task needs CPU fallback */
+	TimestampTz		tv_enqueue;		/* time when task is enqueued */
 };
 
 /*
@@ -376,7 +490,9 @@ struct GpuTask
 #define DEVKERNEL_NEEDS_GPUSCAN			0x00000001	/* GpuScan logic */
 #define DEVKERNEL_NEEDS_GPUJOIN			0x00000002	/* GpuJoin logic */
 #define DEVKERNEL_NEEDS_GPUPREAGG		0x00000004	/* GpuPreAgg logic */
-//#define DEVKERNEL_NEEDS_GPUSORT			0x00000008	/* GpuSort logic */
+#define DEVKERNEL_NEEDS_GPUSORT			0x00000008	/* GpuSort logic */
+#define DEVKERNEL_NEEDS_GPUWINDOW		0x00000010	/* GpuWindow logic */
+#define DEVKERNEL_NEEDS_GPUCOPY			0x00000020	/* GPU COPY FROM logic */
 #define DEVKERNEL_NEEDS_PLCUDA			0x00000080	/* PL/CUDA related */
 
 #define DEVKERNEL_NEEDS_DYNPARA			0x00000100	/* aks, device runtime */
@@ -389,6 +505,9 @@ struct GpuTask
 #define DEVKERNEL_NEEDS_RANGETYPE		0x00008000
 #define DEVKERNEL_NEEDS_PRIMITIVE		0x00010000
 #define DEVKERNEL_NEEDS_TIME_EXTRACT	0x00020000
+#define DEVKERNEL_NEEDS_JSONLIB		   (0x00040000 |				\
+										DEVKERNEL_NEEDS_TEXTLIB |	\
+										DEVKERNEL_NEEDS_NUMERIC)
 
 #define DEVKERNEL_NEEDS_CURAND			0x00100000
 #define DEVKERNEL_BUILD_DEBUG_INFO		0x80000000
@@ -437,12 +556,24 @@ typedef struct devfunc_info {
 	devtype_info *func_rettype;	/* result type by devtype_info */
 	const char *func_sqlname;	/* name of the function in SQL side */
 	const char *func_devname;	/* name of the function in device side */
+	bool		func_needs_vlbuf;	/* True, if it uses varlena buffer */
 } devfunc_info;
 
 /*
  * pgstrom_data_store - a data structure with various format to exchange
  * a data chunk between the host and CUDA server.
  */
+/*
+ * PDSZeroCopyBlock - an all-visible block on the shared buffer, to be read
+ * by GPU kernel directly, instead of memcpy() to the PDS.
+ */
+typedef struct PDSZeroCopyBlock
+{
+	Buffer			buffer;		/* kept pinned until the task is consumed */
+	BlockNumber		blknum;
+	XLogRecPtr		lsn;		/* page LSN when the block was picked up */
+} PDSZeroCopyBlock;
+
 typedef struct pgstrom_data_store
 {
 	/* used to chain multiple PDSs */
@@ -460,14 +591,46 @@ typedef struct pgstrom_data_store
 	 * by NVMe-Strom. If @nblocks_uncached > 0, the tail of PDS shall be
 	 * filled up by an array of strom_dma_chunk.
 	 * @filedesc is file-descriptor of the underlying blocks.
+	 * KDS_FORMAT_COLUMN loaded from the columnar cache may also have
+	 * @nblocks_uncached > 0; which is number of BLCKSZ chunks of the ccache
+	 * file at the tail of KDS, to be processed by NVMe-Strom. In this case,
+	 * the array of chunk-ids is located next to the KDS, and @filedesc is
+	 * the ccache file owned by the PDS.
 	 */
 	cl_uint				nblocks_uncached;
 	cl_int				filedesc;
 
+	/*
+	 * NOTE: @nblocks_zcopy is number of the blocks of KDS_FORMAT_BLOCK to
+	 * be copied from the shared buffer by GPU kernel. These blocks are
+	 * located next to the blocks already loaded, and the host portion
+	 * of them are not valid unless PDS_materialize_zero_copy() is called.
+	 */
+	cl_uint				nblocks_zcopy;
+	PDSZeroCopyBlock   *zcopy_blocks;
+
+	/*
+	 * NOTE: KDS_FORMAT_COLUMN loaded from the columnar cache may be built
+	 * on the memory-mapped ccache file (@mmap_base != NULL). In this case,
+	 * KDS is the file image itself, and the PDS header is located just in
+	 * front of the mapping. @kds_dev is the header of the device image
+	 * which contains only the referenced columns; see
+	 * gpuMemCopyFromMappedColumn().
+	 */
+	void			   *mmap_base;
+	size_t				mmap_length;
+	kern_data_store	   *kds_dev;
+
 	/* data chunk in kernel portion */
 	kern_data_store kds	__attribute__ ((aligned (STROMALIGN_LEN)));
 } pgstrom_data_store;
 
+/* KDS header of the image on the device */
+#define PDS_DEVICE_KDS_HEAD(pds)							\
+	((pds)->kds_dev ? (pds)->kds_dev : &(pds)->kds)
+#define PDS_CCACHE_CHUNK_IDS(pds)							\
+	((BlockNumber *)((char *)&(pds)->kds + (pds)->kds.length))
+
 /*
  * State structure of NVMe-Strom per GpuTaskState
  */
@@ -477,10 +640,26 @@ typedef struct NVMEScanState
 	cl_uint			nblocks_per_chunk;
 	BlockNumber		curr_segno;
 	Buffer			curr_vmbuffer;
+	bool			gpu_mvcc;	/* GPU checks visibility of the blocks
+								 * not all-visible */
+	bool			zero_copy;	/* GPU reads all-visible blocks from the
+								 * shared buffer directly */
 	BlockNumber		nr_segs;
 	int				fdesc[FLEXIBLE_ARRAY_MEMBER];
 } NVMEScanState;
 
+/*
+ * State of SSD-to-GPU Direct DMA kicked asynchronously
+ */
+typedef struct NVMEDmaState
+{
+	bool			is_running;		/* true, if DMA is not waited yet */
+	unsigned long	dma_task_id;	/* ID of the DMA task */
+	cl_uint			nr_ram2gpu;		/* # of chunks written back to RAM */
+	cl_uint			nr_ssd2gpu;		/* # of chunks loaded from SSD */
+	TimestampTz		tv_kicked;		/* timestamp when DMA was kicked */
+} NVMEDmaState;
+
 /*
  * --------------------------------------------------------------------
  *
@@ -498,6 +677,8 @@ typedef struct DevAttributes
 	char		DEV_NAME[256];
 	size_t		DEV_TOTAL_MEMSZ;
 	cl_int		CORES_PER_MPU;
+	cl_int		DEV_NUMA_NODE;		/* -1, if unknown */
+	char		DEV_PCIE_PATH[256];	/* sysfs path of the PCI device */
 #define DEV_ATTR(LABEL,a,b,c)					\
 	cl_int		LABEL;
 #include "device_attrs.h"
@@ -509,7 +690,11 @@ extern cl_int			numDevAttrs;
 extern cl_ulong			devComputeCapability;
 extern cl_uint			devBaselineMaxThreadsPerBlock;
 
+extern cl_ulong GetOptimalGpusForFile(int fdesc);
 extern void pgstrom_init_gpu_device(void);
+extern void pgstrom_gpu_cost_factors(double *p_gpu_setup_cost,
+									 double *p_gpu_dma_cost,
+									 double *p_gpu_operator_cost);
 #if 1
 extern void largest_workgroup_size(size_t *p_grid_size,
 								   size_t *p_block_size,
@@ -559,6 +744,11 @@ extern CUresult __gpuMemAllocIOMap(GpuContext *gcontext,
 								   CUdeviceptr *p_devptr,
 								   size_t bytesize,
 								   const char *filename, int lineno);
+extern CUresult __gpuMemAllocOversubscribe(GpuContext *gcontext,
+											CUdeviceptr *p_devptr,
+											size_t bytesize,
+											size_t read_mostly_sz,
+											const char *filename, int lineno);
 extern CUresult __gpuMemAllocHost(GpuContext *gcontext,
 								  void **p_hostptr,
 								  size_t bytesize,
@@ -590,6 +780,22 @@ extern void gpuIpcMemCopyToHost(void *hbuffer,
 								CUipcMemHandle m_handle,
 								size_t offset,
 								size_t length);
+typedef void (*gpuIpcMemCopyCallback)(void *hbuffer,
+									  size_t offset,
+									  size_t length,
+									  void *cb_private);
+extern void gpuIpcMemCopyFromHostStream(cl_int cuda_dindex,
+										CUipcMemHandle m_handle,
+										size_t offset,
+										size_t length,
+										gpuIpcMemCopyCallback callback,
+										void *cb_private);
+extern void gpuIpcMemCopyToHostStream(cl_int cuda_dindex,
+									  CUipcMemHandle m_handle,
+									  size_t offset,
+									  size_t length,
+									  gpuIpcMemCopyCallback callback,
+									  void *cb_private);
 #define gpuMemAllocRaw(a,b,c)				\
 	__gpuMemAllocRaw((a),(b),(c),__FILE__,__LINE__)
 #define gpuMemAllocManagedRaw(a,b,c,d)		\
@@ -604,6 +810,8 @@ extern void gpuIpcMemCopyToHost(void *hbuffer,
 	__gpuMemAllocManaged((a),(b),(c),(d),__FILE__,__LINE__)
 #define gpuMemAllocIOMap(a,b,c)				\
 	__gpuMemAllocIOMap((a),(b),(c),__FILE__,__LINE__)
+#define gpuMemAllocOversubscribe(a,b,c,d)	\
+	__gpuMemAllocOversubscribe((a),(b),(c),(d),__FILE__,__LINE__)
 #define gpuMemAllocHost(a,b,c)				\
 	__gpuMemAllocHost((a),(b),(c),__FILE__,__LINE__)
 #define gpuMemAllocPreserved(a,b,c)						\
@@ -611,9 +819,20 @@ extern void gpuIpcMemCopyToHost(void *hbuffer,
 #define gpuIpcOpenMemHandle(a,b,c,d)		\
 	__gpuIpcOpenMemHandle((a),(b),(c),(d),__FILE__,__LINE__)
 
+extern void gpuMemAdvisePreferDevice(GpuContext *gcontext,
+									 CUdeviceptr m_deviceptr,
+									 size_t bytesize,
+									 size_t read_mostly_sz);
 extern void gpuMemReclaimSegment(GpuContext *gcontext);
 
+extern void gpuMemCopyFromSSDAsync(CUdeviceptr m_kds, pgstrom_data_store *pds,
+								   NVMEDmaState *dma_state);
+extern void gpuMemCopyFromSSDWait(CUdeviceptr m_kds, pgstrom_data_store *pds,
+								  NVMEDmaState *dma_state);
 extern void gpuMemCopyFromSSD(CUdeviceptr m_kds, pgstrom_data_store *pds);
+extern void gpuMemCopyFromMappedColumn(CUdeviceptr m_kds,
+									   pgstrom_data_store *pds);
+extern bool gpuMemRegisterSharedBuffers(GpuContext *gcontext);
 
 extern void pgstrom_gpu_mmgr_init_gpucontext(GpuContext *gcontext);
 extern void pgstrom_gpu_mmgr_cleanup_gpucontext(GpuContext *gcontext);
@@ -643,6 +862,12 @@ extern void GpuContextWorkerReportError(int elevel,
 										const char *funcname,
 										const char *fmt, ...)
 	pg_attribute_printf(5,6);
+extern void GpuContextDispatchTask(GpuContext *gcontext);
+extern void GpuContextCompleteTask(GpuContext *gcontext);
+extern bool GpuContextCanDispatchTask(GpuContext *gcontext);
+extern void GpuContextUpdateNvmeStat(GpuContext *gcontext,
+									 double dma_usec, double kern_usec);
+extern void GpuContextRequestReclaimMemory(GpuContext *gcontext);
 
 static inline void
 CHECK_FOR_GPUCONTEXT(GpuContext *gcontext)
@@ -802,6 +1027,19 @@ extern void pgstromReleaseGpuTaskState(GpuTaskState *gts);
 extern void pgstromExplainGpuTaskState(GpuTaskState *gts,
 									   ExplainState *es);
 extern GpuTask *fetch_next_gputask(GpuTaskState *gts);
+extern Size pgstromGpuTaskStateChunkSize(GpuTaskState *gts);
+extern void pgstromUpdateChunkKernTime(GpuTaskState *gts,
+									   Size chunk_size, double kern_usec);
+extern void pgstromStatTimingBegin(GpuTaskState *gts);
+extern void pgstromStatDmaSend(GpuTaskState *gts, size_t nbytes);
+extern void pgstromStatDmaRecv(GpuTaskState *gts, size_t nbytes);
+extern void pgstromStatKernelExec(GpuTaskState *gts, const char *kern_name,
+								  bool needs_sync);
+extern void pgstromStatQueueWait(GpuTask *gtask);
+extern void pgstromStatJitBuild(GpuTaskState *gts, TimestampTz tv_begin);
+extern bool	pgstrom_enable_nvtx;		/* GUC */
+extern uint64 pgstromNvtxRangeStart(GpuTaskState *gts, const char *event);
+extern void pgstromNvtxRangeEnd(uint64 range_id);
 extern void pgstromExplainOuterScan(GpuTaskState *gts,
 									List *deparse_context,
 									List *ancestors,
@@ -835,6 +1073,7 @@ extern void pgstrom_build_session_info(StringInfo str,
 									   GpuTaskState *gts,
 									   cl_uint extra_flags);
 extern bool pgstrom_try_build_cuda_program(void);
+extern bool pgstrom_cuda_program_is_ready(ProgramId program_id);
 
 extern char *pgstrom_cuda_source_string(ProgramId program_id);
 extern const char *pgstrom_cuda_source_file(ProgramId program_id);
@@ -856,7 +1095,9 @@ typedef struct {
 	const char *kds_label;	/* label to reference kds, if exist */
 	const char *kds_index_label; /* label to reference kds_index, if exist */
 	List	   *pseudo_tlist;/* pseudo tlist expression, if any */
+	List	   *cse_exprs;	/* common subexpressions on CSE_%u, if any */
 	int			extra_flags;/* external libraries to be included */
+	cl_uint		varlena_bufsz;/* required size of varlena buffer per row */
 } codegen_context;
 
 extern void pgstrom_codegen_typeoid_declarations(StringInfo buf);
@@ -869,8 +1110,11 @@ extern devfunc_info *pgstrom_devfunc_lookup_type_compare(devtype_info *dtype,
 														 Oid type_collid);
 extern void pgstrom_devfunc_track(codegen_context *context,
 								  devfunc_info *dfunc);
+extern cl_uint pgstrom_timezone_name_hash(const char *tzname);
 
 extern char *pgstrom_codegen_expression(Node *expr, codegen_context *context);
+extern char *pgstrom_codegen_common_subexprs(List *exprs,
+											 codegen_context *context);
 extern void pgstrom_codegen_param_declarations(StringInfo buf,
 											   codegen_context *context);
 extern bool __pgstrom_device_expression(Expr *expr,
@@ -890,6 +1134,7 @@ extern bool KDS_fetch_tuple_column(TupleTableSlot *slot,
 extern bool PDS_fetch_tuple(TupleTableSlot *slot,
 							pgstrom_data_store *pds,
 							GpuTaskState *gts);
+extern void PDS_restore_slot_reference(GpuTaskState *gts);
 extern pgstrom_data_store *__PDS_clone(pgstrom_data_store *pds,
 									   const char *filename, int lineno);
 extern pgstrom_data_store *PDS_retain(pgstrom_data_store *pds);
@@ -934,6 +1179,11 @@ extern void PDS_init_heapscan_state(GpuTaskState *gts,
 extern void PDS_end_heapscan_state(GpuTaskState *gts);
 extern bool PDS_exec_heapscan(GpuTaskState *gts,
 							  pgstrom_data_store *pds);
+extern bool PDS_recheck_visibility(GpuTaskState *gts, HeapTuple tuple);
+extern bool PDS_check_zero_copy(pgstrom_data_store *pds);
+extern void PDS_materialize_zero_copy(GpuTaskState *gts,
+									  pgstrom_data_store *pds);
+extern void PDS_unpin_zero_copy(pgstrom_data_store *pds);
 extern cl_uint NVMESS_NBlocksPerChunk(struct NVMEScanState *nvme_sstate);
 
 #define PGSTROM_DATA_STORE_BLOCK_FILEPOS(pds)							\
@@ -951,7 +1201,9 @@ extern bool KDS_insert_hashitem(kern_data_store *kds,
 								cl_uint hash_value);
 
 extern bool ScanPathWillUseNvmeStrom(PlannerInfo *root, RelOptInfo *baserel);
+extern bool DirectoryCanUseNvmeStrom(int dir_fdesc);
 extern bool RelationCanUseNvmeStrom(Relation relation);
+extern int	RelationGetOptimalGpuDevice(Relation relation);
 extern bool RelationWillUseNvmeStrom(Relation relation,
 									 BlockNumber *p_nr_blocks);
 extern void pgstrom_init_datastore(void);
@@ -973,6 +1225,7 @@ extern Cost cost_for_dma_receive(RelOptInfo *rel, double ntuples);
 extern void codegen_gpuscan_quals(StringInfo kern,
 								  codegen_context *context,
 								  Index scanrelid,
+								  Oid relid,
 								  Expr *dev_quals);
 extern bool add_unique_expression(Expr *expr, List **p_tlist, bool resjunk);
 extern bool pgstrom_pullup_outer_scan(const Path *outer_path,
@@ -981,6 +1234,9 @@ extern bool pgstrom_pullup_outer_scan(const Path *outer_path,
 extern bool pgstrom_path_is_gpuscan(const Path *path);
 extern bool pgstrom_plan_is_gpuscan(const Plan *plan);
 extern bool pgstrom_planstate_is_gpuscan(const PlanState *ps);
+extern bool pgstrom_gpuscan_mvcc_check;
+extern bool pgstrom_heapscan_prefetch;
+extern bool pgstrom_gpuscan_zero_copy;
 
 extern void gpuscan_rewind_position(GpuTaskState *gts);
 
@@ -988,6 +1244,11 @@ extern pgstrom_data_store *gpuscanExecScanChunk(GpuTaskState *gts);
 
 extern void gpuscanRewindScanChunk(GpuTaskState *gts);
 
+extern CUdeviceptr gpuscan_unpack_column_store(GpuContext *gcontext,
+											   CUmodule cuda_module,
+											   kern_data_store *kds_head,
+											   CUdeviceptr m_kds_src);
+
 extern Size ExecGpuScanEstimateDSM(CustomScanState *node,
 								   ParallelContext *pcxt);
 extern void ExecGpuScanInitDSM(CustomScanState *node,
@@ -1019,6 +1280,7 @@ extern void	pgstrom_init_gpujoin(void);
 extern Size GpuJoinSetupTask(struct kern_gpujoin *kgjoin,
 							 GpuTaskState *gts,
 							 pgstrom_data_store *pds_src);
+extern void gpujoinResetHashCache(struct kern_gpujoin *kgjoin);
 extern ProgramId GpuJoinCreateCombinedProgram(PlanState *node,
 											  GpuTaskState *gpa_gts,
 											  cl_uint gpa_extra_flags,
@@ -1028,6 +1290,7 @@ extern bool GpuJoinInnerPreload(GpuTaskState *gts, CUdeviceptr *p_m_kmrels);
 extern void GpuJoinInnerUnload(GpuTaskState *gts, bool is_rescan);
 extern pgstrom_data_store *GpuJoinExecOuterScanChunk(GpuTaskState *gts);
 extern bool gpujoinHasRightOuterJoin(GpuTaskState *gts);
+extern bool gpujoinHasInnerPartitions(PlanState *ps);
 extern int  gpujoinNextRightOuterJoin(GpuTaskState *gts);
 extern void gpujoinSyncRightOuterJoin(GpuTaskState *gts);
 extern void gpujoinColocateOuterJoinMaps(GpuTaskState *gts,
@@ -1050,6 +1313,19 @@ extern void assign_gpupreagg_session_info(StringInfo buf,
 										  GpuTaskState *gts);
 extern void pgstrom_init_gpupreagg(void);
 
+/*
+ * gpusort.c
+ */
+extern bool pgstrom_plan_is_gpusort(const Plan *plan);
+extern void gpusort_post_planner(PlannedStmt *pstmt, Limit *limit);
+extern void pgstrom_init_gpusort(void);
+
+/*
+ * gpuwindow.c
+ */
+extern void gpuwindow_post_planner(PlannedStmt *pstmt, Plan **p_plan);
+extern void pgstrom_init_gpuwindow(void);
+
 /*
  * pl_cuda.c
  */
@@ -1088,6 +1364,7 @@ extern void ccache_setup_buffer(TupleDesc tupdesc,
 								MemoryContext memcxt);
 extern void ccache_expand_buffer(TupleDesc tupdesc,
 								 ccacheBuffer *cc_buf,
+								 size_t nrooms_min,
 								 MemoryContext memcxt);
 extern void ccache_release_buffer(ccacheBuffer *cc_buf);
 extern void ccache_buffer_append_row(TupleDesc tupdesc,
@@ -1100,6 +1377,14 @@ extern void ccache_copy_buffer_from_kds(TupleDesc tupdesc,
 										ccacheBuffer *cc_buf,
 										kern_data_store *kds,
 										MemoryContext mcxt);
+extern size_t ccache_buffer_column_length(TupleDesc tupdesc,
+										  ccacheBuffer *cc_buf,
+										  int j, size_t nrooms);
+extern size_t ccache_copy_buffer_column(kern_data_store *kds,
+										TupleDesc tupdesc,
+										ccacheBuffer *cc_buf,
+										bits8 *rowmap, size_t nrooms,
+										int j, char *dest, size_t offset);
 extern void ccache_copy_buffer_to_kds(kern_data_store *kds,
 									  TupleDesc tupdesc,
 									  ccacheBuffer *cc_buf,
@@ -1130,7 +1415,14 @@ extern pgstrom_data_store *
 pgstrom_ccache_load_chunk(struct ccacheChunk *cc_chunk,
 						  GpuContext *gcontext,
 						  Relation relation,
-						  Relids ccache_refs);
+						  Relids ccache_refs,
+						  bool try_nvme_strom);
+extern List *pgstrom_ccache_zonemap_quals(Relation relation,
+										  Index scanrelid,
+										  List *quals);
+extern bool pgstrom_ccache_check_zonemap(struct ccacheChunk *cc_chunk,
+										 Relation relation,
+										 List *zone_quals);
 extern void pgstrom_init_ccache(void);
 
 /*
@@ -1139,6 +1431,11 @@ extern void pgstrom_init_ccache(void);
 extern bool type_is_reggstore(Oid type_oid);
 extern Oid	get_reggstore_type_oid(void);
 #define REGGSTOREOID		get_reggstore_type_oid()
+extern bool relation_is_gstore_fdw(Oid table_oid);
+extern int  gstore_fdw_pinning_device(Oid gstore_oid);
+extern CUdeviceptr gstore_fdw_open_device_memory(GpuContext *gcontext,
+												 Relation frel,
+												 bool *p_ipcmem);
 extern int  gstore_fdw_preferable_device(FunctionCallInfo fcinfo);
 extern void gstore_fdw_load_function_args(GpuContext *gcontext,
 										  FunctionCallInfo fcinfo,
@@ -1170,6 +1467,7 @@ extern int		pgstrom_max_async_tasks;
 extern double	pgstrom_gpu_setup_cost;
 extern double	pgstrom_gpu_dma_cost;
 extern double	pgstrom_gpu_operator_cost;
+extern bool		pgstrom_gpu_cost_calibration;
 extern double	pgstrom_nrows_growth_ratio_limit;
 extern double	pgstrom_nrows_growth_margin;
 extern double	pgstrom_chunk_size_margin;
@@ -63,6 +63,12 @@ typedef struct plcudaCodeProperty
 	/* device memory size for result buffer */
 	Oid			fn_results_bufsz;
 	long		val_results_bufsz;
+	/* number of devices to run the kernels */
+	Oid			fn_num_devices;
+	long		val_num_devices;
+	/* number of chunks to stream the main kernel */
+	Oid			fn_num_chunks;
+	long		val_num_chunks;
 	/* comprehensive functions */
 	Oid			fn_sanity_check;
 	Oid			fn_cpu_fallback;
@@ -70,6 +76,16 @@ typedef struct plcudaCodeProperty
 	List	   *composite_types;
 } plcudaCodeProperty;
 
+/*
+ * plcudaArgCache - device copy of a large varlena argument
+ */
+typedef struct plcudaArgCache
+{
+	CUdeviceptr		m_buffer;	/* device copy of the argument */
+	size_t			length;		/* length of the argument */
+	void		   *shadow;		/* host copy to detect updates */
+} plcudaArgCache;
+
 /*
  * plcudaTaskState
  */
@@ -80,6 +96,17 @@ typedef struct plcudaTaskState
 	dlist_node		chain;
 	kern_plcuda	   *kplcuda_head;
 	CUdeviceptr		last_results_buf;	/* results buffer last used */
+	Size			last_results_bufsz;
+	CUdeviceptr		m_task_buf;		/* plcudaTask buffer last used */
+	Size			task_bufsz;
+	plcudaArgCache *arg_cache;	/* device copy of large arguments */
+	TupleDesc		results_tupdesc;	/* result rows, if SETOF function */
+	char		   *kern_source;	/* to build for the secondary devices */
+	char		   *kern_define;
+	/* state per secondary device (#plcuda_num_devices) */
+	struct plcudaTaskState *primary;	/* primary state, if secondary */
+	int				num_sub_plts;
+	struct plcudaTaskState **sub_plts;
 	/* property of the code block */
 	plcudaCodeProperty p;
 	/* property of the PL/CUDA kernel functions */
@@ -110,9 +137,12 @@ typedef struct plcudaTask
 	bool			exec_post_kernel;
 	bool			has_cpu_fallback;
 	CUdeviceptr		m_results_buf;	/* results buffer as unified memory */
+	bool			results_buf_shared;	/* m_results_buf of the primary */
+	bool			stream_results;	/* download results per chunk */
 	List		   *gstore_oid_list;	/* OID of GpuStore foreign table */
 	List		   *gstore_devptr_list;	/* CUdeviceptr of GpuStore */
 	List		   *gstore_dindex_list;	/* Preferable dindex if any */
+	plcudaArgCache *arg_cache;	/* reference to plts->arg_cache */
 	kern_plcuda		kern;
 } plcudaTask;
 
@@ -133,6 +163,9 @@ Datum plcuda_kernel_dynamic_shmsz(PG_FUNCTION_ARGS);
 Datum plcuda_kernel_const_memsz(PG_FUNCTION_ARGS);
 Datum plcuda_kernel_local_memsz(PG_FUNCTION_ARGS);
 
+/* GUC variables */
+static int	plcuda_arg_cache_threshold;	/* kB; -1 to disable */
+
 /* Tracker of plcudaState */
 static dlist_head	plcuda_state_list;
 
@@ -381,6 +414,8 @@ ident_to_cstring(List *ident)
  * #plcuda_include <function>
  * #plcuda_results_bufsz {<value>|<function>}     (default: 0)
  * #plcuda_working_bufsz {<value>|<function>}      (default: 0)
+ * #plcuda_num_devices {<value>|<function>}       (default: 1)
+ * #plcuda_num_chunks {<value>|<function>}        (default: 1)
  * #plcuda_sanity_check {<function>}             (default: no fallback)
  * #plcuda_cpu_fallback {<function>}             (default: no fallback)
  */
@@ -402,6 +437,8 @@ typedef struct {
 	bool				has_post_block;
 	bool				has_working_bufsz;
 	bool				has_results_bufsz;
+	bool				has_num_devices;
+	bool				has_num_chunks;
 	bool				has_sanity_check;
 	bool				has_cpu_fallback;
 	List			   *include_func_oids;
@@ -430,6 +467,8 @@ plcuda_init_code_context(plcuda_code_context *context,
 	context->p.val_prep_num_threads = 1;
 	context->p.val_main_num_threads = 1;
 	context->p.val_post_num_threads = 1;
+	context->p.val_num_devices = 1;
+	context->p.val_num_chunks = 1;
 }
 
 static void __plcuda_code_include(plcuda_code_context *con,
@@ -770,6 +809,50 @@ __plcuda_code_validation(plcuda_code_context *con,
 					EMSG("\"%s\" was not a valid value or function",
 						 ident_to_cstring(options));
 			}
+			else if (strcmp(cmd, "#plcuda_num_devices") == 0)
+			{
+				if (con->has_num_devices)
+					EMSG("%s appeared twice", cmd);
+				else if (plcuda_lookup_helper(options,
+											  con->proargtypes, INT8OID,
+											  &prop->fn_num_devices,
+											  &prop->val_num_devices))
+				{
+					if (HELPER_PRIV_CHECK(prop->fn_num_devices))
+						con->has_num_devices = true;
+					else
+						EMSG("permission denied on helper function %s",
+							 NameListToString(options));
+				}
+				else if (con->not_exec_now)
+					NOTE("\"%s\" may be a function but not declared yet",
+						 ident_to_cstring(options));
+				else
+					EMSG("\"%s\" was not a valid value or function",
+						 ident_to_cstring(options));
+			}
+			else if (strcmp(cmd, "#plcuda_num_chunks") == 0)
+			{
+				if (con->has_num_chunks)
+					EMSG("%s appeared twice", cmd);
+				else if (plcuda_lookup_helper(options,
+											  con->proargtypes, INT8OID,
+											  &prop->fn_num_chunks,
+											  &prop->val_num_chunks))
+				{
+					if (HELPER_PRIV_CHECK(prop->fn_num_chunks))
+						con->has_num_chunks = true;
+					else
+						EMSG("permission denied on helper function %s",
+							 NameListToString(options));
+				}
+				else if (con->not_exec_now)
+					NOTE("\"%s\" may be a function but not declared yet",
+						 ident_to_cstring(options));
+				else
+					EMSG("\"%s\" was not a valid value or function",
+						 ident_to_cstring(options));
+			}
 			else if (strcmp(cmd, "#plcuda_include") == 0)
 			{
 				cl_uint		extra_flags = 0;
@@ -794,6 +877,8 @@ __plcuda_code_validation(plcuda_code_context *con,
 						extra_flags |= DEVKERNEL_NEEDS_MATHLIB;
 					else if (strcmp(target, "cuda_misc.h") == 0)
 						extra_flags |= DEVKERNEL_NEEDS_MISC;
+					else if (strcmp(target, "cuda_jsonlib.h") == 0)
+						extra_flags |= DEVKERNEL_NEEDS_JSONLIB;
 					else if (strcmp(target, "cuda_curand.h") == 0)
 						extra_flags |= DEVKERNEL_NEEDS_CURAND;
 				}
@@ -1048,6 +1133,7 @@ plcuda_codegen_part(StringInfo kern,
 		"__plcuda_%s_kernel(kern_plcuda *kplcuda,\n"
 		"                   void *workbuf,\n"
 		"                   void *results,\n"
+		"                   cl_uint chunk_index,\n"
 		"                   kern_context *kcxt)\n"
 		"{\n",
 		suffix);
@@ -1078,6 +1164,15 @@ plcuda_codegen_part(StringInfo kern,
 		kern,
 		"  pg_%s_t *retval __attribute__ ((unused));\n",
 		retval_typname);
+	/*
+	 * set-returning function writes result rows on the 'results' buffer
+	 * formatted as KDS_FORMAT_ROW, using plcuda_results_store_tuple().
+	 */
+	if (procForm->proretset)
+		appendStringInfoString(
+			kern,
+			"  kern_data_store *kds_results __attribute__ ((unused))\n"
+			"    = (kern_data_store *)results;\n");
 
 	/* declaration of argument variables */
 	for (i=0; i < procForm->pronargs; i++)
@@ -1114,7 +1209,7 @@ plcuda_codegen_part(StringInfo kern,
 		kern,
 		"  assert(sizeof(*retval) <= sizeof(kplcuda->__retval));\n"
 		"  retval = (pg_%s_t *)kplcuda->__retval;\n", retval_typname);
-	if (retval_typlen < 0)
+	if (retval_typlen < 0 && !procForm->proretset)
 		appendStringInfoString(
 			kern,
 			"  assert(retval->isnull ||\n"
@@ -1164,7 +1259,8 @@ plcuda_codegen_part(StringInfo kern,
 		"KERNEL_FUNCTION%s(void)\n"
 		"plcuda_%s_kernel_entrypoint(kern_plcuda *kplcuda,\n"
 		"            void *workbuf,\n"
-		"            void *results)\n"
+		"            void *results,\n"
+		"            cl_uint chunk_index)\n"
 		"{\n"
 		"  kern_parambuf *kparams = KERN_PLCUDA_PARAMBUF(kplcuda);\n"
 		"  kern_context kcxt;\n"
@@ -1181,7 +1277,8 @@ plcuda_codegen_part(StringInfo kern,
 			"  else\n"
 			"  {\n"
 			"    INIT_KERNEL_CONTEXT(&kcxt,plcuda_%s_kernel,kparams);\n"
-			"    __plcuda_%s_kernel(kplcuda, workbuf, results, &kcxt);\n"
+			"    __plcuda_%s_kernel(kplcuda, workbuf, results,\n"
+			"                       chunk_index, &kcxt);\n"
 			"  }\n",
 			last_suffix,
 			last_suffix,
@@ -1191,7 +1288,8 @@ plcuda_codegen_part(StringInfo kern,
 		appendStringInfo(
 			kern,
 			"  INIT_KERNEL_CONTEXT(&kcxt,plcuda_%s_kernel,kparams);\n"
-			"  __plcuda_%s_kernel(kplcuda, workbuf, results, &kcxt);\n",
+			"  __plcuda_%s_kernel(kplcuda, workbuf, results,\n"
+			"                     chunk_index, &kcxt);\n",
 			suffix,
 			suffix);
 
@@ -1368,6 +1466,7 @@ __setup_composite_kern_colmeta(HeapTuple typtup, plcudaCodeProperty *p)
 		cmeta->atttypmod = attForm->atttypmod;
 		cmeta->va_offset = 0;
 		cmeta->extra_sz = 0;
+		cmeta->attpacked = false;
 
 		if (get_typtype(attForm->atttypid) == TYPTYPE_COMPOSITE)
 			composite_subtypes = list_append_unique_oid(composite_subtypes,
@@ -1392,6 +1491,37 @@ __setup_composite_kern_colmeta(HeapTuple typtup, plcudaCodeProperty *p)
 	list_free(composite_subtypes);
 }
 
+/*
+ * plcuda_results_tupdesc - tuple descriptor of the rows returned by
+ * set-returning PL/CUDA function
+ */
+static TupleDesc
+plcuda_results_tupdesc(HeapTuple protup)
+{
+	Form_pg_proc	procForm = (Form_pg_proc) GETSTRUCT(protup);
+	Oid				rettype = procForm->prorettype;
+	TupleDesc		tupdesc;
+
+	if (rettype == RECORDOID)
+	{
+		tupdesc = build_function_result_tupdesc_t(protup);
+		if (!tupdesc)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("PL/CUDA function returning SETOF record must have OUT arguments")));
+	}
+	else if (type_is_rowtype(rettype))
+		tupdesc = lookup_rowtype_tupdesc_copy(rettype, -1);
+	else
+	{
+		tupdesc = CreateTemplateTupleDesc(1, false);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1,
+						   NameStr(procForm->proname),
+						   rettype, -1, 0);
+	}
+	return tupdesc;
+}
+
 static kern_colmeta
 __setup_kern_colmeta(Oid type_oid, int attnum, plcudaCodeProperty *p)
 {
@@ -1411,6 +1541,7 @@ __setup_kern_colmeta(Oid type_oid, int attnum, plcudaCodeProperty *p)
 		result.atttypmod = -1;
 		result.va_offset = 0;
 		result.extra_sz = 0;
+		result.attpacked = false;
 
 		return result;
 	}
@@ -1430,6 +1561,7 @@ __setup_kern_colmeta(Oid type_oid, int attnum, plcudaCodeProperty *p)
 	result.atttypmod = typeForm->typtypmod;
 	result.va_offset = 0;
 	result.extra_sz = 0;
+	result.attpacked = false;
 
 	/*
 	 * composite type needs extra kern_colmeta array to form/deform
@@ -1624,9 +1756,19 @@ plcuda_exec_begin(HeapTuple protup, FunctionCallInfo fcinfo)
 	plts->gts.task_kind = GpuTaskKind_PL_CUDA;
 	plts->gts.kern_params = NULL;
 	plts->gts.ccache_refs = NULL;
+	plts->gts.tuple_bound = -1;
 	plts->gts.cb_process_task = plcuda_process_task;
 	plts->gts.cb_release_task = plcuda_release_task;
 	dlist_init(&plts->gts.ready_tasks);
+	if (pgstrom_enable_nvtx)
+	{
+		char	label[64];
+
+		snprintf(label, sizeof(label), "PL/CUDA (function=%u)",
+				 HeapTupleGetOid(protup));
+		plts->gts.nvtx_label = MemoryContextStrdup(CurTransactionContext,
+												   label);
+	}
 
 	/* validate PL/CUDA source code */
 	procForm = (Form_pg_proc) GETSTRUCT(protup);
@@ -1648,6 +1790,16 @@ plcuda_exec_begin(HeapTuple protup, FunctionCallInfo fcinfo)
 												   &plts->p);
 	}
 	plts->kplcuda_head = kplcuda;
+	plts->arg_cache = MemoryContextAllocZero(CurTransactionContext,
+											 sizeof(plcudaArgCache) *
+											 procForm->pronargs);
+	if (procForm->proretset)
+	{
+		MemoryContext	oldcxt = MemoryContextSwitchTo(CurTransactionContext);
+
+		plts->results_tupdesc = plcuda_results_tupdesc(protup);
+		MemoryContextSwitchTo(oldcxt);
+	}
 
 	/* construct a flat kernel source to be built */
 	initStringInfo(&kern_define);
@@ -1662,6 +1814,11 @@ plcuda_exec_begin(HeapTuple protup, FunctionCallInfo fcinfo)
 											 true,
 											 false);
 	plts->gts.program_id = program_id;
+	/* kept to build the same program for the secondary devices, if any */
+	plts->kern_source = MemoryContextStrdup(CurTransactionContext,
+											kern_source);
+	plts->kern_define = MemoryContextStrdup(CurTransactionContext,
+											kern_define.data);
 	pfree(kern_define.data);
 	/* track plcudaTaskState by local tracker */
 	plts->owner = CurrentResourceOwner;
@@ -1672,17 +1829,83 @@ plcuda_exec_begin(HeapTuple protup, FunctionCallInfo fcinfo)
 	return plts;
 }
 
-static void
-plcuda_exec_end(plcudaTaskState *plts)
+/*
+ * plcuda_exec_begin_device
+ *
+ * It sets up the state to run the same PL/CUDA program on the secondary
+ * device. It shares the code property and the device copy of the large
+ * arguments with the primary state, but has its own GpuContext, plcudaTask
+ * and results buffer.
+ */
+static plcudaTaskState *
+plcuda_exec_begin_device(plcudaTaskState *plts, int cuda_dindex)
 {
-	dlist_delete(&plts->chain);
+	GpuContext	   *gcontext;
+	plcudaTaskState *sub;
 
+	gcontext = AllocGpuContext(cuda_dindex, true);
+	ActivateGpuContext(gcontext);
+
+	sub = MemoryContextAlloc(GetMemoryChunkContext(plts),
+							 sizeof(plcudaTaskState));
+	memcpy(sub, plts, sizeof(plcudaTaskState));
+	memset(&sub->gts, 0, sizeof(GpuTaskState));
+	sub->gts.gcontext = gcontext;
+	sub->gts.task_kind = GpuTaskKind_PL_CUDA;
+	sub->gts.kern_params = NULL;
+	sub->gts.ccache_refs = NULL;
+	sub->gts.tuple_bound = -1;
+	sub->gts.cb_process_task = plcuda_process_task;
+	sub->gts.cb_release_task = plcuda_release_task;
+	dlist_init(&sub->gts.ready_tasks);
+	sub->gts.nvtx_label = plts->gts.nvtx_label;
+	sub->last_results_buf = 0UL;
+	sub->last_results_bufsz = 0;
+	sub->m_task_buf = 0UL;
+	sub->task_bufsz = 0;
+	sub->primary = plts;
+	sub->num_sub_plts = 0;
+	sub->sub_plts = NULL;
+	/* identical source hits the program cache; no build again */
+	sub->gts.program_id = pgstrom_create_cuda_program(gcontext,
+													  plts->p.extra_flags,
+													  plts->kern_source,
+													  plts->kern_define,
+													  true,
+													  false);
+	return sub;
+}
+
+static void
+__plcuda_exec_end(plcudaTaskState *plts)
+{
 	if (plts->last_results_buf)
 		gpuMemFree(plts->gts.gcontext,
 				   plts->last_results_buf);
+	if (plts->m_task_buf)
+		gpuMemFree(plts->gts.gcontext,
+				   plts->m_task_buf);
 	pgstromReleaseGpuTaskState(&plts->gts);
 }
 
+static void
+plcuda_exec_end(plcudaTaskState *plts)
+{
+	int		i;
+
+	dlist_delete(&plts->chain);
+
+	for (i=0; i < plts->num_sub_plts; i++)
+		__plcuda_exec_end(plts->sub_plts[i]);
+	for (i=0; i < plts->kplcuda_head->nargs; i++)
+	{
+		if (plts->arg_cache[i].m_buffer != 0UL)
+			gpuMemFree(plts->gts.gcontext,
+					   plts->arg_cache[i].m_buffer);
+	}
+	__plcuda_exec_end(plts);
+}
+
 Datum
 plcuda_function_validator(PG_FUNCTION_ARGS)
 {
@@ -1710,10 +1933,6 @@ plcuda_function_validator(PG_FUNCTION_ARGS)
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("Unable to use PL/CUDA for window functions")));
-	if (procForm->proretset)
-		ereport(ERROR,
-				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-				 errmsg("Righ now, PL/CUDA function does not support set returning function")));
 
 	/*
 	 * Only validation of the CUDA code. Run synchronous code build, then
@@ -1772,9 +1991,54 @@ kernel_launch_helper(FunctionCallInfo __fcinfo,	/* PL/CUDA's fcinfo */
 /*
  * create_plcuda_task
  */
+/*
+ * plcuda_lookup_arg_cache
+ *
+ * It returns device copy of the large varlena argument. If the argument is
+ * identical to the one of the last invocation, it is already on the device,
+ * so iterative invocation over the same matrix does not need DMA any more.
+ */
+static CUdeviceptr
+plcuda_lookup_arg_cache(plcudaTaskState *plts, int index,
+						void *vl_ptr, size_t vl_len)
+{
+	plcudaArgCache *acache = &plts->arg_cache[index];
+	GpuContext	   *gcontext = plts->gts.gcontext;
+	CUresult		rc;
+
+	if (acache->m_buffer != 0UL &&
+		acache->length == vl_len &&
+		memcmp(acache->shadow, vl_ptr, vl_len) == 0)
+		return acache->m_buffer;
+
+	if (acache->m_buffer != 0UL && acache->length != vl_len)
+	{
+		gpuMemFree(gcontext, acache->m_buffer);
+		pfree(acache->shadow);
+		memset(acache, 0, sizeof(plcudaArgCache));
+	}
+	if (acache->m_buffer == 0UL)
+	{
+		rc = gpuMemAllocManaged(gcontext,
+								&acache->m_buffer,
+								vl_len,
+								CU_MEM_ATTACH_GLOBAL);
+		if (rc != CUDA_SUCCESS)
+			elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+		acache->shadow = MemoryContextAllocHuge(GetMemoryChunkContext(plts),
+												vl_len);
+		acache->length = vl_len;
+	}
+	memcpy((void *)acache->m_buffer, vl_ptr, vl_len);
+	memcpy(acache->shadow, vl_ptr, vl_len);
+
+	return acache->m_buffer;
+}
+
 static plcudaTask *
 create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
-				   Size working_bufsz, Size results_bufsz)
+				   Size working_bufsz, Size results_bufsz,
+				   CUdeviceptr m_shared_results)
 {
 	GpuContext	   *gcontext = plts->gts.gcontext;
 	plcudaTask	   *ptask;
@@ -1828,28 +2092,67 @@ create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
 
 	total_length = STROMALIGN(total_length);
 
-	/* setup plcudaTask */
-	rc = gpuMemAllocManaged(gcontext,
-							&m_deviceptr,
-							total_length,
-							CU_MEM_ATTACH_GLOBAL);
-	if (rc != CUDA_SUCCESS)
-		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
-	ptask = (plcudaTask *) m_deviceptr;
-	memset(ptask, 0, offsetof(plcudaTask, kern.retmeta));
-	pgstromInitGpuTask(&plts->gts, &ptask->task);
-	if (results_bufsz > 0)
+	/*
+	 * setup plcudaTask
+	 *
+	 * NOTE: When PL/CUDA function is invoked per row, allocation of the
+	 * unified memory is not negligible towards the kernel execution, so
+	 * we recycle the buffers of the last invocation if large enough.
+	 */
+	if (plts->m_task_buf != 0UL && total_length <= plts->task_bufsz)
+		m_deviceptr = plts->m_task_buf;
+	else
 	{
+		if (plts->m_task_buf != 0UL)
+		{
+			gpuMemFree(gcontext, plts->m_task_buf);
+			plts->m_task_buf = 0UL;
+		}
 		rc = gpuMemAllocManaged(gcontext,
-								&ptask->m_results_buf,
-								results_bufsz,
+								&m_deviceptr,
+								total_length,
 								CU_MEM_ATTACH_GLOBAL);
 		if (rc != CUDA_SUCCESS)
 			elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+		plts->m_task_buf = m_deviceptr;
+		plts->task_bufsz = total_length;
+	}
+	ptask = (plcudaTask *) m_deviceptr;
+	memset(ptask, 0, offsetof(plcudaTask, kern.retmeta));
+	pgstromInitGpuTask(&plts->gts, &ptask->task);
+	if (results_bufsz > 0)
+	{
+		if (m_shared_results != 0UL)
+		{
+			/* secondary device writes on the results buffer of primary */
+			ptask->m_results_buf = m_shared_results;
+			ptask->results_buf_shared = true;
+		}
+		else if (plts->last_results_buf != 0UL &&
+				 results_bufsz <= plts->last_results_bufsz)
+			ptask->m_results_buf = plts->last_results_buf;
+		else
+		{
+			if (plts->last_results_buf != 0UL)
+			{
+				gpuMemFree(gcontext, plts->last_results_buf);
+				plts->last_results_buf = 0UL;
+			}
+			rc = gpuMemAllocManaged(gcontext,
+									&ptask->m_results_buf,
+									results_bufsz,
+									CU_MEM_ATTACH_GLOBAL);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on gpuMemAllocManaged: %s",
+					 errorText(rc));
+			plts->last_results_buf = ptask->m_results_buf;
+			plts->last_results_bufsz = results_bufsz;
+		}
 	}
 	ptask->gstore_oid_list = gstore_oid_list;
 	ptask->gstore_devptr_list = gstore_devptr_list;
 	ptask->gstore_dindex_list = gstore_dindex_list;
+	ptask->arg_cache = plts->arg_cache;
 
 	/* setup kern_plcuda */
 	memcpy(&ptask->kern, kplcuda_head, kplcuda_head->length);
@@ -1860,7 +2163,20 @@ create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
 
 	/* setup default result value */
 	cmeta = &ptask->kern.retmeta;
-	if (cmeta->attlen > 0)
+	if (plts->results_tupdesc)
+	{
+		/* results buffer of SETOF function is KDS_FORMAT_ROW */
+		if (results_bufsz <
+			KDS_CALCULATE_HEAD_LENGTH(plts->results_tupdesc->natts))
+			elog(ERROR, "PL/CUDA: results buffer (%zu bytes) is too small for set-returning function",
+				 results_bufsz);
+		init_kernel_data_store((kern_data_store *)ptask->m_results_buf,
+							   plts->results_tupdesc,
+							   results_bufsz,
+							   KDS_FORMAT_ROW,
+							   INT_MAX);
+	}
+	else if (cmeta->attlen > 0)
 		ptask->kern.__retval[cmeta->attlen] = true;
 	else
 	{
@@ -1933,8 +2249,31 @@ create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
 			Size	vl_len = VARSIZE_ANY(vl_ptr);
 
 			kparams->poffset[i] = offset;
-			memcpy((char *)kparams + offset, vl_ptr, vl_len);
-			offset += MAXALIGN(vl_len);
+			if (plcuda_arg_cache_threshold >= 0 &&
+				vl_len >= ((Size)plcuda_arg_cache_threshold << 10))
+			{
+				/*
+				 * Large argument is referenced by the indirect pointer to
+				 * the device copy, instead of the copy in the parambuf.
+				 */
+				char		   *pos = (char *)kparams + offset;
+				varatt_indirect	redirect;
+
+				if (plts->primary)
+					redirect.pointer = (struct varlena *)
+						plts->primary->arg_cache[i].m_buffer;
+				else
+					redirect.pointer = (struct varlena *)
+						plcuda_lookup_arg_cache(plts, i, vl_ptr, vl_len);
+				SET_VARTAG_EXTERNAL(pos, VARTAG_INDIRECT);
+				memcpy(VARDATA_EXTERNAL(pos), &redirect, sizeof(redirect));
+				offset += MAXALIGN(VARHDRSZ_EXTERNAL + sizeof(redirect));
+			}
+			else
+			{
+				memcpy((char *)kparams + offset, vl_ptr, vl_len);
+				offset += MAXALIGN(vl_len);
+			}
 		}
 	}
 	Assert(i == fcinfo->nargs);
@@ -1954,12 +2293,56 @@ create_plcuda_task(plcudaTaskState *plts, FunctionCallInfo fcinfo,
 	Assert(STROMALIGN(offsetof(plcudaTask, kern) +
 					  kplcuda_head->length) +
 		   kparams->length <= total_length);
-	Assert(plts->last_results_buf == 0UL);
-	plts->last_results_buf = ptask->m_results_buf;
+	Assert(ptask->m_results_buf == 0UL ||
+		   ptask->results_buf_shared ||
+		   ptask->m_results_buf == plts->last_results_buf);
 
 	return ptask;
 }
 
+/*
+ * plcuda_advise_multi_devices
+ *
+ * It advises the driver on the managed memory referenced by the secondary
+ * devices. Large arguments are never updated by the kernels, so they are
+ * duplicated on every device instead of migration back and forth. The
+ * shared results buffer is mapped to the secondary devices, so they write
+ * on the primary device over peer-to-peer access where available.
+ * Hints are just hints; errors are ignored.
+ */
+static void
+plcuda_advise_multi_devices(plcudaTaskState *plts, plcudaTask *ptask)
+{
+	GpuContext *gcontext = plts->gts.gcontext;
+	int			i;
+
+	if (cuCtxPushCurrent(gcontext->cuda_context) != CUDA_SUCCESS)
+		return;
+	for (i=0; i < plts->kplcuda_head->nargs; i++)
+	{
+		plcudaArgCache *acache = &plts->arg_cache[i];
+
+		if (acache->m_buffer != 0UL)
+			(void) cuMemAdvise(acache->m_buffer,
+							   acache->length,
+							   CU_MEM_ADVISE_SET_READ_MOSTLY,
+							   gcontext->cuda_device);
+	}
+	if (ptask->m_results_buf != 0UL && !plts->results_tupdesc)
+	{
+		for (i=0; i < plts->num_sub_plts; i++)
+		{
+			GpuContext *__gcontext = plts->sub_plts[i]->gts.gcontext;
+
+			(void) cuMemAdvise(ptask->m_results_buf,
+							   ptask->kern.results_bufsz,
+							   CU_MEM_ADVISE_SET_ACCESSED_BY,
+							   __gcontext->cuda_device);
+		}
+	}
+	cuCtxPopCurrent(NULL);
+}
+
 Datum
 plcuda_function_handler(PG_FUNCTION_ARGS)
 {
@@ -1967,13 +2350,18 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 	plcudaTaskState *plts;
 	plcudaTask	   *ptask;
 	plcudaTask	   *precv;
+	plcudaTask	  **ptasks;
 	GpuContext	   *gcontext;
 	Size			working_bufsz;
 	Size			results_bufsz;
+	int64			num_devices;
+	int64			num_chunks;
 	kern_errorbuf	kerror;
+	ReturnSetInfo  *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
 	Datum			retval = 0;
 	bool			isnull = false;
 	ListCell	   *lc1, *lc2, *lc3;
+	int				k;
 
 	if (!flinfo->fn_extra)
 	{
@@ -1996,14 +2384,21 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 	{
 		plts = (plcudaTaskState *) flinfo->fn_extra;
 		pgstromRescanGpuTaskState(&plts->gts);
+		for (k=0; k < plts->num_sub_plts; k++)
+			pgstromRescanGpuTaskState(&plts->sub_plts[k]->gts);
 	}
 
-	/* results buffer of last invocation will not be used no longer */
-	if (plts->last_results_buf)
+	/* set-returning function returns the results as a tuplestore */
+	if (plts->results_tupdesc)
 	{
-		gpuMemFree(plts->gts.gcontext,
-				   plts->last_results_buf);
-		plts->last_results_buf = 0UL;
+		if (!rsinfo || !IsA(rsinfo, ReturnSetInfo))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("set-valued function called in context that cannot accept a set")));
+		if (!(rsinfo->allowedModes & SFRM_Materialize))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("materialize mode required, but it is not allowed in this context")));
 	}
 
 	/* sanitycheck of the supplied arguments, prior to GPU launch */
@@ -2028,10 +2423,51 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 	elog(DEBUG2, "working_bufsz = %zu, results_bufsz = %zu",
 		 working_bufsz, results_bufsz);
 
+	/* number of devices; 0 means all the devices installed */
+	num_devices =
+		DatumGetInt64(kernel_launch_helper(fcinfo,
+										   plts->p.fn_num_devices,
+										   plts->p.val_num_devices,
+										   NULL));
+	if (num_devices < 0)
+		elog(ERROR, "invalid number of devices: %ld", num_devices);
+	if (num_devices == 0 || num_devices > numDevAttrs)
+		num_devices = numDevAttrs;
+	/*
+	 * Prep and post kernels run on every device with no synchronization
+	 * across the devices, so the main kernel on a device may start prior to
+	 * completion of the prep kernel on the others.
+	 */
+	if (num_devices > 1 && (plts->p.kern_prep || plts->p.kern_post))
+		elog(ERROR, "#plcuda_prep and #plcuda_post are not supported with multiple devices");
+	/* number of chunks to stream the main kernel */
+	num_chunks =
+		DatumGetInt64(kernel_launch_helper(fcinfo,
+										   plts->p.fn_num_chunks,
+										   plts->p.val_num_chunks,
+										   NULL));
+	if (num_chunks <= 0 || num_chunks > INT_MAX)
+		elog(ERROR, "invalid number of chunks: %ld", num_chunks);
+
+	while (plts->num_sub_plts < num_devices - 1)
+	{
+		int		cuda_dindex = (plts->gts.gcontext->cuda_dindex +
+							   plts->num_sub_plts + 1) % numDevAttrs;
+
+		if (!plts->sub_plts)
+			plts->sub_plts = MemoryContextAllocZero(GetMemoryChunkContext(plts),
+													sizeof(plcudaTaskState *) *
+													numDevAttrs);
+		plts->sub_plts[plts->num_sub_plts] =
+			plcuda_exec_begin_device(plts, cuda_dindex);
+		plts->num_sub_plts++;
+	}
+
 	/* construction of plcudaTask structure */
 	ptask = create_plcuda_task(plts, fcinfo,
 							   working_bufsz,
-							   results_bufsz);
+							   results_bufsz,
+							   0UL);
 	if (plts->p.kern_prep)
 	{
 		int		saved_max_blocksz   = plcuda_kfunc_max_blocksz;
@@ -2271,21 +2707,87 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 		PG_END_TRY();
 	}
 
+	/*
+	 * plcudaTask for the secondary devices, if any. Launch parameters are
+	 * common for all the devices, and the results buffer is shared unless
+	 * SETOF function, so kernels put their own portion on the buffer.
+	 */
+	ptasks = palloc(sizeof(plcudaTask *) * num_devices);
+	ptasks[0] = ptask;
+	for (k=1; k < num_devices; k++)
+	{
+		plcudaTask *stask = create_plcuda_task(plts->sub_plts[k-1], fcinfo,
+											   working_bufsz,
+											   results_bufsz,
+											   plts->results_tupdesc
+											   ? 0UL
+											   : ptask->m_results_buf);
+		stask->exec_prep_kernel = ptask->exec_prep_kernel;
+		stask->exec_post_kernel = ptask->exec_post_kernel;
+		memcpy(&stask->kern.prep_num_threads,
+			   &ptask->kern.prep_num_threads,
+			   offsetof(kern_plcuda, working_bufsz) -
+			   offsetof(kern_plcuda, prep_num_threads));
+		ptasks[k] = stask;
+	}
+	for (k=0; k < num_devices; k++)
+	{
+		ptasks[k]->kern.device_index = k;
+		ptasks[k]->kern.num_devices = num_devices;
+		ptasks[k]->kern.num_chunks = num_chunks;
+		/* results are final after the last main kernel, if no post kernel */
+		ptasks[k]->stream_results = (num_chunks > 1 &&
+									 !ptask->exec_post_kernel &&
+									 !plts->results_tupdesc &&
+									 ptask->m_results_buf != 0UL);
+	}
+	if (num_devices > 1)
+		plcuda_advise_multi_devices(plts, ptask);
+
 	/* Exec PL/CUDA function by GPU */
-	gcontext = plts->gts.gcontext;
-	pthreadMutexLock(gcontext->mutex);
-	dlist_push_tail(&gcontext->pending_tasks, &ptask->task.chain);
-	plts->gts.num_running_tasks++;
-	pg_atomic_add_fetch_u32(gcontext->global_num_running_tasks, 1);
-	pthreadCondSignal(gcontext->cond);
-	pthreadMutexUnlock(gcontext->mutex);
+	for (k=0; k < num_devices; k++)
+	{
+		GpuTaskState   *gts = ptasks[k]->task.gts;
+
+		gcontext = gts->gcontext;
+		pthreadMutexLock(gcontext->mutex);
+		dlist_push_tail(&gcontext->pending_tasks, &ptasks[k]->task.chain);
+		gts->num_running_tasks++;
+		GpuContextDispatchTask(gcontext);
+		pthreadCondSignal(gcontext->cond);
+		pthreadMutexUnlock(gcontext->mutex);
+	}
 
 	/* Wait for the completion */
-	plts->gts.scan_done = true;
-	precv = (plcudaTask *) fetch_next_gputask(&plts->gts);
-	if (!precv)
-		elog(ERROR, "PL/CUDA GPU Task has gone to somewhere...");
-	Assert(precv == ptask);
+	for (k=0; k < num_devices; k++)
+	{
+		GpuTaskState   *gts = ptasks[k]->task.gts;
+
+		gts->scan_done = true;
+		precv = (plcudaTask *) fetch_next_gputask(gts);
+		if (!precv)
+			elog(ERROR, "PL/CUDA GPU Task has gone to somewhere...");
+		Assert(precv == ptasks[k]);
+	}
+	precv = ptask;
+
+	/* debug counters and errors are summarized on the primary task */
+	kerror = ptask->task.kerror;
+	for (k=1; k < num_devices; k++)
+	{
+		kern_plcuda	   *kplcuda = &ptasks[k]->kern;
+
+		precv->kern.plcuda_debug_count0 += kplcuda->plcuda_debug_count0;
+		precv->kern.plcuda_debug_count1 += kplcuda->plcuda_debug_count1;
+		precv->kern.plcuda_debug_count2 += kplcuda->plcuda_debug_count2;
+		precv->kern.plcuda_debug_count3 += kplcuda->plcuda_debug_count3;
+		precv->kern.plcuda_debug_count4 += kplcuda->plcuda_debug_count4;
+		precv->kern.plcuda_debug_count5 += kplcuda->plcuda_debug_count5;
+		precv->kern.plcuda_debug_count6 += kplcuda->plcuda_debug_count6;
+		precv->kern.plcuda_debug_count7 += kplcuda->plcuda_debug_count7;
+		if (kerror.errcode == StromError_Success)
+			kerror = ptasks[k]->task.kerror;
+	}
 
 	/*
 	 * Dump the debug counter if valid values are set by kernel function
@@ -2315,9 +2817,41 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 		elog(NOTICE, "PL/CUDA debug count7 => %lu",
 			 precv->kern.plcuda_debug_count7);
 
-	if (precv->task.kerror.errcode == StromError_Success)
+	if (kerror.errcode == StromError_Success)
 	{
-		if (precv->kern.retmeta.attlen > 0)
+		if (plts->results_tupdesc)
+		{
+			MemoryContext	oldcxt;
+			Tuplestorestate *tupstore;
+			HeapTupleData	tuple;
+			cl_uint			i;
+
+			oldcxt = MemoryContextSwitchTo(rsinfo->econtext->
+										   ecxt_per_query_memory);
+			tupstore = tuplestore_begin_heap(true, false, work_mem);
+			/* gather the result rows of every device */
+			for (k=0; k < num_devices; k++)
+			{
+				kern_data_store *kds = (kern_data_store *)
+					ptasks[k]->m_results_buf;
+
+				for (i=0; i < kds->nitems; i++)
+				{
+					kern_tupitem   *tupitem = KERN_DATA_STORE_TUPITEM(kds, i);
+
+					tuple.t_len = tupitem->t_len;
+					tuple.t_self = tupitem->t_self;
+					tuple.t_tableOid = InvalidOid;
+					tuple.t_data = &tupitem->htup;
+					tuplestore_puttuple(tupstore, &tuple);
+				}
+			}
+			rsinfo->returnMode = SFRM_Materialize;
+			rsinfo->setResult = tupstore;
+			rsinfo->setDesc = CreateTupleDescCopy(plts->results_tupdesc);
+			MemoryContextSwitchTo(oldcxt);
+		}
+		else if (precv->kern.retmeta.attlen > 0)
 		{
 			if (precv->kern.__retval[precv->kern.retmeta.attlen])
 				isnull = true;
@@ -2352,16 +2886,23 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 	}
 	else
 	{
-		if (precv->m_results_buf)
+		for (k=0; k < num_devices; k++)
 		{
-			gpuMemFree(plts->gts.gcontext,
-					   precv->m_results_buf);
-			precv->m_results_buf = 0UL;
-			plts->last_results_buf = 0UL;
+			plcudaTask	   *stask = ptasks[k];
+			plcudaTaskState *__plts = (plcudaTaskState *) stask->task.gts;
+
+			if (stask->m_results_buf && !stask->results_buf_shared)
+			{
+				gpuMemFree(__plts->gts.gcontext,
+						   stask->m_results_buf);
+				__plts->last_results_buf = 0UL;
+			}
+			stask->m_results_buf = 0UL;
 		}
 
 		if (kerror.errcode == StromError_CpuReCheck &&
-			OidIsValid(plts->p.fn_cpu_fallback))
+			OidIsValid(plts->p.fn_cpu_fallback) &&
+			!plts->results_tupdesc)
 		{
 			/* CPU fallback, if any */
 			retval = kernel_launch_helper(fcinfo,
@@ -2378,20 +2919,26 @@ plcuda_function_handler(PG_FUNCTION_ARGS)
 		}
 	}
 	/* close gstore_fdw if any */
-	forthree(lc1, ptask->gstore_oid_list,
-			 lc2, ptask->gstore_devptr_list,
-			 lc3, ptask->gstore_dindex_list)
+	for (k=0; k < num_devices; k++)
 	{
-		Oid			gstore_oid __attribute__((unused)) = lfirst_oid(lc1);
-		CUdeviceptr	m_deviceptr = (CUdeviceptr) lfirst(lc2);
-		cl_int		cuda_dindex = lfirst_int(lc3);
+		GpuContext *__gcontext = ptasks[k]->task.gts->gcontext;
 
-		if (cuda_dindex < 0)
-			gpuMemFree(plts->gts.gcontext, m_deviceptr);
-		else
-			gpuIpcCloseMemHandle(plts->gts.gcontext, m_deviceptr);
+		forthree(lc1, ptasks[k]->gstore_oid_list,
+				 lc2, ptasks[k]->gstore_devptr_list,
+				 lc3, ptasks[k]->gstore_dindex_list)
+		{
+			Oid			gstore_oid __attribute__((unused)) = lfirst_oid(lc1);
+			CUdeviceptr	m_deviceptr = (CUdeviceptr) lfirst(lc2);
+			cl_int		cuda_dindex = lfirst_int(lc3);
+
+			if (cuda_dindex < 0)
+				gpuMemFree(__gcontext, m_deviceptr);
+			else
+				gpuIpcCloseMemHandle(__gcontext, m_deviceptr);
+		}
 	}
-	gpuMemFree(plts->gts.gcontext, (CUdeviceptr)ptask);
+	pfree(ptasks);
+	/* plcudaTask buffer is kept for the next invocation */
 
 	if (isnull)
 		PG_RETURN_NULL();
@@ -2460,7 +3007,16 @@ plcuda_process_task(GpuTask *gtask, CUmodule cuda_module)
 {
 	plcudaTask	   *ptask = (plcudaTask *) gtask;
 	GpuContext	   *gcontext = GpuWorkerCurrentContext;
-	void		   *kern_args[3];
+	void		   *kern_args[4];
+	cl_uint			chunk_index = 0;
+	cl_uint			num_chunks = ptask->kern.num_chunks;
+	volatile CUstream upload_stream = NULL;
+	volatile CUstream download_stream = NULL;
+	CUevent		   *volatile chunk_events = NULL;
+	CUstream		stream;
+	CUevent		   *events;
+	volatile bool	failed = false;
+	cl_ulong		start, end;
 	size_t			warp_size;
 	size_t			block_size;
 	size_t			grid_size;
@@ -2471,7 +3027,8 @@ plcuda_process_task(GpuTask *gtask, CUmodule cuda_module)
 	CUdeviceptr		m_results_buf = ptask->m_results_buf;
 	CUdeviceptr		m_working_buf = 0UL;
 	CUresult		rc;
-	int				retval = 100001;
+	uint64			range_id;
+	int				i, k, retval = 100001;
 
 	/* property of the device */
 	warp_size = devAttrs[CU_DINDEX_PER_THREAD].WARP_SIZE;
@@ -2514,198 +3071,359 @@ plcuda_process_task(GpuTask *gtask, CUmodule cuda_module)
 			werror("failed on gpuMemAllocManaged: %s", errorText(rc));
 	}
 
-	/* move the control block + argument buffer */
-	rc = cuMemPrefetchAsync((CUdeviceptr)&ptask->kern,
-							KERN_PLCUDA_DMASEND_LENGTH(&ptask->kern),
-							CU_DEVICE_PER_THREAD,
-							CU_STREAM_PER_THREAD);
-	if (rc != CUDA_SUCCESS)
-		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
-
-	/* kernel arguments (common for all thress kernels) */
-	kern_args[0] = &m_kern_plcuda;
-	kern_args[1] = &m_working_buf;
-	kern_args[2] = &m_results_buf;
+	/*
+	 * Streams and events for the streaming execution must be released on
+	 * errors also, because worker thread continues to run.
+	 */
+	STROM_TRY();
+	{
+		/* move the control block + argument buffer */
+		range_id = pgstromNvtxRangeStart(ptask->task.gts, "DMA send");
+		rc = cuMemPrefetchAsync((CUdeviceptr)&ptask->kern,
+								KERN_PLCUDA_DMASEND_LENGTH(&ptask->kern),
+								CU_DEVICE_PER_THREAD,
+								CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
 
-	/* launch plcuda_prep_kernel_entrypoint */
-	if (ptask->exec_prep_kernel)
-    {
-		if (ptask->kern.prep_kern_blocksz > 0)
+		/* device copy of large arguments; no-op if already on the device */
+		if (num_chunks <= 1)
 		{
-			block_size = (ptask->kern.prep_kern_blocksz +
-						  warp_size - 1) & ~(warp_size - 1);
-			grid_size = (ptask->kern.prep_num_threads +
-						 block_size - 1) / block_size;
+			for (i=0; i < ptask->kern.nargs; i++)
+			{
+				plcudaArgCache *acache = &ptask->arg_cache[i];
+
+				if (acache->m_buffer == 0UL)
+					continue;
+				rc = cuMemPrefetchAsync(acache->m_buffer,
+										acache->length,
+										CU_DEVICE_PER_THREAD,
+										CU_STREAM_PER_THREAD);
+				if (rc != CUDA_SUCCESS)
+					werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+			}
 		}
 		else
 		{
-			rc = gpuOptimalBlockSize(NULL,
-									 &block_size,
-									 kern_plcuda_prep,
-									 ptask->kern.prep_num_threads,
-									 ptask->kern.prep_shmem_blocksz,
-									 ptask->kern.prep_shmem_unitsz);
+			/*
+			 * Streaming execution of the main kernel. Portion of the large
+			 * arguments for each chunk is uploaded on the separate stream, then
+			 * the main kernel for the chunk waits for only its own portion, so
+			 * transfer of the next chunk runs in parallel to the kernels.
+			 * Results are also downloaded per chunk, if final.
+			 */
+			rc = cuStreamCreate(&stream, CU_STREAM_NON_BLOCKING);
 			if (rc != CUDA_SUCCESS)
-				werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
-			grid_size = (ptask->kern.prep_num_threads +
-						 block_size - 1) / block_size;
+				werror("failed on cuStreamCreate: %s", errorText(rc));
+			upload_stream = stream;
+			if (ptask->stream_results)
+			{
+				rc = cuStreamCreate(&stream, CU_STREAM_NON_BLOCKING);
+				if (rc != CUDA_SUCCESS)
+					werror("failed on cuStreamCreate: %s", errorText(rc));
+				download_stream = stream;
+			}
+			events = calloc(2 * num_chunks, sizeof(CUevent));
+			if (!events)
+				werror("out of memory");
+			chunk_events = events;
+			for (k=0; k < 2 * num_chunks; k++)
+			{
+				rc = cuEventCreate(&events[k], CU_EVENT_DISABLE_TIMING);
+				if (rc != CUDA_SUCCESS)
+					werror("failed on cuEventCreate: %s", errorText(rc));
+			}
+
+			for (k=0; k < num_chunks; k++)
+			{
+				for (i=0; i < ptask->kern.nargs; i++)
+				{
+					plcudaArgCache *acache = &ptask->arg_cache[i];
+
+					if (acache->m_buffer == 0UL)
+						continue;
+					plcuda_chunk_portion(&ptask->kern, k, acache->length,
+										 &start, &end);
+					if (start >= end)
+						continue;
+					rc = cuMemPrefetchAsync(acache->m_buffer + start,
+											end - start,
+											CU_DEVICE_PER_THREAD,
+											upload_stream);
+					if (rc != CUDA_SUCCESS)
+						werror("failed on cuMemPrefetchAsync: %s",
+							   errorText(rc));
+				}
+				rc = cuEventRecord(chunk_events[k], upload_stream);
+				if (rc != CUDA_SUCCESS)
+					werror("failed on cuEventRecord: %s", errorText(rc));
+			}
 		}
+		pgstromNvtxRangeEnd(range_id);
 
-		rc = cuLaunchKernel(kern_plcuda_prep,
-							grid_size, 1, 1,
-							block_size, 1, 1,
-							ptask->kern.prep_shmem_blocksz +
-							ptask->kern.prep_shmem_unitsz * block_size,
-							NULL,
-							kern_args,
-							NULL);
-		if (rc != CUDA_SUCCESS)
-			werror("failed on cuLaunchKernel: %s "
-				   "(prep-kernel: grid=%u block=%u shmem=%zu)",
-				   errorText(rc),
+		/* kernel arguments (common for all thress kernels) */
+		kern_args[0] = &m_kern_plcuda;
+		kern_args[1] = &m_working_buf;
+		kern_args[2] = &m_results_buf;
+		kern_args[3] = &chunk_index;
+
+		/* launch plcuda_prep_kernel_entrypoint */
+		if (ptask->exec_prep_kernel)
+		{
+			if (ptask->kern.prep_kern_blocksz > 0)
+			{
+				block_size = (ptask->kern.prep_kern_blocksz +
+							  warp_size - 1) & ~(warp_size - 1);
+				grid_size = (ptask->kern.prep_num_threads +
+							 block_size - 1) / block_size;
+			}
+			else
+			{
+				rc = gpuOptimalBlockSize(NULL,
+										 &block_size,
+										 kern_plcuda_prep,
+										 ptask->kern.prep_num_threads,
+										 ptask->kern.prep_shmem_blocksz,
+										 ptask->kern.prep_shmem_unitsz);
+				if (rc != CUDA_SUCCESS)
+					werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+				grid_size = (ptask->kern.prep_num_threads +
+							 block_size - 1) / block_size;
+			}
+
+			range_id = pgstromNvtxRangeStart(ptask->task.gts, "plcuda_prep");
+			rc = cuLaunchKernel(kern_plcuda_prep,
+								grid_size, 1, 1,
+								block_size, 1, 1,
+								ptask->kern.prep_shmem_blocksz +
+								ptask->kern.prep_shmem_unitsz * block_size,
+								CU_STREAM_PER_THREAD,
+								kern_args,
+								NULL);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuLaunchKernel: %s "
+					   "(prep-kernel: grid=%u block=%u shmem=%zu)",
+					   errorText(rc),
+					   (cl_uint)grid_size, (cl_uint)block_size,
+					   ptask->kern.prep_shmem_blocksz +
+					   ptask->kern.prep_shmem_unitsz * block_size);
+			wdebug("PL/CUDA prep-kernel: grid=%u block=%u shmem=%zu",
 				   (cl_uint)grid_size, (cl_uint)block_size,
 				   ptask->kern.prep_shmem_blocksz +
 				   ptask->kern.prep_shmem_unitsz * block_size);
-		wdebug("PL/CUDA prep-kernel: grid=%u block=%u shmem=%zu",
-			   (cl_uint)grid_size, (cl_uint)block_size,
-			   ptask->kern.prep_shmem_blocksz +
-			   ptask->kern.prep_shmem_unitsz * block_size);
-	}
+			pgstromNvtxRangeEnd(range_id);
+		}
 
-	/* launch plcuda_main_kernel_entrypoint */
-	if (ptask->kern.main_kern_blocksz > 0)
-	{
-		block_size = (ptask->kern.main_kern_blocksz +
-					  warp_size - 1) & ~(warp_size - 1);
-		grid_size = (ptask->kern.main_num_threads +
-					 block_size - 1) / block_size;
-	}
-	else
-	{
-		rc = gpuOptimalBlockSize(NULL,
-								 &block_size,
-								 kern_plcuda_main,
-								 ptask->kern.main_num_threads,
-								 ptask->kern.main_shmem_blocksz,
-								 ptask->kern.main_shmem_unitsz);
-		if (rc != CUDA_SUCCESS)
-			werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
-		grid_size = (ptask->kern.main_num_threads +
-					 block_size - 1) / block_size;
-	}
-
-	rc = cuLaunchKernel(kern_plcuda_main,
-						grid_size, 1, 1,
-						block_size, 1, 1,
-						ptask->kern.main_shmem_blocksz +
-						ptask->kern.main_shmem_unitsz * block_size,
-						NULL,
-						kern_args,
-						NULL);
-	if (rc != CUDA_SUCCESS)
-		werror("failed on cuLaunchKernel: %s "
-			   "(main-kernel: grid=%u block=%u shmem=%zu)",
-			   errorText(rc),
-			   (cl_uint)grid_size, (cl_uint)block_size,
-			   ptask->kern.main_shmem_blocksz +
-			   ptask->kern.main_shmem_unitsz * block_size);
-	wdebug("PL/CUDA main-kernel: grid=%u block=%u shmem=%zu",
-		   (cl_uint)grid_size, (cl_uint)block_size,
-		   ptask->kern.main_shmem_blocksz +
-		   ptask->kern.main_shmem_unitsz * block_size);
-
-	/* launch plcuda_post_kernel_entrypoint */
-	if (ptask->exec_post_kernel)
-    {
-		if (ptask->kern.post_kern_blocksz > 0)
+		/* launch plcuda_main_kernel_entrypoint */
+		if (ptask->kern.main_kern_blocksz > 0)
 		{
-			block_size = (ptask->kern.post_kern_blocksz +
+			block_size = (ptask->kern.main_kern_blocksz +
 						  warp_size - 1) & ~(warp_size - 1);
-			grid_size = (ptask->kern.post_num_threads +
+			grid_size = (ptask->kern.main_num_threads +
 						 block_size - 1) / block_size;
 		}
 		else
 		{
 			rc = gpuOptimalBlockSize(NULL,
 									 &block_size,
-									 kern_plcuda_post,
-									 ptask->kern.post_num_threads,
-									 ptask->kern.post_shmem_blocksz,
-									 ptask->kern.post_shmem_unitsz);
+									 kern_plcuda_main,
+									 ptask->kern.main_num_threads,
+									 ptask->kern.main_shmem_blocksz,
+									 ptask->kern.main_shmem_unitsz);
 			if (rc != CUDA_SUCCESS)
 				werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
-			grid_size = (ptask->kern.post_num_threads +
+			grid_size = (ptask->kern.main_num_threads +
 						 block_size - 1) / block_size;
 		}
 
-		rc = cuLaunchKernel(kern_plcuda_post,
-							grid_size, 1, 1,
-							block_size, 1, 1,
-							ptask->kern.post_shmem_blocksz +
-							ptask->kern.post_shmem_unitsz * block_size,
-							NULL,
-							kern_args,
-							NULL);
-		if (rc != CUDA_SUCCESS)
-			werror("failed on cuLaunchKernel: %s "
-				   "(post-kernel: grid=%u block=%u shmem=%zu)",
-				   errorText(rc),
+		range_id = pgstromNvtxRangeStart(ptask->task.gts, "plcuda_main");
+		for (chunk_index=0; chunk_index < Max(num_chunks, 1); chunk_index++)
+		{
+			if (upload_stream)
+			{
+				rc = cuStreamWaitEvent(CU_STREAM_PER_THREAD,
+									   chunk_events[chunk_index], 0);
+				if (rc != CUDA_SUCCESS)
+					werror("failed on cuStreamWaitEvent: %s", errorText(rc));
+			}
+
+			rc = cuLaunchKernel(kern_plcuda_main,
+								grid_size, 1, 1,
+								block_size, 1, 1,
+								ptask->kern.main_shmem_blocksz +
+								ptask->kern.main_shmem_unitsz * block_size,
+								CU_STREAM_PER_THREAD,
+								kern_args,
+								NULL);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuLaunchKernel: %s "
+					   "(main-kernel: grid=%u block=%u shmem=%zu chunk=%u)",
+					   errorText(rc),
+					   (cl_uint)grid_size, (cl_uint)block_size,
+					   ptask->kern.main_shmem_blocksz +
+					   ptask->kern.main_shmem_unitsz * block_size,
+					   chunk_index);
+			wdebug("PL/CUDA main-kernel: grid=%u block=%u shmem=%zu chunk=%u",
+				   (cl_uint)grid_size, (cl_uint)block_size,
+				   ptask->kern.main_shmem_blocksz +
+				   ptask->kern.main_shmem_unitsz * block_size,
+				   chunk_index);
+
+			if (download_stream)
+			{
+				CUevent		ev_done = chunk_events[num_chunks + chunk_index];
+
+				rc = cuEventRecord(ev_done, CU_STREAM_PER_THREAD);
+				if (rc != CUDA_SUCCESS)
+					werror("failed on cuEventRecord: %s", errorText(rc));
+				rc = cuStreamWaitEvent(download_stream, ev_done, 0);
+				if (rc != CUDA_SUCCESS)
+					werror("failed on cuStreamWaitEvent: %s", errorText(rc));
+				plcuda_chunk_portion(&ptask->kern, chunk_index,
+									 ptask->kern.results_bufsz,
+									 &start, &end);
+				if (start < end)
+				{
+					rc = cuMemPrefetchAsync(m_results_buf + start,
+											end - start,
+											CU_DEVICE_CPU,
+											download_stream);
+					if (rc != CUDA_SUCCESS)
+						werror("failed on cuMemPrefetchAsync: %s",
+							   errorText(rc));
+				}
+			}
+		}
+		chunk_index = 0;
+		pgstromNvtxRangeEnd(range_id);
+
+		/* launch plcuda_post_kernel_entrypoint */
+		if (ptask->exec_post_kernel)
+		{
+			if (ptask->kern.post_kern_blocksz > 0)
+			{
+				block_size = (ptask->kern.post_kern_blocksz +
+							  warp_size - 1) & ~(warp_size - 1);
+				grid_size = (ptask->kern.post_num_threads +
+							 block_size - 1) / block_size;
+			}
+			else
+			{
+				rc = gpuOptimalBlockSize(NULL,
+										 &block_size,
+										 kern_plcuda_post,
+										 ptask->kern.post_num_threads,
+										 ptask->kern.post_shmem_blocksz,
+										 ptask->kern.post_shmem_unitsz);
+				if (rc != CUDA_SUCCESS)
+					werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+				grid_size = (ptask->kern.post_num_threads +
+							 block_size - 1) / block_size;
+			}
+
+			range_id = pgstromNvtxRangeStart(ptask->task.gts, "plcuda_post");
+			rc = cuLaunchKernel(kern_plcuda_post,
+								grid_size, 1, 1,
+								block_size, 1, 1,
+								ptask->kern.post_shmem_blocksz +
+								ptask->kern.post_shmem_unitsz * block_size,
+								CU_STREAM_PER_THREAD,
+								kern_args,
+								NULL);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuLaunchKernel: %s "
+					   "(post-kernel: grid=%u block=%u shmem=%zu)",
+					   errorText(rc),
+					   (cl_uint)grid_size, (cl_uint)block_size,
+					   ptask->kern.post_shmem_blocksz +
+					   ptask->kern.post_shmem_unitsz * block_size);
+			wdebug("PL/CUDA post-kernel: grid=%u block=%u shmem=%zu",
 				   (cl_uint)grid_size, (cl_uint)block_size,
 				   ptask->kern.post_shmem_blocksz +
 				   ptask->kern.post_shmem_unitsz * block_size);
-		wdebug("PL/CUDA post-kernel: grid=%u block=%u shmem=%zu",
-			   (cl_uint)grid_size, (cl_uint)block_size,
-			   ptask->kern.post_shmem_blocksz +
-			   ptask->kern.post_shmem_unitsz * block_size);
-	}
-	/* write back the control block */
-	rc = cuMemPrefetchAsync((CUdeviceptr)&ptask->kern,
-							KERN_PLCUDA_DMARECV_LENGTH(&ptask->kern),
-							CU_DEVICE_CPU,
-							CU_STREAM_PER_THREAD);
-	if (rc != CUDA_SUCCESS)
-		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
-
-	/* write back the result buffer, if any */
-	if (m_results_buf != 0UL)
-	{
-		rc = cuMemPrefetchAsync(ptask->m_results_buf,
-								ptask->kern.results_bufsz,
+			pgstromNvtxRangeEnd(range_id);
+		}
+		/* write back the control block */
+		range_id = pgstromNvtxRangeStart(ptask->task.gts, "DMA recv");
+		rc = cuMemPrefetchAsync((CUdeviceptr)&ptask->kern,
+								KERN_PLCUDA_DMARECV_LENGTH(&ptask->kern),
 								CU_DEVICE_CPU,
 								CU_STREAM_PER_THREAD);
 		if (rc != CUDA_SUCCESS)
 			werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
-	}
-
-	rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
-	if (rc != CUDA_SUCCESS)
-		werror("failed on cuEventRecord: %s", errorText(rc));
 
-	/* Point of synchronization */
-	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
-	if (rc != CUDA_SUCCESS)
-		werror("failed on cuEventSynchronize: %s", errorText(rc));
+		/* write back the result buffer, if any and not streamed yet */
+		if (m_results_buf != 0UL && !download_stream)
+		{
+			rc = cuMemPrefetchAsync(ptask->m_results_buf,
+									ptask->kern.results_bufsz,
+									CU_DEVICE_CPU,
+									CU_STREAM_PER_THREAD);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+		}
 
-	/* check kernel execution status */
-	memset(&ptask->task.kerror, 0, sizeof(kern_errorbuf));
-	if (ptask->exec_prep_kernel &&
-		ptask->kern.kerror_prep.errcode != StromError_Success)
-		ptask->task.kerror = ptask->kern.kerror_prep;
-	else if (ptask->kern.kerror_main.errcode != StromError_Success)
-		ptask->task.kerror = ptask->kern.kerror_main;
-	else if (ptask->exec_post_kernel &&
-			 ptask->kern.kerror_post.errcode != StromError_Success)
-		ptask->task.kerror = ptask->kern.kerror_post;
+		rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventRecord: %s", errorText(rc));
 
-	retval = 0;
+		/* Point of synchronization */
+		rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+		if (rc != CUDA_SUCCESS)
+			werror("failed on cuEventSynchronize: %s", errorText(rc));
+		if (download_stream)
+		{
+			rc = cuStreamSynchronize(download_stream);
+			if (rc != CUDA_SUCCESS)
+				werror("failed on cuStreamSynchronize: %s", errorText(rc));
+		}
+		pgstromNvtxRangeEnd(range_id);
+
+		/* check kernel execution status */
+		memset(&ptask->task.kerror, 0, sizeof(kern_errorbuf));
+		if (ptask->exec_prep_kernel &&
+			ptask->kern.kerror_prep.errcode != StromError_Success)
+			ptask->task.kerror = ptask->kern.kerror_prep;
+		else if (ptask->kern.kerror_main.errcode != StromError_Success)
+			ptask->task.kerror = ptask->kern.kerror_main;
+		else if (ptask->exec_post_kernel &&
+				 ptask->kern.kerror_post.errcode != StromError_Success)
+			ptask->task.kerror = ptask->kern.kerror_post;
+
+		retval = 0;
+	}
+	STROM_CATCH();
+	{
+		failed = true;
+	}
+	STROM_END_TRY();
 
 out_of_resource:
-	if (m_working_buf != 0UL)
+	/*
+	 * kernels may still run on errors; the working buffer is released with
+	 * the GpuContext in this case.
+	 */
+	if (m_working_buf != 0UL && !failed)
 	{
 		rc = gpuMemFree(gcontext, m_working_buf);
 		if (rc != CUDA_SUCCESS)
 			werror("failed on gpuMemFree: %s", errorText(rc));
 	}
+	if (chunk_events)
+	{
+		for (k=0; k < 2 * num_chunks; k++)
+		{
+			if (chunk_events[k])
+				cuEventDestroy(chunk_events[k]);
+		}
+		free(chunk_events);
+	}
+	if (upload_stream)
+		cuStreamDestroy(upload_stream);
+	if (download_stream)
+		cuStreamDestroy(download_stream);
+	if (failed)
+		STROM_RE_THROW();
 	return retval;
 }
 
@@ -2716,11 +3434,16 @@ static void
 plcuda_release_task(GpuTask *gtask)
 {
 	plcudaTask	   *ptask = (plcudaTask *) gtask;
-	GpuContext	   *gcontext = ptask->task.gts->gcontext;
+	plcudaTaskState *plts = (plcudaTaskState *) ptask->task.gts;
+	GpuContext	   *gcontext = plts->gts.gcontext;
 
-	if (ptask->m_results_buf)
+	/* buffers recycled by plcudaTaskState are released at exec_end */
+	if (ptask->m_results_buf &&
+		!ptask->results_buf_shared &&
+		ptask->m_results_buf != plts->last_results_buf)
 		gpuMemFree(gcontext, ptask->m_results_buf);
-	gpuMemFree(gcontext, (CUdeviceptr)ptask);
+	if ((CUdeviceptr)ptask != plts->m_task_buf)
+		gpuMemFree(gcontext, (CUdeviceptr)ptask);
 }
 
 /*
@@ -2729,6 +3452,16 @@ plcuda_release_task(GpuTask *gtask)
 void
 pgstrom_init_plcuda(void)
 {
+	DefineCustomIntVariable("pg_strom.plcuda_arg_cache_threshold",
+							"threshold to keep PL/CUDA arguments on the device memory",
+							NULL,
+							&plcuda_arg_cache_threshold,
+							4096,		/* 4MB */
+							-1,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
 	dlist_init(&plcuda_state_list);
 	RegisterResourceReleaseCallback(plcuda_cleanup_resources, NULL);
 }
@@ -0,0 +1,524 @@
+/*
+ * randgen.c
+ *
+ * GPU-side random data generator to build large tables for load testing.
+ * ----
+ * Copyright 2011-2018 (C) KaiGai Kohei <kaigai@kaigai.gr.jp>
+ * Copyright 2014-2018 (C) The PG-Strom Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "postgres.h"
+#include "access/heapam.h"
+#include "utils/acl.h"
+#include "pg_strom.h"
+
+/*
+ * randgenState - state of pgstrom.random_fill(); a dummy GpuTaskState
+ * to run the generator on the GpuContext worker, like PL/CUDA.
+ */
+typedef struct
+{
+	GpuTaskState	gts;
+	Relation		rel;
+	kern_data_store *kds_head;	/* template of KDS_FORMAT_COLUMN */
+	bool		   *nullable;	/* true, if column has nullmap */
+	cl_ulong		seed;
+	cl_ulong		nrows;		/* # of rows to be generated */
+	cl_ulong		row_base;	/* # of rows already assigned to tasks */
+	cl_uint			nrooms;		/* # of rows per task */
+} randgenState;
+
+/*
+ * randgenTask - a chunk of the generated rows
+ */
+typedef struct
+{
+	GpuTask			task;
+	cl_ulong		seed;
+	cl_ulong		row_base;
+	kern_data_store	kds;		/* KDS_FORMAT_COLUMN; must be last */
+} randgenTask;
+
+/* number of tuples per heap_multi_insert(), same as COPY FROM */
+#define RANDGEN_INSERT_BATCHSZ		1000
+
+Datum pgstrom_random_fill(PG_FUNCTION_ARGS);
+
+/*
+ * randgen_codegen_column - generates a random value for a column
+ */
+static void
+randgen_codegen_column(StringInfo buf, Form_pg_attribute attr,
+					   int colidx, bool nullable, double ratio)
+{
+	const char *ctype;
+	int64		lower = 0;
+	int64		upper = 0;
+	bool		is_float = false;
+
+	switch (attr->atttypid)
+	{
+		case BOOLOID:
+			ctype = "cl_bool";
+			upper = 2;
+			break;
+		case INT2OID:
+			ctype = "cl_short";
+			upper = SHRT_MAX;
+			break;
+		case INT4OID:
+			ctype = "cl_int";
+			upper = INT_MAX;
+			break;
+		case INT8OID:
+			ctype = "cl_long";
+			upper = INT_MAX;
+			break;
+		case FLOAT4OID:
+			ctype = "cl_float";
+			is_float = true;
+			break;
+		case FLOAT8OID:
+			ctype = "cl_double";
+			is_float = true;
+			break;
+		case DATEOID:
+			/* same as the default of pgstrom.random_date() */
+			ctype = "cl_int";
+			lower = date2j(2015, 1, 1) - POSTGRES_EPOCH_JDATE;
+			upper = date2j(2025, 12, 31) - POSTGRES_EPOCH_JDATE;
+			break;
+		case TIMEOID:
+			ctype = "cl_long";
+			upper = HOURS_PER_DAY * USECS_PER_HOUR - 1;
+			break;
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			/* same as the default of pgstrom.random_timestamp() */
+			ctype = "cl_long";
+			lower = (int64)(date2j(2015, 1, 1) -
+							POSTGRES_EPOCH_JDATE) * USECS_PER_DAY;
+			upper = (int64)(date2j(2025, 1, 1) -
+							POSTGRES_EPOCH_JDATE) * USECS_PER_DAY;
+			break;
+		default:
+			elog(ERROR, "pgstrom.random_fill: column \"%s\" of %s is not supported",
+				 NameStr(attr->attname), format_type_be(attr->atttypid));
+	}
+
+	appendStringInfo(
+		buf,
+		"\n"
+		"    /* %s */\n"
+		"    values = (char *)kds + ((size_t)kds->colmeta[%d].va_offset\n"
+		"                            << MAXIMUM_ALIGNOF_SHIFT);\n",
+		NameStr(attr->attname), colidx);
+	if (nullable)
+		appendStringInfo(
+			buf,
+			"    nullmap = (cl_uint *)(values +\n"
+			"                          MAXALIGN(sizeof(%s) * nitems));\n"
+			"    if (curand_uniform_double(&rstate) * 100.0 >= %.6f)\n"
+			"    {\n",
+			ctype, ratio);
+	else
+		appendStringInfo(buf, "    {\n");
+
+	if (is_float)
+		appendStringInfo(
+			buf,
+			"      ((%s *)values)[i] = (%s)curand_uniform_double(&rstate);\n",
+			ctype, ctype);
+	else
+		appendStringInfo(
+			buf,
+			"      v = ((cl_ulong)curand(&rstate) << 32) |\n"
+			"          ((cl_ulong)curand(&rstate));\n"
+			"      ((%s *)values)[i] = (%s)(%ldL + (cl_long)(v %% %luUL));\n",
+			ctype, ctype, (long)lower, (unsigned long)(upper - lower));
+	if (nullable)
+		appendStringInfo(
+			buf,
+			"      atomicOr(&nullmap[i / 32], 1U << (i %% 32));\n");
+	appendStringInfo(buf, "    }\n");
+}
+
+/*
+ * randgen_codegen - generates the GPU kernel to fill up KDS_FORMAT_COLUMN
+ */
+static char *
+randgen_codegen(TupleDesc tupdesc, bool *nullable, double ratio)
+{
+	StringInfoData buf;
+	int			j;
+
+	initStringInfo(&buf);
+	appendStringInfo(
+		&buf,
+		"KERNEL_FUNCTION(void)\n"
+		"kern_random_generate(kern_data_store *kds,\n"
+		"                     cl_ulong seed,\n"
+		"                     cl_ulong row_base)\n"
+		"{\n"
+		"  curandState_t rstate;\n"
+		"  cl_uint       nitems = kds->nitems;\n"
+		"  cl_uint       i;\n"
+		"  char         *values;\n"
+		"  cl_uint      *nullmap;\n"
+		"  cl_ulong      v;\n"
+		"\n"
+		"  /* independent seed for each thread; no skipahead is needed */\n"
+		"  curand_init(seed ^ ((row_base + get_global_id()) *\n"
+		"                      0x9e3779b97f4a7c15UL), 0, 0, &rstate);\n"
+		"  for (i = get_global_id(); i < nitems; i += get_global_size())\n"
+		"  {\n");
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[j];
+
+		if (attr->attisdropped)
+			continue;
+		randgen_codegen_column(&buf, attr, j, nullable[j], ratio);
+	}
+	appendStringInfo(
+		&buf,
+		"  }\n"
+		"  (void)nullmap;\n"
+		"  (void)v;\n"
+		"}\n");
+	return buf.data;
+}
+
+/*
+ * randgen_setup_kds - assigns the data arrays of KDS_FORMAT_COLUMN
+ */
+static size_t
+randgen_setup_kds(randgenState *rgs, kern_data_store *kds, cl_uint nitems)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rgs->rel);
+	size_t		offset = KERN_DATA_STORE_HEAD_LENGTH(rgs->kds_head);
+	int			j;
+
+	if (kds)
+	{
+		memcpy(kds, rgs->kds_head, offset);
+		kds->nitems = nitems;
+		kds->nrooms = nitems;
+	}
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		kern_colmeta *cmeta = &rgs->kds_head->colmeta[j];
+		size_t		unitsz;
+		size_t		extra_sz = 0;
+
+		if (tupdesc->attrs[j]->attisdropped)
+			continue;		/* va_offset = 0 means NULL */
+		unitsz = MAXALIGN(TYPEALIGN(cmeta->attalign,
+									cmeta->attlen) * nitems);
+		if (rgs->nullable[j])
+			extra_sz = MAXALIGN(BITMAPLEN(nitems));
+		if (kds)
+		{
+			kds->colmeta[j].va_offset = offset >> MAXIMUM_ALIGNOF_SHIFT;
+			kds->colmeta[j].extra_sz = extra_sz >> MAXIMUM_ALIGNOF_SHIFT;
+			/* bits of nullmap shall be set by the kernel, if not null */
+			if (extra_sz > 0)
+				memset((char *)kds + offset + unitsz, 0, extra_sz);
+		}
+		offset += unitsz + extra_sz;
+	}
+	if (kds)
+		kds->length = offset;
+	return offset;
+}
+
+/*
+ * randgen_next_task
+ */
+static GpuTask *
+randgen_next_task(GpuTaskState *gts)
+{
+	randgenState   *rgs = (randgenState *) gts;
+	randgenTask	   *rtask;
+	cl_uint			nitems;
+	size_t			length;
+	CUdeviceptr		m_deviceptr;
+	CUresult		rc;
+
+	if (rgs->row_base >= rgs->nrows)
+		return NULL;
+	nitems = Min(rgs->nrows - rgs->row_base, rgs->nrooms);
+	length = randgen_setup_kds(rgs, NULL, nitems);
+
+	rc = gpuMemAllocManaged(gts->gcontext,
+							&m_deviceptr,
+							offsetof(randgenTask, kds) + length,
+							CU_MEM_ATTACH_GLOBAL);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on gpuMemAllocManaged: %s", errorText(rc));
+	rtask = (randgenTask *) m_deviceptr;
+	memset(rtask, 0, offsetof(randgenTask, kds));
+	pgstromInitGpuTask(gts, &rtask->task);
+	rtask->seed = rgs->seed;
+	rtask->row_base = rgs->row_base;
+	randgen_setup_kds(rgs, &rtask->kds, nitems);
+
+	rgs->row_base += nitems;
+
+	return &rtask->task;
+}
+
+/*
+ * randgen_process_task - runs on the GpuContext worker
+ */
+static int
+randgen_process_task(GpuTask *gtask, CUmodule cuda_module)
+{
+	randgenTask	   *rtask = (randgenTask *) gtask;
+	CUfunction		kern_random_generate;
+	CUdeviceptr		m_kds = (CUdeviceptr)&rtask->kds;
+	size_t			grid_sz;
+	size_t			block_sz;
+	void		   *kern_args[3];
+	CUresult		rc;
+
+	rc = cuModuleGetFunction(&kern_random_generate, cuda_module,
+							 "kern_random_generate");
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuModuleGetFunction: %s", errorText(rc));
+
+	rc = cuMemPrefetchAsync(m_kds, rtask->kds.length,
+							CU_DEVICE_PER_THREAD,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+	rc = gpuOptimalBlockSize(&grid_sz,
+							 &block_sz,
+							 kern_random_generate,
+							 rtask->kds.nitems,
+							 0, 0);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on gpuOptimalBlockSize: %s", errorText(rc));
+	kern_args[0] = &m_kds;
+	kern_args[1] = &rtask->seed;
+	kern_args[2] = &rtask->row_base;
+	rc = cuLaunchKernel(kern_random_generate,
+						grid_sz, 1, 1,
+						block_sz, 1, 1,
+						0,
+						CU_STREAM_PER_THREAD,
+						kern_args,
+						NULL);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuLaunchKernel: %s", errorText(rc));
+
+	/* write back the generated data */
+	rc = cuMemPrefetchAsync(m_kds, rtask->kds.length,
+							CU_DEVICE_CPU,
+							CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuMemPrefetchAsync: %s", errorText(rc));
+
+	rc = cuEventRecord(CU_EVENT0_PER_THREAD, CU_STREAM_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventRecord: %s", errorText(rc));
+
+	/* Point of synchronization */
+	rc = cuEventSynchronize(CU_EVENT0_PER_THREAD);
+	if (rc != CUDA_SUCCESS)
+		werror("failed on cuEventSynchronize: %s", errorText(rc));
+	pgstromStatDmaRecv(gtask->gts, rtask->kds.length);
+
+	return 0;
+}
+
+/*
+ * randgen_release_task
+ */
+static void
+randgen_release_task(GpuTask *gtask)
+{
+	gpuMemFree(gtask->gts->gcontext, (CUdeviceptr)gtask);
+}
+
+/*
+ * randgen_insert_rows - writes out the generated rows to the heap
+ */
+static void
+randgen_insert_rows(randgenState *rgs, kern_data_store *kds,
+					TupleTableSlot *slot, BulkInsertState bistate,
+					MemoryContext batch_cxt)
+{
+	HeapTuple	tuples[RANDGEN_INSERT_BATCHSZ];
+	CommandId	cid = GetCurrentCommandId(true);
+	MemoryContext oldcxt;
+	cl_uint		i, ntuples = 0;
+
+	oldcxt = MemoryContextSwitchTo(batch_cxt);
+	for (i=0; i < kds->nitems; i++)
+	{
+		if (!KDS_fetch_tuple_column(slot, kds, i))
+			elog(ERROR, "Bug? generated row %u is out of range", i);
+		tuples[ntuples++] = ExecCopySlotTuple(slot);
+		if (ntuples == RANDGEN_INSERT_BATCHSZ || i + 1 == kds->nitems)
+		{
+			CHECK_FOR_INTERRUPTS();
+			heap_multi_insert(rgs->rel, tuples, ntuples,
+							  cid, 0, bistate);
+			MemoryContextReset(batch_cxt);
+			ntuples = 0;
+		}
+	}
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * pgstrom_random_fill(regclass, bigint, float8, bigint)
+ *
+ * It appends the specified number of rows with random values generated
+ * by GPU, using the same default range of the pgstrom.random_*()
+ * functions. The target table must not have indexes, triggers and
+ * CHECK constraints, because the rows are written out by
+ * heap_multi_insert() bypassing the executor.
+ */
+Datum
+pgstrom_random_fill(PG_FUNCTION_ARGS)
+{
+	Oid				relid = PG_GETARG_OID(0);
+	int64			nrows = PG_GETARG_INT64(1);
+	double			ratio = (!PG_ARGISNULL(2) ? PG_GETARG_FLOAT8(2) : 0.0);
+	Relation		rel;
+	TupleDesc		tupdesc;
+	AclResult		aclresult;
+	randgenState   *rgs;
+	GpuContext	   *gcontext;
+	size_t			head_sz;
+	size_t			unitsz;
+	char		   *kern_source;
+	StringInfoData	kern_define;
+	TupleTableSlot *slot;
+	BulkInsertState	bistate;
+	MemoryContext	batch_cxt;
+	GpuTask		   *gtask;
+	int				j;
+
+	if (nrows < 0)
+		elog(ERROR, "number of rows must be positive");
+	if (ratio < 0.0 || ratio > 100.0)
+		elog(ERROR, "NULL ratio must be in range of 0.0 - 100.0");
+
+	rel = heap_open(relid, RowExclusiveLock);
+	if (RelationGetForm(rel)->relkind != RELKIND_RELATION)
+		elog(ERROR, "\"%s\" is not a regular table",
+			 RelationGetRelationName(rel));
+	aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_INSERT);
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, ACL_KIND_CLASS,
+					   RelationGetRelationName(rel));
+	tupdesc = RelationGetDescr(rel);
+	if (RelationGetForm(rel)->relhasindex ||
+		rel->trigdesc != NULL ||
+		(tupdesc->constr && tupdesc->constr->num_check > 0))
+		elog(ERROR, "pgstrom.random_fill: \"%s\" must not have indexes, triggers and CHECK constraints",
+			 RelationGetRelationName(rel));
+	/* rows generated on GPU are never checked by the policies */
+	if (RelationGetForm(rel)->relrowsecurity)
+		elog(ERROR, "pgstrom.random_fill: \"%s\" must not have row level security",
+			 RelationGetRelationName(rel));
+
+	rgs = palloc0(sizeof(randgenState));
+	rgs->rel = rel;
+	rgs->nrows = nrows;
+	rgs->seed = (!PG_ARGISNULL(3)
+				 ? (cl_ulong)PG_GETARG_INT64(3)
+				 : ((cl_ulong)random() << 31) | (cl_ulong)random());
+	rgs->nullable = palloc0(sizeof(bool) * tupdesc->natts);
+
+	/* template of KDS_FORMAT_COLUMN, and estimation of nrooms */
+	head_sz = STROMALIGN(offsetof(kern_data_store,
+								  colmeta[tupdesc->natts +
+										  NumOfSystemAttrs]));
+	rgs->kds_head = palloc0(head_sz);
+	init_kernel_data_store(rgs->kds_head, tupdesc, head_sz,
+						   KDS_FORMAT_COLUMN, 0);
+	rgs->kds_head->table_oid = RelationGetRelid(rel);
+	unitsz = 0;
+	for (j=0; j < tupdesc->natts; j++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[j];
+
+		if (attr->attisdropped)
+			continue;
+		rgs->nullable[j] = (ratio > 0.0 && !attr->attnotnull);
+		unitsz += TYPEALIGN(rgs->kds_head->colmeta[j].attalign,
+							rgs->kds_head->colmeta[j].attlen);
+	}
+	rgs->nrooms = Max(pgstrom_chunk_size() / Max(unitsz, 1), 1);
+
+	/* build GPU kernel, then setup a dummy GTS (see plcuda_exec_begin) */
+	kern_source = randgen_codegen(tupdesc, rgs->nullable, ratio);
+
+	gcontext = AllocGpuContext(-1, false);
+	ActivateGpuContext(gcontext);
+	rgs->gts.gcontext = gcontext;
+	rgs->gts.task_kind = GpuTaskKind_RandGen;
+	rgs->gts.kern_params = NULL;
+	rgs->gts.ccache_refs = NULL;
+	rgs->gts.tuple_bound = -1;
+	rgs->gts.cb_next_task = randgen_next_task;
+	rgs->gts.cb_process_task = randgen_process_task;
+	rgs->gts.cb_release_task = randgen_release_task;
+	dlist_init(&rgs->gts.ready_tasks);
+
+	initStringInfo(&kern_define);
+	pgstrom_build_session_info(&kern_define,
+							   &rgs->gts,
+							   DEVKERNEL_NEEDS_CURAND);
+	rgs->gts.program_id = pgstrom_create_cuda_program(gcontext,
+													  DEVKERNEL_NEEDS_CURAND,
+													  kern_source,
+													  kern_define.data,
+													  false,
+													  false);
+	pfree(kern_define.data);
+
+	/*
+	 * GPU generates the next chunks asynchronously, during the insertion
+	 * of the generated rows by CPU.
+	 */
+	slot = MakeSingleTupleTableSlot(tupdesc);
+	bistate = GetBulkInsertState();
+	batch_cxt = AllocSetContextCreate(CurrentMemoryContext,
+									  "random_fill batch context",
+									  ALLOCSET_DEFAULT_SIZES);
+	while ((gtask = fetch_next_gputask(&rgs->gts)) != NULL)
+	{
+		randgenTask *rtask = (randgenTask *) gtask;
+
+		if (gtask->kerror.errcode != StromError_Success)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("GPU kernel error: %s",
+							errorTextKernel(&gtask->kerror))));
+		randgen_insert_rows(rgs, &rtask->kds, slot, bistate, batch_cxt);
+		randgen_release_task(gtask);
+	}
+	MemoryContextDelete(batch_cxt);
+	FreeBulkInsertState(bistate);
+	ExecDropSingleTupleTableSlot(slot);
+
+	pgstromReleaseGpuTaskState(&rgs->gts);
+	heap_close(rel, NoLock);
+
+	PG_RETURN_INT64(nrows);
+}
+PG_FUNCTION_INFO_V1(pgstrom_random_fill);
@@ -0,0 +1,115 @@
+--
+-- Test for jsonb operators
+--
+CREATE TABLE t_jsonb (id int primary key,
+                      a jsonb,  -- small object in short varlena
+                      b jsonb,  -- object with JENTRY_HAS_OFF strides
+                      c jsonb,  -- array of strings
+                      d jsonb,  -- nested containers
+                      e jsonb); -- raw scalar, or array of scalars
+INSERT INTO t_jsonb (
+  SELECT x,
+         jsonb_build_object('a', x % 7,
+                            'b', 'str' || (x % 5),
+                            'c', (x % 3 = 0),
+                            'd', CASE WHEN x % 11 = 0 THEN NULL ELSE x % 13 END),
+         (SELECT jsonb_object_agg('k' || i, (x + i) % 10)
+            FROM generate_series(1, 40) i),
+         (SELECT jsonb_agg('e' || ((x * i) % 50))
+            FROM generate_series(1, 40) i),
+         jsonb_build_object('l1', jsonb_build_object('l2',
+                                  jsonb_build_object('l3',
+                                  jsonb_build_object('l4', x % 4))),
+                            'arr', jsonb_build_array(x % 3,
+                                   jsonb_build_array(x % 2, 'v' || (x % 5)))),
+         CASE WHEN x % 2 = 0
+              THEN to_jsonb(x % 5)
+              ELSE jsonb_build_array(x % 3, x % 5, 'e' || (x % 7))
+         END
+    FROM generate_series(1, 100000) x);
+VACUUM ANALYZE t_jsonb;
+
+RESET pg_strom.enabled;
+SET pg_strom.cpu_fallback = on;
+SET enable_indexscan = off;
+-- jsonb ? text
+SELECT id, a ? 'a' v1, a ? 'e' v2, b ? 'k33' v3, b ? 'k40' v4,
+       c ? 'e7' v5, c ? 'k1' v6, e ? 'e3' v7
+  INTO pg_temp.test01a
+  FROM t_jsonb
+ WHERE id % 3 = 0;
+-- jsonb @> jsonb and jsonb <@ jsonb
+SELECT id, a @> '{"a":3}' v1, a @> '{"b":"str2","c":true}' v2,
+       b @> '{"k35":4}' v3, b @> '{"k1":1,"k34":4,"k40":0}' v4,
+       c @> '["e7","e14"]' v5, c @> '"e21"' v6,
+       e @> '2' v7, e @> '[1,"e3"]' v8,
+       a <@ '{"a":3,"b":"str3","c":false,"d":3,"z":null}' v9
+  INTO pg_temp.test02a
+  FROM t_jsonb
+ WHERE id % 3 = 1;
+-- nested containers, deeper than the device supports
+SELECT id, d @> '{"l1":{"l2":{}}}' v1,
+       d @> '{"l1":{"l2":{"l3":{"l4":2}}}}' v2,
+       d @> '{"arr":[[1]]}' v3, d @> '{"arr":[2,["v4"]]}' v4
+  INTO pg_temp.test03a
+  FROM t_jsonb
+ WHERE id % 3 = 2;
+-- text extraction by ->> and #>>
+SELECT id, a ->> 'b' = 'str3' v1, a ->> 'a' = '3' v2, a ->> 'c' = 'true' v3,
+       a ->> 'd' <> '5' v4, b ->> 'k37' = '5' v5, c ->> 33 = 'e0' v6,
+       d #>> '{l1,l2,l3,l4}' = '2' v7, d #>> '{arr,1,1}' = 'v4' v8
+  INTO pg_temp.test04a
+  FROM t_jsonb
+ WHERE id % 2 = 0;
+SELECT id, a, d
+  INTO pg_temp.test05a
+  FROM t_jsonb
+ WHERE a ? 'd' AND c @> '["e7"]' AND d #>> '{arr,1,1}' = 'v2';
+
+SET pg_strom.enabled = off;
+-- jsonb ? text
+SELECT id, a ? 'a' v1, a ? 'e' v2, b ? 'k33' v3, b ? 'k40' v4,
+       c ? 'e7' v5, c ? 'k1' v6, e ? 'e3' v7
+  INTO pg_temp.test01b
+  FROM t_jsonb
+ WHERE id % 3 = 0;
+-- jsonb @> jsonb and jsonb <@ jsonb
+SELECT id, a @> '{"a":3}' v1, a @> '{"b":"str2","c":true}' v2,
+       b @> '{"k35":4}' v3, b @> '{"k1":1,"k34":4,"k40":0}' v4,
+       c @> '["e7","e14"]' v5, c @> '"e21"' v6,
+       e @> '2' v7, e @> '[1,"e3"]' v8,
+       a <@ '{"a":3,"b":"str3","c":false,"d":3,"z":null}' v9
+  INTO pg_temp.test02b
+  FROM t_jsonb
+ WHERE id % 3 = 1;
+-- nested containers, deeper than the device supports
+SELECT id, d @> '{"l1":{"l2":{}}}' v1,
+       d @> '{"l1":{"l2":{"l3":{"l4":2}}}}' v2,
+       d @> '{"arr":[[1]]}' v3, d @> '{"arr":[2,["v4"]]}' v4
+  INTO pg_temp.test03b
+  FROM t_jsonb
+ WHERE id % 3 = 2;
+-- text extraction by ->> and #>>
+SELECT id, a ->> 'b' = 'str3' v1, a ->> 'a' = '3' v2, a ->> 'c' = 'true' v3,
+       a ->> 'd' <> '5' v4, b ->> 'k37' = '5' v5, c ->> 33 = 'e0' v6,
+       d #>> '{l1,l2,l3,l4}' = '2' v7, d #>> '{arr,1,1}' = 'v4' v8
+  INTO pg_temp.test04b
+  FROM t_jsonb
+ WHERE id % 2 = 0;
+SELECT id, a, d
+  INTO pg_temp.test05b
+  FROM t_jsonb
+ WHERE a ? 'd' AND c @> '["e7"]' AND d #>> '{arr,1,1}' = 'v2';
+
+(SELECT * FROM pg_temp.test01a EXCEPT ALL SELECT * FROM pg_temp.test01b);
+(SELECT * FROM pg_temp.test01b EXCEPT ALL SELECT * FROM pg_temp.test01a);
+(SELECT * FROM pg_temp.test02a EXCEPT ALL SELECT * FROM pg_temp.test02b);
+(SELECT * FROM pg_temp.test02b EXCEPT ALL SELECT * FROM pg_temp.test02a);
+(SELECT * FROM pg_temp.test03a EXCEPT ALL SELECT * FROM pg_temp.test03b);
+(SELECT * FROM pg_temp.test03b EXCEPT ALL SELECT * FROM pg_temp.test03a);
+(SELECT * FROM pg_temp.test04a EXCEPT ALL SELECT * FROM pg_temp.test04b);
+(SELECT * FROM pg_temp.test04b EXCEPT ALL SELECT * FROM pg_temp.test04a);
+(SELECT * FROM pg_temp.test05a EXCEPT ALL SELECT * FROM pg_temp.test05b);
+(SELECT * FROM pg_temp.test05b EXCEPT ALL SELECT * FROM pg_temp.test05a);
+
+DROP TABLE t_jsonb;
@@ -0,0 +1,61 @@
+--
+-- Test for text functions
+--
+RESET pg_strom.enabled;
+SET pg_strom.cpu_fallback = on;
+SET enable_indexscan = off;
+SELECT id, length(cat || 'ＧＰＵ') v1, char_length('データ' || cat) v2,
+       octet_length(cat || 'ü') v3
+  INTO pg_temp.test01a
+  FROM t0
+ WHERE id % 7 = 0;
+SELECT id, substring(cat || 'ＧＰＵ', 0, 3) v1, substring('ＧＰＵ' || cat, -2, 4) v2,
+       substr(cat, 5, 100000) v3, substring(cat || 'データ', length(cat) + 2) v4,
+       substring(cat, 1000) v5, substring(cat, -5, 3) v6
+  INTO pg_temp.test02a
+  FROM t0
+ WHERE id % 7 = 1;
+SELECT id, lower(cat || 'ＡbＣ' COLLATE "C") v1, upper('ÄbÇ' || cat COLLATE "C") v2
+  INTO pg_temp.test03a
+  FROM t0
+ WHERE id % 7 = 2;
+SELECT id, cat || 'データ' v1
+  INTO pg_temp.test04a
+  FROM t0
+ WHERE id % 7 = 3 AND char_length(cat || 'データ') > 5;
+
+SET pg_strom.enabled = off;
+SELECT id, length(cat || 'ＧＰＵ') v1, char_length('データ' || cat) v2,
+       octet_length(cat || 'ü') v3
+  INTO pg_temp.test01b
+  FROM t0
+ WHERE id % 7 = 0;
+SELECT id, substring(cat || 'ＧＰＵ', 0, 3) v1, substring('ＧＰＵ' || cat, -2, 4) v2,
+       substr(cat, 5, 100000) v3, substring(cat || 'データ', length(cat) + 2) v4,
+       substring(cat, 1000) v5, substring(cat, -5, 3) v6
+  INTO pg_temp.test02b
+  FROM t0
+ WHERE id % 7 = 1;
+SELECT id, lower(cat || 'ＡbＣ' COLLATE "C") v1, upper('ÄbÇ' || cat COLLATE "C") v2
+  INTO pg_temp.test03b
+  FROM t0
+ WHERE id % 7 = 2;
+SELECT id, cat || 'データ' v1
+  INTO pg_temp.test04b
+  FROM t0
+ WHERE id % 7 = 3 AND char_length(cat || 'データ') > 5;
+
+(SELECT * FROM pg_temp.test01a EXCEPT ALL SELECT * FROM pg_temp.test01b);
+(SELECT * FROM pg_temp.test01b EXCEPT ALL SELECT * FROM pg_temp.test01a);
+(SELECT * FROM pg_temp.test02a EXCEPT ALL SELECT * FROM pg_temp.test02b);
+(SELECT * FROM pg_temp.test02b EXCEPT ALL SELECT * FROM pg_temp.test02a);
+(SELECT * FROM pg_temp.test03a EXCEPT ALL SELECT * FROM pg_temp.test03b);
+(SELECT * FROM pg_temp.test03b EXCEPT ALL SELECT * FROM pg_temp.test03a);
+(SELECT * FROM pg_temp.test04a EXCEPT ALL SELECT * FROM pg_temp.test04b);
+(SELECT * FROM pg_temp.test04b EXCEPT ALL SELECT * FROM pg_temp.test04a);
+
+-- negative length raises an error, even if GPU evaluates
+RESET pg_strom.enabled;
+SELECT count(*) FROM t0 WHERE substring(cat, id % 3, -1) IS NOT NULL;
+SET pg_strom.enabled = off;
+SELECT count(*) FROM t0 WHERE substring(cat, id % 3, -1) IS NOT NULL;
@@ -0,0 +1,35 @@
+--
+-- Test for pgstrom.pg_stat_gpu_activity
+--
+RESET pg_strom.enabled;
+SET pg_strom.cpu_fallback = on;
+SET enable_indexscan = off;
+SET cursor_tuple_fraction = 1.0;
+SELECT aid, atext
+  INTO pg_temp.test01a
+  FROM t1
+ WHERE ax > 100.0 AND atext LIKE '%a%';
+-- GpuContext of the open cursor shall appear with its counters
+BEGIN;
+DECLARE c1 CURSOR FOR
+  SELECT aid, atext FROM t1 WHERE ax > 100.0 AND atext LIKE '%a%';
+MOVE FORWARD 10 IN c1;
+SELECT count(*) > 0 v1,
+       bool_and(device_nr >= 0 AND since <= clock_timestamp()) v2,
+       bool_and(running_tasks >= 0 AND pending_tasks >= 0) v3,
+       bool_and(completed_tasks > 0) v4,
+       bool_and(dma_send_bytes + nvme_bytes > 0 AND gpu_task_time >= 0.0) v5
+  FROM pgstrom.pg_stat_gpu_activity
+ WHERE pid = pg_backend_pid();
+CLOSE c1;
+COMMIT;
+
+SET pg_strom.enabled = off;
+SELECT aid, atext
+  INTO pg_temp.test01b
+  FROM t1
+ WHERE ax > 100.0 AND atext LIKE '%a%';
+RESET cursor_tuple_fraction;
+
+(SELECT * FROM pg_temp.test01a EXCEPT ALL SELECT * FROM pg_temp.test01b);
+(SELECT * FROM pg_temp.test01b EXCEPT ALL SELECT * FROM pg_temp.test01a);
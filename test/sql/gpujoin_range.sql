@@ -0,0 +1,111 @@
+--
+-- Test for GpuNestLoop with range probe
+--
+CREATE TABLE t_range_o (id int, x int, r int4range);
+CREATE TABLE t_range_i (id int, lo int, hi int, r int4range);
+INSERT INTO t_range_o (
+  SELECT id, x,
+         CASE WHEN id % 97 = 0 THEN 'empty'::int4range
+              WHEN id % 89 = 0 THEN int4range(x, NULL)
+              ELSE int4range(x, x + id % 100)
+         END
+    FROM (SELECT id, CASE WHEN id % 50 = 0 THEN NULL
+                          ELSE (id * 7919) % 100000 END x
+            FROM generate_series(1, 50000) id) s);
+INSERT INTO t_range_i (
+  SELECT id, lo, hi,
+         CASE WHEN id % 41 = 0 THEN 'empty'::int4range
+              WHEN id % 1009 = 0 THEN int4range(NULL, hi, '[]')
+              ELSE int4range(lo, hi, '[]')
+         END
+    FROM (SELECT id, CASE WHEN id % 997 = 0 THEN NULL
+                          ELSE (id * 104729) % 100000 END lo,
+                     (id * 104729) % 100000 + id % 100 hi
+            FROM generate_series(1, 5000) id) s);
+VACUUM ANALYZE t_range_o;
+VACUUM ANALYZE t_range_i;
+
+RESET pg_strom.enabled;
+SET pg_strom.cpu_fallback = on;
+SET enable_indexscan = off;
+-- BETWEEN in 'outer OP inner' form
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test01a
+  FROM t_range_o o, t_range_i i
+ WHERE o.x BETWEEN i.lo AND i.hi;
+-- BETWEEN in 'inner OP outer' form
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test02a
+  FROM t_range_o o, t_range_i i
+ WHERE i.lo <= o.x AND i.hi >= o.x;
+-- range @> element, and element <@ range
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test03a
+  FROM t_range_o o, t_range_i i
+ WHERE i.r @> o.x;
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test04a
+  FROM t_range_o o, t_range_i i
+ WHERE o.x <@ i.r;
+-- range && range, with empty or infinite bounds
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test05a
+  FROM t_range_o o, t_range_i i
+ WHERE o.r && i.r AND o.id % 100 = 1;
+-- outer joins; unmatched rows outside of the window are also emitted
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test06a
+  FROM t_range_o o RIGHT JOIN t_range_i i ON i.r @> o.x;
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test07a
+  FROM t_range_o o LEFT JOIN t_range_i i ON o.x BETWEEN i.lo AND i.hi;
+
+SET pg_strom.enabled = off;
+-- BETWEEN in 'outer OP inner' form
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test01b
+  FROM t_range_o o, t_range_i i
+ WHERE o.x BETWEEN i.lo AND i.hi;
+-- BETWEEN in 'inner OP outer' form
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test02b
+  FROM t_range_o o, t_range_i i
+ WHERE i.lo <= o.x AND i.hi >= o.x;
+-- range @> element, and element <@ range
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test03b
+  FROM t_range_o o, t_range_i i
+ WHERE i.r @> o.x;
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test04b
+  FROM t_range_o o, t_range_i i
+ WHERE o.x <@ i.r;
+-- range && range, with empty or infinite bounds
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test05b
+  FROM t_range_o o, t_range_i i
+ WHERE o.r && i.r AND o.id % 100 = 1;
+-- outer joins; unmatched rows outside of the window are also emitted
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test06b
+  FROM t_range_o o RIGHT JOIN t_range_i i ON i.r @> o.x;
+SELECT o.id o_id, i.id i_id
+  INTO pg_temp.test07b
+  FROM t_range_o o LEFT JOIN t_range_i i ON o.x BETWEEN i.lo AND i.hi;
+
+(SELECT * FROM pg_temp.test01a EXCEPT ALL SELECT * FROM pg_temp.test01b);
+(SELECT * FROM pg_temp.test01b EXCEPT ALL SELECT * FROM pg_temp.test01a);
+(SELECT * FROM pg_temp.test02a EXCEPT ALL SELECT * FROM pg_temp.test02b);
+(SELECT * FROM pg_temp.test02b EXCEPT ALL SELECT * FROM pg_temp.test02a);
+(SELECT * FROM pg_temp.test03a EXCEPT ALL SELECT * FROM pg_temp.test03b);
+(SELECT * FROM pg_temp.test03b EXCEPT ALL SELECT * FROM pg_temp.test03a);
+(SELECT * FROM pg_temp.test04a EXCEPT ALL SELECT * FROM pg_temp.test04b);
+(SELECT * FROM pg_temp.test04b EXCEPT ALL SELECT * FROM pg_temp.test04a);
+(SELECT * FROM pg_temp.test05a EXCEPT ALL SELECT * FROM pg_temp.test05b);
+(SELECT * FROM pg_temp.test05b EXCEPT ALL SELECT * FROM pg_temp.test05a);
+(SELECT * FROM pg_temp.test06a EXCEPT ALL SELECT * FROM pg_temp.test06b);
+(SELECT * FROM pg_temp.test06b EXCEPT ALL SELECT * FROM pg_temp.test06a);
+(SELECT * FROM pg_temp.test07a EXCEPT ALL SELECT * FROM pg_temp.test07b);
+(SELECT * FROM pg_temp.test07b EXCEPT ALL SELECT * FROM pg_temp.test07a);
+
+DROP TABLE t_range_o, t_range_i;
@@ -0,0 +1,73 @@
+--
+-- Test for SEMI / ANTI JOIN by GpuJoin
+--
+RESET pg_strom.enabled;
+SET pg_strom.cpu_fallback = on;
+SET enable_indexscan = off;
+-- SEMI JOIN by GpuHashJoin, with duplicated inner keys
+SELECT id, aid, bid
+  INTO pg_temp.test01a
+  FROM t0
+ WHERE EXISTS (SELECT 1 FROM t1 WHERE t1.aid = t0.aid AND t1.ax < 300.0)
+   AND EXISTS (SELECT 1 FROM t2 WHERE t2.bid % 5000 = t0.bid);
+-- ANTI JOIN by GpuHashJoin; outer rows with NULL keys are emitted
+SELECT id, cid
+  INTO pg_temp.test02a
+  FROM t0
+ WHERE NOT EXISTS (SELECT 1 FROM t3 WHERE t3.cid = t0.cid AND t3.cx > 100.0);
+-- SEMI and ANTI JOIN by GpuNestLoop
+SELECT id, did, eid
+  INTO pg_temp.test03a
+  FROM t0
+ WHERE id % 20 = 0
+   AND EXISTS (SELECT 1 FROM t4
+                WHERE t4.did BETWEEN t0.did - 3 AND t0.did + 3
+                  AND t4.dx > 990.0)
+   AND NOT EXISTS (SELECT 1 FROM t5
+                    WHERE t5.eid BETWEEN t0.eid AND t0.eid + 5
+                      AND t5.ex < 50.0);
+-- mixture of INNER, SEMI and ANTI JOIN
+SELECT id, fid, gtext
+  INTO pg_temp.test04a
+  FROM t0 JOIN t7 ON t0.gid = t7.gid
+ WHERE EXISTS (SELECT 1 FROM t6 WHERE t6.fid = t0.fid AND t6.fy > 500.0)
+   AND NOT EXISTS (SELECT 1 FROM t8 WHERE t8.hid = t0.hid AND t8.hx < 500.0);
+
+SET pg_strom.enabled = off;
+-- SEMI JOIN by GpuHashJoin, with duplicated inner keys
+SELECT id, aid, bid
+  INTO pg_temp.test01b
+  FROM t0
+ WHERE EXISTS (SELECT 1 FROM t1 WHERE t1.aid = t0.aid AND t1.ax < 300.0)
+   AND EXISTS (SELECT 1 FROM t2 WHERE t2.bid % 5000 = t0.bid);
+-- ANTI JOIN by GpuHashJoin; outer rows with NULL keys are emitted
+SELECT id, cid
+  INTO pg_temp.test02b
+  FROM t0
+ WHERE NOT EXISTS (SELECT 1 FROM t3 WHERE t3.cid = t0.cid AND t3.cx > 100.0);
+-- SEMI and ANTI JOIN by GpuNestLoop
+SELECT id, did, eid
+  INTO pg_temp.test03b
+  FROM t0
+ WHERE id % 20 = 0
+   AND EXISTS (SELECT 1 FROM t4
+                WHERE t4.did BETWEEN t0.did - 3 AND t0.did + 3
+                  AND t4.dx > 990.0)
+   AND NOT EXISTS (SELECT 1 FROM t5
+                    WHERE t5.eid BETWEEN t0.eid AND t0.eid + 5
+                      AND t5.ex < 50.0);
+-- mixture of INNER, SEMI and ANTI JOIN
+SELECT id, fid, gtext
+  INTO pg_temp.test04b
+  FROM t0 JOIN t7 ON t0.gid = t7.gid
+ WHERE EXISTS (SELECT 1 FROM t6 WHERE t6.fid = t0.fid AND t6.fy > 500.0)
+   AND NOT EXISTS (SELECT 1 FROM t8 WHERE t8.hid = t0.hid AND t8.hx < 500.0);
+
+(SELECT * FROM pg_temp.test01a EXCEPT ALL SELECT * FROM pg_temp.test01b);
+(SELECT * FROM pg_temp.test01b EXCEPT ALL SELECT * FROM pg_temp.test01a);
+(SELECT * FROM pg_temp.test02a EXCEPT ALL SELECT * FROM pg_temp.test02b);
+(SELECT * FROM pg_temp.test02b EXCEPT ALL SELECT * FROM pg_temp.test02a);
+(SELECT * FROM pg_temp.test03a EXCEPT ALL SELECT * FROM pg_temp.test03b);
+(SELECT * FROM pg_temp.test03b EXCEPT ALL SELECT * FROM pg_temp.test03a);
+(SELECT * FROM pg_temp.test04a EXCEPT ALL SELECT * FROM pg_temp.test04b);
+(SELECT * FROM pg_temp.test04b EXCEPT ALL SELECT * FROM pg_temp.test04a);
@@ -0,0 +1,61 @@
+--
+-- Test for aggregate functions with DISTINCT on GpuPreAgg
+--
+RESET pg_strom.enabled;
+SET pg_strom.cpu_fallback = on;
+SET enable_indexscan = off;
+-- COUNT(DISTINCT) along with the regular aggregates
+SELECT aid % 100 k, count(DISTINCT bid % 1000) v1, count(*) v2,
+       sum(cid) v3, max(did) v4
+  INTO pg_temp.test01a
+  FROM t0
+ GROUP BY aid % 100;
+-- multiple DISTINCT aggregates on different arguments, with NULLs
+SELECT eid % 50 k, count(DISTINCT fid % 300) v1, sum(DISTINCT gid % 300) v2,
+       avg(DISTINCT hid % 300) v3, min(iid) v4
+  INTO pg_temp.test02a
+  FROM t0
+ GROUP BY eid % 50;
+-- DISTINCT on text and date, and DISTINCT with FILTER
+SELECT id % 7 k, count(DISTINCT cat) v1, count(DISTINCT ymd) v2,
+       count(DISTINCT aid % 10) FILTER (WHERE bid > 50000) v3
+  INTO pg_temp.test03a
+  FROM t0
+ GROUP BY id % 7;
+-- without GROUP BY
+SELECT count(DISTINCT cid) v1, sum(DISTINCT did % 777) v2, count(*) v3
+  INTO pg_temp.test04a
+  FROM t0;
+
+SET pg_strom.enabled = off;
+-- COUNT(DISTINCT) along with the regular aggregates
+SELECT aid % 100 k, count(DISTINCT bid % 1000) v1, count(*) v2,
+       sum(cid) v3, max(did) v4
+  INTO pg_temp.test01b
+  FROM t0
+ GROUP BY aid % 100;
+-- multiple DISTINCT aggregates on different arguments, with NULLs
+SELECT eid % 50 k, count(DISTINCT fid % 300) v1, sum(DISTINCT gid % 300) v2,
+       avg(DISTINCT hid % 300) v3, min(iid) v4
+  INTO pg_temp.test02b
+  FROM t0
+ GROUP BY eid % 50;
+-- DISTINCT on text and date, and DISTINCT with FILTER
+SELECT id % 7 k, count(DISTINCT cat) v1, count(DISTINCT ymd) v2,
+       count(DISTINCT aid % 10) FILTER (WHERE bid > 50000) v3
+  INTO pg_temp.test03b
+  FROM t0
+ GROUP BY id % 7;
+-- without GROUP BY
+SELECT count(DISTINCT cid) v1, sum(DISTINCT did % 777) v2, count(*) v3
+  INTO pg_temp.test04b
+  FROM t0;
+
+(SELECT * FROM pg_temp.test01a EXCEPT ALL SELECT * FROM pg_temp.test01b);
+(SELECT * FROM pg_temp.test01b EXCEPT ALL SELECT * FROM pg_temp.test01a);
+(SELECT * FROM pg_temp.test02a EXCEPT ALL SELECT * FROM pg_temp.test02b);
+(SELECT * FROM pg_temp.test02b EXCEPT ALL SELECT * FROM pg_temp.test02a);
+(SELECT * FROM pg_temp.test03a EXCEPT ALL SELECT * FROM pg_temp.test03b);
+(SELECT * FROM pg_temp.test03b EXCEPT ALL SELECT * FROM pg_temp.test03a);
+(SELECT * FROM pg_temp.test04a EXCEPT ALL SELECT * FROM pg_temp.test04b);
+(SELECT * FROM pg_temp.test04b EXCEPT ALL SELECT * FROM pg_temp.test04a);
@@ -0,0 +1,67 @@
+--
+-- Test for percentile_cont / percentile_disc on GpuPreAgg
+--
+RESET pg_strom.enabled;
+SET pg_strom.cpu_fallback = on;
+SET enable_indexscan = off;
+-- percentile_cont and percentile_disc with moderate cardinality
+SELECT aid % 10 k,
+       percentile_cont(0.5) WITHIN GROUP (ORDER BY round(ax)) v1,
+       percentile_cont(0.9) WITHIN GROUP (ORDER BY round(ax)) v2,
+       percentile_disc(0.25) WITHIN GROUP (ORDER BY round(ax)) v3,
+       percentile_disc(0.75) WITHIN GROUP (ORDER BY round(ay)) v4
+  INTO pg_temp.test01a
+  FROM t1
+ GROUP BY aid % 10;
+-- boundary fractions, FILTER clause, and groups of NULLs only
+SELECT aid % 100 k,
+       percentile_cont(0.0) WITHIN GROUP (ORDER BY round(ax)) v1,
+       percentile_cont(1.0) WITHIN GROUP (ORDER BY round(ax)) v2,
+       percentile_disc(0.5) WITHIN GROUP (ORDER BY round(ay))
+           FILTER (WHERE aid % 3 = 0) v3,
+       percentile_cont(0.5) WITHIN GROUP (ORDER BY round(ay))
+           FILTER (WHERE aid % 100 = 7) v4
+  INTO pg_temp.test02a
+  FROM t1
+ GROUP BY aid % 100;
+-- without GROUP BY, and along with the other aggregates
+SELECT count(*) c, count(ax) v1,
+       percentile_cont(0.5) WITHIN GROUP (ORDER BY round(ax)) v2,
+       percentile_disc(0.5) WITHIN GROUP (ORDER BY round(ax)) v3
+  INTO pg_temp.test03a
+  FROM t1;
+
+SET pg_strom.enabled = off;
+-- percentile_cont and percentile_disc with moderate cardinality
+SELECT aid % 10 k,
+       percentile_cont(0.5) WITHIN GROUP (ORDER BY round(ax)) v1,
+       percentile_cont(0.9) WITHIN GROUP (ORDER BY round(ax)) v2,
+       percentile_disc(0.25) WITHIN GROUP (ORDER BY round(ax)) v3,
+       percentile_disc(0.75) WITHIN GROUP (ORDER BY round(ay)) v4
+  INTO pg_temp.test01b
+  FROM t1
+ GROUP BY aid % 10;
+-- boundary fractions, FILTER clause, and groups of NULLs only
+SELECT aid % 100 k,
+       percentile_cont(0.0) WITHIN GROUP (ORDER BY round(ax)) v1,
+       percentile_cont(1.0) WITHIN GROUP (ORDER BY round(ax)) v2,
+       percentile_disc(0.5) WITHIN GROUP (ORDER BY round(ay))
+           FILTER (WHERE aid % 3 = 0) v3,
+       percentile_cont(0.5) WITHIN GROUP (ORDER BY round(ay))
+           FILTER (WHERE aid % 100 = 7) v4
+  INTO pg_temp.test02b
+  FROM t1
+ GROUP BY aid % 100;
+-- without GROUP BY, and along with the other aggregates
+SELECT count(*) c, count(ax) v1,
+       percentile_cont(0.5) WITHIN GROUP (ORDER BY round(ax)) v2,
+       percentile_disc(0.5) WITHIN GROUP (ORDER BY round(ax)) v3
+  INTO pg_temp.test03b
+  FROM t1;
+
+(SELECT * FROM pg_temp.test01a EXCEPT ALL SELECT * FROM pg_temp.test01b);
+(SELECT * FROM pg_temp.test01b EXCEPT ALL SELECT * FROM pg_temp.test01a);
+(SELECT * FROM pg_temp.test02a EXCEPT ALL SELECT * FROM pg_temp.test02b);
+(SELECT * FROM pg_temp.test02b EXCEPT ALL SELECT * FROM pg_temp.test02a);
+(SELECT * FROM pg_temp.test03a EXCEPT ALL SELECT * FROM pg_temp.test03b);
+(SELECT * FROM pg_temp.test03b EXCEPT ALL SELECT * FROM pg_temp.test03a);
@@ -0,0 +1,73 @@
+--
+-- Test for GpuSort
+--
+RESET pg_strom.enabled;
+SET pg_strom.cpu_fallback = on;
+SET enable_indexscan = off;
+-- ORDER BY ... LIMIT with NULLS FIRST; row number checks the order
+SELECT row_number() OVER () rn, id, aid
+  INTO pg_temp.test01a
+  FROM (SELECT id, aid FROM t0
+         WHERE aid IS NOT NULL OR id % 10000 = 0
+         ORDER BY aid NULLS FIRST, id LIMIT 300) s;
+-- DESC keys with OFFSET
+SELECT id, bid, cid
+  INTO pg_temp.test02a
+  FROM t0
+ ORDER BY bid DESC, cid, id LIMIT 500 OFFSET 200;
+-- text and date keys, mixed directions
+SELECT id, cat, ymd
+  INTO pg_temp.test03a
+  FROM t0
+ WHERE id % 3 = 0
+ ORDER BY cat, ymd DESC NULLS LAST, id LIMIT 1000;
+-- LIMIT larger than pg_strom.gpusort_max_bound
+SELECT id, did
+  INTO pg_temp.test04a
+  FROM t0
+ ORDER BY did, id LIMIT 3000;
+-- top-k of the groups produced by GpuPreAgg
+SELECT row_number() OVER () rn, k, c, s
+  INTO pg_temp.test05a
+  FROM (SELECT eid % 1000 k, count(*) c, sum(fid) s FROM t0
+         GROUP BY 1 ORDER BY c DESC, k LIMIT 20) s;
+
+SET pg_strom.enabled = off;
+-- ORDER BY ... LIMIT with NULLS FIRST; row number checks the order
+SELECT row_number() OVER () rn, id, aid
+  INTO pg_temp.test01b
+  FROM (SELECT id, aid FROM t0
+         WHERE aid IS NOT NULL OR id % 10000 = 0
+         ORDER BY aid NULLS FIRST, id LIMIT 300) s;
+-- DESC keys with OFFSET
+SELECT id, bid, cid
+  INTO pg_temp.test02b
+  FROM t0
+ ORDER BY bid DESC, cid, id LIMIT 500 OFFSET 200;
+-- text and date keys, mixed directions
+SELECT id, cat, ymd
+  INTO pg_temp.test03b
+  FROM t0
+ WHERE id % 3 = 0
+ ORDER BY cat, ymd DESC NULLS LAST, id LIMIT 1000;
+-- LIMIT larger than pg_strom.gpusort_max_bound
+SELECT id, did
+  INTO pg_temp.test04b
+  FROM t0
+ ORDER BY did, id LIMIT 3000;
+-- top-k of the groups produced by GpuPreAgg
+SELECT row_number() OVER () rn, k, c, s
+  INTO pg_temp.test05b
+  FROM (SELECT eid % 1000 k, count(*) c, sum(fid) s FROM t0
+         GROUP BY 1 ORDER BY c DESC, k LIMIT 20) s;
+
+(SELECT * FROM pg_temp.test01a EXCEPT ALL SELECT * FROM pg_temp.test01b);
+(SELECT * FROM pg_temp.test01b EXCEPT ALL SELECT * FROM pg_temp.test01a);
+(SELECT * FROM pg_temp.test02a EXCEPT ALL SELECT * FROM pg_temp.test02b);
+(SELECT * FROM pg_temp.test02b EXCEPT ALL SELECT * FROM pg_temp.test02a);
+(SELECT * FROM pg_temp.test03a EXCEPT ALL SELECT * FROM pg_temp.test03b);
+(SELECT * FROM pg_temp.test03b EXCEPT ALL SELECT * FROM pg_temp.test03a);
+(SELECT * FROM pg_temp.test04a EXCEPT ALL SELECT * FROM pg_temp.test04b);
+(SELECT * FROM pg_temp.test04b EXCEPT ALL SELECT * FROM pg_temp.test04a);
+(SELECT * FROM pg_temp.test05a EXCEPT ALL SELECT * FROM pg_temp.test05b);
+(SELECT * FROM pg_temp.test05b EXCEPT ALL SELECT * FROM pg_temp.test05a);
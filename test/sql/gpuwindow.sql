@@ -0,0 +1,61 @@
+--
+-- Test for GpuWindow
+--
+RESET pg_strom.enabled;
+SET pg_strom.cpu_fallback = on;
+SET enable_indexscan = off;
+-- peers of rank and dense_rank
+SELECT id, rank() OVER w v1, dense_rank() OVER w v2
+  INTO pg_temp.test01a
+  FROM t0
+WINDOW w AS (PARTITION BY id % 3 ORDER BY aid % 1000);
+-- ROWS n PRECEDING with NULLs
+SELECT id, sum(bid) OVER w v1, avg(bid) OVER w v2,
+       count(bid) OVER w v3, count(*) OVER w v4
+  INTO pg_temp.test02a
+  FROM t0
+WINDOW w AS (PARTITION BY cid % 10 ORDER BY id ROWS 5 PRECEDING);
+-- partitions across the chunk and block boundaries
+SELECT id, sum(did) OVER w1 v1, count(*) OVER w1 v2,
+       sum(eid) OVER w2 v3, row_number() OVER w1 v4
+  INTO pg_temp.test03a
+  FROM t0
+WINDOW w1 AS (PARTITION BY id % 2 ORDER BY id ROWS UNBOUNDED PRECEDING),
+       w2 AS (PARTITION BY id % 2 ORDER BY id ROWS 1000 PRECEDING);
+SELECT id, rank() OVER w v1, dense_rank() OVER w v2
+  INTO pg_temp.test04a
+  FROM t0
+WINDOW w AS (ORDER BY ymd);
+
+SET pg_strom.enabled = off;
+-- peers of rank and dense_rank
+SELECT id, rank() OVER w v1, dense_rank() OVER w v2
+  INTO pg_temp.test01b
+  FROM t0
+WINDOW w AS (PARTITION BY id % 3 ORDER BY aid % 1000);
+-- ROWS n PRECEDING with NULLs
+SELECT id, sum(bid) OVER w v1, avg(bid) OVER w v2,
+       count(bid) OVER w v3, count(*) OVER w v4
+  INTO pg_temp.test02b
+  FROM t0
+WINDOW w AS (PARTITION BY cid % 10 ORDER BY id ROWS 5 PRECEDING);
+-- partitions across the chunk and block boundaries
+SELECT id, sum(did) OVER w1 v1, count(*) OVER w1 v2,
+       sum(eid) OVER w2 v3, row_number() OVER w1 v4
+  INTO pg_temp.test03b
+  FROM t0
+WINDOW w1 AS (PARTITION BY id % 2 ORDER BY id ROWS UNBOUNDED PRECEDING),
+       w2 AS (PARTITION BY id % 2 ORDER BY id ROWS 1000 PRECEDING);
+SELECT id, rank() OVER w v1, dense_rank() OVER w v2
+  INTO pg_temp.test04b
+  FROM t0
+WINDOW w AS (ORDER BY ymd);
+
+(SELECT * FROM pg_temp.test01a EXCEPT ALL SELECT * FROM pg_temp.test01b);
+(SELECT * FROM pg_temp.test01b EXCEPT ALL SELECT * FROM pg_temp.test01a);
+(SELECT * FROM pg_temp.test02a EXCEPT ALL SELECT * FROM pg_temp.test02b);
+(SELECT * FROM pg_temp.test02b EXCEPT ALL SELECT * FROM pg_temp.test02a);
+(SELECT * FROM pg_temp.test03a EXCEPT ALL SELECT * FROM pg_temp.test03b);
+(SELECT * FROM pg_temp.test03b EXCEPT ALL SELECT * FROM pg_temp.test03a);
+(SELECT * FROM pg_temp.test04a EXCEPT ALL SELECT * FROM pg_temp.test04b);
+(SELECT * FROM pg_temp.test04b EXCEPT ALL SELECT * FROM pg_temp.test04a);
@@ -13,3 +13,41 @@ SHOW pg_strom.gpu_operator_cost;
 SHOW pg_strom.gpu_dma_cost;
 SHOW pg_strom.pullup_outer_scan;
 SHOW pg_strom.pullup_outer_join;
+SHOW pg_strom.adaptive_chunk_size;
+SHOW pg_strom.async_jit_fallback;
+SHOW pg_strom.ccache_compression;
+SHOW pg_strom.ccache_hot_tier_size;
+SHOW pg_strom.ccache_mmap_load;
+SHOW pg_strom.enable_brin_filter;
+SHOW pg_strom.enable_gpusort;
+SHOW pg_strom.enable_gpuwindow;
+SHOW pg_strom.enable_nvtx;
+SHOW pg_strom.fused_outer_join;
+SHOW pg_strom.gpu_cost_calibration;
+SHOW pg_strom.gpu_memory_oversubscribe;
+SHOW pg_strom.gpu_memory_shared_pool_size;
+SHOW pg_strom.gpu_share_weight;
+SHOW pg_strom.gpu_topology_aware;
+SHOW pg_strom.gpujoin_adaptive_reorder;
+SHOW pg_strom.gpujoin_bloom_filter;
+SHOW pg_strom.gpujoin_heavy_hitter;
+SHOW pg_strom.gpujoin_inner_cache;
+SHOW pg_strom.gpujoin_inner_partition_size;
+SHOW pg_strom.gpujoin_shared_inner;
+SHOW pg_strom.gpujoin_sorted_inner;
+SHOW pg_strom.gpupreagg_compensated_sum;
+SHOW pg_strom.gpupreagg_full_aggregation;
+SHOW pg_strom.gpupreagg_shared_final_buffer;
+SHOW pg_strom.gpupreagg_spill_final_buffer;
+SHOW pg_strom.gpuscan_late_materialization;
+SHOW pg_strom.gpuscan_mvcc_check;
+SHOW pg_strom.gpuscan_zero_copy;
+SHOW pg_strom.gpusort_max_bound;
+SHOW pg_strom.gstore_max_segments;
+SHOW pg_strom.heapscan_prefetch;
+SHOW pg_strom.max_cuda_contexts_per_device;
+SHOW pg_strom.min_chunk_size;
+SHOW pg_strom.num_program_builders;
+SHOW pg_strom.numa_node_binding;
+SHOW pg_strom.nvme_max_prefetch_tasks;
+SHOW pg_strom.plcuda_arg_cache_threshold;
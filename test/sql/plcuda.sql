@@ -0,0 +1,62 @@
+--
+-- Test for PL/CUDA functions
+--
+SET client_min_messages = error;
+DROP FUNCTION IF EXISTS pg_temp.plcuda_add(int, int);
+RESET client_min_messages;
+
+CREATE FUNCTION pg_temp.plcuda_add(int, int)
+RETURNS int
+AS $$
+#plcuda_include "cuda_mathlib.h"
+#plcuda_begin
+  if (get_global_id() == 0)
+    *retval = pgfn_int4pl(kcxt, arg1, arg2);
+#plcuda_end
+$$ LANGUAGE plcuda;
+
+SELECT pg_temp.plcuda_add(100, 23);
+SELECT pg_temp.plcuda_add(x, x * 2) FROM generate_series(1,3) x;
+
+-- prep, main and post kernels share the working buffer
+CREATE FUNCTION pg_temp.plcuda_sum_ids(int)
+RETURNS bigint
+AS $$
+#plcuda_working_bufsz 8
+#plcuda_prep
+#plcuda_num_threads 1
+  *((cl_ulong *)workbuf) = 0;
+#plcuda_end
+#plcuda_begin
+#plcuda_num_threads 1000
+  if (get_global_id() < arg1.value)
+    atomicAdd((cl_ulong *)workbuf, (cl_ulong)get_global_id());
+#plcuda_end
+#plcuda_post
+#plcuda_num_threads 1
+  retval->isnull = false;
+  retval->value = *((cl_long *)workbuf);
+#plcuda_end
+$$ LANGUAGE plcuda;
+
+SELECT pg_temp.plcuda_sum_ids(1000);
+SELECT pg_temp.plcuda_sum_ids(x) FROM generate_series(0,2) x;
+
+-- set-returning function
+CREATE FUNCTION pg_temp.plcuda_series(int)
+RETURNS SETOF int
+AS $$
+#plcuda_results_bufsz 65536
+#plcuda_begin
+#plcuda_num_threads 1000
+  Datum		tup_values[1];
+  cl_bool	tup_isnull[1];
+  tup_values[0] = (Datum)get_global_id();
+  tup_isnull[0] = false;
+  if (get_global_id() < arg1.value)
+    plcuda_results_store_tuple(kcxt, kds_results, tup_values, tup_isnull);
+#plcuda_end
+$$ LANGUAGE plcuda;
+
+SELECT count(*), sum(x), min(x), max(x) FROM pg_temp.plcuda_series(100) x;
+SELECT count(*) FROM pg_temp.plcuda_series(0) x;
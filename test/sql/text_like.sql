@@ -0,0 +1,83 @@
+--
+-- Test for LIKE operator with fast path
+--
+RESET pg_strom.enabled;
+SET pg_strom.cpu_fallback = on;
+SET enable_indexscan = off;
+-- exact, prefix and suffix match
+SELECT aid, atext LIKE 'c81e728d9d4c2f636f067f89cc14862c' v1,
+       atext LIKE 'ab%' v2, atext LIKE '%%0f%%' v3,
+       atext LIKE '%e3' v4, atext NOT LIKE 'a%' v5, atext NOT LIKE '%9' v6
+  INTO pg_temp.test01a
+  FROM t1
+ WHERE aid % 2 = 0;
+-- substring search by shift-and, and by memcmp for long needles
+SELECT aid, atext LIKE '%abc%' v1, atext NOT LIKE '%0%' v2,
+       atext LIKE '%%' v3, atext LIKE '%' v4, atext LIKE '' v5,
+       (atext || atext) LIKE '%e51657dab8c37e33defde51cf91e1e03e5%' v6,
+       (atext || atext) NOT LIKE '%cf91e1e03e51657dab8c37e33defde51cf91e1e03e%' v7
+  INTO pg_temp.test02a
+  FROM t1
+ WHERE aid % 2 = 1;
+-- escaped characters, and patterns for the generic matcher
+SELECT id, (cat || '%_\') LIKE '%\%\_\\' v1, cat LIKE 'test\_%' v2,
+       cat LIKE '%t_0%' v3, cat LIKE 't%0' v4, cat NOT LIKE '%9%1' v5
+  INTO pg_temp.test03a
+  FROM t0
+ WHERE id % 7 = 0;
+-- multibyte characters
+SELECT id, ('ＧＰＵ' || cat) LIKE '%ＰＵt%' v1, (cat || 'データ') LIKE '%ータ' v2,
+       ('データ' || cat) LIKE 'デ%' v3, (cat || 'データ') NOT LIKE '%デ%' v4
+  INTO pg_temp.test04a
+  FROM t0
+ WHERE id % 7 = 1;
+-- LIKE in WHERE clause
+SELECT aid, atext
+  INTO pg_temp.test05a
+  FROM t1
+ WHERE atext LIKE '%ab%' AND atext NOT LIKE '%ff';
+
+SET pg_strom.enabled = off;
+-- exact, prefix and suffix match
+SELECT aid, atext LIKE 'c81e728d9d4c2f636f067f89cc14862c' v1,
+       atext LIKE 'ab%' v2, atext LIKE '%%0f%%' v3,
+       atext LIKE '%e3' v4, atext NOT LIKE 'a%' v5, atext NOT LIKE '%9' v6
+  INTO pg_temp.test01b
+  FROM t1
+ WHERE aid % 2 = 0;
+-- substring search by shift-and, and by memcmp for long needles
+SELECT aid, atext LIKE '%abc%' v1, atext NOT LIKE '%0%' v2,
+       atext LIKE '%%' v3, atext LIKE '%' v4, atext LIKE '' v5,
+       (atext || atext) LIKE '%e51657dab8c37e33defde51cf91e1e03e5%' v6,
+       (atext || atext) NOT LIKE '%cf91e1e03e51657dab8c37e33defde51cf91e1e03e%' v7
+  INTO pg_temp.test02b
+  FROM t1
+ WHERE aid % 2 = 1;
+-- escaped characters, and patterns for the generic matcher
+SELECT id, (cat || '%_\') LIKE '%\%\_\\' v1, cat LIKE 'test\_%' v2,
+       cat LIKE '%t_0%' v3, cat LIKE 't%0' v4, cat NOT LIKE '%9%1' v5
+  INTO pg_temp.test03b
+  FROM t0
+ WHERE id % 7 = 0;
+-- multibyte characters
+SELECT id, ('ＧＰＵ' || cat) LIKE '%ＰＵt%' v1, (cat || 'データ') LIKE '%ータ' v2,
+       ('データ' || cat) LIKE 'デ%' v3, (cat || 'データ') NOT LIKE '%デ%' v4
+  INTO pg_temp.test04b
+  FROM t0
+ WHERE id % 7 = 1;
+-- LIKE in WHERE clause
+SELECT aid, atext
+  INTO pg_temp.test05b
+  FROM t1
+ WHERE atext LIKE '%ab%' AND atext NOT LIKE '%ff';
+
+(SELECT * FROM pg_temp.test01a EXCEPT ALL SELECT * FROM pg_temp.test01b);
+(SELECT * FROM pg_temp.test01b EXCEPT ALL SELECT * FROM pg_temp.test01a);
+(SELECT * FROM pg_temp.test02a EXCEPT ALL SELECT * FROM pg_temp.test02b);
+(SELECT * FROM pg_temp.test02b EXCEPT ALL SELECT * FROM pg_temp.test02a);
+(SELECT * FROM pg_temp.test03a EXCEPT ALL SELECT * FROM pg_temp.test03b);
+(SELECT * FROM pg_temp.test03b EXCEPT ALL SELECT * FROM pg_temp.test03a);
+(SELECT * FROM pg_temp.test04a EXCEPT ALL SELECT * FROM pg_temp.test04b);
+(SELECT * FROM pg_temp.test04b EXCEPT ALL SELECT * FROM pg_temp.test04a);
+(SELECT * FROM pg_temp.test05a EXCEPT ALL SELECT * FROM pg_temp.test05b);
+(SELECT * FROM pg_temp.test05b EXCEPT ALL SELECT * FROM pg_temp.test05a);
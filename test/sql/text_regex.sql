@@ -0,0 +1,89 @@
+--
+-- Test for regular expression by DFA
+--
+RESET pg_strom.enabled;
+SET pg_strom.cpu_fallback = on;
+SET enable_indexscan = off;
+-- anchors, alternation and {m,n}
+SELECT aid, atext ~ '^[0-9]{2}' v1, atext ~ '(ab|cd|e)f$' v2,
+       atext ~ '^a|b$' v3, atext !~ '[a-c]{2,4}[0-9]' v4,
+       atext ~ '^.{3}(1|2)' v5, atext ~ 'f{2,}' v6
+  INTO pg_temp.test01a
+  FROM t1
+ WHERE aid % 3 = 0;
+-- bracket expressions
+SELECT aid, atext ~ '[^0-9a-c]{5}' v1, atext ~ '[a-f0-3]e[[:digit:]]' v2,
+       atext ~ '\d\D\d' v3, atext !~ '[]a]0' v4
+  INTO pg_temp.test02a
+  FROM t1
+ WHERE aid % 3 = 1;
+-- multibyte input
+SELECT aid, ('ＧＰＵ' || atext) ~ '^.Ｐ' v1, (atext || 'データ') ~ 'タ$' v2,
+       (atext || 'データ') ~ '[0-9][デー]{2}' v3,
+       ('データ' || atext) ~ '^.{3}[a-f]' v4
+  INTO pg_temp.test03a
+  FROM t1
+ WHERE aid % 3 = 2;
+-- case insensitive
+SELECT aid, atext ~* '^A[B-F]' v1, upper(atext) ~* 'e{2}' v2,
+       atext !~* 'F.?3' v3, upper(atext) !~* '^(0|A)' v4
+  INTO pg_temp.test04a
+  FROM t1
+ WHERE aid % 2 = 0;
+-- patterns beyond the NFA/DFA limits shall be evaluated by CPU
+SELECT aid, atext ~ 'a.{10}b' v1, atext ~ '[0-9]{20}' v2,
+       atext ~ '(a)\1' v3
+  INTO pg_temp.test05a
+  FROM t1
+ WHERE aid % 2 = 1;
+
+SET pg_strom.enabled = off;
+-- anchors, alternation and {m,n}
+SELECT aid, atext ~ '^[0-9]{2}' v1, atext ~ '(ab|cd|e)f$' v2,
+       atext ~ '^a|b$' v3, atext !~ '[a-c]{2,4}[0-9]' v4,
+       atext ~ '^.{3}(1|2)' v5, atext ~ 'f{2,}' v6
+  INTO pg_temp.test01b
+  FROM t1
+ WHERE aid % 3 = 0;
+-- bracket expressions
+SELECT aid, atext ~ '[^0-9a-c]{5}' v1, atext ~ '[a-f0-3]e[[:digit:]]' v2,
+       atext ~ '\d\D\d' v3, atext !~ '[]a]0' v4
+  INTO pg_temp.test02b
+  FROM t1
+ WHERE aid % 3 = 1;
+-- multibyte input
+SELECT aid, ('ＧＰＵ' || atext) ~ '^.Ｐ' v1, (atext || 'データ') ~ 'タ$' v2,
+       (atext || 'データ') ~ '[0-9][デー]{2}' v3,
+       ('データ' || atext) ~ '^.{3}[a-f]' v4
+  INTO pg_temp.test03b
+  FROM t1
+ WHERE aid % 3 = 2;
+-- case insensitive
+SELECT aid, atext ~* '^A[B-F]' v1, upper(atext) ~* 'e{2}' v2,
+       atext !~* 'F.?3' v3, upper(atext) !~* '^(0|A)' v4
+  INTO pg_temp.test04b
+  FROM t1
+ WHERE aid % 2 = 0;
+-- patterns beyond the NFA/DFA limits shall be evaluated by CPU
+SELECT aid, atext ~ 'a.{10}b' v1, atext ~ '[0-9]{20}' v2,
+       atext ~ '(a)\1' v3
+  INTO pg_temp.test05b
+  FROM t1
+ WHERE aid % 2 = 1;
+
+(SELECT * FROM pg_temp.test01a EXCEPT ALL SELECT * FROM pg_temp.test01b);
+(SELECT * FROM pg_temp.test01b EXCEPT ALL SELECT * FROM pg_temp.test01a);
+(SELECT * FROM pg_temp.test02a EXCEPT ALL SELECT * FROM pg_temp.test02b);
+(SELECT * FROM pg_temp.test02b EXCEPT ALL SELECT * FROM pg_temp.test02a);
+(SELECT * FROM pg_temp.test03a EXCEPT ALL SELECT * FROM pg_temp.test03b);
+(SELECT * FROM pg_temp.test03b EXCEPT ALL SELECT * FROM pg_temp.test03a);
+(SELECT * FROM pg_temp.test04a EXCEPT ALL SELECT * FROM pg_temp.test04b);
+(SELECT * FROM pg_temp.test04b EXCEPT ALL SELECT * FROM pg_temp.test04a);
+(SELECT * FROM pg_temp.test05a EXCEPT ALL SELECT * FROM pg_temp.test05b);
+(SELECT * FROM pg_temp.test05b EXCEPT ALL SELECT * FROM pg_temp.test05a);
+
+-- WHERE clause by DFA, with GpuScan
+RESET pg_strom.enabled;
+SELECT count(*) FROM t1 WHERE atext ~ '^[0-9a-c]{3}(d|e)' AND atext !~* 'F$';
+SET pg_strom.enabled = off;
+SELECT count(*) FROM t1 WHERE atext ~ '^[0-9a-c]{3}(d|e)' AND atext !~* 'F$';
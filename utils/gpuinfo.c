@@ -32,7 +32,9 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <libgen.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
@@ -189,7 +191,7 @@ static struct
 };
 #undef DEV_ATTR
 
-static void output_device(CUdevice device, int dev_id)
+static void output_device(FILE *out, CUdevice device, int dev_id)
 {
 	char		dev_name[1024];
 	size_t		dev_memsz;
@@ -199,27 +201,28 @@ static void output_device(CUdevice device, int dev_id)
 
 	/* device identifier */
 	if (!machine_format)
-		printf("--------\nDevice Identifier: %d\n", dev_id);
+		fprintf(out, "--------\nDevice Identifier: %d\n", dev_id);
 	else
-		printf("DEVICE%d:DEVICE_ID=%d\n", dev_id, dev_id);
+		fprintf(out, "DEVICE%d:DEVICE_ID=%d\n", dev_id, dev_id);
 
 	/* device name */
 	rc = cuDeviceGetName(dev_name, sizeof(dev_name), device);
 	if (rc != CUDA_SUCCESS)
 		error_exit(rc, "failed on cuDeviceGetName");
 	if (!machine_format)
-		printf("Device Name: %s\n", dev_name);
+		fprintf(out, "Device Name: %s\n", dev_name);
 	else
-		printf("DEVICE%d:DEVICE_NAME=%s\n", dev_id, dev_name);
+		fprintf(out, "DEVICE%d:DEVICE_NAME=%s\n", dev_id, dev_name);
 
 	/* device RAM size */
 	rc = cuDeviceTotalMem(&dev_memsz, device);
 	if (rc != CUDA_SUCCESS)
 		error_exit(rc, "failed on cuDeviceTotalMem");
 	if (!machine_format)
-		printf("Global memory size: %zuMB\n", dev_memsz >> 20);
+		fprintf(out, "Global memory size: %zuMB\n", dev_memsz >> 20);
 	else
-		printf("DEVICE%d:GLOBAL_MEMORY_SIZE=%zu\n", dev_id, dev_memsz);
+		fprintf(out, "DEVICE%d:GLOBAL_MEMORY_SIZE=%zu\n",
+				dev_id, dev_memsz);
 
 	for (i=0; i < lengthof(attribute_catalog); i++)
 	{
@@ -238,95 +241,130 @@ static void output_device(CUdevice device, int dev_id)
 			error_exit(rc, "failed on cuDeviceGetAttribute");
 
 		if (machine_format)
-			printf("DEVICE%d:%s=%d\n", dev_id, attname_m, dev_prop);
+			fprintf(out, "DEVICE%d:%s=%d\n", dev_id, attname_m, dev_prop);
 		else
 		{
 			switch (attclass)
 			{
 				case ATTRCLASS_INT:
-					printf("%s: %d\n", attname_h, dev_prop);
+					fprintf(out, "%s: %d\n", attname_h, dev_prop);
 					break;
 
 			case ATTRCLASS_BYTES:
 				if (dev_prop > (4UL << 30))
-					printf("%s: %.1fGB\n", attname_h,
-						   (double)dev_prop / (double)(1UL << 30));
+					fprintf(out, "%s: %.1fGB\n", attname_h,
+						(double)dev_prop / (double)(1UL << 30));
 				else if (dev_prop > (4UL << 20))
-					printf("%s: %.1fMB\n", attname_h,
-						   (double)dev_prop / (double)(1UL << 20));
+					fprintf(out, "%s: %.1fMB\n", attname_h,
+						(double)dev_prop / (double)(1UL << 20));
 				else if (dev_prop > (4UL << 10))
-					printf("%s: %.1fKB\n", attname_h,
-						   (double)dev_prop / (double)(1UL << 10));
+					fprintf(out, "%s: %.1fKB\n", attname_h,
+						(double)dev_prop / (double)(1UL << 10));
 				else
-					printf("%s: %dbytes\n", attname_h, dev_prop);
+					fprintf(out, "%s: %dbytes\n", attname_h, dev_prop);
 				break;
 
 			case ATTRCLASS_KB:
 				if (dev_prop > (4UL << 20))
-					printf("%s: %.1fGB\n", attname_h,
-						   (double)dev_prop / (double)(1UL << 20));
+					fprintf(out, "%s: %.1fGB\n", attname_h,
+						(double)dev_prop / (double)(1UL << 20));
 				else if (dev_prop > (4UL << 10))
-					printf("%s: %.1fMB\n", attname_h,
-						   (double)dev_prop / (double)(1UL << 10));
+					fprintf(out, "%s: %.1fMB\n", attname_h,
+						(double)dev_prop / (double)(1UL << 10));
 				else
-					printf("%s: %dKB\n", attname_h, dev_prop);
+					fprintf(out, "%s: %dKB\n", attname_h, dev_prop);
 				break;
 
 			case ATTRCLASS_KHZ:
 				if (dev_prop > 4000000UL)
-					printf("%s: %.1fGHz\n", attname_h,
-						   (double)dev_prop / 1000000.0);
+					fprintf(out, "%s: %.1fGHz\n", attname_h,
+						(double)dev_prop / 1000000.0);
 				else if (dev_prop > 4000UL)
-					printf("%s: %.1fMHz\n", attname_h,
-						   (double)dev_prop / 1000.0);
+					fprintf(out, "%s: %.1fMHz\n", attname_h,
+						(double)dev_prop / 1000.0);
 				else
-					printf("%s: %dKHz\n", attname_h, dev_prop);
+					fprintf(out, "%s: %dKHz\n", attname_h, dev_prop);
 				break;
 
 			case ATTRCLASS_COMPUTEMODE:
 				switch (dev_prop)
 				{
 					case CU_COMPUTEMODE_DEFAULT:
-						printf("%s: default\n", attname_h);
+						fprintf(out, "%s: default\n", attname_h);
 						break;
 #if CUDA_VERSION < 8000
 					case CU_COMPUTEMODE_EXCLUSIVE:
-						printf("%s: exclusive\n", attname_h);
+						fprintf(out, "%s: exclusive\n", attname_h);
 						break;
 #endif
 					case CU_COMPUTEMODE_PROHIBITED:
-						printf("%s: prohibited\n", attname_h);
+						fprintf(out, "%s: prohibited\n", attname_h);
 						break;
 					case CU_COMPUTEMODE_EXCLUSIVE_PROCESS:
-						printf("%s: exclusive process\n", attname_h);
+						fprintf(out, "%s: exclusive process\n", attname_h);
 						break;
 					default:
-						printf("%s: unknown\n", attname_h);
+						fprintf(out, "%s: unknown\n", attname_h);
 						break;
 				}
 				break;
 
 			case ATTRCLASS_BOOL:
-				printf("%s: %s\n", attname_h, dev_prop ? "true" : "false");
+				fprintf(out, "%s: %s\n",
+						attname_h, dev_prop ? "true" : "false");
 				break;
 
 			default:
-				printf("%s: %d\n", attname_h, dev_prop);
+				fprintf(out, "%s: %d\n", attname_h, dev_prop);
 				break;
 			}
 		}
 	}
 }
 
-int main(int argc, char *argv[])
+/*
+ * device_probe - state of the thread which collects properties of a device
+ */
+typedef struct
+{
+	pthread_t	thread;
+	int			dev_id;
+	char	   *buffer;
+	size_t		length;
+} device_probe;
+
+static void *
+probe_device_main(void *arg)
 {
+	device_probe *probe = arg;
 	CUdevice	device;
+	CUresult	rc;
+	FILE	   *out;
+
+	out = open_memstream(&probe->buffer, &probe->length);
+	if (!out)
+	{
+		fprintf(stderr, "failed on open_memstream: %m\n");
+		exit(1);
+	}
+	rc = cuDeviceGet(&device, probe->dev_id);
+	if (rc != CUDA_SUCCESS)
+		error_exit(rc, "failed on cuDeviceGet");
+	output_device(out, device, probe->dev_id);
+	fclose(out);
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
 	CUresult	rc;
 	int			version;
 	int			i, count;
 	int			nr_gpus = 1;
 	int			opt;
 	FILE	   *filp;
+	device_probe *probes;
 
 	/*
 	 * Parse options
@@ -412,12 +450,39 @@ int main(int argc, char *argv[])
 	else
 		printf("PLATFORM:NUMBER_OF_DEVICES=%d\n", nr_gpus);
 
+	/*
+	 * Collect properties of the devices in parallel, because a few
+	 * hundreds of cuDeviceGetAttribute() calls per device are not
+	 * negligible on the hosts with many GPUs. Each thread writes out
+	 * the properties to its own buffer, then we print them in order.
+	 */
+	probes = calloc(nr_gpus, sizeof(device_probe));
+	if (!probes)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
 	for (i=0; i < nr_gpus; i++)
 	{
-		rc = cuDeviceGet(&device, i);
-		if (rc != CUDA_SUCCESS)
-			error_exit(rc, "failed on cuDeviceGet");
-		output_device(device, i);
+		probes[i].dev_id = i;
+		if ((errno = pthread_create(&probes[i].thread, NULL,
+									probe_device_main, &probes[i])) != 0)
+		{
+			fprintf(stderr, "failed on pthread_create: %m\n");
+			return 1;
+		}
 	}
+	for (i=0; i < nr_gpus; i++)
+	{
+		if ((errno = pthread_join(probes[i].thread, NULL)) != 0)
+		{
+			fprintf(stderr, "failed on pthread_join: %m\n");
+			return 1;
+		}
+		fwrite(probes[i].buffer, 1, probes[i].length, stdout);
+		free(probes[i].buffer);
+	}
+	free(probes);
+
 	return 0;
 }